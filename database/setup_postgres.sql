@@ -87,11 +87,17 @@ CREATE TABLE IF NOT EXISTS readers (
     email VARCHAR(255),
     address TEXT,
     date_of_birth DATE,
+    card_uid VARCHAR(32),
     created_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
     updated_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP
 );
 
+-- UID thẻ RFID (hex in hoa như trạm gửi, ví dụ "04A1B2C3"); station gateway dựng bảng tra
+-- UID → độc giả từ cột này. ALTER cho DB tạo trước khi có cột
+ALTER TABLE readers ADD COLUMN IF NOT EXISTS card_uid VARCHAR(32);
+
 -- Index cho readers
+CREATE UNIQUE INDEX IF NOT EXISTS idx_readers_card_uid ON readers(card_uid);
 CREATE INDEX IF NOT EXISTS idx_readers_student_id ON readers(student_id);
 CREATE INDEX IF NOT EXISTS idx_readers_name ON readers(name);
 CREATE INDEX IF NOT EXISTS idx_readers_class ON readers(class);
@@ -190,6 +196,25 @@ CREATE TABLE IF NOT EXISTS login_history (
 CREATE INDEX IF NOT EXISTS idx_login_history_user_id ON login_history(user_id);
 CREATE INDEX IF NOT EXISTS idx_login_history_login_time ON login_history(login_time);
 
+-- =====================================================
+-- Bảng iot_scan_events (Lịch sử quét, ghi theo lô bởi station gateway)
+-- =====================================================
+-- Gateway ghi bằng COPY, mỗi transaction gom mọi sự kiện tới trong vài ms (group commit).
+-- payload là JSON gốc của trạm (data sinh viên/sách, trace...)
+CREATE TABLE IF NOT EXISTS iot_scan_events (
+    id BIGSERIAL PRIMARY KEY,
+    device_id VARCHAR(64) NOT NULL,
+    scan_type VARCHAR(50) NOT NULL,
+    scan_data VARCHAR(255),
+    success BOOLEAN NOT NULL DEFAULT false,
+    payload JSONB NOT NULL,
+    received_at TIMESTAMPTZ NOT NULL DEFAULT CURRENT_TIMESTAMP
+);
+
+-- Index cho iot_scan_events
+CREATE INDEX IF NOT EXISTS idx_iot_scan_events_device_time ON iot_scan_events(device_id, received_at);
+CREATE INDEX IF NOT EXISTS idx_iot_scan_events_scan_data ON iot_scan_events(scan_data);
+
 -- =====================================================
 -- Dữ liệu mẫu (Sample Data)
 -- =====================================================
@@ -5,35 +5,32 @@ import '../models/iot_scan_event_model.dart';
 
 class IoTWebSocketDataSource {
   WebSocketChannel? _channel;
+  StreamSubscription? _channelSubscription;
   final String wsUrl;
   final _scanEventController = StreamController<IoTScanEventModel>.broadcast();
   bool _isConnected = false;
 
+  // Kết nối lại khi mất mạng (trừ khi gọi disconnect())
+  bool _closedByUser = false;
+  int _reconnectAttempts = 0;
+  Timer? _reconnectTimer;
+
+  // Station gateway gán seq theo trạm: nhớ seq cuối đã nhận để khi kết nối lại
+  // gửi since=<trạm>:<seq> và nhận lại phần đã lỡ. Backend cũ bỏ qua các tham số này.
+  final Map<String, int> _lastSeq = {};
+  String? _epoch;
+  bool _resuming = false;
+
   IoTWebSocketDataSource({required this.wsUrl});
 
   Stream<IoTScanEventModel> get scanEvents => _scanEventController.stream;
   bool get isConnected => _isConnected;
 
   Future<void> connect() async {
+    _closedByUser = false;
+    _reconnectTimer?.cancel();
     try {
-      _channel = WebSocketChannel.connect(Uri.parse(wsUrl));
-      _isConnected = true;
-
-      _channel!.stream.listen(
-        (message) {
-          _handleMessage(message);
-        },
-        onError: (error) {
-          _isConnected = false;
-          print('[IoT WebSocket] Error: $error');
-        },
-        onDone: () {
-          _isConnected = false;
-          print('[IoT WebSocket] Connection closed');
-        },
-      );
-
-      print('[IoT WebSocket] Connected to $wsUrl');
+      await _open();
     } catch (e) {
       _isConnected = false;
       print('[IoT WebSocket] Connection failed: $e');
@@ -41,17 +38,112 @@ class IoTWebSocketDataSource {
     }
   }
 
+  Future<void> _open() async {
+    final uri = _connectUri();
+    final channel = WebSocketChannel.connect(uri);
+    await channel.ready;
+    _channel = channel;
+    _isConnected = true;
+    _reconnectAttempts = 0;
+
+    _channelSubscription = channel.stream.listen(
+      (message) {
+        _handleMessage(message);
+      },
+      onError: (error) {
+        _isConnected = false;
+        print('[IoT WebSocket] Error: $error');
+      },
+      onDone: () {
+        _isConnected = false;
+        print('[IoT WebSocket] Connection closed');
+        _scheduleReconnect();
+      },
+    );
+
+    print('[IoT WebSocket] Connected to $uri');
+  }
+
+  // Lần đầu: hello=1 để lấy mốc seq. Kết nối lại: epoch + since của từng trạm
+  Uri _connectUri() {
+    final uri = Uri.parse(wsUrl);
+    final params = Map<String, String>.of(uri.queryParameters);
+    _resuming = _epoch != null;
+    if (_resuming) {
+      params['epoch'] = _epoch!;
+      params['since'] =
+          _lastSeq.entries.map((e) => '${e.key}:${e.value}').join(',');
+    } else {
+      params['hello'] = '1';
+    }
+    return uri.replace(queryParameters: params);
+  }
+
+  void _scheduleReconnect() {
+    if (_closedByUser || _scanEventController.isClosed) return;
+    _reconnectTimer?.cancel();
+    // 1s, 2s, 4s... tối đa 30s
+    final delay =
+        Duration(seconds: (1 << _reconnectAttempts.clamp(0, 5)).clamp(1, 30));
+    _reconnectAttempts++;
+    print('[IoT WebSocket] Reconnecting in ${delay.inSeconds}s');
+    _reconnectTimer = Timer(delay, () async {
+      try {
+        await _open();
+      } catch (e) {
+        print('[IoT WebSocket] Reconnect failed: $e');
+        _scheduleReconnect();
+      }
+    });
+  }
+
   void _handleMessage(dynamic message) {
     try {
       final Map<String, dynamic> json = jsonDecode(message);
+      if (json['type'] == 'hello') {
+        _handleHello(json);
+        return;
+      }
       final event = IoTScanEventModel.fromJson(json);
+      final seq = event.seq;
+      if (seq != null) {
+        // Phát lại chồng lên phần đã nhận (hiếm): bỏ bản trùng
+        final last = _lastSeq[event.deviceId];
+        if (last != null && seq <= last) return;
+        _lastSeq[event.deviceId] = seq;
+      }
       _scanEventController.add(event);
     } catch (e) {
       print('[IoT WebSocket] Failed to parse message: $e');
     }
   }
 
+  void _handleHello(Map<String, dynamic> json) {
+    final epoch = json['epoch'] as String?;
+    if (_epoch != null && epoch != _epoch) {
+      // Gateway đã khởi động lại: seq cũ vô nghĩa, gateway phát lại từ seq 1
+      _lastSeq.clear();
+    }
+    _epoch = epoch;
+    if (!_resuming) {
+      final seqs = json['seq'] is Map<String, dynamic>
+          ? json['seq'] as Map<String, dynamic>
+          : const <String, dynamic>{};
+      for (final entry in seqs.entries) {
+        if (entry.value is num) {
+          _lastSeq.putIfAbsent(entry.key, () => (entry.value as num).toInt());
+        }
+      }
+    }
+    if (json['lost'] is Map<String, dynamic>) {
+      print('[IoT WebSocket] Missed events no longer on gateway: ${json['lost']}');
+    }
+  }
+
   void disconnect() {
+    _closedByUser = true;
+    _reconnectTimer?.cancel();
+    _channelSubscription?.cancel();
     _channel?.sink.close();
     _isConnected = false;
   }
@@ -7,6 +7,14 @@ class IoTScanEventModel {
   final String? error;
   final DateTime timestamp;
 
+  // Vết của lần quét (trạm chưa cập nhật firmware thì không có)
+  final String? traceId;
+  final Map<String, int> stagesMs; // sent, response, published: ms kể từ lúc quét
+  final int? serverMs; // Thời gian xử lý ở backend
+  final bool hasStationTime; // timestamp là giờ quét trên trạm (đã đồng bộ SNTP)
+  final DateTime receivedAt; // Giờ app nhận sự kiện
+  final int? seq; // Số thứ tự theo trạm do station gateway gán (backend không có)
+
   IoTScanEventModel({
     required this.deviceId,
     required this.scanType,
@@ -15,9 +23,23 @@ class IoTScanEventModel {
     this.data,
     this.error,
     required this.timestamp,
-  });
+    this.traceId,
+    this.stagesMs = const {},
+    this.serverMs,
+    this.hasStationTime = false,
+    DateTime? receivedAt,
+    this.seq,
+  }) : receivedAt = receivedAt ?? DateTime.now();
 
   factory IoTScanEventModel.fromJson(Map<String, dynamic> json) {
+    final receivedAt = DateTime.now();
+    final trace = json['trace'] is Map<String, dynamic>
+        ? json['trace'] as Map<String, dynamic>
+        : const <String, dynamic>{};
+    final stages = trace['stages_ms'] is Map<String, dynamic>
+        ? trace['stages_ms'] as Map<String, dynamic>
+        : const <String, dynamic>{};
+
     return IoTScanEventModel(
       deviceId: json['device_id'] ?? '',
       scanType: json['scan_type'] ?? '',
@@ -27,12 +49,22 @@ class IoTScanEventModel {
       error: json['error'],
       timestamp: json['timestamp'] != null
           ? DateTime.parse(json['timestamp'])
-          : DateTime.now(),
+          : receivedAt,
+      traceId: trace['id'] as String?,
+      stagesMs: {
+        for (final entry in stages.entries)
+          if (entry.value is num) entry.key: (entry.value as num).toInt(),
+      },
+      serverMs: (trace['server_ms'] as num?)?.toInt(),
+      hasStationTime: json['timestamp'] != null,
+      receivedAt: receivedAt,
+      seq: (json['seq'] as num?)?.toInt(),
     );
   }
 
   Map<String, dynamic> toJson() {
     return {
+      if (seq != null) 'seq': seq,
       'device_id': deviceId,
       'scan_type': scanType,
       'scan_data': scanData,
@@ -40,6 +72,12 @@ class IoTScanEventModel {
       'data': data,
       'error': error,
       'timestamp': timestamp.toIso8601String(),
+      if (traceId != null)
+        'trace': {
+          'id': traceId,
+          'stages_ms': stagesMs,
+          if (serverMs != null) 'server_ms': serverMs,
+        },
     };
   }
 
@@ -53,4 +91,41 @@ class IoTScanEventModel {
 
   // Lấy thông tin sách (nếu có)
   Map<String, dynamic>? get bookInfo => isBookScan && success ? data : null;
+
+  /// Thời gian (ms) của từng chặng từ lúc chạm thẻ tới khi form được điền.
+  /// Chặng nào thiếu mốc thì bỏ qua. Các chặng dùng giờ của cả trạm và app
+  /// (lan_delivery, total) chỉ có khi trạm đã đồng bộ giờ qua SNTP.
+  Map<String, int> hopBreakdown(DateTime formFilledAt) {
+    final sent = stagesMs['sent'];
+    final response = stagesMs['response'];
+    final published = stagesMs['published'];
+    final hops = <String, int>{};
+
+    if (sent != null) hops['station_queue'] = sent;
+    if (serverMs != null) hops['backend'] = serverMs!;
+    if (sent != null && response != null) {
+      hops['network'] = response - sent - (serverMs ?? 0);
+    }
+    if (response != null && published != null) {
+      hops['station_publish'] = published - response;
+    }
+    if (hasStationTime && published != null) {
+      final publishedAt = timestamp.add(Duration(milliseconds: published));
+      hops['lan_delivery'] = receivedAt.difference(publishedAt).inMilliseconds;
+    }
+    hops['form'] = formFilledAt.difference(receivedAt).inMilliseconds;
+    if (hasStationTime) {
+      hops['total'] = formFilledAt.difference(timestamp).inMilliseconds;
+    }
+    return hops;
+  }
+
+  /// Dòng log "[IoT Trace] <id> station_queue=3ms backend=42ms ..."
+  String traceSummary(DateTime formFilledAt) {
+    final hops = hopBreakdown(formFilledAt)
+        .entries
+        .map((hop) => '${hop.key}=${hop.value}ms')
+        .join(' ');
+    return '[IoT Trace] ${traceId ?? '-'} $scanType $hops';
+  }
 }
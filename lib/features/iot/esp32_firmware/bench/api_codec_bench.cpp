@@ -0,0 +1,342 @@
+// Micro-benchmark cho ApiCodec: đo ns/op và số byte cấp phát trên heap cho mỗi
+// payload builder và response parser, với response mẫu trong fixtures/ và các
+// response lớn/sai định dạng được sinh ra.
+//
+//   api_codec_bench [iterations] [fixtures_dir]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "api_codec.h"
+
+// ============================================
+// Đếm cấp phát heap
+// ============================================
+static size_t allocCount = 0;
+static size_t allocBytes = 0;
+
+void* operator new(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// ============================================
+// Bộ đo
+// ============================================
+struct BenchResult {
+    double nsPerOp;
+    double bytesPerOp;
+    double allocsPerOp;
+};
+
+template <typename Fn>
+static BenchResult runBench(size_t iterations, Fn fn) {
+    // Warm-up
+    for (size_t i = 0; i < iterations / 10 + 1; i++) {
+        fn();
+    }
+    
+    size_t startCount = allocCount;
+    size_t startBytes = allocBytes;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    
+    BenchResult r;
+    r.nsPerOp = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    r.bytesPerOp = (double)(allocBytes - startBytes) / iterations;
+    r.allocsPerOp = (double)(allocCount - startCount) / iterations;
+    return r;
+}
+
+static void printResult(const char* name, const BenchResult& r, const char* note = "") {
+    printf("%-44s %10.1f ns/op %8.1f B/op %6.2f allocs/op %s\n",
+           name, r.nsPerOp, r.bytesPerOp, r.allocsPerOp, note);
+}
+
+// ============================================
+// Dữ liệu đầu vào
+// ============================================
+struct Sample {
+    std::string name;
+    std::string json;
+};
+
+static bool readFile(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        out.append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+static std::vector<Sample> loadFixtures(const char* dir) {
+    std::vector<Sample> samples;
+    DIR* d = opendir(dir);
+    if (d == nullptr) {
+        fprintf(stderr, "Cannot open fixtures dir %s\n", dir);
+        return samples;
+    }
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() < 6 || name.compare(name.size() - 5, 5, ".json") != 0) {
+            continue;
+        }
+        Sample s;
+        s.name = name;
+        if (readFile(std::string(dir) + "/" + name, s.json)) {
+            samples.push_back(s);
+        }
+    }
+    closedir(d);
+    return samples;
+}
+
+static std::vector<Sample> generateSamples() {
+    std::vector<Sample> samples;
+    
+    // Tên rất dài (UTF-8) - phải bị cắt đúng ranh giới ký tự
+    std::string longName;
+    for (int i = 0; i < 40; i++) {
+        longName += "Nguyễn ";
+    }
+    samples.push_back({"gen_long_name",
+        "{\"success\":true,\"student\":{\"mssv\":\"2021001234\",\"name\":\"" + longName +
+        "\",\"class\":\"CNTT\",\"phone\":\"0\",\"email\":\"a@b.c\"}}"});
+    
+    // Nhiều phiếu mượn hơn MAX_ACTIVE_LOANS
+    std::string loans = "[";
+    for (int i = 0; i < 30; i++) {
+        char item[160];
+        snprintf(item, sizeof(item),
+                 "%s{\"book_code\":\"BK%06d\",\"book_name\":\"Sách số %d\",\"due_date\":\"2024-11-%02d\",\"days_left\":%d}",
+                 i ? "," : "", i, i, i % 28 + 1, 10 - i);
+        loans += item;
+    }
+    loans += "]";
+    samples.push_back({"gen_many_loans",
+        "{\"success\":true,\"student\":{\"mssv\":\"1\",\"name\":\"A\"},\"total_loans\":30,\"active_loans\":" + loans + "}"});
+    
+    // Sai kiểu dữ liệu
+    samples.push_back({"gen_wrong_types",
+        "{\"success\":\"yes\",\"student\":[1,2,3],\"active_loans\":{\"a\":1},\"book\":\"x\"}"});
+    samples.push_back({"gen_numeric_fields",
+        "{\"success\":true,\"student\":{\"mssv\":2021001234,\"name\":42},\"book\":{\"id\":42,\"available\":1}}"});
+    
+    // JSON hỏng
+    samples.push_back({"gen_truncated", "{\"success\":true,\"student\":{\"mssv\":\"2021"});
+    samples.push_back({"gen_not_object", "[true,false,null]"});
+    samples.push_back({"gen_empty", ""});
+    
+    // Lồng sâu vượt giới hạn nesting
+    std::string deep(64, '[');
+    deep += std::string(64, ']');
+    samples.push_back({"gen_deep_nesting", "{\"success\":true,\"student\":" + deep + "}"});
+    
+    return samples;
+}
+
+// ============================================
+// Main
+// ============================================
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    const char* fixturesDir = argc > 2 ? argv[2] : BENCH_FIXTURES_DIR;
+    
+    std::vector<Sample> samples = loadFixtures(fixturesDir);
+    std::vector<Sample> generated = generateSamples();
+    samples.insert(samples.end(), generated.begin(), generated.end());
+    
+    printf("ApiCodec benchmark, %zu iterations\n\n", iterations);
+    
+    // Payload builders
+    char output[API_PAYLOAD_MAX + 1];
+    const ScanSource source = {0, LANE_CHECKOUT};
+    char longUID[200];
+    memset(longUID, 'A', sizeof(longUID) - 1);
+    longUID[sizeof(longUID) - 1] = '\0';
+    
+    ScanTrace trace = {};
+    strcpy(trace.id, "4bf92f3577b34da6a3ce929d0e0e4736");
+    trace.tapEpochMs = 1729300000123ULL;
+    trace.stageMs[TRACE_SENT] = 3;
+    trace.stageMs[TRACE_RESPONSE] = 148;
+    trace.stageMs[TRACE_PUBLISHED] = 151;
+    trace.reached = (1 << TRACE_SENT) | (1 << TRACE_RESPONSE) | (1 << TRACE_PUBLISHED);
+    trace.serverMs = 42;
+    
+    printResult("createStudentPayload", runBench(iterations, [&] {
+        ApiCodec::createStudentPayload("04A1B2C3D4E5F6", source, DEVICE_ID, trace, output, sizeof(output));
+    }));
+    size_t n = ApiCodec::createStudentPayload(longUID, source, DEVICE_ID, trace, output, sizeof(output));
+    printResult("createStudentPayload(uid=199 chars)", runBench(iterations, [&] {
+        ApiCodec::createStudentPayload(longUID, source, DEVICE_ID, trace, output, sizeof(output));
+    }), n == 0 ? "[rejected: too large]" : "");
+    printResult("createBookPayload", runBench(iterations, [&] {
+        ApiCodec::createBookPayload("BK001234", DEVICE_ID, trace, output, sizeof(output));
+    }));
+    
+    // Batch: BATCH_MAX_ITEMS lần quét trong một request
+    BatchScan scans[BATCH_MAX_ITEMS];
+    for (uint8_t i = 0; i < BATCH_MAX_ITEMS; i++) {
+        scans[i] = {i % 2 ? "8935086854321" : "04A1B2C3D4E5F6", i % 2 == 1, {(uint8_t)(i % 2), LANE_CHECKOUT}, &trace};
+    }
+    char batchOutput[BATCH_PAYLOAD_MAX + 1];
+    n = ApiCodec::createBatchPayload(scans, BATCH_MAX_ITEMS, DEVICE_ID, batchOutput, sizeof(batchOutput));
+    printResult("createBatchPayload(4 scans)", runBench(iterations, [&] {
+        ApiCodec::createBatchPayload(scans, BATCH_MAX_ITEMS, DEVICE_ID, batchOutput, sizeof(batchOutput));
+    }), n == 0 ? "[rejected: too large]" : "");
+    
+    // Vết của lần quét: header traceparent và Server-Timing của backend
+    char traceparent[64];
+    printResult("formatTraceparent", runBench(iterations, [&] {
+        ApiCodec::formatTraceparent(trace, "00f067aa0ba902b7", traceparent, sizeof(traceparent));
+    }));
+    uint32_t serverMs = ApiCodec::parseServerTiming("db;dur=12.5, cache;desc=\"hit\", total;dur=41.6");
+    printResult("parseServerTiming", runBench(iterations, [&] {
+        ApiCodec::parseServerTiming("db;dur=12.5, cache;desc=\"hit\", total;dur=41.6");
+    }), serverMs == 42 ? "[ok]" : "[wrong]");
+    
+    HeartbeatInfo hb = {};
+    hb.deviceId = DEVICE_ID;
+    hb.deviceName = DEVICE_NAME;
+    hb.location = DEVICE_LOCATION;
+    hb.timestamp = 1729300000123ULL;
+    hb.freeHeap = 180000;
+    hb.largestFreeBlock = 110000;
+    hb.taskCount = 2;
+    hb.taskNames[0] = "loop";
+    hb.taskNames[1] = "net";
+    hb.stackFree[0] = 4200;
+    hb.stackFree[1] = 3100;
+    char heartbeatOutput[HEARTBEAT_PAYLOAD_MAX + 1];
+    n = ApiCodec::createHeartbeatPayload(hb, heartbeatOutput, sizeof(heartbeatOutput));
+    printResult("createHeartbeatPayload", runBench(iterations, [&] {
+        ApiCodec::createHeartbeatPayload(hb, heartbeatOutput, sizeof(heartbeatOutput));
+    }), n == 0 ? "[rejected: too large]" : "");
+    
+    // Response heartbeat kèm cấu hình mới (đường nhận cấu hình của StationParams)
+    // Kèm các trường trạm không dùng (backend mới hơn firmware) để chắc chúng không làm parse lỗi
+    const std::string configJson = "{\"success\":true,\"server_time\":\"2026-10-19T08:00:00Z\",\"message\":\"ok\","
+                                   "\"station\":{\"name\":\"Quay 1\",\"location\":\"Tang 2\"},"
+                                   "\"config\":{\"version\":17,\"updated_by\":\"admin\",\"params\":"
+                                   "{\"api_timeout_ms\":8000,\"rfid_debounce_ms\":null,\"heartbeat_interval_ms\":30000}},"
+                                   "\"firmware_update\":true,\"pending_commands\":[]}";
+    std::vector<char> configScratch(configJson.size() + 1);
+    ConfigUpdate update;
+    bool parsed = false;
+    BenchResult configCopy = runBench(iterations, [&] {
+        memcpy(configScratch.data(), configJson.data(), configJson.size());
+    });
+    BenchResult configParse = runBench(iterations, [&] {
+        memcpy(configScratch.data(), configJson.data(), configJson.size());
+        parsed = ApiCodec::parseHeartbeatResponse(configScratch.data(), configJson.size(), update);
+    });
+    configParse.nsPerOp -= configCopy.nsPerOp;
+    printResult("parseHeartbeatResponse", configParse,
+                parsed && update.revision == 17 && update.count == 3 && update.entries[1].reset && update.firmwareUpdate
+                ? "[ok]" : "[wrong]");
+    
+    // Sự kiện quét cho EventStream (WebSocket trên trạm)
+    char eventOutput[EVENT_STREAM_EVENT_MAX];
+    StudentInfo eventStudent;
+    resetStudentInfo(eventStudent);
+    eventStudent.success = true;
+    strcpy(eventStudent.mssv, "20210001");
+    strcpy(eventStudent.name, "Nguyễn Thị Thanh Hương");
+    strcpy(eventStudent.className, "CNTT-K66");
+    strcpy(eventStudent.email, "huong.ntt@example.edu.vn");
+    eventStudent.loanCount = 3;
+    eventStudent.trace = trace;
+    n = ApiCodec::createStudentEvent("04A1B2C3", eventStudent, source, DEVICE_ID, eventOutput, sizeof(eventOutput));
+    printResult("createStudentEvent", runBench(iterations, [&] {
+        ApiCodec::createStudentEvent("04A1B2C3", eventStudent, source, DEVICE_ID, eventOutput, sizeof(eventOutput));
+    }), n == 0 ? "[rejected: too large]" : "");
+    BookInfo eventBook;
+    resetBookInfo(eventBook);
+    eventBook.success = true;
+    strcpy(eventBook.title, "Giáo trình Giải tích 1");
+    strcpy(eventBook.code, "8935086854321");
+    eventBook.available = true;
+    eventBook.trace = trace;
+    printResult("createBookEvent", runBench(iterations, [&] {
+        ApiCodec::createBookEvent("8935086854321", eventBook, DEVICE_ID, eventOutput, sizeof(eventOutput));
+    }));
+    printf("\n");
+    
+    // Response parsers (parse zero-copy sửa input, nên mỗi lần phải copy lại;
+    // thời gian copy được đo riêng và trừ đi)
+    std::vector<char> scratch(API_RESPONSE_MAX + 1);
+    StudentInfo student;
+    BookInfo book;
+    
+    // Response batch ghép từ các fixture: tách mảng results rồi parse từng phần tử
+    std::string batchJson = "{\"success\":true,\"results\":[";
+    for (const Sample& s : samples) {
+        if (s.name.compare(0, 4, "gen_") != 0) {
+            batchJson += (batchJson.back() == '[' ? "" : ",") + s.json;
+        }
+    }
+    batchJson += "]}";
+    std::vector<char> batchScratch(batchJson.size() + 1);
+    char* items[BATCH_MAX_ITEMS];
+    size_t lengths[BATCH_MAX_ITEMS];
+    int found = 0;
+    BenchResult batchCopy = runBench(iterations, [&] {
+        memcpy(batchScratch.data(), batchJson.data(), batchJson.size());
+    });
+    BenchResult split = runBench(iterations, [&] {
+        memcpy(batchScratch.data(), batchJson.data(), batchJson.size());
+        found = ApiCodec::splitBatchResults(batchScratch.data(), batchJson.size(), items, lengths, BATCH_MAX_ITEMS);
+    });
+    split.nsPerOp -= batchCopy.nsPerOp;
+    std::string splitName = "splitBatchResults(" + std::to_string(batchJson.size()) + " bytes)";
+    printResult(splitName.c_str(), split, found > 0 ? "[ok]" : "[rejected]");
+    
+    for (const Sample& s : samples) {
+        size_t len = s.json.size() < API_RESPONSE_MAX ? s.json.size() : API_RESPONSE_MAX;
+        BenchResult copy = runBench(iterations, [&] {
+            memcpy(scratch.data(), s.json.data(), len);
+        });
+    
+        BenchResult rs = runBench(iterations, [&] {
+            memcpy(scratch.data(), s.json.data(), len);
+            ApiCodec::parseStudentResponse(scratch.data(), len, student);
+        });
+        rs.nsPerOp -= copy.nsPerOp;
+    
+        BenchResult rb = runBench(iterations, [&] {
+            memcpy(scratch.data(), s.json.data(), len);
+            ApiCodec::parseBookResponse(scratch.data(), len, book);
+        });
+        rb.nsPerOp -= copy.nsPerOp;
+    
+        std::string name = "parseStudentResponse(" + s.name + ")";
+        printResult(name.c_str(), rs, student.success ? "[ok]" : "[rejected]");
+        name = "parseBookResponse(" + s.name + ")";
+        printResult(name.c_str(), rb, book.success ? "[ok]" : "[rejected]");
+    }
+    
+    return 0;
+}
@@ -0,0 +1,119 @@
+// libFuzzer target cho ApiCodec.
+// Input được dùng làm response của server (cho cả hai parser) và làm UID/barcode
+// cho payload builder. Kiểm tra: không crash, chuỗi luôn kết thúc '\0' trong
+// buffer, số phiếu mượn không vượt MAX_ACTIVE_LOANS, payload không vượt buffer
+// và giữ nguyên giá trị đầu vào, phần tử tách từ response batch nằm trong input.
+//
+//   api_codec_fuzz -max_len=4096 corpus/ ../fixtures/
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "api_codec.h"
+
+// Không dùng assert: bản Release định nghĩa NDEBUG
+#define FUZZ_CHECK(x) do { if (!(x)) __builtin_trap(); } while (0)
+#define CHECK_TERMINATED(field) FUZZ_CHECK(strnlen(field, sizeof(field)) < sizeof(field))
+
+static void checkStudent(const StudentInfo& s) {
+    CHECK_TERMINATED(s.mssv);
+    CHECK_TERMINATED(s.name);
+    CHECK_TERMINATED(s.className);
+    CHECK_TERMINATED(s.phone);
+    CHECK_TERMINATED(s.email);
+    CHECK_TERMINATED(s.error);
+    FUZZ_CHECK(s.loanCount <= MAX_ACTIVE_LOANS);
+    for (uint8_t i = 0; i < s.loanCount; i++) {
+        CHECK_TERMINATED(s.loans[i].bookCode);
+        CHECK_TERMINATED(s.loans[i].bookName);
+        CHECK_TERMINATED(s.loans[i].dueDate);
+    }
+}
+
+static void checkBook(const BookInfo& b) {
+    CHECK_TERMINATED(b.id);
+    CHECK_TERMINATED(b.title);
+    CHECK_TERMINATED(b.code);
+    CHECK_TERMINATED(b.author);
+    CHECK_TERMINATED(b.error);
+}
+
+static void checkPayload(size_t length, const char* output, size_t capacity,
+                         const char* key, const char* expected) {
+    if (length == 0) {
+        return;  // Bị từ chối vì không đủ chỗ - hợp lệ
+    }
+    FUZZ_CHECK(length < capacity);
+    FUZZ_CHECK(output[length] == '\0');
+    
+    StaticJsonDocument<512> doc;
+    DeserializationError error = deserializeJson(doc, output, length);
+    FUZZ_CHECK(!error);
+    FUZZ_CHECK(strcmp(doc[key] | "", expected) == 0);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size > API_RESPONSE_MAX) {
+        size = API_RESPONSE_MAX;
+    }
+    
+    std::vector<char> buffer(data, data + size);
+    buffer.push_back('\0');
+    
+    StudentInfo student;
+    ApiCodec::parseStudentResponse(buffer.data(), size, student);
+    checkStudent(student);
+    
+    buffer.assign(data, data + size);
+    buffer.push_back('\0');
+    BookInfo book;
+    ApiCodec::parseBookResponse(buffer.data(), size, book);
+    checkBook(book);
+    
+    // Dùng input (tới '\0' đầu tiên) làm UID/barcode
+    std::vector<char> value(data, data + size);
+    value.push_back('\0');
+    
+    char output[API_PAYLOAD_MAX + 1];
+    ScanTrace trace = {};
+    strcpy(trace.id, "4bf92f3577b34da6a3ce929d0e0e4736");
+    trace.tapEpochMs = 1729300000123ULL;
+    size_t length = ApiCodec::createStudentPayload(value.data(), ScanSource{0, LANE_CHECKOUT}, DEVICE_ID, trace,
+                                                   output, sizeof(output));
+    checkPayload(length, output, sizeof(output), "card_uid", value.data());
+    
+    length = ApiCodec::createBookPayload(value.data(), DEVICE_ID, trace, output, sizeof(output));
+    checkPayload(length, output, sizeof(output), "barcode", value.data());
+    
+    // Response batch: phần tử tách ra phải nằm trong input và tự parse được
+    buffer.assign(data, data + size);
+    buffer.push_back('\0');
+    char* items[BATCH_MAX_ITEMS];
+    size_t lengths[BATCH_MAX_ITEMS];
+    int found = ApiCodec::splitBatchResults(buffer.data(), size, items, lengths, BATCH_MAX_ITEMS);
+    for (int i = 0; i < found && i < BATCH_MAX_ITEMS; i++) {
+        if (items[i] != nullptr) {
+            FUZZ_CHECK(items[i] >= buffer.data() && items[i] + lengths[i] <= buffer.data() + size);
+            ApiCodec::parseStudentResponse(items[i], lengths[i], student);
+            checkStudent(student);
+        }
+    }
+    
+    // Response heartbeat: tên tham số phải trỏ vào input, không quá CONFIG_MAX_ENTRIES
+    buffer.assign(data, data + size);
+    buffer.push_back('\0');
+    ConfigUpdate update;
+    if (ApiCodec::parseHeartbeatResponse(buffer.data(), size, update)) {
+        FUZZ_CHECK(update.count <= CONFIG_MAX_ENTRIES);
+        for (uint8_t i = 0; i < update.count; i++) {
+            const char* name = update.entries[i].name;
+            FUZZ_CHECK(name >= buffer.data() && name + strlen(name) <= buffer.data() + buffer.size());
+            FUZZ_CHECK(!update.entries[i].reset || update.entries[i].value == 0);
+        }
+    }
+    
+    // Header Server-Timing do backend gửi về cũng là dữ liệu không tin cậy
+    ApiCodec::parseServerTiming(value.data());
+    
+    return 0;
+}
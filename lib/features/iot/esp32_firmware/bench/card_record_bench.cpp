@@ -0,0 +1,131 @@
+// Chạy CardStore/CardRecord trên thẻ giả lập: kiểm tra ghi/đọc, phát hiện dữ liệu
+// bị sửa hoặc copy sang thẻ khác, và đo thời gian giải mã + xác thực chữ ký.
+//
+//   card_record_bench [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "config.h"
+#include "card_store.h"
+#include "emulated_picc.h"
+#include "emulated_rc522.h"
+
+// Khóa riêng của bench (khóa thật của trạm không nằm trong repo)
+#define BENCH_SIGNING_KEY "card-record-bench-key"
+
+static const uint8_t sectorKey[6] = CARD_SECTOR_KEY;
+static const uint8_t uidA[4] = {0x04, 0xA1, 0xB2, 0xC3};
+static const uint8_t uidB[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static StudentCardRecord sampleRecord() {
+    StudentCardRecord record = {};
+    strcpy(record.mssv, "2021001234");
+    strcpy(record.name, "Nguyễn Thị Minh Khai");
+    record.expiry = 20281231;
+    return record;
+}
+
+static void checkKind(PiccKind kind, const char* label) {
+    printf("%s\n", label);
+    StudentCardRecord record = sampleRecord();
+    StudentCardRecord read;
+    
+    EmulatedPicc blank(kind, uidA, sizeof(uidA));
+    expect(CardStore::readRecord(blank, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_EMPTY,
+           "blank card reads as EMPTY");
+    
+    EmulatedPicc card(kind, uidA, sizeof(uidA));
+    expect(CardStore::writeRecord(card, BENCH_SIGNING_KEY, sectorKey, record) == CARD_RECORD_OK,
+           "write + verify");
+    expect(CardStore::readRecord(card, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_OK &&
+           strcmp(read.mssv, record.mssv) == 0 && strcmp(read.name, record.name) == 0 &&
+           read.expiry == record.expiry,
+           "read back same MSSV/name/expiry");
+    expect(CardStore::readRecord(card, "wrong-key", sectorKey, read) == CARD_RECORD_BAD_SIGNATURE,
+           "other signing key rejected");
+    
+    // Sửa 1 byte trong tên
+    EmulatedPicc tampered = card;
+    uint8_t* raw = tampered.raw();
+    size_t offset = kind == PICC_KIND_MIFARE_CLASSIC ? (CARD_RECORD_SECTOR * 4 + 1) * 16 + 4
+                                                     : CARD_RECORD_NTAG_PAGE * 4 + 24;
+    raw[offset] ^= 0x01;
+    expect(CardStore::readRecord(tampered, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_BAD_SIGNATURE,
+           "tampered record rejected");
+    
+    // Copy nguyên bộ nhớ sang thẻ có UID khác
+    EmulatedPicc clone(kind, uidB, sizeof(uidB));
+    memcpy(clone.raw(), card.raw(), EmulatedPicc::CLASSIC_BLOCKS * 16);
+    expect(CardStore::readRecord(clone, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_BAD_SIGNATURE,
+           "record cloned to another UID rejected");
+    
+    if (kind == PICC_KIND_MIFARE_CLASSIC) {
+        EmulatedPicc locked(kind, uidA, sizeof(uidA));
+        const uint8_t otherKey[6] = {1, 2, 3, 4, 5, 6};
+        locked.setSectorKey(CARD_RECORD_SECTOR, otherKey);
+        expect(CardStore::readRecord(locked, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_IO_ERROR,
+               "wrong sector key -> IO_ERROR");
+    }
+    
+    expect(CardRecord::isExpired(record, 20290101) && !CardRecord::isExpired(record, 20250101) &&
+           !CardRecord::isExpired(record, 0),
+           "expiry check (unknown date = not expired)");
+}
+
+// Cùng bản ghi nhưng đi qua Rc522Driver và chip RC522 giả lập như trên trạm
+static void checkThroughDriver(PiccKind kind, const uint8_t* uid, uint8_t uidLength, const char* label) {
+    printf("%s\n", label);
+    EmulatedPicc card(kind, uid, uidLength);
+    EmulatedRc522 chip(&card);
+    Rc522Driver driver(chip);
+    
+    Rc522Poll poll;
+    while ((poll = driver.service()) == RC522_BUSY) {
+    }
+    expect(poll == RC522_CARD, "card selected by driver");
+    
+    StudentCardRecord record = sampleRecord();
+    StudentCardRecord read;
+    expect(CardStore::writeRecord(driver, BENCH_SIGNING_KEY, sectorKey, record) == CARD_RECORD_OK,
+           "write + verify");
+    expect(CardStore::readRecord(driver, BENCH_SIGNING_KEY, sectorKey, read) == CARD_RECORD_OK &&
+           strcmp(read.mssv, record.mssv) == 0,
+           "read back same MSSV");
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+    
+    checkKind(PICC_KIND_MIFARE_CLASSIC, "MIFARE Classic 1K");
+    checkKind(PICC_KIND_NTAG, "NTAG213");
+    checkThroughDriver(PICC_KIND_MIFARE_CLASSIC, uidA, sizeof(uidA), "MIFARE Classic 1K via Rc522Driver");
+    checkThroughDriver(PICC_KIND_NTAG, uidB, sizeof(uidB), "NTAG213 via Rc522Driver");
+    
+    // Thời gian đọc + xác thực trên thẻ giả lập (không tính thời gian RF)
+    EmulatedPicc card(PICC_KIND_MIFARE_CLASSIC, uidA, sizeof(uidA));
+    StudentCardRecord record = sampleRecord();
+    CardStore::writeRecord(card, BENCH_SIGNING_KEY, sectorKey, record);
+    
+    StudentCardRecord read;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        CardStore::readRecord(card, BENCH_SIGNING_KEY, sectorKey, read);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    printf("\nreadRecord (classic, HMAC verify): %.1f ns/op\n", ns);
+    
+    printf("%s (%d failure(s))\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
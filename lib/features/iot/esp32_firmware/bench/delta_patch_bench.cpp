@@ -0,0 +1,552 @@
+// Cập nhật firmware bằng bản vá (delta OTA) trên máy host: tạo bản vá kiểu bsdiff giữa hai
+// ảnh firmware, áp dụng bằng DeltaPatcher theo từng đoạn như khi tải qua WiFi (bộ nhớ cố
+// định), kiểm tra các trường hợp lỗi (sai ảnh nguồn, bản vá hỏng/thiếu), rồi so byte tải về
+// và thời gian cập nhật với OTA ảnh đầy đủ.
+//
+//   delta_patch_bench [old.bin new.bin] [--kbps N]
+//   delta_patch_bench --make old.bin new.bin patch.sdp
+//
+// Mặc định dùng fixtures/ota/station_v1.bin -> station_v2.bin (hai bản build host của
+// metrics_bench trước và sau một thay đổi nhỏ: thêm một endpoint, mọi địa chỉ phía sau dịch đi).
+// Với firmware thật: hai file .pio/build/esp32s3cam/firmware.bin của hai lần build.
+// --kbps: throughput tải về của trạm (lệnh "bench" in upload kbit/s), mặc định 2000.
+// --make: ghi bản vá để đặt lên server (API_FIRMWARE_PATCH).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "delta_patch.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static bool readFile(const std::string& path, Bytes& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    data.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+static bool writeFile(const std::string& path, const Bytes& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+// ============================================
+// Tạo bản vá (bsdiff: mảng hậu tố của ảnh cũ, ghép các đoạn gần khớp)
+// ============================================
+
+// Mảng hậu tố bằng nhân đôi tiền tố, O(n log^2 n): đủ nhanh cho ảnh vài MB
+static std::vector<int32_t> suffixArray(const Bytes& data) {
+    int32_t n = (int32_t)data.size();
+    std::vector<int32_t> sa(n);
+    std::vector<int32_t> rank(n);
+    std::vector<int32_t> next(n);
+    for (int32_t i = 0; i < n; i++) {
+        sa[i] = i;
+        rank[i] = data[i];
+    }
+    for (int32_t k = 1; n > 0; k <<= 1) {
+        auto key = [&](int32_t i) { return std::make_pair(rank[i], i + k < n ? rank[i + k] : -1); };
+        std::sort(sa.begin(), sa.end(), [&](int32_t a, int32_t b) { return key(a) < key(b); });
+        next[sa[0]] = 0;
+        for (int32_t i = 1; i < n; i++) {
+            next[sa[i]] = next[sa[i - 1]] + (key(sa[i - 1]) < key(sa[i]) ? 1 : 0);
+        }
+        rank.swap(next);
+        if (rank[sa[n - 1]] == n - 1) {
+            break;
+        }
+    }
+    return sa;
+}
+
+static int32_t matchLength(const uint8_t* a, int32_t aLength, const uint8_t* b, int32_t bLength) {
+    int32_t i = 0;
+    while (i < aLength && i < bLength && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Đoạn dài nhất của ảnh cũ khớp với phần đầu target (tìm nhị phân trên mảng hậu tố)
+static int32_t search(const std::vector<int32_t>& sa, const Bytes& old, const uint8_t* target, int32_t targetLength,
+                      int32_t start, int32_t end, int32_t& position) {
+    int32_t oldSize = (int32_t)old.size();
+    while (end - start >= 2) {
+        int32_t middle = start + (end - start) / 2;
+        int32_t length = std::min(oldSize - sa[middle], targetLength);
+        if (memcmp(old.data() + sa[middle], target, length) < 0) {
+            start = middle;
+        } else {
+            end = middle;
+        }
+    }
+    int32_t x = matchLength(old.data() + sa[start], oldSize - sa[start], target, targetLength);
+    int32_t y = matchLength(old.data() + sa[end], oldSize - sa[end], target, targetLength);
+    position = x > y ? sa[start] : sa[end];
+    return std::max(x, y);
+}
+
+static void putVarint(Bytes& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static void putLe32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+// diff ghi dạng chạy: (số byte 0, số byte còn lại, các byte đó). Lượt 0 ngắn hơn 3 byte nằm
+// luôn trong lượt literal vì hai varint tốn hơn chính các byte 0 đó
+static void putDiff(Bytes& out, const uint8_t* diff, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        size_t zeros = 0;
+        while (i + zeros < length && diff[i + zeros] == 0) {
+            zeros++;
+        }
+        putVarint(out, zeros);
+        i += zeros;
+        if (i == length) {
+            break;
+        }
+        size_t end = i;
+        while (end < length) {
+            if (diff[end] != 0) {
+                end++;
+                continue;
+            }
+            size_t run = 0;
+            while (end + run < length && diff[end + run] == 0) {
+                run++;
+            }
+            if (run >= 3 || end + run == length) {
+                break;
+            }
+            end += run;
+        }
+        putVarint(out, end - i);
+        out.insert(out.end(), diff + i, diff + end);
+        i = end;
+    }
+}
+
+static void sha256(const Bytes& data, uint8_t hash[DELTA_HASH_LEN]) {
+    mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), data.data(), data.size(), hash);
+}
+
+// LZSS như DeltaPatcher::inflate(): tìm đoạn lặp trong DELTA_LZ_WINDOW byte trước bằng chuỗi băm
+// 3 byte, lấy đoạn dài nhất
+static Bytes deflate(const Bytes& input) {
+    const size_t n = input.size();
+    const int maxChain = 256;
+    std::vector<int32_t> head(1 << 16, -1);
+    std::vector<int32_t> previous(n, -1);
+    auto hash = [&](size_t i) { return ((input[i] << 8) ^ (input[i + 1] << 4) ^ input[i + 2]) & 0xFFFF; };
+    auto insert = [&](size_t i) {
+        if (i + 2 < n) {
+            previous[i] = head[hash(i)];
+            head[hash(i)] = (int32_t)i;
+        }
+    };
+    
+    Bytes out;
+    size_t flagsAt = 0;
+    int bit = 8;
+    size_t i = 0;
+    while (i < n) {
+        if (bit == 8) {
+            flagsAt = out.size();
+            out.push_back(0);
+            bit = 0;
+        }
+        size_t best = 0;
+        size_t bestDistance = 0;
+        if (i + 2 < n) {
+            int chain = 0;
+            for (int32_t c = head[hash(i)]; c >= 0 && i - c <= DELTA_LZ_WINDOW && chain < maxChain;
+                 c = previous[c], chain++) {
+                size_t length = 0;
+                while (length < DELTA_LZ_MAX_MATCH && i + length < n && input[c + length] == input[i + length]) {
+                    length++;
+                }
+                if (length > best) {
+                    best = length;
+                    bestDistance = i - c;
+                }
+            }
+        }
+        if (best >= DELTA_LZ_MIN_MATCH) {
+            size_t code = bestDistance - 1;
+            out.push_back((uint8_t)code);
+            out.push_back((uint8_t)(((code >> 8) << 4) | (best - DELTA_LZ_MIN_MATCH)));
+            for (size_t k = 0; k < best; k++) {
+                insert(i + k);
+            }
+            i += best;
+        } else {
+            out[flagsAt] |= 1 << bit;
+            out.push_back(input[i]);
+            insert(i);
+            i++;
+        }
+        bit++;
+    }
+    return out;
+}
+
+static Bytes makePatch(const Bytes& old, const Bytes& target) {
+    Bytes patch(DELTA_MAGIC, DELTA_MAGIC + 4);
+    putLe32(patch, (uint32_t)old.size());
+    putLe32(patch, (uint32_t)target.size());
+    uint8_t hash[DELTA_HASH_LEN];
+    sha256(old, hash);
+    patch.insert(patch.end(), hash, hash + DELTA_HASH_LEN);
+    sha256(target, hash);
+    patch.insert(patch.end(), hash, hash + DELTA_HASH_LEN);
+    
+    int32_t oldSize = (int32_t)old.size();
+    int32_t newSize = (int32_t)target.size();
+    std::vector<int32_t> sa = suffixArray(old);
+    Bytes records;
+    Bytes diff;
+    
+    int32_t scan = 0;
+    int32_t length = 0;
+    int32_t position = 0;
+    int32_t lastScan = 0;
+    int32_t lastPos = 0;
+    int32_t lastOffset = 0;
+    while (scan < newSize) {
+        int32_t oldScore = 0;
+        int32_t scsc = scan += length;
+        for (; scan < newSize; scan++) {
+            length = oldSize > 0 ? search(sa, old, target.data() + scan, newSize - scan, 0, oldSize - 1, position) : 0;
+            for (; scsc < scan + length; scsc++) {
+                if (scsc + lastOffset < oldSize && old[scsc + lastOffset] == target[scsc]) {
+                    oldScore++;
+                }
+            }
+            if ((length == oldScore && length != 0) || length > oldScore + 8) {
+                break;
+            }
+            if (scan + lastOffset < oldSize && old[scan + lastOffset] == target[scan]) {
+                oldScore--;
+            }
+        }
+        if (length == oldScore && scan != newSize) {
+            continue;
+        }
+    
+        // Kéo dài đoạn khớp trước về phía sau (lenf) và đoạn khớp mới về phía trước (lenb)
+        int32_t score = 0;
+        int32_t bestForward = 0;
+        int32_t lengthForward = 0;
+        for (int32_t i = 0; lastScan + i < scan && lastPos + i < oldSize;) {
+            if (old[lastPos + i] == target[lastScan + i]) {
+                score++;
+            }
+            i++;
+            if (score * 2 - i > bestForward * 2 - lengthForward) {
+                bestForward = score;
+                lengthForward = i;
+            }
+        }
+        int32_t lengthBack = 0;
+        if (scan < newSize) {
+            score = 0;
+            int32_t bestBack = 0;
+            for (int32_t i = 1; scan >= lastScan + i && position >= i; i++) {
+                if (old[position - i] == target[scan - i]) {
+                    score++;
+                }
+                if (score * 2 - i > bestBack * 2 - lengthBack) {
+                    bestBack = score;
+                    lengthBack = i;
+                }
+            }
+        }
+        if (lastScan + lengthForward > scan - lengthBack) {
+            int32_t overlap = (lastScan + lengthForward) - (scan - lengthBack);
+            score = 0;
+            int32_t bestSplit = 0;
+            int32_t split = 0;
+            for (int32_t i = 0; i < overlap; i++) {
+                if (target[lastScan + lengthForward - overlap + i] == old[lastPos + lengthForward - overlap + i]) {
+                    score++;
+                }
+                if (target[scan - lengthBack + i] == old[position - lengthBack + i]) {
+                    score--;
+                }
+                if (score > bestSplit) {
+                    bestSplit = score;
+                    split = i + 1;
+                }
+            }
+            lengthForward += split - overlap;
+            lengthBack -= split;
+        }
+    
+        int32_t extra = (scan - lengthBack) - (lastScan + lengthForward);
+        int64_t seek = (int64_t)(position - lengthBack) - (lastPos + lengthForward);
+        putVarint(records, lengthForward);
+        putVarint(records, extra);
+        putVarint(records, ((uint64_t)seek << 1) ^ (uint64_t)(seek >> 63));
+        diff.resize(lengthForward);
+        for (int32_t i = 0; i < lengthForward; i++) {
+            diff[i] = target[lastScan + i] - old[lastPos + i];
+        }
+        putDiff(records, diff.data(), diff.size());
+        records.insert(records.end(), target.begin() + lastScan + lengthForward, target.begin() + scan - lengthBack);
+    
+        lastScan = scan - lengthBack;
+        lastPos = position - lengthBack;
+        lastOffset = position - scan;
+    }
+    Bytes body = deflate(records);
+    patch.insert(patch.end(), body.begin(), body.end());
+    return patch;
+}
+
+// ============================================
+// Áp dụng bản vá
+// ============================================
+
+class VectorSource : public DeltaSource {
+public:
+    explicit VectorSource(const Bytes& data) : data(data), reads(0) {}
+    
+    uint32_t size() override { return data.size(); }
+    bool read(uint32_t offset, uint8_t* buffer, size_t length) override {
+        if (offset + length > data.size()) {
+            return false;
+        }
+        memcpy(buffer, data.data() + offset, length);
+        reads++;
+        return true;
+    }
+    
+    const Bytes& data;
+    uint32_t reads;
+};
+
+// Ghi như phân vùng OTA: begin() trước mọi lần ghi, không ghi quá kích thước đã báo
+class VectorSink : public DeltaSink {
+public:
+    VectorSink() : begun(false), capacity(0) {}
+    
+    bool begin(uint32_t targetSize) override {
+        begun = true;
+        capacity = targetSize;
+        data.clear();
+        return true;
+    }
+    bool write(const uint8_t* chunk, size_t length) override {
+        if (!begun || data.size() + length > capacity) {
+            return false;
+        }
+        data.insert(data.end(), chunk, chunk + length);
+        return true;
+    }
+    
+    Bytes data;
+    bool begun;
+    uint32_t capacity;
+};
+
+// Đưa bản vá vào theo từng đoạn chunk byte (như khi đọc từ kết nối HTTP)
+static DeltaStatus apply(DeltaPatcher& patcher, const Bytes& source, const Bytes& patch, size_t chunk,
+                         VectorSink& sink) {
+    VectorSource input(source);
+    patcher.begin(input, sink);
+    DeltaStatus status = DELTA_RUNNING;
+    for (size_t offset = 0; offset < patch.size() && status == DELTA_RUNNING; offset += chunk) {
+        status = patcher.feed(patch.data() + offset, std::min(chunk, patch.size() - offset));
+    }
+    return status;
+}
+
+static void checkRoundTrip(const char* name, const Bytes& old, const Bytes& target) {
+    printf("%s\n", name);
+    static DeltaPatcher patcher;
+    Bytes patch = makePatch(old, target);
+    bool same = true;
+    for (size_t chunk : {(size_t)1, (size_t)7, (size_t)1460, patch.size()}) {
+        VectorSink sink;
+        same = same && apply(patcher, old, patch, chunk, sink) == DELTA_DONE && sink.data == target;
+    }
+    expect(same, "patched image matches (1, 7, 1460 B, whole)");
+    printf("  %-52s %zu / %zu B\n", "patch / image", patch.size(), target.size());
+}
+
+// Ảnh giả: vùng mã ngẫu nhiên + bảng con trỏ trỏ vào chính ảnh + padding
+static Bytes syntheticImage(std::mt19937& rng, size_t size) {
+    Bytes image(size);
+    for (size_t i = 0; i < size; i++) {
+        image[i] = i % 4096 < 3072 ? (uint8_t)rng() : (i % 4 == 3 ? 0x40 : (uint8_t)(i >> 8));
+    }
+    return image;
+}
+
+// Bản mới: chèn một hàm, xóa một đoạn, sửa vài hằng số, con trỏ phía sau dịch đi
+static Bytes editImage(const Bytes& image, std::mt19937& rng) {
+    Bytes edited(image.begin(), image.begin() + image.size() / 3);
+    for (int i = 0; i < 1500; i++) {
+        edited.push_back((uint8_t)rng());
+    }
+    edited.insert(edited.end(), image.begin() + image.size() / 3, image.begin() + image.size() / 2);
+    edited.insert(edited.end(), image.begin() + image.size() / 2 + 800, image.end());
+    for (size_t i = 3072; i < edited.size(); i += 4096) {
+        for (size_t j = 0; j < 1024 && i + j + 1 < edited.size(); j += 4) {
+            edited[i + j + 1] += 6;
+        }
+    }
+    for (int i = 0; i < 40; i++) {
+        edited[rng() % edited.size()] ^= 0x5A;
+    }
+    return edited;
+}
+
+static void checkErrors(const Bytes& old, const Bytes& target) {
+    printf("Errors\n");
+    static DeltaPatcher patcher;
+    Bytes patch = makePatch(old, target);
+    VectorSink sink;
+    
+    // Trạm đang chạy bản khác bản vá: không được xóa phân vùng đích
+    expect(apply(patcher, target, patch, 1460, sink) == DELTA_SOURCE_MISMATCH && !sink.begun,
+           "wrong source rejected before writing");
+    
+    Bytes bad = patch;
+    bad[0] = 'X';
+    expect(apply(patcher, old, bad, 1460, sink) == DELTA_BAD_HEADER, "bad magic rejected");
+    
+    bool rejected = true;
+    for (size_t offset = DELTA_HEADER_LEN; offset < patch.size(); offset += patch.size() / 16 + 1) {
+        bad = patch;
+        bad[offset] ^= 0x01;
+        VectorSink out;
+        rejected = rejected && apply(patcher, old, bad, 1460, out) != DELTA_DONE;
+    }
+    expect(rejected, "flipped bit in the body never reaches done");
+    
+    bad.assign(patch.begin(), patch.end() - 1);
+    expect(apply(patcher, old, bad, 1460, sink) == DELTA_RUNNING, "truncated patch stays incomplete");
+    
+    bad = patch;
+    bad.push_back(0);
+    expect(apply(patcher, old, bad, 1460, sink) == DELTA_CORRUPT, "trailing data rejected");
+}
+
+int main(int argc, char** argv) {
+    std::string oldPath = std::string(BENCH_FIXTURES_DIR) + "/ota/station_v1.bin";
+    std::string newPath = std::string(BENCH_FIXTURES_DIR) + "/ota/station_v2.bin";
+    double kbps = 2000;
+    bool make = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--kbps") == 0 && i + 1 < argc) {
+            kbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--make") == 0) {
+            make = true;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    
+    Bytes old;
+    Bytes target;
+    if (paths.size() >= 2) {
+        oldPath = paths[0];
+        newPath = paths[1];
+    }
+    if (!readFile(oldPath, old) || !readFile(newPath, target)) {
+        fprintf(stderr, "cannot read %s / %s\n", oldPath.c_str(), newPath.c_str());
+        return 2;
+    }
+    
+    if (make) {
+        if (paths.size() != 3) {
+            fprintf(stderr, "usage: delta_patch_bench --make old.bin new.bin patch.sdp\n");
+            return 2;
+        }
+        Bytes patch = makePatch(old, target);
+        if (!writeFile(paths[2], patch)) {
+            fprintf(stderr, "cannot write %s\n", paths[2].c_str());
+            return 2;
+        }
+        printf("%s: %zu bytes (%.1f%% of %zu)\n", paths[2].c_str(), patch.size(), 100.0 * patch.size() / target.size(),
+               target.size());
+        return 0;
+    }
+    
+    std::mt19937 rng(11);
+    Bytes synthetic = syntheticImage(rng, 512 * 1024);
+    checkRoundTrip("Fixture images", old, target);
+    checkRoundTrip("Same image", old, old);
+    checkRoundTrip("Synthetic 512 KB, code inserted/removed", synthetic, editImage(synthetic, rng));
+    checkRoundTrip("Unrelated images", target, synthetic);
+    checkErrors(old, target);
+    
+    // So với OTA ảnh đầy đủ: cùng ghi targetSize byte vào flash, khác ở byte tải về. Bản vá còn
+    // đọc lại ảnh nguồn (SHA-256 + byte cũ), trên trạm là đọc flash, nhanh hơn WiFi nhiều lần
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    Bytes patch = makePatch(old, target);
+    double makeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    
+    static DeltaPatcher patcher;
+    const int rounds = 20;
+    VectorSink sink;
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        apply(patcher, old, patch, 1460, sink);
+    }
+    double applyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / rounds;
+    
+    double fullMs = target.size() * 8.0 / kbps;
+    double deltaMs = patch.size() * 8.0 / kbps;
+    printf("\n%-28s %12s %12s\n", "", "full image", "delta");
+    printf("%-28s %12zu %12zu\n", "download bytes", target.size(), patch.size());
+    printf("%-28s %12s %11.1f%%\n", "download saved", "", 100.0 - 100.0 * patch.size() / target.size());
+    printf("%-28s %9.1f ms %9.1f ms\n", "download time", fullMs, deltaMs);
+    printf("%-28s %12s %9.2f ms\n", "apply (host CPU)", "-", applyMs);
+    printf("%-28s %12u %12u\n", "bytes copied from source", 0u, patcher.getCopiedBytes());
+    printf("%-28s %12s %9zu B\n", "patcher RAM", "-", sizeof(DeltaPatcher));
+    printf("%-28s %12s %9.1f ms\n", "make patch (host)", "", makeMs);
+    printf("(download at %.0f kbit/s; both write %zu bytes to the OTA slot)\n", kbps, target.size());
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
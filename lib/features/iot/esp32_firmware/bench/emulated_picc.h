@@ -0,0 +1,106 @@
+// Thẻ giả lập cho máy host: MIFARE Classic 1K (có xác thực Key A theo sector)
+// và NTAG213 (trang 4 byte), dùng thay MFRC522 khi chạy CardStore ngoài thiết bị.
+#ifndef EMULATED_PICC_H
+#define EMULATED_PICC_H
+
+#include <cstring>
+#include "card_store.h"
+
+class EmulatedPicc : public PiccTransport {
+public:
+    static const int CLASSIC_BLOCKS = 64;   // 1K = 16 sector x 4 block
+    static const int NTAG_PAGES = 45;       // NTAG213
+    static const int NTAG_FIRST_USER_PAGE = 4;
+    static const int NTAG_LAST_USER_PAGE = 39;
+    
+    EmulatedPicc(PiccKind kind, const uint8_t* uid, uint8_t uidLength)
+        : piccKind(kind), uidLength(uidLength), authSector(-1), ioCount(0) {
+        memcpy(uidBytes, uid, uidLength);
+        memset(memory, 0, sizeof(memory));
+        if (kind == PICC_KIND_MIFARE_CLASSIC) {
+            // Sector trailer mặc định: Key A = Key B = FF..FF
+            for (int sector = 0; sector < CLASSIC_BLOCKS / 4; sector++) {
+                uint8_t* trailer = memory + (sector * 4 + 3) * 16;
+                memset(trailer, 0xFF, 6);
+                memset(trailer + 10, 0xFF, 6);
+            }
+        }
+    }
+    
+    // Đổi Key A của một sector (giả lập thẻ đã được khóa)
+    void setSectorKey(int sector, const uint8_t key[6]) {
+        memcpy(memory + (sector * 4 + 3) * 16, key, 6);
+    }
+    
+    uint8_t* raw() { return memory; }
+    int getIoCount() const { return ioCount; }
+    
+    PiccKind kind() override { return piccKind; }
+    
+    const uint8_t* uid(uint8_t& length) override {
+        length = uidLength;
+        return uidBytes;
+    }
+    
+    bool authenticate(uint8_t block, const uint8_t key[6]) override {
+        ioCount++;
+        if (piccKind != PICC_KIND_MIFARE_CLASSIC || block >= CLASSIC_BLOCKS) {
+            return false;
+        }
+        int sector = block / 4;
+        if (memcmp(memory + (sector * 4 + 3) * 16, key, 6) != 0) {
+            authSector = -1;
+            return false;
+        }
+        authSector = sector;
+        return true;
+    }
+    
+    bool read16(uint8_t block, uint8_t output[16]) override {
+        ioCount++;
+        if (piccKind == PICC_KIND_MIFARE_CLASSIC) {
+            if (block >= CLASSIC_BLOCKS || block / 4 != authSector) {
+                return false;
+            }
+            memcpy(output, memory + block * 16, 16);
+            return true;
+        }
+        // NTAG READ: 4 trang, quay vòng về trang 0 khi vượt cuối
+        if (block >= NTAG_PAGES) {
+            return false;
+        }
+        for (int i = 0; i < 4; i++) {
+            memcpy(output + i * 4, memory + ((block + i) % NTAG_PAGES) * 4, 4);
+        }
+        return true;
+    }
+    
+    bool writeBlock(uint8_t block, const uint8_t data[16]) override {
+        ioCount++;
+        if (piccKind != PICC_KIND_MIFARE_CLASSIC || block >= CLASSIC_BLOCKS ||
+            block / 4 != authSector || block == 0 || block % 4 == 3) {
+            return false;  // Block 0 (manufacturer) và trailer không ghi
+        }
+        memcpy(memory + block * 16, data, 16);
+        return true;
+    }
+    
+    bool writePage(uint8_t page, const uint8_t data[4]) override {
+        ioCount++;
+        if (piccKind != PICC_KIND_NTAG || page < NTAG_FIRST_USER_PAGE || page > NTAG_LAST_USER_PAGE) {
+            return false;
+        }
+        memcpy(memory + page * 4, data, 4);
+        return true;
+    }
+
+private:
+    PiccKind piccKind;
+    uint8_t uidBytes[10];
+    uint8_t uidLength;
+    int authSector;
+    int ioCount;
+    uint8_t memory[CLASSIC_BLOCKS * 16];
+};
+
+#endif // EMULATED_PICC_H
@@ -0,0 +1,404 @@
+// Chip RC522 giả lập ở mức thanh ghi cho máy host: nhận frame SPI như chip thật
+// (thanh ghi, FIFO, lệnh Transceive/MFAuthent/CalcCRC) và trả lời bằng một thẻ
+// ISO 14443-A giả lập (bench/emulated_picc.h). Lệnh hoàn tất ngay lập tức, không
+// mô phỏng thời gian truyền RF; không mô phỏng mã hóa Crypto1.
+// Nhiều thẻ trong trường (addCard) trả lời chồng lên nhau: bit khác nhau đầu tiên
+// báo va chạm qua ErrorReg/CollReg như chip thật (ValuesAfterColl = 0).
+#ifndef EMULATED_RC522_H
+#define EMULATED_RC522_H
+
+#include <cstring>
+#include "rc522_bus.h"
+#include "rc522_driver.h"
+#include "emulated_picc.h"
+
+class EmulatedRc522 : public Rc522Bus {
+public:
+    static const uint8_t VERSION = 0x92;    // MFRC522 v2.0
+    static const uint8_t MAX_CARDS = 32;
+    
+    explicit EmulatedRc522(EmulatedPicc* card = nullptr) {
+        reset();
+        setCard(card);
+    }
+    
+    // Đặt thẻ lên / nhấc thẻ khỏi đầu đọc (nullptr = không có thẻ)
+    void setCard(EmulatedPicc* newCard) {
+        cardCount = 0;
+        pendingWriteBlock = -1;
+        if (newCard != nullptr) {
+            addCard(newCard);
+        }
+    }
+    
+    // Thêm một thẻ vào trường (kiểm kê: nhiều nhãn sách cùng lúc)
+    bool addCard(EmulatedPicc* newCard) {
+        if (cardCount >= MAX_CARDS) {
+            return false;
+        }
+        cards[cardCount] = newCard;
+        states[cardCount++] = CARD_IDLE;
+        return true;
+    }
+    
+    bool submit(const Rc522Frame* frames, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++) {
+            exchange(frames[i]);
+        }
+        return true;
+    }
+    
+    bool done() override { return true; }
+    
+private:
+    enum : uint8_t {
+        REG_COMMAND = 0x01, REG_COM_IRQ = 0x04, REG_DIV_IRQ = 0x05, REG_ERROR = 0x06,
+        REG_STATUS2 = 0x08, REG_FIFO_DATA = 0x09, REG_FIFO_LEVEL = 0x0A, REG_CONTROL = 0x0C,
+        REG_BIT_FRAMING = 0x0D, REG_COLL = 0x0E, REG_CRC_RESULT_H = 0x21, REG_CRC_RESULT_L = 0x22, REG_VERSION = 0x37
+    };
+    enum CardState { CARD_IDLE, CARD_READY, CARD_ACTIVE, CARD_HALT };
+    
+    void reset() {
+        memset(regs, 0, sizeof(regs));
+        regs[REG_COMMAND] = 0x20;
+        fifoLength = 0;
+    }
+    
+    void exchange(const Rc522Frame& frame) {
+        uint8_t scratch[96];
+        uint8_t* rx = frame.rx != nullptr ? frame.rx : scratch;
+        rx[0] = 0x00;
+    
+        if (frame.tx[0] & 0x80) {
+            // Đọc: byte địa chỉ thứ i trả về giá trị ở byte i + 1
+            for (uint8_t i = 1; i < frame.length; i++) {
+                rx[i] = readRegister((frame.tx[i - 1] >> 1) & 0x3F);
+            }
+            return;
+        }
+    
+        uint8_t reg = (frame.tx[0] >> 1) & 0x3F;
+        for (uint8_t i = 1; i < frame.length; i++) {
+            rx[i] = 0x00;
+            writeRegister(reg, frame.tx[i]);
+        }
+    }
+    
+    uint8_t readRegister(uint8_t reg) {
+        switch (reg) {
+            case REG_FIFO_DATA: {
+                if (fifoLength == 0) {
+                    return 0x00;
+                }
+                uint8_t value = fifo[0];
+                memmove(fifo, fifo + 1, --fifoLength);
+                return value;
+            }
+            case REG_FIFO_LEVEL:
+                return fifoLength;
+            case REG_VERSION:
+                return VERSION;
+            default:
+                return regs[reg];
+        }
+    }
+    
+    void writeRegister(uint8_t reg, uint8_t value) {
+        switch (reg) {
+            case REG_COMMAND:
+                regs[REG_COMMAND] = value & 0x0F;
+                execute(value & 0x0F);
+                break;
+            case REG_COM_IRQ:
+            case REG_DIV_IRQ:
+                // Bit 7 = Set1: 1 → đặt các bit được đánh dấu, 0 → xóa
+                if (value & 0x80) {
+                    regs[reg] |= value & 0x7F;
+                } else {
+                    regs[reg] &= ~value;
+                }
+                break;
+            case REG_FIFO_LEVEL:
+                if (value & 0x80) {
+                    fifoLength = 0;
+                }
+                break;
+            case REG_FIFO_DATA:
+                if (fifoLength < sizeof(fifo)) {
+                    fifo[fifoLength++] = value;
+                }
+                break;
+            case REG_BIT_FRAMING:
+                regs[reg] = value & 0x7F;
+                if ((value & 0x80) && regs[REG_COMMAND] == 0x0C) {
+                    transmit(value & 0x07);
+                }
+                break;
+            default:
+                regs[reg] = value;
+                break;
+        }
+    }
+    
+    void execute(uint8_t command) {
+        switch (command) {
+            case 0x03: {                                  // CalcCRC
+                uint8_t crc[2];
+                Rc522Driver::crcA(fifo, fifoLength, crc);
+                fifoLength = 0;
+                regs[REG_CRC_RESULT_L] = crc[0];
+                regs[REG_CRC_RESULT_H] = crc[1];
+                regs[REG_DIV_IRQ] |= 0x04;
+                break;
+            }
+            case 0x0E: {                                  // MFAuthent
+                int active = activeSlot();
+                bool ok = fifoLength == 12 && active >= 0 && cards[active]->authenticate(fifo[1], fifo + 2);
+                fifoLength = 0;
+                regs[REG_COMMAND] = 0x00;
+                if (ok) {
+                    regs[REG_STATUS2] |= 0x08;
+                    regs[REG_COM_IRQ] |= 0x10;
+                } else {
+                    regs[REG_COM_IRQ] |= 0x01;            // Thẻ không trả lời → timer
+                }
+                break;
+            }
+            case 0x0F:                                    // SoftReset
+                reset();
+                regs[REG_COMMAND] = 0x00;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    void transmit(uint8_t txLastBits) {
+        uint8_t frame[64];
+        uint8_t length = fifoLength;
+        memcpy(frame, fifo, length);
+        fifoLength = 0;
+    
+        uint8_t responseLength = 0;
+        uint8_t responseBits = 0;
+        uint8_t collisionBit = 0xFF;
+        if (respond(frame, length, txLastBits, fifo, responseLength, responseBits, collisionBit)) {
+            fifoLength = responseLength;
+            regs[REG_CONTROL] = responseBits;
+            regs[REG_ERROR] = 0x00;
+            if (collisionBit != 0xFF) {
+                // CollPos tính từ bit đầu của byte FIFO đầu tiên, 32 → 0, sau bit 32 = không hợp lệ
+                uint8_t position = collisionBit + 1;
+                regs[REG_ERROR] = 0x08;                   // CollErr
+                regs[REG_COLL] = (regs[REG_COLL] & 0x80) | (position > 32 ? 0x20 : (position & 0x1F));
+            }
+            regs[REG_COM_IRQ] |= 0x20;                    // RxIRq
+        } else {
+            regs[REG_COM_IRQ] |= 0x01;                    // TimerIRq
+        }
+    }
+    
+    static bool crcOk(const uint8_t* data, uint8_t length) {
+        if (length < 3) {
+            return false;
+        }
+        uint8_t crc[2];
+        Rc522Driver::crcA(data, length - 2, crc);
+        return crc[0] == data[length - 2] && crc[1] == data[length - 1];
+    }
+    
+    static uint8_t appendCrc(uint8_t* data, uint8_t length) {
+        Rc522Driver::crcA(data, length, data + length);
+        return length + 2;
+    }
+    
+    int activeSlot() const {
+        for (uint8_t i = 0; i < cardCount; i++) {
+            if (states[i] == CARD_ACTIVE) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    
+    // 4 byte của mức cascade (UID 7 byte: mức 1 = CT 0x88 + 3 byte đầu)
+    static bool levelBytes(EmulatedPicc* card, uint8_t level, uint8_t output[4]) {
+        uint8_t length;
+        const uint8_t* uid = card->uid(length);
+        if (length == 4 && level == 0) {
+            memcpy(output, uid, 4);
+            return true;
+        }
+        if (length == 7 && level == 0) {
+            output[0] = 0x88;
+            memcpy(output + 1, uid, 3);
+            return true;
+        }
+        if (length == 7 && level == 1) {
+            memcpy(output, uid + 3, 4);
+            return true;
+        }
+        return false;
+    }
+    
+    bool ack(uint8_t* output, uint8_t& length, uint8_t& bits, bool ok) {
+        output[0] = ok ? 0x0A : 0x04;
+        length = 1;
+        bits = 4;
+        return true;
+    }
+    
+    // Các thẻ cùng trả lời: byte giống nhau giữ nguyên, từ bit khác nhau đầu tiên (tính cả
+    // bit RxAlign không dùng của byte đầu) trở đi là 0 và collisionBit ghi vị trí đó
+    bool respond(const uint8_t* in, uint8_t length, uint8_t txLastBits,
+                 uint8_t* output, uint8_t& outputLength, uint8_t& outputBits, uint8_t& collisionBit) {
+        bool any = false;
+        uint8_t firstBit = 0;
+        for (uint8_t slot = 0; slot < cardCount; slot++) {
+            uint8_t reply[32];
+            uint8_t replyLength = 0;
+            uint8_t replyBits = 0;
+            if (!respondCard(slot, in, length, txLastBits, reply, replyLength, replyBits, firstBit)) {
+                continue;
+            }
+            if (!any) {
+                memcpy(output, reply, replyLength);
+                outputLength = replyLength;
+                outputBits = replyBits;
+                any = true;
+                continue;
+            }
+            uint8_t common = replyLength < outputLength ? replyLength : outputLength;
+            for (uint8_t bit = firstBit; bit < common * 8 && bit < collisionBit; bit++) {
+                if (((output[bit / 8] ^ reply[bit / 8]) >> (bit % 8)) & 1) {
+                    collisionBit = bit;
+                    break;
+                }
+            }
+        }
+        if (any && collisionBit != 0xFF) {
+            output[collisionBit / 8] &= (1 << (collisionBit % 8)) - 1;
+            memset(output + collisionBit / 8 + 1, 0, outputLength - collisionBit / 8 - 1);
+        }
+        return any;
+    }
+    
+    // Lớp ISO 14443-3 / MIFARE của một thẻ. firstBit: bit đầu thẻ thực sự gửi trong byte đầu
+    bool respondCard(uint8_t slot, const uint8_t* in, uint8_t length, uint8_t txLastBits,
+                     uint8_t* output, uint8_t& outputLength, uint8_t& outputBits, uint8_t& firstBit) {
+        EmulatedPicc* card = cards[slot];
+        CardState& cardState = states[slot];
+        outputBits = 0;
+    
+        // REQA / WUPA (frame ngắn 7 bit)
+        if (txLastBits == 7 && length == 1 && (in[0] == 0x26 || in[0] == 0x52)) {
+            bool wake = cardState == CARD_IDLE || (cardState == CARD_HALT && in[0] == 0x52);
+            if (!wake) {
+                // Thẻ đang ACTIVE nhận lệnh không hợp lệ → về IDLE, không trả lời
+                if (cardState != CARD_HALT) {
+                    cardState = CARD_IDLE;
+                }
+                return false;
+            }
+            uint8_t uidLength;
+            card->uid(uidLength);
+            cardState = CARD_READY;
+            output[0] = uidLength == 4 ? 0x04 : 0x44;
+            output[1] = 0x00;
+            outputLength = 2;
+            return true;
+        }
+    
+        bool select = length >= 2 && (in[0] == 0x93 || in[0] == 0x95 || in[0] == 0x97);
+        if (cardState == CARD_READY && select) {
+            uint8_t level = (in[0] - 0x93) / 2;
+            uint8_t bytes[5];
+            if (!levelBytes(card, level, bytes)) {
+                return false;
+            }
+            bytes[4] = bytes[0] ^ bytes[1] ^ bytes[2] ^ bytes[3];
+    
+            // ANTICOLLISION: NVB = số byte đã gửi (gồm SEL, NVB) << 4 | số bit lẻ.
+            // Thẻ khớp các bit đã biết gửi phần còn lại của 4 byte + BCC
+            if (in[1] != 0x70) {
+                uint8_t known = ((in[1] >> 4) - 2) * 8 + (in[1] & 0x07);
+                if (known >= 32 || length != 2 + (known + 7) / 8) {
+                    cardState = CARD_IDLE;
+                    return false;
+                }
+                for (uint8_t bit = 0; bit < known; bit++) {
+                    if (((in[2 + bit / 8] ^ bytes[bit / 8]) >> (bit % 8)) & 1) {
+                        return false;             // Không khớp: im lặng, vẫn READY
+                    }
+                }
+                firstBit = known % 8;
+                outputLength = 5 - known / 8;
+                memcpy(output, bytes + known / 8, outputLength);
+                output[0] &= ~((1 << firstBit) - 1);
+                return true;
+            }
+    
+            // SELECT: SAK + CRC
+            if (length == 9 && crcOk(in, 9) && memcmp(in + 2, bytes, 4) == 0) {
+                uint8_t probe[4];
+                bool more = levelBytes(card, level + 1, probe);
+                output[0] = more ? 0x04 : (card->kind() == PICC_KIND_MIFARE_CLASSIC ? 0x08 : 0x00);
+                outputLength = appendCrc(output, 1);
+                if (!more) {
+                    cardState = CARD_ACTIVE;
+                }
+                return true;
+            }
+            cardState = CARD_IDLE;
+            return false;
+        }
+    
+        if (cardState != CARD_ACTIVE) {
+            return false;
+        }
+    
+        // Khối dữ liệu thứ hai của lệnh WRITE (MIFARE Classic)
+        if (pendingWriteBlock >= 0) {
+            int block = pendingWriteBlock;
+            pendingWriteBlock = -1;
+            return ack(output, outputLength, outputBits,
+                       length == 18 && crcOk(in, 18) && card->writeBlock(block, in));
+        }
+    
+        if (!crcOk(in, length)) {
+            cardState = CARD_IDLE;
+            return false;
+        }
+    
+        switch (in[0]) {
+            case 0x50:                                    // HLTA
+                cardState = CARD_HALT;
+                regs[REG_STATUS2] &= ~0x08;
+                return false;
+            case 0x30:                                    // READ
+                if (!card->read16(in[1], output)) {
+                    return ack(output, outputLength, outputBits, false);
+                }
+                outputLength = appendCrc(output, 16);
+                return true;
+            case 0xA0:                                    // WRITE (bước 1)
+                pendingWriteBlock = in[1];
+                return ack(output, outputLength, outputBits, true);
+            case 0xA2:                                    // Ultralight WRITE
+                return ack(output, outputLength, outputBits, length == 8 && card->writePage(in[1], in + 2));
+            default:
+                cardState = CARD_IDLE;
+                return false;
+        }
+    }
+    
+    EmulatedPicc* cards[MAX_CARDS];
+    CardState states[MAX_CARDS];
+    uint8_t cardCount;
+    int pendingWriteBlock;
+    uint8_t regs[64];
+    uint8_t fifo[64];
+    uint8_t fifoLength;
+};
+
+#endif // EMULATED_RC522_H
@@ -0,0 +1,174 @@
+// Giao thức WebSocket của EventStream trên máy host: kiểm tra handshake (vector
+// của RFC 6455), header frame, đọc frame có mask, buffer gửi có giới hạn; rồi đo
+// thời gian đẩy một sự kiện tới EVENT_STREAM_MAX_CLIENTS client và số sự kiện một
+// client đọc chậm nhận được trước khi bị ngắt.
+//
+//   event_stream_bench [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "config.h"
+#include "ws_protocol.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// Frame client → server có mask (như app gửi lên)
+static size_t maskedFrame(WsOpcode opcode, const char* payload, size_t length, uint8_t* output) {
+    const uint8_t mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+    size_t pos = 0;
+    output[pos++] = 0x80 | opcode;
+    if (length < 126) {
+        output[pos++] = 0x80 | (uint8_t)length;
+    } else {
+        output[pos++] = 0x80 | 126;
+        output[pos++] = (uint8_t)(length >> 8);
+        output[pos++] = (uint8_t)length;
+    }
+    memcpy(output + pos, mask, 4);
+    pos += 4;
+    for (size_t i = 0; i < length; i++) {
+        output[pos++] = payload[i] ^ mask[i & 3];
+    }
+    return pos;
+}
+
+static void checkHandshake() {
+    printf("Handshake\n");
+    const char* request =
+        "GET /events HTTP/1.1\r\n"
+        "Host: 192.168.1.50:81\r\n"
+        "upgrade: WebSocket\r\n"
+        "Connection: keep-alive, Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    char key[WS_ACCEPT_KEY_LEN];
+    expect(WsProtocol::parseUpgrade(request, key) && strcmp(key, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == 0,
+           "RFC 6455 sample key -> s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    
+    char response[160];
+    size_t length = WsProtocol::buildHandshakeResponse(key, response, sizeof(response));
+    expect(length > 0 && strstr(response, "101 Switching Protocols") != nullptr &&
+           strcmp(response + length - 4, "\r\n\r\n") == 0, "101 response");
+    expect(WsProtocol::buildHandshakeResponse(key, response, 40) == 0, "response rejected when buffer small");
+    
+    expect(!WsProtocol::parseUpgrade("GET / HTTP/1.1\r\nHost: x\r\n\r\n", key), "plain HTTP GET rejected");
+    expect(!WsProtocol::parseUpgrade(
+               "POST / HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+               "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", key),
+           "non-GET rejected");
+    expect(!WsProtocol::parseUpgrade(
+               "GET / HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+               "Sec-WebSocket-Key: short\r\nSec-WebSocket-Version: 13\r\n\r\n", key),
+           "malformed key rejected");
+    expect(!WsProtocol::parseUpgrade(
+               "GET / HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+               "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 8\r\n\r\n", key),
+           "old protocol version rejected");
+}
+
+static void checkFrames() {
+    printf("Frames\n");
+    uint8_t header[WS_MAX_FRAME_HEADER];
+    expect(WsProtocol::frameHeader(WS_OPCODE_TEXT, 5, header) == 2 && header[0] == 0x81 && header[1] == 5,
+           "short text header");
+    expect(WsProtocol::frameHeader(WS_OPCODE_TEXT, 700, header) == 4 && header[1] == 126 &&
+           header[2] == 0x02 && header[3] == 0xBC, "16-bit length header");
+    expect(WsProtocol::frameHeader(WS_OPCODE_BINARY, 70000, header) == 10 && header[1] == 127 &&
+           header[7] == 0x01 && header[8] == 0x11 && header[9] == 0x70, "64-bit length header");
+    
+    uint8_t data[256];
+    size_t length = maskedFrame(WS_OPCODE_PING, "hi", 2, data);
+    length += maskedFrame(WS_OPCODE_CLOSE, "\x03\xE8", 2, data + length);
+    WsFrame frame;
+    int used = WsProtocol::parseClientFrame(data, length, frame);
+    expect(used == 8 && frame.opcode == WS_OPCODE_PING && frame.length == 2 && memcmp(frame.payload, "hi", 2) == 0,
+           "masked ping unmasked in place");
+    used = WsProtocol::parseClientFrame(data + used, length - used, frame);
+    expect(used == 8 && frame.opcode == WS_OPCODE_CLOSE && frame.payload[0] == 0x03, "close frame follows");
+    
+    length = maskedFrame(WS_OPCODE_TEXT, "partial", 7, data);
+    expect(WsProtocol::parseClientFrame(data, length - 1, frame) == 0, "incomplete frame -> need more");
+    data[1] &= 0x7F;
+    expect(WsProtocol::parseClientFrame(data, length, frame) == -1, "unmasked client frame rejected");
+    
+    std::string big(200, 'x');
+    length = maskedFrame(WS_OPCODE_PING, big.data(), big.size(), data);
+    expect(WsProtocol::parseClientFrame(data, length, frame) == -1, "control frame > 125 bytes rejected");
+}
+
+static void checkOutbox() {
+    printf("Outbox\n");
+    WsOutbox<16> outbox;
+    const uint8_t bytes[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    expect(outbox.push(bytes, 12) && !outbox.push(bytes, 5) && outbox.size() == 12,
+           "push is all-or-nothing");
+    outbox.consume(10);
+    expect(outbox.push(bytes, 12) && outbox.size() == 14, "wraps around");
+    const uint8_t* data;
+    size_t first = outbox.peek(data);
+    bool ok = first == 6 && data[0] == 11 && data[1] == 12 && data[2] == 1;
+    outbox.consume(first);
+    size_t second = outbox.peek(data);
+    ok = ok && second == 8 && data[0] == 5 && data[7] == 12;
+    outbox.consume(second);
+    expect(ok && outbox.size() == 0, "peek returns contiguous pieces in order");
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    
+    checkHandshake();
+    checkFrames();
+    checkOutbox();
+    
+    // Sự kiện quét sinh viên cỡ thật (createStudentEvent)
+    const char* event =
+        "{\"device_id\":\"" DEVICE_ID "\",\"scan_type\":\"student_card\",\"scan_data\":\"04A1B2C3\","
+        "\"success\":true,\"reader\":0,\"lane\":\"checkout\",\"data\":{\"mssv\":\"20210001\","
+        "\"name\":\"Nguyễn Thị Thanh Hương\",\"class\":\"CNTT-K66\",\"phone\":\"0912345678\","
+        "\"email\":\"huong.ntt@example.edu.vn\",\"active_loans\":3}}";
+    size_t eventLength = strlen(event);
+    
+    // Mỗi lần đẩy: header + payload vào buffer của từng client; client đọc ngay
+    static WsOutbox<EVENT_STREAM_CLIENT_BUFFER> outboxes[EVENT_STREAM_MAX_CLIENTS];
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        uint8_t header[WS_MAX_FRAME_HEADER];
+        size_t headerLength = WsProtocol::frameHeader(WS_OPCODE_TEXT, eventLength, header);
+        for (auto& outbox : outboxes) {
+            outbox.push(header, headerLength);
+            outbox.push((const uint8_t*)event, eventLength);
+            const uint8_t* data;
+            outbox.consume(outbox.peek(data));
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    printf("\nEvent %zu bytes, fan-out to %d clients: %.0f host ns/event\n", eventLength,
+           EVENT_STREAM_MAX_CLIENTS, std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+    
+    // Client không đọc: số sự kiện giữ được trước khi bị ngắt
+    WsOutbox<EVENT_STREAM_CLIENT_BUFFER> stalled;
+    size_t buffered = 0;
+    uint8_t header[WS_MAX_FRAME_HEADER];
+    size_t headerLength = WsProtocol::frameHeader(WS_OPCODE_TEXT, eventLength, header);
+    while (stalled.space() >= headerLength + eventLength) {
+        stalled.push(header, headerLength);
+        stalled.push((const uint8_t*)event, eventLength);
+        buffered++;
+    }
+    printf("Stalled client is dropped after %zu buffered events (%d B buffer, %d B RAM per slot)\n",
+           buffered, EVENT_STREAM_CLIENT_BUFFER, (int)sizeof(stalled));
+    
+    printf("\n%s (%d failure(s))\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
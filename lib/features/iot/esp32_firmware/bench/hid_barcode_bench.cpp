@@ -0,0 +1,212 @@
+// Máy quét barcode USB trên máy host: dòng input report HID boot keyboard giả lập
+// (nhấn/nhả từng phím như máy quét thật) đi qua HidKeyboardDecoder. Kiểm tra ghép mã,
+// Shift, phím lặp, rollover, thời gian chờ giữa hai ký tự, rồi đo ns mỗi report và
+// độ trễ từ phím đầu tiên tới khi có mã ở các nhịp gửi report khác nhau.
+//
+//   hid_barcode_bench [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "hid_keyboard_decoder.h"
+
+#define USAGE_ENTER 0x28
+#define USAGE_KEYPAD_ENTER 0x58
+#define MODIFIER_LEFT_SHIFT 0x02
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+struct Report {
+    uint8_t data[8];
+    uint32_t atMs;
+};
+
+struct Received {
+    std::vector<std::string> barcodes;
+    std::vector<uint32_t> times;
+    uint32_t now = 0;
+};
+
+static void collect(const char* barcode, uint8_t length, void* context) {
+    Received* received = static_cast<Received*>(context);
+    received->barcodes.push_back(std::string(barcode, length));
+    received->times.push_back(received->now);
+}
+
+// Usage ID + Shift để gõ ra ký tự c (hàng phím chính trước bàn phím số)
+static bool lookup(char c, uint8_t& usage, bool& shift) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int u = 0x04; u <= 0x63; u++) {
+            if (HidKeyboardDecoder::usageToChar(u, pass == 1) == c) {
+                usage = u;
+                shift = pass == 1;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Máy quét gõ text: mỗi ký tự = report nhấn + report nhả, cách nhau intervalMs
+static void type(std::vector<Report>& out, const std::string& text, uint32_t& atMs, uint32_t intervalMs,
+                 uint8_t terminator = USAGE_ENTER) {
+    for (char c : text) {
+        uint8_t usage;
+        bool shift;
+        if (!lookup(c, usage, shift)) {
+            continue;
+        }
+        out.push_back({{(uint8_t)(shift ? MODIFIER_LEFT_SHIFT : 0), 0, usage, 0, 0, 0, 0, 0}, atMs});
+        atMs += intervalMs;
+        out.push_back({{0}, atMs});
+        atMs += intervalMs;
+    }
+    if (terminator != 0) {
+        out.push_back({{0, 0, terminator, 0, 0, 0, 0, 0}, atMs});
+        atMs += intervalMs;
+        out.push_back({{0}, atMs});
+        atMs += intervalMs;
+    }
+}
+
+// Chạy dòng report, gọi tick() mỗi 1 ms như task USB, thêm tailMs sau report cuối
+static Received replay(const std::vector<Report>& reports, uint32_t tailMs = 200) {
+    Received received;
+    HidKeyboardDecoder decoder(collect, &received);
+    size_t next = 0;
+    uint32_t end = (reports.empty() ? 0 : reports.back().atMs) + tailMs;
+    for (uint32_t now = 0; now <= end; now++) {
+        received.now = now;
+        while (next < reports.size() && reports[next].atMs <= now) {
+            decoder.feed(reports[next].data, 8, now);
+            next++;
+        }
+        decoder.tick(now);
+    }
+    return received;
+}
+
+static void checkDecoder() {
+    printf("HidKeyboardDecoder\n");
+    std::vector<Report> reports;
+    uint32_t at = 0;
+    
+    type(reports, "8935235226272", at, 2);
+    Received r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "8935235226272", "EAN-13 terminated by Enter");
+    
+    reports.clear();
+    at = 0;
+    type(reports, "LIB-2024/AB_cd:7", at, 1);
+    r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "LIB-2024/AB_cd:7", "Code 128 with Shift and symbols");
+    
+    reports.clear();
+    at = 0;
+    type(reports, "11000", at, 1);
+    type(reports, "22334455", at, 1);
+    r = replay(reports);
+    expect(r.barcodes.size() == 2 && r.barcodes[0] == "11000" && r.barcodes[1] == "22334455",
+           "repeated digits and back-to-back scans");
+    
+    reports.clear();
+    at = 0;
+    type(reports, "9780262033848", at, 2, 0);
+    r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "9780262033848" &&
+           r.times[0] >= reports.back().atMs - 2 + USB_SCANNER_CHAR_TIMEOUT_MS - 1,
+           "no suffix: barcode ends after the timeout");
+    
+    reports.clear();
+    at = 0;
+    type(reports, "abcdef", at, 150);
+    r = replay(reports);
+    expect(r.barcodes.empty(), "slow typing is discarded");
+    
+    reports.clear();
+    reports.push_back({{0, 0, 0x04, 0x05, 0, 0, 0, 0}, 0});       // 'a' và 'b' cùng report
+    reports.push_back({{0, 0, 0x04, 0x05, 0x06, 0, 0, 0}, 1});    // Giữ a, b; thêm 'c'
+    reports.push_back({{0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01}, 2});  // ErrorRollOver
+    reports.push_back({{0, 0, 0x06, 0x07, 0, 0, 0, 0}, 3});       // Vẫn giữ c, thêm 'd'
+    reports.push_back({{0}, 4});
+    reports.push_back({{0, 0, USAGE_ENTER, 0, 0, 0, 0, 0}, 5});
+    r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "abcd", "rollover: held keys count once");
+    
+    reports.clear();
+    at = 0;
+    type(reports, std::string(REQUEST_DATA_LEN + 8, '7'), at, 1);
+    type(reports, "4006381333931", at, 1);
+    r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "4006381333931", "overlong code dropped, next one read");
+    
+    reports.clear();
+    for (uint8_t i = 0; i < 5; i++) {
+        uint8_t usage = 0x59 + i;                                   // Bàn phím số 1..5
+        reports.push_back({{0, 0, usage, 0, 0, 0, 0, 0}, (uint32_t)i * 2});
+        reports.push_back({{0}, (uint32_t)i * 2 + 1});
+    }
+    reports.push_back({{0, 0, USAGE_KEYPAD_ENTER, 0, 0, 0, 0, 0}, 10});
+    r = replay(reports);
+    expect(r.barcodes.size() == 1 && r.barcodes[0] == "12345", "keypad digits and keypad Enter");
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    
+    checkDecoder();
+    
+    // Chi phí decode: một lần quét EAN-13 = 28 report
+    std::vector<Report> scan;
+    uint32_t at = 0;
+    type(scan, "8935235226272", at, 1);
+    Received sink;
+    HidKeyboardDecoder decoder(collect, &sink);
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    uint32_t now = 0;
+    for (int i = 0; i < iterations; i++) {
+        for (const Report& report : scan) {
+            decoder.feed(report.data, 8, now++);
+        }
+    }
+    double reportNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+                      ((double)iterations * scan.size());
+    expect(decoder.getStats().barcodes == (uint32_t)iterations, "every simulated scan decoded");
+    
+    // Độ trễ từ phím đầu tới khi có mã, theo nhịp gửi report (bInterval) của máy quét
+    printf("\n%-28s %10s %10s\n", "EAN-13, report interval", "Enter", "no suffix");
+    const uint32_t intervals[] = {1, 2, 4, 8};
+    for (uint32_t interval : intervals) {
+        std::vector<Report> withEnter;
+        std::vector<Report> withoutSuffix;
+        uint32_t a = 0;
+        uint32_t b = 0;
+        type(withEnter, "8935235226272", a, interval);
+        type(withoutSuffix, "8935235226272", b, interval, 0);
+        Received first = replay(withEnter);
+        Received second = replay(withoutSuffix);
+        char label[16];
+        snprintf(label, sizeof(label), "%u ms", interval);
+        printf("%-28s %7u ms %7u ms\n", label, first.times.empty() ? 0 : first.times[0],
+               second.times.empty() ? 0 : second.times[0]);
+    }
+    
+    printf("\n%-28s %10s\n", "", "host");
+    printf("%-28s %10.1f ns\n", "feed() per report", reportNs);
+    printf("%-28s %10zu bytes\n", "decoder state", sizeof(HidKeyboardDecoder));
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// Tập UID của chế độ kiểm kê trên máy host: kiểm tra UidSet (bloom filter + mảng
+// đã sắp xếp) và bộ nén lô UID, rồi đo chi phí một lần đọc nhãn, tỉ lệ dương tính
+// giả của bloom filter và kích thước lô gửi lên so với mảng chuỗi hex JSON.
+//
+//   inventory_bench [tags] [reads-per-tag]
+//
+// Mặc định 5000 nhãn trên kệ, mỗi nhãn được đọc trung bình 6 lần (nhãn nằm lâu
+// trong trường của đầu đọc khi đẩy xe qua kệ).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "uid_set.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// Nhãn cùng cuộn: UID 7 byte của NXP (04 + số sê-ri tăng dần)
+static UidKey rollKey(uint32_t serial) {
+    uint8_t uid[7] = {0x04, 0x5A, 0x11, (uint8_t)(serial >> 24), (uint8_t)(serial >> 16),
+                      (uint8_t)(serial >> 8), (uint8_t)serial};
+    return UidSet::makeKey(uid, 7);
+}
+
+// Thẻ/nhãn lẫn lộn: UID 4 byte ngẫu nhiên
+static UidKey randomKey(std::mt19937& rng) {
+    uint32_t value = rng();
+    uint8_t uid[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    return UidSet::makeKey(uid, 4);
+}
+
+// Mảng chuỗi hex JSON tương đương: "04A1B2C3" + dấu phẩy
+static size_t hexArrayBytes(const UidKey* keys, size_t count) {
+    size_t bytes = 2;
+    for (size_t i = 0; i < count; i++) {
+        bytes += (keys[i] >> 56) * 2 + 3;
+    }
+    return bytes;
+}
+
+static void checkKeys() {
+    printf("UidKey\n");
+    uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    uint8_t uid10[10] = {};
+    uint8_t out[7];
+    expect(UidSet::keyToUid(UidSet::makeKey(uid4, 4), out) == 4 && memcmp(out, uid4, 4) == 0,
+           "4-byte UID round trip");
+    expect(UidSet::keyToUid(UidSet::makeKey(uid7, 7), out) == 7 && memcmp(out, uid7, 7) == 0,
+           "7-byte UID round trip");
+    expect(UidSet::makeKey(uid10, 10) == 0, "10-byte UID is not supported");
+    expect(UidSet::makeKey(uid4, 4) != UidSet::makeKey(uid7, 4) &&
+           UidSet::makeKey(uid7, 4) != UidSet::makeKey(uid7, 7), "length is part of the key");
+}
+
+static void checkSet() {
+    printf("UidSet\n");
+    const uint32_t capacity = 1000;
+    std::vector<uint32_t> bloom(INVENTORY_BLOOM_BITS / 32);
+    std::vector<UidKey> storage(capacity);
+    UidSet set(bloom.data(), storage.data(), capacity);
+    
+    std::mt19937 rng(7);
+    std::vector<UidKey> keys;
+    while (keys.size() < capacity) {
+        UidKey key = randomKey(rng);
+        if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+            keys.push_back(key);
+        }
+    }
+    
+    bool inserted = true;
+    for (UidKey key : keys) {
+        inserted &= set.insert(key) == UID_INSERTED;
+    }
+    expect(inserted && set.size() == capacity, "distinct keys are all inserted");
+    
+    bool duplicates = true;
+    for (UidKey key : keys) {
+        duplicates &= set.insert(key) == UID_DUPLICATE;
+    }
+    expect(duplicates && set.size() == capacity, "second insert is a duplicate");
+    expect(set.insert(rollKey(1)) == UID_SET_FULL, "full set refuses new keys");
+    
+    bool absent = true;
+    for (uint32_t i = 0; i < 10000; i++) {
+        absent &= !set.contains(rollKey(i));
+    }
+    expect(absent, "keys never inserted are not found");
+    
+    set.clear();
+    expect(set.size() == 0 && !set.contains(keys[0]) && set.insert(keys[0]) == UID_INSERTED,
+           "clear() starts a new session");
+}
+
+static void checkEncoding() {
+    printf("Batch encoding\n");
+    std::mt19937 rng(11);
+    std::vector<UidKey> keys;
+    for (uint32_t i = 0; i < INVENTORY_BATCH_MAX; i++) {
+        keys.push_back(i % 2 == 0 ? rollKey(1000 + i * 3) : randomKey(rng));
+    }
+    std::vector<UidKey> expected = keys;
+    std::sort(expected.begin(), expected.end());
+    
+    std::vector<uint8_t> encoded(INVENTORY_BATCH_MAX * 10);
+    size_t length = UidSet::encodeBatch(keys.data(), keys.size(), encoded.data(), encoded.size());
+    std::vector<UidKey> decoded(INVENTORY_BATCH_MAX);
+    int count = UidSet::decodeBatch(encoded.data(), length, decoded.data(), decoded.size());
+    expect(length > 0 && count == (int)keys.size() &&
+           std::equal(expected.begin(), expected.end(), decoded.begin()), "mixed batch round trip");
+    expect(UidSet::encodeBatch(keys.data(), keys.size(), encoded.data(), length - 1) == 0,
+           "encode reports a buffer that is too small");
+    const uint8_t truncated[] = {0x85, 0x80};
+    expect(UidSet::decodeBatch(truncated, sizeof(truncated), decoded.data(), decoded.size()) == -1,
+           "decode rejects a truncated varint");
+    expect(UidSet::decodeBatch(encoded.data(), length, decoded.data(), count - 1) == -1,
+           "decode rejects more keys than maxKeys");
+}
+
+// Kích thước một lô INVENTORY_BATCH_MAX UID gửi lên theo từng cách mã hóa
+static void measureBatch(const char* name, std::vector<UidKey> keys) {
+    size_t hex = hexArrayBytes(keys.data(), keys.size());
+    std::vector<uint8_t> encoded(keys.size() * 10);
+    size_t length = UidSet::encodeBatch(keys.data(), keys.size(), encoded.data(), encoded.size());
+    size_t base64 = (length + 2) / 3 * 4;
+    printf("%-28s %8zu %8zu %8zu %7.1fx\n", name, hex, length, base64, (double)hex / base64);
+}
+
+int main(int argc, char** argv) {
+    uint32_t tags = argc > 1 ? atoi(argv[1]) : 5000;
+    uint32_t readsPerTag = argc > 2 ? atoi(argv[2]) : 6;
+    tags = std::min<uint32_t>(tags, INVENTORY_MAX_TAGS);
+    
+    checkKeys();
+    checkSet();
+    checkEncoding();
+    
+    // Một phiên kiểm kê: nhãn cùng cuộn lẫn nhãn rời, mỗi nhãn đọc nhiều lần theo thứ tự ngẫu nhiên
+    std::mt19937 rng(42);
+    std::vector<UidKey> shelf;
+    for (uint32_t i = 0; i < tags; i++) {
+        shelf.push_back(i % 4 == 3 ? randomKey(rng) : rollKey(0x10000 + i));
+    }
+    std::vector<UidKey> reads;
+    for (uint32_t i = 0; i < tags * readsPerTag; i++) {
+        reads.push_back(shelf[rng() % tags]);
+    }
+    
+    std::vector<uint32_t> bloom(INVENTORY_BLOOM_BITS / 32);
+    std::vector<UidKey> storage(INVENTORY_MAX_TAGS);
+    UidSet set(bloom.data(), storage.data(), INVENTORY_MAX_TAGS);
+    
+    using Clock = std::chrono::steady_clock;
+    uint32_t unique = 0;
+    uint32_t duplicates = 0;
+    auto start = Clock::now();
+    for (UidKey key : reads) {
+        if (set.insert(key) == UID_INSERTED) {
+            unique++;
+        } else {
+            duplicates++;
+        }
+    }
+    double insertNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / reads.size();
+    
+    // Đọc ngẫu nhiên nên vài nhãn có thể chưa lần nào được đọc
+    std::vector<UidKey> distinct = reads;
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    uint32_t seen = 0;
+    for (UidKey key : distinct) {
+        seen += set.contains(key) ? 1 : 0;
+    }
+    printf("Session\n");
+    expect(unique == set.size() && seen == distinct.size(), "every tag read is in the set");
+    expect(set.size() == distinct.size(), "no tag counted twice");
+    
+    // Dương tính giả đo trên khóa chắc chắn không có trong tập
+    UidSetStats before = set.getStats();
+    const uint32_t probes = 100000;
+    for (uint32_t i = 0; i < probes; i++) {
+        set.contains(rollKey(0x01000000 + i));
+    }
+    uint32_t falsePositives = set.getStats().falsePositives - before.falsePositives;
+    
+    printf("\n%-28s %10s\n", "", "host");
+    printf("%-28s %10u\n", "reads", (unsigned)reads.size());
+    printf("%-28s %10u\n", "unique tags", unique);
+    printf("%-28s %9.1f%%\n", "duplicate ratio", 100.0 * duplicates / reads.size());
+    printf("%-28s %10.1f ns\n", "insert (dedup) per read", insertNs);
+    printf("%-28s %9.2f%%\n", "bloom false positives", 100.0 * falsePositives / probes);
+    printf("%-28s %10u\n", "tail merges", set.getStats().merges);
+    printf("%-28s %10zu bytes\n", "set memory", set.bytesUsed());
+    
+    printf("\n%-28s %8s %8s %8s %8s\n", "batch of 128", "hex", "varint", "base64", "ratio");
+    std::vector<UidKey> roll;
+    std::vector<UidKey> random;
+    std::vector<UidKey> mixed;
+    for (uint32_t i = 0; i < INVENTORY_BATCH_MAX; i++) {
+        roll.push_back(rollKey(0x10000 + i));
+        random.push_back(randomKey(rng));
+        mixed.push_back(shelf[rng() % tags]);
+    }
+    measureBatch("same roll (7-byte)", roll);
+    measureBatch("random (4-byte)", random);
+    measureBatch("shelf sample", mixed);
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// Metrics của trạm trên máy host: kiểm tra histogram và định dạng Prometheus
+// text (0.0.4) mà MetricsServer trả về, rồi đo chi phí observe() trên luồng quét
+// và thời gian dựng một lần scrape so với METRICS_BUFFER_SIZE.
+//
+//   metrics_bench [iterations] [--dump]
+//
+// --dump: in nội dung một lần scrape mẫu.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include "config.h"
+#include "station_metrics.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// Bố cục giống collectMetrics() trong main.cpp (giá trị cố định, 2 đầu đọc)
+static void collectDevice(MetricsWriter& out) {
+    static const char* const PRIORITIES[] = {"scan", "replay", "heartbeat"};
+    static const char* const TASKS[] = {"loop", "net", "metrics"};
+    char labels[64];
+    
+    out.family("station_uptime_seconds", "gauge", "Time since boot");
+    out.sample("station_uptime_seconds", "", (uint64_t)86400);
+    stationMetrics.write(out);
+    out.family("station_wifi_rssi_dbm", "gauge", "WiFi signal strength");
+    out.sample("station_wifi_rssi_dbm", "", (int64_t)-67);
+    
+    const char* heapGauges[] = {"station_heap_free_bytes", "station_heap_min_free_bytes",
+                                "station_heap_largest_free_block_bytes", "station_heap_drift_bytes",
+                                "station_psram_free_bytes", "station_arena_high_water_bytes"};
+    for (const char* name : heapGauges) {
+        out.family(name, "gauge", "Heap gauge");
+        out.sample(name, "", (uint64_t)181234);
+    }
+    out.family("station_heap_fragmentation_ratio", "gauge", "1 - largest free block / free heap");
+    out.sample("station_heap_fragmentation_ratio", "", 0.12);
+    out.family("station_arena_overflows_total", "counter", "Scan arena allocations that did not fit");
+    out.sample("station_arena_overflows_total", "", (uint64_t)0);
+    
+    out.family("station_tls_handshakes_total", "counter", "TLS handshakes by type");
+    out.sample("station_tls_handshakes_total", "type=\"full\"", (uint64_t)12);
+    out.sample("station_tls_handshakes_total", "type=\"resumed\"", (uint64_t)388);
+    out.sample("station_tls_handshakes_total", "type=\"failed\"", (uint64_t)1);
+    out.family("station_tls_handshake_seconds_total", "counter", "Time spent in TLS handshakes");
+    out.sample("station_tls_handshake_seconds_total", "type=\"full\"", 13.2);
+    out.sample("station_tls_handshake_seconds_total", "type=\"resumed\"", 23.3);
+    
+    out.family("station_task_stack_free_bytes", "gauge", "Stack high-water mark per task");
+    for (const char* task : TASKS) {
+        snprintf(labels, sizeof(labels), "task=\"%s\"", task);
+        out.sample("station_task_stack_free_bytes", labels, (uint64_t)2048);
+    }
+    const char* queueFamilies[] = {"station_request_queue_depth", "station_requests_served_total",
+                                   "station_requests_dropped_total"};
+    for (const char* name : queueFamilies) {
+        out.family(name, strstr(name, "_total") ? "counter" : "gauge", "Request scheduler");
+        for (const char* priority : PRIORITIES) {
+            snprintf(labels, sizeof(labels), "priority=\"%s\"", priority);
+            out.sample(name, labels, (uint64_t)1234);
+        }
+    }
+    out.family("station_backpressure_limit", "gauge", "AIMD limit on requests in flight (1 = unthrottled)");
+    out.sample("station_backpressure_limit", "", 0.125);
+    out.family("station_backpressure_hold_seconds", "gauge", "Time left before the server accepts requests again");
+    out.sample("station_backpressure_hold_seconds", "", 4.25);
+    const char* pressureCounters[] = {"station_backpressure_overloads_total", "station_backpressure_shed_total",
+                                      "station_backpressure_rejected_total"};
+    for (const char* name : pressureCounters) {
+        out.family(name, "counter", "Backpressure");
+        out.sample(name, "", (uint64_t)37);
+    }
+    out.family("station_config_revision", "gauge", "Server configuration revision applied to the station");
+    out.sample("station_config_revision", "", (uint64_t)17);
+    out.family("station_config_params_total", "counter", "Runtime parameter changes by result");
+    out.sample("station_config_params_total", "result=\"applied\"", (uint64_t)9);
+    out.sample("station_config_params_total", "result=\"rejected\"", (uint64_t)1);
+    out.family("station_inventory_active", "gauge", "1 while a stocktake session is running");
+    out.sample("station_inventory_active", "", (uint64_t)1);
+    out.family("station_inventory_tags_total", "counter", "Tag reads in the current stocktake session by result");
+    out.sample("station_inventory_tags_total", "result=\"unique\"", (uint64_t)4873);
+    out.sample("station_inventory_tags_total", "result=\"duplicate\"", (uint64_t)21950);
+    out.sample("station_inventory_tags_total", "result=\"deferred\"", (uint64_t)0);
+    out.family("station_inventory_tags_per_second", "gauge", "Tag reads per second over the last second");
+    out.sample("station_inventory_tags_per_second", "", 41.5);
+    out.family("station_inventory_pending_tags", "gauge", "Unique tags waiting to be uploaded");
+    out.sample("station_inventory_pending_tags", "", (uint64_t)37);
+    out.family("station_inventory_upload_bytes_total", "counter", "Uploaded UID bytes, compressed and as a hex array");
+    out.sample("station_inventory_upload_bytes_total", "encoding=\"delta-varint\"", (uint64_t)14602);
+    out.sample("station_inventory_upload_bytes_total", "encoding=\"hex\"", (uint64_t)58476);
+    out.family("station_rfid_detections_total", "counter", "Cards detected per reader");
+    out.sample("station_rfid_detections_total", "reader=\"0\",lane=\"checkout\"", (uint64_t)812);
+    out.sample("station_rfid_detections_total", "reader=\"1\",lane=\"return\"", (uint64_t)455);
+    out.family("station_usb_scanner_connected", "gauge", "1 if a USB barcode scanner is attached");
+    out.sample("station_usb_scanner_connected", "", (uint64_t)1);
+    out.family("station_usb_scanner_barcodes_total", "counter", "Keystroke sequences from the USB scanner by result");
+    out.sample("station_usb_scanner_barcodes_total", "result=\"ok\"", (uint64_t)530);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"discarded\"", (uint64_t)4);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"overflow\"", (uint64_t)0);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"dropped\"", (uint64_t)0);
+    out.family("station_event_stream_clients", "gauge", "Open WebSocket clients");
+    out.sample("station_event_stream_clients", "", (uint64_t)2);
+    out.family("station_event_stream_dropped_total", "counter", "WebSocket clients disconnected");
+    out.sample("station_event_stream_dropped_total", "reason=\"slow\"", (uint64_t)1);
+    out.sample("station_event_stream_dropped_total", "reason=\"timeout\"", (uint64_t)3);
+}
+
+static void checkHistogram() {
+    printf("MetricHistogram\n");
+    static const uint32_t bounds[] = {10, 100, 1000};
+    MetricHistogram h(bounds, 3);
+    const uint32_t values[] = {0, 10, 11, 100, 999, 1000, 1001, 50000};
+    for (uint32_t v : values) {
+        h.observe(v);
+    }
+    expect(h.getCumulative(0) == 2, "le=10 includes the bound itself");
+    expect(h.getCumulative(1) == 4, "le=100 is cumulative");
+    expect(h.getCumulative(2) == 6, "le=1000 is cumulative");
+    expect(h.getCumulative(3) == 8 && h.getCount() == 8, "+Inf equals count");
+    expect(h.getSum() == 0 + 10 + 11 + 100 + 999 + 1000 + 1001 + 50000, "sum is exact");
+}
+
+static void checkWriter() {
+    printf("MetricsWriter\n");
+    char buffer[512];
+    MetricsWriter out(buffer, sizeof(buffer));
+    out.family("x_total", "counter", "Help text");
+    out.sample("x_total", "", (uint64_t)7);
+    out.sample("x_total", "type=\"a\"", (uint64_t)18446744073709551615ull);
+    out.sample("y", "", (int64_t)-67);
+    out.sample("z", "", 0.25);
+    expect(strcmp(buffer, "# HELP x_total Help text\n# TYPE x_total counter\n"
+                          "x_total 7\nx_total{type=\"a\"} 18446744073709551615\ny -67\nz 0.25\n") == 0,
+           "HELP/TYPE, labels and value formats");
+    
+    static const uint32_t bounds[] = {25, 1000};
+    MetricHistogram h(bounds, 2);
+    h.observe(20);
+    h.observe(1500);
+    MetricsWriter hist(buffer, sizeof(buffer));
+    hist.histogram("d_seconds", "endpoint=\"book\"", h, 0.001);
+    expect(strcmp(buffer, "d_seconds_bucket{endpoint=\"book\",le=\"0.025\"} 1\n"
+                          "d_seconds_bucket{endpoint=\"book\",le=\"1\"} 1\n"
+                          "d_seconds_bucket{endpoint=\"book\",le=\"+Inf\"} 2\n"
+                          "d_seconds_sum{endpoint=\"book\"} 1.52\n"
+                          "d_seconds_count{endpoint=\"book\"} 2\n") == 0,
+           "histogram lines, scaled le and sum");
+    
+    char small[40];
+    MetricsWriter tight(small, sizeof(small));
+    tight.sample("first_metric", "", (uint64_t)1);
+    tight.sample("second_metric_does_not_fit", "", (uint64_t)2);
+    expect(tight.overflowed() && strcmp(small, "first_metric 1\n") == 0,
+           "overflow keeps only complete lines");
+}
+
+// Kiểm tra cú pháp từng dòng như một Prometheus scraper: mỗi sample thuộc một family
+// đã khai báo HELP/TYPE, bucket cộng dồn không giảm và +Inf bằng _count
+static bool validateExposition(const char* text, size_t& samples) {
+    std::map<std::string, std::string> types;
+    std::map<std::string, double> lastBucket, infBucket;
+    samples = 0;
+    
+    const char* line = text;
+    while (*line != '\0') {
+        const char* end = strchr(line, '\n');
+        if (end == nullptr) {
+            return false;
+        }
+        std::string row(line, end - line);
+        line = end + 1;
+    
+        if (row.rfind("# HELP ", 0) == 0) {
+            continue;
+        }
+        if (row.rfind("# TYPE ", 0) == 0) {
+            size_t space = row.find(' ', 7);
+            types[row.substr(7, space - 7)] = row.substr(space + 1);
+            continue;
+        }
+    
+        size_t nameEnd = row.find_first_of("{ ");
+        std::string name = row.substr(0, nameEnd);
+        std::string labels;
+        size_t valueStart = nameEnd + 1;
+        if (row[nameEnd] == '{') {
+            size_t close = row.find("} ", nameEnd);
+            if (close == std::string::npos) {
+                return false;
+            }
+            labels = row.substr(nameEnd + 1, close - nameEnd - 1);
+            valueStart = close + 2;
+        }
+        char* parsedEnd;
+        double value = strtod(row.c_str() + valueStart, &parsedEnd);
+        if (*parsedEnd != '\0' || parsedEnd == row.c_str() + valueStart) {
+            return false;
+        }
+    
+        std::string family = name;
+        for (const char* suffix : {"_bucket", "_sum", "_count"}) {
+            size_t n = strlen(suffix);
+            if (family.size() > n && family.compare(family.size() - n, n, suffix) == 0 &&
+                types.count(family.substr(0, family.size() - n)) != 0) {
+                family = family.substr(0, family.size() - n);
+            }
+        }
+        if (types.count(family) == 0) {
+            printf("  sample before TYPE: %s\n", row.c_str());
+            return false;
+        }
+    
+        if (types[family] == "histogram") {
+            size_t le = labels.find("le=\"");
+            std::string series = family + "{" + (le == std::string::npos ? labels : labels.substr(0, le)) + "}";
+            if (name == family + "_bucket") {
+                if (lastBucket.count(series) != 0 && value < lastBucket[series]) {
+                    return false;
+                }
+                lastBucket[series] = value;
+                if (labels.find("le=\"+Inf\"") != std::string::npos) {
+                    infBucket[series] = value;
+                }
+            } else if (name == family + "_count") {
+                std::string key = family + "{" + labels + (labels.empty() ? "" : ",") + "}";
+                if (infBucket.count(key) == 0 || infBucket[key] != value) {
+                    return false;
+                }
+                lastBucket.erase(key);
+            }
+        }
+        samples++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 && argv[1][0] != '-' ? atoi(argv[1]) : 20000;
+    bool dumpScrape = argc > 1 && strcmp(argv[argc - 1], "--dump") == 0;
+    
+    checkHistogram();
+    checkWriter();
+    
+    // Số liệu giống một ngày hoạt động của trạm
+    srand(42);
+    for (int i = 0; i < 2000; i++) {
+        stationMetrics.countScan(i % 3 == 0 ? SCAN_KIND_BOOK : SCAN_KIND_STUDENT, i % 17 != 0);
+        stationMetrics.observeHttp((ApiEndpoint)(i % ENDPOINT_COUNT), 30 + rand() % 900);
+        stationMetrics.observeLoop(200 + rand() % 40000);
+        stationMetrics.observeBatch(1 + rand() % BATCH_MAX_ITEMS, rand() % (BATCH_MAX_WINDOW_MS * 1000));
+        if (i % 50 == 0) {
+            stationMetrics.countApiError((ApiErrorType)(i % API_ERROR_COUNT));
+        }
+    }
+    
+    static char buffer[METRICS_BUFFER_SIZE];
+    MetricsWriter out(buffer, sizeof(buffer));
+    collectDevice(out);
+    size_t samples = 0;
+    printf("Scrape\n");
+    expect(!out.overflowed(), "full scrape fits METRICS_BUFFER_SIZE");
+    expect(validateExposition(buffer, samples), "exposition format parses");
+    if (dumpScrape) {
+        printf("\n%s\n", buffer);
+    }
+    
+    // observe() chạy trên loop() và task mạng mỗi request: phải gần như miễn phí
+    using Clock = std::chrono::steady_clock;
+    uint32_t values[1024];
+    for (uint32_t& v : values) {
+        v = rand() % 2000000;
+    }
+    auto start = Clock::now();
+    for (int i = 0; i < iterations * 50; i++) {
+        stationMetrics.observeLoop(values[i & 1023]);
+    }
+    double observeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (iterations * 50.0);
+    
+    size_t length = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        MetricsWriter render(buffer, sizeof(buffer));
+        collectDevice(render);
+        length = render.length();
+    }
+    double renderUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+    
+    printf("\n%-28s %10s\n", "", "host");
+    printf("%-28s %10.1f ns\n", "observe()", observeNs);
+    printf("%-28s %10.1f us\n", "render scrape", renderUs);
+    printf("%-28s %10zu\n", "samples", samples);
+    printf("%-28s %10zu / %d bytes\n", "scrape size", length, METRICS_BUFFER_SIZE);
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// Đường đi hiện tại của thư viện MFRC522 (miguelbalboa/MFRC522 1.4.x) cho
+// PICC_IsNewCardPresent() + PICC_ReadCardSerial(), viết lại ở mức frame SPI để
+// so sánh với Rc522Driver trên cùng thiết bị giả. Mỗi lần đọc/ghi thanh ghi là
+// một transaction SPI chặn riêng; CRC_A nhờ chip tính (CalcCRC). Chỉ đi nhánh
+// không va chạm (một thẻ trên đầu đọc), giống trường hợp sử dụng ở trạm.
+#ifndef MFRC522_REFERENCE_H
+#define MFRC522_REFERENCE_H
+
+#include <cstring>
+#include "rc522_bus.h"
+
+class ReferenceMfrc522 {
+public:
+    explicit ReferenceMfrc522(Rc522Bus& bus) : uidSize(0), sak(0), bus(bus) {}
+    
+    bool isNewCardPresent() {
+        writeRegister(TX_MODE, 0x00);
+        writeRegister(RX_MODE, 0x00);
+        writeRegister(MOD_WIDTH, 0x26);
+    
+        uint8_t atqa[2];
+        uint8_t atqaSize = sizeof(atqa);
+        uint8_t command = 0x26;
+        clearBits(COLL, 0x80);
+        uint8_t validBits = 7;
+        Status status = transceive(&command, 1, atqa, &atqaSize, &validBits);
+        if (status == OK && (atqaSize != 2 || validBits != 0)) {
+            status = ERROR;
+        }
+        return status == OK || status == COLLISION;
+    }
+    
+    bool readCardSerial() {
+        clearBits(COLL, 0x80);
+        uidSize = 0;
+    
+        for (uint8_t level = 0; level < 3; level++) {
+            uint8_t buffer[9];
+            buffer[0] = 0x93 + 2 * level;
+    
+            // ANTICOLLISION
+            buffer[1] = 0x20;
+            writeRegister(BIT_FRAMING, 0x00);
+            uint8_t responseSize = 5;
+            uint8_t validBits = 0;
+            if (transceive(buffer, 2, buffer + 2, &responseSize, &validBits) != OK || responseSize != 5) {
+                return false;
+            }
+    
+            // SELECT
+            buffer[1] = 0x70;
+            if (calculateCrc(buffer, 7, buffer + 7) != OK) {
+                return false;
+            }
+            writeRegister(BIT_FRAMING, 0x00);
+            uint8_t sakBuffer[3];
+            responseSize = sizeof(sakBuffer);
+            validBits = 0;
+            if (transceive(buffer, 9, sakBuffer, &responseSize, &validBits) != OK || responseSize != 3) {
+                return false;
+            }
+            uint8_t crc[2];
+            if (calculateCrc(sakBuffer, 1, crc) != OK || crc[0] != sakBuffer[1] || crc[1] != sakBuffer[2]) {
+                return false;
+            }
+    
+            sak = sakBuffer[0];
+            bool cascade = (sak & 0x04) != 0;
+            memcpy(uid + uidSize, buffer + (cascade ? 3 : 2), cascade ? 3 : 4);
+            uidSize += cascade ? 3 : 4;
+            if (!cascade) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    uint8_t uid[10];
+    uint8_t uidSize;
+    uint8_t sak;
+    
+private:
+    enum Status { OK, ERROR, COLLISION, TIMEOUT };
+    enum : uint8_t {
+        COMMAND = 0x01, COM_IRQ = 0x04, DIV_IRQ = 0x05, ERROR_REG = 0x06, FIFO_DATA = 0x09,
+        FIFO_LEVEL = 0x0A, CONTROL = 0x0C, BIT_FRAMING = 0x0D, COLL = 0x0E, TX_MODE = 0x12,
+        RX_MODE = 0x13, CRC_RESULT_H = 0x21, CRC_RESULT_L = 0x22, MOD_WIDTH = 0x24
+    };
+    
+    // Mỗi lần gọi = beginTransaction + CS + SPI.transfer từng byte + endTransaction
+    void frame(const uint8_t* tx, uint8_t* rx, uint8_t length) {
+        Rc522Frame f = {tx, rx, length};
+        bus.submit(&f, 1);
+        while (!bus.done()) {
+        }
+    }
+    
+    void writeRegister(uint8_t reg, uint8_t value) {
+        uint8_t tx[2] = {(uint8_t)((reg << 1) & 0x7E), value};
+        frame(tx, nullptr, 2);
+    }
+    
+    void writeRegister(uint8_t reg, uint8_t count, const uint8_t* values) {
+        uint8_t tx[65];
+        tx[0] = (reg << 1) & 0x7E;
+        memcpy(tx + 1, values, count);
+        frame(tx, nullptr, count + 1);
+    }
+    
+    uint8_t readRegister(uint8_t reg) {
+        uint8_t tx[2] = {(uint8_t)(((reg << 1) & 0x7E) | 0x80), 0x00};
+        uint8_t rx[2];
+        frame(tx, rx, 2);
+        return rx[1];
+    }
+    
+    void readRegister(uint8_t reg, uint8_t count, uint8_t* values) {
+        uint8_t tx[65];
+        uint8_t rx[65];
+        memset(tx, ((reg << 1) & 0x7E) | 0x80, count);
+        tx[count] = 0x00;
+        frame(tx, rx, count + 1);
+        memcpy(values, rx + 1, count);
+    }
+    
+    void setBits(uint8_t reg, uint8_t mask) { writeRegister(reg, readRegister(reg) | mask); }
+    void clearBits(uint8_t reg, uint8_t mask) { writeRegister(reg, readRegister(reg) & ~mask); }
+    
+    Status transceive(const uint8_t* send, uint8_t sendLength, uint8_t* back, uint8_t* backLength,
+                      uint8_t* validBits) {
+        uint8_t txLastBits = *validBits;
+        writeRegister(COMMAND, 0x00);
+        writeRegister(COM_IRQ, 0x7F);
+        writeRegister(FIFO_LEVEL, 0x80);
+        writeRegister(FIFO_DATA, sendLength, send);
+        writeRegister(BIT_FRAMING, txLastBits);
+        writeRegister(COMMAND, 0x0C);
+        setBits(BIT_FRAMING, 0x80);
+    
+        // Chờ RxIRq/IdleIRq hoặc timer (thư viện chặn ở đây tới 25 ms khi không có thẻ)
+        for (;;) {
+            uint8_t irq = readRegister(COM_IRQ);
+            if (irq & 0x30) {
+                break;
+            }
+            if (irq & 0x01) {
+                return TIMEOUT;
+            }
+        }
+    
+        uint8_t error = readRegister(ERROR_REG);
+        if (error & 0x13) {
+            return ERROR;
+        }
+        uint8_t level = readRegister(FIFO_LEVEL);
+        if (level > *backLength) {
+            return ERROR;
+        }
+        *backLength = level;
+        readRegister(FIFO_DATA, level, back);
+        *validBits = readRegister(CONTROL) & 0x07;
+        if (error & 0x08) {
+            return COLLISION;
+        }
+        return OK;
+    }
+    
+    Status calculateCrc(const uint8_t* data, uint8_t length, uint8_t result[2]) {
+        writeRegister(COMMAND, 0x00);
+        writeRegister(DIV_IRQ, 0x04);
+        writeRegister(FIFO_LEVEL, 0x80);
+        writeRegister(FIFO_DATA, length, data);
+        writeRegister(COMMAND, 0x03);
+        for (uint16_t i = 0; i < 5000; i++) {
+            if (readRegister(DIV_IRQ) & 0x04) {
+                writeRegister(COMMAND, 0x00);
+                result[0] = readRegister(CRC_RESULT_L);
+                result[1] = readRegister(CRC_RESULT_H);
+                return OK;
+            }
+        }
+        return TIMEOUT;
+    }
+    
+    Rc522Bus& bus;
+};
+
+#endif // MFRC522_REFERENCE_H
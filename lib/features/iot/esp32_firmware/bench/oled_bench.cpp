@@ -0,0 +1,235 @@
+// Bảng glyph tiếng Việt + framebuffer OLED trên máy host: kiểm tra glyph/UTF-8/
+// xuống dòng, rồi đo chuỗi màn hình của một lượt mượn sách: số byte I2C mỗi
+// frame khi chỉ gửi phần thay đổi so với gửi cả màn hình, thời gian trên dây ở
+// OLED_I2C_CLOCK và thời gian vẽ trên máy host.
+//
+//   oled_bench [iterations] [--dump]
+//
+// --dump: in các màn hình ra dạng ký tự để xem glyph bằng mắt.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include "config.h"
+#include "glyph_atlas.h"
+#include "oled_framebuffer.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// Bố cục giống LCDHandler::show() khi DISPLAY_OLED
+static void render(OledFramebuffer& frame, const char* line1, const char* line2) {
+    frame.clear();
+    bool hasLine2 = line2[0] != '\0';
+    uint8_t rows = frame.drawWrapped(0, line1, hasLine2 ? OLED_TEXT_ROWS - 1 : OLED_TEXT_ROWS);
+    if (hasLine2) {
+        frame.drawWrapped(rows, line2, OLED_TEXT_ROWS - rows);
+    }
+}
+
+// Giả lập flush: gửi hết các đoạn thay đổi, trả về số byte I2C
+static uint32_t flush(OledFramebuffer& frame, uint32_t* spans = nullptr) {
+    uint32_t bytes = 0;
+    OledSpan span;
+    while (frame.nextSpan(span)) {
+        bytes += OledFramebuffer::i2cBytes(span);
+        frame.markShown(span);
+        if (spans != nullptr) {
+            (*spans)++;
+        }
+    }
+    return bytes;
+}
+
+static void dump(const OledFramebuffer& frame) {
+    for (int y = 0; y < OLED_HEIGHT; y++) {
+        std::string line;
+        for (int x = 0; x < OLED_WIDTH; x++) {
+            line += (frame.pageData(y / 8)[x] >> (y % 8)) & 1 ? '#' : '.';
+        }
+        printf("  %s\n", line.c_str());
+    }
+}
+
+static std::string stripTones(const char* text) {
+    std::string result;
+    while (*text != '\0') {
+        char c = GlyphAtlas::baseLetter(GlyphAtlas::nextCodepoint(text));
+        if (c != 0) {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// ============================================
+// Kiểm tra chức năng
+// ============================================
+
+static void checkAtlas() {
+    printf("Glyph atlas\n");
+    expect(GlyphAtlas::glyphCount() == 95 + 134, "95 ASCII + 134 Vietnamese glyphs");
+    
+    std::set<std::string> bitmaps;
+    const uint8_t* question = GlyphAtlas::glyph('?');
+    const char* all = "aàảãáạăằẳẵắặâầẩẫấậeèẻẽéẹêềểễếệiìỉĩíịoòỏõóọôồổỗốộơờởỡớợuùủũúụưừửữứựyỳỷỹýỵđ"
+                      "AÀẢÃÁẠĂẰẲẴẮẶÂẦẨẪẤẬEÈẺẼÉẸÊỀỂỄẾỆIÌỈĨÍỊOÒỎÕÓỌÔỒỔỖỐỘƠỜỞỠỚỢUÙỦŨÚỤƯỪỬỮỨỰYỲỶỸÝỴĐ";
+    bool covered = true;
+    size_t count = 0;
+    for (const char* p = all; *p != '\0'; count++) {
+        const uint8_t* bitmap = GlyphAtlas::glyph(GlyphAtlas::nextCodepoint(p));
+        covered = covered && bitmap != question;
+        bitmaps.insert(std::string((const char*)bitmap, GLYPH_BYTES));
+    }
+    expect(covered && count == 12 * 6 * 2 + 2, "every Vietnamese letter has its own glyph");
+    expect(bitmaps.size() == count, "all Vietnamese glyphs distinct");
+    expect(GlyphAtlas::glyph(0x4E2D) == question, "unknown codepoint -> '?'");
+    
+    expect(stripTones("Nguyễn Thị Ánh Đào") == "Nguyen Thi Anh Dao", "baseLetter strips tones and d-stroke");
+    expect(stripTones("Trường Đại học Bách khoa") == "Truong Dai hoc Bach khoa", "baseLetter on a mixed-case phrase");
+}
+
+static void checkUtf8() {
+    printf("UTF-8 decoder\n");
+    const char* text = "A\xC3\xA0\xE1\xBB\x87\xF0\x9F\x93\x9A";
+    uint32_t a = GlyphAtlas::nextCodepoint(text);
+    uint32_t b = GlyphAtlas::nextCodepoint(text);
+    uint32_t c = GlyphAtlas::nextCodepoint(text);
+    uint32_t d = GlyphAtlas::nextCodepoint(text);
+    expect(a == 'A' && b == 0xE0 && c == 0x1EC7 && d == 0x1F4DA && *text == '\0', "1-4 byte sequences");
+    
+    const char* truncated = "\xE1\xBB";
+    expect(GlyphAtlas::nextCodepoint(truncated) == 0xFFFD && *truncated == '\0',
+           "truncated sequence stops at NUL");
+    const char* stray = "\x80x";
+    expect(GlyphAtlas::nextCodepoint(stray) == 0xFFFD && *stray == 'x', "stray continuation byte skipped");
+}
+
+static bool rowIsBlank(const OledFramebuffer& frame, uint8_t row) {
+    for (uint8_t p = 0; p < GLYPH_PAGES; p++) {
+        const uint8_t* data = frame.pageData(row * GLYPH_PAGES + p);
+        for (int x = 0; x < OLED_WIDTH; x++) {
+            if (data[x] != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void checkFramebuffer() {
+    printf("Framebuffer\n");
+    OledFramebuffer frame;
+    
+    // 21 ký tự mỗi dòng: "Nguyễn Thị Thanh" (16) + "Hương" không vừa → xuống dòng
+    uint8_t rows = frame.drawWrapped(0, "Nguyễn Thị Thanh Hương Giang", 3);
+    OledFramebuffer expected;
+    expected.drawText(0, 0, "Nguyễn Thị Thanh");
+    expected.drawText(1, 0, "Hương Giang");
+    expect(rows == 2 && memcmp(frame.pageData(0), expected.pageData(0), OLED_WIDTH) == 0 &&
+           memcmp(frame.pageData(3), expected.pageData(3), OLED_WIDTH) == 0, "wraps at word boundary");
+    
+    frame.clear();
+    rows = frame.drawWrapped(0, "Lập trình hướng đối tượng với C++ và các mẫu thiết kế", 2);
+    expect(rows == 2 && !rowIsBlank(frame, 1) && rowIsBlank(frame, 2), "wrap stops at maxRows");
+    
+    frame.clear();
+    flush(frame);
+    render(frame, "Sẵn sàng!", "Quét thẻ/sách");
+    uint32_t first = flush(frame);
+    render(frame, "Sẵn sàng!", "Quét thẻ/sách");
+    expect(first > 0 && flush(frame) == 0, "redraw of same screen sends nothing");
+    
+    frame.invalidate();
+    uint32_t spans = 0;
+    flush(frame, &spans);
+    expect(spans == OLED_PAGES, "invalidate -> full pages");
+}
+
+// ============================================
+// Benchmark: chuỗi màn hình của một lượt mượn
+// ============================================
+
+struct Screen {
+    const char* name;
+    const char* line1;
+    const char* line2;
+};
+
+int main(int argc, char** argv) {
+    size_t iterations = 100000;
+    bool dumpScreens = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) {
+            dumpScreens = true;
+        } else {
+            iterations = strtoul(argv[i], nullptr, 10);
+        }
+    }
+    
+    checkAtlas();
+    checkUtf8();
+    checkFramebuffer();
+    
+    const Screen screens[] = {
+        {"ready", "Sẵn sàng!", "Quét thẻ/sách"},
+        {"processing", "Đang xử lý...", ""},
+        {"student", "Nguyễn Thị Thanh Hương", "MSSV:20210001"},
+        {"loans", "Đang mượn: 3", "Quá hạn: 1"},
+        {"processing", "Đang xử lý...", ""},
+        {"book", "Giáo trình Giải tích 1 - Nguyễn Đình Trí", "Mã:8935086854321"},
+        {"due", "Giáo trình Giải tích 1 - Nguyễn Đình Trí", "Hạn:2026-11-02"},
+        {"ready", "Sẵn sàng!", "Quét thẻ/sách"},
+    };
+    const size_t count = sizeof(screens) / sizeof(screens[0]);
+    
+    OledSpan page = {0, 0, OLED_WIDTH};
+    uint32_t fullBytes = OLED_PAGES * OledFramebuffer::i2cBytes(page);
+    double usPerByte = 9.0 * 1e6 / OLED_I2C_CLOCK;         // 8 bit + ACK
+    
+    printf("\nScreen sequence, I2C at %d kHz (full frame = %u bytes, %.0f us)\n\n",
+           OLED_I2C_CLOCK / 1000, fullBytes, fullBytes * usPerByte);
+    printf("%-11s %6s %10s %9s %9s\n", "screen", "spans", "i2c bytes", "wire us", "vs full");
+    
+    OledFramebuffer frame;
+    flush(frame);
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        render(frame, screens[i].line1, screens[i].line2);
+        if (dumpScreens) {
+            printf("%s:\n", screens[i].name);
+            dump(frame);
+        }
+        uint32_t spans = 0;
+        uint32_t bytes = flush(frame, &spans);
+        totalBytes += bytes;
+        printf("%-11s %6u %10u %9.0f %8.0f%%\n", screens[i].name, spans, bytes, bytes * usPerByte,
+               100.0 * bytes / fullBytes);
+    }
+    printf("%-11s %6s %10llu %9.0f %8.0f%%\n", "total", "", (unsigned long long)totalBytes,
+           totalBytes * usPerByte, 100.0 * totalBytes / (fullBytes * count));
+    
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sink = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const Screen& screen = screens[i % count];
+        render(frame, screen.line1, screen.line2);
+        sink += flush(frame);
+    }
+    auto end = std::chrono::steady_clock::now();
+    printf("\nrender + diff: %.0f host ns/screen (checksum %llu)\n",
+           std::chrono::duration<double, std::nano>(end - start).count() / iterations,
+           (unsigned long long)sink);
+    
+    printf("\n%s (%d failure(s))\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
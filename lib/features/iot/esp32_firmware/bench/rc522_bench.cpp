@@ -0,0 +1,342 @@
+// So sánh Rc522Driver với đường đi hiện tại của thư viện MFRC522
+// (PICC_IsNewCardPresent + PICC_ReadCardSerial) trên cùng một thiết bị giả:
+// transcript SPI đã ghi trong fixtures/rc522/. Mỗi kịch bản đo số frame (số lần
+// kéo CS), số byte, thời gian trên dây ở clock SPI tương ứng và thời gian CPU
+// trên máy host. Trước đó chạy kiểm tra chức năng với chip RC522 giả lập.
+//
+//   rc522_bench [iterations] [--record]
+//
+// --record: ghi lại transcript từ chip giả lập vào fixtures/rc522/ (sau khi
+// sửa driver có chủ đích làm thay đổi chuỗi frame).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "config.h"
+#include "rc522_driver.h"
+#include "emulated_rc522.h"
+#include "mfrc522_reference.h"
+#include "spi_transcript.h"
+
+// Clock SPI của thư viện MFRC522 (MFRC522_SPICLOCK)
+#define LIBRARY_SPI_CLOCK_HZ 4000000
+
+static const uint8_t uid4[4] = {0x04, 0xA1, 0xB2, 0xC3};
+static const uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+static const uint8_t defaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// Chạy service() tới khi có kết quả, đếm số frame lớn nhất trong một lần gọi
+template <typename Bus>
+static Rc522Poll detect(Rc522Driver& driver, Bus* counter = nullptr, uint64_t* maxFrames = nullptr) {
+    Rc522Poll result;
+    for (int i = 0; i < 64; i++) {
+        uint64_t before = counter != nullptr ? counter->frameCount : 0;
+        result = driver.service();
+        if (counter != nullptr && counter->frameCount - before > *maxFrames) {
+            *maxFrames = counter->frameCount - before;
+        }
+        if (result != RC522_BUSY) {
+            return result;
+        }
+    }
+    return RC522_BUSY;
+}
+
+static Rc522Poll detect(Rc522Driver& driver) {
+    return detect<ReplayBus>(driver);
+}
+
+// ============================================
+// Kiểm tra chức năng trên chip giả lập
+// ============================================
+
+static void checkCrc() {
+    printf("CRC_A\n");
+    // ISO/IEC 14443-3 Annex B và khung HLTA quen thuộc "50 00 57 CD"
+    const uint8_t zero[2] = {0x00, 0x00};
+    const uint8_t sample[2] = {0x12, 0x34};
+    const uint8_t hlta[2] = {0x50, 0x00};
+    uint8_t crc[2];
+    Rc522Driver::crcA(zero, 2, crc);
+    expect(crc[0] == 0xA0 && crc[1] == 0x1E, "CRC_A(00 00) = A0 1E");
+    Rc522Driver::crcA(sample, 2, crc);
+    expect(crc[0] == 0x26 && crc[1] == 0xCF, "CRC_A(12 34) = 26 CF");
+    Rc522Driver::crcA(hlta, 2, crc);
+    expect(crc[0] == 0x57 && crc[1] == 0xCD, "CRC_A(50 00) = 57 CD");
+}
+
+static void checkDriver() {
+    printf("Rc522Driver on emulated RC522\n");
+    EmulatedRc522 chip;
+    Rc522Driver driver(chip);
+    expect(driver.init() == EmulatedRc522::VERSION, "init returns VersionReg");
+    
+    expect(detect<ReplayBus>(driver) == RC522_NO_CARD, "no card -> NO_CARD");
+    
+    EmulatedPicc classic(PICC_KIND_MIFARE_CLASSIC, uid4, sizeof(uid4));
+    chip.setCard(&classic);
+    uint8_t length = 0;
+    bool found = detect(driver) == RC522_CARD;
+    const uint8_t* uid = driver.uid(length);
+    expect(found && length == 4 && memcmp(uid, uid4, 4) == 0 && driver.getSak() == 0x08,
+           "4-byte UID selected, SAK 0x08");
+    expect(driver.kind() == PICC_KIND_MIFARE_CLASSIC, "kind = MIFARE Classic");
+    
+    uint8_t block[16];
+    for (int i = 0; i < 16; i++) {
+        block[i] = (uint8_t)(i * 7);
+    }
+    uint8_t readBack[16] = {};
+    expect(!driver.read16(4, readBack), "read before auth rejected");
+    expect(driver.authenticate(4, defaultKey), "authenticate sector 1 (Key A)");
+    expect(driver.writeBlock(5, block) && driver.read16(5, readBack) && memcmp(block, readBack, 16) == 0,
+           "writeBlock + read16 round trip");
+    expect(!driver.writeBlock(7, block), "sector trailer write rejected");
+    
+    driver.halt();
+    expect(detect(driver) == RC522_NO_CARD, "halt completes in service()");
+    expect(detect(driver) == RC522_NO_CARD, "halted card ignores REQA");
+    
+    EmulatedPicc ntag(PICC_KIND_NTAG, uid7, sizeof(uid7));
+    chip.setCard(&ntag);
+    found = detect(driver) == RC522_CARD;
+    uid = driver.uid(length);
+    expect(found && length == 7 && memcmp(uid, uid7, 7) == 0 && driver.getSak() == 0x00,
+           "7-byte UID (2 cascade levels), SAK 0x00");
+    const uint8_t page[4] = {'L', 'B', 1, 0};
+    expect(driver.writePage(4, page) && driver.read16(4, readBack) && memcmp(page, readBack, 4) == 0,
+           "writePage + read16 round trip");
+    expect(!driver.writePage(2, page), "lock page write rejected");
+    
+    EmulatedRc522 referenceChip(&ntag);
+    ReferenceMfrc522 reference(referenceChip);
+    expect(reference.isNewCardPresent() && reference.readCardSerial() &&
+           reference.uidSize == 7 && memcmp(reference.uid, uid7, 7) == 0,
+           "reference MFRC522 path reads the same UID");
+}
+
+// Nhiều nhãn trong trường cùng lúc (kiểm kê): UID chung tiền tố để va chạm rơi vào
+// nhiều byte khác nhau, trộn UID 4 và 7 byte (ATQA cũng va chạm)
+static void checkCollisions() {
+    printf("Anticollision with several tags in the field\n");
+    static const uint8_t uids[][7] = {
+        {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66},
+        {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x67},
+        {0x04, 0x11, 0x22, 0xB3, 0x44, 0x55, 0x66},
+        {0x04, 0x91, 0x22, 0x33, 0x00, 0x00, 0x01},
+        {0x04, 0xA1, 0xB2, 0xC3},
+        {0x04, 0xA1, 0xB2, 0x43},
+    };
+    static const uint8_t lengths[] = {7, 7, 7, 7, 4, 4};
+    const int count = sizeof(lengths);
+    
+    EmulatedRc522 chip;
+    Rc522Driver driver(chip);
+    driver.init();
+    EmulatedPicc* tags[count];
+    for (int i = 0; i < count; i++) {
+        tags[i] = new EmulatedPicc(lengths[i] == 4 ? PICC_KIND_MIFARE_CLASSIC : PICC_KIND_NTAG, uids[i], lengths[i]);
+        chip.addCard(tags[i]);
+    }
+    
+    // Chọn một thẻ, HLTA, lặp lại tới khi trường im lặng
+    bool seen[count] = {};
+    int found = 0;
+    int duplicates = 0;
+    int unknown = 0;
+    for (int round = 0; round < count * 2; round++) {
+        Rc522Poll result = detect(driver);
+        if (result == RC522_NO_CARD) {
+            break;
+        }
+        if (result != RC522_CARD) {
+            continue;
+        }
+        uint8_t length = 0;
+        const uint8_t* uid = driver.uid(length);
+        int match = -1;
+        for (int i = 0; i < count; i++) {
+            if (length == lengths[i] && memcmp(uid, uids[i], length) == 0) {
+                match = i;
+            }
+        }
+        if (match < 0) {
+            unknown++;
+        } else if (seen[match]) {
+            duplicates++;
+        } else {
+            seen[match] = true;
+            found++;
+        }
+        driver.halt();
+        detect(driver);
+    }
+    expect(found == count && duplicates == 0 && unknown == 0, "every tag selected exactly once");
+    expect(driver.getCollisionCount() >= (uint32_t)count - 1, "collisions resolved bit by bit");
+    expect(detect(driver) == RC522_NO_CARD, "halted tags stay silent");
+    for (int i = 0; i < count; i++) {
+        delete tags[i];
+    }
+}
+
+// ============================================
+// Benchmark trên transcript
+// ============================================
+
+struct Scenario {
+    const char* name;
+    PiccKind kind;
+    const uint8_t* uid;
+    uint8_t uidLength;
+    bool present;              // false = đầu đọc trống
+};
+
+struct PathResult {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t maxFramesPerCall;
+    double wireUs;
+    double cpuNs;
+    bool ok;
+};
+
+static std::string transcriptPath(const Scenario& scenario, const char* path) {
+    return std::string(BENCH_FIXTURES_DIR) + "/rc522/" + scenario.name + "_" + path + ".spi";
+}
+
+// Ghi transcript từ chip giả lập, so với fixture (hoặc ghi đè khi --record)
+static bool prepareTranscript(const Scenario& scenario, const char* path, bool record,
+                              SpiTranscript& transcript) {
+    EmulatedPicc card(scenario.kind, scenario.uid, scenario.uidLength);
+    EmulatedRc522 chip(scenario.present ? &card : nullptr);
+    RecordingBus recorder(chip);
+    
+    if (strcmp(path, "driver") == 0) {
+        Rc522Driver driver(recorder);
+        detect<ReplayBus>(driver);
+    } else {
+        ReferenceMfrc522 reference(recorder);
+        if (reference.isNewCardPresent()) {
+            reference.readCardSerial();
+        }
+    }
+    
+    std::string file = transcriptPath(scenario, path);
+    if (record) {
+        char comment[128];
+        snprintf(comment, sizeof(comment), "%s: %s, recorded from bench/emulated_rc522.h", scenario.name, path);
+        transcript = recorder.transcript;
+        return saveTranscript(file, transcript, comment);
+    }
+    
+    if (!loadTranscript(file, transcript)) {
+        fprintf(stderr, "Cannot load %s (run with --record)\n", file.c_str());
+        return false;
+    }
+    if (!(transcript == recorder.transcript)) {
+        fprintf(stderr, "%s: SPI sequence changed, re-record if intended\n", file.c_str());
+        return false;
+    }
+    return true;
+}
+
+static PathResult runPath(const Scenario& scenario, const char* path, const SpiTranscript& transcript,
+                          size_t iterations) {
+    PathResult r = {};
+    ReplayBus device(transcript);
+    bool driverPath = strcmp(path, "driver") == 0;
+    Rc522Driver driver(device);
+    ReferenceMfrc522 reference(device);
+    bool expectCard = scenario.present;
+    
+    auto runOnce = [&]() -> bool {
+        device.rewind();
+        if (driverPath) {
+            return (detect(driver, &device, &r.maxFramesPerCall) == RC522_CARD) == expectCard;
+        }
+        return (reference.isNewCardPresent() && reference.readCardSerial()) == expectCard;
+    };
+    
+    // Lần đầu: kiểm tra kết quả + đếm frame/byte
+    r.ok = runOnce() && device.finished() && device.mismatches == 0;
+    r.frames = device.frameCount;
+    r.bytes = device.byteCount;
+    uint32_t clock = driverPath ? RFID_SPI_CLOCK_HZ : LIBRARY_SPI_CLOCK_HZ;
+    r.wireUs = r.bytes * 8.0 * 1e6 / clock;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        runOnce();
+    }
+    auto end = std::chrono::steady_clock::now();
+    r.cpuNs = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    r.ok = r.ok && device.mismatches == 0;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = 100000;
+    bool record = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            record = true;
+        } else {
+            iterations = strtoul(argv[i], nullptr, 10);
+        }
+    }
+    
+    checkCrc();
+    checkDriver();
+    checkCollisions();
+    
+    const Scenario scenarios[] = {
+        {"idle", PICC_KIND_MIFARE_CLASSIC, uid4, sizeof(uid4), false},
+        {"classic_uid4", PICC_KIND_MIFARE_CLASSIC, uid4, sizeof(uid4), true},
+        {"ntag_uid7", PICC_KIND_NTAG, uid7, sizeof(uid7), true},
+    };
+    const char* paths[] = {"mfrc522", "driver"};
+    
+    printf("\nDetect + select on recorded SPI transcript, %zu iterations\n", iterations);
+    printf("(wire time at %d MHz for mfrc522, %d MHz for driver; RF time not included)\n\n",
+           LIBRARY_SPI_CLOCK_HZ / 1000000, RFID_SPI_CLOCK_HZ / 1000000);
+    printf("%-14s %-8s %7s %7s %9s %12s %15s\n", "scenario", "path", "frames", "bytes", "wire us",
+           "host ns/op", "frames/service");
+    
+    for (const Scenario& scenario : scenarios) {
+        for (const char* path : paths) {
+            SpiTranscript transcript;
+            if (!prepareTranscript(scenario, path, record, transcript)) {
+                failures++;
+                continue;
+            }
+            PathResult r = runPath(scenario, path, transcript, iterations);
+            char perCall[24] = "-";
+            if (r.maxFramesPerCall > 0) {
+                snprintf(perCall, sizeof(perCall), "%llu", (unsigned long long)r.maxFramesPerCall);
+            }
+            printf("%-14s %-8s %7llu %7llu %9.1f %12.1f %15s %s\n", scenario.name, path,
+                   (unsigned long long)r.frames, (unsigned long long)r.bytes, r.wireUs, r.cpuNs, perCall,
+                   r.ok ? "" : "FAIL");
+            if (!r.ok) {
+                failures++;
+            }
+        }
+    }
+    
+    // Thư viện chờ trong vòng lặp đọc ComIrqReg suốt thời gian thẻ trả lời (tới 25 ms
+    // khi không có thẻ); driver chỉ xếp frame rồi trả về, mỗi lần service() tối đa
+    // frames/service frame.
+    printf("\n%s (%d failure(s))\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
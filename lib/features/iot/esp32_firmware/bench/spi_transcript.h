@@ -0,0 +1,153 @@
+// Transcript SPI của RC522: ghi lại mọi frame (tx + rx) đi qua một Rc522Bus,
+// lưu ra file và phát lại làm thiết bị giả. Khi phát lại, tx của driver phải
+// khớp từng byte với transcript; rx lấy từ transcript.
+//
+// File dạng text, mỗi dòng một frame: "<tx hex> <rx hex>", dòng '#' là chú thích.
+// Có thể thay bằng transcript bắt từ logic analyzer trên đầu đọc thật.
+#ifndef SPI_TRANSCRIPT_H
+#define SPI_TRANSCRIPT_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "rc522_bus.h"
+
+struct SpiTranscriptFrame {
+    std::vector<uint8_t> tx;
+    std::vector<uint8_t> rx;
+    
+    bool operator==(const SpiTranscriptFrame& other) const { return tx == other.tx && rx == other.rx; }
+};
+
+typedef std::vector<SpiTranscriptFrame> SpiTranscript;
+
+// Ghi lại frame đi tới thiết bị thật/giả lập
+class RecordingBus : public Rc522Bus {
+public:
+    explicit RecordingBus(Rc522Bus& device) : device(device) {}
+    
+    bool submit(const Rc522Frame* frames, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t scratch[96];
+            uint8_t* rx = frames[i].rx != nullptr ? frames[i].rx : scratch;
+            Rc522Frame frame = {frames[i].tx, rx, frames[i].length};
+            device.submit(&frame, 1);
+            device.done();
+    
+            SpiTranscriptFrame record;
+            record.tx.assign(frames[i].tx, frames[i].tx + frames[i].length);
+            record.rx.assign(rx, rx + frames[i].length);
+            transcript.push_back(record);
+        }
+        return true;
+    }
+    
+    bool done() override { return true; }
+    
+    SpiTranscript transcript;
+    
+private:
+    Rc522Bus& device;
+};
+
+// Phát lại transcript làm thiết bị giả
+class ReplayBus : public Rc522Bus {
+public:
+    explicit ReplayBus(const SpiTranscript& transcript)
+        : transcript(transcript), position(0), mismatches(0), frameCount(0), byteCount(0) {}
+    
+    bool submit(const Rc522Frame* frames, uint8_t count) override {
+        for (uint8_t i = 0; i < count; i++) {
+            const Rc522Frame& frame = frames[i];
+            frameCount++;
+            byteCount += frame.length;
+            if (position >= transcript.size()) {
+                mismatches++;
+                continue;
+            }
+            const SpiTranscriptFrame& expected = transcript[position++];
+            if (expected.tx.size() != frame.length ||
+                memcmp(expected.tx.data(), frame.tx, frame.length) != 0) {
+                mismatches++;
+                continue;
+            }
+            if (frame.rx != nullptr) {
+                memcpy(frame.rx, expected.rx.data(), frame.length);
+            }
+        }
+        return true;
+    }
+    
+    bool done() override { return true; }
+    
+    void rewind() { position = 0; }
+    bool finished() const { return position == transcript.size(); }
+    
+    const SpiTranscript& transcript;
+    size_t position;
+    size_t mismatches;
+    uint64_t frameCount;
+    uint64_t byteCount;
+};
+
+inline bool saveTranscript(const std::string& path, const SpiTranscript& transcript, const char* comment) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "# %s\n", comment);
+    for (const SpiTranscriptFrame& frame : transcript) {
+        for (uint8_t b : frame.tx) {
+            fprintf(file, "%02x", b);
+        }
+        fputc(' ', file);
+        for (uint8_t b : frame.rx) {
+            fprintf(file, "%02x", b);
+        }
+        fputc('\n', file);
+    }
+    fclose(file);
+    return true;
+}
+
+inline bool parseHex(const char* text, size_t length, std::vector<uint8_t>& output) {
+    if (length % 2 != 0) {
+        return false;
+    }
+    output.clear();
+    for (size_t i = 0; i < length; i += 2) {
+        unsigned value;
+        if (sscanf(text + i, "%2x", &value) != 1) {
+            return false;
+        }
+        output.push_back((uint8_t)value);
+    }
+    return true;
+}
+
+inline bool loadTranscript(const std::string& path, SpiTranscript& transcript) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+    transcript.clear();
+    char line[512];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != nullptr) {
+        size_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        char* space = strchr(line, ' ');
+        SpiTranscriptFrame frame;
+        ok = space != nullptr && parseHex(line, space - line, frame.tx) &&
+             parseHex(space + 1, strlen(space + 1), frame.rx) && frame.tx.size() == frame.rx.size();
+        transcript.push_back(frame);
+    }
+    fclose(file);
+    return ok;
+}
+
+#endif // SPI_TRANSCRIPT_H
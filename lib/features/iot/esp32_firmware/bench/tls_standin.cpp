@@ -0,0 +1,740 @@
+// Server HTTPS giả cho trạm (OpenSSL): trả response mẫu trong fixtures/ cho ba API
+// của trạm và API batch, giữ kết nối keep-alive và hỗ trợ resume bằng session ticket lẫn
+// session ID như backend thật sau reverse proxy. Cùng cipher suite AES-GCM mà
+// TlsClient của trạm bật, TLS 1.2 như mbedTLS trên ESP32.
+//
+//   tls_standin [port] [--host <IP trạm gọi tới>] [--no-tickets]
+//   tls_standin --bench [connections]
+//
+// Chế độ server in chứng chỉ tự ký dạng chuỗi C để dán vào API_TLS_CA_CERT (CN =
+// --host, vì mbedTLS so tên máy trong API_BASE_URL với CN), rồi ghi log mỗi kết
+// nối: full/resumed, cipher, số request phục vụ trên kết nối đó, cùng trace ID của
+// mỗi request (header traceparent). Response có header Server-Timing như backend thật.
+// --bench chạy server trong tiến trình và đo handshake đầy đủ so với resume
+// (ticket, session ID) qua loopback, kèm kiểm tra keep-alive và nội dung response.
+//
+// Giả lập server quá tải (chế độ server):
+//   --capacity <req/s>   vượt quá thì trả 429 kèm Retry-After (token bucket, burst = 1/5 giây)
+//   --fail <phần trăm>   trả 503 kèm Retry-After ngẫu nhiên
+//   --retry-after <s>    giá trị Retry-After (mặc định 1)
+//   --latency <ms>       thời gian xử lý thêm cho mỗi request
+// --overload [stations] cho nhiều trạm giả cùng xả hàng đợi gửi lại vào server giới hạn
+// capacity, so sánh gửi lại cố định (trước) với Backpressure của trạm (src/backpressure.cpp).
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "config.h"
+#include "backpressure.h"
+
+// Cùng danh sách với HARDWARE_CIPHERSUITES trong src/tls_client.cpp
+static const char* CIPHERS =
+    "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES256-GCM-SHA384";
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        out.append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+// ============================================
+// Server
+// ============================================
+
+// Lỗi giả lập của server: giới hạn số request mỗi giây, 503 ngẫu nhiên, xử lý chậm
+struct Faults {
+    double capacity = 0;               // req/s, 0 = không giới hạn
+    int failPercent = 0;
+    int retryAfter = 1;                // giây
+    int latencyMs = 0;
+    
+    std::mutex lock;
+    double tokens = 0;
+    std::chrono::steady_clock::time_point refilledAt = std::chrono::steady_clock::now();
+    std::mt19937 rng{42};
+    std::atomic<int> rejected{0};
+    
+    // 0 = xử lý request, hoặc mã 429/503 trả về ngay
+    int admit() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (failPercent > 0 && (int)(rng() % 100) < failPercent) {
+            rejected++;
+            return HTTP_STATUS_SERVICE_UNAVAILABLE;
+        }
+        if (capacity <= 0) {
+            return 0;
+        }
+        auto now = std::chrono::steady_clock::now();
+        double burst = std::max(1.0, capacity / 5);
+        tokens = std::min(burst, tokens + std::chrono::duration<double>(now - refilledAt).count() * capacity);
+        refilledAt = now;
+        if (tokens < 1) {
+            rejected++;
+            return HTTP_STATUS_TOO_MANY_REQUESTS;
+        }
+        tokens -= 1;
+        return 0;
+    }
+};
+
+struct Standin {
+    SSL_CTX* ctx;
+    X509* cert;
+    std::string studentJson;
+    std::string bookJson;
+    Faults* faults;
+};
+
+static X509* selfSignedCertificate(EVP_PKEY* key, const char* commonName) {
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+    X509_set_pubkey(cert, key);
+    
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)commonName, -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    
+    // CA:TRUE để trạm dùng chính chứng chỉ này làm CA tin cậy
+    X509V3_CTX v3;
+    X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &v3, NID_basic_constraints, "critical,CA:TRUE");
+    X509_add_ext(cert, ext, -1);
+    X509_EXTENSION_free(ext);
+    
+    X509_sign(cert, key, EVP_sha256());
+    return cert;
+}
+
+static bool createStandin(Standin& standin, const char* commonName, bool tickets, Faults* faults) {
+    standin.faults = faults;
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    if (keyCtx == nullptr || EVP_PKEY_keygen_init(keyCtx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(keyCtx, 2048) <= 0 || EVP_PKEY_keygen(keyCtx, &key) <= 0) {
+        EVP_PKEY_CTX_free(keyCtx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(keyCtx);
+    standin.cert = selfSignedCertificate(key, commonName);
+    
+    standin.ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_set_min_proto_version(standin.ctx, TLS1_2_VERSION);
+    SSL_CTX_set_max_proto_version(standin.ctx, TLS1_2_VERSION);
+    SSL_CTX_set_cipher_list(standin.ctx, CIPHERS);
+    SSL_CTX_use_certificate(standin.ctx, standin.cert);
+    SSL_CTX_use_PrivateKey(standin.ctx, key);
+    EVP_PKEY_free(key);
+    
+    // Resume bằng session ID cần cache phía server; ticket thì không
+    static const unsigned char sessionContext[] = "station-standin";
+    SSL_CTX_set_session_id_context(standin.ctx, sessionContext, sizeof(sessionContext) - 1);
+    SSL_CTX_set_session_cache_mode(standin.ctx, SSL_SESS_CACHE_SERVER);
+    if (!tickets) {
+        SSL_CTX_set_options(standin.ctx, SSL_OP_NO_TICKET);
+    }
+    
+    std::string dir = BENCH_FIXTURES_DIR;
+    return readFile(dir + "/student_with_loans.json", standin.studentJson) &&
+           readFile(dir + "/book_ok.json", standin.bookJson);
+}
+
+static const std::string& routeBody(const Standin& standin, const std::string& path) {
+    static const std::string heartbeat = "{\"success\":true}";
+    static const std::string notFound = "{\"success\":false,\"message\":\"Not found\"}";
+    if (path == API_SCAN_STUDENT) {
+        return standin.studentJson;
+    }
+    if (path == API_SCAN_BOOK) {
+        return standin.bookJson;
+    }
+    return path == API_HEARTBEAT || path == API_INVENTORY_BATCH ? heartbeat : notFound;
+}
+
+// Response của API_SCAN_BATCH: một kết quả mẫu cho mỗi phần tử "scans", đúng thứ tự
+static std::string batchBody(const Standin& standin, const std::string& request) {
+    std::string body = "{\"success\":true,\"results\":[";
+    size_t pos = 0;
+    int count = 0;
+    while ((pos = request.find("\"type\":\"", pos)) != std::string::npos) {
+        pos += 8;
+        body += count++ ? "," : "";
+        body += request.compare(pos, 12, "book_barcode") == 0 ? standin.bookJson : standin.studentJson;
+    }
+    return body + "]}";
+}
+
+// Đọc một request HTTP/1.1 (header + body theo Content-Length), trả về đường dẫn,
+// body và trace ID trong header traceparent (rỗng nếu không có)
+static bool readRequest(SSL* ssl, std::string& pending, std::string& path, std::string& body,
+                        std::string& traceId) {
+    size_t headerEnd;
+    char buf[2048];
+    while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) {
+            return false;
+        }
+        pending.append(buf, n);
+    }
+    
+    size_t lengthPos = pending.find("Content-Length:");
+    size_t bodyLength = 0;
+    if (lengthPos != std::string::npos && lengthPos < headerEnd) {
+        bodyLength = strtoul(pending.c_str() + lengthPos + 15, nullptr, 10);
+    }
+    while (pending.size() < headerEnd + 4 + bodyLength) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) {
+            return false;
+        }
+        pending.append(buf, n);
+    }
+    
+    size_t pathStart = pending.find(' ') + 1;
+    path = pending.substr(pathStart, pending.find(' ', pathStart) - pathStart);
+    
+    // traceparent: 00-<32 hex trace ID>-<16 hex span ID>-01
+    traceId.clear();
+    size_t tracePos = pending.find("traceparent: 00-");
+    if (tracePos != std::string::npos && tracePos < headerEnd) {
+        traceId = pending.substr(tracePos + 16, 32);
+    }
+    body = pending.substr(headerEnd + 4, bodyLength);
+    pending.erase(0, headerEnd + 4 + bodyLength);
+    return true;
+}
+
+static void serveConnection(const Standin* standin, int fd, bool verbose) {
+    // Giống keepAliveTimeout mặc định của Node: kết nối rảnh 5 s thì đóng
+    struct timeval idle = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+    
+    SSL* ssl = SSL_new(standin->ctx);
+    SSL_set_fd(ssl, fd);
+    auto start = std::chrono::steady_clock::now();
+    if (SSL_accept(ssl) <= 0) {
+        if (verbose) {
+            printf("[standin] handshake failed: %s\n", ERR_reason_error_string(ERR_get_error()));
+        }
+        SSL_free(ssl);
+        close(fd);
+        return;
+    }
+    double handshakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    std::string pending;
+    std::string path;
+    std::string requestBody;
+    std::string traceId;
+    int requests = 0;
+    while (readRequest(ssl, pending, path, requestBody, traceId)) {
+        auto handleStart = std::chrono::steady_clock::now();
+        std::string response;
+        int status = standin->faults->admit();
+        if (status != 0) {
+            // Quá tải: từ chối ngay, không tốn thời gian xử lý
+            std::string body = "{\"success\":false,\"message\":\"Server overloaded\"}";
+            response = "HTTP/1.1 " + std::to_string(status) +
+                       (status == HTTP_STATUS_TOO_MANY_REQUESTS ? " Too Many Requests" : " Service Unavailable") +
+                       "\r\nContent-Type: application/json\r\nConnection: keep-alive\r\nRetry-After: " +
+                       std::to_string(standin->faults->retryAfter) + "\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\n\r\n" + body;
+        } else {
+            if (standin->faults->latencyMs > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(standin->faults->latencyMs));
+            }
+            std::string body = path == API_SCAN_BATCH ? batchBody(*standin, requestBody) : routeBody(*standin, path);
+            double handleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - handleStart).count();
+            char timing[48];
+            snprintf(timing, sizeof(timing), "Server-Timing: total;dur=%.1f\r\n", handleMs);
+            response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                       "Connection: keep-alive\r\n" + std::string(timing) + "Content-Length: " +
+                       std::to_string(body.size()) + "\r\n\r\n" + body;
+        }
+        if (SSL_write(ssl, response.data(), (int)response.size()) <= 0) {
+            break;
+        }
+        requests++;
+        if (verbose) {
+            printf("[standin]   POST %s trace=%s%s\n", path.c_str(), traceId.empty() ? "-" : traceId.c_str(),
+                   status != 0 ? (status == HTTP_STATUS_TOO_MANY_REQUESTS ? " -> 429" : " -> 503") : "");
+        }
+    }
+    
+    if (verbose) {
+        printf("[standin] %s handshake %.1f ms (%s), %d request(s) on this connection\n",
+               SSL_session_reused(ssl) ? "resumed" : "full", handshakeMs, SSL_get_cipher(ssl), requests);
+    }
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+}
+
+static int listenOn(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void acceptLoop(const Standin* standin, int listenFd, bool verbose) {
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        std::thread(serveConnection, standin, fd, verbose).detach();
+    }
+}
+
+// In chứng chỉ dạng chuỗi C để dán vào API_TLS_CA_CERT
+static void printCertificate(X509* cert) {
+    BIO* bio = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(bio, cert);
+    char* data;
+    long length = BIO_get_mem_data(bio, &data);
+    std::string pem(data, length);
+    BIO_free(bio);
+    
+    printf("#define API_TLS_CA_CERT \\\n");
+    size_t start = 0;
+    while (start < pem.size()) {
+        size_t end = pem.find('\n', start);
+        printf("    \"%s\\n\"%s\n", pem.substr(start, end - start).c_str(), end + 1 < pem.size() ? " \\" : "");
+        start = end + 1;
+    }
+}
+
+// ============================================
+// Bench (client OpenSSL qua loopback)
+// ============================================
+
+struct HandshakeResult {
+    bool ok;
+    bool resumed;
+    double ms;
+    int requests;                      // Request thành công trên cùng kết nối
+    std::string body;                  // Body của request đầu tiên
+    SSL_SESSION* session;
+};
+
+// Body của response, rỗng nếu mất kết nối. status/retryAfterMs (nếu có): mã HTTP và Retry-After
+static std::string post(SSL* ssl, const char* path, int* status = nullptr, uint32_t* retryAfterMs = nullptr) {
+    std::string request = std::string("POST ") + path + " HTTP/1.1\r\nHost: standin\r\n"
+                          "Content-Type: application/json\r\nConnection: keep-alive\r\n"
+                          "Content-Length: 2\r\n\r\n{}";
+    if (SSL_write(ssl, request.data(), (int)request.size()) <= 0) {
+        return "";
+    }
+    
+    std::string response;
+    char buf[4096];
+    size_t headerEnd = std::string::npos;
+    size_t bodyLength = 0;
+    while (headerEnd == std::string::npos || response.size() < headerEnd + 4 + bodyLength) {
+        int n = SSL_read(ssl, buf, sizeof(buf));
+        if (n <= 0) {
+            return "";
+        }
+        response.append(buf, n);
+        if (headerEnd == std::string::npos && (headerEnd = response.find("\r\n\r\n")) != std::string::npos) {
+            bodyLength = strtoul(response.c_str() + response.find("Content-Length:") + 15, nullptr, 10);
+        }
+    }
+    if (status != nullptr) {
+        *status = atoi(response.c_str() + 9);    // "HTTP/1.1 200 OK"
+    }
+    if (retryAfterMs != nullptr) {
+        size_t retryPos = response.find("Retry-After:");
+        *retryAfterMs = retryPos < headerEnd ? Backpressure::parseRetryAfter(response.c_str() + retryPos + 12, 0) : 0;
+    }
+    return response.substr(headerEnd + 4, bodyLength);
+}
+
+static int connectLoopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static HandshakeResult connectOnce(SSL_CTX* ctx, uint16_t port, SSL_SESSION* session, int requests) {
+    HandshakeResult result = {false, false, 0, 0, "", nullptr};
+    int fd = connectLoopback(port);
+    if (fd < 0) {
+        return result;
+    }
+    
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (session != nullptr) {
+        SSL_set_session(ssl, session);
+    }
+    auto start = std::chrono::steady_clock::now();
+    result.ok = SSL_connect(ssl) == 1;
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    if (result.ok) {
+        result.resumed = SSL_session_reused(ssl);
+        for (int i = 0; i < requests; i++) {
+            std::string body = post(ssl, i % 2 == 0 ? API_SCAN_STUDENT : API_HEARTBEAT);
+            if (body.empty()) {
+                break;
+            }
+            if (i == 0) {
+                result.body = body;
+            }
+            result.requests++;
+        }
+        result.session = SSL_get1_session(ssl);
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    close(fd);
+    return result;
+}
+
+static SSL_CTX* benchClient(bool tickets) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_cipher_list(ctx, CIPHERS);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+    if (!tickets) {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+    return ctx;
+}
+
+// Kết nối lặp lại; resume = dùng session của kết nối trước như TlsClient trên trạm
+static void measure(const char* label, SSL_CTX* ctx, uint16_t port, bool resume, int connections,
+                    double& avgMs, int& resumedCount) {
+    SSL_SESSION* session = nullptr;
+    double total = 0;
+    int measured = 0;
+    resumedCount = 0;
+    
+    for (int i = 0; i < connections + 1; i++) {
+        HandshakeResult r = connectOnce(ctx, port, resume ? session : nullptr, 1);
+        if (session != nullptr) {
+            SSL_SESSION_free(session);
+        }
+        session = r.session;
+        // Kết nối đầu của chế độ resume là handshake đầy đủ để lấy session
+        if (i > 0 || !resume) {
+            total += r.ms;
+            measured++;
+            resumedCount += r.resumed ? 1 : 0;
+        }
+    }
+    if (session != nullptr) {
+        SSL_SESSION_free(session);
+    }
+    avgMs = measured > 0 ? total / measured : 0;
+    printf("%-24s %8d %12.3f %9d\n", label, measured, avgMs, resumedCount);
+}
+
+// Server chạy trong tiến trình trên cổng ngẫu nhiên, trả về cổng
+static uint16_t startInProcess(const Standin* standin) {
+    int listenFd = listenOn(0);
+    sockaddr_in bound = {};
+    socklen_t boundLength = sizeof(bound);
+    getsockname(listenFd, (sockaddr*)&bound, &boundLength);
+    std::thread(acceptLoop, standin, listenFd, false).detach();
+    return ntohs(bound.sin_port);
+}
+
+static int runBench(int connections) {
+    Standin standin;
+    Faults faults;
+    if (!createStandin(standin, "localhost", true, &faults)) {
+        fprintf(stderr, "Cannot create stand-in (fixtures in %s?)\n", BENCH_FIXTURES_DIR);
+        return 1;
+    }
+    uint16_t port = startInProcess(&standin);
+    
+    SSL_CTX* withTickets = benchClient(true);
+    SSL_CTX* withoutTickets = benchClient(false);
+    
+    printf("Stand-in server\n");
+    HandshakeResult first = connectOnce(withTickets, port, nullptr, 4);
+    expect(first.ok && !first.resumed, "first connection is a full handshake");
+    expect(first.requests == 4, "keep-alive serves 4 requests on one connection");
+    expect(first.body == standin.studentJson, "student endpoint returns fixture");
+    HandshakeResult again = connectOnce(withTickets, port, first.session, 1);
+    expect(again.ok && again.resumed, "session ticket resumes");
+    HandshakeResult noTicket = connectOnce(withoutTickets, port, nullptr, 1);
+    HandshakeResult byId = connectOnce(withoutTickets, port, noTicket.session, 1);
+    expect(byId.ok && byId.resumed, "session ID resumes (tickets disabled)");
+    for (SSL_SESSION* s : {first.session, again.session, noTicket.session, byId.session}) {
+        SSL_SESSION_free(s);
+    }
+    
+    printf("\nTLS 1.2 handshake over loopback, RSA-2048 server key (%s)\n\n", OpenSSL_version(OPENSSL_VERSION));
+    printf("%-24s %8s %12s %9s\n", "handshake", "count", "avg ms", "resumed");
+    double fullMs, ticketMs, idMs;
+    int resumed;
+    measure("full", withTickets, port, false, connections, fullMs, resumed);
+    measure("resumed (ticket)", withTickets, port, true, connections, ticketMs, resumed);
+    expect(resumed == connections, "every ticket reconnect resumed");
+    measure("resumed (session ID)", withoutTickets, port, true, connections, idMs, resumed);
+    expect(resumed == connections, "every session ID reconnect resumed");
+    printf("\nresumed/full: ticket %.1f%%, session ID %.1f%%\n", 100.0 * ticketMs / fullMs, 100.0 * idMs / fullMs);
+    
+    SSL_CTX_free(withTickets);
+    SSL_CTX_free(withoutTickets);
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
+
+// ============================================
+// Quá tải: nhiều trạm xả hàng đợi gửi lại cùng lúc
+// ============================================
+
+struct OverloadResult {
+    std::atomic<int> requests{0};
+    std::atomic<int> overloads{0};         // Response 429/503
+    std::atomic<int> delivered{0};
+    std::atomic<int> givenUp{0};           // Hết REQUEST_MAX_RETRIES lần gửi lại
+    double drainSeconds = 0;
+};
+
+struct SimScan {
+    uint8_t attempts;
+    uint32_t notBefore;                    // ms kể từ lúc bắt đầu
+};
+
+// Một trạm: một kết nối keep-alive, gửi lần lượt từng lần quét như task mạng.
+// controlled = false: gửi lại sau REQUEST_RETRY_DELAY * số lần, bỏ qua Retry-After (như trước);
+// true: Backpressure của trạm (Retry-After, giãn theo AIMD, gửi lại lũy thừa có jitter)
+static void simulateStation(SSL_CTX* ctx, uint16_t port, bool controlled, int scans, uint32_t seed,
+                            std::chrono::steady_clock::time_point start, OverloadResult* result) {
+    auto elapsedMs = [start] {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    };
+    std::mt19937 rng(seed);
+    Backpressure backpressure;
+    std::deque<SimScan> queue(scans, SimScan{0, 0});
+    SSL* ssl = nullptr;
+    int fd = -1;
+    
+    while (!queue.empty()) {
+        SimScan scan = queue.front();
+        queue.pop_front();
+        uint32_t now = elapsedMs();
+        uint32_t wait = (int32_t)(scan.notBefore - now) > 0 ? scan.notBefore - now : 0;
+        if (controlled) {
+            wait = std::max(wait, backpressure.backgroundDelay(now));
+        }
+        if (wait > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+        }
+    
+        // Server đóng kết nối rảnh sau 5 s: kết nối lại rồi gửi tiếp lần quét này
+        int status = 0;
+        uint32_t retryAfterMs = 0;
+        uint32_t sentAt = elapsedMs();
+        for (int reconnect = 0; reconnect < 2 && status == 0; reconnect++) {
+            if (ssl == nullptr) {
+                fd = connectLoopback(port);
+                ssl = SSL_new(ctx);
+                SSL_set_fd(ssl, fd);
+                if (fd < 0 || SSL_connect(ssl) != 1) {
+                    break;
+                }
+            }
+            if (post(ssl, API_SCAN_STUDENT, &status, &retryAfterMs).empty()) {
+                status = 0;
+                SSL_free(ssl);
+                close(fd);
+                ssl = nullptr;
+            }
+        }
+        if (status == 0) {
+            result->givenUp += 1 + (int)queue.size();
+            break;
+        }
+        result->requests++;
+        now = elapsedMs();
+        if (controlled) {
+            backpressure.onResponse(status, retryAfterMs, now - sentAt, now, rng());
+        }
+        if (status == 200) {
+            result->delivered++;
+            continue;
+        }
+    
+        result->overloads++;
+        if (scan.attempts >= REQUEST_MAX_RETRIES) {
+            result->givenUp++;
+            continue;
+        }
+        scan.attempts++;
+        uint32_t delay = (uint32_t)REQUEST_RETRY_DELAY * scan.attempts;
+        if (controlled) {
+            delay = std::max(Backpressure::retryDelay(scan.attempts, rng()), backpressure.holdRemaining(now));
+        }
+        scan.notBefore = now + delay;
+        auto position = std::upper_bound(queue.begin(), queue.end(), scan,
+                                         [](const SimScan& a, const SimScan& b) { return a.notBefore < b.notBefore; });
+        queue.insert(position, scan);
+    }
+    if (ssl != nullptr) {
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        close(fd);
+    }
+}
+
+static void runPolicy(const char* label, SSL_CTX* ctx, uint16_t port, bool controlled, int stations, int scans,
+                      OverloadResult& result) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < stations; i++) {
+        threads.emplace_back(simulateStation, ctx, port, controlled, scans, (uint32_t)(i + 1), start, &result);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    result.drainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-22s %9d %9d %10d %9d %9.1f\n", label, result.requests.load(), result.overloads.load(),
+           result.delivered.load(), result.givenUp.load(), result.drainSeconds);
+}
+
+static int runOverload(int stations) {
+    const int scans = 15;                  // Lần quét mỗi trạm tích lại trong lúc mất kết nối
+    Standin standin;
+    Faults faults;
+    faults.capacity = 40;
+    faults.latencyMs = 50;                 // RTT gần với trạm thật qua WiFi
+    if (!createStandin(standin, "localhost", true, &faults)) {
+        fprintf(stderr, "Cannot create stand-in (fixtures in %s?)\n", BENCH_FIXTURES_DIR);
+        return 1;
+    }
+    uint16_t port = startInProcess(&standin);
+    SSL_CTX* ctx = benchClient(true);
+    
+    printf("%d stations x %d queued scans, server capacity %.0f req/s (429 + Retry-After: %d), %d ms per request\n\n",
+           stations, scans, faults.capacity, faults.retryAfter, faults.latencyMs);
+    printf("%-22s %9s %9s %10s %9s %9s\n", "retry policy", "requests", "429/503", "delivered", "given up", "drain s");
+    OverloadResult fixed, controlled;
+    runPolicy("fixed (before)", ctx, port, false, stations, scans, fixed);
+    // Server hồi phục giữa hai lượt
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    runPolicy("backpressure", ctx, port, true, stations, scans, controlled);
+    
+    printf("\n");
+    expect(controlled.overloads < fixed.overloads, "backpressure draws fewer 429/503 responses");
+    expect(controlled.givenUp <= fixed.givenUp, "backpressure gives up on no more scans");
+    expect(controlled.delivered + controlled.givenUp == stations * scans, "every scan delivered or given up");
+    SSL_CTX_free(ctx);
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return runBench(argc > 2 ? atoi(argv[2]) : 200);
+    }
+    if (argc > 1 && strcmp(argv[1], "--overload") == 0) {
+        return runOverload(argc > 2 ? atoi(argv[2]) : 16);
+    }
+    
+    uint16_t port = 3443;
+    const char* host = "localhost";
+    bool tickets = true;
+    Faults faults;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host = argv[++i];
+        } else if (strcmp(argv[i], "--no-tickets") == 0) {
+            tickets = false;
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            faults.capacity = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--fail") == 0 && i + 1 < argc) {
+            faults.failPercent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--retry-after") == 0 && i + 1 < argc) {
+            faults.retryAfter = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            faults.latencyMs = atoi(argv[++i]);
+        } else {
+            port = (uint16_t)atoi(argv[i]);
+        }
+    }
+    
+    Standin standin;
+    if (!createStandin(standin, host, tickets, &faults)) {
+        fprintf(stderr, "Cannot create stand-in (fixtures in %s?)\n", BENCH_FIXTURES_DIR);
+        return 1;
+    }
+    int listenFd = listenOn(port);
+    if (listenFd < 0) {
+        fprintf(stderr, "Cannot listen on port %d\n", port);
+        return 1;
+    }
+    
+    printf("// Dán vào config.h của trạm (API_BASE_URL \"https://%s:%d\"):\n", host, port);
+    printCertificate(standin.cert);
+    printf("\n[standin] listening on :%d, session tickets %s\n", port, tickets ? "on" : "off");
+    if (faults.capacity > 0 || faults.failPercent > 0 || faults.latencyMs > 0) {
+        printf("[standin] faults: capacity %.0f req/s, %d%% 503, Retry-After %d s, +%d ms\n", faults.capacity,
+               faults.failPercent, faults.retryAfter, faults.latencyMs);
+    }
+    fflush(stdout);
+    acceptLoop(&standin, listenFd, true);
+    return 0;
+}
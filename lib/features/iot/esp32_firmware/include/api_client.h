@@ -5,52 +5,118 @@
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include "config.h"
-
-// Struct để lưu response từ API
-struct StudentInfo {
-    bool success;
-    String mssv;
-    String name;
-    String className;
-    String phone;
-    String email;
-    String error;
-};
-
-struct BookInfo {
-    bool success;
-    String id;
-    String title;
-    String code;
-    String author;
-    bool available;
-    String error;
-};
+#include "scan_arena.h"
+#include "api_types.h"
+#include "station_metrics.h"
+#if INVENTORY_ENABLED
+#include "inventory_session.h"
+#endif
+#if OTA_ENABLED
+#include "ota_updater.h"
+#endif
+#if API_TLS_ENABLED
+#include "tls_client.h"
+#endif
 
 class APIClient {
 public:
     APIClient();
     
-    // Gửi request quét thẻ sinh viên
-    StudentInfo scanStudentCard(const String& cardUID);
+    // Cấp arena cho payload/response (gọi một lần trong setup)
+    bool begin();
+    
+    // Gửi request quét thẻ sinh viên. Kết quả mang theo vết với mốc sent/response
+    StudentInfo scanStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace);
     
     // Gửi request quét barcode sách
-    BookInfo scanBookBarcode(const String& barcode);
+    BookInfo scanBookBarcode(const char* barcode, const ScanTrace& trace);
+    
+    // Gửi nhiều lần quét trong một request (API_SCAN_BATCH). Kết quả của scans[i]
+    // ghi vào students[i] hoặc books[i] (theo scans[i].book), kể cả khi lỗi.
+    // Trả về mã HTTP của request (404 = server chưa hỗ trợ batch)
+    int scanBatch(const BatchScan* scans, uint8_t count, StudentInfo* students, BookInfo* books);
     
     // Gửi heartbeat (check trạng thái thiết bị)
     bool sendHeartbeat();
-
+    
+    #if INVENTORY_ENABLED
+    // Gửi một lô UID kiểm kê (tối đa INVENTORY_BATCH_MAX, cũ nhất trước); server nhận
+    // thì xóa chúng khỏi hàng đợi của phiên, lỗi thì để lại cho lần sau
+    bool sendInventoryBatch(InventorySession& session);
+    #endif
+    
+    #if SELF_BENCH_ENABLED
+    // Phần đo trên task mạng của tự kiểm tra: BENCH_HTTP_ITERATIONS request nhỏ (RTT),
+    // BENCH_UPLOAD_ROUNDS lần tải lên BENCH_UPLOAD_BYTES (throughput), ghi vào report rồi gửi
+    // report lên API_BENCHMARK. true nếu server nhận báo cáo
+    bool runBenchmark(BenchReport& report);
+    #endif
+    
+    #if OTA_ENABLED
+    // Gọi giữa các đoạn body firmware (cùng task mạng): gửi request đang chờ qua kết nối chính
+    typedef void (*DownloadYield)(void* context);
+    
+    // Tải firmware mới về phân vùng OTA còn lại: trước hết xin bản vá so với firmware đang chạy
+    // (API_FIRMWARE_PATCH), server không có bản vá hoặc bản vá không khớp ảnh đang chạy thì tải
+    // ảnh đầy đủ (API_FIRMWARE_IMAGE). true nếu đã ghi và chuyển phân vùng khởi động
+    // (otaUpdater.isRestartPending()); 204 = đã là bản mới nhất.
+    // Tải qua kết nối riêng, đọc từng OTA_CHUNK_SIZE byte và gọi yield giữa các đoạn
+    bool updateFirmware(DownloadYield yield, void* context);
+    
+    // Heartbeat gần nhất báo có firmware mới; đọc xong thì xóa cờ
+    bool takeFirmwareUpdateRequest();
+    #endif
+    
+    const ScanArena& getArena() const { return arena; }
+    #if API_TLS_ENABLED
+    const TlsClient& getTls() const { return tls; }
+    #endif
+    
 private:
     HTTPClient http;
+    #if API_TLS_ENABLED
+    // Kết nối TLS giữ lại giữa các request (keep-alive); server đóng thì mở lại bằng resume
+    TlsClient tls;
+    uint32_t backendGeneration;    // backendDiscovery.getGeneration() lúc mở kết nối
+    #endif
+    
+    #if OTA_ENABLED
+    volatile bool firmwareUpdateRequested;
+    // Kết nối tải firmware, tách khỏi http để request quét vẫn gửi được trong lúc tải
+    HTTPClient firmwareHttp;
+    #if API_TLS_ENABLED
+    TlsClient firmwareTls;
+    bool firmwareTlsReady;
+    #endif
+    uint8_t firmwareChunk[OTA_CHUNK_SIZE];
+    #endif
+    
+    // Payload và body response của mỗi request nằm trong arena,
+    // thu hồi ngay khi request kết thúc (không tạo String tạm trên heap)
+    ScanArena arena;
     
-    // Helper: Tạo JSON payload
-    String createStudentPayload(const String& cardUID);
-    String createBookPayload(const String& barcode);
-    String createHeartbeatPayload();
+    // Helper: POST JSON tới path trên backend đang dùng (backendDiscovery), body response (nếu có) được ghi vào response.
+    // Ghi RTT và lỗi kết nối/HTTP vào stationMetrics theo endpoint.
+    // traces (nếu có): gửi header traceparent của vết đầu tiên, ghi mốc sent/response
+    // và Server-Timing vào mọi vết
+    int post(ApiEndpoint endpoint, const char* path, const char* payload, size_t length, uint16_t timeout,
+             BufferStream* response, ScanTrace* traces, uint8_t traceCount);
+    // Hai nửa của post(): mở request tới path (false nếu chưa có địa chỉ backend), và sau khi
+    // gửi xong thì báo kết quả cho backpressure/backendDiscovery/stationMetrics rồi đóng.
+    // method chỉ để ghi log
+    bool open(const char* path, uint16_t timeout, const char* method = "POST");
+    int finish(ApiEndpoint endpoint, int httpCode, uint32_t rttMs);
+    int finish(HTTPClient& client, ApiEndpoint endpoint, int httpCode, uint32_t rttMs);
+    void countHttpError(int httpCode);
+    #if OTA_ENABLED
+    // GET path qua firmwareHttp rồi ghi body vào otaUpdater; trả về mã HTTP (âm nếu lỗi kết nối)
+    int downloadFirmware(const char* path, OtaMode mode, DownloadYield yield, void* context);
+    // Đọc body theo đoạn vào otaUpdater; trả về số byte đã đọc, âm nếu lỗi giữa chừng
+    int streamFirmware(DownloadYield yield, void* context);
+    #endif
     
-    // Helper: Parse JSON response
-    StudentInfo parseStudentResponse(const String& jsonResponse);
-    BookInfo parseBookResponse(const String& jsonResponse);
+    // Helper: Gom số liệu heap/arena cho payload heartbeat
+    void collectHeartbeatInfo(HeartbeatInfo& info);
 };
 
 #endif // API_CLIENT_H
@@ -0,0 +1,78 @@
+#ifndef API_CODEC_H
+#define API_CODEC_H
+
+#include <ArduinoJson.h>
+#include "api_types.h"
+
+// Tạo payload và parse response JSON của API.
+// Tách khỏi APIClient (HTTP) để chạy được trên máy host: fuzz và benchmark
+// nằm trong thư mục bench/.
+namespace ApiCodec {
+
+// Tạo JSON payload vào output, trả về độ dài (0 nếu không đủ chỗ).
+// Kèm trace_id và giờ quét (timestamp, ms UTC) nếu trạm đã có giờ thực
+size_t createStudentPayload(const char* cardUID, const ScanSource& source, const char* deviceId,
+                            const ScanTrace& trace, char* output, size_t capacity);
+size_t createBookPayload(const char* barcode, const char* deviceId, const ScanTrace& trace,
+                         char* output, size_t capacity);
+size_t createHeartbeatPayload(const HeartbeatInfo& info, char* output, size_t capacity);
+
+// Payload gộp nhiều lần quét: {"device_id", "scans": [{"type", "card_uid"|"barcode", ...}]}.
+// Server trả {"results": [...]} theo đúng thứ tự, mỗi phần tử như response của request đơn
+size_t createBatchPayload(const BatchScan* scans, uint8_t count, const char* deviceId,
+                          char* output, size_t capacity);
+
+// Lô UID kiểm kê: {"device_id", "session", "seq", "count", "encoding", "uids"}
+size_t createInventoryPayload(const InventoryBatch& batch, char* output, size_t capacity);
+// Tự kiểm tra: request đo RTT {"device_id", "phase": "probe", "seq"} (server trả gì cũng được)
+// và báo cáo {"device_id", "timestamp", "run", "duration_ms", "rc522": [...], "display", "wifi",
+// "http", "upload"}; mỗi phép đo lặp có samples/failures/min_us/p50_us/p95_us/max_us/avg_us
+size_t createBenchmarkProbe(const char* deviceId, uint16_t sequence, char* output, size_t capacity);
+size_t createBenchmarkReport(const BenchReport& report, char* output, size_t capacity);
+// Base64 chuẩn (có '='). Trả về độ dài, 0 nếu không đủ chỗ kể cả '\0'
+size_t base64Encode(const uint8_t* data, size_t length, char* output, size_t capacity);
+
+// Sự kiện quét đẩy thẳng tới app qua EventStream, cùng dạng IoTScanEventModel:
+// device_id, scan_type, scan_data, success, data (thông tin sinh viên/sách), error,
+// trace (id + thời gian từng chặng trên trạm + thời gian xử lý ở backend); "unverified": true với
+// thông tin đọc từ thẻ chưa được server xác nhận.
+// Không có timestamp khi trạm chưa có giờ thực (app dùng giờ nhận)
+size_t createStudentEvent(const char* cardUID, const StudentInfo& student, const ScanSource& source,
+                          const char* deviceId, char* output, size_t capacity);
+size_t createBookEvent(const char* barcode, const BookInfo& book, const char* deviceId,
+                       char* output, size_t capacity);
+
+// Parse response (zero-copy: json bị sửa tại chỗ). Không tin vào cấu trúc
+// server trả về: sai kiểu hay thiếu trường đều cho ra chuỗi rỗng/giá trị mặc định.
+// Trả về false nếu JSON không hợp lệ.
+bool parseStudentResponse(char* json, size_t length, StudentInfo& result);
+bool parseBookResponse(char* json, size_t length, BookInfo& result);
+
+// Response heartbeat: cấu hình mới trong "config" (nếu có) ghi vào update, cờ "firmware_update".
+// Tham số có giá trị sai kiểu bị bỏ qua và đếm vào update.invalid; tên trỏ vào json.
+// Trường khác bị bỏ qua khi parse. Trả về false nếu JSON không hợp lệ (lý do trong update.parseError)
+bool parseHeartbeatResponse(char* json, size_t length, ConfigUpdate& update);
+
+// Tách mảng "results" của response batch thành từng object (không parse, không copy):
+// items[i]/lengths[i] trỏ vào json, phần tử không phải object → nullptr.
+// Trả về số phần tử của mảng (có thể > maxItems), -1 nếu không tìm thấy mảng hoặc JSON hỏng
+int splitBatchResults(char* json, size_t length, char** items, size_t* lengths, uint8_t maxItems);
+
+// Header traceparent (W3C Trace Context): "00-<trace id>-<span id>-01".
+// spanId là 16 ký tự hex. Trả về độ dài, 0 nếu trace rỗng hoặc không đủ chỗ
+size_t formatTraceparent(const ScanTrace& trace, const char* spanId, char* output, size_t capacity);
+
+// Thời gian xử lý (ms) từ header Server-Timing của backend, ví dụ
+// "db;dur=12.5, total;dur=31". Lấy metric "total" nếu có, không thì cộng các dur.
+// 0 nếu header rỗng hoặc không có dur
+uint32_t parseServerTiming(const char* header);
+
+// Giờ UTC dạng ISO 8601 có ms: "2024-10-19T03:04:05.123Z" (TIMESTAMP_ISO_LEN kể cả '\0')
+size_t formatIsoTimestamp(uint64_t epochMs, char* output, size_t capacity);
+
+const char* laneName(ScanLane lane);
+const char* traceStageName(TraceStage stage);
+
+} // namespace ApiCodec
+
+#endif // API_CODEC_H
@@ -0,0 +1,207 @@
+#ifndef API_TYPES_H
+#define API_TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// Kiểu dữ liệu trao đổi với API. Chỉ dùng mảng char cố định (không String)
+// để build được cả trên máy host cho fuzz/benchmark.
+
+#define INFO_MSSV_LEN 16
+#define INFO_NAME_LEN 64      // Tên tiếng Việt UTF-8 có dấu
+#define INFO_CLASS_LEN 24
+#define INFO_PHONE_LEN 16
+#define INFO_EMAIL_LEN 64
+#define INFO_ID_LEN 16
+#define INFO_TITLE_LEN 96
+#define INFO_CODE_LEN 24
+#define INFO_AUTHOR_LEN 48
+#define INFO_ERROR_LEN 48
+
+#define TRACE_ID_LEN 33       // 16 byte ngẫu nhiên = 32 ký tự hex + '\0' (trace-id của W3C Trace Context)
+#define TRACE_SPAN_ID_LEN 17  // parent-id: 8 byte = 16 ký tự hex + '\0'
+#define TIMESTAMP_ISO_LEN 25  // "YYYY-MM-DDTHH:MM:SS.mmmZ" + '\0'
+
+// Các chặng của một lần quét trên trạm, tính từ lúc chạm thẻ/quét mã
+enum TraceStage : uint8_t {
+    TRACE_SENT,           // Task mạng bắt đầu gửi request (sau thời gian chờ hàng đợi)
+    TRACE_RESPONSE,       // Nhận xong response
+    TRACE_PUBLISHED,      // Sự kiện đã đẩy tới app qua EventStream
+    TRACE_STAGE_COUNT
+};
+
+// Vết của một lần quét. Trace ID đi trong header traceparent qua backend tới
+// sự kiện WebSocket; app ghép với giờ nhận để tách thời gian theo từng chặng.
+struct ScanTrace {
+    char id[TRACE_ID_LEN];                // "" = không có vết
+    uint64_t tapEpochMs;                  // Giờ thực lúc quét (UTC), 0 nếu chưa đồng bộ SNTP
+    uint32_t tapMs;                       // millis() lúc quét, gốc của stageMs
+    uint32_t stageMs[TRACE_STAGE_COUNT];  // ms sau lúc quét
+    uint8_t reached;                      // Bit (1 << TraceStage) của các chặng đã qua
+    uint32_t serverMs;                    // Thời gian xử lý ở backend (header Server-Timing), 0 = không có
+};
+
+// Làn phục vụ của đầu đọc (một trạm có thể có nhiều đầu đọc)
+enum ScanLane : uint8_t {
+    LANE_CHECKOUT = 0,    // Mượn sách
+    LANE_RETURN = 1       // Trả sách
+};
+
+// Nguồn của một lần quét: đầu đọc nào, thuộc làn nào
+struct ScanSource {
+    uint8_t reader;
+    ScanLane lane;
+};
+
+// Phiếu mượn đang mở của sinh viên (bản rút gọn từ borrow_cards)
+struct LoanInfo {
+    char bookCode[LOAN_BOOK_CODE_LEN];
+    char bookName[LOAN_TITLE_LEN];
+    char dueDate[LOAN_DATE_LEN];   // expected_return_date, "YYYY-MM-DD"
+    int16_t daysLeft;              // Số ngày còn lại tính tại server (âm = quá hạn)
+    bool overdue;
+};
+
+// Struct để lưu response từ API
+struct StudentInfo {
+    bool success;
+    char mssv[INFO_MSSV_LEN];
+    char name[INFO_NAME_LEN];
+    char className[INFO_CLASS_LEN];
+    char phone[INFO_PHONE_LEN];
+    char email[INFO_EMAIL_LEN];
+    char error[INFO_ERROR_LEN];
+    int httpCode;                  // Mã HTTP, <= 0 nếu lỗi kết nối
+    bool unverified;               // Đọc từ thẻ (CARD_DATA_MODE), server chưa xác nhận
+    ScanTrace trace;
+    
+    // Danh sách phiếu mượn đang mở, server trả kèm trong response quét thẻ
+    LoanInfo loans[MAX_ACTIVE_LOANS];
+    uint8_t loanCount;
+    bool loansTruncated;           // Sinh viên có nhiều hơn MAX_ACTIVE_LOANS phiếu
+};
+
+struct BookInfo {
+    bool success;
+    char id[INFO_ID_LEN];
+    char title[INFO_TITLE_LEN];
+    char code[INFO_CODE_LEN];
+    char author[INFO_AUTHOR_LEN];
+    bool available;
+    bool returned;                 // "returned": true, server đã ghi nhận trả sách của phiên hiện tại
+    char error[INFO_ERROR_LEN];
+    int httpCode;                  // Mã HTTP, <= 0 nếu lỗi kết nối
+    ScanTrace trace;
+};
+
+// Một lần quét trong request gộp (API_SCAN_BATCH)
+struct BatchScan {
+    const char* data;              // UID thẻ hoặc barcode
+    bool book;                     // true = barcode sách, false = thẻ sinh viên
+    ScanSource source;             // Đầu đọc/làn (chỉ dùng với thẻ)
+    const ScanTrace* trace;
+};
+
+// Một lô UID kiểm kê (API_INVENTORY_BATCH). uids: khóa UidSet đã sắp xếp, ghi hiệu
+// liên tiếp dạng varint rồi base64 (encoding "uid-delta-varint")
+struct InventoryBatch {
+    const char* deviceId;
+    uint32_t session;
+    uint32_t sequence;             // Số thứ tự lô trong phiên: server bỏ lô gửi lại
+    uint16_t count;
+    const char* uids;
+};
+
+// Số liệu gửi kèm heartbeat
+struct HeartbeatInfo {
+    const char* deviceId;
+    const char* deviceName;
+    const char* location;
+    uint64_t timestamp;            // Giờ thực (ms UTC), 0 nếu chưa đồng bộ SNTP
+    
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint32_t largestFreeBlock;
+    uint32_t freePsram;
+    uint8_t fragmentationPct;
+    int32_t heapDrift;
+    uint32_t arenaHighWater;
+    uint32_t arenaOverflows;
+    
+    uint32_t configRevision;       // Phiên bản cấu hình đã áp dụng (0 = mặc định của firmware)
+    
+    uint8_t taskCount;
+    const char* taskNames[HEAP_MONITOR_MAX_TASKS];
+    uint32_t stackFree[HEAP_MONITOR_MAX_TASKS];
+};
+
+// Thống kê một phép đo lặp của tự kiểm tra (µs)
+struct BenchTiming {
+    uint16_t samples;              // Lần đo thành công
+    uint16_t failures;             // Đọc sai / lỗi kết nối (không tính vào thời gian)
+    uint32_t minUs;
+    uint32_t p50Us;
+    uint32_t p95Us;
+    uint32_t maxUs;
+    uint32_t avgUs;
+};
+
+// Báo cáo tự kiểm tra của trạm (API_BENCHMARK). Các trường đo trên task mạng
+// (http, upload) = 0 khi chưa tới bước đó hoặc không có mạng
+struct BenchReport {
+    const char* deviceId;
+    uint64_t timestamp;            // Giờ thực lúc bắt đầu (ms UTC), 0 nếu chưa đồng bộ SNTP
+    uint32_t run;                  // Số lần chạy từ lúc khởi động
+    uint32_t startedMs;            // millis() lúc bắt đầu (không gửi đi)
+    uint32_t durationMs;           // Tới lúc gửi báo cáo
+    
+    // Đầu đọc không hoạt động có active = false
+    uint8_t readerCount;
+    bool readerActive[RFID_READER_COUNT];
+    ScanLane readerLane[RFID_READER_COUNT];
+    uint8_t readerVersion[RFID_READER_COUNT];
+    BenchTiming rc522[RFID_READER_COUNT];   // Đọc VersionReg
+    
+    const char* display;           // "lcd1602" / "ssd1306"
+    BenchTiming lcd;               // Vẽ lại cả màn hình
+    
+    bool wifiConnected;
+    int8_t rssiMin;
+    int8_t rssiMax;
+    float rssiAvg;
+    uint8_t channel;
+    
+    BenchTiming http;              // POST nhỏ tới API_BENCHMARK (mọi mã HTTP đều tính)
+    int httpCode;                  // Mã HTTP của lần gần nhất
+    uint32_t uploadBytes;          // Body mỗi lần đo throughput
+    uint32_t uploadBestMs;         // Lần nhanh nhất trong BENCH_UPLOAD_ROUNDS
+    uint16_t uploadFailures;
+    uint32_t uploadKbps;           // uploadBytes / (uploadBestMs - RTT p50), kbit/s
+};
+
+// Cấu hình server gửi kèm response heartbeat:
+// "config": {"version": 3, "params": {"api_timeout_ms": 8000, "rfid_debounce_ms": null}}
+// (null = về giá trị mặc định của firmware)
+#define CONFIG_MAX_ENTRIES 8
+
+struct ConfigEntry {
+    const char* name;              // Trỏ vào JSON đã parse
+    uint32_t value;
+    bool reset;                    // null: dùng lại giá trị mặc định
+};
+
+struct ConfigUpdate {
+    uint32_t revision;             // Phiên bản cấu hình phía server, 0 = response không có "config"
+    uint8_t count;
+    uint8_t invalid;               // Giá trị không phải số nguyên không âm, hoặc quá CONFIG_MAX_ENTRIES
+    ConfigEntry entries[CONFIG_MAX_ENTRIES];
+    bool firmwareUpdate;           // "firmware_update": true, có firmware mới (OTA_ENABLED)
+    const char* parseError;        // Lý do parse lỗi (parseHeartbeatResponse trả false), nullptr nếu không lỗi
+};
+
+// Khởi tạo kết quả rỗng (success = false, mọi chuỗi = "")
+void resetStudentInfo(StudentInfo& info);
+void resetBookInfo(BookInfo& info);
+
+#endif // API_TYPES_H
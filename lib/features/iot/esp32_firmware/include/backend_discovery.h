@@ -0,0 +1,69 @@
+#ifndef BACKEND_DISCOVERY_H
+#define BACKEND_DISCOVERY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+struct DiscoveryStats {
+    uint32_t queries;              // Lần tra mDNS
+    uint32_t emptyQueries;         // Không có instance nào trả lời (giữ cache cũ)
+    uint32_t failovers;            // Lần chuyển sang instance khác vì lỗi kết nối
+    uint32_t lastQueryMs;          // millis() lần tra gần nhất
+};
+
+// Địa chỉ backend tìm qua mDNS/DNS-SD, cache trong RAM.
+// Task nền tra _library-api._tcp lúc khởi động, sau mỗi nửa TTL và khi request bắt
+// đầu lỗi; request quét chỉ đọc địa chỉ đã cache (không bao giờ chờ tra cứu).
+// Chưa tìm thấy instance nào thì dùng API_BASE_URL.
+class BackendDiscovery {
+public:
+    BackendDiscovery();
+    
+    // Gọi sau khi WiFi đã kết nối: bật mDNS và khởi động task tra cứu
+    bool begin();
+    
+    // URL đầy đủ = địa chỉ backend đang dùng + path. Trả về độ dài, 0 nếu không đủ chỗ
+    size_t formatUrl(const char* path, char* output, size_t capacity) const;
+    
+    // Kết quả mỗi request (task mạng gọi): lỗi kết nối liên tiếp thì chuyển instance
+    void reportResult(int httpCode);
+    
+    // Tăng mỗi khi backend đang dùng đổi địa chỉ (để đóng kết nối keep-alive cũ)
+    uint32_t getGeneration() const { return generation; }
+    
+    // Cache còn trong TTL (false = đang dùng địa chỉ cũ hoặc dự phòng)
+    bool isCacheFresh() const;
+    uint8_t getInstanceCount() const { return count; }
+    const DiscoveryStats& getStats() const { return stats; }
+    TaskHandle_t getTaskHandle() const { return taskHandle; }
+    
+    // In trạng thái ra Serial
+    void printStats() const;
+    
+private:
+    struct Instance {
+        char base[BACKEND_URL_LEN];    // "https://192.168.1.10:3443"
+        uint32_t failedAt;             // millis() lần chuyển đi vì lỗi, 0 = tốt
+    };
+    
+    static void taskEntry(void* param);
+    void run();
+    void refresh();
+    void failover();
+    bool isUsable(const Instance& instance, uint32_t now) const;
+    
+    Instance instances[BACKEND_MAX_INSTANCES];
+    uint8_t count;                     // 0 = chưa tìm thấy, dùng fallback
+    uint8_t active;
+    char fallback[BACKEND_URL_LEN];    // Từ API_BASE_URL
+    mutable portMUX_TYPE lock;
+    volatile uint32_t generation;
+    uint32_t expiresAt;
+    uint8_t consecutiveFailures;
+    TaskHandle_t taskHandle;
+    DiscoveryStats stats;
+};
+
+extern BackendDiscovery backendDiscovery;
+
+#endif // BACKEND_DISCOVERY_H
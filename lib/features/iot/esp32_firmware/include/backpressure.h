@@ -0,0 +1,70 @@
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#define HTTP_STATUS_TOO_MANY_REQUESTS 429
+#define HTTP_STATUS_SERVICE_UNAVAILABLE 503
+
+struct BackpressureStats {
+    uint32_t overloads;        // Response 429/503
+    uint32_t timeouts;         // Server không trả lời kịp (cũng giảm giới hạn)
+    uint32_t retryAfters;      // Response có Retry-After hợp lệ
+    uint32_t decreases;        // Lần giảm giới hạn
+    uint32_t shed;             // Request nền chuyển sang gửi lại sau / heartbeat bỏ qua khi quá tải
+    uint32_t rejected;         // Lần quét có người chờ bị từ chối ngay tại trạm trong thời gian giữ
+};
+
+// Phản ứng của trạm khi server quá tải: giữ Retry-After, giới hạn AIMD cho số request đang
+// bay (giãn request nền khi giới hạn < 1) và độ trễ gửi lại lũy thừa có jitter.
+// Không phụ thuộc Arduino (thời gian và số ngẫu nhiên do người gọi truyền vào) để chạy được
+// trong bench/tls_standin --overload. Chỉ task mạng ghi; loop()/task metrics chỉ đọc.
+class Backpressure {
+public:
+    Backpressure();
+    
+    // Response HTTP (httpCode > 0). retryAfterMs = 0 nếu không có Retry-After
+    void onResponse(int httpCode, uint32_t retryAfterMs, uint32_t rttMs, uint32_t now, uint32_t random);
+    
+    // Timeout đọc response: server còn nhận kết nối nhưng không kịp xử lý
+    void onTimeout(uint32_t rttMs, uint32_t now);
+    
+    // Đang trong thời gian server yêu cầu chờ
+    bool isHolding(uint32_t now) const;
+    uint32_t holdRemaining(uint32_t now) const;
+    
+    // ms request nền còn phải chờ: hết thời gian giữ và đủ giãn theo giới hạn
+    uint32_t backgroundDelay(uint32_t now) const;
+    
+    void countShed() { stats.shed++; }
+    void countRejected() { stats.rejected++; }
+    float getLimit() const { return limit; }
+    const BackpressureStats& getStats() const { return stats; }
+    
+    static bool isOverloadStatus(int httpCode);
+    
+    // Độ trễ lần gửi lại thứ attempt (1, 2, ...): REQUEST_RETRY_DELAY * 2^(attempt - 1), tối đa
+    // REQUEST_RETRY_MAX_DELAY, lấy ngẫu nhiên trong [d/2, d] để các trạm không gửi lại cùng lúc
+    static uint32_t retryDelay(uint8_t attempt, uint32_t random);
+    
+    // Retry-After dạng số giây hoặc HTTP-date (cần nowEpochMs != 0).
+    // Trả về ms, 0 nếu không hợp lệ hoặc thời điểm đã qua
+    static uint32_t parseRetryAfter(const char* value, uint64_t nowEpochMs);
+    
+private:
+    void decrease();
+    void pace(uint32_t rttMs, uint32_t now);
+    
+    float limit;                 // Số request đang bay trung bình được phép, tối đa 1 (một task mạng)
+    uint32_t holdUntil;
+    uint32_t nextBackgroundAt;   // Request nền kế tiếp được gửi từ thời điểm này
+    uint8_t overloadStreak;      // 429/503 liên tiếp (thời gian giữ mặc định gấp đôi mỗi lần)
+    bool holding;
+    BackpressureStats stats;
+};
+
+extern Backpressure backpressure;
+
+#endif // BACKPRESSURE_H
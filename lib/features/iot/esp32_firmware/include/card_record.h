@@ -0,0 +1,56 @@
+#ifndef CARD_RECORD_H
+#define CARD_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bản ghi sinh viên lưu trên thẻ (96 byte):
+//   [0]  'L' 'B'          magic
+//   [2]  version          CARD_RECORD_VERSION
+//   [3]  reserved
+//   [4]  expiry           uint32 little-endian, YYYYMMDD (0 = không hết hạn)
+//   [8]  mssv             12 byte ASCII, đệm '\0'
+//   [20] name             60 byte UTF-8, đệm '\0'
+//   [80] signature        16 byte đầu của HMAC-SHA256(key, [0..80) || UID thẻ)
+// Chữ ký gắn với UID nên copy bản ghi sang thẻ khác sẽ không hợp lệ.
+
+#define CARD_RECORD_SIZE 96
+#define CARD_RECORD_VERSION 1
+#define CARD_RECORD_MSSV_LEN 12
+#define CARD_RECORD_NAME_LEN 60
+#define CARD_RECORD_SIG_LEN 16
+
+struct StudentCardRecord {
+    char mssv[CARD_RECORD_MSSV_LEN + 1];
+    char name[CARD_RECORD_NAME_LEN + 1];
+    uint32_t expiry;              // YYYYMMDD, 0 = không hết hạn
+};
+
+enum CardRecordStatus : uint8_t {
+    CARD_RECORD_OK,
+    CARD_RECORD_EMPTY,            // Thẻ chưa được ghi dữ liệu
+    CARD_RECORD_BAD_FORMAT,
+    CARD_RECORD_BAD_SIGNATURE,
+    CARD_RECORD_EXPIRED,
+    CARD_RECORD_IO_ERROR,         // Lỗi xác thực sector hoặc đọc/ghi
+    CARD_RECORD_UNSUPPORTED       // Loại thẻ không hỗ trợ
+};
+
+namespace CardRecord {
+
+// Mã hóa + ký bản ghi. Trả về false nếu dữ liệu không vừa
+bool encode(const StudentCardRecord& record, const uint8_t* uid, uint8_t uidLength,
+            const char* key, uint8_t output[CARD_RECORD_SIZE]);
+
+// Giải mã + kiểm tra chữ ký
+CardRecordStatus decode(const uint8_t input[CARD_RECORD_SIZE], const uint8_t* uid, uint8_t uidLength,
+                        const char* key, StudentCardRecord& record);
+
+// today: YYYYMMDD, 0 = chưa có giờ thực (bỏ qua kiểm tra)
+bool isExpired(const StudentCardRecord& record, uint32_t today);
+
+const char* statusName(CardRecordStatus status);
+
+} // namespace CardRecord
+
+#endif // CARD_RECORD_H
@@ -0,0 +1,47 @@
+#ifndef CARD_STORE_H
+#define CARD_STORE_H
+
+#include <stdint.h>
+#include "card_record.h"
+
+enum PiccKind : uint8_t {
+    PICC_KIND_UNKNOWN,
+    PICC_KIND_MIFARE_CLASSIC,     // 1K/4K/Mini: block 16 byte, cần xác thực theo sector
+    PICC_KIND_NTAG                // NTAG/Ultralight: trang 4 byte, không xác thực
+};
+
+// Truy cập bộ nhớ thẻ đang được chọn. Trên trạm là Rc522Driver, trên máy host là
+// thẻ giả lập (bench/emulated_picc.h).
+class PiccTransport {
+public:
+    virtual ~PiccTransport() {}
+    
+    virtual PiccKind kind() = 0;
+    virtual const uint8_t* uid(uint8_t& length) = 0;
+    
+    // MIFARE Classic: xác thực Key A cho sector chứa block
+    virtual bool authenticate(uint8_t block, const uint8_t key[6]) = 0;
+    
+    // Đọc 16 byte: MIFARE Classic = 1 block, NTAG = 4 trang bắt đầu từ block
+    virtual bool read16(uint8_t block, uint8_t output[16]) = 0;
+    
+    // MIFARE Classic: ghi 1 block
+    virtual bool writeBlock(uint8_t block, const uint8_t data[16]) = 0;
+    
+    // NTAG: ghi 1 trang
+    virtual bool writePage(uint8_t page, const uint8_t data[4]) = 0;
+};
+
+// Đọc/ghi bản ghi sinh viên theo bố cục của từng loại thẻ
+// (sector CARD_RECORD_SECTOR.. cho MIFARE Classic, trang CARD_RECORD_NTAG_PAGE.. cho NTAG)
+namespace CardStore {
+
+CardRecordStatus readRecord(PiccTransport& picc, const char* key, const uint8_t sectorKey[6],
+                            StudentCardRecord& record);
+
+CardRecordStatus writeRecord(PiccTransport& picc, const char* key, const uint8_t sectorKey[6],
+                             const StudentCardRecord& record);
+
+} // namespace CardStore
+
+#endif // CARD_STORE_H
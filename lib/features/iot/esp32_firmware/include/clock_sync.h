@@ -0,0 +1,38 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Giờ thực của trạm qua SNTP. Dùng để gắn giờ quét (UTC) vào request và sự
+// kiện, để app so được với giờ của nó khi tách thời gian theo từng chặng.
+// millis() vẫn là đồng hồ cho mọi khoảng thời gian trên trạm.
+class ClockSync {
+public:
+    ClockSync();
+    
+    // Gọi sau khi WiFi đã kết nối; SNTP chạy nền trong lwIP
+    void begin();
+    
+    // Đã nhận giờ từ server ít nhất một lần
+    bool isSynced() const;
+    
+    // Giờ thực (ms từ 1970, UTC), 0 nếu chưa đồng bộ
+    uint64_t nowEpochMs() const;
+    
+    uint32_t getSyncCount() const { return syncCount; }
+    
+    // In trạng thái ra Serial
+    void printStats() const;
+    
+private:
+    static void onTimeSync(struct timeval* tv);
+    
+    volatile uint32_t syncCount;
+    volatile uint32_t lastSyncMs;    // millis() lần đồng bộ gần nhất
+    bool started;
+};
+
+extern ClockSync clockSync;
+
+#endif // CLOCK_SYNC_H
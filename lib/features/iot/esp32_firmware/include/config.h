@@ -11,11 +11,125 @@
 // ============================================
 // API Configuration
 // ============================================
-#define API_BASE_URL "http://172.20.10.5:3000"  // Thay bằng IP server của bạn
+#define API_TLS_ENABLED false            // HTTPS: UID thẻ không đi dạng rõ trên mạng (cần API_TLS_CA_CERT)
+#if API_TLS_ENABLED
+#define API_BASE_URL "https://172.20.10.5:3443"  // Thay bằng IP server của bạn
+#else
+#define API_BASE_URL "http://172.20.10.5:3000"
+#endif
 #define API_SCAN_STUDENT "/api/iot/scan-student-card"
 #define API_SCAN_BOOK "/api/iot/scan-book-barcode"
 #define API_HEARTBEAT "/api/iot/heartbeat"
+#define API_SCAN_BATCH "/api/iot/scan-batch"
 #define API_TIMEOUT 10000  // 10 seconds
+#define HEARTBEAT_TIMEOUT 5000  // Heartbeat chạy nền nên được phép chậm hơn
+#define API_PAYLOAD_MAX 256     // Độ dài tối đa JSON gửi đi
+#define HEARTBEAT_PAYLOAD_MAX 512  // Heartbeat kèm số liệu heap và stack của từng task
+#define HEARTBEAT_RESPONSE_MAX 512 // Response heartbeat có thể kèm cấu hình mới ("config")
+#define API_RESPONSE_MAX 2048   // Độ dài tối đa body response đọc vào arena
+
+// Tìm backend qua mDNS/DNS-SD (_library-api._tcp) thay vì IP cố định ở trên.
+// API_BASE_URL chỉ còn là địa chỉ dự phòng khi chưa tìm thấy instance nào.
+// Việc tra cứu chạy trong task nền; request quét chỉ đọc địa chỉ đã cache.
+#define BACKEND_DISCOVERY_ENABLED true
+#define BACKEND_MDNS_SERVICE "_library-api"  // Backend quảng bá: _library-api._tcp, port của API
+#define STATION_MDNS_HOSTNAME "iot-station-01"  // Trạm trả lời tại iot-station-01.local
+#define BACKEND_MAX_INSTANCES 4
+#define BACKEND_CACHE_TTL 300000        // Địa chỉ đã tra còn hiệu lực 5 phút, làm mới sau nửa TTL
+#define BACKEND_FAILOVER_THRESHOLD 3    // Số lần lỗi kết nối liên tiếp trước khi chuyển instance
+#define BACKEND_FAILED_COOLDOWN 60000   // Instance vừa lỗi bị bỏ qua trong 1 phút
+#define BACKEND_URL_LEN 48              // "https://255.255.255.255:65535" + '\0'
+#define DISCOVERY_TASK_STACK 4096
+#define DISCOVERY_TASK_PRIORITY 1
+#define DISCOVERY_TASK_CORE 0
+
+// Chứng chỉ CA (PEM) để xác thực server, ví dụ:
+//   "-----BEGIN CERTIFICATE-----\n" "MIIB..." "\n-----END CERTIFICATE-----\n"
+// Bắt buộc khi bật API_TLS_ENABLED: để trống thì không build được (bench/tls_standin in sẵn CA để dán)
+#define API_TLS_CA_CERT ""
+#define API_TLS_HANDSHAKE_TIMEOUT 8000  // Handshake đầy đủ mất ~1 s trên ESP32-S3, resume vài chục ms
+
+// ============================================
+// Event Stream (WebSocket trên trạm, app trong LAN nhận sự kiện quét trực tiếp)
+// ============================================
+#define EVENT_STREAM_ENABLED true
+#define EVENT_STREAM_PORT 81            // ws://<IP trạm>:81/ (đường dẫn nào cũng được)
+#define EVENT_STREAM_MAX_CLIENTS 4
+#define EVENT_STREAM_CLIENT_BUFFER 2048 // Buffer gửi mỗi client; đầy = client chậm, bị ngắt
+#define EVENT_STREAM_EVENT_MAX 768      // Độ dài tối đa JSON một sự kiện
+#define EVENT_STREAM_HANDSHAKE_TIMEOUT 2000
+#define EVENT_STREAM_PING_INTERVAL 15000  // Không nhận gì sau 2 lần ping = client chết
+
+// ============================================
+// Metrics (Prometheus text format tại http://<IP trạm>:9100/metrics)
+// ============================================
+#define METRICS_ENABLED true
+#define METRICS_PORT 9100
+#define METRICS_BUFFER_SIZE 16384       // Nội dung một lần scrape (~15 KB với 2 đầu đọc)
+#define METRICS_REQUEST_TIMEOUT 1000    // Chờ request line của client
+#define METRICS_TASK_STACK 4096
+#define METRICS_TASK_PRIORITY 1         // Thấp hơn task mạng: scrape không chen vào request quét
+#define METRICS_TASK_CORE 0
+
+// ============================================
+// Clock & Tracing (giờ thực qua SNTP, trace ID cho mỗi lần quét)
+// ============================================
+#define NTP_SERVER "pool.ntp.org"
+#define NTP_FALLBACK_SERVER "time.google.com"
+#define NTP_TIMEZONE "ICT-7"            // POSIX TZ của Việt Nam (UTC+7); trace luôn dùng UTC
+#define NTP_SYNC_INTERVAL 3600000       // Đồng bộ lại mỗi giờ (thạch anh ESP32 trôi vài giây/ngày)
+#define TRACE_LOG_ENABLED true          // In thời gian từng chặng của mỗi lần quét ra Serial
+
+// ============================================
+// Request Scheduler (thứ tự ưu tiên: quét > gửi lại > heartbeat)
+// ============================================
+#define REQUEST_QUEUE_SIZE 8        // Số request tối đa chờ trong mỗi hàng đợi
+#define REQUEST_DATA_LEN 32         // UID thẻ hoặc barcode (kể cả '\0')
+#define REQUEST_COMPLETION_QUEUE 2  // Kết quả quét thẻ chạy nền chờ loop() lấy
+#define REQUEST_MAX_RETRIES 3       // Số lần gửi lại request quét bị lỗi kết nối hoặc server quá tải
+#define REQUEST_RETRY_DELAY 2000    // Độ trễ gửi lại lần đầu, gấp đôi mỗi lần (có jitter)
+#define REQUEST_RETRY_MAX_DELAY 30000
+#define HEARTBEAT_MAX_PIGGYBACK 4   // Bỏ heartbeat nhờ lần quét vừa thành công tối đa N lần liên tiếp
+                                    // (response quét không mang cấu hình/cờ firmware của heartbeat)
+#define REQUEST_TASK_STACK 10240   // Lần quét có thể chạy lồng trong lượt tải firmware (OTA_CHUNK_SIZE)
+#define REQUEST_TASK_PRIORITY 2
+#define REQUEST_TASK_CORE 0         // loop() chạy trên core 1
+
+// Gom các lần quét tới dồn dập (nhiều làn, gửi lại) thành một request tới API_SCAN_BATCH.
+// Cửa sổ gom = khoảng cách trung bình giữa các lần quét gần đây, tối đa BATCH_MAX_WINDOW_MS;
+// khi các lần quét cách nhau quá BATCH_BURST_GAP_MS thì cửa sổ = 0 (gửi ngay như cũ)
+#define BATCH_ENABLED true
+#define BATCH_MAX_ITEMS 4
+#define BATCH_MAX_WINDOW_MS 30
+#define BATCH_BURST_GAP_MS 150
+#define BATCH_PAYLOAD_MAX 1024      // JSON gửi đi của một batch
+#define BATCH_RESPONSE_MAX 6144     // Body response của một batch (mỗi kết quả như request đơn)
+
+// Server quá tải (429/503, timeout): giữ Retry-After, giảm giới hạn request đang bay theo AIMD.
+// Task mạng chỉ gửi một request một lúc, nên giới hạn < 1 nghĩa là giãn request nền ra để trung
+// bình chỉ có `limit` request đang bay; lần quét có người chờ không bị giãn
+#define BACKPRESSURE_ENABLED true
+#define BACKPRESSURE_MIN_LIMIT 0.05f    // Tối đa ~19 RTT nghỉ giữa hai request nền
+#define BACKPRESSURE_INCREASE 0.1f      // Cộng thêm sau mỗi response bình thường
+#define BACKPRESSURE_DECREASE 0.5f      // Nhân khi server báo quá tải
+#define BACKPRESSURE_DEFAULT_HOLD 2000  // 429/503 không có Retry-After: chờ 2 s (gấp đôi nếu lặp lại)
+#define BACKPRESSURE_MAX_HOLD 60000     // Retry-After dài hơn bị cắt còn 1 phút
+#define BACKPRESSURE_MAX_PACING 30000
+
+// ============================================
+// Active Loans Prefetch
+// ============================================
+#define MAX_ACTIVE_LOANS 8         // Số phiếu mượn tối đa giữ trên trạm cho 1 sinh viên
+#define LOAN_BOOK_CODE_LEN 24      // Độ dài tối đa mã sách (kể cả '\0')
+#define LOAN_TITLE_LEN 40          // Độ dài tối đa tên sách (kể cả '\0')
+#define LOAN_DATE_LEN 11           // "YYYY-MM-DD" + '\0'
+
+// ============================================
+// Memory (arena cho mỗi lần quét + theo dõi heap)
+// ============================================
+#define SCAN_ARENA_SIZE 8192        // Vùng nhớ tạm cho payload/response của một request (hoặc một batch)
+#define UID_STRING_LEN 21           // UID tối đa 10 byte = 20 ký tự hex + '\0'
+#define HEAP_MONITOR_MAX_TASKS 5    // Số task theo dõi stack high-water
 
 // ============================================
 // Device Configuration
@@ -33,6 +147,100 @@
 #define RFID_MOSI_PIN 11  // Master Out Slave In
 #define RFID_MISO_PIN 13  // Master In Slave Out
 
+// Nhiều đầu đọc RC522 dùng chung bus SPI (mỗi đầu đọc một chân CS riêng).
+// Ví dụ 2 làn: {RFID_CS_PIN, 14} / {RFID_RST_PIN, RFID_RST_PIN} / {LANE_CHECKOUT, LANE_RETURN}
+#define RFID_READER_COUNT 1
+#define RFID_READER_CS_PINS {RFID_CS_PIN}
+#define RFID_READER_RST_PINS {RFID_RST_PIN}   // RST có thể nối chung
+#define RFID_READER_LANES {LANE_CHECKOUT}
+// Các đầu đọc luôn được poll; thẻ quét khi màn hình còn hiện kết quả được giữ lại (mỗi đầu đọc
+// một lần quét, mới nhất thắng). Làn khác được xử lý sau khi kết quả đang hiện đã đứng ít nhất
+// chừng này, cùng làn thì chờ hết lcd_display_timeout_ms
+#define RFID_LANE_MIN_DISPLAY_MS 1500
+
+// Bus SPI của RC522 chạy qua driver ESP-IDF (DMA, hàng đợi transaction).
+// RC522 hỗ trợ tối đa 10 Mbit/s; giảm xuống nếu dây nối dài hoặc đọc lỗi.
+#define RFID_SPI_CLOCK_HZ 10000000
+// Thời gian tối đa mỗi lần poll một đầu đọc chạy máy trạng thái của driver.
+// Thẻ trả lời trong vài trăm µs; khi không có thẻ, chip chờ 25 ms mới báo
+// timeout nên phần còn lại được xử lý ở vòng loop() sau thay vì chặn tại đây.
+#define RFID_POLL_BUDGET_US 3000
+
+// ============================================
+// Student Card Data (đọc MSSV/tên trực tiếp từ thẻ, server chỉ xác nhận ở nền)
+// ============================================
+#define CARD_DATA_MODE false         // true = hiện MSSV/tên từ thẻ đã ký trước khi server xác nhận
+#define CARD_RECORD_SECTOR 1         // MIFARE Classic: dùng sector 1 và 2 (6 block dữ liệu)
+#define CARD_RECORD_NTAG_PAGE 4      // NTAG213/215/216: trang bắt đầu (24 trang)
+#define CARD_SECTOR_KEY {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}  // Key A của các sector trên
+// Khóa HMAC chung cho các trạm: sinh riêng (vd. `openssl rand -hex 32`) và truyền qua build flag
+// -DCARD_SIGNING_KEY=\"...\" thay vì commit vào repo; ai có khóa đều ghi được thẻ giả
+// #define CARD_SIGNING_KEY "..."
+#define CARD_SIGNING_KEY_PLACEHOLDER "doi-khoa-nay-truoc-khi-trien-khai"  // Khóa mẫu cũ, đã công khai
+#if CARD_DATA_MODE && !defined(CARD_SIGNING_KEY)
+#error "CARD_DATA_MODE cần CARD_SIGNING_KEY riêng của thư viện"
+#endif
+
+// ============================================
+// Inventory (kiểm kê: quét nhãn RFID dán trên sách theo từng kệ)
+// ============================================
+// Bật/tắt bằng lệnh Serial "inventory start|stop". Trong chế độ này trạm chỉ đọc UID:
+// không debounce, HLTA ngay sau khi chọn để nhãn khác trong trường trả lời,
+// UID trùng bị lọc trên trạm và UID mới được gửi theo lô đã nén.
+#define INVENTORY_ENABLED true
+#define API_INVENTORY_BATCH "/api/iot/inventory-batch"
+#define INVENTORY_MAX_TAGS 8192          // UID khác nhau tối đa trong một phiên (8 byte/UID, PSRAM)
+#define INVENTORY_BLOOM_BITS 65536       // Bloom filter 8 KB (8 bit/UID, lũy thừa của 2)
+#define INVENTORY_BLOOM_HASHES 4         // ~2% dương tính giả khi đầy
+#define INVENTORY_SET_TAIL 32            // UID mới gom chưa sắp xếp trước khi trộn vào mảng
+#define INVENTORY_UPLOAD_QUEUE 512       // UID mới chờ gửi; đầy thì nhãn được đọc lại ở lượt sau
+#define INVENTORY_BATCH_MAX 128          // UID mỗi request
+#define INVENTORY_UPLOAD_INTERVAL 2000   // Gửi lô chưa đầy sau 2 giây
+#define INVENTORY_PAYLOAD_MAX 2048       // JSON của một lô (UID nén + base64)
+#define INVENTORY_POLL_BUDGET_US 20000   // Mỗi vòng loop() đọc nhãn liên tục trong 20 ms
+#define INVENTORY_RESPONSE_TIMEOUT_US 1000  // Chỉ REQA/anticollision/select/HLTA: thẻ trả lời < 100 µs
+
+// ============================================
+// Self-benchmark (tự kiểm tra hiệu năng: lệnh Serial "bench" hoặc giữ nút BOOT)
+// ============================================
+// Số lần lặp cố định để kết quả so được giữa các trạm và giữa các lần chạy. Chặn loop()
+// trong lúc chạy (~5 s), báo cáo in ra Serial và gửi lên API_BENCHMARK
+#define SELF_BENCH_ENABLED true
+#define API_BENCHMARK "/api/iot/benchmark"
+#define BENCH_LONG_PRESS_MS 3000         // Giữ nút BOOT chừng này để chạy
+#define BENCH_RC522_ITERATIONS 500       // Đọc VersionReg (1 frame SPI 2 byte) mỗi đầu đọc
+#define BENCH_LCD_ITERATIONS 20          // Vẽ lại cả màn hình, nội dung đổi mỗi lần
+#define BENCH_RSSI_SAMPLES 20
+#define BENCH_RSSI_INTERVAL_MS 50
+#define BENCH_HTTP_ITERATIONS 20         // POST nhỏ tới API_BENCHMARK trên kết nối keep-alive
+#define BENCH_UPLOAD_BYTES 32768         // Body mỗi lần đo throughput tải lên (sinh dần, không giữ trong RAM)
+#define BENCH_UPLOAD_ROUNDS 3
+#define BENCH_TIMEOUT 15000              // Timeout HTTP của các request đo
+#define BENCH_REPORT_MAX 1536            // JSON báo cáo
+
+// ============================================
+// OTA (cập nhật firmware qua WiFi: lệnh Serial "ota" hoặc server báo trong response heartbeat)
+// ============================================
+// Trạm tải bản vá so với firmware đang chạy (delta, xem delta_patch.h) và áp dụng ngay khi tải
+// vào phân vùng OTA còn lại; SHA-256 khớp mới chuyển phân vùng khởi động rồi khởi động lại lúc
+// rảnh. Server không có bản vá cho bản đang chạy (404) thì tải ảnh đầy đủ.
+// Mặc định tắt: cần khóa công khai OTA_SIGNING_PUBKEY bên dưới
+#define OTA_ENABLED false
+#define API_FIRMWARE_PATCH "/api/iot/firmware/patch"   // GET ?device_id=&from=<app_elf_sha256>, 204 = đã mới nhất
+#define API_FIRMWARE_IMAGE "/api/iot/firmware/image"   // GET ?device_id=, ảnh đầy đủ (firmware.bin)
+#define OTA_TIMEOUT 30000                // Timeout HTTP của mỗi lần đọc khi tải
+#define OTA_CHUNK_SIZE 1024              // Body đọc theo đoạn; giữa hai đoạn task mạng gửi các lần quét đang chờ
+#define DELTA_CHUNK_SIZE 1024            // Bộ đệm đọc ảnh nguồn / ghi ảnh đích của DeltaPatcher
+// Khóa công khai ECDSA P-256 (PEM) kiểm tra chữ ký ảnh đích trước khi chuyển phân vùng khởi động.
+// Server gửi chữ ký trong header X-Firmware-Signature (base64 của chữ ký DER trên SHA-256 của
+// firmware.bin), cùng một chữ ký cho bản vá và ảnh đầy đủ. SHA-256 trong bản vá chỉ chống lỗi,
+// không chống giả mạo: không có khóa thì không build được OTA
+// #define OTA_SIGNING_PUBKEY "-----BEGIN PUBLIC KEY-----\n" "MFkw..." "\n-----END PUBLIC KEY-----\n"
+#define OTA_SIGNATURE_MAX 72             // Chữ ký DER ECDSA P-256 dài nhất
+#if OTA_ENABLED && !defined(OTA_SIGNING_PUBKEY)
+#error "OTA_ENABLED requires OTA_SIGNING_PUBKEY (see README, OTA section)"
+#endif
+
 // ============================================
 // LCD 16x2 I2C Configuration - ESP32-S3-CAM
 // ============================================
@@ -42,6 +250,12 @@
 #define LCD_SDA_PIN 4     // I2C SDA for ESP32-S3
 #define LCD_SCL_PIN 5     // I2C SCL for ESP32-S3
 
+// Màn hình OLED 0.96" 128x64 SSD1306 thay cho LCD (cùng chân I2C ở trên).
+// Hiển thị tiếng Việt có dấu, 4 dòng x 21 ký tự; LCDHandler giữ nguyên API
+#define DISPLAY_OLED false
+#define OLED_ADDRESS 0x3C
+#define OLED_I2C_CLOCK 400000     // Fast mode; LCD PCF8574 chạy 100 kHz mặc định
+
 // ============================================
 // Camera Configuration - ESP32-S3-CAM
 // ============================================
@@ -49,6 +263,25 @@
 #define CAMERA_FRAME_SIZE FRAMESIZE_VGA  // 640x480 - tốt cho barcode
 #define CAMERA_JPEG_QUALITY 10  // 0-63, thấp hơn = chất lượng cao hơn
 
+// ============================================
+// USB Barcode Scanner (máy quét kiểu bàn phím trên cổng USB OTG của ESP32-S3)
+// ============================================
+// Máy quét HID boot keyboard, bố cục US, hậu tố Enter (hoặc không hậu tố: kết thúc theo thời gian chờ).
+// Cổng OTG dùng chung PHY với USB Serial/JTAG: Serial phải đi qua cổng UART (chip USB-UART của board).
+// Mặc định tắt; bật bằng env esp32s3cam_usbhost trong platformio.ini (kèm ARDUINO_USB_CDC_ON_BOOT=0)
+#ifndef USB_SCANNER_ENABLED
+#define USB_SCANNER_ENABLED false
+#endif
+#if USB_SCANNER_ENABLED && defined(ARDUINO_USB_CDC_ON_BOOT) && ARDUINO_USB_CDC_ON_BOOT
+#error "USB_SCANNER_ENABLED needs ARDUINO_USB_CDC_ON_BOOT=0 (build env esp32s3cam_usbhost)"
+#endif
+#define USB_SCANNER_CHAR_TIMEOUT_MS 50   // Máy quét gõ < 10 ms/ký tự; chậm hơn là người gõ hoặc đã hết mã
+#define USB_SCANNER_MIN_LENGTH 4         // Chuỗi ngắn hơn bị bỏ (phím lạc)
+#define USB_SCANNER_QUEUE 4              // Mã chờ loop() xử lý
+#define USB_SCANNER_TASK_STACK 4096
+#define USB_SCANNER_TASK_PRIORITY 2      // Như task mạng: report HID đến mỗi vài ms
+#define USB_SCANNER_TASK_CORE 0
+
 // ============================================
 // Button Configuration
 // ============================================
@@ -65,9 +298,16 @@
 // ============================================
 // Timing Configuration
 // ============================================
-#define RFID_SCAN_INTERVAL 500     // Check RFID mỗi 500ms
+// RFID_SCAN_INTERVAL, RFID_DEBOUNCE_TIME, LCD_DISPLAY_TIMEOUT, HEARTBEAT_INTERVAL, WIFI_CHECK_INTERVAL
+// và API_TIMEOUT chỉ là giá trị mặc định: trạm đọc qua stationParams (lưu trong NVS), server đổi
+// được qua response heartbeat mà không cần nạp lại firmware
+#define RFID_SCAN_INTERVAL 100     // Poll RFID mỗi 100ms (bằng nhịp loop)
+#define RFID_DEBOUNCE_TIME 2000    // Bỏ qua cùng một thẻ trên cùng đầu đọc trong 2 giây
 #define LCD_DISPLAY_TIMEOUT 5000   // Hiển thị thông tin 5 giây
 #define HEARTBEAT_INTERVAL 60000   // Gửi heartbeat mỗi 60 giây
+#define WIFI_CHECK_INTERVAL 5000   // Kiểm tra và kết nối lại WiFi mỗi 5 giây
+#define PARAMS_DEFAULTS_VERSION 1  // Tăng khi đổi mặc định/ý nghĩa của tham số (ParamSpec::version)
+#define STUDENT_SESSION_TIMEOUT 120000  // Giữ phiên sinh viên (danh sách đang mượn) 2 phút
 #define CAMERA_WARMUP_MS 1000      // Camera warm-up time
 
 // ============================================
@@ -0,0 +1,153 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mbedtls/md.h>
+#include "config.h"
+
+// Bản vá firmware kiểu bsdiff so với ảnh đang chạy, áp dụng ngay khi tải về (không cần giữ
+// cả bản vá hay ảnh mới trong RAM). Định dạng (số nguyên little-endian, varint = LEB128):
+//
+//   header  "SDP1", sourceSize u32, targetSize u32, SHA-256 ảnh nguồn, SHA-256 ảnh đích
+//   record  varint diffLength, varint extraLength, varint zigzag(seek)
+//           diff:  diffLength byte (mới - cũ) ghi dạng chạy: varint số byte 0 (chép nguyên từ
+//                  ảnh nguồn), varint số byte khác 0, các byte đó; lặp tới đủ diffLength
+//           extra: extraLength byte mới chép thẳng
+//           sau record vị trí đọc ảnh nguồn cộng thêm seek
+//
+// Các record nén LZSS (cửa sổ DELTA_LZ_WINDOW byte): mỗi byte cờ cho 8 phần tử tiếp theo, bit 1 =
+// một byte nguyên, bit 0 = 2 byte (12 bit khoảng cách - 1, 4 bit độ dài - 3). Địa chỉ dịch đi sau
+// một thay đổi nhỏ lặp lại cùng một mẫu diff nên nén rất tốt. Record nối tiếp tới khi đủ
+// targetSize byte. Ảnh nguồn đọc theo vị trí (phân vùng đang chạy), ảnh đích chỉ ghi tuần tự
+// (phân vùng OTA còn lại). Bản vá tạo trên máy host bằng `bench/build/delta_patch_bench --make`.
+
+#define DELTA_MAGIC "SDP1"
+#define DELTA_HASH_LEN 32
+#define DELTA_HEADER_LEN (4 + 4 + 4 + DELTA_HASH_LEN * 2)
+#define DELTA_LZ_WINDOW 4096
+#define DELTA_LZ_MIN_MATCH 3
+#define DELTA_LZ_MAX_MATCH 18
+
+struct DeltaHeader {
+    uint32_t sourceSize;
+    uint32_t targetSize;
+    uint8_t sourceHash[DELTA_HASH_LEN];
+    uint8_t targetHash[DELTA_HASH_LEN];
+};
+
+enum DeltaStatus : uint8_t {
+    DELTA_RUNNING,             // Chờ thêm dữ liệu bản vá
+    DELTA_DONE,                // Đủ targetSize byte, SHA-256 khớp
+    DELTA_BAD_HEADER,          // Không phải bản vá, hoặc ảnh nguồn dài hơn phân vùng
+    DELTA_SOURCE_MISMATCH,     // Bản vá làm cho ảnh khác với ảnh đang chạy
+    DELTA_CORRUPT,             // Record vượt ra ngoài ảnh nguồn/đích, dữ liệu thừa
+    DELTA_READ_FAILED,
+    DELTA_WRITE_FAILED,
+    DELTA_HASH_MISMATCH        // Ảnh đích ghi xong nhưng SHA-256 không khớp
+};
+
+// Đọc ảnh nguồn theo vị trí (phân vùng đang chạy trên trạm, file trên máy host)
+class DeltaSource {
+public:
+    virtual ~DeltaSource() {}
+    virtual uint32_t size() = 0;
+    virtual bool read(uint32_t offset, uint8_t* buffer, size_t length) = 0;
+};
+
+// Ghi ảnh đích tuần tự. begin() gọi một lần khi đã biết kích thước và ảnh nguồn đã khớp
+class DeltaSink {
+public:
+    virtual ~DeltaSink() {}
+    virtual bool begin(uint32_t targetSize) = 0;
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+};
+
+// Áp dụng bản vá theo từng đoạn nhận được. Bộ nhớ cố định (cửa sổ LZSS, hai bộ đệm
+// DELTA_CHUNK_SIZE, ngữ cảnh SHA-256) bất kể kích thước ảnh; không phụ thuộc Arduino để chạy
+// được trong bench. Đối tượng ~6.5 KB: đặt ở biến toàn cục, không đặt trên stack của task.
+class DeltaPatcher {
+public:
+    DeltaPatcher();
+    ~DeltaPatcher();
+    
+    void begin(DeltaSource& source, DeltaSink& sink);
+    
+    // Đưa thêm length byte bản vá. Sau header, SHA-256 của ảnh nguồn được kiểm tra trước khi
+    // ghi byte nào vào sink. Trả về DELTA_DONE khi xong, trạng thái lỗi thì dừng hẳn
+    DeltaStatus feed(const uint8_t* data, size_t length);
+    
+    DeltaStatus getStatus() const { return status; }
+    const DeltaHeader& getHeader() const { return header; }
+    uint32_t getPatchBytes() const { return patchBytes; }
+    uint32_t getWritten() const { return written; }
+    // Byte ảnh đích chép nguyên từ ảnh nguồn (lượt byte 0 của diff), không cần dữ liệu trong bản vá
+    uint32_t getCopiedBytes() const { return copiedBytes; }
+    
+    static const char* statusName(DeltaStatus status);
+    
+private:
+    enum Stage : uint8_t {
+        STAGE_HEADER,
+        STAGE_DIFF_LENGTH,
+        STAGE_EXTRA_LENGTH,
+        STAGE_SEEK,
+        STAGE_ZERO_RUN,
+        STAGE_LITERAL_RUN,
+        STAGE_LITERAL,
+        STAGE_EXTRA,
+        STAGE_FINISHED
+    };
+    
+    void inflate(const uint8_t* data, size_t length);
+    void consume(const uint8_t* data, size_t length);
+    size_t step(const uint8_t* data, size_t length);
+    DeltaStatus parseHeader();
+    bool verifySource();
+    bool readVarint(uint8_t byte);
+    DeltaStatus startRecord();
+    DeltaStatus nextRun();
+    DeltaStatus endRecord();
+    bool loadSource(uint32_t position);
+    bool copySource(uint32_t count);
+    bool putByte(uint8_t value);
+    bool flushOutput();
+    
+    DeltaSource* source;
+    DeltaSink* sink;
+    mbedtls_md_context_t hash;     // SHA-256 của ảnh đích (trước đó: của ảnh nguồn)
+    bool hashReady;
+    DeltaStatus status;
+    Stage stage;
+    DeltaHeader header;
+    uint8_t headerBytes[DELTA_HEADER_LEN];
+    uint8_t headerLength;
+    
+    // Giải nén LZSS
+    uint8_t lzWindow[DELTA_LZ_WINDOW];
+    uint32_t lzPos;                // Tổng số byte đã giải nén
+    uint16_t flags;                // Byte cờ hiện tại, bit 8 trở lên = còn bit chưa dùng
+    uint8_t matchBytes[2];
+    uint8_t matchLength;
+    
+    uint64_t varint;
+    uint8_t varintShift;
+    uint32_t diffLeft;             // Byte diff còn lại của record hiện tại
+    uint32_t extraLeft;
+    uint32_t runLeft;              // Byte khác 0 còn lại của lượt hiện tại
+    int64_t seek;
+    uint32_t sourcePos;
+    
+    // Đoạn ảnh nguồn đang đệm: bản vá đọc gần như tuần tự nên mỗi lần đọc một đoạn
+    uint8_t sourceBuffer[DELTA_CHUNK_SIZE];
+    uint32_t bufferStart;
+    uint32_t bufferLength;
+    uint8_t output[DELTA_CHUNK_SIZE];
+    size_t outputLength;
+    
+    uint32_t patchBytes;
+    uint32_t written;
+    uint32_t copiedBytes;
+};
+
+#endif // DELTA_PATCH_H
@@ -0,0 +1,68 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "ws_protocol.h"
+
+#define EVENT_STREAM_RX_BUFFER 128     // Client chỉ gửi ping/pong/close
+
+struct EventStreamStats {
+    uint32_t published;                // Sự kiện đã đẩy ra
+    uint32_t accepted;                 // Client đã nâng cấp WebSocket thành công
+    uint32_t rejected;                 // Hết slot hoặc handshake sai/quá hạn
+    uint32_t slowDropped;              // Client bị ngắt vì buffer gửi đầy
+    uint32_t timedOut;                 // Client không trả lời ping
+    uint32_t maxQueued;                // Số byte chờ gửi lớn nhất của một client
+};
+
+// WebSocket server nhỏ trên trạm: đẩy sự kiện quét (JSON giống IoTScanEventModel
+// của app) tới các client trong LAN ngay khi có kết quả, không đi qua backend.
+// Chạy trong loop(), không chặn: socket gửi với MSG_DONTWAIT, mỗi client có buffer
+// gửi cố định EVENT_STREAM_CLIENT_BUFFER byte; client đọc không kịp bị ngắt thay
+// vì làm chậm trạm hay các client khác.
+class EventStream {
+public:
+    explicit EventStream(uint16_t port = EVENT_STREAM_PORT);
+    
+    // Mở cổng lắng nghe (gọi sau khi có WiFi)
+    void begin();
+    
+    // Gọi mỗi vòng loop(): nhận client mới, handshake, gửi dữ liệu chờ, đọc ping/close
+    void service();
+    
+    // Gửi một sự kiện JSON tới mọi client đang mở
+    void publish(const char* json, size_t length);
+    
+    uint8_t getClientCount() const;
+    const EventStreamStats& getStats() const { return stats; }
+    void printStats() const;
+    
+private:
+    enum ClientState : uint8_t { CLIENT_FREE, CLIENT_HANDSHAKE, CLIENT_OPEN, CLIENT_CLOSING };
+    
+    struct Client {
+        WiFiClient socket;
+        ClientState state;
+        uint32_t since;                // Lúc nhận kết nối / lúc nhận dữ liệu gần nhất
+        uint32_t lastPing;
+        size_t received;               // Số byte request/frame đang chờ xử lý
+        uint8_t rx[EVENT_STREAM_RX_BUFFER];
+        WsOutbox<EVENT_STREAM_CLIENT_BUFFER> outbox;
+    };
+    
+    void acceptClients();
+    void serviceHandshake(Client& client);
+    void serviceOpen(Client& client);
+    bool sendFrame(Client& client, WsOpcode opcode, const uint8_t* payload, size_t length);
+    bool flush(Client& client);
+    void drop(Client& client);
+    
+    WiFiServer server;
+    Client clients[EVENT_STREAM_MAX_CLIENTS];
+    EventStreamStats stats;
+    bool started;
+};
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,33 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Ô ký tự 6x16: font 5x7 ở hàng 6..12, dấu thanh/mũ phía trên, dấu nặng ở hàng 14.
+// Cao đúng 2 trang SSD1306 nên vẽ chữ chỉ là chép byte, không phải dịch bit.
+#define GLYPH_WIDTH 6
+#define GLYPH_HEIGHT 16
+#define GLYPH_PAGES (GLYPH_HEIGHT / 8)
+#define GLYPH_BYTES (GLYPH_WIDTH * GLYPH_PAGES)
+
+// Bảng glyph ASCII + 134 chữ cái tiếng Việt dựng sẵn (NFC), ghép từ font 5x7 và
+// các dấu lúc biên dịch (constexpr) nên nằm trong flash, không rasterize lúc chạy.
+// Không phụ thuộc Arduino: bench/oled_bench.cpp chạy được trên máy host.
+namespace GlyphAtlas {
+
+// Giải mã một ký tự UTF-8 và tiến con trỏ; chuỗi lỗi trả về U+FFFD
+uint32_t nextCodepoint(const char*& text);
+
+// Bitmap GLYPH_BYTES byte: GLYPH_WIDTH byte trang trên rồi GLYPH_WIDTH byte trang dưới
+// (bit 0 = hàng trên cùng của trang). Ký tự không có trong bảng trả về glyph '?'
+const uint8_t* glyph(uint32_t codepoint);
+
+// Chữ không dấu tương ứng (ế → e, Đ → D; ASCII giữ nguyên), 0 nếu không có trong bảng
+char baseLetter(uint32_t codepoint);
+
+size_t glyphCount();
+
+} // namespace GlyphAtlas
+
+#endif // GLYPH_ATLAS_H
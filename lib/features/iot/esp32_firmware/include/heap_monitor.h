@@ -0,0 +1,50 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+struct HeapSnapshot {
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;        // Thấp nhất từ lúc khởi động
+    uint32_t largestFreeBlock;
+    uint32_t freePsram;
+    uint8_t fragmentationPct;    // 100 * (1 - largestFreeBlock / freeHeap)
+    int32_t drift;               // Giảm so với mốc sau khi khởi động xong (> 0 = đang rò)
+};
+
+// Theo dõi sức khỏe bộ nhớ: heap, phân mảnh và stack high-water của từng task
+class HeapMonitor {
+public:
+    HeapMonitor();
+    
+    // Ghi mốc heap sau khi setup() xong
+    void markBaseline();
+    
+    // Đăng ký task để theo dõi stack high-water mark
+    bool registerTask(TaskHandle_t handle, const char* name);
+    
+    HeapSnapshot snapshot() const;
+    
+    // Stack còn trống ít nhất (byte) của task đã đăng ký
+    uint32_t getStackHighWater(uint8_t index) const;
+    uint8_t getTaskCount() const { return taskCount; }
+    const char* getTaskName(uint8_t index) const { return tasks[index].name; }
+    
+    // In báo cáo ra Serial
+    void printReport() const;
+
+private:
+    struct TrackedTask {
+        TaskHandle_t handle;
+        const char* name;
+    };
+    
+    TrackedTask tasks[HEAP_MONITOR_MAX_TASKS];
+    uint8_t taskCount;
+    uint32_t baselineFreeHeap;
+};
+
+extern HeapMonitor heapMonitor;
+
+#endif // HEAP_MONITOR_H
@@ -0,0 +1,58 @@
+#ifndef HID_KEYBOARD_DECODER_H
+#define HID_KEYBOARD_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+struct HidDecoderStats {
+    uint32_t reports;
+    uint32_t keystrokes;           // Phím mới được nhấn (đã đổi ra ký tự hoặc phím điều khiển)
+    uint32_t barcodes;             // Mã hoàn chỉnh (Enter/Tab hoặc hết thời gian chờ)
+    uint32_t timeoutBarcodes;      // Trong số đó: kết thúc vì hết thời gian chờ (máy quét không gửi Enter)
+    uint32_t discarded;            // Chuỗi ngắn hơn USB_SCANNER_MIN_LENGTH (gõ tay, phím lạc)
+    uint32_t overflows;            // Mã dài hơn REQUEST_DATA_LEN - 1
+    uint32_t unmapped;             // Phím không có ký tự trong bảng US
+    uint32_t rolloverErrors;       // Report báo quá nhiều phím cùng lúc (ErrorRollOver)
+};
+
+// Ghép phím từ máy quét barcode kiểu bàn phím USB (HID boot keyboard, bố cục US)
+// thành mã. Máy quét gõ cả mã trong vài ms rồi gửi Enter; giữa hai ký tự quá
+// USB_SCANNER_CHAR_TIMEOUT_MS thì mã đang gom được kết thúc (máy quét không cấu hình
+// hậu tố) hoặc bỏ nếu quá ngắn. Không chặn, không phụ thuộc Arduino: thời gian do
+// người gọi truyền vào, chạy được trong bench/hid_barcode_bench.
+class HidKeyboardDecoder {
+public:
+    // Nhận mỗi mã hoàn chỉnh (đã kết thúc bằng '\0')
+    typedef void (*BarcodeSink)(const char* barcode, uint8_t length, void* context);
+    
+    HidKeyboardDecoder(BarcodeSink sink, void* context);
+    
+    // Một input report boot keyboard: [modifier, reserved, key1..key6]
+    void feed(const uint8_t* report, size_t length, uint32_t nowMs);
+    // Gọi định kỳ (kể cả khi không có report) để kết thúc mã theo thời gian chờ
+    void tick(uint32_t nowMs);
+    // Bỏ mã đang gom (thiết bị rút ra)
+    void reset();
+    
+    uint8_t getPendingLength() const { return length; }
+    const HidDecoderStats& getStats() const { return stats; }
+    
+    // Ký tự của một usage ID (HID Usage Table, trang Keyboard/Keypad), 0 nếu không có
+    static char usageToChar(uint8_t usage, bool shift);
+    
+private:
+    void press(uint8_t usage, bool shift, uint32_t nowMs);
+    void finish(bool terminated);
+    
+    BarcodeSink sink;
+    void* context;
+    uint8_t previous[6];           // Phím đang giữ ở report trước: chỉ phím mới xuất hiện mới là lần nhấn
+    char buffer[REQUEST_DATA_LEN];
+    uint8_t length;
+    bool overflowed;
+    uint32_t lastKeyAt;
+    HidDecoderStats stats;
+};
+
+#endif // HID_KEYBOARD_DECODER_H
@@ -0,0 +1,88 @@
+#ifndef INVENTORY_SESSION_H
+#define INVENTORY_SESSION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "uid_set.h"
+#include "rfid_reader_pool.h"
+
+struct InventoryStats {
+    uint32_t reads;                // Lần chọn được nhãn (kể cả nhãn đã thấy)
+    uint32_t unique;
+    uint32_t duplicates;
+    uint32_t deferred;             // Nhãn mới bỏ qua vì hàng đợi gửi đầy (đọc lại ở lượt quét sau)
+    uint32_t unsupported;          // UID 10 byte
+    uint32_t uploaded;             // UID server đã nhận
+    uint32_t batches;
+    uint32_t uploadFailures;
+    uint32_t encodedBytes;         // UID đã nén (trước base64)
+    uint32_t hexBytes;             // Cùng số UID nếu gửi dạng mảng chuỗi hex JSON
+};
+
+// Phiên kiểm kê: đọc nhãn RFID nhanh nhất trường cho phép trên mọi đầu đọc, lọc UID trùng
+// bằng UidSet (bộ nhớ PSRAM cấp một lần) và gửi UID mới theo lô nén ở nền.
+// loop() ghi (poll), task mạng đọc hàng đợi gửi (peekPending/acknowledge): một bên ghi
+// head, một bên ghi tail nên không cần khóa.
+class InventorySession {
+public:
+    InventorySession();
+    
+    // Cấp bộ nhớ cho tập UID và hàng đợi gửi (gọi một lần trong setup)
+    bool begin();
+    
+    // Bắt đầu phiên mới (xóa tập UID) / kết thúc phiên; đổi timeout của các đầu đọc
+    void start(RFIDReaderPool& readers);
+    void stop(RFIDReaderPool& readers);
+    bool isActive() const { return active; }
+    
+    // Đọc nhãn liên tục trong INVENTORY_POLL_BUDGET_US. Trả về số nhãn mới
+    uint16_t poll(RFIDReaderPool& readers);
+    
+    // Có đủ một lô hoặc lô chưa đầy đã chờ quá INVENTORY_UPLOAD_INTERVAL
+    bool shouldUpload(uint32_t now) const;
+    
+    // Task mạng: copy tối đa max UID chờ gửi (cũ nhất trước, không xóa khỏi hàng đợi)
+    uint16_t peekPending(UidKey* keys, uint16_t max) const;
+    // Server đã nhận count UID đầu hàng đợi
+    void acknowledge(uint16_t count, size_t encodedBytes);
+    void countUploadFailure();
+    
+    uint32_t getPendingCount() const { return queueHead - queueTail; }
+    uint32_t getSessionId() const { return sessionId; }
+    uint32_t getSequence() const { return sequence; }
+    
+    // Nhãn đọc được mỗi giây (kể cả trùng): trung bình cả phiên và trong giây gần nhất
+    float tagsPerSecond() const;
+    float currentRate() const { return lastRate; }
+    // Tỉ lệ lần đọc trùng UID đã thấy
+    float duplicateRatio() const;
+    uint32_t getCollisionCount() const { return collisions; }
+    const InventoryStats& getStats() const { return stats; }
+    
+    // In thống kê ra Serial
+    void printStats() const;
+    
+private:
+    bool record(const uint8_t* uid, uint8_t length);
+    
+    UidSet* set;
+    UidKey* queue;                 // Vòng INVENTORY_UPLOAD_QUEUE UID mới chờ gửi
+    volatile uint32_t queueHead;   // loop() ghi
+    volatile uint32_t queueTail;   // Task mạng ghi
+    volatile uint32_t lastUploadAt;
+    volatile bool active;
+    uint32_t sessionId;
+    uint32_t sequence;             // Số lô đã được server nhận trong phiên
+    uint32_t startedAt;
+    uint32_t stoppedAt;
+    uint32_t windowStart;
+    uint32_t windowReads;
+    float lastRate;
+    uint32_t collisionBase;        // Tổng va chạm của các đầu đọc lúc bắt đầu phiên
+    uint32_t collisions;
+    InventoryStats stats;
+};
+
+extern InventorySession inventorySession;
+
+#endif // INVENTORY_SESSION_H
@@ -2,9 +2,15 @@
 #define LCD_HANDLER_H
 
 #include <Arduino.h>
-#include <LiquidCrystal_I2C.h>
 #include "config.h"
+#if DISPLAY_OLED
+#include "oled_display.h"
+#else
+#include <LiquidCrystal_I2C.h>
+#endif
 
+// Màn hình của trạm: LCD 16x2 (bỏ dấu, cắt 16 ký tự) hoặc OLED 128x64 khi
+// DISPLAY_OLED (giữ dấu, dòng đầu xuống dòng theo từ để hiện đủ tên)
 class LCDHandler {
 public:
     LCDHandler();
@@ -21,6 +27,12 @@ public:
     // Hiển thị thông tin sách
     void displayBook(const char* title, const char* code);
     
+    // Hiển thị tóm tắt phiếu mượn đang mở của sinh viên
+    void displayLoanSummary(uint8_t loanCount, uint8_t overdueCount);
+    
+    // Hiển thị hạn trả của sách sinh viên đang mượn
+    void displayLoanDue(const char* title, const char* dueDate, bool overdue);
+    
     // Hiển thị trạng thái
     void displayStatus(const char* status);
     
@@ -38,15 +50,22 @@ public:
     
     // Bật/tắt backlight
     void setBacklight(bool on);
-
+    
+    // In thời gian vẽ frame và số byte I2C (OLED)
+    void printStats() const;
+    
 private:
+    #if DISPLAY_OLED
+    OledDisplay oled;
+    #else
     LiquidCrystal_I2C* lcd;
+    #endif
     
-    // Helper: Cắt chuỗi cho vừa LCD (16 ký tự)
-    String truncateString(const char* str, int maxLen);
+    // Vẽ nội dung 2 dòng (UTF-8) lên backend đang dùng
+    void show(const char* line1, const char* line2 = "");
     
-    // Helper: Chuyển tiếng Việt có dấu sang không dấu (đơn giản)
-    String removeVietnameseTones(const char* str);
+    // Helper: Chuyển tiếng Việt có dấu sang không dấu (theo bảng glyph), cắt theo outputSize
+    void removeVietnameseTones(const char* str, char* output, size_t outputSize);
 };
 
 #endif // LCD_HANDLER_H
@@ -0,0 +1,52 @@
+#ifndef LOAN_SESSION_H
+#define LOAN_SESSION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "api_types.h"
+
+// Phiên làm việc của sinh viên vừa quét thẻ.
+// Giữ danh sách phiếu mượn đang mở để các lần quét sách sau đó
+// (trả sách, kiểm tra quá hạn) được đối chiếu ngay trên trạm, không cần gọi API.
+class LoanSession {
+public:
+    LoanSession();
+    
+    // Bắt đầu phiên mới từ response quét thẻ (thay thế phiên cũ)
+    void start(const StudentInfo& student);
+    
+    // Kết thúc phiên hiện tại
+    void end();
+    
+    // Phiên còn hiệu lực không (tự hết hạn sau STUDENT_SESSION_TIMEOUT)
+    bool isActive();
+    
+    // Gia hạn phiên mỗi khi có thao tác mới
+    void touch();
+    
+    // Tìm phiếu mượn theo mã sách, trả về nullptr nếu sinh viên không mượn sách này
+    const LoanInfo* findByBookCode(const char* bookCode);
+    
+    // Đánh dấu sách đã trả (xóa khỏi danh sách trên trạm)
+    bool markReturned(const char* bookCode);
+    
+    const char* getMSSV() const { return mssv; }
+    const char* getName() const { return name; }
+    uint8_t getLoanCount() const { return loanCount; }
+    uint8_t getOverdueCount() const;
+    const LoanInfo& getLoan(uint8_t index) const { return loans[index]; }
+    
+    // Danh sách có thể thiếu (server có nhiều phiếu hơn MAX_ACTIVE_LOANS)
+    bool isTruncated() const { return truncated; }
+
+private:
+    bool active;
+    char mssv[INFO_MSSV_LEN];
+    char name[INFO_NAME_LEN];
+    LoanInfo loans[MAX_ACTIVE_LOANS];
+    uint8_t loanCount;
+    bool truncated;
+    unsigned long lastActivity;
+};
+
+#endif // LOAN_SESSION_H
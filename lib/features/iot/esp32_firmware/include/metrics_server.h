@@ -0,0 +1,40 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+#include "station_metrics.h"
+
+// Ghi toàn bộ số liệu của trạm cho một lần scrape (do main.cpp cung cấp)
+typedef void (*MetricsCollector)(MetricsWriter& out);
+
+// Endpoint GET /metrics dạng Prometheus text. Chạy trong task riêng, ưu tiên thấp
+// hơn task mạng và loop(): một lần scrape chỉ đọc số liệu đang có, không chờ
+// khóa nào của luồng quét, nên không làm chậm request quét thẻ/sách.
+class MetricsServer {
+public:
+    MetricsServer(MetricsCollector collector, uint16_t port = METRICS_PORT);
+    
+    // Cấp buffer và khởi động task (gọi sau khi có WiFi)
+    bool begin();
+    
+    TaskHandle_t getTaskHandle() const { return taskHandle; }
+    uint32_t getScrapeCount() const { return scrapes; }
+    
+private:
+    static void taskEntry(void* param);
+    void run();
+    void handle(WiFiClient& client);
+    bool readRequestLine(WiFiClient& client, char* line, size_t capacity);
+    void respond(WiFiClient& client, const char* status, const char* body, size_t length);
+    
+    WiFiServer server;
+    MetricsCollector collector;
+    TaskHandle_t taskHandle;
+    char* buffer;
+    uint32_t scrapes;
+    uint32_t lastRenderUs;             // Thời gian dựng nội dung lần scrape trước
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,45 @@
+#ifndef OLED_DISPLAY_H
+#define OLED_DISPLAY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "oled_framebuffer.h"
+
+// Thống kê flush: thời gian một frame và số byte trên dây I2C
+struct OledStats {
+    uint32_t frames;
+    uint32_t lastFrameUs;
+    uint32_t maxFrameUs;
+    uint32_t lastFrameBytes;
+    uint64_t totalBytes;
+    uint32_t errors;               // Transaction không nhận ACK
+};
+
+// OLED SSD1306 128x64 qua I2C (Wire). Vẽ vào frame(), flush() chỉ gửi các
+// đoạn cột đã đổi (addressing mode ngang, đặt vùng bằng lệnh 0x21/0x22).
+class OledDisplay {
+public:
+    explicit OledDisplay(uint8_t address = OLED_ADDRESS);
+    
+    // Gửi chuỗi khởi tạo; Wire phải đã begin. false nếu không thấy màn hình
+    bool begin();
+    
+    OledFramebuffer& frame() { return framebuffer; }
+    
+    void flush();
+    
+    // Tắt/bật panel (OLED không có backlight)
+    void setPower(bool on);
+    
+    const OledStats& getStats() const { return stats; }
+    
+private:
+    bool sendCommands(const uint8_t* commands, uint8_t count);
+    bool sendData(const uint8_t* data, uint8_t length);
+    
+    uint8_t address;
+    OledFramebuffer framebuffer;
+    OledStats stats;
+};
+
+#endif // OLED_DISPLAY_H
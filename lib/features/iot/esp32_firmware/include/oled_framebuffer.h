@@ -0,0 +1,63 @@
+#ifndef OLED_FRAMEBUFFER_H
+#define OLED_FRAMEBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "glyph_atlas.h"
+
+#define OLED_WIDTH 128
+#define OLED_HEIGHT 64
+#define OLED_PAGES (OLED_HEIGHT / 8)
+#define OLED_TEXT_COLS (OLED_WIDTH / GLYPH_WIDTH)      // 21 ký tự mỗi dòng
+#define OLED_TEXT_ROWS (OLED_HEIGHT / GLYPH_HEIGHT)    // 4 dòng
+#define OLED_I2C_CHUNK 64                              // Byte dữ liệu mỗi transaction (buffer Wire 128)
+
+// Đoạn cột [start, end) của một trang cần gửi lên màn hình
+struct OledSpan {
+    uint8_t page;
+    uint8_t start;
+    uint8_t end;
+};
+
+// Framebuffer theo trang của SSD1306 (8 trang x 128 cột, mỗi byte = 8 điểm dọc).
+// Giữ thêm bản sao nội dung đang hiện trên màn hình: flush chỉ gửi đoạn cột
+// thật sự khác trong các trang đã vẽ lại, vẽ lại cùng nội dung thì không gửi gì.
+// Không phụ thuộc Arduino (OledDisplay lo phần I2C), chạy được trên máy host.
+class OledFramebuffer {
+public:
+    OledFramebuffer();
+    
+    void clear();
+    
+    // Vẽ chuỗi UTF-8 ở dòng chữ row (0..OLED_TEXT_ROWS-1) từ cột ký tự col,
+    // tối đa maxChars ký tự. Trả về số ký tự đã vẽ
+    uint8_t drawText(uint8_t row, uint8_t col, const char* text, uint8_t maxChars = OLED_TEXT_COLS);
+    
+    // Vẽ chuỗi UTF-8 xuống dòng theo từ từ dòng row, tối đa maxRows dòng.
+    // Trả về số dòng đã dùng
+    uint8_t drawWrapped(uint8_t row, const char* text, uint8_t maxRows);
+    
+    // Đoạn thay đổi tiếp theo so với nội dung trên màn hình, false nếu không còn.
+    // Gọi markShown() sau khi đã gửi xong đoạn đó
+    bool nextSpan(OledSpan& span);
+    void markShown(const OledSpan& span);
+    
+    // Màn hình mất nội dung (khởi động, bật lại nguồn): lần flush sau gửi toàn bộ
+    void invalidate();
+    
+    const uint8_t* pageData(uint8_t page) const { return buffer[page]; }
+    
+    // Số byte trên dây I2C để gửi một đoạn (địa chỉ + byte điều khiển + lệnh + dữ liệu)
+    static uint32_t i2cBytes(const OledSpan& span);
+    
+private:
+    void drawGlyph(uint8_t row, uint8_t col, uint32_t codepoint);
+    uint8_t drawRange(uint8_t row, uint8_t col, const char* text, const char* end, uint8_t maxChars);
+    
+    uint8_t buffer[OLED_PAGES][OLED_WIDTH];
+    uint8_t shown[OLED_PAGES][OLED_WIDTH];
+    uint8_t dirtyPages;            // Bit mask các trang đã vẽ lại từ lần flush trước
+    uint8_t stalePages;            // Trang chưa biết nội dung trên màn hình: gửi cả trang
+};
+
+#endif // OLED_FRAMEBUFFER_H
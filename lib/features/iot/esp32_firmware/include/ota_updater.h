@@ -0,0 +1,106 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/md.h>
+#include "config.h"
+#include "delta_patch.h"
+
+enum OtaMode : uint8_t {
+    OTA_DELTA,                 // Bản vá so với firmware đang chạy
+    OTA_FULL,                  // Ảnh đầy đủ (server không có bản vá cho bản đang chạy)
+    OTA_MODE_COUNT
+};
+
+// Số liệu theo từng cách cập nhật, để so byte tải về và thời gian của bản vá với ảnh đầy đủ
+struct OtaModeStats {
+    uint32_t updates;              // Lần ghi xong và đã chuyển phân vùng khởi động
+    uint32_t failures;
+    uint32_t downloadBytes;        // Body đã tải (bản vá hoặc ảnh)
+    uint32_t imageBytes;           // Ảnh firmware đã ghi
+    uint32_t lastMs;               // Lần gần nhất: từ lúc nhận header HTTP tới khi ghi xong
+    uint32_t verifyMs;             // Bản vá: kiểm tra SHA-256 ảnh đang chạy (nằm trong lastMs)
+};
+
+struct OtaStats {
+    uint32_t checks;               // Lần hỏi server
+    uint32_t upToDate;             // Server trả 204
+    OtaModeStats modes[OTA_MODE_COUNT];
+    DeltaStatus lastDelta;         // Kết quả áp dụng bản vá gần nhất
+    const char* lastResult;
+};
+
+// Ghi firmware mới vào phân vùng OTA còn lại trong lúc tải: bản vá đi qua DeltaPatcher (đọc
+// phân vùng đang chạy làm ảnh nguồn), ảnh đầy đủ ghi thẳng. Chỉ chuyển phân vùng khởi động khi
+// ảnh đã kiểm tra xong (SHA-256 trong bản vá, esp_ota_end() kiểm tra ảnh ESP32, và chữ ký của
+// server trên SHA-256 ảnh đã ghi khớp OTA_SIGNING_PUBKEY); khởi động lại do loop() làm lúc trạm
+// rảnh. Chỉ task mạng gọi begin/write/finish.
+class OtaUpdater {
+public:
+    OtaUpdater();
+    
+    // app_elf_sha256 của firmware đang chạy (hex), server chọn bản vá theo giá trị này
+    bool getRunningBuild(char* hex, size_t capacity) const;
+    
+    void countCheck(bool upToDate);
+    
+    // Bắt đầu nhận body. imageSize < 0: ảnh đầy đủ không rõ độ dài.
+    // signature: header X-Firmware-Signature (base64); thiếu hoặc hỏng thì không tải
+    bool begin(OtaMode mode, int32_t imageSize, const char* signature);
+    // Một đoạn body; false nếu phải dừng (bản vá lỗi, ghi flash lỗi)
+    bool write(const uint8_t* data, size_t length);
+    // Sau khi tải xong (received = số byte body đã đọc, âm nếu lỗi giữa chừng):
+    // kiểm tra ảnh và chuyển phân vùng khởi động. true nếu cần khởi động lại
+    bool finish(int received);
+    
+    bool isRestartPending() const { return restartPending; }
+    const OtaStats& getStats() const { return stats; }
+    
+    // In thống kê ra Serial
+    void printStats() const;
+    
+private:
+    // Ảnh nguồn của bản vá: phân vùng đang chạy
+    class PartitionSource : public DeltaSource {
+    public:
+        const esp_partition_t* partition;
+        uint32_t size() override { return partition->size; }
+        bool read(uint32_t offset, uint8_t* buffer, size_t length) override;
+    };
+    
+    // Ảnh đích: phân vùng OTA còn lại, xóa theo kích thước ảnh trong esp_ota_begin().
+    // Băm mọi byte đã ghi để kiểm tra chữ ký
+    class PartitionSink : public DeltaSink {
+    public:
+        const esp_partition_t* partition;
+        esp_ota_handle_t handle;
+        bool open;
+        mbedtls_md_context_t hash;
+        bool hashReady;
+        bool begin(uint32_t targetSize) override;
+        bool write(const uint8_t* data, size_t length) override;
+    };
+    
+    bool verifySignature();
+    void fail(const char* result);
+    void logProgress(uint32_t written, uint32_t total);
+    
+    DeltaPatcher patcher;
+    PartitionSource source;
+    PartitionSink sink;
+    OtaMode mode;
+    bool active;
+    uint32_t startedAt;
+    uint32_t downloaded;
+    uint32_t imageSize;            // 0 = chưa biết (ảnh đầy đủ, chunked)
+    uint8_t progressStep;          // Phần mười đã báo ra Serial
+    uint8_t signature[OTA_SIGNATURE_MAX];
+    size_t signatureLength;
+    volatile bool restartPending;
+    OtaStats stats;
+};
+
+extern OtaUpdater otaUpdater;
+
+#endif // OTA_UPDATER_H
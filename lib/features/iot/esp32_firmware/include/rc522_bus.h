@@ -0,0 +1,31 @@
+#ifndef RC522_BUS_H
+#define RC522_BUS_H
+
+#include <stdint.h>
+
+// Số frame tối đa trong một lần submit (một lệnh transceive cần 7 frame)
+#define RC522_MAX_BATCH 8
+
+// Một frame SPI = một lần kéo CS xuống. Byte đầu là địa chỉ thanh ghi
+// ((reg << 1) | 0x80 khi đọc), các byte sau là dữ liệu.
+struct Rc522Frame {
+    const uint8_t* tx;
+    uint8_t* rx;               // nullptr nếu bỏ qua dữ liệu nhận
+    uint8_t length;
+};
+
+// Bus tới một chip RC522. Trên trạm là SPI DMA của ESP-IDF (rc522_spi_bus.h),
+// trên máy host là chip giả lập hoặc transcript SPI đã ghi (bench/).
+class Rc522Bus {
+public:
+    virtual ~Rc522Bus() {}
+    
+    // Xếp cả chuỗi frame vào hàng đợi rồi trả về ngay. Bộ nhớ tx/rx phải giữ
+    // nguyên tới khi done() trả về true. false nếu bus đang bận
+    virtual bool submit(const Rc522Frame* frames, uint8_t count) = 0;
+    
+    // true khi mọi frame đã submit đã truyền xong (không chặn)
+    virtual bool done() = 0;
+};
+
+#endif // RC522_BUS_H
@@ -0,0 +1,121 @@
+#ifndef RC522_DRIVER_H
+#define RC522_DRIVER_H
+
+#include <stdint.h>
+#include "rc522_bus.h"
+#include "card_store.h"
+
+#define RC522_FIFO_SIZE 64
+#define RC522_MAX_STATUS_POLLS 5000   // Chốt an toàn nếu timer của chip không báo
+#define RC522_DEFAULT_TIMEOUT_US 25000  // Timer sau init(): đủ cho lệnh ghi MIFARE
+
+enum Rc522Poll : uint8_t {
+    RC522_BUSY,         // Đang chờ bus/thẻ, gọi lại service() ở vòng sau
+    RC522_NO_CARD,
+    RC522_CARD,         // Đã chọn thẻ, uid()/getSak() hợp lệ
+    RC522_ERROR         // Lỗi CRC/BCC hoặc va chạm không giải được, thử lại ở lần sau
+};
+
+// Driver RC522 riêng của trạm: gom các lần ghi thanh ghi + FIFO của một lệnh
+// thành một chuỗi frame gửi qua Rc522Bus, CRC_A tính bằng phần mềm thay vì
+// dùng bộ CalcCRC của chip. Phát hiện thẻ (REQA/anticollision/select) chạy
+// theo máy trạng thái: mỗi lần service() chỉ xếp frame rồi trả về.
+// Nhiều thẻ cùng trả lời thì anticollision đi theo bit (ISO 14443-3): chọn nhánh
+// bit 1 ở vị trí va chạm và hỏi lại; thẻ còn lại trả lời sau khi thẻ này HLTA.
+// Đọc/ghi bộ nhớ thẻ (PiccTransport) vẫn chờ kết quả vì chỉ dùng sau khi đã chọn thẻ.
+class Rc522Driver : public PiccTransport {
+public:
+    explicit Rc522Driver(Rc522Bus& bus);
+    
+    // Soft reset + cấu hình timer/antenna (chờ kết quả, chỉ gọi lúc khởi động).
+    // Trả về VersionReg, 0x00/0xFF nếu không thấy chip
+    uint8_t init();
+    
+    // Thời gian chờ thẻ trả lời (timer của chip, mặc định 25 ms cho lệnh ghi MIFARE).
+    // Chỉ gọi khi service() không đang giữa chừng (chờ kết quả)
+    void setResponseTimeout(uint32_t microseconds);
+    
+    // Đọc VersionReg và chờ kết quả (một frame SPI): dùng để đo RTT thanh ghi khi tự kiểm tra.
+    // Chỉ gọi khi service() không đang giữa chừng, như setResponseTimeout
+    uint8_t readVersion();
+    
+    // Một bước phát hiện thẻ
+    Rc522Poll service();
+    
+    // HLTA + tắt Crypto1, hoàn tất ở các lần service() tiếp theo
+    void halt();
+    
+    uint8_t getSak() const { return sak; }
+    
+    // Số lần va chạm đã giải (nhiều thẻ trong trường cùng lúc)
+    uint32_t getCollisionCount() const { return collisions; }
+    
+    // PiccTransport
+    PiccKind kind() override;
+    const uint8_t* uid(uint8_t& length) override;
+    bool authenticate(uint8_t block, const uint8_t key[6]) override;
+    bool read16(uint8_t block, uint8_t output[16]) override;
+    bool writeBlock(uint8_t block, const uint8_t data[16]) override;
+    bool writePage(uint8_t page, const uint8_t data[4]) override;
+    
+    // CRC_A (ISO/IEC 14443-3), ghi 2 byte LSB trước vào output
+    static void crcA(const uint8_t* data, uint8_t length, uint8_t output[2]);
+    
+private:
+    enum Result : uint8_t { EX_BUSY, EX_OK, EX_TIMEOUT, EX_ERROR, EX_COLLISION };
+    enum Stage : uint8_t { STAGE_IDLE, STAGE_REQA, STAGE_ANTICOLL, STAGE_SELECT, STAGE_HALT, STAGE_STOP_CRYPTO };
+    enum Step : uint8_t { STEP_NONE, STEP_COMMAND, STEP_STATUS, STEP_FIFO, STEP_COLLISION };
+    
+    // Gom frame
+    void resetBatch();
+    void addWrite(uint8_t reg, uint8_t value);
+    void addFifoWrite(const uint8_t* data, uint8_t length);
+    void submitBatch();
+    void waitBus();
+    
+    // Thanh ghi đơn lẻ (chờ kết quả, chỉ dùng lúc init)
+    void writeRegister(uint8_t reg, uint8_t value);
+    uint8_t readRegister(uint8_t reg);
+    
+    // Một lệnh tới thẻ: ghi FIFO + lệnh, đọc trạng thái tới khi xong, đọc FIFO.
+    // bitFraming = BitFramingReg (RxAlign << 4 | TxLastBits)
+    void beginExchange(uint8_t command, const uint8_t* data, uint8_t length, uint8_t bitFraming);
+    void submitStatusRead();
+    Result stepExchange();
+    Result runExchange(uint8_t command, const uint8_t* data, uint8_t length, uint8_t txLastBits);
+    Result transceiveWithCrc(uint8_t* data, uint8_t length);
+    bool isAck() const;
+    
+    Rc522Poll beginSelectLevel();
+    Rc522Poll sendAnticollision();
+    Rc522Poll finishStep(Rc522Poll result);
+    
+    Rc522Bus& bus;
+    Rc522Frame frames[RC522_MAX_BATCH];
+    uint8_t frameCount;
+    alignas(4) uint8_t tx[RC522_FIFO_SIZE + 16];
+    alignas(4) uint8_t rx[RC522_FIFO_SIZE + 16];
+    uint8_t txUsed;
+    
+    // Trạng thái lệnh đang chạy
+    Step step;
+    uint8_t waitIrq;
+    uint16_t statusPolls;
+    uint8_t response[RC522_FIFO_SIZE];
+    uint8_t responseLength;
+    uint8_t responseLastBits;
+    uint8_t collisionPos;      // CollReg.CollPos của lần va chạm gần nhất (0 = bit 32)
+    bool crypto1On;
+    
+    // Trạng thái phát hiện thẻ
+    Stage stage;
+    uint8_t cascadeLevel;
+    uint8_t levelBytes[5];     // 4 byte UID (hoặc CT + 3 byte) + BCC của mức hiện tại
+    uint8_t knownBits;         // Số bit đầu của mức hiện tại đã chọn qua các lần va chạm
+    uint8_t uidBytes[10];
+    uint8_t uidLength;
+    uint8_t sak;
+    uint32_t collisions;
+};
+
+#endif // RC522_DRIVER_H
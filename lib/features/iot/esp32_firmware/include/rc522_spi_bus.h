@@ -0,0 +1,32 @@
+#ifndef RC522_SPI_BUS_H
+#define RC522_SPI_BUS_H
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+#include "config.h"
+#include "rc522_bus.h"
+
+// Rc522Bus trên SPI2 của ESP32-S3 qua driver ESP-IDF: mỗi frame là một
+// transaction DMA, CS do phần cứng điều khiển, cả batch được xếp hàng một lần
+// và CPU không phải chờ từng byte như SPI.transfer().
+class Rc522SpiBus : public Rc522Bus {
+public:
+    explicit Rc522SpiBus(uint8_t csPin);
+    
+    // Khởi tạo bus SPI2 + DMA (một lần cho mọi đầu đọc)
+    static bool beginBus();
+    
+    // Thêm thiết bị với chân CS riêng, clock RFID_SPI_CLOCK_HZ
+    bool begin();
+    
+    bool submit(const Rc522Frame* frames, uint8_t count) override;
+    bool done() override;
+
+private:
+    uint8_t csPin;
+    spi_device_handle_t device;
+    spi_transaction_t transactions[RC522_MAX_BATCH];
+    uint8_t inFlight;
+};
+
+#endif // RC522_SPI_BUS_H
@@ -0,0 +1,174 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "api_client.h"
+
+// Độ ưu tiên của request (số nhỏ = ưu tiên cao)
+enum RequestPriority : uint8_t {
+    PRIORITY_SCAN = 0,        // Quét thẻ/sách - người dùng đang chờ
+    PRIORITY_REPLAY = 1,      // Gửi lại request quét bị lỗi kết nối
+    PRIORITY_HEARTBEAT = 2,   // Heartbeat định kỳ, lô UID kiểm kê, tự kiểm tra, cập nhật firmware
+    PRIORITY_COUNT = 3
+};
+
+enum RequestType : uint8_t {
+    REQUEST_STUDENT_SCAN,
+    REQUEST_BOOK_SCAN,
+    REQUEST_HEARTBEAT,
+    REQUEST_INVENTORY,
+    REQUEST_BENCHMARK,
+    REQUEST_FIRMWARE_UPDATE
+};
+
+// Thống kê thời gian chờ trong hàng đợi cho từng mức ưu tiên
+struct QueueStats {
+    uint32_t served;
+    uint32_t dropped;
+    uint32_t totalWaitUs;
+    uint32_t maxWaitUs;
+};
+
+// Thống kê gom batch: số request gộp đã gửi và thời gian chờ gom thêm
+struct BatchStats {
+    uint32_t batches;          // Request gộp (>= 2 lần quét)
+    uint32_t batchedScans;     // Tổng số lần quét đi trong request gộp
+    uint32_t totalWaitUs;      // Thời gian chờ thêm do cửa sổ gom (mọi lần gửi quét)
+    uint32_t maxWaitUs;
+};
+
+// Bộ lập lịch request: mọi request HTTP đi qua một task mạng duy nhất.
+// Task luôn lấy request có độ ưu tiên cao nhất, nên một lần quét thẻ không phải
+// chờ sau heartbeat hay các request đang gửi lại. Khi các lần quét tới dồn dập,
+// task gom chúng trong một cửa sổ ngắn và gửi thành một request (BATCH_ENABLED).
+class RequestScheduler {
+public:
+    RequestScheduler(APIClient& client);
+    
+    // Tạo hàng đợi và task mạng
+    bool begin();
+    
+    // Quét thẻ sinh viên (chặn tới khi có kết quả)
+    StudentInfo scanStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace);
+    
+    // Quét thẻ sinh viên ở nền (không chặn), lấy kết quả bằng pollStudentResult
+    bool submitStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace);
+    
+    // Lấy kết quả của submitStudentCard nếu đã xong
+    bool pollStudentResult(StudentInfo& result);
+    
+    // Quét barcode sách (chặn tới khi có kết quả)
+    BookInfo scanBookBarcode(const char* barcode, const ScanTrace& trace);
+    
+    // Xếp heartbeat vào hàng đợi. Trả về false nếu bỏ qua vì vừa có request quét thành công
+    // (server coi request quét như heartbeat), nhưng không quá HEARTBEAT_MAX_PIGGYBACK lần liên tiếp
+    bool requestHeartbeat();
+    
+    #if INVENTORY_ENABLED
+    // Xếp một lần gửi lô UID kiểm kê (chạy nền, cùng mức với heartbeat).
+    // Trả về false nếu lần gửi trước còn trong hàng đợi
+    bool requestInventoryUpload();
+    #endif
+    
+    #if OTA_ENABLED
+    // Xếp một lần kiểm tra/tải firmware mới (chạy nền, cùng mức với heartbeat; lệnh "ota" hoặc
+    // heartbeat báo có bản mới). Trả về false nếu lần trước còn trong hàng đợi
+    bool requestFirmwareUpdate();
+    #endif
+    
+    #if SELF_BENCH_ENABLED
+    // Phần đo mạng của tự kiểm tra (RTT HTTP, throughput) và gửi báo cáo, chạy trên task mạng
+    // sau các request quét/gửi lại đang chờ. Chặn tới khi xong; server đang bắt chờ (429/503)
+    // thì trả về ngay với report.httpCode = 503. false nếu hàng đợi đầy
+    bool runBenchmark(BenchReport& report);
+    #endif
+    
+    // Thống kê theo mức ưu tiên
+    const QueueStats& getStats(RequestPriority priority) const { return stats[priority]; }
+    uint32_t getPendingCount(RequestPriority priority) const;
+    uint32_t getHeartbeatsPiggybacked() const { return heartbeatsPiggybacked; }
+    const BatchStats& getBatchStats() const { return batchStats; }
+    
+    // Cửa sổ gom hiện tại (ms), 0 khi lưu lượng thấp
+    uint32_t getBatchWindowMs() const;
+    TaskHandle_t getTaskHandle() const { return taskHandle; }
+    
+    // In thống kê ra Serial
+    void printStats() const;
+    
+private:
+    // Request nằm trong hàng đợi (copy theo giá trị vào FreeRTOS queue)
+    struct QueuedRequest {
+        RequestType type;
+        RequestPriority priority;
+        uint8_t attempts;
+        bool notify;               // Đẩy kết quả vào hàng đợi completions
+        ScanSource source;         // Đầu đọc/làn của lần quét thẻ
+        char data[REQUEST_DATA_LEN];
+        ScanTrace trace;           // Vết của lần quét; lần gửi lại giữ nguyên trace ID
+        uint32_t enqueuedAtUs;
+        unsigned long notBefore;   // Gửi lại: chưa tới hạn thì chưa gửi
+        void* result;              // StudentInfo*/BookInfo* của người gọi, nullptr = chạy nền
+        SemaphoreHandle_t done;    // Báo cho người gọi khi có kết quả
+    };
+    
+    APIClient& apiClient;
+    QueueHandle_t queues[PRIORITY_COUNT];
+    SemaphoreHandle_t pending;       // Đếm tổng số request đang chờ
+    SemaphoreHandle_t interactiveDone;
+    SemaphoreHandle_t interactiveLock;
+    QueueHandle_t completions;       // Kết quả quét thẻ chạy nền
+    TaskHandle_t taskHandle;
+    
+    QueueStats stats[PRIORITY_COUNT];
+    uint32_t heartbeatsPiggybacked;
+    uint8_t piggybackStreak;         // Số heartbeat liên tiếp đã bỏ nhờ lần quét
+    volatile unsigned long lastScanSuccess;
+    volatile bool heartbeatQueued;
+    volatile bool inventoryQueued;
+    volatile bool firmwareQueued;
+    
+    // Gom batch: request đang gom và kết quả của chúng (chỉ task mạng dùng)
+    QueuedRequest batch[BATCH_MAX_ITEMS];
+    StudentInfo batchStudents[BATCH_MAX_ITEMS];
+    BookInfo batchBooks[BATCH_MAX_ITEMS];
+    BatchStats batchStats;
+    bool batchSupported;                  // false khi server trả 404 cho API_SCAN_BATCH
+    volatile uint32_t lastScanArrival;    // millis() lần quét gần nhất được xếp hàng
+    volatile uint32_t scanGapEwmaMs;      // Khoảng cách trung bình giữa các lần quét
+    
+    bool enqueue(QueuedRequest& request);
+    // Đưa request vào cuối hàng đợi của nó; đầy thì đếm vào dropped và trả về false
+    bool push(QueuedRequest& request);
+    // Request đầu hàng đợi đã tới hạn, ưu tiên cao trước. Không có thì waitMs = thời gian tới
+    // hạn sớm nhất (portMAX_DELAY nếu mọi hàng đợi trống)
+    bool takeNext(QueuedRequest& request, uint32_t& waitMs);
+    // Request nền bị bỏ khỏi hàng đợi: cho phép xếp lại lần sau
+    void clearQueued(RequestType type);
+    bool takeScan(QueuedRequest& request);
+    void recordArrival();
+    uint8_t gatherBatch(const QueuedRequest& first);
+    void executeBatch(uint8_t count);
+    // Gửi một request vừa lấy khỏi hàng đợi: backpressure, gom batch, rồi execute
+    void serve(QueuedRequest& request);
+    void execute(QueuedRequest& request);
+    void dispatch(QueuedRequest& request);
+    // sent = false: lần quét chưa được gửi đi (server quá tải), không tính vào số lần gửi lại
+    void finishStudent(const QueuedRequest& request, const StudentInfo& info, bool sent);
+    void finishBook(const QueuedRequest& request, const BookInfo& info, bool sent);
+    void scheduleReplay(const QueuedRequest& request, bool sent);
+    bool holdBack(QueuedRequest& request);
+    void rejectOverloaded(QueuedRequest& request);
+    void recordWait(const QueuedRequest& request);
+    
+    #if OTA_ENABLED
+    // Giữa các đoạn tải firmware: gửi các lần quét đã tới hạn đang chờ trong hàng đợi
+    static void serveScans(void* param);
+    #endif
+    
+    static void taskEntry(void* param);
+    void run();
+};
+
+#endif // REQUEST_SCHEDULER_H
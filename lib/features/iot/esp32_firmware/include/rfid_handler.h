@@ -2,34 +2,61 @@
 #define RFID_HANDLER_H
 
 #include <Arduino.h>
-#include <MFRC522.h>
-#include <SPI.h>
 #include "config.h"
+#include "card_store.h"
+#include "rc522_driver.h"
+#include "rc522_spi_bus.h"
 
 class RFIDHandler {
 public:
-    RFIDHandler();
+    RFIDHandler(uint8_t csPin = RFID_CS_PIN, uint8_t rstPin = RFID_RST_PIN);
     
-    // Khởi tạo RFID reader
+    // Khởi tạo RFID reader (bus SPI phải được Rc522SpiBus::beginBus() trước)
     bool begin();
     
-    // Kiểm tra có thẻ mới không
+    // Kiểm tra có thẻ mới không (không chặn: mỗi lần gọi chạy một bước của driver)
     bool hasNewCard();
     
-    // Đọc UID thẻ
-    String readCardUID();
+    // Đọc UID thẻ (chuỗi hex, hợp lệ tới lần quét tiếp theo)
+    const char* readCardUID();
+    
+    #if CARD_DATA_MODE
+    // Đọc bản ghi sinh viên đã ký trên thẻ (gọi trước haltCard)
+    CardRecordStatus readStudentRecord(StudentCardRecord& record);
+    
+    // Ghi bản ghi sinh viên lên thẻ đang đặt trên đầu đọc
+    CardRecordStatus writeStudentRecord(const StudentCardRecord& record);
+    #endif
     
     // Dừng đọc thẻ hiện tại
     void haltCard();
-
+    
+    // Kiểm kê: timeout trả lời ngắn (chỉ phát hiện, không đọc/ghi bộ nhớ thẻ)
+    void setInventoryMode(bool enabled);
+    
+    // Kiểm kê: chọn nhãn tiếp theo trong trường rồi HLTA ngay (không debounce) để lần gọi
+    // sau chọn nhãn khác; nhãn đã HLTA im lặng tới khi rời khỏi trường. uid cần 10 byte
+    bool readInventoryTag(uint8_t* uid, uint8_t& length);
+    
+    uint32_t getCollisionCount() const { return driver.getCollisionCount(); }
+    
+    // Tự kiểm tra: chạy nốt lệnh đang dở rồi đọc VersionReg count lần, thời gian từng lần (µs)
+    // ghi vào samplesUs. Trả về số lần đọc ra giá trị khác lúc khởi động (dây SPI lỏng, nhiễu)
+    uint16_t benchmarkRegisters(uint32_t* samplesUs, uint16_t count);
+    uint8_t getVersion() const { return version; }
+    
 private:
-    MFRC522* rfid;
-    String lastUID;
+    Rc522SpiBus bus;
+    Rc522Driver driver;
+    uint8_t csPin;
+    uint8_t rstPin;
+    uint8_t version;           // VersionReg lúc khởi động
+    char currentUID[UID_STRING_LEN];
+    char lastUID[UID_STRING_LEN];
     unsigned long lastReadTime;
-    const unsigned long debounceTime = 2000; // 2 giây debounce
     
-    // Helper: Convert byte array to hex string
-    String byteArrayToHexString(byte* buffer, byte bufferSize);
+    // Helper: Convert byte array to hex string (ghi vào buffer, không cấp phát)
+    void byteArrayToHexString(const byte* buffer, byte bufferSize, char* output, size_t outputSize);
 };
 
 #endif // RFID_HANDLER_H
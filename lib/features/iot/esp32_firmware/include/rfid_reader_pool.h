@@ -0,0 +1,58 @@
+#ifndef RFID_READER_POOL_H
+#define RFID_READER_POOL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "api_types.h"
+#include "rfid_handler.h"
+
+// Một lần phát hiện thẻ, gắn với đầu đọc đã thấy thẻ
+struct RFIDEvent {
+    ScanSource source;
+    const char* uid;           // Hợp lệ tới lần quét tiếp theo của cùng đầu đọc
+};
+
+// Thống kê độ trễ phát hiện của một đầu đọc
+struct ReaderStats {
+    uint32_t polls;
+    uint32_t detections;
+    uint32_t lastCycleUs;      // Khoảng cách giữa hai lần poll liên tiếp
+    uint32_t maxCycleUs;
+    uint32_t lastLatencyUs;    // Chu kỳ poll + thời gian đọc UID của lần phát hiện gần nhất
+    uint32_t maxLatencyUs;
+    uint64_t totalLatencyUs;
+};
+
+// Nhiều đầu đọc RC522 dùng chung bus SPI, poll xoay vòng (time-multiplexed).
+// Mỗi lần poll() bắt đầu từ đầu đọc ngay sau đầu đọc vừa phát hiện thẻ,
+// nên một làn đông khách không chặn được các làn còn lại.
+class RFIDReaderPool {
+public:
+    RFIDReaderPool();
+    
+    // Khởi tạo bus SPI và từng đầu đọc. true nếu có ít nhất một đầu đọc hoạt động
+    bool begin();
+    
+    // Poll mỗi đầu đọc đang hoạt động tối đa một lần, trả về thẻ đầu tiên phát hiện được
+    bool poll(RFIDEvent& event);
+    
+    RFIDHandler& reader(uint8_t index) { return *readers[index]; }
+    uint8_t getReaderCount() const { return RFID_READER_COUNT; }
+    uint8_t getActiveCount() const;
+    bool isActive(uint8_t index) const { return active[index]; }
+    ScanLane getLane(uint8_t index) const { return lanes[index]; }
+    const ReaderStats& getStats(uint8_t index) const { return stats[index]; }
+    
+    // In thống kê ra Serial
+    void printStats() const;
+
+private:
+    RFIDHandler* readers[RFID_READER_COUNT];
+    ScanLane lanes[RFID_READER_COUNT];
+    bool active[RFID_READER_COUNT];
+    ReaderStats stats[RFID_READER_COUNT];
+    uint32_t lastPollUs[RFID_READER_COUNT];
+    uint8_t next;
+};
+
+#endif // RFID_READER_POOL_H
@@ -0,0 +1,87 @@
+#ifndef SCAN_ARENA_H
+#define SCAN_ARENA_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Bump allocator cho dữ liệu tạm của một lần quét.
+// Vùng nhớ được cấp một lần lúc khởi động (ưu tiên PSRAM) và không bao giờ free,
+// mỗi giao dịch chỉ dời con trỏ; kết thúc giao dịch thì thu hồi toàn bộ trong một bước.
+// Không thread-safe: mỗi task dùng arena riêng.
+class ScanArena {
+public:
+    ScanArena(size_t capacity);
+    
+    // Cấp vùng nhớ cố định
+    bool begin();
+    
+    // Cấp phát từ arena, trả về nullptr nếu hết chỗ
+    void* alloc(size_t size, size_t align = 4);
+    
+    // Cấp phát buffer chuỗi (len ký tự + '\0'), đã kết thúc bằng '\0'
+    char* allocString(size_t len);
+    
+    // Phần còn trống liên tục (dùng cho ghi tuần tự không biết trước độ dài)
+    size_t remaining() const { return capacity - offset; }
+    
+    // Đánh dấu/quay lại vị trí (giải phóng mọi thứ cấp sau mark)
+    size_t mark() const { return offset; }
+    void rewind(size_t position);
+    
+    // Giải phóng toàn bộ
+    void reset() { rewind(0); }
+    
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return offset; }
+    size_t getHighWater() const { return highWater; }
+    uint32_t getOverflowCount() const { return overflows; }
+    bool isInPSRAM() const { return inPSRAM; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t offset;
+    size_t highWater;
+    uint32_t overflows;
+    bool inPSRAM;
+};
+
+// Phạm vi một giao dịch: hủy scope là thu hồi mọi cấp phát bên trong
+class ArenaScope {
+public:
+    ArenaScope(ScanArena& arena) : arena(arena), start(arena.mark()) {}
+    ~ArenaScope() { arena.rewind(start); }
+
+private:
+    ScanArena& arena;
+    size_t start;
+};
+
+// Stream ghi vào một buffer cố định, dùng để đọc body HTTP thẳng vào arena
+class BufferStream : public Stream {
+public:
+    BufferStream(char* buffer, size_t capacity)
+        : buffer(buffer), capacity(capacity), length(0), truncated(false) {
+        if (capacity > 0) {
+            buffer[0] = '\0';
+        }
+    }
+    
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+    
+    size_t getLength() const { return length; }
+    bool isTruncated() const { return truncated; }
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    bool truncated;
+};
+
+#endif // SCAN_ARENA_H
@@ -0,0 +1,26 @@
+#ifndef SCAN_TRACE_H
+#define SCAN_TRACE_H
+
+#include <Arduino.h>
+#include "api_types.h"
+
+// Vết của một lần quét: trace ID ngẫu nhiên + mốc thời gian từng chặng trên trạm.
+// ID đi theo request (header traceparent, trường trace_id) và sự kiện gửi app,
+// để log của trạm, backend và app ghép được với nhau.
+namespace ScanTracing {
+
+// Bắt đầu vết lúc chạm thẻ/quét mã: ID mới, giờ thực (nếu có) và millis()
+void start(ScanTrace& trace);
+
+// Ghi mốc của một chặng (ms kể từ lúc quét); lần đầu mới được tính
+void mark(ScanTrace& trace, TraceStage stage);
+
+// Header traceparent với span ID mới cho mỗi request (kể cả lần gửi lại)
+size_t traceparent(const ScanTrace& trace, char* output, size_t capacity);
+
+// In "[TRACE] <id> sent=.. response=.. (server=..) published=.." ra Serial
+void print(const ScanTrace& trace, const char* label);
+
+} // namespace ScanTracing
+
+#endif // SCAN_TRACE_H
@@ -0,0 +1,46 @@
+#ifndef SELF_BENCHMARK_H
+#define SELF_BENCHMARK_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "api_types.h"
+#include "rfid_reader_pool.h"
+#include "lcd_handler.h"
+#include "wifi_handler.h"
+#include "request_scheduler.h"
+
+// Tự kiểm tra hiệu năng của trạm, để biết quầy chậm do dây RC522, backpack I2C của LCD,
+// WiFi hay server. Trên loop(): RTT đọc thanh ghi từng đầu đọc RC522, thời gian vẽ lại cả
+// màn hình, RSSI. Trên task mạng (qua RequestScheduler, cùng HTTPClient/kết nối TLS với
+// request quét): RTT HTTP tới backend và throughput tải lên. Số lần lặp cố định (BENCH_*)
+// nên kết quả so được giữa các trạm và giữa các lần chạy; báo cáo in ra Serial và gửi lên
+// API_BENCHMARK. loop() bị chặn trong lúc chạy (vài giây), LCD hiện bước đang đo.
+class SelfBenchmark {
+public:
+    SelfBenchmark();
+    
+    // Chạy mọi phép đo. Bộ đệm mẫu cấp khi chạy và trả lại khi xong; false nếu không đủ heap
+    bool run(RFIDReaderPool& readers, LCDHandler& lcd, WiFiHandler& wifi, RequestScheduler& scheduler);
+    
+    // Kết quả lần chạy gần nhất (hợp lệ khi getRunCount() > 0)
+    const BenchReport& getReport() const { return report; }
+    uint32_t getRunCount() const { return runs; }
+    
+    // In báo cáo ra Serial, mỗi phép đo một dòng
+    void printReport() const;
+    
+    // min/p50/p95/max/avg của count mẫu (samplesUs bị sắp xếp tại chỗ)
+    static void summarize(uint32_t* samplesUs, uint16_t count, uint16_t failures, BenchTiming& out);
+    
+private:
+    void measureReaders(RFIDReaderPool& readers, uint32_t* samples);
+    void measureDisplay(LCDHandler& lcd, uint32_t* samples);
+    void measureWifi(WiFiHandler& wifi);
+    
+    BenchReport report;
+    uint32_t runs;
+};
+
+extern SelfBenchmark selfBenchmark;
+
+#endif // SELF_BENCHMARK_H
@@ -0,0 +1,109 @@
+#ifndef STATION_METRICS_H
+#define STATION_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_MAX_BUCKETS 10
+
+// Histogram bucket cố định (giá trị nguyên: ms hoặc µs). Mỗi histogram chỉ có
+// một task ghi; task metrics đọc không khóa nên có thể lệch một mẫu giữa các
+// bucket và count, chấp nhận được với số liệu giám sát.
+class MetricHistogram {
+public:
+    MetricHistogram(const uint32_t* bounds, uint8_t boundCount);
+    
+    void observe(uint32_t value);
+    
+    uint8_t getBoundCount() const { return boundCount; }
+    uint32_t getBound(uint8_t i) const { return bounds[i]; }
+    // Số mẫu <= bounds[i] (cộng dồn như Prometheus), i == boundCount là +Inf
+    uint32_t getCumulative(uint8_t i) const;
+    uint32_t getCount() const { return count; }
+    uint64_t getSum() const { return sum; }
+    
+private:
+    const uint32_t* bounds;
+    uint8_t boundCount;
+    uint32_t buckets[METRICS_MAX_BUCKETS + 1];
+    uint32_t count;
+    uint64_t sum;
+};
+
+// Ghi text exposition format (Prometheus 0.0.4) vào buffer cố định, không cấp phát.
+// Hết chỗ thì dừng ghi và overflowed() = true
+class MetricsWriter {
+public:
+    MetricsWriter(char* buffer, size_t capacity);
+    
+    // Dòng # HELP và # TYPE của một metric
+    void family(const char* name, const char* type, const char* help);
+    
+    // labels dạng `type="student_card",result="success"` hoặc "" nếu không có
+    void sample(const char* name, const char* labels, uint64_t value);
+    void sample(const char* name, const char* labels, int64_t value);
+    void sample(const char* name, const char* labels, double value);
+    
+    // Các dòng _bucket/_sum/_count; scale đổi đơn vị lưu sang đơn vị metric (ms → s: 0.001)
+    void histogram(const char* name, const char* labels, const MetricHistogram& histogram, double scale);
+    
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+    
+private:
+    void append(const char* format, ...);
+    
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+};
+
+enum ScanKind : uint8_t { SCAN_KIND_STUDENT, SCAN_KIND_BOOK, SCAN_KIND_COUNT };
+
+enum ApiEndpoint : uint8_t {
+    ENDPOINT_STUDENT, ENDPOINT_BOOK, ENDPOINT_HEARTBEAT, ENDPOINT_BATCH, ENDPOINT_INVENTORY, ENDPOINT_BENCHMARK, ENDPOINT_FIRMWARE,
+    ENDPOINT_COUNT
+};
+
+enum ApiErrorType : uint8_t {
+    API_ERROR_CONNECTION,          // Không kết nối được / timeout (httpCode <= 0)
+    API_ERROR_HTTP_STATUS,         // Server trả mã khác 200
+    API_ERROR_OVERLOADED,          // 429/503: server quá tải
+    API_ERROR_RESPONSE_TOO_LARGE,
+    API_ERROR_PARSE,               // JSON không hợp lệ
+    API_ERROR_PAYLOAD,             // Payload vượt API_PAYLOAD_MAX
+    API_ERROR_OUT_OF_MEMORY,       // Arena hết chỗ
+    API_ERROR_COUNT
+};
+
+// Số liệu của trạm ngoài các thống kê sẵn có của từng module.
+// Lượt quét và thời gian loop do loop() ghi; lỗi API và RTT HTTP do task mạng ghi.
+class StationMetrics {
+public:
+    StationMetrics();
+    
+    void countScan(ScanKind kind, bool success) { scans[kind][success ? 1 : 0]++; }
+    void countApiError(ApiErrorType type) { apiErrors[type]++; }
+    void observeHttp(ApiEndpoint endpoint, uint32_t durationMs) { httpDuration[endpoint].observe(durationMs); }
+    void observeLoop(uint32_t durationUs) { loopDuration.observe(durationUs); }
+    // Mỗi lần task mạng gửi request quét: số lần quét gộp lại và thời gian chờ gom thêm
+    void observeBatch(uint8_t size, uint32_t waitUs) {
+        batchSize.observe(size);
+        batchWait.observe(waitUs);
+    }
+    
+    void write(MetricsWriter& out) const;
+    
+private:
+    uint32_t scans[SCAN_KIND_COUNT][2];
+    uint32_t apiErrors[API_ERROR_COUNT];
+    MetricHistogram httpDuration[ENDPOINT_COUNT];
+    MetricHistogram loopDuration;
+    MetricHistogram batchSize;
+    MetricHistogram batchWait;
+};
+
+extern StationMetrics stationMetrics;
+
+#endif // STATION_METRICS_H
@@ -0,0 +1,78 @@
+#ifndef STATION_PARAMS_H
+#define STATION_PARAMS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "api_types.h"
+
+// Tham số vận hành chỉnh được lúc chạy (mặc định ở config.h)
+enum ParamId {
+    PARAM_RFID_SCAN_INTERVAL,
+    PARAM_RFID_DEBOUNCE,
+    PARAM_LCD_DISPLAY_TIMEOUT,
+    PARAM_HEARTBEAT_INTERVAL,
+    PARAM_API_TIMEOUT,
+    PARAM_WIFI_CHECK_INTERVAL,
+    PARAM_COUNT
+};
+
+struct ParamSpec {
+    const char* name;              // Tên trong JSON và lệnh Serial ("api_timeout_ms")
+    const char* key;               // Khóa NVS (tối đa 15 ký tự)
+    uint32_t defaultValue;
+    uint32_t minValue;
+    uint32_t maxValue;
+    uint8_t version;               // Giá trị đã lưu từ phiên bản mặc định cũ hơn bị bỏ
+};
+
+struct ParamStats {
+    uint32_t updates;              // Lần nhận cấu hình có phiên bản mới
+    uint32_t applied;              // Tham số đã đổi (kể cả reset về mặc định)
+    uint32_t rejected;             // Tên lạ, sai kiểu hoặc ngoài khoảng cho phép
+};
+
+// Tham số lưu trong NVS (namespace "params"), nạp một lần lúc khởi động.
+// Server đổi qua "config" trong response heartbeat; giá trị mới có hiệu lực ngay
+// (hot reload) và được ghi lại để giữ qua reboot.
+// get() chỉ đọc một ô uint32_t trong RAM, không khóa và không chạm NVS,
+// nên gọi được trong vòng lặp quét và từ mọi task.
+class StationParams {
+public:
+    StationParams();
+    
+    // Đọc giá trị đã lưu; gọi sớm trong setup() trước khi các module dùng tham số
+    void begin();
+    
+    uint32_t get(ParamId id) const { return values[id]; }
+    
+    // Áp dụng cấu hình server gửi (task mạng gọi). Bỏ qua nếu cùng phiên bản đã áp dụng.
+    // Trả về số tham số đã đổi
+    uint8_t apply(const ConfigUpdate& update);
+    
+    // Đổi/reset từng tham số (lệnh Serial). false nếu tên lạ hoặc giá trị ngoài khoảng
+    bool set(const char* name, uint32_t value);
+    bool reset(const char* name);
+    
+    // Phiên bản cấu hình server đã áp dụng, 0 = chưa nhận lần nào
+    uint32_t getRevision() const { return revision; }
+    const ParamStats& getStats() const { return stats; }
+    
+    static const ParamSpec& spec(ParamId id);
+    // PARAM_COUNT nếu không có tham số tên này
+    static ParamId find(const char* name);
+    
+    // In giá trị hiện tại ra Serial
+    void printStats() const;
+    
+private:
+    bool store(ParamId id, uint32_t value, bool isReset);
+    
+    volatile uint32_t values[PARAM_COUNT];
+    volatile uint32_t revision;
+    SemaphoreHandle_t mutex;       // Chỉ giữ khi ghi (NVS chậm), get() không cần
+    ParamStats stats;
+};
+
+extern StationParams stationParams;
+
+#endif // STATION_PARAMS_H
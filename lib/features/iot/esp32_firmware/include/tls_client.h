@@ -0,0 +1,84 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/x509_crt.h>
+#include "config.h"
+
+struct TlsStats {
+    uint32_t fullHandshakes;
+    uint32_t resumedHandshakes;
+    uint32_t failedHandshakes;         // Kể cả lỗi TCP/DNS trước handshake
+    uint32_t lastFullMs;
+    uint32_t lastResumedMs;
+    uint64_t totalFullMs;
+    uint64_t totalResumedMs;
+};
+
+// Kết nối TLS cho HTTPClient, dùng thay WiFiClientSecure (bản đó bỏ session mỗi
+// lần stop()). Sau mỗi handshake giữ lại session để lần kết nối sau resume bằng
+// session ticket hoặc session ID: không trao đổi khóa ECDHE, không gửi/xác thực
+// chứng chỉ, chỉ một vòng round-trip. Ngữ cảnh mbedTLS (~35 KB buffer) cấp một lần
+// trong begin() và dùng lại cho mọi kết nối.
+// mbedTLS của ESP-IDF chạy AES/SHA/bignum trên bộ tăng tốc phần cứng của ESP32-S3;
+// chỉ bật các cipher suite AES-GCM để phần mã hóa bản ghi luôn đi qua phần cứng.
+class TlsClient : public WiFiClient {
+public:
+    TlsClient();
+    ~TlsClient();
+    
+    // Khởi tạo RNG, CA và cấu hình (gọi một lần trong setup).
+    // caPem rỗng: trả false, trạm không kết nối tới server chưa xác thực
+    bool begin(const char* caPem);
+    
+    int connect(IPAddress ip, uint16_t port);
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char* host, uint16_t port);
+    int connect(const char* host, uint16_t port, int32_t timeout);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    
+    // Quên session đã lưu: kết nối sau handshake đầy đủ
+    void clearSession();
+    bool hasSession() const { return haveSession; }
+    
+    const TlsStats& getStats() const { return stats; }
+    void printStats() const;
+    
+private:
+    static int bioSend(void* ctx, const unsigned char* buf, size_t len);
+    static int bioRecv(void* ctx, unsigned char* buf, size_t len);
+    static int verifyCertificate(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+    
+    bool openSocket(const char* host, uint16_t port, int32_t timeout);
+    bool handshake(const char* host);
+    void closeSocket();
+    
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt ca;
+    mbedtls_ssl_session session;       // Session của handshake gần nhất (kèm ticket nếu server cấp)
+    
+    int socketFd;
+    bool ready;
+    bool haveSession;
+    bool handshaking;                  // Đang handshake: recv chờ theo SO_RCVTIMEO, sau đó không chặn
+    bool certificateSeen;              // Server gửi chứng chỉ = handshake đầy đủ, không phải resume
+    int peeked;                        // Byte đã đọc trước bởi peek(), -1 nếu không có
+    TlsStats stats;
+};
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,68 @@
+#ifndef UID_SET_H
+#define UID_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// Khóa 64-bit của một UID: byte cao = độ dài (4 hoặc 7), 56 bit thấp = các byte UID
+// (byte đầu ở cao nhất). Sắp xếp theo khóa gom UID cùng độ dài và cùng tiền tố
+// (nhãn cùng cuộn thường có số sê-ri liên tiếp). 0 = không dùng được (UID 10 byte).
+typedef uint64_t UidKey;
+
+enum UidInsert : uint8_t {
+    UID_INSERTED,
+    UID_DUPLICATE,
+    UID_SET_FULL
+};
+
+struct UidSetStats {
+    uint32_t lookups;
+    uint32_t bloomRejects;         // Bloom filter trả lời "chắc chắn chưa có" (không cần tìm)
+    uint32_t falsePositives;       // Bloom nói "có thể có" nhưng tìm không thấy
+    uint32_t merges;               // Lần trộn đuôi chưa sắp xếp vào mảng
+};
+
+// Tập UID đã thấy trong một phiên kiểm kê: bloom filter trước, phía sau là mảng khóa
+// đã sắp xếp (tìm nhị phân) cộng một đuôi ngắn chưa sắp xếp. UID mới chỉ cần thêm vào
+// đuôi; đuôi đầy mới sắp xếp và trộn một lượt O(n) vào mảng.
+// Bộ nhớ do người gọi cấp (PSRAM trên trạm, vector trên máy host) và không phụ thuộc
+// Arduino để chạy được trong bench/inventory_bench.
+class UidSet {
+public:
+    // bloom: INVENTORY_BLOOM_BITS / 32 word, keys: capacity khóa
+    UidSet(uint32_t* bloom, UidKey* keys, uint32_t capacity);
+    
+    UidInsert insert(UidKey key);
+    bool contains(UidKey key);
+    void clear();
+    
+    uint32_t size() const { return count; }
+    uint32_t getCapacity() const { return capacity; }
+    size_t bytesUsed() const;
+    const UidSetStats& getStats() const { return stats; }
+    
+    static UidKey makeKey(const uint8_t* uid, uint8_t length);
+    // Ghi lại các byte UID, trả về độ dài (0 nếu khóa không hợp lệ)
+    static uint8_t keyToUid(UidKey key, uint8_t uid[7]);
+    
+    // Nén một lô khóa: sắp xếp tại chỗ rồi ghi hiệu của hai khóa liên tiếp dạng varint
+    // (LEB128, khóa đầu so với 0). Trả về số byte, 0 nếu không đủ chỗ
+    static size_t encodeBatch(UidKey* keys, uint16_t count, uint8_t* output, size_t capacity);
+    // Ngược lại của encodeBatch. Trả về số khóa, -1 nếu dữ liệu hỏng hoặc quá maxKeys
+    static int decodeBatch(const uint8_t* data, size_t length, UidKey* keys, uint16_t maxKeys);
+    
+private:
+    void bloomPositions(UidKey key, uint32_t positions[INVENTORY_BLOOM_HASHES]) const;
+    bool search(UidKey key) const;
+    void mergeTail();
+    
+    uint32_t* bloom;
+    UidKey* keys;
+    uint32_t capacity;
+    uint32_t count;                // Tổng số khóa
+    uint32_t sortedCount;          // keys[0, sortedCount) đã sắp xếp, phần còn lại là đuôi
+    UidSetStats stats;
+};
+
+#endif // UID_SET_H
@@ -0,0 +1,64 @@
+#ifndef USB_BARCODE_SCANNER_H
+#define USB_BARCODE_SCANNER_H
+
+#include <Arduino.h>
+#include <usb/usb_host.h>
+#include "config.h"
+#include "hid_keyboard_decoder.h"
+
+struct UsbScannerStats {
+    uint32_t connects;
+    uint32_t unsupported;          // Thiết bị không có interface HID boot keyboard
+    uint32_t transferErrors;
+    uint32_t dropped;              // Mã bỏ vì loop() chưa lấy kịp (hàng đợi đầy)
+};
+
+// Máy quét barcode USB (kiểu bàn phím, HID boot protocol) trên cổng OTG của ESP32-S3.
+// Task "usb" chạy USB host, nhận input report qua interrupt transfer và ghép thành mã
+// bằng HidKeyboardDecoder; mã hoàn chỉnh vào hàng đợi, loop() lấy bằng poll() như
+// lấy thẻ từ rfidReaders.poll() (không chặn). Một máy quét tại một thời điểm.
+class UsbBarcodeScanner {
+public:
+    UsbBarcodeScanner();
+    
+    // Cài USB host và khởi động task
+    bool begin();
+    
+    // Lấy một mã đã quét nếu có (không chặn). capacity >= REQUEST_DATA_LEN
+    bool poll(char* barcode, size_t capacity);
+    
+    bool isConnected() const { return device != nullptr; }
+    const UsbScannerStats& getStats() const { return stats; }
+    const HidDecoderStats& getDecoderStats() const { return decoder.getStats(); }
+    TaskHandle_t getTaskHandle() const { return taskHandle; }
+    
+    // In thống kê ra Serial
+    void printStats() const;
+    
+private:
+    static void taskEntry(void* param);
+    static void clientEvent(const usb_host_client_event_msg_t* message, void* param);
+    static void transferDone(usb_transfer_t* transfer);
+    static void barcodeReady(const char* barcode, uint8_t length, void* param);
+    void run();
+    void open(uint8_t address);
+    bool claimKeyboard(const usb_config_desc_t* config);
+    void close();
+    
+    HidKeyboardDecoder decoder;        // Chỉ task USB dùng
+    QueueHandle_t barcodes;            // char[REQUEST_DATA_LEN]
+    TaskHandle_t taskHandle;
+    usb_host_client_handle_t client;
+    usb_device_handle_t device;
+    usb_transfer_t* transfer;          // Interrupt IN: input report
+    usb_transfer_t* control;           // SET_PROTOCOL(boot)
+    uint8_t interfaceNumber;
+    uint8_t pendingAddress;            // Thiết bị mới báo trong callback, mở trong run()
+    uint8_t inFlight;                  // Transfer đã submit chưa hoàn tất
+    bool deviceGone;
+    UsbScannerStats stats;
+};
+
+extern UsbBarcodeScanner usbBarcodeScanner;
+
+#endif // USB_BARCODE_SCANNER_H
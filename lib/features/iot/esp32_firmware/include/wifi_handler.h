@@ -23,10 +23,12 @@ public:
     
     // Lấy signal strength
     int getSignalStrength();
+    
+    // Kênh WiFi của AP đang kết nối
+    uint8_t getChannel();
 
 private:
     unsigned long lastCheckTime;
-    const unsigned long checkInterval = 5000; // Check mỗi 5 giây
 };
 
 #endif // WIFI_HANDLER_H
@@ -0,0 +1,97 @@
+#ifndef WS_PROTOCOL_H
+#define WS_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WS_ACCEPT_KEY_LEN 29           // base64(SHA-1) = 28 ký tự + '\0'
+#define WS_MAX_FRAME_HEADER 10         // Frame server → client (không mask)
+
+enum WsOpcode : uint8_t {
+    WS_OPCODE_CONTINUATION = 0x0,
+    WS_OPCODE_TEXT = 0x1,
+    WS_OPCODE_BINARY = 0x2,
+    WS_OPCODE_CLOSE = 0x8,
+    WS_OPCODE_PING = 0x9,
+    WS_OPCODE_PONG = 0xA
+};
+
+struct WsFrame {
+    WsOpcode opcode;
+    bool fin;
+    uint8_t* payload;                  // Đã bỏ mask, trỏ vào buffer đầu vào
+    size_t length;
+};
+
+// Phần giao thức WebSocket (RFC 6455) mà EventStream cần, không phụ thuộc Arduino
+// để kiểm tra trên máy host (bench/event_stream_bench.cpp).
+namespace WsProtocol {
+
+// Kiểm tra request nâng cấp (header đã đủ tới "\r\n\r\n", kết thúc bằng '\0')
+// và tính Sec-WebSocket-Accept. false nếu không phải request WebSocket hợp lệ
+bool parseUpgrade(const char* request, char acceptKey[WS_ACCEPT_KEY_LEN]);
+
+// Response 101 Switching Protocols, trả về độ dài (0 nếu không đủ chỗ)
+size_t buildHandshakeResponse(const char* acceptKey, char* output, size_t capacity);
+
+// Header frame server → client (FIN, không mask), trả về số byte header
+size_t frameHeader(WsOpcode opcode, size_t payloadLength, uint8_t output[WS_MAX_FRAME_HEADER]);
+
+// Đọc một frame client gửi lên (bắt buộc có mask), bỏ mask tại chỗ.
+// Trả về số byte đã dùng, 0 nếu chưa đủ dữ liệu, -1 nếu vi phạm giao thức
+int parseClientFrame(uint8_t* data, size_t length, WsFrame& frame);
+
+} // namespace WsProtocol
+
+// Buffer gửi vòng có giới hạn của một client: ghi cả frame hoặc không ghi gì,
+// để client chậm không bao giờ nhận frame cụt.
+template <size_t Capacity>
+class WsOutbox {
+public:
+    WsOutbox() : head(0), count(0) {}
+    
+    void reset() {
+        head = 0;
+        count = 0;
+    }
+    
+    size_t size() const { return count; }
+    size_t space() const { return Capacity - count; }
+    
+    bool push(const uint8_t* data, size_t length) {
+        if (length > space()) {
+            return false;
+        }
+        size_t tail = (head + count) % Capacity;
+        size_t first = Capacity - tail < length ? Capacity - tail : length;
+        memcpy(buffer + tail, data, first);
+        memcpy(buffer, data + first, length - first);
+        count += length;
+        return true;
+    }
+    
+    // Đoạn liên tục đầu tiên đang chờ gửi
+    size_t peek(const uint8_t*& data) const {
+        data = buffer + head;
+        return Capacity - head < count ? Capacity - head : count;
+    }
+    
+    void consume(size_t length) {
+        head = (head + length) % Capacity;
+        count -= length;
+        if (count == 0) {
+            head = 0;
+        }
+    }
+    
+    // Dùng tạm vùng nhớ làm buffer nhận request nâng cấp (trước khi có gì để gửi)
+    uint8_t* raw() { return buffer; }
+    
+private:
+    uint8_t buffer[Capacity];
+    size_t head;
+    size_t count;
+};
+
+#endif // WS_PROTOCOL_H
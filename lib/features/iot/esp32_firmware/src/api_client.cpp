@@ -1,190 +1,725 @@
 #include "api_client.h"
+#include "api_codec.h"
+#include "heap_monitor.h"
+#include "clock_sync.h"
+#include "scan_trace.h"
+#include "backend_discovery.h"
+#include "backpressure.h"
+#include "station_params.h"
+#if SELF_BENCH_ENABLED
+#include "self_benchmark.h"
+#endif
 
-APIClient::APIClient() {}
+#if API_TLS_ENABLED
+// TLS không xác thực server thì vẫn bị nghe lén qua man-in-the-middle, và OTA tin nội dung tải về
+static_assert(sizeof(API_TLS_CA_CERT) > 1, "API_TLS_ENABLED requires API_TLS_CA_CERT");
+#endif
 
-StudentInfo APIClient::scanStudentCard(const String& cardUID) {
-    StudentInfo result;
-    result.success = false;
+// Header đọc lại sau mỗi request: thời gian xử lý của backend, thời gian chờ khi quá tải
+static const char* COLLECTED_HEADERS[] = {"Server-Timing", "Retry-After"};
+#if OTA_ENABLED
+// Tải firmware: chữ ký của ảnh đích (OTA_SIGNING_PUBKEY)
+static const char* FIRMWARE_HEADERS[] = {"X-Firmware-Signature", "Retry-After"};
+#endif
+
+// Quá tải hiện thông báo riêng trên LCD thay vì mã HTTP
+static void formatHttpError(int httpCode, char* error, size_t capacity) {
+    if (Backpressure::isOverloadStatus(httpCode)) {
+        strlcpy(error, "Server qua tai", capacity);
+    } else {
+        snprintf(error, capacity, "HTTP Error: %d", httpCode);
+    }
+}
+
+APIClient::APIClient() : arena(SCAN_ARENA_SIZE) {
+    #if API_TLS_ENABLED
+    backendGeneration = 0;
+    #endif
+    #if OTA_ENABLED
+    firmwareUpdateRequested = false;
+    #if API_TLS_ENABLED
+    firmwareTlsReady = false;
+    #endif
+    #endif
+}
+
+bool APIClient::begin() {
+    #if API_TLS_ENABLED
+    if (!tls.begin(API_TLS_CA_CERT)) {
+        return false;
+    }
+    #endif
+    return arena.begin();
+}
+
+bool APIClient::open(const char* path, uint16_t timeout, const char* method) {
+    // Query của API_FIRMWARE_PATCH mang app_elf_sha256 (64 ký tự hex)
+    char url[BACKEND_URL_LEN + 128];
+    if (backendDiscovery.formatUrl(path, url, sizeof(url)) == 0) {
+        countHttpError(HTTPC_ERROR_CONNECTION_REFUSED);
+        return false;
+    }
     
-    String url = String(API_BASE_URL) + String(API_SCAN_STUDENT);
-    String payload = createStudentPayload(cardUID);
+    #if API_TLS_ENABLED
+    // Backend đổi địa chỉ: bỏ kết nối keep-alive và session của server cũ
+    uint32_t generation = backendDiscovery.getGeneration();
+    if (generation != backendGeneration) {
+        backendGeneration = generation;
+        tls.stop();
+        tls.clearSession();
+    }
+    #endif
     
-    DEBUG_PRINT("[API] POST ");
+    DEBUG_PRINTF("[API] %s ", method);
     DEBUG_PRINTLN(url);
-    DEBUG_PRINT("[API] Payload: ");
-    DEBUG_PRINTLN(payload);
     
+    #if API_TLS_ENABLED
+    http.begin(tls, url);
+    http.setReuse(true);
+    #else
     http.begin(url);
+    #endif
     http.addHeader("Content-Type", "application/json");
-    http.setTimeout(API_TIMEOUT);
+    http.setTimeout(timeout);
+    http.collectHeaders(COLLECTED_HEADERS, 2);
+    return true;
+}
+
+int APIClient::finish(ApiEndpoint endpoint, int httpCode, uint32_t rttMs) {
+    return finish(http, endpoint, httpCode, rttMs);
+}
+
+int APIClient::finish(HTTPClient& client, ApiEndpoint endpoint, int httpCode, uint32_t rttMs) {
+    #if BACKPRESSURE_ENABLED
+    if (httpCode > 0) {
+        uint32_t retryAfterMs = 0;
+        if (Backpressure::isOverloadStatus(httpCode)) {
+            retryAfterMs = Backpressure::parseRetryAfter(client.header("Retry-After").c_str(), clockSync.nowEpochMs());
+            DEBUG_PRINTF("[API] Server overloaded (%d), retry after %ums\n", httpCode, retryAfterMs);
+        }
+        backpressure.onResponse(httpCode, retryAfterMs, rttMs, millis(), esp_random());
+    } else if (httpCode == HTTPC_ERROR_READ_TIMEOUT) {
+        backpressure.onTimeout(rttMs, millis());
+    }
+    #endif
+    
+    client.end();
+    backendDiscovery.reportResult(httpCode);
+    
+    // RTT gồm cả đọc body; lỗi kết nối chỉ đếm lỗi, không lẫn vào histogram
+    if (httpCode > 0) {
+        stationMetrics.observeHttp(endpoint, rttMs);
+    }
+    countHttpError(httpCode);
+    return httpCode;
+}
+
+int APIClient::post(ApiEndpoint endpoint, const char* path, const char* payload, size_t length, uint16_t timeout,
+                    BufferStream* response, ScanTrace* traces, uint8_t traceCount) {
+    if (!open(path, timeout)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    DEBUG_PRINT("[API] Payload: ");
+    DEBUG_PRINTLN(payload);
+    
+    if (traceCount > 0) {
+        char traceparent[64];
+        if (ScanTracing::traceparent(traces[0], traceparent, sizeof(traceparent)) > 0) {
+            http.addHeader("traceparent", traceparent);
+        }
+        for (uint8_t i = 0; i < traceCount; i++) {
+            ScanTracing::mark(traces[i], TRACE_SENT);
+        }
+    }
+    
+    uint32_t start = millis();
+    int httpCode = http.POST((uint8_t*)payload, length);
+    
+    if (httpCode == HTTP_CODE_OK && response != nullptr) {
+        http.writeToStream(response);
+    }
+    if (traceCount > 0 && httpCode > 0) {
+        uint32_t serverMs = ApiCodec::parseServerTiming(http.header("Server-Timing").c_str());
+        for (uint8_t i = 0; i < traceCount; i++) {
+            ScanTracing::mark(traces[i], TRACE_RESPONSE);
+            traces[i].serverMs = serverMs;
+        }
+    }
+    return finish(endpoint, httpCode, millis() - start);
+}
+
+StudentInfo APIClient::scanStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace) {
+    StudentInfo result;
+    resetStudentInfo(result);
+    result.trace = trace;
+    ScanTrace traced = trace;     // parse xóa result, mốc được gắn lại ở cuối
+    
+    ArenaScope scope(arena);
+    char* payload = arena.allocString(API_PAYLOAD_MAX);
+    char* body = arena.allocString(API_RESPONSE_MAX);
+    if (payload == nullptr || body == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        strlcpy(result.error, "Out of memory", sizeof(result.error));
+        return result;
+    }
+    
+    size_t length = ApiCodec::createStudentPayload(cardUID, source, DEVICE_ID, trace,
+                                                 payload, API_PAYLOAD_MAX + 1);
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Student payload overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        strlcpy(result.error, "Payload too large", sizeof(result.error));
+        return result;
+    }
     
-    int httpCode = http.POST(payload);
+    BufferStream response(body, API_RESPONSE_MAX + 1);
+    int httpCode = post(ENDPOINT_STUDENT, API_SCAN_STUDENT, payload, length, stationParams.get(PARAM_API_TIMEOUT),
+                       &response, &traced, 1);
     
     if (httpCode > 0) {
         DEBUG_PRINT("[API] Response code: ");
         DEBUG_PRINTLN(httpCode);
-        
+    
         if (httpCode == HTTP_CODE_OK) {
-            String response = http.getString();
             DEBUG_PRINT("[API] Response: ");
-            DEBUG_PRINTLN(response);
-            
-            result = parseStudentResponse(response);
+            DEBUG_PRINTLN(body);
+    
+            if (response.isTruncated()) {
+                stationMetrics.countApiError(API_ERROR_RESPONSE_TOO_LARGE);
+                strlcpy(result.error, "Response too large", sizeof(result.error));
+            } else if (!ApiCodec::parseStudentResponse(body, response.getLength(), result)) {
+                stationMetrics.countApiError(API_ERROR_PARSE);
+            }
         } else {
-            result.error = "HTTP Error: " + String(httpCode);
+            formatHttpError(httpCode, result.error, sizeof(result.error));
         }
     } else {
-        result.error = "Connection failed: " + http.errorToString(httpCode);
+        snprintf(result.error, sizeof(result.error), "Connection failed: %s",
+                 HTTPClient::errorToString(httpCode).c_str());
         DEBUG_PRINT("[API] Error: ");
         DEBUG_PRINTLN(result.error);
     }
     
-    http.end();
+    result.httpCode = httpCode;
+    result.trace = traced;
     return result;
 }
 
-BookInfo APIClient::scanBookBarcode(const String& barcode) {
+BookInfo APIClient::scanBookBarcode(const char* barcode, const ScanTrace& trace) {
     BookInfo result;
-    result.success = false;
-    
-    String url = String(API_BASE_URL) + String(API_SCAN_BOOK);
-    String payload = createBookPayload(barcode);
+    resetBookInfo(result);
+    result.trace = trace;
+    ScanTrace traced = trace;
     
-    DEBUG_PRINT("[API] POST ");
-    DEBUG_PRINTLN(url);
-    DEBUG_PRINT("[API] Payload: ");
-    DEBUG_PRINTLN(payload);
+    ArenaScope scope(arena);
+    char* payload = arena.allocString(API_PAYLOAD_MAX);
+    char* body = arena.allocString(API_RESPONSE_MAX);
+    if (payload == nullptr || body == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        strlcpy(result.error, "Out of memory", sizeof(result.error));
+        return result;
+    }
     
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(API_TIMEOUT);
+    size_t length = ApiCodec::createBookPayload(barcode, DEVICE_ID, trace, payload, API_PAYLOAD_MAX + 1);
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Book payload overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        strlcpy(result.error, "Payload too large", sizeof(result.error));
+        return result;
+    }
     
-    int httpCode = http.POST(payload);
+    BufferStream response(body, API_RESPONSE_MAX + 1);
+    int httpCode = post(ENDPOINT_BOOK, API_SCAN_BOOK, payload, length, stationParams.get(PARAM_API_TIMEOUT), &response, &traced, 1);
     
     if (httpCode > 0) {
         DEBUG_PRINT("[API] Response code: ");
         DEBUG_PRINTLN(httpCode);
-        
+    
         if (httpCode == HTTP_CODE_OK) {
-            String response = http.getString();
             DEBUG_PRINT("[API] Response: ");
-            DEBUG_PRINTLN(response);
-            
-            result = parseBookResponse(response);
+            DEBUG_PRINTLN(body);
+    
+            if (response.isTruncated()) {
+                stationMetrics.countApiError(API_ERROR_RESPONSE_TOO_LARGE);
+                strlcpy(result.error, "Response too large", sizeof(result.error));
+            } else if (!ApiCodec::parseBookResponse(body, response.getLength(), result)) {
+                stationMetrics.countApiError(API_ERROR_PARSE);
+            }
         } else {
-            result.error = "HTTP Error: " + String(httpCode);
+            formatHttpError(httpCode, result.error, sizeof(result.error));
         }
     } else {
-        result.error = "Connection failed: " + http.errorToString(httpCode);
+        snprintf(result.error, sizeof(result.error), "Connection failed: %s",
+                 HTTPClient::errorToString(httpCode).c_str());
         DEBUG_PRINT("[API] Error: ");
         DEBUG_PRINTLN(result.error);
     }
     
-    http.end();
+    result.httpCode = httpCode;
+    result.trace = traced;
     return result;
 }
 
-bool APIClient::sendHeartbeat() {
-    String url = String(API_BASE_URL) + String(API_HEARTBEAT);
-    String payload = createHeartbeatPayload();
+int APIClient::scanBatch(const BatchScan* scans, uint8_t count, StudentInfo* students, BookInfo* books) {
+    ScanTrace traced[BATCH_MAX_ITEMS];
+    count = count < BATCH_MAX_ITEMS ? count : BATCH_MAX_ITEMS;
+    for (uint8_t i = 0; i < count; i++) {
+        if (scans[i].trace != nullptr) {
+            traced[i] = *scans[i].trace;
+        } else {
+            memset(&traced[i], 0, sizeof(traced[i]));
+        }
+    }
     
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(5000);
+    // Lỗi chung của cả batch: ghi vào kết quả của từng lần quét
+    auto fail = [&](const char* error, int httpCode) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (scans[i].book) {
+                resetBookInfo(books[i]);
+                strlcpy(books[i].error, error, sizeof(books[i].error));
+                books[i].httpCode = httpCode;
+                books[i].trace = traced[i];
+            } else {
+                resetStudentInfo(students[i]);
+                strlcpy(students[i].error, error, sizeof(students[i].error));
+                students[i].httpCode = httpCode;
+                students[i].trace = traced[i];
+            }
+        }
+    };
     
-    int httpCode = http.POST(payload);
-    bool success = (httpCode == HTTP_CODE_OK);
+    ArenaScope scope(arena);
+    char* payload = arena.allocString(BATCH_PAYLOAD_MAX);
+    char* body = arena.allocString(BATCH_RESPONSE_MAX);
+    if (payload == nullptr || body == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        fail("Out of memory", 0);
+        return 0;
+    }
     
-    http.end();
-    return success;
-}
-
-String APIClient::createStudentPayload(const String& cardUID) {
-    StaticJsonDocument<200> doc;
-    doc["card_uid"] = cardUID;
-    doc["device_id"] = DEVICE_ID;
-    doc["timestamp"] = millis();
+    size_t length = ApiCodec::createBatchPayload(scans, count, DEVICE_ID, payload, BATCH_PAYLOAD_MAX + 1);
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Batch payload overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        fail("Payload too large", 0);
+        return 0;
+    }
+    
+    BufferStream response(body, BATCH_RESPONSE_MAX + 1);
+    int httpCode = post(ENDPOINT_BATCH, API_SCAN_BATCH, payload, length, stationParams.get(PARAM_API_TIMEOUT),
+                        &response, traced, count);
+    
+    if (httpCode <= 0) {
+        char error[INFO_ERROR_LEN];
+        snprintf(error, sizeof(error), "Connection failed: %s", HTTPClient::errorToString(httpCode).c_str());
+        DEBUG_PRINT("[API] Error: ");
+        DEBUG_PRINTLN(error);
+        fail(error, httpCode);
+        return httpCode;
+    }
     
-    String output;
-    serializeJson(doc, output);
-    return output;
+    DEBUG_PRINTF("[API] Batch of %u, response code: %d\n", count, httpCode);
+    if (httpCode != HTTP_CODE_OK) {
+        char error[INFO_ERROR_LEN];
+        formatHttpError(httpCode, error, sizeof(error));
+        fail(error, httpCode);
+        return httpCode;
+    }
+    if (response.isTruncated()) {
+        stationMetrics.countApiError(API_ERROR_RESPONSE_TOO_LARGE);
+        fail("Response too large", httpCode);
+        return httpCode;
+    }
+    
+    char* items[BATCH_MAX_ITEMS];
+    size_t lengths[BATCH_MAX_ITEMS];
+    int found = ApiCodec::splitBatchResults(body, response.getLength(), items, lengths, count);
+    if (found != count) {
+        DEBUG_PRINTF("[API] Batch results mismatch: %d/%u\n", found, count);
+        stationMetrics.countApiError(API_ERROR_PARSE);
+        fail("JSON parse error", httpCode);
+        return httpCode;
+    }
+    
+    // Mỗi phần tử là response như request đơn, ghép lại theo thứ tự
+    for (uint8_t i = 0; i < count; i++) {
+        bool parsed;
+        if (scans[i].book) {
+            resetBookInfo(books[i]);
+            parsed = items[i] != nullptr && ApiCodec::parseBookResponse(items[i], lengths[i], books[i]);
+            books[i].httpCode = httpCode;
+            books[i].trace = traced[i];
+        } else {
+            resetStudentInfo(students[i]);
+            parsed = items[i] != nullptr && ApiCodec::parseStudentResponse(items[i], lengths[i], students[i]);
+            students[i].httpCode = httpCode;
+            students[i].trace = traced[i];
+        }
+        if (!parsed) {
+            stationMetrics.countApiError(API_ERROR_PARSE);
+            if (scans[i].book) {
+                strlcpy(books[i].error, "JSON parse error", sizeof(books[i].error));
+            } else {
+                strlcpy(students[i].error, "JSON parse error", sizeof(students[i].error));
+            }
+        }
+    }
+    return httpCode;
 }
 
-String APIClient::createBookPayload(const String& barcode) {
-    StaticJsonDocument<200> doc;
-    doc["barcode"] = barcode;
-    doc["device_id"] = DEVICE_ID;
-    doc["timestamp"] = millis();
+bool APIClient::sendHeartbeat() {
+    ArenaScope scope(arena);
+    char* payload = arena.allocString(HEARTBEAT_PAYLOAD_MAX);
+    char* body = arena.allocString(HEARTBEAT_RESPONSE_MAX);
+    if (payload == nullptr || body == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    
+    HeartbeatInfo info;
+    collectHeartbeatInfo(info);
+    
+    size_t length = ApiCodec::createHeartbeatPayload(info, payload, HEARTBEAT_PAYLOAD_MAX + 1);
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Heartbeat payload overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        return false;
+    }
+    
+    BufferStream response(body, HEARTBEAT_RESPONSE_MAX + 1);
+    int httpCode = post(ENDPOINT_HEARTBEAT, API_HEARTBEAT, payload, length, HEARTBEAT_TIMEOUT,
+                       &response, nullptr, 0);
+    if (httpCode != HTTP_CODE_OK) {
+        return false;
+    }
     
-    String output;
-    serializeJson(doc, output);
-    return output;
+    // Server gửi kèm cấu hình mới khi config_version của trạm đã cũ
+    ConfigUpdate update;
+    if (response.isTruncated()) {
+        stationMetrics.countApiError(API_ERROR_RESPONSE_TOO_LARGE);
+    } else if (!ApiCodec::parseHeartbeatResponse(body, response.getLength(), update)) {
+        DEBUG_PRINTF("[API] Heartbeat response not parsed (%s), %u bytes\n", update.parseError,
+                     (unsigned)response.getLength());
+        stationMetrics.countApiError(API_ERROR_PARSE);
+    } else {
+        stationParams.apply(update);
+        #if OTA_ENABLED
+        if (update.firmwareUpdate) {
+            firmwareUpdateRequested = true;
+        }
+        #endif
+    }
+    return true;
 }
 
-String APIClient::createHeartbeatPayload() {
-    StaticJsonDocument<200> doc;
-    doc["device_id"] = DEVICE_ID;
-    doc["device_name"] = DEVICE_NAME;
-    doc["location"] = DEVICE_LOCATION;
-    doc["timestamp"] = millis();
+#if INVENTORY_ENABLED
+bool APIClient::sendInventoryBatch(InventorySession& session) {
+    ArenaScope scope(arena);
+    // Varint của hiệu hai khóa 64-bit tối đa 10 byte
+    const size_t encodedCapacity = INVENTORY_BATCH_MAX * 10;
+    const size_t uidsLength = (encodedCapacity + 2) / 3 * 4;
+    UidKey* keys = static_cast<UidKey*>(arena.alloc(INVENTORY_BATCH_MAX * sizeof(UidKey), 8));
+    uint8_t* encoded = static_cast<uint8_t*>(arena.alloc(encodedCapacity, 1));
+    char* uids = arena.allocString(uidsLength);
+    char* payload = arena.allocString(INVENTORY_PAYLOAD_MAX);
+    if (keys == nullptr || encoded == nullptr || uids == nullptr || payload == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
     
-    String output;
-    serializeJson(doc, output);
-    return output;
+    uint16_t count = session.peekPending(keys, INVENTORY_BATCH_MAX);
+    if (count == 0) {
+        return true;
+    }
+    
+    size_t encodedLength = UidSet::encodeBatch(keys, count, encoded, encodedCapacity);
+    InventoryBatch batch;
+    batch.deviceId = DEVICE_ID;
+    batch.session = session.getSessionId();
+    batch.sequence = session.getSequence();
+    batch.count = count;
+    batch.uids = uids;
+    size_t length = 0;
+    if (encodedLength > 0 && ApiCodec::base64Encode(encoded, encodedLength, uids, uidsLength + 1) > 0) {
+        length = ApiCodec::createInventoryPayload(batch, payload, INVENTORY_PAYLOAD_MAX + 1);
+    }
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Inventory payload overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        session.countUploadFailure();
+        return false;
+    }
+    
+    int httpCode = post(ENDPOINT_INVENTORY, API_INVENTORY_BATCH, payload, length, stationParams.get(PARAM_API_TIMEOUT),
+                       nullptr, nullptr, 0);
+    if (httpCode != HTTP_CODE_OK) {
+        session.countUploadFailure();
+        return false;
+    }
+    session.acknowledge(count, encodedLength);
+    return true;
 }
+#endif
 
-StudentInfo APIClient::parseStudentResponse(const String& jsonResponse) {
-    StudentInfo result;
+#if SELF_BENCH_ENABLED
+// Lỗi kết nối liên tiếp thì bỏ các lần đo còn lại: mỗi lần chờ tới timeout
+#define BENCH_MAX_CONNECT_ERRORS 3
+
+// Body đo throughput: head + ký tự 'x' + tail, sinh dần khi HTTPClient đọc nên không cần
+// buffer BENCH_UPLOAD_BYTES trong RAM (arena chỉ có SCAN_ARENA_SIZE)
+class PaddingStream : public Stream {
+public:
+    PaddingStream(const char* head, const char* tail, size_t total)
+        : head(head), tail(tail), headLength(strlen(head)), tailLength(strlen(tail)), total(total), position(0) {}
     
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, jsonResponse);
+    int available() override { return (int)(total - position); }
+    int read() override { return position < total ? byteAt(position++) : -1; }
+    int peek() override { return position < total ? byteAt(position) : -1; }
+    size_t readBytes(char* buffer, size_t length) override {
+        size_t count = 0;
+        while (count < length && position < total) {
+            buffer[count++] = byteAt(position++);
+        }
+        return count;
+    }
+    size_t write(uint8_t c) override { return 0; }
+    void flush() override {}
     
-    if (error) {
-        result.success = false;
-        result.error = "JSON parse error";
-        return result;
+private:
+    char byteAt(size_t index) const {
+        if (index < headLength) {
+            return head[index];
+        }
+        if (index >= total - tailLength) {
+            return tail[index - (total - tailLength)];
+        }
+        return 'x';
     }
     
-    result.success = doc["success"] | false;
+    const char* head;
+    const char* tail;
+    size_t headLength;
+    size_t tailLength;
+    size_t total;
+    size_t position;
+};
+
+bool APIClient::runBenchmark(BenchReport& report) {
+    ArenaScope scope(arena);
+    uint32_t* samples = static_cast<uint32_t*>(arena.alloc(BENCH_HTTP_ITERATIONS * sizeof(uint32_t), 4));
+    char* payload = arena.allocString(BENCH_REPORT_MAX);
+    if (samples == nullptr || payload == nullptr) {
+        stationMetrics.countApiError(API_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
     
-    if (result.success) {
-        JsonObject student = doc["student"];
-        result.mssv = student["mssv"].as<String>();
-        result.name = student["name"].as<String>();
-        result.className = student["class"].as<String>();
-        result.phone = student["phone"].as<String>();
-        result.email = student["email"].as<String>();
-    } else {
-        result.error = doc["error"].as<String>();
+    // RTT: request nhỏ lặp lại trên cùng kết nối keep-alive, lần đầu gồm cả mở kết nối (TLS).
+    // Chỉ tính thời gian của POST (gửi + chờ response), không tính log Serial
+    uint16_t count = 0;
+    uint16_t failures = 0;
+    for (uint16_t i = 0; i < BENCH_HTTP_ITERATIONS && failures < BENCH_MAX_CONNECT_ERRORS; i++) {
+        size_t length = ApiCodec::createBenchmarkProbe(DEVICE_ID, i, payload, BENCH_REPORT_MAX + 1);
+        if (!open(API_BENCHMARK, BENCH_TIMEOUT)) {
+            report.httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+            failures++;
+            continue;
+        }
+        uint32_t start = micros();
+        int httpCode = http.POST((uint8_t*)payload, length);
+        uint32_t elapsed = micros() - start;
+        report.httpCode = finish(ENDPOINT_BENCHMARK, httpCode, elapsed / 1000);
+        if (httpCode > 0) {
+            samples[count++] = elapsed;
+        } else {
+            failures++;
+        }
     }
+    SelfBenchmark::summarize(samples, count, failures, report.http);
     
-    return result;
+    // Throughput tải lên: lần nhanh nhất trừ RTT p50 (phần chờ server trả lời)
+    char head[80];
+    snprintf(head, sizeof(head), "{\"device_id\":\"%s\",\"phase\":\"upload\",\"padding\":\"", DEVICE_ID);
+    uint32_t bestUs = 0;
+    report.uploadBytes = BENCH_UPLOAD_BYTES;
+    for (uint8_t round = 0; round < BENCH_UPLOAD_ROUNDS && count > 0; round++) {
+        if (!open(API_BENCHMARK, BENCH_TIMEOUT)) {
+            report.uploadFailures++;
+            continue;
+        }
+        PaddingStream body(head, "\"}", BENCH_UPLOAD_BYTES);
+        uint32_t start = micros();
+        int httpCode = http.sendRequest("POST", &body, BENCH_UPLOAD_BYTES);
+        uint32_t elapsed = micros() - start;
+        finish(ENDPOINT_BENCHMARK, httpCode, elapsed / 1000);
+        if (httpCode <= 0) {
+            report.uploadFailures++;
+        } else if (bestUs == 0 || elapsed < bestUs) {
+            bestUs = elapsed;
+        }
+    }
+    if (bestUs > 0) {
+        uint32_t transferUs = bestUs > report.http.p50Us + 1000 ? bestUs - report.http.p50Us : 1000;
+        report.uploadBestMs = bestUs / 1000;
+        report.uploadKbps = (uint32_t)((uint64_t)BENCH_UPLOAD_BYTES * 8 * 1000 / transferUs);
+    }
+    
+    report.durationMs = millis() - report.startedMs;
+    size_t length = ApiCodec::createBenchmarkReport(report, payload, BENCH_REPORT_MAX + 1);
+    if (length == 0) {
+        DEBUG_PRINTLN("[API] Benchmark report overflow!");
+        stationMetrics.countApiError(API_ERROR_PAYLOAD);
+        return false;
+    }
+    return post(ENDPOINT_BENCHMARK, API_BENCHMARK, payload, length, BENCH_TIMEOUT, nullptr, nullptr, 0) == HTTP_CODE_OK;
 }
+#endif
 
-BookInfo APIClient::parseBookResponse(const String& jsonResponse) {
-    BookInfo result;
+#if OTA_ENABLED
+int APIClient::downloadFirmware(const char* path, OtaMode mode, DownloadYield yield, void* context) {
+    char url[BACKEND_URL_LEN + 128];
+    if (backendDiscovery.formatUrl(path, url, sizeof(url)) == 0) {
+        countHttpError(HTTPC_ERROR_CONNECTION_REFUSED);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    DEBUG_PRINT("[API] GET ");
+    DEBUG_PRINTLN(url);
     
-    StaticJsonDocument<512> doc;
-    DeserializationError error = deserializeJson(doc, jsonResponse);
+    #if API_TLS_ENABLED
+    // Kết nối thứ hai chỉ mở khi tải; không giữ keep-alive nên không cần theo dõi backend đổi địa chỉ
+    if (!firmwareTlsReady) {
+        firmwareTlsReady = firmwareTls.begin(API_TLS_CA_CERT);
+        if (!firmwareTlsReady) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+    }
+    firmwareHttp.begin(firmwareTls, url);
+    #else
+    firmwareHttp.begin(url);
+    #endif
+    firmwareHttp.setReuse(false);
+    // HTTP/1.0: body không bị chia chunk, đọc thẳng từ stream
+    firmwareHttp.useHTTP10(true);
+    firmwareHttp.setTimeout(OTA_TIMEOUT);
+    firmwareHttp.collectHeaders(FIRMWARE_HEADERS, 2);
     
-    if (error) {
-        result.success = false;
-        result.error = "JSON parse error";
-        return result;
+    uint32_t start = millis();
+    int httpCode = firmwareHttp.GET();
+    // RTT chỉ tính tới khi có header; thời gian tải và ghi flash nằm trong thống kê của otaUpdater
+    uint32_t rttMs = millis() - start;
+    if (httpCode == HTTP_CODE_OK &&
+        otaUpdater.begin(mode, firmwareHttp.getSize(), firmwareHttp.header("X-Firmware-Signature").c_str())) {
+        otaUpdater.finish(streamFirmware(yield, context));
+    }
+    return finish(firmwareHttp, ENDPOINT_FIRMWARE, httpCode, rttMs);
+}
+
+int APIClient::streamFirmware(DownloadYield yield, void* context) {
+    WiFiClient* stream = firmwareHttp.getStreamPtr();
+    if (stream == nullptr) {
+        return HTTPC_ERROR_CONNECTION_LOST;
     }
+    int32_t size = firmwareHttp.getSize();    // -1: đọc tới khi server đóng kết nối
+    int received = 0;
+    uint32_t lastData = millis();
+    while (size < 0 || received < size) {
+        int available = stream->available();
+        if (available <= 0) {
+            if (!stream->connected()) {
+                break;
+            }
+            if (millis() - lastData > OTA_TIMEOUT) {
+                return HTTPC_ERROR_READ_TIMEOUT;
+            }
+            // Chưa có dữ liệu: lần quét đang chờ không phải đợi thêm
+            yield(context);
+            delay(1);
+            continue;
+        }
     
-    result.success = doc["success"] | false;
+        size_t length = (size_t)available < sizeof(firmwareChunk) ? (size_t)available : sizeof(firmwareChunk);
+        if (size > 0 && length > (size_t)(size - received)) {
+            length = size - received;
+        }
+        int count = stream->read(firmwareChunk, length);
+        if (count <= 0) {
+            continue;
+        }
+        if (!otaUpdater.write(firmwareChunk, count)) {
+            return HTTPC_ERROR_STREAM_WRITE;
+        }
+        received += count;
+        lastData = millis();
+        yield(context);
+    }
+    return received;
+}
+
+bool APIClient::updateFirmware(DownloadYield yield, void* context) {
+    if (otaUpdater.isRestartPending()) {
+        return true;
+    }
     
-    if (result.success) {
-        JsonObject book = doc["book"];
-        result.id = book["id"].as<String>();
-        result.title = book["title"].as<String>();
-        result.code = book["code"].as<String>();
-        result.author = book["author"].as<String>();
-        result.available = book["available"] | false;
-    } else {
-        result.error = doc["error"].as<String>();
+    char build[DELTA_HASH_LEN * 2 + 1];
+    char path[sizeof(API_FIRMWARE_PATCH) + sizeof(DEVICE_ID) + sizeof(build) + 16];
+    int httpCode = HTTP_CODE_NOT_FOUND;
+    if (otaUpdater.getRunningBuild(build, sizeof(build))) {
+        snprintf(path, sizeof(path), "%s?device_id=%s&from=%s", API_FIRMWARE_PATCH, DEVICE_ID, build);
+        httpCode = downloadFirmware(path, OTA_DELTA, yield, context);
+        otaUpdater.countCheck(httpCode == HTTP_CODE_NO_CONTENT);
+        if (httpCode == HTTP_CODE_NO_CONTENT || otaUpdater.isRestartPending()) {
+            return otaUpdater.isRestartPending();
+        }
     }
     
-    return result;
+    // Bản vá lỗi khi đang tải (mất kết nối, ghi flash) thì để lần sau; chỉ tải ảnh đầy đủ khi
+    // server không có bản vá cho bản đang chạy hoặc bản vá làm cho ảnh khác
+    bool mismatch = httpCode == HTTP_CODE_OK && otaUpdater.getStats().lastDelta == DELTA_SOURCE_MISMATCH;
+    if (httpCode != HTTP_CODE_NOT_FOUND && !mismatch) {
+        return false;
+    }
+    snprintf(path, sizeof(path), "%s?device_id=%s", API_FIRMWARE_IMAGE, DEVICE_ID);
+    downloadFirmware(path, OTA_FULL, yield, context);
+    return otaUpdater.isRestartPending();
+}
+
+bool APIClient::takeFirmwareUpdateRequest() {
+    bool requested = firmwareUpdateRequested;
+    firmwareUpdateRequested = false;
+    return requested;
+}
+#endif
+
+void APIClient::countHttpError(int httpCode) {
+    if (httpCode <= 0) {
+        stationMetrics.countApiError(API_ERROR_CONNECTION);
+    } else if (Backpressure::isOverloadStatus(httpCode)) {
+        stationMetrics.countApiError(API_ERROR_OVERLOADED);
+    } else if (httpCode != HTTP_CODE_OK && httpCode != HTTP_CODE_NO_CONTENT) {
+        stationMetrics.countApiError(API_ERROR_HTTP_STATUS);
+    }
+}
+
+void APIClient::collectHeartbeatInfo(HeartbeatInfo& info) {
+    HeapSnapshot snap = heapMonitor.snapshot();
+    
+    info.deviceId = DEVICE_ID;
+    info.deviceName = DEVICE_NAME;
+    info.location = DEVICE_LOCATION;
+    info.timestamp = clockSync.nowEpochMs();
+    
+    info.freeHeap = snap.freeHeap;
+    info.minFreeHeap = snap.minFreeHeap;
+    info.largestFreeBlock = snap.largestFreeBlock;
+    info.freePsram = snap.freePsram;
+    info.fragmentationPct = snap.fragmentationPct;
+    info.heapDrift = snap.drift;
+    info.arenaHighWater = arena.getHighWater();
+    info.arenaOverflows = arena.getOverflowCount();
+    info.configRevision = stationParams.getRevision();
+    
+    info.taskCount = heapMonitor.getTaskCount();
+    for (uint8_t i = 0; i < info.taskCount; i++) {
+        info.taskNames[i] = heapMonitor.getTaskName(i);
+        info.stackFree[i] = heapMonitor.getStackHighWater(i);
+    }
 }
@@ -0,0 +1,617 @@
+#include "api_codec.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void resetStudentInfo(StudentInfo& info) {
+    memset(&info, 0, sizeof(info));
+}
+
+void resetBookInfo(BookInfo& info) {
+    memset(&info, 0, sizeof(info));
+}
+
+namespace ApiCodec {
+
+// Helper: Copy chuỗi có giới hạn, không cắt giữa một ký tự UTF-8
+static void copyText(char* dest, size_t size, const char* src) {
+    size_t len = strnlen(src, size);
+    if (len >= size) {
+        len = size - 1;
+        // Lùi về đầu ký tự UTF-8 (bỏ các byte 10xxxxxx và byte đầu bị cắt dở)
+        while (len > 0 && (static_cast<uint8_t>(src[len]) & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
+// Helper: Lấy trường dạng chuỗi; số nguyên được đổi sang chuỗi, kiểu khác → ""
+static void copyField(JsonVariantConst value, char* dest, size_t size) {
+    if (value.is<const char*>()) {
+        copyText(dest, size, value.as<const char*>());
+    } else if (value.is<long long>()) {
+        snprintf(dest, size, "%lld", value.as<long long>());
+    } else {
+        dest[0] = '\0';
+    }
+}
+
+// Helper: Ghi document ra output nếu vừa, ngược lại trả về 0
+static size_t serializeChecked(const JsonDocument& doc, char* output, size_t capacity) {
+    if (doc.overflowed() || measureJson(doc) >= capacity) {
+        return 0;
+    }
+    return serializeJson(doc, output, capacity);
+}
+
+// Helper: Trường chung của payload: trace_id, giờ quét nếu đã có giờ thực
+static void addTraceFields(JsonDocument& doc, const ScanTrace& trace) {
+    if (trace.id[0] != '\0') {
+        doc["trace_id"] = (const char*)trace.id;
+    }
+    if (trace.tapEpochMs > 0) {
+        doc["timestamp"] = trace.tapEpochMs;
+    }
+}
+
+// Helper: Object "trace" của sự kiện; app ghép với giờ nhận để tách từng chặng
+static void addTraceObject(JsonDocument& doc, const ScanTrace& trace, char* isoBuffer) {
+    if (trace.tapEpochMs > 0 && formatIsoTimestamp(trace.tapEpochMs, isoBuffer, TIMESTAMP_ISO_LEN) > 0) {
+        doc["timestamp"] = (const char*)isoBuffer;
+    }
+    if (trace.id[0] == '\0') {
+        return;
+    }
+    JsonObject object = doc.createNestedObject("trace");
+    object["id"] = (const char*)trace.id;
+    JsonObject stages = object.createNestedObject("stages_ms");
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        if (trace.reached & (1 << i)) {
+            stages[traceStageName((TraceStage)i)] = trace.stageMs[i];
+        }
+    }
+    if (trace.serverMs > 0) {
+        object["server_ms"] = trace.serverMs;
+    }
+}
+
+const char* laneName(ScanLane lane) {
+    return lane == LANE_RETURN ? "return" : "checkout";
+}
+
+const char* traceStageName(TraceStage stage) {
+    switch (stage) {
+        case TRACE_SENT:      return "sent";
+        case TRACE_RESPONSE:  return "response";
+        case TRACE_PUBLISHED: return "published";
+        default:              return "unknown";
+    }
+}
+
+size_t formatTraceparent(const ScanTrace& trace, const char* spanId, char* output, size_t capacity) {
+    if (trace.id[0] == '\0') {
+        return 0;
+    }
+    int length = snprintf(output, capacity, "00-%s-%s-01", trace.id, spanId);
+    return length > 0 && (size_t)length < capacity ? length : 0;
+}
+
+uint32_t parseServerTiming(const char* header) {
+    if (header == nullptr) {
+        return 0;
+    }
+    
+    // Các metric cách nhau bởi ',', tham số bởi ';': name;desc="...";dur=12.3
+    double sum = 0;
+    double total = -1;
+    const char* metric = header;
+    while (*metric != '\0') {
+        while (*metric == ' ' || *metric == ',') {
+            metric++;
+        }
+        const char* end = strchr(metric, ',');
+        if (end == nullptr) {
+            end = metric + strlen(metric);
+        }
+        size_t nameLength = strcspn(metric, ";, ");
+    
+        for (const char* p = metric; p < end; p++) {
+            if (*p == ';' && strncmp(p + 1, "dur=", 4) == 0) {
+                double dur = strtod(p + 5, nullptr);
+                if (dur > 0) {
+                    sum += dur;
+                    if (nameLength == 5 && strncmp(metric, "total", 5) == 0) {
+                        total = dur;
+                    }
+                }
+                break;
+            }
+        }
+        metric = end;
+    }
+    
+    double ms = total >= 0 ? total : sum;
+    return ms > 0 ? (uint32_t)(ms + 0.5) : 0;
+}
+
+size_t formatIsoTimestamp(uint64_t epochMs, char* output, size_t capacity) {
+    time_t seconds = (time_t)(epochMs / 1000);
+    struct tm utc;
+    if (gmtime_r(&seconds, &utc) == nullptr) {
+        return 0;
+    }
+    int length = snprintf(output, capacity, "%04d-%02d-%02dT%02d:%02d:%02d.%03uZ",
+                          utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+                          utc.tm_hour, utc.tm_min, utc.tm_sec, (unsigned)(epochMs % 1000));
+    return length > 0 && (size_t)length < capacity ? length : 0;
+}
+
+size_t createStudentPayload(const char* cardUID, const ScanSource& source, const char* deviceId,
+                            const ScanTrace& trace, char* output, size_t capacity) {
+    StaticJsonDocument<256> doc;
+    doc["card_uid"] = cardUID;
+    doc["device_id"] = deviceId;
+    addTraceFields(doc, trace);
+    doc["reader"] = source.reader;
+    doc["lane"] = laneName(source.lane);
+    // Yêu cầu server trả kèm các phiếu mượn đang mở (tránh lookup lại khi trả sách)
+    doc["include_loans"] = true;
+    doc["max_loans"] = MAX_ACTIVE_LOANS;
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createBookPayload(const char* barcode, const char* deviceId, const ScanTrace& trace,
+                         char* output, size_t capacity) {
+    StaticJsonDocument<200> doc;
+    doc["barcode"] = barcode;
+    doc["device_id"] = deviceId;
+    addTraceFields(doc, trace);
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createHeartbeatPayload(const HeartbeatInfo& info, char* output, size_t capacity) {
+    StaticJsonDocument<512> doc;
+    doc["device_id"] = info.deviceId;
+    doc["device_name"] = info.deviceName;
+    doc["location"] = info.location;
+    if (info.timestamp > 0) {
+        doc["timestamp"] = info.timestamp;
+    }
+    // Server so với phiên bản hiện tại để biết có cần gửi lại cấu hình
+    doc["config_version"] = info.configRevision;
+    
+    // Sức khỏe bộ nhớ để phát hiện trạm chạy lâu bị rò/phân mảnh heap
+    JsonObject memory = doc.createNestedObject("memory");
+    memory["free_heap"] = info.freeHeap;
+    memory["min_free_heap"] = info.minFreeHeap;
+    memory["largest_free_block"] = info.largestFreeBlock;
+    memory["frag_pct"] = info.fragmentationPct;
+    memory["heap_drift"] = info.heapDrift;
+    if (info.freePsram > 0) {
+        memory["free_psram"] = info.freePsram;
+    }
+    memory["arena_high_water"] = info.arenaHighWater;
+    memory["arena_overflows"] = info.arenaOverflows;
+    
+    JsonObject stacks = memory.createNestedObject("stack_free");
+    for (uint8_t i = 0; i < info.taskCount && i < HEAP_MONITOR_MAX_TASKS; i++) {
+        stacks[info.taskNames[i]] = info.stackFree[i];
+    }
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createBatchPayload(const BatchScan* scans, uint8_t count, const char* deviceId,
+                          char* output, size_t capacity) {
+    // Mỗi lần quét tối đa 8 trường
+    StaticJsonDocument<JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(BATCH_MAX_ITEMS) +
+                       BATCH_MAX_ITEMS * JSON_OBJECT_SIZE(8)> doc;
+    doc["device_id"] = deviceId;
+    doc["include_loans"] = true;
+    doc["max_loans"] = MAX_ACTIVE_LOANS;
+    
+    JsonArray items = doc.createNestedArray("scans");
+    for (uint8_t i = 0; i < count; i++) {
+        const BatchScan& scan = scans[i];
+        JsonObject item = items.createNestedObject();
+        if (scan.book) {
+            item["type"] = "book_barcode";
+            item["barcode"] = scan.data;
+        } else {
+            item["type"] = "student_card";
+            item["card_uid"] = scan.data;
+            item["reader"] = scan.source.reader;
+            item["lane"] = laneName(scan.source.lane);
+        }
+        if (scan.trace != nullptr && scan.trace->id[0] != '\0') {
+            item["trace_id"] = (const char*)scan.trace->id;
+        }
+        if (scan.trace != nullptr && scan.trace->tapEpochMs > 0) {
+            item["timestamp"] = scan.trace->tapEpochMs;
+        }
+    }
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createInventoryPayload(const InventoryBatch& batch, char* output, size_t capacity) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(6)> doc;
+    doc["device_id"] = batch.deviceId;
+    doc["session"] = batch.session;
+    doc["seq"] = batch.sequence;
+    doc["count"] = batch.count;
+    doc["encoding"] = "uid-delta-varint";
+    doc["uids"] = batch.uids;
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createBenchmarkProbe(const char* deviceId, uint16_t sequence, char* output, size_t capacity) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(3)> doc;
+    doc["device_id"] = deviceId;
+    doc["phase"] = "probe";
+    doc["seq"] = sequence;
+    return serializeChecked(doc, output, capacity);
+}
+
+// Helper: Một phép đo lặp của báo cáo tự kiểm tra
+static void addBenchTiming(JsonObject object, const BenchTiming& timing) {
+    object["samples"] = timing.samples;
+    object["failures"] = timing.failures;
+    if (timing.samples > 0) {
+        object["min_us"] = timing.minUs;
+        object["p50_us"] = timing.p50Us;
+        object["p95_us"] = timing.p95Us;
+        object["max_us"] = timing.maxUs;
+        object["avg_us"] = timing.avgUs;
+    }
+}
+
+size_t createBenchmarkReport(const BenchReport& report, char* output, size_t capacity) {
+    // Mỗi phép đo 7 trường; mỗi đầu đọc thêm reader/lane/version
+    StaticJsonDocument<JSON_OBJECT_SIZE(10) + JSON_ARRAY_SIZE(RFID_READER_COUNT) +
+                       RFID_READER_COUNT * JSON_OBJECT_SIZE(10) + 3 * JSON_OBJECT_SIZE(8) +
+                       JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(5)> doc;
+    doc["device_id"] = report.deviceId;
+    if (report.timestamp > 0) {
+        doc["timestamp"] = report.timestamp;
+    }
+    doc["run"] = report.run;
+    doc["duration_ms"] = report.durationMs;
+    
+    JsonArray readers = doc.createNestedArray("rc522");
+    for (uint8_t i = 0; i < report.readerCount && i < RFID_READER_COUNT; i++) {
+        if (!report.readerActive[i]) {
+            continue;
+        }
+        JsonObject reader = readers.createNestedObject();
+        reader["reader"] = i;
+        reader["lane"] = laneName(report.readerLane[i]);
+        reader["version"] = report.readerVersion[i];
+        addBenchTiming(reader, report.rc522[i]);
+    }
+    
+    JsonObject display = doc.createNestedObject("display");
+    display["type"] = report.display;
+    addBenchTiming(display, report.lcd);
+    
+    JsonObject wifi = doc.createNestedObject("wifi");
+    wifi["connected"] = report.wifiConnected;
+    if (report.wifiConnected) {
+        wifi["rssi_min"] = report.rssiMin;
+        wifi["rssi_avg"] = report.rssiAvg;
+        wifi["rssi_max"] = report.rssiMax;
+        wifi["channel"] = report.channel;
+    }
+    
+    JsonObject http = doc.createNestedObject("http");
+    http["status"] = report.httpCode;
+    addBenchTiming(http, report.http);
+    
+    JsonObject upload = doc.createNestedObject("upload");
+    upload["bytes"] = report.uploadBytes;
+    upload["failures"] = report.uploadFailures;
+    if (report.uploadBestMs > 0) {
+        upload["best_ms"] = report.uploadBestMs;
+        upload["kbps"] = report.uploadKbps;
+    }
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t base64Encode(const uint8_t* data, size_t length, char* output, size_t capacity) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t encodedLength = (length + 2) / 3 * 4;
+    if (encodedLength >= capacity) {
+        return 0;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t block = data[i] << 16;
+        if (i + 1 < length) {
+            block |= data[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            block |= data[i + 2];
+        }
+        output[pos++] = alphabet[(block >> 18) & 0x3F];
+        output[pos++] = alphabet[(block >> 12) & 0x3F];
+        output[pos++] = i + 1 < length ? alphabet[(block >> 6) & 0x3F] : '=';
+        output[pos++] = i + 2 < length ? alphabet[block & 0x3F] : '=';
+    }
+    output[pos] = '\0';
+    return pos;
+}
+
+size_t createStudentEvent(const char* cardUID, const StudentInfo& student, const ScanSource& source,
+                          const char* deviceId, char* output, size_t capacity) {
+    StaticJsonDocument<640> doc;
+    char timestamp[TIMESTAMP_ISO_LEN];
+    doc["device_id"] = deviceId;
+    doc["scan_type"] = "student_card";
+    doc["scan_data"] = cardUID;
+    doc["success"] = student.success;
+    if (student.unverified) {
+        // App không được tự điền phiếu mượn từ sự kiện này, chờ sự kiện đã xác nhận
+        doc["unverified"] = true;
+    }
+    doc["reader"] = source.reader;
+    doc["lane"] = laneName(source.lane);
+    if (student.success) {
+        JsonObject data = doc.createNestedObject("data");
+        data["mssv"] = student.mssv;
+        data["name"] = student.name;
+        data["class"] = student.className;
+        data["phone"] = student.phone;
+        data["email"] = student.email;
+        data["active_loans"] = student.loanCount;
+    } else {
+        doc["error"] = student.error;
+    }
+    addTraceObject(doc, student.trace, timestamp);
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+size_t createBookEvent(const char* barcode, const BookInfo& book, const char* deviceId,
+                       char* output, size_t capacity) {
+    StaticJsonDocument<512> doc;
+    char timestamp[TIMESTAMP_ISO_LEN];
+    doc["device_id"] = deviceId;
+    doc["scan_type"] = "book_barcode";
+    doc["scan_data"] = barcode;
+    doc["success"] = book.success;
+    if (book.success) {
+        JsonObject data = doc.createNestedObject("data");
+        data["id"] = book.id;
+        data["title"] = book.title;
+        data["code"] = book.code;
+        data["author"] = book.author;
+        data["available"] = book.available;
+    } else {
+        doc["error"] = book.error;
+    }
+    addTraceObject(doc, book.trace, timestamp);
+    
+    return serializeChecked(doc, output, capacity);
+}
+
+bool parseStudentResponse(char* json, size_t length, StudentInfo& result) {
+    resetStudentInfo(result);
+    
+    // Đủ cho thông tin sinh viên + MAX_ACTIVE_LOANS phiếu mượn
+    StaticJsonDocument<1536> doc;
+    DeserializationError error = deserializeJson(doc, json, length);
+    
+    if (error || !doc.is<JsonObject>()) {
+        copyText(result.error, sizeof(result.error), "JSON parse error");
+        return false;
+    }
+    
+    result.success = doc["success"].is<bool>() && doc["success"].as<bool>();
+    
+    if (result.success) {
+        JsonObjectConst student = doc["student"];
+        copyField(student["mssv"], result.mssv, sizeof(result.mssv));
+        copyField(student["name"], result.name, sizeof(result.name));
+        copyField(student["class"], result.className, sizeof(result.className));
+        copyField(student["phone"], result.phone, sizeof(result.phone));
+        copyField(student["email"], result.email, sizeof(result.email));
+    
+        JsonArrayConst loans = doc["active_loans"];
+        for (JsonVariantConst item : loans) {
+            if (result.loanCount >= MAX_ACTIVE_LOANS) {
+                result.loansTruncated = true;
+                break;
+            }
+            JsonObjectConst loan = item;
+            if (loan.isNull()) {
+                continue;
+            }
+            LoanInfo& entry = result.loans[result.loanCount++];
+            copyField(loan["book_code"], entry.bookCode, sizeof(entry.bookCode));
+            copyField(loan["book_name"], entry.bookName, sizeof(entry.bookName));
+            copyField(loan["due_date"], entry.dueDate, sizeof(entry.dueDate));
+            entry.daysLeft = loan["days_left"] | 0;
+            entry.overdue = loan["overdue"].is<bool>() ? loan["overdue"].as<bool>() : entry.daysLeft < 0;
+        }
+        long totalLoans = doc["total_loans"] | 0L;
+        if (totalLoans > result.loanCount) {
+            result.loansTruncated = true;
+        }
+    } else {
+        copyField(doc["error"], result.error, sizeof(result.error));
+    }
+    
+    return true;
+}
+
+bool parseBookResponse(char* json, size_t length, BookInfo& result) {
+    resetBookInfo(result);
+    
+    StaticJsonDocument<512> doc;
+    DeserializationError error = deserializeJson(doc, json, length);
+    
+    if (error || !doc.is<JsonObject>()) {
+        copyText(result.error, sizeof(result.error), "JSON parse error");
+        return false;
+    }
+    
+    result.success = doc["success"].is<bool>() && doc["success"].as<bool>();
+    
+    if (result.success) {
+        JsonObjectConst book = doc["book"];
+        copyField(book["id"], result.id, sizeof(result.id));
+        copyField(book["title"], result.title, sizeof(result.title));
+        copyField(book["code"], result.code, sizeof(result.code));
+        copyField(book["author"], result.author, sizeof(result.author));
+        result.available = book["available"].is<bool>() && book["available"].as<bool>();
+        result.returned = doc["returned"].is<bool>() && doc["returned"].as<bool>();
+    } else {
+        copyField(doc["error"], result.error, sizeof(result.error));
+    }
+    
+    return true;
+}
+
+bool parseHeartbeatResponse(char* json, size_t length, ConfigUpdate& update) {
+    memset(&update, 0, sizeof(update));
+    
+    // Chỉ giữ các trường trạm dùng: backend thêm trường mới không làm hết chỗ trong doc.
+    // "params" giữ nguyên, dư gấp đôi CONFIG_MAX_ENTRIES để tham số thừa được đếm vào invalid
+    StaticJsonDocument<JSON_OBJECT_SIZE(2) * 2> filter;
+    filter["firmware_update"] = true;
+    filter["config"]["version"] = true;
+    filter["config"]["params"] = true;
+    
+    StaticJsonDocument<JSON_OBJECT_SIZE(2) * 2 + JSON_OBJECT_SIZE(CONFIG_MAX_ENTRIES * 2)> doc;
+    DeserializationError error = deserializeJson(doc, json, length, DeserializationOption::Filter(filter));
+    if (error) {
+        update.parseError = error.c_str();
+        return false;
+    }
+    if (!doc.is<JsonObject>()) {
+        update.parseError = "not an object";
+        return false;
+    }
+    update.firmwareUpdate = doc["firmware_update"] | false;
+    
+    JsonObjectConst config = doc["config"];
+    if (config.isNull() || !config["version"].is<uint32_t>()) {
+        return true;
+    }
+    update.revision = config["version"].as<uint32_t>();
+    
+    for (JsonPairConst param : config["params"].as<JsonObjectConst>()) {
+        JsonVariantConst value = param.value();
+        if (update.count >= CONFIG_MAX_ENTRIES || (!value.isNull() && !value.is<uint32_t>())) {
+            update.invalid++;
+            continue;
+        }
+        ConfigEntry& entry = update.entries[update.count++];
+        entry.name = param.key().c_str();
+        entry.reset = value.isNull();
+        entry.value = entry.reset ? 0 : value.as<uint32_t>();
+    }
+    return true;
+}
+
+int splitBatchResults(char* json, size_t length, char** items, size_t* lengths, uint8_t maxItems) {
+    // Quét một lượt, chỉ theo dõi chuỗi và độ sâu: tìm khóa "results" ở object
+    // ngoài cùng rồi ghi lại vị trí từng phần tử của mảng
+    const int maxDepth = 32;
+    int depth = 0;
+    int resultsDepth = 0;          // Độ sâu bên trong mảng results, 0 = chưa gặp
+    bool inString = false;
+    bool escaped = false;
+    size_t stringStart = 0;
+    bool lastKeyIsResults = false;
+    bool awaitingArray = false;
+    int slot = 0;
+    bool slotUsed = false;
+    
+    for (uint8_t i = 0; i < maxItems; i++) {
+        items[i] = nullptr;
+        lengths[i] = 0;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        char c = json[i];
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+                lastKeyIsResults = depth == 1 && resultsDepth == 0 && i - stringStart == 7 &&
+                                   strncmp(json + stringStart, "results", 7) == 0;
+            }
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            continue;
+        }
+    
+        // Phần tử mới của mảng results bắt đầu
+        if (resultsDepth > 0 && depth == resultsDepth && c != ',' && c != ']') {
+            if (!slotUsed && c == '{' && slot < maxItems) {
+                items[slot] = json + i;
+            }
+            slotUsed = true;
+        }
+    
+        switch (c) {
+            case '"':
+                inString = true;
+                stringStart = i + 1;
+                break;
+            case ':':
+                awaitingArray = lastKeyIsResults;
+                break;
+            case '{':
+            case '[':
+                if (awaitingArray && c == '[') {
+                    resultsDepth = depth + 1;
+                }
+                awaitingArray = false;
+                if (++depth > maxDepth) {
+                    return -1;
+                }
+                break;
+            case '}':
+            case ']':
+                awaitingArray = false;
+                if (--depth < 0) {
+                    return -1;
+                }
+                if (resultsDepth > 0 && depth == resultsDepth && c == '}' && slot < maxItems &&
+                    items[slot] != nullptr) {
+                    lengths[slot] = json + i + 1 - items[slot];
+                }
+                if (resultsDepth > 0 && depth == resultsDepth - 1) {
+                    return slotUsed ? slot + 1 : slot;
+                }
+                break;
+            case ',':
+                awaitingArray = false;
+                lastKeyIsResults = false;
+                if (resultsDepth > 0 && depth == resultsDepth) {
+                    slot++;
+                    slotUsed = false;
+                }
+                break;
+            default:
+                awaitingArray = false;
+                break;
+        }
+    }
+    
+    return -1;
+}
+
+} // namespace ApiCodec
@@ -0,0 +1,180 @@
+#include "backend_discovery.h"
+#include <ESPmDNS.h>
+
+BackendDiscovery backendDiscovery;
+
+#if API_TLS_ENABLED
+#define BACKEND_SCHEME "https"
+#else
+#define BACKEND_SCHEME "http"
+#endif
+
+BackendDiscovery::BackendDiscovery()
+    : count(0), active(0), lock(portMUX_INITIALIZER_UNLOCKED), generation(0), expiresAt(0),
+      consecutiveFailures(0), taskHandle(nullptr) {
+    strlcpy(fallback, API_BASE_URL, sizeof(fallback));
+    memset(instances, 0, sizeof(instances));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool BackendDiscovery::begin() {
+    #if BACKEND_DISCOVERY_ENABLED
+    if (!MDNS.begin(STATION_MDNS_HOSTNAME)) {
+        DEBUG_PRINTLN("[MDNS] Responder failed, using " API_BASE_URL);
+        return false;
+    }
+    
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "mdns", DISCOVERY_TASK_STACK, this,
+                                                 DISCOVERY_TASK_PRIORITY, &taskHandle, DISCOVERY_TASK_CORE);
+    if (created != pdPASS) {
+        DEBUG_PRINTLN("[MDNS] Task creation failed!");
+        return false;
+    }
+    DEBUG_PRINTLN("[MDNS] Looking for " BACKEND_MDNS_SERVICE "._tcp");
+    #endif
+    return true;
+}
+
+size_t BackendDiscovery::formatUrl(const char* path, char* output, size_t capacity) const {
+    portENTER_CRITICAL(&lock);
+    const char* base = count > 0 ? instances[active].base : fallback;
+    int length = snprintf(output, capacity, "%s%s", base, path);
+    portEXIT_CRITICAL(&lock);
+    return length > 0 && (size_t)length < capacity ? length : 0;
+}
+
+void BackendDiscovery::reportResult(int httpCode) {
+    if (httpCode > 0) {
+        consecutiveFailures = 0;
+        return;
+    }
+    if (++consecutiveFailures < BACKEND_FAILOVER_THRESHOLD) {
+        return;
+    }
+    consecutiveFailures = 0;
+    failover();
+}
+
+bool BackendDiscovery::isCacheFresh() const {
+    return count > 0 && (long)(expiresAt - millis()) > 0;
+}
+
+bool BackendDiscovery::isUsable(const Instance& instance, uint32_t now) const {
+    return instance.failedAt == 0 || now - instance.failedAt > BACKEND_FAILED_COOLDOWN;
+}
+
+// Chạy trên task mạng: chỉ đổi chỉ số instance, việc tra lại để task nền làm
+void BackendDiscovery::failover() {
+    uint32_t now = millis();
+    bool switched = false;
+    
+    portENTER_CRITICAL(&lock);
+    if (count > 0) {
+        instances[active].failedAt = now;
+        for (uint8_t step = 1; step < count; step++) {
+            uint8_t candidate = (active + step) % count;
+            if (isUsable(instances[candidate], now)) {
+                active = candidate;
+                generation++;
+                switched = true;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (switched) {
+        stats.failovers++;
+        DEBUG_PRINTF("[MDNS] Backend unreachable, switched to %s\n", instances[active].base);
+    }
+    // Backend có thể đã đổi địa chỉ: tra lại ngay
+    if (taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
+    }
+}
+
+void BackendDiscovery::taskEntry(void* param) {
+    static_cast<BackendDiscovery*>(param)->run();
+}
+
+void BackendDiscovery::run() {
+    for (;;) {
+        refresh();
+        // Làm mới sau nửa TTL để cache không hết hạn khi backend vẫn quảng bá;
+        // failover() đánh thức sớm
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BACKEND_CACHE_TTL / 2));
+    }
+}
+
+void BackendDiscovery::refresh() {
+    // Chặn tới ~3 s, chỉ trong task này
+    int found = MDNS.queryService(BACKEND_MDNS_SERVICE, "_tcp");
+    stats.queries++;
+    stats.lastQueryMs = millis();
+    
+    Instance fresh[BACKEND_MAX_INSTANCES];
+    uint8_t freshCount = 0;
+    for (int i = 0; i < found && freshCount < BACKEND_MAX_INSTANCES; i++) {
+        IPAddress ip = MDNS.IP(i);
+        if ((uint32_t)ip == 0) {
+            continue;
+        }
+        Instance& instance = fresh[freshCount++];
+        snprintf(instance.base, sizeof(instance.base), BACKEND_SCHEME "://%u.%u.%u.%u:%u",
+                 ip[0], ip[1], ip[2], ip[3], MDNS.port(i));
+        instance.failedAt = 0;
+    }
+    
+    if (freshCount == 0) {
+        // Không ai trả lời (mất gói multicast, backend đang khởi động lại): giữ địa chỉ cũ
+        stats.emptyQueries++;
+        DEBUG_PRINTF("[MDNS] No backend found, keeping %s\n", count > 0 ? "cached address" : API_BASE_URL);
+        return;
+    }
+    
+    bool changed = false;
+    uint32_t now = millis();
+    portENTER_CRITICAL(&lock);
+    // Giữ trạng thái lỗi của instance cũ và giữ instance đang dùng nếu vẫn còn
+    const char* current = count > 0 ? instances[active].base : fallback;
+    uint8_t nextActive = freshCount;
+    for (uint8_t i = 0; i < freshCount; i++) {
+        for (uint8_t j = 0; j < count; j++) {
+            if (strcmp(fresh[i].base, instances[j].base) == 0) {
+                fresh[i].failedAt = instances[j].failedAt;
+            }
+        }
+        if (strcmp(fresh[i].base, current) == 0 && isUsable(fresh[i], now)) {
+            nextActive = i;
+        }
+    }
+    if (nextActive == freshCount) {
+        nextActive = 0;
+        for (uint8_t i = 0; i < freshCount; i++) {
+            if (isUsable(fresh[i], now)) {
+                nextActive = i;
+                break;
+            }
+        }
+        changed = true;
+    }
+    memcpy(instances, fresh, sizeof(Instance) * freshCount);
+    count = freshCount;
+    active = nextActive;
+    expiresAt = now + BACKEND_CACHE_TTL;
+    if (changed) {
+        generation++;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (changed) {
+        DEBUG_PRINTF("[MDNS] Backend: %s (%u instance(s))\n", instances[active].base, count);
+    }
+}
+
+void BackendDiscovery::printStats() const {
+    char url[BACKEND_URL_LEN];
+    formatUrl("", url, sizeof(url));
+    DEBUG_PRINTF("[MDNS] backend=%s instances=%u %s queries=%u empty=%u failovers=%u\n", url, count,
+                 isCacheFresh() ? "fresh" : "stale", stats.queries, stats.emptyQueries, stats.failovers);
+}
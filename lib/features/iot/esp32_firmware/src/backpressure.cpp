@@ -0,0 +1,147 @@
+#include "backpressure.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Backpressure backpressure;
+
+Backpressure::Backpressure()
+    : limit(1.0f), holdUntil(0), nextBackgroundAt(0), overloadStreak(0), holding(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool Backpressure::isOverloadStatus(int httpCode) {
+    return httpCode == HTTP_STATUS_TOO_MANY_REQUESTS || httpCode == HTTP_STATUS_SERVICE_UNAVAILABLE;
+}
+
+void Backpressure::onResponse(int httpCode, uint32_t retryAfterMs, uint32_t rttMs, uint32_t now,
+                              uint32_t random) {
+    if (isOverloadStatus(httpCode)) {
+        stats.overloads++;
+        if (overloadStreak < 8) {
+            overloadStreak++;
+        }
+    
+        uint32_t hold = retryAfterMs;
+        if (hold > 0) {
+            stats.retryAfters++;
+        } else {
+            hold = (uint32_t)BACKPRESSURE_DEFAULT_HOLD << (overloadStreak - 1);
+        }
+        if (hold > BACKPRESSURE_MAX_HOLD) {
+            hold = BACKPRESSURE_MAX_HOLD;
+        }
+        // Retry-After là thời gian tối thiểu: cộng thêm tới 25% để các trạm cùng nhận
+        // một giá trị không quay lại đúng cùng một lúc
+        hold += random % (hold / 4 + 1);
+        holdUntil = now + hold;
+        holding = true;
+        decrease();
+    } else {
+        overloadStreak = 0;
+        limit += BACKPRESSURE_INCREASE;
+        if (limit > 1.0f) {
+            limit = 1.0f;
+        }
+    }
+    pace(rttMs, now);
+}
+
+void Backpressure::onTimeout(uint32_t rttMs, uint32_t now) {
+    stats.timeouts++;
+    decrease();
+    pace(rttMs, now);
+}
+
+void Backpressure::decrease() {
+    limit *= BACKPRESSURE_DECREASE;
+    if (limit < BACKPRESSURE_MIN_LIMIT) {
+        limit = BACKPRESSURE_MIN_LIMIT;
+    }
+    stats.decreases++;
+}
+
+// Trung bình `limit` request đang bay: sau mỗi request nghỉ rtt * (1/limit - 1)
+void Backpressure::pace(uint32_t rttMs, uint32_t now) {
+    uint32_t gap = 0;
+    if (limit < 1.0f) {
+        float idle = rttMs * (1.0f / limit - 1.0f);
+        gap = idle < BACKPRESSURE_MAX_PACING ? (uint32_t)idle : BACKPRESSURE_MAX_PACING;
+    }
+    nextBackgroundAt = now + gap;
+}
+
+bool Backpressure::isHolding(uint32_t now) const {
+    return holdRemaining(now) > 0;
+}
+
+uint32_t Backpressure::holdRemaining(uint32_t now) const {
+    int32_t remaining = (int32_t)(holdUntil - now);
+    return holding && remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+uint32_t Backpressure::backgroundDelay(uint32_t now) const {
+    int32_t paced = (int32_t)(nextBackgroundAt - now);
+    uint32_t delay = paced > 0 ? (uint32_t)paced : 0;
+    uint32_t hold = holdRemaining(now);
+    return hold > delay ? hold : delay;
+}
+
+uint32_t Backpressure::retryDelay(uint8_t attempt, uint32_t random) {
+    uint32_t delay = REQUEST_RETRY_DELAY;
+    for (uint8_t i = 1; i < attempt && delay < REQUEST_RETRY_MAX_DELAY; i++) {
+        delay *= 2;
+    }
+    if (delay > REQUEST_RETRY_MAX_DELAY) {
+        delay = REQUEST_RETRY_MAX_DELAY;
+    }
+    return delay / 2 + random % (delay / 2 + 1);
+}
+
+// Số ngày từ 1970-01-01 (lịch Gregory, thuật toán days_from_civil)
+static int64_t daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = (unsigned)(year - era * 400);
+    unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int64_t)dayOfEra - 719468;
+}
+
+uint32_t Backpressure::parseRetryAfter(const char* value, uint64_t nowEpochMs) {
+    if (value == nullptr) {
+        return 0;
+    }
+    while (*value == ' ') {
+        value++;
+    }
+    
+    // delay-seconds
+    if (*value >= '0' && *value <= '9') {
+        unsigned long seconds = strtoul(value, nullptr, 10);
+        // Giới hạn một ngày để phép nhân không tràn; BACKPRESSURE_MAX_HOLD cắt tiếp
+        return (uint32_t)(seconds < 86400 ? seconds : 86400) * 1000;
+    }
+    
+    // IMF-fixdate: "Wed, 21 Oct 2015 07:28:00 GMT"
+    static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char* comma = strchr(value, ',');
+    int day, year, hour, minute, second;
+    char month[4];
+    if (nowEpochMs == 0 || comma == nullptr ||
+        sscanf(comma + 1, " %2d %3s %4d %2d:%2d:%2d GMT", &day, month, &year, &hour, &minute, &second) != 6) {
+        return 0;
+    }
+    const char* found = strstr(MONTHS, month);
+    if (strlen(month) != 3 || found == nullptr || (found - MONTHS) % 3 != 0) {
+        return 0;
+    }
+    
+    unsigned monthIndex = (unsigned)(found - MONTHS) / 3 + 1;
+    int64_t epochSeconds = daysFromCivil(year, monthIndex, day) * 86400 + hour * 3600 + minute * 60 + second;
+    int64_t remainingMs = epochSeconds * 1000 - (int64_t)nowEpochMs;
+    if (remainingMs <= 0) {
+        return 0;
+    }
+    return remainingMs < 86400000 ? (uint32_t)remainingMs : 86400000;
+}
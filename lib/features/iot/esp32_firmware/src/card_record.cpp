@@ -0,0 +1,103 @@
+#include "card_record.h"
+#include <string.h>
+#include <mbedtls/md.h>
+
+namespace CardRecord {
+
+static const size_t SIGNED_LEN = CARD_RECORD_SIZE - CARD_RECORD_SIG_LEN;
+
+// Helper: HMAC-SHA256(key, data || uid), lấy CARD_RECORD_SIG_LEN byte đầu
+static bool sign(const uint8_t* data, const uint8_t* uid, uint8_t uidLength,
+                 const char* key, uint8_t signature[CARD_RECORD_SIG_LEN]) {
+    uint8_t mac[32];
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    
+    bool ok = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0 &&
+              mbedtls_md_hmac_starts(&ctx, (const unsigned char*)key, strlen(key)) == 0 &&
+              mbedtls_md_hmac_update(&ctx, data, SIGNED_LEN) == 0 &&
+              mbedtls_md_hmac_update(&ctx, uid, uidLength) == 0 &&
+              mbedtls_md_hmac_finish(&ctx, mac) == 0;
+    
+    mbedtls_md_free(&ctx);
+    memcpy(signature, mac, CARD_RECORD_SIG_LEN);
+    return ok;
+}
+
+bool encode(const StudentCardRecord& record, const uint8_t* uid, uint8_t uidLength,
+            const char* key, uint8_t output[CARD_RECORD_SIZE]) {
+    size_t mssvLen = strlen(record.mssv);
+    size_t nameLen = strlen(record.name);
+    if (mssvLen == 0 || mssvLen > CARD_RECORD_MSSV_LEN || nameLen > CARD_RECORD_NAME_LEN) {
+        return false;
+    }
+    
+    memset(output, 0, CARD_RECORD_SIZE);
+    output[0] = 'L';
+    output[1] = 'B';
+    output[2] = CARD_RECORD_VERSION;
+    output[4] = record.expiry & 0xFF;
+    output[5] = (record.expiry >> 8) & 0xFF;
+    output[6] = (record.expiry >> 16) & 0xFF;
+    output[7] = (record.expiry >> 24) & 0xFF;
+    memcpy(output + 8, record.mssv, mssvLen);
+    memcpy(output + 20, record.name, nameLen);
+    
+    return sign(output, uid, uidLength, key, output + SIGNED_LEN);
+}
+
+CardRecordStatus decode(const uint8_t input[CARD_RECORD_SIZE], const uint8_t* uid, uint8_t uidLength,
+                        const char* key, StudentCardRecord& record) {
+    memset(&record, 0, sizeof(record));
+    
+    // Thẻ mới: toàn 0x00 (MIFARE) hoặc toàn 0xFF
+    if ((input[0] == 0x00 && input[1] == 0x00) || (input[0] == 0xFF && input[1] == 0xFF)) {
+        return CARD_RECORD_EMPTY;
+    }
+    if (input[0] != 'L' || input[1] != 'B' || input[2] != CARD_RECORD_VERSION) {
+        return CARD_RECORD_BAD_FORMAT;
+    }
+    
+    uint8_t expected[CARD_RECORD_SIG_LEN];
+    if (!sign(input, uid, uidLength, key, expected)) {
+        return CARD_RECORD_BAD_SIGNATURE;
+    }
+    // So sánh không rẽ nhánh theo dữ liệu
+    uint8_t diff = 0;
+    for (size_t i = 0; i < CARD_RECORD_SIG_LEN; i++) {
+        diff |= expected[i] ^ input[SIGNED_LEN + i];
+    }
+    if (diff != 0) {
+        return CARD_RECORD_BAD_SIGNATURE;
+    }
+    
+    record.expiry = (uint32_t)input[4] | ((uint32_t)input[5] << 8) |
+                    ((uint32_t)input[6] << 16) | ((uint32_t)input[7] << 24);
+    memcpy(record.mssv, input + 8, CARD_RECORD_MSSV_LEN);
+    memcpy(record.name, input + 20, CARD_RECORD_NAME_LEN);
+    // Các mảng dài hơn 1 byte đã được memset 0 nên luôn kết thúc '\0'
+    
+    if (record.mssv[0] == '\0') {
+        return CARD_RECORD_BAD_FORMAT;
+    }
+    return CARD_RECORD_OK;
+}
+
+bool isExpired(const StudentCardRecord& record, uint32_t today) {
+    return record.expiry != 0 && today != 0 && today > record.expiry;
+}
+
+const char* statusName(CardRecordStatus status) {
+    switch (status) {
+        case CARD_RECORD_OK: return "OK";
+        case CARD_RECORD_EMPTY: return "EMPTY";
+        case CARD_RECORD_BAD_FORMAT: return "BAD_FORMAT";
+        case CARD_RECORD_BAD_SIGNATURE: return "BAD_SIGNATURE";
+        case CARD_RECORD_EXPIRED: return "EXPIRED";
+        case CARD_RECORD_IO_ERROR: return "IO_ERROR";
+        case CARD_RECORD_UNSUPPORTED: return "UNSUPPORTED";
+    }
+    return "UNKNOWN";
+}
+
+} // namespace CardRecord
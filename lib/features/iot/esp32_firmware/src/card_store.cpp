@@ -0,0 +1,94 @@
+#include "card_store.h"
+#include "config.h"
+#include <string.h>
+
+namespace CardStore {
+
+static const uint8_t CLASSIC_DATA_BLOCKS = CARD_RECORD_SIZE / 16;   // 6 block
+static const uint8_t NTAG_PAGES = CARD_RECORD_SIZE / 4;              // 24 trang
+
+// Helper: block dữ liệu thứ i của bản ghi (bỏ qua sector trailer)
+static uint8_t classicBlock(uint8_t index) {
+    uint8_t sector = CARD_RECORD_SECTOR + index / 3;
+    return sector * 4 + index % 3;
+}
+
+static bool readRaw(PiccTransport& picc, const uint8_t sectorKey[6], uint8_t raw[CARD_RECORD_SIZE]) {
+    if (picc.kind() == PICC_KIND_MIFARE_CLASSIC) {
+        for (uint8_t i = 0; i < CLASSIC_DATA_BLOCKS; i++) {
+            uint8_t block = classicBlock(i);
+            // Xác thực một lần cho mỗi sector
+            if (i % 3 == 0 && !picc.authenticate(block, sectorKey)) {
+                return false;
+            }
+            if (!picc.read16(block, raw + i * 16)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // NTAG: mỗi lệnh READ trả về 4 trang
+    for (uint8_t i = 0; i < NTAG_PAGES; i += 4) {
+        if (!picc.read16(CARD_RECORD_NTAG_PAGE + i, raw + i * 4)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CardRecordStatus readRecord(PiccTransport& picc, const char* key, const uint8_t sectorKey[6],
+                            StudentCardRecord& record) {
+    memset(&record, 0, sizeof(record));
+    if (picc.kind() == PICC_KIND_UNKNOWN) {
+        return CARD_RECORD_UNSUPPORTED;
+    }
+    
+    uint8_t raw[CARD_RECORD_SIZE];
+    if (!readRaw(picc, sectorKey, raw)) {
+        return CARD_RECORD_IO_ERROR;
+    }
+    
+    uint8_t uidLength = 0;
+    const uint8_t* uid = picc.uid(uidLength);
+    return CardRecord::decode(raw, uid, uidLength, key, record);
+}
+
+CardRecordStatus writeRecord(PiccTransport& picc, const char* key, const uint8_t sectorKey[6],
+                             const StudentCardRecord& record) {
+    if (picc.kind() == PICC_KIND_UNKNOWN) {
+        return CARD_RECORD_UNSUPPORTED;
+    }
+    
+    uint8_t uidLength = 0;
+    const uint8_t* uid = picc.uid(uidLength);
+    
+    uint8_t raw[CARD_RECORD_SIZE];
+    if (!CardRecord::encode(record, uid, uidLength, key, raw)) {
+        return CARD_RECORD_BAD_FORMAT;
+    }
+    
+    if (picc.kind() == PICC_KIND_MIFARE_CLASSIC) {
+        for (uint8_t i = 0; i < CLASSIC_DATA_BLOCKS; i++) {
+            uint8_t block = classicBlock(i);
+            if (i % 3 == 0 && !picc.authenticate(block, sectorKey)) {
+                return CARD_RECORD_IO_ERROR;
+            }
+            if (!picc.writeBlock(block, raw + i * 16)) {
+                return CARD_RECORD_IO_ERROR;
+            }
+        }
+    } else {
+        for (uint8_t i = 0; i < NTAG_PAGES; i++) {
+            if (!picc.writePage(CARD_RECORD_NTAG_PAGE + i, raw + i * 4)) {
+                return CARD_RECORD_IO_ERROR;
+            }
+        }
+    }
+    
+    // Đọc lại để chắc chắn thẻ đã ghi đúng
+    StudentCardRecord check;
+    return readRecord(picc, key, sectorKey, check);
+}
+
+} // namespace CardStore
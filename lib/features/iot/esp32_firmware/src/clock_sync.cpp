@@ -0,0 +1,57 @@
+#include "clock_sync.h"
+#include <esp_sntp.h>
+#include <sys/time.h>
+#include <time.h>
+
+ClockSync clockSync;
+
+// Trước mốc này coi như chưa có giờ (RTC bắt đầu từ 1970 sau khi reset)
+static const time_t MIN_VALID_EPOCH = 1577836800;  // 2020-01-01
+
+ClockSync::ClockSync() : syncCount(0), lastSyncMs(0), started(false) {}
+
+void ClockSync::begin() {
+    if (started) {
+        return;
+    }
+    started = true;
+    
+    sntp_set_time_sync_notification_cb(onTimeSync);
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL);
+    configTzTime(NTP_TIMEZONE, NTP_SERVER, NTP_FALLBACK_SERVER);
+    DEBUG_PRINTF("[CLOCK] SNTP started (%s)\n", NTP_SERVER);
+}
+
+// Chạy trong task tcpip của lwIP
+void ClockSync::onTimeSync(struct timeval* tv) {
+    clockSync.syncCount++;
+    clockSync.lastSyncMs = millis();
+    DEBUG_PRINTF("[CLOCK] Synced: %ld\n", (long)tv->tv_sec);
+}
+
+bool ClockSync::isSynced() const {
+    return time(nullptr) >= MIN_VALID_EPOCH;
+}
+
+uint64_t ClockSync::nowEpochMs() const {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < MIN_VALID_EPOCH) {
+        return 0;
+    }
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void ClockSync::printStats() const {
+    if (!isSynced()) {
+        DEBUG_PRINTLN("[CLOCK] Not synced");
+        return;
+    }
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    char text[24];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    DEBUG_PRINTF("[CLOCK] %s syncs=%u last=%us ago\n", text, (unsigned)syncCount,
+                 (unsigned)((millis() - lastSyncMs) / 1000));
+}
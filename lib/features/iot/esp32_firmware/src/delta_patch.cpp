@@ -0,0 +1,414 @@
+#include "delta_patch.h"
+#include <string.h>
+
+// Varint dài nhất của một số 64-bit
+#define VARINT_MAX_SHIFT 63
+
+static uint32_t readLe32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+DeltaPatcher::DeltaPatcher()
+    : source(nullptr), sink(nullptr), hashReady(false), status(DELTA_BAD_HEADER), stage(STAGE_HEADER),
+      headerLength(0), lzPos(0), flags(0), matchLength(0), varint(0), varintShift(0),
+      diffLeft(0), extraLeft(0), runLeft(0), seek(0), sourcePos(0), bufferStart(0), bufferLength(0),
+      outputLength(0), patchBytes(0), written(0), copiedBytes(0) {
+    memset(&header, 0, sizeof(header));
+    // Ngữ cảnh SHA-256 cấp một lần, dùng lại cho mọi lần cập nhật
+    mbedtls_md_init(&hash);
+    hashReady = mbedtls_md_setup(&hash, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0) == 0;
+}
+
+DeltaPatcher::~DeltaPatcher() {
+    mbedtls_md_free(&hash);
+}
+
+void DeltaPatcher::begin(DeltaSource& source, DeltaSink& sink) {
+    this->source = &source;
+    this->sink = &sink;
+    status = hashReady ? DELTA_RUNNING : DELTA_BAD_HEADER;
+    stage = STAGE_HEADER;
+    memset(&header, 0, sizeof(header));
+    headerLength = 0;
+    varint = 0;
+    varintShift = 0;
+    diffLeft = 0;
+    extraLeft = 0;
+    runLeft = 0;
+    seek = 0;
+    sourcePos = 0;
+    bufferStart = 0;
+    bufferLength = 0;
+    lzPos = 0;
+    flags = 0;
+    matchLength = 0;
+    outputLength = 0;
+    patchBytes = 0;
+    written = 0;
+    copiedBytes = 0;
+}
+
+const char* DeltaPatcher::statusName(DeltaStatus status) {
+    switch (status) {
+        case DELTA_RUNNING: return "running";
+        case DELTA_DONE: return "done";
+        case DELTA_BAD_HEADER: return "bad_header";
+        case DELTA_SOURCE_MISMATCH: return "source_mismatch";
+        case DELTA_CORRUPT: return "corrupt";
+        case DELTA_READ_FAILED: return "read_failed";
+        case DELTA_WRITE_FAILED: return "write_failed";
+        case DELTA_HASH_MISMATCH: return "hash_mismatch";
+    }
+    return "unknown";
+}
+
+DeltaStatus DeltaPatcher::feed(const uint8_t* data, size_t length) {
+    patchBytes += length;
+    // Header không nén: ảnh nguồn được kiểm tra trước khi giải nén phần còn lại
+    if (stage == STAGE_HEADER && status == DELTA_RUNNING) {
+        size_t n = DELTA_HEADER_LEN - headerLength;
+        n = n < length ? n : length;
+        memcpy(headerBytes + headerLength, data, n);
+        headerLength += n;
+        data += n;
+        length -= n;
+        if (headerLength == DELTA_HEADER_LEN) {
+            status = parseHeader();
+        }
+    }
+    if (length > 0 && status == DELTA_DONE) {
+        status = DELTA_CORRUPT;
+    }
+    if (status == DELTA_RUNNING) {
+        inflate(data, length);
+    }
+    return status;
+}
+
+// Giải nén LZSS, mỗi phần tử giải xong đưa ngay cho bộ đọc record
+void DeltaPatcher::inflate(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (status == DELTA_DONE) {
+            // Dữ liệu sau record cuối: bản vá không khớp với header
+            status = DELTA_CORRUPT;
+        }
+        if (status != DELTA_RUNNING) {
+            return;
+        }
+        uint8_t byte = data[i];
+        if ((flags & 0x100) == 0) {
+            // Byte cờ mới; bit 8-15 đánh dấu còn bao nhiêu bit chưa dùng
+            flags = byte | 0xFF00;
+            continue;
+        }
+        if (flags & 1) {
+            flags >>= 1;
+            lzWindow[lzPos++ & (DELTA_LZ_WINDOW - 1)] = byte;
+            consume(&byte, 1);
+            continue;
+        }
+        
+        matchBytes[matchLength++] = byte;
+        if (matchLength < 2) {
+            continue;
+        }
+        matchLength = 0;
+        flags >>= 1;
+        uint32_t distance = (matchBytes[0] | ((uint32_t)(matchBytes[1] & 0xF0) << 4)) + 1;
+        uint8_t count = (matchBytes[1] & 0x0F) + DELTA_LZ_MIN_MATCH;
+        if (distance > lzPos) {
+            status = DELTA_CORRUPT;
+            return;
+        }
+        // Từng byte một: đoạn lặp có thể chồng lên chính nó (khoảng cách < độ dài)
+        uint8_t run[DELTA_LZ_MAX_MATCH];
+        for (uint8_t k = 0; k < count; k++) {
+            run[k] = lzWindow[(lzPos - distance) & (DELTA_LZ_WINDOW - 1)];
+            lzWindow[lzPos++ & (DELTA_LZ_WINDOW - 1)] = run[k];
+        }
+        consume(run, count);
+    }
+}
+
+void DeltaPatcher::consume(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        if (status == DELTA_DONE) {
+            status = DELTA_CORRUPT;
+        }
+        if (status != DELTA_RUNNING) {
+            return;
+        }
+        size_t consumed = step(data, length);
+        data += consumed;
+        length -= consumed;
+    }
+}
+
+// Xử lý phần đầu của data theo stage hiện tại, trả về số byte đã dùng.
+// Lỗi thì ghi vào status (vòng lặp trong consume() dừng lại)
+size_t DeltaPatcher::step(const uint8_t* data, size_t length) {
+    switch (stage) {
+        case STAGE_LITERAL: {
+            // Byte mới = byte cũ cùng vị trí + diff
+            size_t n = runLeft < length ? runLeft : length;
+            for (size_t i = 0; i < n; i++) {
+                if (!loadSource(sourcePos)) {
+                    status = DELTA_READ_FAILED;
+                    return i;
+                }
+                if (!putByte(sourceBuffer[sourcePos - bufferStart] + data[i])) {
+                    status = DELTA_WRITE_FAILED;
+                    return i;
+                }
+                sourcePos++;
+            }
+            runLeft -= n;
+            if (runLeft == 0) {
+                status = nextRun();
+            }
+            return n;
+        }
+        case STAGE_EXTRA: {
+            size_t n = extraLeft < length ? extraLeft : length;
+            for (size_t i = 0; i < n; i++) {
+                if (!putByte(data[i])) {
+                    status = DELTA_WRITE_FAILED;
+                    return i;
+                }
+            }
+            extraLeft -= n;
+            if (extraLeft == 0) {
+                status = endRecord();
+            }
+            return n;
+        }
+        default:
+            break;
+    }
+    
+    // Các stage còn lại đọc một varint
+    if (!readVarint(data[0])) {
+        return 1;
+    }
+    uint64_t value = varint;
+    varint = 0;
+    varintShift = 0;
+    switch (stage) {
+        case STAGE_DIFF_LENGTH:
+            if (value > header.targetSize) {
+                status = DELTA_CORRUPT;
+                break;
+            }
+            diffLeft = (uint32_t)value;
+            stage = STAGE_EXTRA_LENGTH;
+            break;
+        case STAGE_EXTRA_LENGTH:
+            if (value > header.targetSize) {
+                status = DELTA_CORRUPT;
+                break;
+            }
+            extraLeft = (uint32_t)value;
+            stage = STAGE_SEEK;
+            break;
+        case STAGE_SEEK:
+            // zigzag: bit thấp là dấu
+            seek = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+            status = startRecord();
+            break;
+        case STAGE_ZERO_RUN:
+            if (value > diffLeft) {
+                status = DELTA_CORRUPT;
+                break;
+            }
+            diffLeft -= (uint32_t)value;
+            if (!copySource((uint32_t)value)) {
+                break;
+            }
+            if (diffLeft == 0) {
+                status = nextRun();
+            } else {
+                stage = STAGE_LITERAL_RUN;
+            }
+            break;
+        case STAGE_LITERAL_RUN:
+            if (value > diffLeft) {
+                status = DELTA_CORRUPT;
+                break;
+            }
+            diffLeft -= (uint32_t)value;
+            runLeft = (uint32_t)value;
+            if (runLeft > 0) {
+                stage = STAGE_LITERAL;
+            } else {
+                status = nextRun();
+            }
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+DeltaStatus DeltaPatcher::parseHeader() {
+    if (memcmp(headerBytes, DELTA_MAGIC, 4) != 0) {
+        return DELTA_BAD_HEADER;
+    }
+    header.sourceSize = readLe32(headerBytes + 4);
+    header.targetSize = readLe32(headerBytes + 8);
+    memcpy(header.sourceHash, headerBytes + 12, DELTA_HASH_LEN);
+    memcpy(header.targetHash, headerBytes + 12 + DELTA_HASH_LEN, DELTA_HASH_LEN);
+    if (header.targetSize == 0 || header.sourceSize > source->size()) {
+        return DELTA_BAD_HEADER;
+    }
+    
+    // Bản vá tạo cho một bản firmware khác: dừng trước khi xóa phân vùng đích
+    if (!verifySource()) {
+        return status == DELTA_RUNNING ? DELTA_SOURCE_MISMATCH : status;
+    }
+    if (!sink->begin(header.targetSize)) {
+        return DELTA_WRITE_FAILED;
+    }
+    if (mbedtls_md_starts(&hash) != 0) {
+        return DELTA_WRITE_FAILED;
+    }
+    stage = STAGE_DIFF_LENGTH;
+    return DELTA_RUNNING;
+}
+
+bool DeltaPatcher::verifySource() {
+    uint8_t digest[DELTA_HASH_LEN];
+    if (mbedtls_md_starts(&hash) != 0) {
+        return false;
+    }
+    for (uint32_t offset = 0; offset < header.sourceSize; offset += DELTA_CHUNK_SIZE) {
+        uint32_t n = header.sourceSize - offset;
+        n = n < DELTA_CHUNK_SIZE ? n : DELTA_CHUNK_SIZE;
+        if (!source->read(offset, sourceBuffer, n)) {
+            status = DELTA_READ_FAILED;
+            return false;
+        }
+        mbedtls_md_update(&hash, sourceBuffer, n);
+    }
+    mbedtls_md_finish(&hash, digest);
+    // Bộ đệm giờ chứa đoạn cuối ảnh nguồn, không còn là cửa sổ hợp lệ
+    bufferLength = 0;
+    return memcmp(digest, header.sourceHash, DELTA_HASH_LEN) == 0;
+}
+
+bool DeltaPatcher::readVarint(uint8_t byte) {
+    if (varintShift > VARINT_MAX_SHIFT) {
+        status = DELTA_CORRUPT;
+        return false;
+    }
+    varint |= (uint64_t)(byte & 0x7F) << varintShift;
+    varintShift += 7;
+    return (byte & 0x80) == 0;
+}
+
+// Đã có đủ bộ ba (diff, extra, seek): kiểm tra record nằm trong ảnh nguồn/đích
+DeltaStatus DeltaPatcher::startRecord() {
+    if ((uint64_t)sourcePos + diffLeft > header.sourceSize ||
+        (uint64_t)written + diffLeft + extraLeft > header.targetSize) {
+        return DELTA_CORRUPT;
+    }
+    if (diffLeft > 0) {
+        stage = STAGE_ZERO_RUN;
+        return DELTA_RUNNING;
+    }
+    if (extraLeft > 0) {
+        stage = STAGE_EXTRA;
+        return DELTA_RUNNING;
+    }
+    return endRecord();
+}
+
+// Hết một lượt byte khác 0 của diff
+DeltaStatus DeltaPatcher::nextRun() {
+    if (diffLeft > 0) {
+        stage = STAGE_ZERO_RUN;
+        return DELTA_RUNNING;
+    }
+    if (extraLeft > 0) {
+        stage = STAGE_EXTRA;
+        return DELTA_RUNNING;
+    }
+    return endRecord();
+}
+
+DeltaStatus DeltaPatcher::endRecord() {
+    int64_t position = (int64_t)sourcePos + seek;
+    if (position < 0 || position > (int64_t)header.sourceSize) {
+        return DELTA_CORRUPT;
+    }
+    sourcePos = (uint32_t)position;
+    if (written < header.targetSize) {
+        stage = STAGE_DIFF_LENGTH;
+        return DELTA_RUNNING;
+    }
+    
+    // Đủ ảnh đích: SHA-256 khớp thì người gọi mới được chuyển phân vùng khởi động
+    stage = STAGE_FINISHED;
+    if (!flushOutput()) {
+        return DELTA_WRITE_FAILED;
+    }
+    uint8_t digest[DELTA_HASH_LEN];
+    mbedtls_md_finish(&hash, digest);
+    return memcmp(digest, header.targetHash, DELTA_HASH_LEN) == 0 ? DELTA_DONE : DELTA_HASH_MISMATCH;
+}
+
+bool DeltaPatcher::loadSource(uint32_t position) {
+    if (position >= bufferStart && position < bufferStart + bufferLength) {
+        return true;
+    }
+    uint32_t n = header.sourceSize - position;
+    n = n < DELTA_CHUNK_SIZE ? n : DELTA_CHUNK_SIZE;
+    if (n == 0 || !source->read(position, sourceBuffer, n)) {
+        bufferLength = 0;
+        return false;
+    }
+    bufferStart = position;
+    bufferLength = n;
+    return true;
+}
+
+// Lượt byte 0 của diff: byte mới trùng byte cũ
+bool DeltaPatcher::copySource(uint32_t count) {
+    while (count > 0) {
+        if (!loadSource(sourcePos)) {
+            status = DELTA_READ_FAILED;
+            return false;
+        }
+        uint32_t offset = sourcePos - bufferStart;
+        uint32_t n = bufferLength - offset;
+        n = n < count ? n : count;
+        size_t room = DELTA_CHUNK_SIZE - outputLength;
+        n = n < room ? n : (uint32_t)room;
+        memcpy(output + outputLength, sourceBuffer + offset, n);
+        outputLength += n;
+        written += n;
+        copiedBytes += n;
+        sourcePos += n;
+        count -= n;
+        if (outputLength == DELTA_CHUNK_SIZE && !flushOutput()) {
+            status = DELTA_WRITE_FAILED;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaPatcher::putByte(uint8_t value) {
+    output[outputLength++] = value;
+    written++;
+    return outputLength < DELTA_CHUNK_SIZE || flushOutput();
+}
+
+bool DeltaPatcher::flushOutput() {
+    if (outputLength == 0) {
+        return true;
+    }
+    mbedtls_md_update(&hash, output, outputLength);
+    bool ok = sink->write(output, outputLength);
+    outputLength = 0;
+    return ok;
+}
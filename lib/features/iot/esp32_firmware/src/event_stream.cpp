@@ -0,0 +1,251 @@
+#include "event_stream.h"
+#include <errno.h>
+#include <lwip/sockets.h>
+
+EventStream::EventStream(uint16_t port) : server(port), started(false) {
+    memset(&stats, 0, sizeof(stats));
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        clients[i].state = CLIENT_FREE;
+    }
+}
+
+void EventStream::begin() {
+    server.begin();
+    server.setNoDelay(true);
+    started = true;
+    DEBUG_PRINTF("[WS] Event stream on port %d\n", EVENT_STREAM_PORT);
+}
+
+void EventStream::service() {
+    if (!started) {
+        return;
+    }
+    acceptClients();
+    
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        Client& client = clients[i];
+        if (client.state == CLIENT_FREE) {
+            continue;
+        }
+        if (!client.socket.connected()) {
+            drop(client);
+            continue;
+        }
+        if (client.state == CLIENT_HANDSHAKE) {
+            serviceHandshake(client);
+        } else if (client.state == CLIENT_OPEN) {
+            serviceOpen(client);
+        }
+        if (client.state != CLIENT_FREE && !flush(client)) {
+            drop(client);
+            continue;
+        }
+        // Đã gửi hết frame close thì đóng socket
+        if (client.state == CLIENT_CLOSING && client.outbox.size() == 0) {
+            drop(client);
+        }
+    }
+}
+
+void EventStream::acceptClients() {
+    WiFiClient incoming = server.accept();
+    if (!incoming) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        Client& client = clients[i];
+        if (client.state == CLIENT_FREE) {
+            client.socket = incoming;
+            client.socket.setNoDelay(true);
+            client.state = CLIENT_HANDSHAKE;
+            client.since = millis();
+            client.received = 0;
+            client.outbox.reset();
+            return;
+        }
+    }
+    
+    // Hết slot: từ chối ngay, không để client chờ
+    stats.rejected++;
+    incoming.stop();
+}
+
+void EventStream::serviceHandshake(Client& client) {
+    // Request nâng cấp đọc vào vùng outbox (chưa có gì để gửi)
+    char* request = (char*)client.outbox.raw();
+    size_t capacity = EVENT_STREAM_CLIENT_BUFFER - 1;
+    int available = client.socket.available();
+    if (available > 0 && client.received < capacity) {
+        size_t want = capacity - client.received;
+        if ((size_t)available < want) {
+            want = available;
+        }
+        int n = client.socket.read((uint8_t*)request + client.received, want);
+        if (n > 0) {
+            client.received += n;
+        }
+    }
+    request[client.received] = '\0';
+    
+    if (strstr(request, "\r\n\r\n") == nullptr) {
+        if (client.received >= capacity || millis() - client.since > EVENT_STREAM_HANDSHAKE_TIMEOUT) {
+            stats.rejected++;
+            drop(client);
+        }
+        return;
+    }
+    
+    char acceptKey[WS_ACCEPT_KEY_LEN];
+    char response[160];
+    size_t length = 0;
+    if (WsProtocol::parseUpgrade(request, acceptKey)) {
+        length = WsProtocol::buildHandshakeResponse(acceptKey, response, sizeof(response));
+    }
+    client.received = 0;
+    client.outbox.reset();
+    if (length == 0) {
+        static const char badRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+        client.outbox.push((const uint8_t*)badRequest, sizeof(badRequest) - 1);
+        client.state = CLIENT_CLOSING;
+        stats.rejected++;
+        return;
+    }
+    
+    client.outbox.push((const uint8_t*)response, length);
+    client.state = CLIENT_OPEN;
+    client.since = millis();
+    client.lastPing = client.since;
+    stats.accepted++;
+    DEBUG_PRINTF("[WS] Client connected: %s (%d open)\n",
+                 client.socket.remoteIP().toString().c_str(), getClientCount());
+}
+
+void EventStream::serviceOpen(Client& client) {
+    int available = client.socket.available();
+    if (available > 0) {
+        size_t want = sizeof(client.rx) - client.received;
+        if ((size_t)available < want) {
+            want = available;
+        }
+        int n = client.socket.read(client.rx + client.received, want);
+        if (n > 0) {
+            client.received += n;
+            client.since = millis();
+        }
+    }
+    
+    // Xử lý các frame đã đủ
+    size_t offset = 0;
+    while (offset < client.received && client.state == CLIENT_OPEN) {
+        WsFrame frame;
+        int used = WsProtocol::parseClientFrame(client.rx + offset, client.received - offset, frame);
+        if (used < 0 || (used == 0 && offset == 0 && client.received == sizeof(client.rx))) {
+            // Sai giao thức, hoặc frame lớn hơn buffer nhận (client không có lý do gửi)
+            drop(client);
+            return;
+        }
+        if (used == 0) {
+            break;
+        }
+        offset += used;
+    
+        if (frame.opcode == WS_OPCODE_PING) {
+            sendFrame(client, WS_OPCODE_PONG, frame.payload, frame.length);
+        } else if (frame.opcode == WS_OPCODE_CLOSE) {
+            sendFrame(client, WS_OPCODE_CLOSE, frame.payload, frame.length >= 2 ? 2 : 0);
+            client.state = CLIENT_CLOSING;
+        }
+        // Text/binary/pong từ client: bỏ qua (luồng một chiều)
+    }
+    if (offset > 0) {
+        memmove(client.rx, client.rx + offset, client.received - offset);
+        client.received -= offset;
+    }
+    
+    if (client.state != CLIENT_OPEN) {
+        return;
+    }
+    uint32_t now = millis();
+    if (now - client.since > 2 * EVENT_STREAM_PING_INTERVAL) {
+        stats.timedOut++;
+        drop(client);
+    } else if (now - client.lastPing > EVENT_STREAM_PING_INTERVAL) {
+        client.lastPing = now;
+        sendFrame(client, WS_OPCODE_PING, nullptr, 0);
+    }
+}
+
+bool EventStream::sendFrame(Client& client, WsOpcode opcode, const uint8_t* payload, size_t length) {
+    uint8_t header[WS_MAX_FRAME_HEADER];
+    size_t headerLength = WsProtocol::frameHeader(opcode, length, header);
+    if (client.outbox.space() < headerLength + length) {
+        return false;
+    }
+    client.outbox.push(header, headerLength);
+    client.outbox.push(payload, length);
+    if (client.outbox.size() > stats.maxQueued) {
+        stats.maxQueued = client.outbox.size();
+    }
+    return true;
+}
+
+void EventStream::publish(const char* json, size_t length) {
+    stats.published++;
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        Client& client = clients[i];
+        if (client.state != CLIENT_OPEN) {
+            continue;
+        }
+        if (!sendFrame(client, WS_OPCODE_TEXT, (const uint8_t*)json, length)) {
+            // Client đọc không kịp: ngắt để không giữ sự kiện cũ hay chặn các client khác
+            DEBUG_PRINTF("[WS] Dropping slow client %s\n", client.socket.remoteIP().toString().c_str());
+            stats.slowDropped++;
+            drop(client);
+            continue;
+        }
+        // Gửi ngay phần vừa xếp, không chờ tới vòng service() sau
+        if (!flush(client)) {
+            drop(client);
+        }
+    }
+}
+
+bool EventStream::flush(Client& client) {
+    while (client.outbox.size() > 0) {
+        const uint8_t* data;
+        size_t length = client.outbox.peek(data);
+        int sent = send(client.socket.fd(), data, length, MSG_DONTWAIT);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.outbox.consume(sent);
+        if ((size_t)sent < length) {
+            return true;                // Buffer TCP đầy, gửi tiếp ở vòng sau
+        }
+    }
+    return true;
+}
+
+void EventStream::drop(Client& client) {
+    client.socket.stop();
+    client.state = CLIENT_FREE;
+    client.received = 0;
+    client.outbox.reset();
+}
+
+uint8_t EventStream::getClientCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        if (clients[i].state == CLIENT_OPEN) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void EventStream::printStats() const {
+    DEBUG_PRINTF("[WS] clients=%d events=%u accepted=%u rejected=%u slow=%u timeout=%u max queued=%uB\n",
+                 getClientCount(), stats.published, stats.accepted, stats.rejected,
+                 stats.slowDropped, stats.timedOut, stats.maxQueued);
+}
@@ -0,0 +1,464 @@
+#include "glyph_atlas.h"
+
+// ============================================
+// Font 5x7 ASCII 0x20..0x7E: 5 cột mỗi ký tự, bit 0 = hàng trên
+// ============================================
+static constexpr uint8_t FONT_5X7[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00},   // ' '
+    {0x00, 0x00, 0x5F, 0x00, 0x00},   // !
+    {0x00, 0x07, 0x00, 0x07, 0x00},   // "
+    {0x14, 0x7F, 0x14, 0x7F, 0x14},   // #
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12},   // $
+    {0x23, 0x13, 0x08, 0x64, 0x62},   // %
+    {0x36, 0x49, 0x55, 0x22, 0x50},   // &
+    {0x00, 0x05, 0x03, 0x00, 0x00},   // '
+    {0x00, 0x1C, 0x22, 0x41, 0x00},   // (
+    {0x00, 0x41, 0x22, 0x1C, 0x00},   // )
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08},   // *
+    {0x08, 0x08, 0x3E, 0x08, 0x08},   // +
+    {0x00, 0x50, 0x30, 0x00, 0x00},   // ,
+    {0x08, 0x08, 0x08, 0x08, 0x08},   // -
+    {0x00, 0x60, 0x60, 0x00, 0x00},   // .
+    {0x20, 0x10, 0x08, 0x04, 0x02},   // /
+    {0x3E, 0x51, 0x49, 0x45, 0x3E},   // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00},   // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46},   // 2
+    {0x21, 0x41, 0x45, 0x4B, 0x31},   // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10},   // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39},   // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x30},   // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03},   // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36},   // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1E},   // 9
+    {0x00, 0x36, 0x36, 0x00, 0x00},   // :
+    {0x00, 0x56, 0x36, 0x00, 0x00},   // ;
+    {0x08, 0x14, 0x22, 0x41, 0x00},   // <
+    {0x14, 0x14, 0x14, 0x14, 0x14},   // =
+    {0x00, 0x41, 0x22, 0x14, 0x08},   // >
+    {0x02, 0x01, 0x51, 0x09, 0x06},   // ?
+    {0x32, 0x49, 0x79, 0x41, 0x3E},   // @
+    {0x7E, 0x11, 0x11, 0x11, 0x7E},   // A
+    {0x7F, 0x49, 0x49, 0x49, 0x36},   // B
+    {0x3E, 0x41, 0x41, 0x41, 0x22},   // C
+    {0x7F, 0x41, 0x41, 0x22, 0x1C},   // D
+    {0x7F, 0x49, 0x49, 0x49, 0x41},   // E
+    {0x7F, 0x09, 0x09, 0x01, 0x01},   // F
+    {0x3E, 0x41, 0x41, 0x51, 0x32},   // G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F},   // H
+    {0x00, 0x41, 0x7F, 0x41, 0x00},   // I
+    {0x20, 0x40, 0x41, 0x3F, 0x01},   // J
+    {0x7F, 0x08, 0x14, 0x22, 0x41},   // K
+    {0x7F, 0x40, 0x40, 0x40, 0x40},   // L
+    {0x7F, 0x02, 0x04, 0x02, 0x7F},   // M
+    {0x7F, 0x04, 0x08, 0x10, 0x7F},   // N
+    {0x3E, 0x41, 0x41, 0x41, 0x3E},   // O
+    {0x7F, 0x09, 0x09, 0x09, 0x06},   // P
+    {0x3E, 0x41, 0x51, 0x21, 0x5E},   // Q
+    {0x7F, 0x09, 0x19, 0x29, 0x46},   // R
+    {0x46, 0x49, 0x49, 0x49, 0x31},   // S
+    {0x01, 0x01, 0x7F, 0x01, 0x01},   // T
+    {0x3F, 0x40, 0x40, 0x40, 0x3F},   // U
+    {0x1F, 0x20, 0x40, 0x20, 0x1F},   // V
+    {0x7F, 0x20, 0x18, 0x20, 0x7F},   // W
+    {0x63, 0x14, 0x08, 0x14, 0x63},   // X
+    {0x03, 0x04, 0x78, 0x04, 0x03},   // Y
+    {0x61, 0x51, 0x49, 0x45, 0x43},   // Z
+    {0x00, 0x7F, 0x41, 0x41, 0x00},   // [
+    {0x02, 0x04, 0x08, 0x10, 0x20},   // backslash
+    {0x00, 0x41, 0x41, 0x7F, 0x00},   // ]
+    {0x04, 0x02, 0x01, 0x02, 0x04},   // ^
+    {0x40, 0x40, 0x40, 0x40, 0x40},   // _
+    {0x00, 0x01, 0x02, 0x04, 0x00},   // `
+    {0x20, 0x54, 0x54, 0x54, 0x78},   // a
+    {0x7F, 0x48, 0x44, 0x44, 0x38},   // b
+    {0x38, 0x44, 0x44, 0x44, 0x20},   // c
+    {0x38, 0x44, 0x44, 0x48, 0x7F},   // d
+    {0x38, 0x54, 0x54, 0x54, 0x18},   // e
+    {0x08, 0x7E, 0x09, 0x01, 0x02},   // f
+    {0x08, 0x14, 0x54, 0x54, 0x3C},   // g
+    {0x7F, 0x08, 0x04, 0x04, 0x78},   // h
+    {0x00, 0x44, 0x7D, 0x40, 0x00},   // i
+    {0x20, 0x40, 0x44, 0x3D, 0x00},   // j
+    {0x00, 0x7F, 0x10, 0x28, 0x44},   // k
+    {0x00, 0x41, 0x7F, 0x40, 0x00},   // l
+    {0x7C, 0x04, 0x18, 0x04, 0x78},   // m
+    {0x7C, 0x08, 0x04, 0x04, 0x78},   // n
+    {0x38, 0x44, 0x44, 0x44, 0x38},   // o
+    {0x7C, 0x14, 0x14, 0x14, 0x08},   // p
+    {0x08, 0x14, 0x14, 0x18, 0x7C},   // q
+    {0x7C, 0x08, 0x04, 0x04, 0x08},   // r
+    {0x48, 0x54, 0x54, 0x54, 0x20},   // s
+    {0x04, 0x3F, 0x44, 0x40, 0x20},   // t
+    {0x3C, 0x40, 0x40, 0x20, 0x7C},   // u
+    {0x1C, 0x20, 0x40, 0x20, 0x1C},   // v
+    {0x3C, 0x40, 0x30, 0x40, 0x3C},   // w
+    {0x44, 0x28, 0x10, 0x28, 0x44},   // x
+    {0x0C, 0x50, 0x50, 0x50, 0x3C},   // y
+    {0x44, 0x64, 0x54, 0x4C, 0x44},   // z
+    {0x00, 0x08, 0x36, 0x41, 0x00},   // {
+    {0x00, 0x00, 0x7F, 0x00, 0x00},   // |
+    {0x00, 0x41, 0x36, 0x08, 0x00},   // }
+    {0x08, 0x04, 0x08, 0x10, 0x08},   // ~
+};
+
+static constexpr uint32_t ASCII_FIRST = 0x20;
+static constexpr size_t ASCII_COUNT = sizeof(FONT_5X7) / sizeof(FONT_5X7[0]);
+static_assert(ASCII_COUNT == 0x7F - ASCII_FIRST, "FONT_5X7 phải đủ ASCII 0x20..0x7E");
+
+// ============================================
+// Chữ tiếng Việt = chữ gốc + dấu mũ/trăng/móc + dấu thanh
+// ============================================
+enum Modifier : uint8_t { MOD_NONE, MOD_BREVE, MOD_CIRCUMFLEX, MOD_HORN, MOD_STROKE };
+enum Tone : uint8_t { TONE_NONE, TONE_ACUTE, TONE_GRAVE, TONE_HOOK, TONE_TILDE, TONE_DOT };
+
+struct Recipe {
+    uint16_t codepoint;
+    char base;
+    Modifier modifier;
+    Tone tone;
+};
+
+// Sắp theo codepoint để tra cứu nhị phân
+static constexpr Recipe RECIPES[] = {
+    {0x00C0, 'A', MOD_NONE, TONE_GRAVE},         // À
+    {0x00C1, 'A', MOD_NONE, TONE_ACUTE},         // Á
+    {0x00C2, 'A', MOD_CIRCUMFLEX, TONE_NONE},    // Â
+    {0x00C3, 'A', MOD_NONE, TONE_TILDE},         // Ã
+    {0x00C8, 'E', MOD_NONE, TONE_GRAVE},         // È
+    {0x00C9, 'E', MOD_NONE, TONE_ACUTE},         // É
+    {0x00CA, 'E', MOD_CIRCUMFLEX, TONE_NONE},    // Ê
+    {0x00CC, 'I', MOD_NONE, TONE_GRAVE},         // Ì
+    {0x00CD, 'I', MOD_NONE, TONE_ACUTE},         // Í
+    {0x00D2, 'O', MOD_NONE, TONE_GRAVE},         // Ò
+    {0x00D3, 'O', MOD_NONE, TONE_ACUTE},         // Ó
+    {0x00D4, 'O', MOD_CIRCUMFLEX, TONE_NONE},    // Ô
+    {0x00D5, 'O', MOD_NONE, TONE_TILDE},         // Õ
+    {0x00D9, 'U', MOD_NONE, TONE_GRAVE},         // Ù
+    {0x00DA, 'U', MOD_NONE, TONE_ACUTE},         // Ú
+    {0x00DD, 'Y', MOD_NONE, TONE_ACUTE},         // Ý
+    {0x00E0, 'a', MOD_NONE, TONE_GRAVE},         // à
+    {0x00E1, 'a', MOD_NONE, TONE_ACUTE},         // á
+    {0x00E2, 'a', MOD_CIRCUMFLEX, TONE_NONE},    // â
+    {0x00E3, 'a', MOD_NONE, TONE_TILDE},         // ã
+    {0x00E8, 'e', MOD_NONE, TONE_GRAVE},         // è
+    {0x00E9, 'e', MOD_NONE, TONE_ACUTE},         // é
+    {0x00EA, 'e', MOD_CIRCUMFLEX, TONE_NONE},    // ê
+    {0x00EC, 'i', MOD_NONE, TONE_GRAVE},         // ì
+    {0x00ED, 'i', MOD_NONE, TONE_ACUTE},         // í
+    {0x00F2, 'o', MOD_NONE, TONE_GRAVE},         // ò
+    {0x00F3, 'o', MOD_NONE, TONE_ACUTE},         // ó
+    {0x00F4, 'o', MOD_CIRCUMFLEX, TONE_NONE},    // ô
+    {0x00F5, 'o', MOD_NONE, TONE_TILDE},         // õ
+    {0x00F9, 'u', MOD_NONE, TONE_GRAVE},         // ù
+    {0x00FA, 'u', MOD_NONE, TONE_ACUTE},         // ú
+    {0x00FD, 'y', MOD_NONE, TONE_ACUTE},         // ý
+    {0x0102, 'A', MOD_BREVE, TONE_NONE},         // Ă
+    {0x0103, 'a', MOD_BREVE, TONE_NONE},         // ă
+    {0x0110, 'D', MOD_STROKE, TONE_NONE},        // Đ
+    {0x0111, 'd', MOD_STROKE, TONE_NONE},        // đ
+    {0x0128, 'I', MOD_NONE, TONE_TILDE},         // Ĩ
+    {0x0129, 'i', MOD_NONE, TONE_TILDE},         // ĩ
+    {0x0168, 'U', MOD_NONE, TONE_TILDE},         // Ũ
+    {0x0169, 'u', MOD_NONE, TONE_TILDE},         // ũ
+    {0x01A0, 'O', MOD_HORN, TONE_NONE},          // Ơ
+    {0x01A1, 'o', MOD_HORN, TONE_NONE},          // ơ
+    {0x01AF, 'U', MOD_HORN, TONE_NONE},          // Ư
+    {0x01B0, 'u', MOD_HORN, TONE_NONE},          // ư
+    {0x1EA0, 'A', MOD_NONE, TONE_DOT},           // Ạ
+    {0x1EA1, 'a', MOD_NONE, TONE_DOT},           // ạ
+    {0x1EA2, 'A', MOD_NONE, TONE_HOOK},          // Ả
+    {0x1EA3, 'a', MOD_NONE, TONE_HOOK},          // ả
+    {0x1EA4, 'A', MOD_CIRCUMFLEX, TONE_ACUTE},   // Ấ
+    {0x1EA5, 'a', MOD_CIRCUMFLEX, TONE_ACUTE},   // ấ
+    {0x1EA6, 'A', MOD_CIRCUMFLEX, TONE_GRAVE},   // Ầ
+    {0x1EA7, 'a', MOD_CIRCUMFLEX, TONE_GRAVE},   // ầ
+    {0x1EA8, 'A', MOD_CIRCUMFLEX, TONE_HOOK},    // Ẩ
+    {0x1EA9, 'a', MOD_CIRCUMFLEX, TONE_HOOK},    // ẩ
+    {0x1EAA, 'A', MOD_CIRCUMFLEX, TONE_TILDE},   // Ẫ
+    {0x1EAB, 'a', MOD_CIRCUMFLEX, TONE_TILDE},   // ẫ
+    {0x1EAC, 'A', MOD_CIRCUMFLEX, TONE_DOT},     // Ậ
+    {0x1EAD, 'a', MOD_CIRCUMFLEX, TONE_DOT},     // ậ
+    {0x1EAE, 'A', MOD_BREVE, TONE_ACUTE},        // Ắ
+    {0x1EAF, 'a', MOD_BREVE, TONE_ACUTE},        // ắ
+    {0x1EB0, 'A', MOD_BREVE, TONE_GRAVE},        // Ằ
+    {0x1EB1, 'a', MOD_BREVE, TONE_GRAVE},        // ằ
+    {0x1EB2, 'A', MOD_BREVE, TONE_HOOK},         // Ẳ
+    {0x1EB3, 'a', MOD_BREVE, TONE_HOOK},         // ẳ
+    {0x1EB4, 'A', MOD_BREVE, TONE_TILDE},        // Ẵ
+    {0x1EB5, 'a', MOD_BREVE, TONE_TILDE},        // ẵ
+    {0x1EB6, 'A', MOD_BREVE, TONE_DOT},          // Ặ
+    {0x1EB7, 'a', MOD_BREVE, TONE_DOT},          // ặ
+    {0x1EB8, 'E', MOD_NONE, TONE_DOT},           // Ẹ
+    {0x1EB9, 'e', MOD_NONE, TONE_DOT},           // ẹ
+    {0x1EBA, 'E', MOD_NONE, TONE_HOOK},          // Ẻ
+    {0x1EBB, 'e', MOD_NONE, TONE_HOOK},          // ẻ
+    {0x1EBC, 'E', MOD_NONE, TONE_TILDE},         // Ẽ
+    {0x1EBD, 'e', MOD_NONE, TONE_TILDE},         // ẽ
+    {0x1EBE, 'E', MOD_CIRCUMFLEX, TONE_ACUTE},   // Ế
+    {0x1EBF, 'e', MOD_CIRCUMFLEX, TONE_ACUTE},   // ế
+    {0x1EC0, 'E', MOD_CIRCUMFLEX, TONE_GRAVE},   // Ề
+    {0x1EC1, 'e', MOD_CIRCUMFLEX, TONE_GRAVE},   // ề
+    {0x1EC2, 'E', MOD_CIRCUMFLEX, TONE_HOOK},    // Ể
+    {0x1EC3, 'e', MOD_CIRCUMFLEX, TONE_HOOK},    // ể
+    {0x1EC4, 'E', MOD_CIRCUMFLEX, TONE_TILDE},   // Ễ
+    {0x1EC5, 'e', MOD_CIRCUMFLEX, TONE_TILDE},   // ễ
+    {0x1EC6, 'E', MOD_CIRCUMFLEX, TONE_DOT},     // Ệ
+    {0x1EC7, 'e', MOD_CIRCUMFLEX, TONE_DOT},     // ệ
+    {0x1EC8, 'I', MOD_NONE, TONE_HOOK},          // Ỉ
+    {0x1EC9, 'i', MOD_NONE, TONE_HOOK},          // ỉ
+    {0x1ECA, 'I', MOD_NONE, TONE_DOT},           // Ị
+    {0x1ECB, 'i', MOD_NONE, TONE_DOT},           // ị
+    {0x1ECC, 'O', MOD_NONE, TONE_DOT},           // Ọ
+    {0x1ECD, 'o', MOD_NONE, TONE_DOT},           // ọ
+    {0x1ECE, 'O', MOD_NONE, TONE_HOOK},          // Ỏ
+    {0x1ECF, 'o', MOD_NONE, TONE_HOOK},          // ỏ
+    {0x1ED0, 'O', MOD_CIRCUMFLEX, TONE_ACUTE},   // Ố
+    {0x1ED1, 'o', MOD_CIRCUMFLEX, TONE_ACUTE},   // ố
+    {0x1ED2, 'O', MOD_CIRCUMFLEX, TONE_GRAVE},   // Ồ
+    {0x1ED3, 'o', MOD_CIRCUMFLEX, TONE_GRAVE},   // ồ
+    {0x1ED4, 'O', MOD_CIRCUMFLEX, TONE_HOOK},    // Ổ
+    {0x1ED5, 'o', MOD_CIRCUMFLEX, TONE_HOOK},    // ổ
+    {0x1ED6, 'O', MOD_CIRCUMFLEX, TONE_TILDE},   // Ỗ
+    {0x1ED7, 'o', MOD_CIRCUMFLEX, TONE_TILDE},   // ỗ
+    {0x1ED8, 'O', MOD_CIRCUMFLEX, TONE_DOT},     // Ộ
+    {0x1ED9, 'o', MOD_CIRCUMFLEX, TONE_DOT},     // ộ
+    {0x1EDA, 'O', MOD_HORN, TONE_ACUTE},         // Ớ
+    {0x1EDB, 'o', MOD_HORN, TONE_ACUTE},         // ớ
+    {0x1EDC, 'O', MOD_HORN, TONE_GRAVE},         // Ờ
+    {0x1EDD, 'o', MOD_HORN, TONE_GRAVE},         // ờ
+    {0x1EDE, 'O', MOD_HORN, TONE_HOOK},          // Ở
+    {0x1EDF, 'o', MOD_HORN, TONE_HOOK},          // ở
+    {0x1EE0, 'O', MOD_HORN, TONE_TILDE},         // Ỡ
+    {0x1EE1, 'o', MOD_HORN, TONE_TILDE},         // ỡ
+    {0x1EE2, 'O', MOD_HORN, TONE_DOT},           // Ợ
+    {0x1EE3, 'o', MOD_HORN, TONE_DOT},           // ợ
+    {0x1EE4, 'U', MOD_NONE, TONE_DOT},           // Ụ
+    {0x1EE5, 'u', MOD_NONE, TONE_DOT},           // ụ
+    {0x1EE6, 'U', MOD_NONE, TONE_HOOK},          // Ủ
+    {0x1EE7, 'u', MOD_NONE, TONE_HOOK},          // ủ
+    {0x1EE8, 'U', MOD_HORN, TONE_ACUTE},         // Ứ
+    {0x1EE9, 'u', MOD_HORN, TONE_ACUTE},         // ứ
+    {0x1EEA, 'U', MOD_HORN, TONE_GRAVE},         // Ừ
+    {0x1EEB, 'u', MOD_HORN, TONE_GRAVE},         // ừ
+    {0x1EEC, 'U', MOD_HORN, TONE_HOOK},          // Ử
+    {0x1EED, 'u', MOD_HORN, TONE_HOOK},          // ử
+    {0x1EEE, 'U', MOD_HORN, TONE_TILDE},         // Ữ
+    {0x1EEF, 'u', MOD_HORN, TONE_TILDE},         // ữ
+    {0x1EF0, 'U', MOD_HORN, TONE_DOT},           // Ự
+    {0x1EF1, 'u', MOD_HORN, TONE_DOT},           // ự
+    {0x1EF2, 'Y', MOD_NONE, TONE_GRAVE},         // Ỳ
+    {0x1EF3, 'y', MOD_NONE, TONE_GRAVE},         // ỳ
+    {0x1EF4, 'Y', MOD_NONE, TONE_DOT},           // Ỵ
+    {0x1EF5, 'y', MOD_NONE, TONE_DOT},           // ỵ
+    {0x1EF6, 'Y', MOD_NONE, TONE_HOOK},          // Ỷ
+    {0x1EF7, 'y', MOD_NONE, TONE_HOOK},          // ỷ
+    {0x1EF8, 'Y', MOD_NONE, TONE_TILDE},         // Ỹ
+    {0x1EF9, 'y', MOD_NONE, TONE_TILDE},         // ỹ
+};
+
+static constexpr size_t RECIPE_COUNT = sizeof(RECIPES) / sizeof(RECIPES[0]);
+static constexpr size_t GLYPH_COUNT = ASCII_COUNT + RECIPE_COUNT;
+
+static constexpr bool recipesSorted() {
+    for (size_t i = 1; i < RECIPE_COUNT; i++) {
+        if (RECIPES[i - 1].codepoint >= RECIPES[i].codepoint) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(recipesSorted(), "RECIPES phải sắp tăng dần theo codepoint");
+
+// Dấu phía trên: 5 cột, bit 0 = hàng trên của dấu
+struct Mark {
+    uint8_t columns[5];
+    uint8_t height;
+};
+
+static constexpr Mark TONE_MARKS[] = {
+    {{0x00, 0x00, 0x00, 0x00, 0x00}, 0},   // không dấu
+    {{0x00, 0x00, 0x02, 0x01, 0x00}, 2},   // sắc
+    {{0x00, 0x01, 0x02, 0x00, 0x00}, 2},   // huyền
+    {{0x00, 0x01, 0x05, 0x02, 0x00}, 3},   // hỏi
+    {{0x02, 0x01, 0x01, 0x02, 0x01}, 2},   // ngã
+    {{0x00, 0x00, 0x00, 0x00, 0x00}, 0},   // nặng: chấm dưới, vẽ riêng
+};
+static constexpr Mark BREVE_MARK = {{0x01, 0x02, 0x02, 0x02, 0x01}, 2};
+static constexpr Mark CIRCUMFLEX_MARK = {{0x00, 0x02, 0x01, 0x02, 0x00}, 2};
+
+#define BASE_ROW 6          // Hàng trên cùng của font 5x7 trong ô 16 hàng
+#define X_HEIGHT_ROW 8      // Đỉnh chữ thường (a, e, o...) trong ô
+#define DOT_BELOW_ROW 14
+
+// Ô đang ghép: mỗi cột 16 bit, bit r = hàng r
+struct Cell {
+    uint16_t columns[GLYPH_WIDTH];
+};
+
+static constexpr void drawMark(Cell& cell, const Mark& mark, int bottomRow) {
+    int top = bottomRow - (mark.height - 1);
+    for (int c = 0; c < 5; c++) {
+        cell.columns[c] |= (uint16_t)(mark.columns[c] << top);
+    }
+}
+
+static constexpr Cell composeGlyph(const Recipe& recipe) {
+    Cell cell = {};
+    bool lower = recipe.base >= 'a';
+    int bodyTop = lower ? X_HEIGHT_ROW : BASE_ROW;
+    
+    // i có dấu thanh phía trên thì bỏ chấm
+    bool dotless = recipe.base == 'i' && recipe.tone != TONE_NONE && recipe.tone != TONE_DOT;
+    const uint8_t* base = FONT_5X7[recipe.base - ASCII_FIRST];
+    for (int c = 0; c < 5; c++) {
+        uint8_t bits = dotless ? (uint8_t)(base[c] & ~0x01) : base[c];
+        cell.columns[c] = (uint16_t)(bits << BASE_ROW);
+    }
+    
+    // Dấu mũ/trăng sát trên thân chữ, dấu thanh chồng lên trên nữa
+    int toneBottom = bodyTop - 2;
+    switch (recipe.modifier) {
+        case MOD_BREVE:
+            drawMark(cell, BREVE_MARK, bodyTop - 2);
+            toneBottom = bodyTop - 4;
+            break;
+        case MOD_CIRCUMFLEX:
+            drawMark(cell, CIRCUMFLEX_MARK, bodyTop - 2);
+            toneBottom = bodyTop - 4;
+            break;
+        case MOD_HORN:
+            cell.columns[4] |= (uint16_t)(1 << (bodyTop - 1));
+            cell.columns[5] |= (uint16_t)(1 << (bodyTop - 2));
+            break;
+        case MOD_STROKE:
+            // đ: gạch ngang qua chân d; Đ: gạch ngang giữa thân D
+            for (int c = lower ? 2 : 0; c <= (lower ? 4 : 2); c++) {
+                cell.columns[c] |= (uint16_t)(1 << (lower ? BASE_ROW + 1 : BASE_ROW + 3));
+            }
+            break;
+        default:
+            break;
+    }
+    
+    if (recipe.tone == TONE_DOT) {
+        cell.columns[2] |= (uint16_t)(1 << DOT_BELOW_ROW);
+    } else if (recipe.tone != TONE_NONE) {
+        drawMark(cell, TONE_MARKS[recipe.tone], toneBottom);
+    }
+    return cell;
+}
+
+struct Atlas {
+    uint8_t glyphs[GLYPH_COUNT][GLYPH_BYTES];
+};
+
+static constexpr void storeCell(uint8_t* output, const Cell& cell) {
+    for (int c = 0; c < GLYPH_WIDTH; c++) {
+        output[c] = (uint8_t)(cell.columns[c] & 0xFF);
+        output[GLYPH_WIDTH + c] = (uint8_t)(cell.columns[c] >> 8);
+    }
+}
+
+static constexpr Atlas buildAtlas() {
+    Atlas atlas = {};
+    for (size_t i = 0; i < ASCII_COUNT; i++) {
+        Cell cell = {};
+        for (int c = 0; c < 5; c++) {
+            cell.columns[c] = (uint16_t)(FONT_5X7[i][c] << BASE_ROW);
+        }
+        storeCell(atlas.glyphs[i], cell);
+    }
+    for (size_t i = 0; i < RECIPE_COUNT; i++) {
+        storeCell(atlas.glyphs[ASCII_COUNT + i], composeGlyph(RECIPES[i]));
+    }
+    return atlas;
+}
+
+// Tính xong lúc biên dịch; const nên nằm trong .rodata (flash trên ESP32)
+static constexpr Atlas ATLAS = buildAtlas();
+
+// ============================================
+// Tra cứu
+// ============================================
+
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+static int findRecipe(uint32_t codepoint) {
+    int low = 0;
+    int high = (int)RECIPE_COUNT - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (RECIPES[middle].codepoint == codepoint) {
+            return middle;
+        }
+        if (RECIPES[middle].codepoint < codepoint) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+namespace GlyphAtlas {
+
+uint32_t nextCodepoint(const char*& text) {
+    const uint8_t* bytes = (const uint8_t*)text;
+    uint8_t lead = bytes[0];
+    if (lead < 0x80) {
+        text++;
+        return lead;
+    }
+    
+    int extra;
+    uint32_t codepoint;
+    if ((lead & 0xE0) == 0xC0) {
+        extra = 1;
+        codepoint = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+        extra = 2;
+        codepoint = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+        extra = 3;
+        codepoint = lead & 0x07;
+    } else {
+        text++;
+        return REPLACEMENT_CHARACTER;
+    }
+    
+    for (int i = 1; i <= extra; i++) {
+        // Thiếu byte tiếp nối (kể cả gặp '\0'): dừng trước byte đó
+        if ((bytes[i] & 0xC0) != 0x80) {
+            text += i;
+            return REPLACEMENT_CHARACTER;
+        }
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+    text += extra + 1;
+    return codepoint;
+}
+
+const uint8_t* glyph(uint32_t codepoint) {
+    if (codepoint >= ASCII_FIRST && codepoint < ASCII_FIRST + ASCII_COUNT) {
+        return ATLAS.glyphs[codepoint - ASCII_FIRST];
+    }
+    int index = findRecipe(codepoint);
+    if (index >= 0) {
+        return ATLAS.glyphs[ASCII_COUNT + index];
+    }
+    return ATLAS.glyphs['?' - ASCII_FIRST];
+}
+
+char baseLetter(uint32_t codepoint) {
+    if (codepoint >= ASCII_FIRST && codepoint < ASCII_FIRST + ASCII_COUNT) {
+        return (char)codepoint;
+    }
+    int index = findRecipe(codepoint);
+    return index >= 0 ? RECIPES[index].base : 0;
+}
+
+size_t glyphCount() {
+    return GLYPH_COUNT;
+}
+
+} // namespace GlyphAtlas
@@ -0,0 +1,52 @@
+#include "heap_monitor.h"
+
+HeapMonitor heapMonitor;
+
+HeapMonitor::HeapMonitor() : taskCount(0), baselineFreeHeap(0) {}
+
+void HeapMonitor::markBaseline() {
+    baselineFreeHeap = ESP.getFreeHeap();
+    DEBUG_PRINTF("[HEAP] Baseline free heap: %u\n", (unsigned)baselineFreeHeap);
+}
+
+bool HeapMonitor::registerTask(TaskHandle_t handle, const char* name) {
+    if (handle == nullptr || taskCount >= HEAP_MONITOR_MAX_TASKS) {
+        return false;
+    }
+    tasks[taskCount].handle = handle;
+    tasks[taskCount].name = name;
+    taskCount++;
+    return true;
+}
+
+HeapSnapshot HeapMonitor::snapshot() const {
+    HeapSnapshot snap;
+    snap.freeHeap = ESP.getFreeHeap();
+    snap.minFreeHeap = ESP.getMinFreeHeap();
+    snap.largestFreeBlock = ESP.getMaxAllocHeap();
+    snap.freePsram = ESP.getFreePsram();
+    snap.fragmentationPct = snap.freeHeap > 0
+        ? (uint8_t)(100 - (uint64_t)snap.largestFreeBlock * 100 / snap.freeHeap)
+        : 0;
+    snap.drift = baselineFreeHeap > 0 ? (int32_t)(baselineFreeHeap - snap.freeHeap) : 0;
+    return snap;
+}
+
+uint32_t HeapMonitor::getStackHighWater(uint8_t index) const {
+    if (index >= taskCount) {
+        return 0;
+    }
+    // ESP-IDF trả về đơn vị byte
+    return uxTaskGetStackHighWaterMark(tasks[index].handle);
+}
+
+void HeapMonitor::printReport() const {
+    HeapSnapshot snap = snapshot();
+    DEBUG_PRINTF("[HEAP] free=%u min=%u largest=%u frag=%u%% drift=%d psram=%u\n",
+                 (unsigned)snap.freeHeap, (unsigned)snap.minFreeHeap,
+                 (unsigned)snap.largestFreeBlock, snap.fragmentationPct,
+                 (int)snap.drift, (unsigned)snap.freePsram);
+    for (uint8_t i = 0; i < taskCount; i++) {
+        DEBUG_PRINTF("[HEAP] stack %-6s free=%u\n", tasks[i].name, (unsigned)getStackHighWater(i));
+    }
+}
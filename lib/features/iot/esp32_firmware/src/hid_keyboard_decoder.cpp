@@ -0,0 +1,129 @@
+#include "hid_keyboard_decoder.h"
+#include <string.h>
+
+// Usage ID của các phím điều khiển (HID Usage Tables, trang 0x07)
+#define HID_USAGE_ERROR_ROLLOVER 0x01
+#define HID_USAGE_ENTER 0x28
+#define HID_USAGE_ESCAPE 0x29
+#define HID_USAGE_BACKSPACE 0x2A
+#define HID_USAGE_TAB 0x2B
+#define HID_USAGE_KEYPAD_ENTER 0x58
+#define HID_MODIFIER_SHIFT 0x22        // Left Shift | Right Shift
+
+// Bố cục US từ 0x04 ('a') tới 0x38 ('/'); 0 = phím điều khiển hoặc không có ký tự
+static const char USAGE_CHARS[] =
+    "abcdefghijklmnopqrstuvwxyz1234567890"
+    "\0\0\0\0 -=[]\\#;'`,./";
+static const char USAGE_CHARS_SHIFT[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ!@#$%^&*()"
+    "\0\0\0\0 _+{}|~:\"~<>?";
+// Bàn phím số từ 0x54 ('/') tới 0x63 ('.'), Enter của bàn phím số xử lý riêng
+static const char KEYPAD_CHARS[] = "/*-+\0" "1234567890.";
+
+HidKeyboardDecoder::HidKeyboardDecoder(BarcodeSink sink, void* context)
+    : sink(sink), context(context), length(0), overflowed(false), lastKeyAt(0) {
+    memset(previous, 0, sizeof(previous));
+    memset(buffer, 0, sizeof(buffer));
+    memset(&stats, 0, sizeof(stats));
+}
+
+char HidKeyboardDecoder::usageToChar(uint8_t usage, bool shift) {
+    if (usage >= 0x04 && usage <= 0x38) {
+        return (shift ? USAGE_CHARS_SHIFT : USAGE_CHARS)[usage - 0x04];
+    }
+    if (usage >= 0x54 && usage <= 0x63) {
+        return KEYPAD_CHARS[usage - 0x54];
+    }
+    return 0;
+}
+
+void HidKeyboardDecoder::feed(const uint8_t* report, size_t reportLength, uint32_t nowMs) {
+    if (reportLength < 8) {
+        return;
+    }
+    stats.reports++;
+    
+    // Quá nhiều phím cùng lúc: mọi ô phím = ErrorRollOver, giữ nguyên trạng thái phím cũ
+    if (report[2] == HID_USAGE_ERROR_ROLLOVER) {
+        stats.rolloverErrors++;
+        return;
+    }
+    
+    tick(nowMs);
+    
+    bool shift = (report[0] & HID_MODIFIER_SHIFT) != 0;
+    for (uint8_t i = 2; i < 8; i++) {
+        uint8_t usage = report[i];
+        if (usage == 0 || memchr(previous, usage, sizeof(previous)) != nullptr) {
+            continue;
+        }
+        press(usage, shift, nowMs);
+    }
+    memcpy(previous, report + 2, sizeof(previous));
+}
+
+void HidKeyboardDecoder::press(uint8_t usage, bool shift, uint32_t nowMs) {
+    stats.keystrokes++;
+    lastKeyAt = nowMs;
+    
+    switch (usage) {
+        case HID_USAGE_ENTER:
+        case HID_USAGE_KEYPAD_ENTER:
+        case HID_USAGE_TAB:
+            finish(true);
+            return;
+        case HID_USAGE_ESCAPE:
+            length = 0;
+            overflowed = false;
+            return;
+        case HID_USAGE_BACKSPACE:
+            if (length > 0 && !overflowed) {
+                length--;
+            }
+            return;
+        default:
+            break;
+    }
+    
+    char c = usageToChar(usage, shift);
+    if (c == 0) {
+        stats.unmapped++;
+        return;
+    }
+    if (length >= sizeof(buffer) - 1) {
+        overflowed = true;
+        return;
+    }
+    buffer[length++] = c;
+}
+
+void HidKeyboardDecoder::tick(uint32_t nowMs) {
+    if ((length > 0 || overflowed) && nowMs - lastKeyAt >= USB_SCANNER_CHAR_TIMEOUT_MS) {
+        finish(false);
+    }
+}
+
+void HidKeyboardDecoder::finish(bool terminated) {
+    if (overflowed) {
+        stats.overflows++;
+    } else if (length < USB_SCANNER_MIN_LENGTH) {
+        if (length > 0) {
+            stats.discarded++;
+        }
+    } else {
+        buffer[length] = '\0';
+        stats.barcodes++;
+        if (!terminated) {
+            stats.timeoutBarcodes++;
+        }
+        sink(buffer, length, context);
+    }
+    length = 0;
+    overflowed = false;
+}
+
+void HidKeyboardDecoder::reset() {
+    memset(previous, 0, sizeof(previous));
+    length = 0;
+    overflowed = false;
+}
@@ -0,0 +1,209 @@
+#include "inventory_session.h"
+#include "clock_sync.h"
+
+InventorySession inventorySession;
+
+// Mảng lớn (~76 KB) nên ưu tiên PSRAM
+static void* allocLarge(size_t size) {
+    void* memory = psramFound() ? ps_malloc(size) : nullptr;
+    return memory != nullptr ? memory : malloc(size);
+}
+
+InventorySession::InventorySession()
+    : set(nullptr), queue(nullptr), queueHead(0), queueTail(0), lastUploadAt(0), active(false),
+      sessionId(0), sequence(0), startedAt(0), stoppedAt(0), windowStart(0), windowReads(0), lastRate(0),
+      collisionBase(0), collisions(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool InventorySession::begin() {
+    if (set != nullptr) {
+        return true;
+    }
+    
+    uint32_t* bloom = static_cast<uint32_t*>(allocLarge(INVENTORY_BLOOM_BITS / 8));
+    UidKey* keys = static_cast<UidKey*>(allocLarge(INVENTORY_MAX_TAGS * sizeof(UidKey)));
+    queue = static_cast<UidKey*>(allocLarge(INVENTORY_UPLOAD_QUEUE * sizeof(UidKey)));
+    if (bloom == nullptr || keys == nullptr || queue == nullptr) {
+        DEBUG_PRINTLN("[INVENTORY] Allocation failed!");
+        free(bloom);
+        free(keys);
+        free(queue);
+        queue = nullptr;
+        return false;
+    }
+    set = new UidSet(bloom, keys, INVENTORY_MAX_TAGS);
+    
+    DEBUG_PRINTF("[INVENTORY] UID set: %u tags, %u bytes\n", INVENTORY_MAX_TAGS, (unsigned)set->bytesUsed());
+    return true;
+}
+
+void InventorySession::start(RFIDReaderPool& readers) {
+    if (set == nullptr || active) {
+        return;
+    }
+    
+    set->clear();
+    memset(&stats, 0, sizeof(stats));
+    queueTail = queueHead;
+    sequence = 0;
+    // Giờ thực làm mã phiên (server gom các lô cùng phiên); chưa có giờ thì ngẫu nhiên
+    sessionId = clockSync.isSynced() ? (uint32_t)(clockSync.nowEpochMs() / 1000) : esp_random();
+    
+    collisionBase = 0;
+    collisions = 0;
+    for (uint8_t i = 0; i < readers.getReaderCount(); i++) {
+        if (readers.isActive(i)) {
+            readers.reader(i).setInventoryMode(true);
+            collisionBase += readers.reader(i).getCollisionCount();
+        }
+    }
+    
+    startedAt = millis();
+    windowStart = startedAt;
+    windowReads = 0;
+    lastRate = 0;
+    lastUploadAt = startedAt;
+    active = true;
+    DEBUG_PRINTF("[INVENTORY] Session %u started\n", sessionId);
+}
+
+void InventorySession::stop(RFIDReaderPool& readers) {
+    if (!active) {
+        return;
+    }
+    active = false;
+    stoppedAt = millis();
+    for (uint8_t i = 0; i < readers.getReaderCount(); i++) {
+        if (readers.isActive(i)) {
+            readers.reader(i).setInventoryMode(false);
+        }
+    }
+    DEBUG_PRINTF("[INVENTORY] Session %u stopped, %u pending upload\n", sessionId, getPendingCount());
+}
+
+uint16_t InventorySession::poll(RFIDReaderPool& readers) {
+    if (!active) {
+        return 0;
+    }
+    
+    uint16_t added = 0;
+    uint32_t start = micros();
+    do {
+        for (uint8_t i = 0; i < readers.getReaderCount(); i++) {
+            uint8_t uid[10];
+            uint8_t length;
+            if (readers.isActive(i) && readers.reader(i).readInventoryTag(uid, length) && record(uid, length)) {
+                added++;
+            }
+        }
+    } while (micros() - start < INVENTORY_POLL_BUDGET_US);
+    
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < readers.getReaderCount(); i++) {
+        if (readers.isActive(i)) {
+            total += readers.reader(i).getCollisionCount();
+        }
+    }
+    collisions = total - collisionBase;
+    
+    uint32_t now = millis();
+    if (now - windowStart >= 1000) {
+        lastRate = windowReads * 1000.0f / (now - windowStart);
+        windowStart = now;
+        windowReads = 0;
+    }
+    return added;
+}
+
+bool InventorySession::record(const uint8_t* uid, uint8_t length) {
+    stats.reads++;
+    windowReads++;
+    
+    UidKey key = UidSet::makeKey(uid, length);
+    if (key == 0) {
+        stats.unsupported++;
+        return false;
+    }
+    
+    // Hàng đợi gửi đầy (mất mạng lâu): chỉ lọc trùng, nhãn mới không vào tập
+    // nên sẽ được đọc lại ở lượt quét sau thay vì bị mất
+    if (queueHead - queueTail >= INVENTORY_UPLOAD_QUEUE) {
+        if (set->contains(key)) {
+            stats.duplicates++;
+        } else {
+            stats.deferred++;
+        }
+        return false;
+    }
+    
+    switch (set->insert(key)) {
+        case UID_DUPLICATE:
+            stats.duplicates++;
+            return false;
+        case UID_SET_FULL:
+            stats.deferred++;
+            return false;
+        default:
+            break;
+    }
+    queue[queueHead % INVENTORY_UPLOAD_QUEUE] = key;
+    queueHead = queueHead + 1;
+    stats.unique++;
+    return true;
+}
+
+bool InventorySession::shouldUpload(uint32_t now) const {
+    uint32_t pending = getPendingCount();
+    return pending >= INVENTORY_BATCH_MAX || (pending > 0 && now - lastUploadAt >= INVENTORY_UPLOAD_INTERVAL);
+}
+
+uint16_t InventorySession::peekPending(UidKey* keys, uint16_t max) const {
+    uint32_t tail = queueTail;
+    uint32_t pending = queueHead - tail;
+    uint16_t count = pending < max ? pending : max;
+    for (uint16_t i = 0; i < count; i++) {
+        keys[i] = queue[(tail + i) % INVENTORY_UPLOAD_QUEUE];
+    }
+    return count;
+}
+
+void InventorySession::acknowledge(uint16_t count, size_t encodedBytes) {
+    for (uint16_t i = 0; i < count; i++) {
+        // "04A1B2C3", = độ dài hex + 2 dấu nháy + dấu phẩy
+        stats.hexBytes += (queue[(queueTail + i) % INVENTORY_UPLOAD_QUEUE] >> 56) * 2 + 3;
+    }
+    queueTail = queueTail + count;
+    stats.uploaded += count;
+    stats.batches++;
+    stats.encodedBytes += encodedBytes;
+    sequence++;
+    lastUploadAt = millis();
+}
+
+void InventorySession::countUploadFailure() {
+    stats.uploadFailures++;
+    lastUploadAt = millis();
+}
+
+float InventorySession::tagsPerSecond() const {
+    uint32_t elapsed = (active ? millis() : stoppedAt) - startedAt;
+    return elapsed > 0 ? stats.reads * 1000.0f / elapsed : 0;
+}
+
+float InventorySession::duplicateRatio() const {
+    return stats.reads > 0 ? (float)stats.duplicates / stats.reads : 0;
+}
+
+void InventorySession::printStats() const {
+    if (set == nullptr || (!active && stats.reads == 0)) {
+        return;
+    }
+    const UidSetStats& setStats = set->getStats();
+    DEBUG_PRINTF("[INVENTORY] session=%u %s reads=%u unique=%u dup=%.1f%% rate=%.1f/s (now %.1f/s) collisions=%u\n",
+                 sessionId, active ? "active" : "stopped", stats.reads, stats.unique, duplicateRatio() * 100,
+                 tagsPerSecond(), lastRate, collisions);
+    DEBUG_PRINTF("[INVENTORY] uploaded=%u pending=%u batches=%u failed=%u deferred=%u bytes=%u (hex %u) bloom=%u/%u fp\n",
+                 stats.uploaded, getPendingCount(), stats.batches, stats.uploadFailures, stats.deferred,
+                 stats.encodedBytes, stats.hexBytes, setStats.falsePositives, setStats.lookups);
+}
@@ -1,132 +1,164 @@
 #include "lcd_handler.h"
 #include <Wire.h>
+#include "glyph_atlas.h"
 
 LCDHandler::LCDHandler() {
+    #if !DISPLAY_OLED
     lcd = new LiquidCrystal_I2C(LCD_ADDRESS, LCD_COLS, LCD_ROWS);
+    #endif
 }
 
 bool LCDHandler::begin() {
     // Initialize I2C with custom pins for ESP32-S3
     Wire.begin(LCD_SDA_PIN, LCD_SCL_PIN);
     
+    #if DISPLAY_OLED
+    if (!oled.begin()) {
+        return false;
+    }
+    #else
     lcd->init();
     lcd->backlight();
     lcd->clear();
+    #endif
     
     // Test display
-    lcd->setCursor(0, 0);
-    lcd->print("Khoi dong...");
+    show("Khởi động...");
     delay(1000);
     
-    DEBUG_PRINTLN("LCD initialized");
+    DEBUG_PRINTLN(DISPLAY_OLED ? "OLED initialized" : "LCD initialized");
     return true;
 }
 
-void LCDHandler::displayText(const char* line1, const char* line2) {
+void LCDHandler::show(const char* line1, const char* line2) {
+    #if DISPLAY_OLED
+    // Dòng 1 xuống dòng theo từ (tên dài), dòng 2 nối ngay sau; frame chỉ gửi phần thay đổi
+    OledFramebuffer& frame = oled.frame();
+    frame.clear();
+    bool hasLine2 = line2[0] != '\0';
+    uint8_t rows = frame.drawWrapped(0, line1, hasLine2 ? OLED_TEXT_ROWS - 1 : OLED_TEXT_ROWS);
+    if (hasLine2) {
+        frame.drawWrapped(rows, line2, OLED_TEXT_ROWS - rows);
+    }
+    oled.flush();
+    #else
     lcd->clear();
     
+    char text[LCD_COLS + 1];
+    
     lcd->setCursor(0, 0);
-    lcd->print(truncateString(line1, LCD_COLS));
+    removeVietnameseTones(line1, text, sizeof(text));
+    lcd->print(text);
     
     if (strlen(line2) > 0) {
         lcd->setCursor(0, 1);
-        lcd->print(truncateString(line2, LCD_COLS));
+        removeVietnameseTones(line2, text, sizeof(text));
+        lcd->print(text);
     }
+    #endif
+}
+
+void LCDHandler::displayText(const char* line1, const char* line2) {
+    show(line1, line2);
 }
 
 void LCDHandler::displayStudent(const char* name, const char* mssv) {
-    lcd->clear();
-    
-    // Dòng 1: Tên sinh viên (bỏ dấu)
-    String nameStr = removeVietnameseTones(name);
-    lcd->setCursor(0, 0);
-    lcd->print(truncateString(nameStr.c_str(), LCD_COLS));
-    
-    // Dòng 2: MSSV
-    lcd->setCursor(0, 1);
-    lcd->print("MSSV:");
-    lcd->print(mssv);
+    // Dòng 1: Tên sinh viên, dòng 2: MSSV
+    char line2[32];
+    snprintf(line2, sizeof(line2), "MSSV:%s", mssv);
+    show(name, line2);
     
     DEBUG_PRINTLN("[LCD] Displaying student info");
 }
 
 void LCDHandler::displayBook(const char* title, const char* code) {
-    lcd->clear();
+    // Dòng 1: Tên sách, dòng 2: Mã sách
+    char line2[48];
+    snprintf(line2, sizeof(line2), "Mã:%s", code);
+    show(title, line2);
     
-    // Dòng 1: Tên sách (bỏ dấu)
-    String titleStr = removeVietnameseTones(title);
-    lcd->setCursor(0, 0);
-    lcd->print(truncateString(titleStr.c_str(), LCD_COLS));
+    DEBUG_PRINTLN("[LCD] Displaying book info");
+}
+
+void LCDHandler::displayLoanSummary(uint8_t loanCount, uint8_t overdueCount) {
+    char line1[24];
+    snprintf(line1, sizeof(line1), "Đang mượn: %u", loanCount);
     
-    // Dòng 2: Mã sách
-    lcd->setCursor(0, 1);
-    lcd->print("Ma:");
-    lcd->print(code);
+    char line2[24];
+    if (overdueCount > 0) {
+        snprintf(line2, sizeof(line2), "Quá hạn: %u", overdueCount);
+    } else {
+        strlcpy(line2, "Không quá hạn", sizeof(line2));
+    }
+    show(line1, line2);
+}
+
+void LCDHandler::displayLoanDue(const char* title, const char* dueDate, bool overdue) {
+    // Dòng 1: Tên sách, dòng 2: Hạn trả
+    char line2[32];
+    snprintf(line2, sizeof(line2), "%s%s", overdue ? "QH:" : "Hạn:", dueDate);
+    show(title, line2);
     
-    DEBUG_PRINTLN("[LCD] Displaying book info");
+    DEBUG_PRINTLN("[LCD] Displaying loan due date");
 }
 
 void LCDHandler::displayStatus(const char* status) {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print(truncateString(status, LCD_COLS));
+    show(status);
 }
 
 void LCDHandler::displayError(const char* error) {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("LOI!");
-    lcd->setCursor(0, 1);
-    lcd->print(truncateString(error, LCD_COLS));
+    show("LỖI!", error);
     
     DEBUG_PRINT("[LCD] Error: ");
     DEBUG_PRINTLN(error);
 }
 
 void LCDHandler::displayProcessing() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("Dang xu ly...");
+    show("Đang xử lý...");
 }
 
 void LCDHandler::displayReady() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("San sang!");
-    lcd->setCursor(0, 1);
-    lcd->print("Quet the/sach");
+    show("Sẵn sàng!", "Quét thẻ/sách");
 }
 
 void LCDHandler::clear() {
+    #if DISPLAY_OLED
+    oled.frame().clear();
+    oled.flush();
+    #else
     lcd->clear();
+    #endif
 }
 
 void LCDHandler::setBacklight(bool on) {
+    #if DISPLAY_OLED
+    oled.setPower(on);
+    #else
     if (on) {
         lcd->backlight();
     } else {
         lcd->noBacklight();
     }
+    #endif
 }
 
-String LCDHandler::truncateString(const char* str, int maxLen) {
-    String result = String(str);
-    if (result.length() > maxLen) {
-        result = result.substring(0, maxLen);
-    }
-    return result;
-}
-
-String LCDHandler::removeVietnameseTones(const char* str) {
-    // Đơn giản hóa: chỉ giữ ASCII
-    // Trong thực tế, cần map đầy đủ: á->a, đ->d, etc.
-    String result = "";
-    for (int i = 0; i < strlen(str); i++) {
-        char c = str[i];
-        // Chỉ giữ ký tự ASCII printable
-        if (c >= 32 && c <= 126) {
-            result += c;
+void LCDHandler::printStats() const {
+    #if DISPLAY_OLED
+    const OledStats& s = oled.getStats();
+    DEBUG_PRINTF("[OLED] frames=%u last=%uus/%uB max=%uus total=%uKB i2c errors=%u\n",
+                 s.frames, s.lastFrameUs, s.lastFrameBytes, s.maxFrameUs,
+                 (uint32_t)(s.totalBytes / 1024), s.errors);
+    #endif
+}
+
+void LCDHandler::removeVietnameseTones(const char* str, char* output, size_t outputSize) {
+    // Mỗi ký tự UTF-8 → chữ không dấu theo bảng glyph (ế → e, Đ → D), bỏ ký tự ngoài bảng
+    size_t pos = 0;
+    while (*str != '\0' && pos + 1 < outputSize) {
+        char c = GlyphAtlas::baseLetter(GlyphAtlas::nextCodepoint(str));
+        if (c != 0) {
+            output[pos++] = c;
         }
     }
-    return result;
+    output[pos] = '\0';
 }
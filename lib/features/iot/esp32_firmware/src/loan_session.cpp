@@ -0,0 +1,76 @@
+#include "loan_session.h"
+
+LoanSession::LoanSession() : active(false), loanCount(0), truncated(false), lastActivity(0) {
+    mssv[0] = '\0';
+    name[0] = '\0';
+}
+
+void LoanSession::start(const StudentInfo& student) {
+    memcpy(mssv, student.mssv, sizeof(mssv));
+    memcpy(name, student.name, sizeof(name));
+    loanCount = student.loanCount;
+    truncated = student.loansTruncated;
+    memcpy(loans, student.loans, sizeof(LoanInfo) * loanCount);
+    
+    active = true;
+    lastActivity = millis();
+    
+    DEBUG_PRINTF("[SESSION] Started for %s, %d active loan(s), %d overdue\n",
+                 mssv, loanCount, getOverdueCount());
+}
+
+void LoanSession::end() {
+    if (active) {
+        DEBUG_PRINTLN("[SESSION] Ended");
+    }
+    active = false;
+    loanCount = 0;
+    truncated = false;
+}
+
+bool LoanSession::isActive() {
+    if (active && (millis() - lastActivity > STUDENT_SESSION_TIMEOUT)) {
+        DEBUG_PRINTLN("[SESSION] Timeout");
+        end();
+    }
+    return active;
+}
+
+void LoanSession::touch() {
+    lastActivity = millis();
+}
+
+const LoanInfo* LoanSession::findByBookCode(const char* bookCode) {
+    if (!isActive()) {
+        return nullptr;
+    }
+    
+    for (uint8_t i = 0; i < loanCount; i++) {
+        if (strcmp(loans[i].bookCode, bookCode) == 0) {
+            return &loans[i];
+        }
+    }
+    return nullptr;
+}
+
+bool LoanSession::markReturned(const char* bookCode) {
+    for (uint8_t i = 0; i < loanCount; i++) {
+        if (strcmp(loans[i].bookCode, bookCode) == 0) {
+            // Dồn phần tử cuối vào chỗ trống, thứ tự không quan trọng
+            loans[i] = loans[loanCount - 1];
+            loanCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t LoanSession::getOverdueCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < loanCount; i++) {
+        if (loans[i].overdue) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -2,23 +2,692 @@
 #include "config.h"
 #include "wifi_handler.h"
 #include "lcd_handler.h"
-#include "rfid_handler.h"
+#include "rfid_reader_pool.h"
 #include "api_client.h"
+#include "loan_session.h"
+#include "request_scheduler.h"
+#include "heap_monitor.h"
+#include "api_codec.h"
+#include "event_stream.h"
+#include "station_metrics.h"
+#include "metrics_server.h"
+#include "clock_sync.h"
+#include "scan_trace.h"
+#include "backend_discovery.h"
+#include "backpressure.h"
+#include "station_params.h"
+#if INVENTORY_ENABLED
+#include "inventory_session.h"
+#endif
+#if USB_SCANNER_ENABLED
+#include "usb_barcode_scanner.h"
+#endif
+#if SELF_BENCH_ENABLED
+#include "self_benchmark.h"
+#endif
+#if OTA_ENABLED
+#include "ota_updater.h"
+#endif
 
 // Global objects
 WiFiHandler wifiHandler;
 LCDHandler lcdHandler;
-RFIDHandler rfidHandler;
+RFIDReaderPool rfidReaders;
 APIClient apiClient;
+LoanSession loanSession;
+RequestScheduler requestScheduler(apiClient);
+#if EVENT_STREAM_ENABLED
+EventStream eventStream;
+#endif
+#if METRICS_ENABLED
+void collectMetrics(MetricsWriter& out);
+MetricsServer metricsServer(collectMetrics);
+#endif
 
 // State management
 unsigned long lastHeartbeat = 0;
 unsigned long lastDisplayUpdate = 0;
 bool isProcessing = false;
+bool loanSummaryPending = false;
 
 // Button state
 int lastButtonState = HIGH;
+int buttonState = HIGH;                // Trạng thái đã qua debounce
 unsigned long lastDebounceTime = 0;
+unsigned long buttonPressedAt = 0;
+bool longPressHandled = false;
+
+#if CARD_DATA_MODE
+// Thẻ có dữ liệu sinh viên: MSSV đang chờ server xác nhận (cùng UID/đầu đọc để gửi sự kiện
+// đã xác nhận cho app), bản ghi chờ ghi lên thẻ
+char confirmingMSSV[CARD_RECORD_MSSV_LEN + 1] = "";
+char confirmingUID[REQUEST_DATA_LEN] = "";
+ScanSource confirmingSource;
+StudentCardRecord pendingCardRecord;
+bool cardWritePending = false;
+#endif
+
+// Lần quét thẻ chờ màn hình rảnh, mỗi đầu đọc một chỗ. Vết bắt đầu từ lúc phát hiện thẻ
+struct PendingTap {
+    bool valid;
+    char uid[REQUEST_DATA_LEN];
+    ScanSource source;
+    ScanTrace trace;
+};
+PendingTap pendingTaps[RFID_READER_COUNT];
+uint8_t displayedReader = RFID_READER_COUNT;   // Đầu đọc có kết quả đang hiện, COUNT = không phải thẻ
+
+// Thời gian hiển thị tên sinh viên trước khi chuyển sang tóm tắt phiếu mượn
+#define LOAN_SUMMARY_DELAY 2000
+
+// Chu kỳ cập nhật số nhãn trên LCD khi kiểm kê
+#define INVENTORY_LCD_INTERVAL 500
+
+// Đẩy kết quả quét thẳng tới app trong LAN (không chờ backend chuyển tiếp).
+// Sự kiện mang theo vết của lần quét; vết được in ra Serial kể cả khi không có app
+void publishStudentEvent(const char* cardUID, StudentInfo& student, const ScanSource& source) {
+    #if EVENT_STREAM_ENABLED
+    if (eventStream.getClientCount() > 0) {
+        ScanTracing::mark(student.trace, TRACE_PUBLISHED);
+        char json[EVENT_STREAM_EVENT_MAX];
+        size_t length = ApiCodec::createStudentEvent(cardUID, student, source, DEVICE_ID, json, sizeof(json));
+        if (length > 0) {
+            eventStream.publish(json, length);
+        }
+    }
+    #endif
+    ScanTracing::print(student.trace, "student");
+}
+
+void publishBookEvent(const char* barcode, BookInfo& book) {
+    #if EVENT_STREAM_ENABLED
+    if (eventStream.getClientCount() > 0) {
+        ScanTracing::mark(book.trace, TRACE_PUBLISHED);
+        char json[EVENT_STREAM_EVENT_MAX];
+        size_t length = ApiCodec::createBookEvent(barcode, book, DEVICE_ID, json, sizeof(json));
+        if (length > 0) {
+            eventStream.publish(json, length);
+        }
+    }
+    #endif
+    ScanTracing::print(book.trace, "book");
+}
+
+#if METRICS_ENABLED
+// Số liệu cho GET /metrics, chạy trong task metrics: chỉ đọc bộ đếm và trạng thái
+// hiện có của các module, không gọi gì chờ task mạng hay loop()
+void collectMetrics(MetricsWriter& out) {
+    static const char* const PRIORITY_NAMES[PRIORITY_COUNT] = {"scan", "replay", "heartbeat"};
+    char labels[64];
+    
+    out.family("station_uptime_seconds", "gauge", "Time since boot");
+    out.sample("station_uptime_seconds", "", (uint64_t)(millis() / 1000));
+    
+    stationMetrics.write(out);
+    
+    out.family("station_wifi_rssi_dbm", "gauge", "WiFi signal strength");
+    out.sample("station_wifi_rssi_dbm", "", (int64_t)wifiHandler.getSignalStrength());
+    
+    HeapSnapshot heap = heapMonitor.snapshot();
+    out.family("station_heap_free_bytes", "gauge", "Free internal heap");
+    out.sample("station_heap_free_bytes", "", (uint64_t)heap.freeHeap);
+    out.family("station_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    out.sample("station_heap_min_free_bytes", "", (uint64_t)heap.minFreeHeap);
+    out.family("station_heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block");
+    out.sample("station_heap_largest_free_block_bytes", "", (uint64_t)heap.largestFreeBlock);
+    out.family("station_heap_fragmentation_ratio", "gauge", "1 - largest free block / free heap");
+    out.sample("station_heap_fragmentation_ratio", "", heap.fragmentationPct / 100.0);
+    out.family("station_heap_drift_bytes", "gauge", "Heap lost since the post-boot baseline");
+    out.sample("station_heap_drift_bytes", "", (int64_t)heap.drift);
+    out.family("station_psram_free_bytes", "gauge", "Free PSRAM");
+    out.sample("station_psram_free_bytes", "", (uint64_t)heap.freePsram);
+    
+    out.family("station_task_stack_free_bytes", "gauge", "Stack high-water mark per task");
+    for (uint8_t i = 0; i < heapMonitor.getTaskCount(); i++) {
+        snprintf(labels, sizeof(labels), "task=\"%s\"", heapMonitor.getTaskName(i));
+        out.sample("station_task_stack_free_bytes", labels, (uint64_t)heapMonitor.getStackHighWater(i));
+    }
+    
+    const ScanArena& arena = apiClient.getArena();
+    out.family("station_arena_high_water_bytes", "gauge", "Peak scan arena usage");
+    out.sample("station_arena_high_water_bytes", "", (uint64_t)arena.getHighWater());
+    out.family("station_arena_overflows_total", "counter", "Scan arena allocations that did not fit");
+    out.sample("station_arena_overflows_total", "", (uint64_t)arena.getOverflowCount());
+    
+    out.family("station_clock_synced", "gauge", "1 if the station has wall-clock time from SNTP");
+    out.sample("station_clock_synced", "", (uint64_t)(clockSync.isSynced() ? 1 : 0));
+    out.family("station_clock_syncs_total", "counter", "SNTP synchronizations");
+    out.sample("station_clock_syncs_total", "", (uint64_t)clockSync.getSyncCount());
+    
+    const DiscoveryStats& discovery = backendDiscovery.getStats();
+    out.family("station_backend_instances", "gauge", "Backend instances found via mDNS");
+    out.sample("station_backend_instances", "", (uint64_t)backendDiscovery.getInstanceCount());
+    out.family("station_backend_cache_fresh", "gauge", "1 if the backend address cache is within its TTL");
+    out.sample("station_backend_cache_fresh", "", (uint64_t)(backendDiscovery.isCacheFresh() ? 1 : 0));
+    out.family("station_backend_discovery_queries_total", "counter", "mDNS queries for the backend");
+    out.sample("station_backend_discovery_queries_total", "", (uint64_t)discovery.queries);
+    out.family("station_backend_failovers_total", "counter", "Switches to another backend instance");
+    out.sample("station_backend_failovers_total", "", (uint64_t)discovery.failovers);
+    
+    const ParamStats& params = stationParams.getStats();
+    out.family("station_config_revision", "gauge", "Server configuration revision applied to the station");
+    out.sample("station_config_revision", "", (uint64_t)stationParams.getRevision());
+    out.family("station_config_params_total", "counter", "Runtime parameter changes by result");
+    out.sample("station_config_params_total", "result=\"applied\"", (uint64_t)params.applied);
+    out.sample("station_config_params_total", "result=\"rejected\"", (uint64_t)params.rejected);
+    
+    #if INVENTORY_ENABLED
+    const InventoryStats& inventory = inventorySession.getStats();
+    out.family("station_inventory_active", "gauge", "1 while a stocktake session is running");
+    out.sample("station_inventory_active", "", (uint64_t)(inventorySession.isActive() ? 1 : 0));
+    out.family("station_inventory_tags_total", "counter", "Tag reads in the current stocktake session by result");
+    out.sample("station_inventory_tags_total", "result=\"unique\"", (uint64_t)inventory.unique);
+    out.sample("station_inventory_tags_total", "result=\"duplicate\"", (uint64_t)inventory.duplicates);
+    out.sample("station_inventory_tags_total", "result=\"deferred\"", (uint64_t)inventory.deferred);
+    out.family("station_inventory_tags_per_second", "gauge", "Tag reads per second over the last second");
+    out.sample("station_inventory_tags_per_second", "", inventorySession.currentRate());
+    out.family("station_inventory_pending_tags", "gauge", "Unique tags waiting to be uploaded");
+    out.sample("station_inventory_pending_tags", "", (uint64_t)inventorySession.getPendingCount());
+    out.family("station_inventory_upload_bytes_total", "counter", "Uploaded UID bytes, compressed and as a hex array");
+    out.sample("station_inventory_upload_bytes_total", "encoding=\"delta-varint\"", (uint64_t)inventory.encodedBytes);
+    out.sample("station_inventory_upload_bytes_total", "encoding=\"hex\"", (uint64_t)inventory.hexBytes);
+    #endif
+    
+    #if API_TLS_ENABLED
+    const TlsStats& tls = apiClient.getTls().getStats();
+    out.family("station_tls_handshakes_total", "counter", "TLS handshakes by type");
+    out.sample("station_tls_handshakes_total", "type=\"full\"", (uint64_t)tls.fullHandshakes);
+    out.sample("station_tls_handshakes_total", "type=\"resumed\"", (uint64_t)tls.resumedHandshakes);
+    out.sample("station_tls_handshakes_total", "type=\"failed\"", (uint64_t)tls.failedHandshakes);
+    out.family("station_tls_handshake_seconds_total", "counter", "Time spent in TLS handshakes");
+    out.sample("station_tls_handshake_seconds_total", "type=\"full\"", tls.totalFullMs / 1000.0);
+    out.sample("station_tls_handshake_seconds_total", "type=\"resumed\"", tls.totalResumedMs / 1000.0);
+    #endif
+    
+    out.family("station_request_queue_depth", "gauge", "Requests waiting for the network task");
+    for (uint8_t p = 0; p < PRIORITY_COUNT; p++) {
+        snprintf(labels, sizeof(labels), "priority=\"%s\"", PRIORITY_NAMES[p]);
+        out.sample("station_request_queue_depth", labels,
+                   (uint64_t)requestScheduler.getPendingCount((RequestPriority)p));
+    }
+    out.family("station_requests_served_total", "counter", "Requests completed by the network task");
+    for (uint8_t p = 0; p < PRIORITY_COUNT; p++) {
+        snprintf(labels, sizeof(labels), "priority=\"%s\"", PRIORITY_NAMES[p]);
+        out.sample("station_requests_served_total", labels,
+                   (uint64_t)requestScheduler.getStats((RequestPriority)p).served);
+    }
+    out.family("station_requests_dropped_total", "counter", "Requests dropped because a queue was full");
+    for (uint8_t p = 0; p < PRIORITY_COUNT; p++) {
+        snprintf(labels, sizeof(labels), "priority=\"%s\"", PRIORITY_NAMES[p]);
+        out.sample("station_requests_dropped_total", labels,
+                   (uint64_t)requestScheduler.getStats((RequestPriority)p).dropped);
+    }
+    
+    #if BACKPRESSURE_ENABLED
+    const BackpressureStats& pressure = backpressure.getStats();
+    out.family("station_backpressure_limit", "gauge", "AIMD limit on requests in flight (1 = unthrottled)");
+    out.sample("station_backpressure_limit", "", (double)backpressure.getLimit());
+    out.family("station_backpressure_hold_seconds", "gauge", "Time left before the server accepts requests again");
+    out.sample("station_backpressure_hold_seconds", "", backpressure.holdRemaining(millis()) / 1000.0);
+    out.family("station_backpressure_overloads_total", "counter", "429/503 responses from the server");
+    out.sample("station_backpressure_overloads_total", "", (uint64_t)pressure.overloads);
+    out.family("station_backpressure_shed_total", "counter", "Background requests deferred while overloaded");
+    out.sample("station_backpressure_shed_total", "", (uint64_t)pressure.shed);
+    out.family("station_backpressure_rejected_total", "counter", "Scans answered locally while overloaded");
+    out.sample("station_backpressure_rejected_total", "", (uint64_t)pressure.rejected);
+    #endif
+    
+    out.family("station_rfid_detections_total", "counter", "Cards detected per reader");
+    for (uint8_t i = 0; i < rfidReaders.getReaderCount(); i++) {
+        snprintf(labels, sizeof(labels), "reader=\"%d\",lane=\"%s\"", i,
+                 ApiCodec::laneName(rfidReaders.getLane(i)));
+        out.sample("station_rfid_detections_total", labels, (uint64_t)rfidReaders.getStats(i).detections);
+    }
+    
+    #if USB_SCANNER_ENABLED
+    const HidDecoderStats& keys = usbBarcodeScanner.getDecoderStats();
+    out.family("station_usb_scanner_connected", "gauge", "1 if a USB barcode scanner is attached");
+    out.sample("station_usb_scanner_connected", "", (uint64_t)(usbBarcodeScanner.isConnected() ? 1 : 0));
+    out.family("station_usb_scanner_barcodes_total", "counter", "Keystroke sequences from the USB scanner by result");
+    out.sample("station_usb_scanner_barcodes_total", "result=\"ok\"", (uint64_t)keys.barcodes);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"discarded\"", (uint64_t)keys.discarded);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"overflow\"", (uint64_t)keys.overflows);
+    out.sample("station_usb_scanner_barcodes_total", "result=\"dropped\"",
+               (uint64_t)usbBarcodeScanner.getStats().dropped);
+    #endif
+    
+    #if EVENT_STREAM_ENABLED
+    const EventStreamStats& events = eventStream.getStats();
+    out.family("station_event_stream_clients", "gauge", "Open WebSocket clients");
+    out.sample("station_event_stream_clients", "", (uint64_t)eventStream.getClientCount());
+    out.family("station_event_stream_published_total", "counter", "Scan events pushed to clients");
+    out.sample("station_event_stream_published_total", "", (uint64_t)events.published);
+    out.family("station_event_stream_dropped_total", "counter", "WebSocket clients disconnected by the station");
+    out.sample("station_event_stream_dropped_total", "reason=\"slow\"", (uint64_t)events.slowDropped);
+    out.sample("station_event_stream_dropped_total", "reason=\"timeout\"", (uint64_t)events.timedOut);
+    #endif
+}
+#endif
+
+// Xử lý một mã sách: đối chiếu với phiên sinh viên trước, sau đó mới gọi API
+void handleBookScan(const char* barcode) {
+    isProcessing = true;
+    displayedReader = RFID_READER_COUNT;
+    loanSummaryPending = false;
+    ScanTrace trace;
+    ScanTracing::start(trace);
+    
+    // Sách nằm trong danh sách đang mượn → hiển thị hạn trả ngay, không chờ mạng
+    const LoanInfo* loan = loanSession.findByBookCode(barcode);
+    if (loan != nullptr) {
+        DEBUG_PRINT("[SESSION] Loan hit: ");
+        DEBUG_PRINTLN(loan->bookCode);
+        lcdHandler.displayLoanDue(loan->bookName, loan->dueDate, loan->overdue);
+        loanSession.touch();
+    } else {
+        lcdHandler.displayProcessing();
+    }
+    
+    // Vẫn gửi lên server để ghi nhận và đẩy sự kiện tới app
+    BookInfo book = requestScheduler.scanBookBarcode(barcode, trace);
+    publishBookEvent(barcode, book);
+    stationMetrics.countScan(SCAN_KIND_BOOK, book.success);
+    
+    if (book.success) {
+        if (loan != nullptr) {
+            // Tra được sách chưa có nghĩa là đã trả: chỉ bỏ khỏi phiên khi server xác nhận
+            if (book.returned) {
+                loanSession.markReturned(barcode);
+            }
+        } else {
+            lcdHandler.displayBook(book.title, book.code);
+        }
+    } else if (loan == nullptr) {
+        DEBUG_PRINT("[API] Error: ");
+        DEBUG_PRINTLN(book.error);
+        lcdHandler.displayError("Khong tim thay");
+    }
+    
+    lastDisplayUpdate = millis();
+}
+
+// Quét thẻ sinh viên qua server (chờ kết quả)
+void handleStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace) {
+    // Gửi request lên API
+    StudentInfo student = requestScheduler.scanStudentCard(cardUID, source, trace);
+    publishStudentEvent(cardUID, student, source);
+    stationMetrics.countScan(SCAN_KIND_STUDENT, student.success);
+    
+    if (student.success) {
+        // Thành công
+        DEBUG_PRINTLN("[API] Student found:");
+        DEBUG_PRINT("  Name: ");
+        DEBUG_PRINTLN(student.name);
+        DEBUG_PRINT("  MSSV: ");
+        DEBUG_PRINTLN(student.mssv);
+        DEBUG_PRINT("  Class: ");
+        DEBUG_PRINTLN(student.className);
+    
+        // Hiển thị thông tin sinh viên
+        lcdHandler.displayStudent(student.name, student.mssv);
+    
+        // Giữ danh sách phiếu mượn cho các lần quét sách tiếp theo
+        loanSession.start(student);
+        loanSummaryPending = student.loanCount > 0;
+    
+        // Beep success (nếu có buzzer)
+        #ifdef BUZZER_PIN
+        tone(BUZZER_PIN, 1000, 200);
+        #endif
+    } else {
+        // Thất bại
+        DEBUG_PRINT("[API] Error: ");
+        DEBUG_PRINTLN(student.error);
+    
+        lcdHandler.displayError("Khong tim thay");
+        loanSession.end();
+        loanSummaryPending = false;
+    
+        // Beep error (nếu có buzzer)
+        #ifdef BUZZER_PIN
+        for (int i = 0; i < 3; i++) {
+            tone(BUZZER_PIN, 500, 100);
+            delay(150);
+        }
+        #endif
+    }
+}
+
+#if CARD_DATA_MODE
+// Ngày hiện tại dạng YYYYMMDD, 0 nếu trạm chưa có giờ thực
+uint32_t currentDate() {
+    time_t now = time(nullptr);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    if (timeinfo.tm_year + 1900 < 2020) {
+        return 0;
+    }
+    return (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+}
+
+// Xử lý thẻ có dữ liệu sinh viên. Trả về false nếu cần quét qua server như cũ
+bool handleCardData(RFIDHandler& reader, const char* cardUID, const ScanSource& source, const ScanTrace& trace) {
+    // Chế độ ghi thẻ: ghi bản ghi đang chờ lên thẻ vừa đặt vào
+    if (cardWritePending) {
+        cardWritePending = false;
+        CardRecordStatus status = reader.writeStudentRecord(pendingCardRecord);
+        if (status == CARD_RECORD_OK) {
+            lcdHandler.displayText("Ghi the OK", pendingCardRecord.mssv);
+        } else {
+            lcdHandler.displayError(CardRecord::statusName(status));
+        }
+        return true;
+    }
+    
+    StudentCardRecord record;
+    CardRecordStatus status = reader.readStudentRecord(record);
+    if (status == CARD_RECORD_OK && CardRecord::isExpired(record, currentDate())) {
+        status = CARD_RECORD_EXPIRED;
+    }
+    
+    if (status == CARD_RECORD_EXPIRED) {
+        stationMetrics.countScan(SCAN_KIND_STUDENT, false);
+        lcdHandler.displayError("The het han");
+        loanSession.end();
+        return true;
+    }
+    if (status != CARD_RECORD_OK) {
+        // Thẻ chưa ghi dữ liệu / chữ ký sai → tra cứu server như cũ
+        return false;
+    }
+    
+    // Hiển thị ngay từ dữ liệu trên thẻ, server xác nhận + trả phiếu mượn ở nền. App chỉ nhận
+    // sự kiện đánh dấu unverified: mất mạng thì không bao giờ có bản xác nhận để tự điền
+    DEBUG_PRINT("[CARD] Student from card: ");
+    DEBUG_PRINTLN(record.mssv);
+    lcdHandler.displayStudent(record.name, record.mssv);
+    loanSession.end();
+    loanSummaryPending = false;
+    
+    StudentInfo fromCard;
+    resetStudentInfo(fromCard);
+    fromCard.success = true;
+    fromCard.unverified = true;
+    strlcpy(fromCard.mssv, record.mssv, sizeof(fromCard.mssv));
+    strlcpy(fromCard.name, record.name, sizeof(fromCard.name));
+    fromCard.trace = trace;
+    publishStudentEvent(cardUID, fromCard, source);
+    stationMetrics.countScan(SCAN_KIND_STUDENT, true);
+    
+    strlcpy(confirmingMSSV, record.mssv, sizeof(confirmingMSSV));
+    strlcpy(confirmingUID, cardUID, sizeof(confirmingUID));
+    confirmingSource = source;
+    if (!requestScheduler.submitStudentCard(cardUID, source, trace)) {
+        confirmingMSSV[0] = '\0';
+    }
+    return true;
+}
+
+// Kết quả xác nhận từ server cho thẻ đã hiển thị từ dữ liệu trên thẻ
+void handleStudentConfirmation(StudentInfo& student) {
+    if (confirmingMSSV[0] == '\0') {
+        ScanTracing::print(student.trace, "confirm");
+        return;
+    }
+    
+    if (student.success && strcmp(student.mssv, confirmingMSSV) == 0) {
+        DEBUG_PRINTLN("[CARD] Confirmed by server");
+        publishStudentEvent(confirmingUID, student, confirmingSource);
+        loanSession.start(student);
+        loanSummaryPending = student.loanCount > 0;
+    } else if (student.success || student.httpCode == HTTP_CODE_OK) {
+        // Server có trả lời nhưng không khớp: thẻ bị thu hồi hoặc dữ liệu cũ
+        ScanTracing::print(student.trace, "confirm");
+        DEBUG_PRINT("[CARD] Rejected by server: ");
+        DEBUG_PRINTLN(student.success ? student.mssv : student.error);
+        lcdHandler.displayError("The khong hop le");
+        loanSession.end();
+        loanSummaryPending = false;
+        isProcessing = true;
+        lastDisplayUpdate = millis();
+    } else {
+        // Mất kết nối: LCD giữ thông tin trên thẻ nhưng không mở phiên mượn/trả, app chỉ có sự
+        // kiện unverified; request được gửi lại ở nền
+        ScanTracing::print(student.trace, "confirm");
+        DEBUG_PRINTLN("[CARD] Confirmation deferred (offline)");
+    }
+    
+    confirmingMSSV[0] = '\0';
+}
+#endif
+
+// Xử lý một lần quét thẻ. cardPresent = false: lần quét đã chờ màn hình rảnh, thẻ có thể đã
+// rời đầu đọc nên không đọc dữ liệu trên thẻ mà tra cứu server
+void handleCardTap(const char* cardUID, const ScanSource& source, ScanTrace& trace, bool cardPresent) {
+    isProcessing = true;
+    displayedReader = source.reader;
+    RFIDHandler& reader = rfidReaders.reader(source.reader);
+    DEBUG_PRINTF("[RFID] Card detected on reader %d: %s\n", source.reader, cardUID);
+    
+    // Hiển thị đang xử lý
+    lcdHandler.displayProcessing();
+    
+    #ifdef LED_PIN
+    digitalWrite(LED_PIN, HIGH);
+    #endif
+    
+    bool handled = false;
+    #if CARD_DATA_MODE
+    if (cardPresent) {
+        handled = handleCardData(reader, cardUID, source, trace);
+    }
+    #endif
+    if (!handled) {
+        handleStudentCard(cardUID, source, trace);
+    }
+    
+    #ifdef LED_PIN
+    digitalWrite(LED_PIN, LOW);
+    #endif
+    
+    if (cardPresent) {
+        reader.haltCard();
+    }
+    lastDisplayUpdate = millis();
+}
+
+// Màn hình có thể hiện kết quả mới cho đầu đọc này chưa
+bool canServeReader(uint8_t index) {
+    if (!isProcessing) {
+        return true;
+    }
+    return displayedReader != index && millis() - lastDisplayUpdate >= RFID_LANE_MIN_DISPLAY_MS;
+}
+
+// Poll mọi đầu đọc (debounce và độ trễ theo từng đầu đọc chạy tiếp cả khi màn hình bận), rồi xử lý
+// tối đa một lần quét: thẻ vừa phát hiện nếu làn của nó được phục vụ ngay, không thì lần quét đã giữ
+void serviceReaders() {
+    RFIDEvent event;
+    if (rfidReaders.poll(event)) {
+        uint8_t index = event.source.reader;
+        ScanTrace trace;
+        ScanTracing::start(trace);
+        if (canServeReader(index) && !pendingTaps[index].valid) {
+            handleCardTap(event.uid, event.source, trace, true);
+            return;
+        }
+        PendingTap& tap = pendingTaps[index];
+        tap.valid = true;
+        strlcpy(tap.uid, event.uid, sizeof(tap.uid));
+        tap.source = event.source;
+        tap.trace = trace;
+        rfidReaders.reader(index).haltCard();
+        DEBUG_PRINTF("[RFID] Reader %d: %s held until display is free\n", index, tap.uid);
+    }
+    
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        PendingTap& tap = pendingTaps[i];
+        if (tap.valid && canServeReader(i)) {
+            tap.valid = false;
+            handleCardTap(tap.uid, tap.source, tap.trace, false);
+            return;
+        }
+    }
+}
+
+#if SELF_BENCH_ENABLED
+// Tự kiểm tra hiệu năng (lệnh "bench" hoặc giữ nút BOOT): chặn loop() vài giây, kết quả
+// hiện trên LCD tới hết thời gian hiển thị như một lần quét
+void runSelfBenchmark() {
+    #if INVENTORY_ENABLED
+    if (inventorySession.isActive()) {
+        DEBUG_PRINTLN("[BENCH] Stop inventory first");
+        return;
+    }
+    #endif
+    loanSession.end();
+    loanSummaryPending = false;
+    
+    if (!selfBenchmark.run(rfidReaders, lcdHandler, wifiHandler, requestScheduler)) {
+        lcdHandler.displayError("Tu kiem tra loi");
+    } else {
+        selfBenchmark.printReport();
+        const BenchReport& report = selfBenchmark.getReport();
+        char line1[LCD_COLS + 1];
+        char line2[LCD_COLS + 1];
+        snprintf(line1, sizeof(line1), "RC %uus LCD %ums", report.rc522[0].p50Us, report.lcd.p50Us / 1000);
+        if (report.http.samples > 0) {
+            snprintf(line2, sizeof(line2), "%ddBm HTTP %ums", report.rssiMax, report.http.p50Us / 1000);
+        } else {
+            snprintf(line2, sizeof(line2), "%ddBm HTTP loi", report.rssiMax);
+        }
+        lcdHandler.displayText(line1, line2);
+    }
+    isProcessing = true;
+    displayedReader = RFID_READER_COUNT;
+    lastDisplayUpdate = millis();
+}
+#endif
+
+// Lệnh Serial:
+//   "card-write <mssv>|<YYYYMMDD>|<ten>" rồi đặt thẻ cần ghi lên đầu đọc (CARD_DATA_MODE)
+//   "params", "param <ten> <gia tri>", "param-reset <ten>": xem/chỉnh tham số vận hành
+//   "book <barcode>": quét mã sách như từ máy quét (khi chưa có camera/máy quét USB)
+//   "inventory start|stop", "inventory": phiên kiểm kê và thống kê của nó (INVENTORY_ENABLED)
+//   "bench": tự kiểm tra hiệu năng, "bench report": in lại kết quả lần trước (SELF_BENCH_ENABLED)
+//   "ota": kiểm tra và cài firmware mới, "ota status": thống kê cập nhật (OTA_ENABLED)
+void handleSerialCommand() {
+    static char line[128];
+    static uint8_t length = 0;
+    
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (length < sizeof(line) - 1) {
+                line[length++] = c;
+            }
+            continue;
+        }
+        if (length == 0) {
+            continue;
+        }
+        line[length] = '\0';
+        length = 0;
+    
+        if (strcmp(line, "params") == 0) {
+            stationParams.printStats();
+        } else if (strncmp(line, "param ", 6) == 0) {
+            char* name = line + 6;
+            char* value = strchr(name, ' ');
+            if (value == nullptr) {
+                DEBUG_PRINTLN("[CMD] Usage: param <name> <value>");
+                continue;
+            }
+            *value++ = '\0';
+            if (!stationParams.set(name, strtoul(value, nullptr, 10))) {
+                DEBUG_PRINTLN("[CMD] Unknown parameter or value out of range");
+            }
+        } else if (strncmp(line, "param-reset ", 12) == 0) {
+            if (!stationParams.reset(line + 12)) {
+                DEBUG_PRINTLN("[CMD] Unknown parameter");
+            }
+        } else if (strncmp(line, "book ", 5) == 0) {
+            handleBookScan(line + 5);
+        #if INVENTORY_ENABLED
+        } else if (strcmp(line, "inventory start") == 0) {
+            isProcessing = false;
+            loanSummaryPending = false;
+            inventorySession.start(rfidReaders);
+        } else if (strcmp(line, "inventory stop") == 0) {
+            inventorySession.stop(rfidReaders);
+            inventorySession.printStats();
+            lcdHandler.displayReady();
+        } else if (strcmp(line, "inventory") == 0) {
+            inventorySession.printStats();
+        #endif
+        #if SELF_BENCH_ENABLED
+        } else if (strcmp(line, "bench") == 0) {
+            runSelfBenchmark();
+        } else if (strcmp(line, "bench report") == 0) {
+            selfBenchmark.printReport();
+        #endif
+        #if OTA_ENABLED
+        } else if (strcmp(line, "ota") == 0) {
+            if (!requestScheduler.requestFirmwareUpdate()) {
+                DEBUG_PRINTLN("[OTA] Already queued or restart pending");
+            }
+        } else if (strcmp(line, "ota status") == 0) {
+            otaUpdater.printStats();
+        #endif
+        #if CARD_DATA_MODE
+        } else if (strncmp(line, "card-write ", 11) == 0) {
+            char* mssv = line + 11;
+            char* expiry = strchr(mssv, '|');
+            char* name = expiry != nullptr ? strchr(expiry + 1, '|') : nullptr;
+            if (name == nullptr) {
+                DEBUG_PRINTLN("[CMD] Usage: card-write <mssv>|<YYYYMMDD>|<ten>");
+                continue;
+            }
+            *expiry++ = '\0';
+            *name++ = '\0';
+    
+            memset(&pendingCardRecord, 0, sizeof(pendingCardRecord));
+            strlcpy(pendingCardRecord.mssv, mssv, sizeof(pendingCardRecord.mssv));
+            strlcpy(pendingCardRecord.name, name, sizeof(pendingCardRecord.name));
+            pendingCardRecord.expiry = strtoul(expiry, nullptr, 10);
+            cardWritePending = true;
+    
+            DEBUG_PRINTLN("[CMD] Place card to write...");
+            lcdHandler.displayText("Dat the can ghi", pendingCardRecord.mssv);
+        } else if (strcmp(line, "card-cancel") == 0) {
+            cardWritePending = false;
+            lcdHandler.displayReady();
+        #endif
+        } else {
+            DEBUG_PRINT("[CMD] Unknown command: ");
+            DEBUG_PRINTLN(line);
+        }
+    }
+}
+
+#if INVENTORY_ENABLED
+// Kiểm kê: đọc nhãn liên tục thay cho luồng quét thẻ, số nhãn trên LCD cập nhật định kỳ
+void serviceInventory() {
+    static uint32_t lastLcdUpdate = 0;
+    
+    inventorySession.poll(rfidReaders);
+    
+    uint32_t now = millis();
+    if (now - lastLcdUpdate >= INVENTORY_LCD_INTERVAL) {
+        char count[LCD_COLS + 1];
+        char rate[LCD_COLS + 1];
+        snprintf(count, sizeof(count), "Kiem ke: %u", inventorySession.getStats().unique);
+        snprintf(rate, sizeof(rate), "%.0f the/s", inventorySession.currentRate());
+        lcdHandler.displayText(count, rate);
+        lastLcdUpdate = now;
+    }
+}
+#endif
 
 void setup() {
     // Khởi tạo Serial
@@ -39,6 +708,9 @@ void setup() {
     // Khởi tạo button
     pinMode(SCAN_BUTTON_PIN, INPUT_PULLUP);
     
+    // Tham số vận hành đã lưu (NVS) phải có trước khi các module đọc timeout/chu kỳ
+    stationParams.begin();
+    
     // Khởi tạo LED (optional)
     #ifdef LED_PIN
     pinMode(LED_PIN, OUTPUT);
@@ -65,13 +737,23 @@ void setup() {
     }
     
     lcdHandler.displayText("WiFi OK!", wifiHandler.getIPAddress().c_str());
+    clockSync.begin();
+    backendDiscovery.begin();
+    #if EVENT_STREAM_ENABLED
+    eventStream.begin();
+    #endif
+    #if METRICS_ENABLED
+    if (!metricsServer.begin()) {
+        DEBUG_PRINTLN("[ERROR] Metrics server failed!");
+    }
+    #endif
     delay(2000);
     
-    // Khởi tạo RFID
-    DEBUG_PRINTLN("[INIT] Initializing RFID reader...");
+    // Khởi tạo RFID (một hoặc nhiều đầu đọc trên cùng bus SPI)
+    DEBUG_PRINTLN("[INIT] Initializing RFID readers...");
     lcdHandler.displayText("Khoi tao RFID...", "");
     
-    if (!rfidHandler.begin()) {
+    if (!rfidReaders.begin()) {
         DEBUG_PRINTLN("[ERROR] RFID initialization failed!");
         lcdHandler.displayError("Loi RFID!");
         while (true) {
@@ -79,12 +761,53 @@ void setup() {
         }
     }
     
-    lcdHandler.displayText("RFID OK!", "");
+    char readerText[LCD_COLS + 1];
+    snprintf(readerText, sizeof(readerText), "%d/%d dau doc", rfidReaders.getActiveCount(),
+             rfidReaders.getReaderCount());
+    lcdHandler.displayText("RFID OK!", readerText);
+    #if INVENTORY_ENABLED
+    if (!inventorySession.begin()) {
+        DEBUG_PRINTLN("[ERROR] Inventory mode unavailable!");
+    }
+    #endif
+    #if USB_SCANNER_ENABLED
+    if (!usbBarcodeScanner.begin()) {
+        DEBUG_PRINTLN("[ERROR] USB host failed, barcode scanner disabled");
+    }
+    #endif
     delay(1000);
     
-    // Gửi heartbeat đầu tiên
+    // Khởi động task mạng, mọi request HTTP đi qua bộ lập lịch
+    DEBUG_PRINTLN("[INIT] Starting request scheduler...");
+    if (!apiClient.begin() || !requestScheduler.begin()) {
+        DEBUG_PRINTLN("[ERROR] Request scheduler failed!");
+        lcdHandler.displayError("Loi he thong!");
+        while (true) {
+            delay(1000);
+        }
+    }
+    
+    // Theo dõi stack của loop() và task mạng, lấy mốc heap sau khởi động
+    heapMonitor.registerTask(xTaskGetCurrentTaskHandle(), "loop");
+    heapMonitor.registerTask(requestScheduler.getTaskHandle(), "net");
+    #if METRICS_ENABLED
+    if (metricsServer.getTaskHandle() != nullptr) {
+        heapMonitor.registerTask(metricsServer.getTaskHandle(), "metrics");
+    }
+    #endif
+    if (backendDiscovery.getTaskHandle() != nullptr) {
+        heapMonitor.registerTask(backendDiscovery.getTaskHandle(), "mdns");
+    }
+    #if USB_SCANNER_ENABLED
+    if (usbBarcodeScanner.getTaskHandle() != nullptr) {
+        heapMonitor.registerTask(usbBarcodeScanner.getTaskHandle(), "usb");
+    }
+    #endif
+    heapMonitor.markBaseline();
+    
+    // Gửi heartbeat đầu tiên (chạy nền)
     DEBUG_PRINTLN("[INIT] Sending initial heartbeat...");
-    apiClient.sendHeartbeat();
+    requestScheduler.requestHeartbeat();
     lastHeartbeat = millis();
     
     // Sẵn sàng
@@ -104,35 +827,112 @@ void setup() {
 }
 
 void loop() {
+    uint32_t loopStart = micros();
+    
     // Kiểm tra kết nối WiFi
     wifiHandler.checkConnection();
     
-    // Gửi heartbeat định kỳ
-    if (millis() - lastHeartbeat > HEARTBEAT_INTERVAL) {
-        DEBUG_PRINTLN("[HEARTBEAT] Sending...");
-        if (apiClient.sendHeartbeat()) {
-            DEBUG_PRINTLN("[HEARTBEAT] OK");
+    #if EVENT_STREAM_ENABLED
+    // Client WebSocket của app: handshake, gửi dữ liệu chờ, ping
+    eventStream.service();
+    #endif
+    
+    // Xếp heartbeat định kỳ vào hàng đợi (không chặn loop)
+    if (millis() - lastHeartbeat > stationParams.get(PARAM_HEARTBEAT_INTERVAL)) {
+        if (requestScheduler.requestHeartbeat()) {
+            DEBUG_PRINTLN("[HEARTBEAT] Queued");
         } else {
-            DEBUG_PRINTLN("[HEARTBEAT] Failed");
+            DEBUG_PRINTLN("[HEARTBEAT] Skipped (recent scan)");
         }
+        requestScheduler.printStats();
+        clockSync.printStats();
+        backendDiscovery.printStats();
+        #if API_TLS_ENABLED
+        apiClient.getTls().printStats();
+        #endif
+        rfidReaders.printStats();
+        #if USB_SCANNER_ENABLED
+        usbBarcodeScanner.printStats();
+        #endif
+        lcdHandler.printStats();
+        #if EVENT_STREAM_ENABLED
+        eventStream.printStats();
+        #endif
+        stationParams.printStats();
+        #if INVENTORY_ENABLED
+        inventorySession.printStats();
+        #endif
+        #if OTA_ENABLED
+        otaUpdater.printStats();
+        #endif
+        heapMonitor.printReport();
         lastHeartbeat = millis();
     }
     
+    // Lệnh qua Serial (tham số, ghi thẻ, kiểm kê)
+    handleSerialCommand();
+    
+    #if INVENTORY_ENABLED
+    // UID mới gửi ở nền theo lô, kể cả sau khi phiên kết thúc
+    if (inventorySession.shouldUpload(millis())) {
+        requestScheduler.requestInventoryUpload();
+    }
+    if (inventorySession.isActive()) {
+        serviceInventory();
+        stationMetrics.observeLoop(micros() - loopStart);
+        // Không nghỉ theo rfid_scan_interval_ms, chỉ nhường một tick cho các task khác
+        delay(1);
+        return;
+    }
+    #endif
+    
+    #if CARD_DATA_MODE
+    // Kết quả xác nhận ghi thẻ từ server
+    static StudentInfo confirmation;
+    if (requestScheduler.pollStudentResult(confirmation)) {
+        handleStudentConfirmation(confirmation);
+    }
+    #endif
+    
+    // Chuyển từ tên sinh viên sang tóm tắt phiếu mượn
+    if (loanSummaryPending && (millis() - lastDisplayUpdate > LOAN_SUMMARY_DELAY)) {
+        loanSummaryPending = false;
+        lcdHandler.displayLoanSummary(loanSession.getLoanCount(), loanSession.getOverdueCount());
+    }
+    
     // Reset display sau timeout
-    if (isProcessing && (millis() - lastDisplayUpdate > LCD_DISPLAY_TIMEOUT)) {
+    if (isProcessing && (millis() - lastDisplayUpdate > stationParams.get(PARAM_LCD_DISPLAY_TIMEOUT))) {
         isProcessing = false;
         lcdHandler.displayReady();
         DEBUG_PRINTLN("[SYSTEM] Ready for next scan");
     }
     
-    // Kiểm tra nút quét barcode (sẽ implement sau khi có camera)
-    int buttonState = digitalRead(SCAN_BUTTON_PIN);
-    if (buttonState != lastButtonState) {
+    #if OTA_ENABLED
+    // Firmware mới đã ghi và kiểm tra: khởi động lại khi không có ai đang mượn/trả và mọi lần
+    // quét đã tới server (hàng đợi gửi lại trống), để không mất lần quét nào
+    if (otaUpdater.isRestartPending() && !isProcessing && !loanSummaryPending && !loanSession.isActive() &&
+        requestScheduler.getPendingCount(PRIORITY_SCAN) == 0 && requestScheduler.getPendingCount(PRIORITY_REPLAY) == 0) {
+        DEBUG_PRINTLN("[OTA] Restarting into new firmware");
+        lcdHandler.displayText("Cap nhat xong", "Khoi dong lai...");
+        delay(1000);
+        ESP.restart();
+    }
+    #endif
+    
+    // Nút BOOT: nhấn ngắn = quét barcode bằng camera (sẽ implement sau khi có camera),
+    // giữ BENCH_LONG_PRESS_MS = tự kiểm tra. Nhấn ngắn xử lý lúc nhả để phân biệt với giữ
+    int reading = digitalRead(SCAN_BUTTON_PIN);
+    if (reading != lastButtonState) {
         lastDebounceTime = millis();
     }
+    lastButtonState = reading;
     
-    if ((millis() - lastDebounceTime) > BUTTON_DEBOUNCE_MS) {
-        if (buttonState == LOW && lastButtonState == HIGH && !isProcessing) {
+    if ((millis() - lastDebounceTime) > BUTTON_DEBOUNCE_MS && reading != buttonState) {
+        buttonState = reading;
+        if (buttonState == LOW) {
+            buttonPressedAt = millis();
+            longPressHandled = false;
+        } else if (!longPressHandled && !isProcessing) {
             DEBUG_PRINTLN("[BUTTON] Scan button pressed");
             lcdHandler.displayText("Quet barcode", "Chua ho tro");
             delay(2000);
@@ -140,70 +940,30 @@ void loop() {
             // TODO: Implement camera barcode scan
         }
     }
-    lastButtonState = buttonState;
+    #if SELF_BENCH_ENABLED
+    if (buttonState == LOW && !longPressHandled && millis() - buttonPressedAt >= BENCH_LONG_PRESS_MS) {
+        longPressHandled = true;
+        DEBUG_PRINTLN("[BUTTON] Long press: self-benchmark");
+        runSelfBenchmark();
+    }
+    #endif
     
-    // Kiểm tra thẻ RFID
-    if (!isProcessing && rfidHandler.hasNewCard()) {
-        isProcessing = true;
-        
-        // Đọc UID thẻ
-        String cardUID = rfidHandler.readCardUID();
-        DEBUG_PRINT("[RFID] Card detected: ");
-        DEBUG_PRINTLN(cardUID);
-        
-        // Hiển thị đang xử lý
-        lcdHandler.displayProcessing();
-        
-        #ifdef LED_PIN
-        digitalWrite(LED_PIN, HIGH);
-        #endif
-        
-        // Gửi request lên API
-        StudentInfo student = apiClient.scanStudentCard(cardUID);
-        
-        if (student.success) {
-            // Thành công
-            DEBUG_PRINTLN("[API] Student found:");
-            DEBUG_PRINT("  Name: ");
-            DEBUG_PRINTLN(student.name);
-            DEBUG_PRINT("  MSSV: ");
-            DEBUG_PRINTLN(student.mssv);
-            DEBUG_PRINT("  Class: ");
-            DEBUG_PRINTLN(student.className);
-            
-            // Hiển thị thông tin sinh viên
-            lcdHandler.displayStudent(student.name.c_str(), student.mssv.c_str());
-            
-            // Beep success (nếu có buzzer)
-            #ifdef BUZZER_PIN
-            tone(BUZZER_PIN, 1000, 200);
-            #endif
-        } else {
-            // Thất bại
-            DEBUG_PRINT("[API] Error: ");
-            DEBUG_PRINTLN(student.error);
-            
-            lcdHandler.displayError("Khong tim thay");
-            
-            // Beep error (nếu có buzzer)
-            #ifdef BUZZER_PIN
-            for (int i = 0; i < 3; i++) {
-                tone(BUZZER_PIN, 500, 100);
-                delay(150);
-            }
-            #endif
-        }
-        
-        #ifdef LED_PIN
-        digitalWrite(LED_PIN, LOW);
-        #endif
-        
-        // Halt card
-        rfidHandler.haltCard();
-        
-        lastDisplayUpdate = millis();
+    #if USB_SCANNER_ENABLED
+    // Mã từ máy quét USB đã ghép sẵn trong task USB. Không chờ hết thời gian hiển thị như
+    // thẻ: thủ thư quét liên tiếp các sách của một sinh viên, mã chưa xử lý nằm trong hàng đợi
+    char barcode[REQUEST_DATA_LEN];
+    if (usbBarcodeScanner.poll(barcode, sizeof(barcode))) {
+        DEBUG_PRINTF("[USB] Barcode: %s\n", barcode);
+        handleBookScan(barcode);
     }
+    #endif
+    
+    // Kiểm tra thẻ RFID trên các đầu đọc (xoay vòng giữa các làn, mỗi làn giữ lần quét riêng)
+    serviceReaders();
+    
+    // Thời gian xử lý của vòng này (gồm cả chờ server khi quét), không tính delay nghỉ
+    stationMetrics.observeLoop(micros() - loopStart);
     
-    // Small delay
-    delay(100);
+    // Nghỉ giữa hai vòng = nhịp poll RFID (rfid_scan_interval_ms)
+    delay(stationParams.get(PARAM_RFID_SCAN_INTERVAL));
 }
@@ -0,0 +1,104 @@
+#include "metrics_server.h"
+
+MetricsServer::MetricsServer(MetricsCollector collector, uint16_t port)
+    : server(port), collector(collector), taskHandle(nullptr), buffer(nullptr), scrapes(0), lastRenderUs(0) {}
+
+bool MetricsServer::begin() {
+    buffer = (char*)malloc(METRICS_BUFFER_SIZE);
+    if (buffer == nullptr) {
+        DEBUG_PRINTLN("[METRICS] Buffer allocation failed!");
+        return false;
+    }
+    
+    server.begin();
+    
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "metrics", METRICS_TASK_STACK, this,
+                                                 METRICS_TASK_PRIORITY, &taskHandle, METRICS_TASK_CORE);
+    if (created != pdPASS) {
+        DEBUG_PRINTLN("[METRICS] Task creation failed!");
+        return false;
+    }
+    
+    DEBUG_PRINTF("[METRICS] Listening on :%d/metrics\n", METRICS_PORT);
+    return true;
+}
+
+void MetricsServer::taskEntry(void* param) {
+    static_cast<MetricsServer*>(param)->run();
+}
+
+void MetricsServer::run() {
+    for (;;) {
+        WiFiClient client = server.accept();
+        if (client) {
+            handle(client);
+            client.stop();
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(50));
+        }
+    }
+}
+
+bool MetricsServer::readRequestLine(WiFiClient& client, char* line, size_t capacity) {
+    size_t length = 0;
+    uint32_t start = millis();
+    
+    while (millis() - start < METRICS_REQUEST_TIMEOUT && client.connected()) {
+        if (client.available() == 0) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        int c = client.read();
+        if (c == '\n') {
+            line[length] = '\0';
+            return true;
+        }
+        if (c != '\r' && length + 1 < capacity) {
+            line[length++] = (char)c;
+        }
+    }
+    return false;
+}
+
+void MetricsServer::handle(WiFiClient& client) {
+    // Chỉ cần dòng đầu "GET /metrics HTTP/1.1"; header còn lại bỏ qua
+    char line[64];
+    if (!readRequestLine(client, line, sizeof(line))) {
+        return;
+    }
+    
+    if (strncmp(line, "GET /metrics ", 13) != 0 && strcmp(line, "GET /metrics") != 0) {
+        static const char notFound[] = "Not Found\n";
+        respond(client, "404 Not Found", notFound, sizeof(notFound) - 1);
+        return;
+    }
+    
+    uint32_t start = micros();
+    MetricsWriter out(buffer, METRICS_BUFFER_SIZE);
+    collector(out);
+    
+    out.family("station_metrics_scrapes_total", "counter", "Scrapes served by this endpoint");
+    out.sample("station_metrics_scrapes_total", "", (uint64_t)(scrapes + 1));
+    out.family("station_metrics_render_seconds", "gauge", "Time to render the previous scrape");
+    out.sample("station_metrics_render_seconds", "", lastRenderUs / 1e6);
+    
+    if (out.overflowed()) {
+        DEBUG_PRINTLN("[METRICS] Buffer too small, output truncated!");
+    }
+    lastRenderUs = micros() - start;
+    scrapes++;
+    
+    respond(client, "200 OK", buffer, out.length());
+}
+
+void MetricsServer::respond(WiFiClient& client, const char* status, const char* body, size_t length) {
+    char header[160];
+    int headerLength = snprintf(header, sizeof(header),
+                                "HTTP/1.1 %s\r\n"
+                                "Content-Type: text/plain; version=0.0.4\r\n"
+                                "Content-Length: %u\r\n"
+                                "Connection: close\r\n\r\n",
+                                status, (unsigned)length);
+    client.write((const uint8_t*)header, headerLength);
+    client.write((const uint8_t*)body, length);
+}
@@ -0,0 +1,94 @@
+#include "oled_display.h"
+#include <Wire.h>
+
+// Khởi tạo SSD1306 128x64, charge pump nội, addressing mode ngang
+static const uint8_t INIT_SEQUENCE[] = {
+    0xAE,               // Display off
+    0xD5, 0x80,         // Clock divide
+    0xA8, 0x3F,         // Multiplex 64
+    0xD3, 0x00,         // Display offset
+    0x40,               // Start line 0
+    0x8D, 0x14,         // Charge pump on
+    0x20, 0x00,         // Horizontal addressing
+    0xA1,               // Segment remap (cột 127 = SEG0)
+    0xC8,               // COM scan ngược
+    0xDA, 0x12,         // COM pins
+    0x81, 0xCF,         // Contrast
+    0xD9, 0xF1,         // Pre-charge
+    0xDB, 0x40,         // VCOMH
+    0xA4,               // Hiển thị theo RAM
+    0xA6,               // Không đảo màu
+    0xAF                // Display on
+};
+
+OledDisplay::OledDisplay(uint8_t address) : address(address) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool OledDisplay::begin() {
+    Wire.setClock(OLED_I2C_CLOCK);
+    if (!sendCommands(INIT_SEQUENCE, sizeof(INIT_SEQUENCE))) {
+        DEBUG_PRINTLN("[OLED] No ACK from SSD1306");
+        return false;
+    }
+    
+    // Nội dung RAM của panel lúc bật nguồn là ngẫu nhiên
+    framebuffer.clear();
+    framebuffer.invalidate();
+    flush();
+    return true;
+}
+
+void OledDisplay::flush() {
+    uint32_t start = micros();
+    uint32_t bytes = 0;
+    OledSpan span;
+    while (framebuffer.nextSpan(span)) {
+        uint8_t window[] = {0x21, span.start, (uint8_t)(span.end - 1), 0x22, span.page, span.page};
+        bool ok = sendCommands(window, sizeof(window));
+        const uint8_t* data = framebuffer.pageData(span.page);
+        for (uint8_t x = span.start; ok && x < span.end; x += OLED_I2C_CHUNK) {
+            uint8_t length = span.end - x > OLED_I2C_CHUNK ? OLED_I2C_CHUNK : span.end - x;
+            ok = sendData(data + x, length);
+        }
+        if (!ok) {
+            // Không biết panel đã nhận tới đâu: lần sau gửi lại cả trang
+            stats.errors++;
+            framebuffer.invalidate();
+            break;
+        }
+        framebuffer.markShown(span);
+        bytes += OledFramebuffer::i2cBytes(span);
+    }
+    
+    if (bytes == 0) {
+        return;
+    }
+    uint32_t elapsed = micros() - start;
+    stats.frames++;
+    stats.lastFrameUs = elapsed;
+    stats.lastFrameBytes = bytes;
+    stats.totalBytes += bytes;
+    if (elapsed > stats.maxFrameUs) {
+        stats.maxFrameUs = elapsed;
+    }
+}
+
+void OledDisplay::setPower(bool on) {
+    uint8_t command = on ? 0xAF : 0xAE;
+    sendCommands(&command, 1);
+}
+
+bool OledDisplay::sendCommands(const uint8_t* commands, uint8_t count) {
+    Wire.beginTransmission(address);
+    Wire.write((uint8_t)0x00);          // Co = 0, D/C = 0: các byte sau đều là lệnh
+    Wire.write(commands, count);
+    return Wire.endTransmission() == 0;
+}
+
+bool OledDisplay::sendData(const uint8_t* data, uint8_t length) {
+    Wire.beginTransmission(address);
+    Wire.write((uint8_t)0x40);          // D/C = 1: dữ liệu GDDRAM
+    Wire.write(data, length);
+    return Wire.endTransmission() == 0;
+}
@@ -0,0 +1,126 @@
+#include "oled_framebuffer.h"
+#include <string.h>
+
+OledFramebuffer::OledFramebuffer() {
+    memset(buffer, 0, sizeof(buffer));
+    memset(shown, 0, sizeof(shown));
+    invalidate();
+}
+
+void OledFramebuffer::clear() {
+    memset(buffer, 0, sizeof(buffer));
+    dirtyPages = 0xFF;
+}
+
+void OledFramebuffer::invalidate() {
+    dirtyPages = 0xFF;
+    stalePages = 0xFF;
+}
+
+void OledFramebuffer::drawGlyph(uint8_t row, uint8_t col, uint32_t codepoint) {
+    const uint8_t* bitmap = GlyphAtlas::glyph(codepoint);
+    uint8_t page = row * GLYPH_PAGES;
+    uint8_t x = col * GLYPH_WIDTH;
+    for (uint8_t p = 0; p < GLYPH_PAGES; p++) {
+        memcpy(&buffer[page + p][x], bitmap + p * GLYPH_WIDTH, GLYPH_WIDTH);
+        dirtyPages |= 1 << (page + p);
+    }
+}
+
+uint8_t OledFramebuffer::drawRange(uint8_t row, uint8_t col, const char* text, const char* end,
+                                   uint8_t maxChars) {
+    if (row >= OLED_TEXT_ROWS) {
+        return 0;
+    }
+    uint8_t count = 0;
+    while (*text != '\0' && text != end && count < maxChars && col + count < OLED_TEXT_COLS) {
+        drawGlyph(row, col + count, GlyphAtlas::nextCodepoint(text));
+        count++;
+    }
+    return count;
+}
+
+uint8_t OledFramebuffer::drawText(uint8_t row, uint8_t col, const char* text, uint8_t maxChars) {
+    return drawRange(row, col, text, nullptr, maxChars);
+}
+
+uint8_t OledFramebuffer::drawWrapped(uint8_t row, const char* text, uint8_t maxRows) {
+    uint8_t used = 0;
+    while (used < maxRows && row + used < OLED_TEXT_ROWS) {
+        while (*text == ' ') {
+            text++;
+        }
+        if (*text == '\0') {
+            break;
+        }
+    
+        // Lấy tối đa một dòng ký tự, nhớ khoảng trắng cuối cùng để ngắt theo từ
+        const char* scan = text;
+        const char* lastSpace = nullptr;
+        uint8_t count = 0;
+        while (*scan != '\0' && count < OLED_TEXT_COLS) {
+            if (*scan == ' ') {
+                lastSpace = scan;
+            }
+            GlyphAtlas::nextCodepoint(scan);
+            count++;
+        }
+    
+        // Vừa hết từ, hoặc dòng cuối (cắt ngang), hoặc từ dài hơn một dòng
+        const char* lineEnd = scan;
+        bool lastRow = used + 1 == maxRows || row + used + 1 == OLED_TEXT_ROWS;
+        if (*scan != '\0' && *scan != ' ' && lastSpace != nullptr && !lastRow) {
+            lineEnd = lastSpace;
+        }
+        drawRange(row + used, 0, text, lineEnd, OLED_TEXT_COLS);
+        text = lineEnd;
+        used++;
+    }
+    return used;
+}
+
+bool OledFramebuffer::nextSpan(OledSpan& span) {
+    while (dirtyPages != 0) {
+        uint8_t page = 0;
+        while (!(dirtyPages & (1 << page))) {
+            page++;
+        }
+    
+        if (stalePages & (1 << page)) {
+            span = {page, 0, OLED_WIDTH};
+            return true;
+        }
+    
+        const uint8_t* now = buffer[page];
+        const uint8_t* before = shown[page];
+        int first = 0;
+        while (first < OLED_WIDTH && now[first] == before[first]) {
+            first++;
+        }
+        if (first == OLED_WIDTH) {
+            dirtyPages &= ~(1 << page);
+            continue;
+        }
+        int last = OLED_WIDTH - 1;
+        while (now[last] == before[last]) {
+            last--;
+        }
+        span = {page, (uint8_t)first, (uint8_t)(last + 1)};
+        return true;
+    }
+    return false;
+}
+
+void OledFramebuffer::markShown(const OledSpan& span) {
+    memcpy(&shown[span.page][span.start], &buffer[span.page][span.start], span.end - span.start);
+    dirtyPages &= ~(1 << span.page);
+    stalePages &= ~(1 << span.page);
+}
+
+uint32_t OledFramebuffer::i2cBytes(const OledSpan& span) {
+    // Lệnh đặt vùng: địa chỉ + 0x00 + 6 byte (0x21 cột đầu/cuối, 0x22 trang đầu/cuối);
+    // dữ liệu: mỗi transaction thêm địa chỉ + 0x40
+    uint32_t length = span.end - span.start;
+    uint32_t chunks = (length + OLED_I2C_CHUNK - 1) / OLED_I2C_CHUNK;
+    return 8 + length + 2 * chunks;
+}
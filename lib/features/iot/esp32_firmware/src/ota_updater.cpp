@@ -0,0 +1,252 @@
+#include "ota_updater.h"
+#include <mbedtls/base64.h>
+#include <mbedtls/pk.h>
+
+OtaUpdater otaUpdater;
+
+static const char* MODE_NAMES[OTA_MODE_COUNT] = {"delta", "full"};
+
+bool OtaUpdater::PartitionSource::read(uint32_t offset, uint8_t* buffer, size_t length) {
+    return esp_partition_read(partition, offset, buffer, length) == ESP_OK;
+}
+
+bool OtaUpdater::PartitionSink::begin(uint32_t targetSize) {
+    // esp_ota_begin() xóa đúng số sector cần cho targetSize (OTA_SIZE_UNKNOWN: cả phân vùng)
+    esp_err_t err = esp_ota_begin(partition, targetSize, &handle);
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[OTA] esp_ota_begin failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    open = true;
+    return hashReady && mbedtls_md_starts(&hash) == 0;
+}
+
+bool OtaUpdater::PartitionSink::write(const uint8_t* data, size_t length) {
+    esp_err_t err = esp_ota_write(handle, data, length);
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[OTA] esp_ota_write failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    return mbedtls_md_update(&hash, data, length) == 0;
+}
+
+OtaUpdater::OtaUpdater()
+    : mode(OTA_DELTA), active(false), startedAt(0), downloaded(0), imageSize(0), progressStep(0),
+      signatureLength(0), restartPending(false) {
+    source.partition = nullptr;
+    sink.partition = nullptr;
+    sink.handle = 0;
+    sink.open = false;
+    mbedtls_md_init(&sink.hash);
+    sink.hashReady = mbedtls_md_setup(&sink.hash, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0) == 0;
+    memset(&stats, 0, sizeof(stats));
+    stats.lastResult = "none";
+}
+
+bool OtaUpdater::getRunningBuild(char* hex, size_t capacity) const {
+    esp_app_desc_t description;
+    if (capacity < sizeof(description.app_elf_sha256) * 2 + 1 ||
+        esp_ota_get_partition_description(esp_ota_get_running_partition(), &description) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(description.app_elf_sha256); i++) {
+        snprintf(hex + i * 2, 3, "%02x", description.app_elf_sha256[i]);
+    }
+    return true;
+}
+
+void OtaUpdater::countCheck(bool upToDate) {
+    stats.checks++;
+    if (upToDate) {
+        stats.upToDate++;
+        stats.lastResult = "up to date";
+    }
+}
+
+bool OtaUpdater::begin(OtaMode updateMode, int32_t size, const char* signatureBase64) {
+    if (restartPending) {
+        return false;
+    }
+    // Chưa có chữ ký thì không xóa phân vùng đích, không tải
+    size_t encodedLength = signatureBase64 != nullptr ? strlen(signatureBase64) : 0;
+    if (encodedLength == 0 ||
+        mbedtls_base64_decode(signature, sizeof(signature), &signatureLength, (const unsigned char*)signatureBase64,
+                              encodedLength) != 0) {
+        DEBUG_PRINTLN("[OTA] Missing or malformed X-Firmware-Signature, update refused");
+        stats.modes[updateMode].failures++;
+        stats.lastResult = "unsigned";
+        return false;
+    }
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+    if (running == nullptr || next == nullptr) {
+        DEBUG_PRINTLN("[OTA] No OTA partition!");
+        stats.lastResult = "no partition";
+        return false;
+    }
+    
+    mode = updateMode;
+    source.partition = running;
+    sink.partition = next;
+    sink.open = false;
+    downloaded = 0;
+    progressStep = 0;
+    startedAt = millis();
+    active = true;
+    
+    if (mode == OTA_DELTA) {
+        // Kích thước ảnh lấy từ header bản vá; sink chỉ mở sau khi ảnh nguồn đã khớp
+        imageSize = 0;
+        stats.lastDelta = DELTA_RUNNING;
+        patcher.begin(source, sink);
+    } else {
+        imageSize = size > 0 ? (uint32_t)size : 0;
+        if (!sink.begin(imageSize > 0 ? imageSize : OTA_SIZE_UNKNOWN)) {
+            fail("erase failed");
+            return false;
+        }
+    }
+    DEBUG_PRINTF("[OTA] %s update: %s -> %s\n", MODE_NAMES[mode], running->label, next->label);
+    return true;
+}
+
+bool OtaUpdater::write(const uint8_t* data, size_t length) {
+    if (!active) {
+        return false;
+    }
+    downloaded += length;
+    
+    uint32_t written;
+    if (mode == OTA_DELTA) {
+        DeltaStatus status = patcher.feed(data, length);
+        if (status != DELTA_RUNNING && status != DELTA_DONE) {
+            return false;
+        }
+        if (imageSize == 0 && sink.open) {
+            // Header đã đọc và SHA-256 ảnh đang chạy đã khớp
+            stats.modes[mode].verifyMs = millis() - startedAt;
+        }
+        imageSize = patcher.getHeader().targetSize;
+        written = patcher.getWritten();
+    } else {
+        if (!sink.write(data, length)) {
+            return false;
+        }
+        written = downloaded;
+    }
+    logProgress(written, imageSize);
+    return true;
+}
+
+bool OtaUpdater::finish(int received) {
+    if (!active) {
+        return false;
+    }
+    OtaModeStats& modeStats = stats.modes[mode];
+    
+    if (mode == OTA_DELTA) {
+        stats.lastDelta = patcher.getStatus();
+        if (stats.lastDelta != DELTA_DONE) {
+            // Bản vá lỗi giữa chừng thì SHA-256 chưa kiểm tra được: không bao giờ khởi động ảnh dở
+            DEBUG_PRINTF("[OTA] Patch failed: %s after %u bytes\n", DeltaPatcher::statusName(stats.lastDelta),
+                         patcher.getPatchBytes());
+            fail(DeltaPatcher::statusName(stats.lastDelta));
+            return false;
+        }
+    } else if (received <= 0 || (imageSize > 0 && downloaded != imageSize)) {
+        DEBUG_PRINTF("[OTA] Download incomplete: %u/%u bytes (%d)\n", downloaded, imageSize, received);
+        fail("download failed");
+        return false;
+    }
+    
+    // esp_ota_end() kiểm tra header ảnh ESP32 và SHA-256 nối cuối ảnh
+    esp_err_t err = esp_ota_end(sink.handle);
+    sink.open = false;
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[OTA] Image invalid: %s\n", esp_err_to_name(err));
+        fail("image invalid");
+        return false;
+    }
+    if (!verifySignature()) {
+        // Ảnh đã ghi nhưng phân vùng khởi động giữ nguyên: trạm vẫn chạy bản cũ
+        fail("bad signature");
+        return false;
+    }
+    err = esp_ota_set_boot_partition(sink.partition);
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[OTA] Set boot partition failed: %s\n", esp_err_to_name(err));
+        fail("set boot failed");
+        return false;
+    }
+    
+    active = false;
+    modeStats.updates++;
+    modeStats.downloadBytes += downloaded;
+    modeStats.imageBytes += mode == OTA_DELTA ? patcher.getWritten() : downloaded;
+    modeStats.lastMs = millis() - startedAt;
+    stats.lastResult = "restart pending";
+    restartPending = true;
+    DEBUG_PRINTF("[OTA] %s update ok: %u bytes downloaded, image %u bytes, %ums\n", MODE_NAMES[mode], downloaded,
+                 mode == OTA_DELTA ? patcher.getWritten() : downloaded, modeStats.lastMs);
+    return true;
+}
+
+bool OtaUpdater::verifySignature() {
+    #if OTA_ENABLED
+    uint8_t digest[DELTA_HASH_LEN];
+    if (mbedtls_md_finish(&sink.hash, digest) != 0) {
+        return false;
+    }
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    // Độ dài PEM tính cả '\0' cuối
+    int ret = mbedtls_pk_parse_public_key(&key, (const unsigned char*)OTA_SIGNING_PUBKEY, sizeof(OTA_SIGNING_PUBKEY));
+    if (ret == 0) {
+        ret = mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, signatureLength);
+    }
+    mbedtls_pk_free(&key);
+    if (ret != 0) {
+        DEBUG_PRINTF("[OTA] Signature check failed: -0x%04x\n", -ret);
+        return false;
+    }
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+void OtaUpdater::fail(const char* result) {
+    if (sink.open) {
+        esp_ota_abort(sink.handle);
+        sink.open = false;
+    }
+    active = false;
+    stats.modes[mode].failures++;
+    stats.modes[mode].downloadBytes += downloaded;
+    stats.lastResult = result;
+}
+
+void OtaUpdater::logProgress(uint32_t written, uint32_t total) {
+    if (total == 0) {
+        return;
+    }
+    uint8_t step = (uint8_t)((uint64_t)written * 10 / total);
+    if (step > progressStep) {
+        progressStep = step;
+        DEBUG_PRINTF("[OTA] %u%% (%u/%u bytes, %u downloaded)\n", step * 10, written, total, downloaded);
+    }
+}
+
+void OtaUpdater::printStats() const {
+    DEBUG_PRINTF("[OTA] checks=%u up_to_date=%u last=%s delta_status=%s%s\n", stats.checks, stats.upToDate,
+                 stats.lastResult, DeltaPatcher::statusName(stats.lastDelta), restartPending ? " RESTART PENDING" : "");
+    for (uint8_t i = 0; i < OTA_MODE_COUNT; i++) {
+        const OtaModeStats& modeStats = stats.modes[i];
+        if (modeStats.updates == 0 && modeStats.failures == 0) {
+            continue;
+        }
+        DEBUG_PRINTF("[OTA] %s: ok=%u failed=%u downloaded=%u image=%u last=%ums verify=%ums\n", MODE_NAMES[i],
+                     modeStats.updates, modeStats.failures, modeStats.downloadBytes, modeStats.imageBytes,
+                     modeStats.lastMs, modeStats.verifyMs);
+    }
+}
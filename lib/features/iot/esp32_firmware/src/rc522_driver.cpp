@@ -0,0 +1,546 @@
+#include "rc522_driver.h"
+#include <string.h>
+
+// Thanh ghi RC522 (địa chỉ chưa dịch bit)
+enum : uint8_t {
+    REG_COMMAND = 0x01,
+    REG_COM_IRQ = 0x04,
+    REG_ERROR = 0x06,
+    REG_STATUS2 = 0x08,
+    REG_FIFO_DATA = 0x09,
+    REG_FIFO_LEVEL = 0x0A,
+    REG_CONTROL = 0x0C,
+    REG_BIT_FRAMING = 0x0D,
+    REG_COLL = 0x0E,
+    REG_MODE = 0x11,
+    REG_TX_MODE = 0x12,
+    REG_RX_MODE = 0x13,
+    REG_TX_CONTROL = 0x14,
+    REG_TX_ASK = 0x15,
+    REG_MOD_WIDTH = 0x24,
+    REG_T_MODE = 0x2A,
+    REG_T_PRESCALER = 0x2B,
+    REG_T_RELOAD_H = 0x2C,
+    REG_T_RELOAD_L = 0x2D,
+    REG_VERSION = 0x37
+};
+
+// Lệnh của chip
+enum : uint8_t {
+    PCD_IDLE = 0x00,
+    PCD_TRANSCEIVE = 0x0C,
+    PCD_MF_AUTHENT = 0x0E,
+    PCD_SOFT_RESET = 0x0F
+};
+
+// Lệnh ISO 14443 / MIFARE
+enum : uint8_t {
+    PICC_REQA = 0x26,
+    PICC_SEL_CL1 = 0x93,
+    PICC_HLTA = 0x50,
+    PICC_AUTH_KEY_A = 0x60,
+    PICC_READ = 0x30,
+    PICC_WRITE = 0xA0,
+    PICC_UL_WRITE = 0xA2
+};
+
+#define IRQ_TIMER 0x01
+#define IRQ_IDLE 0x10
+#define IRQ_RX 0x20
+#define ERROR_COLL 0x08
+#define COLL_POS_NOT_VALID 0x20
+#define ERROR_FATAL 0x13          // BufferOvfl | ParityErr | ProtocolErr
+#define STATUS2_CRYPTO1_ON 0x08
+#define MIFARE_ACK 0x0A
+
+static constexpr uint8_t writeAddress(uint8_t reg) { return (reg << 1) & 0x7E; }
+static constexpr uint8_t readAddress(uint8_t reg) { return writeAddress(reg) | 0x80; }
+
+Rc522Driver::Rc522Driver(Rc522Bus& bus)
+    : bus(bus), frameCount(0), txUsed(0), step(STEP_NONE), waitIrq(0), statusPolls(0),
+      responseLength(0), responseLastBits(0), collisionPos(0), crypto1On(false),
+      stage(STAGE_IDLE), cascadeLevel(0), knownBits(0), uidLength(0), sak(0), collisions(0) {
+}
+
+// ============================================
+// Gom frame
+// ============================================
+
+void Rc522Driver::resetBatch() {
+    frameCount = 0;
+    txUsed = 0;
+}
+
+void Rc522Driver::addWrite(uint8_t reg, uint8_t value) {
+    uint8_t* frame = tx + txUsed;
+    frame[0] = writeAddress(reg);
+    frame[1] = value;
+    frames[frameCount++] = {frame, nullptr, 2};
+    txUsed += 2;
+}
+
+void Rc522Driver::addFifoWrite(const uint8_t* data, uint8_t length) {
+    // Mọi byte sau địa chỉ trong cùng frame đều ghi vào FIFODataReg
+    uint8_t* frame = tx + txUsed;
+    frame[0] = writeAddress(REG_FIFO_DATA);
+    memcpy(frame + 1, data, length);
+    frames[frameCount++] = {frame, nullptr, (uint8_t)(length + 1)};
+    txUsed += length + 1;
+}
+
+void Rc522Driver::submitBatch() {
+    // Bus chỉ từ chối khi còn batch cũ chưa xong
+    while (!bus.submit(frames, frameCount)) {
+        bus.done();
+    }
+}
+
+void Rc522Driver::waitBus() {
+    while (!bus.done()) {
+    }
+}
+
+void Rc522Driver::writeRegister(uint8_t reg, uint8_t value) {
+    resetBatch();
+    addWrite(reg, value);
+    submitBatch();
+    waitBus();
+}
+
+uint8_t Rc522Driver::readRegister(uint8_t reg) {
+    resetBatch();
+    tx[0] = readAddress(reg);
+    tx[1] = 0x00;
+    frames[frameCount++] = {tx, rx, 2};
+    submitBatch();
+    waitBus();
+    return rx[1];
+}
+
+uint8_t Rc522Driver::init() {
+    writeRegister(REG_COMMAND, PCD_SOFT_RESET);
+    
+    // Chờ bit PowerDown tắt (dao động thạch anh ổn định)
+    for (uint16_t i = 0; i < RC522_MAX_STATUS_POLLS; i++) {
+        if ((readRegister(REG_COMMAND) & 0x10) == 0) {
+            break;
+        }
+    }
+    
+    uint8_t version = readRegister(REG_VERSION);
+    if (version == 0x00 || version == 0xFF) {
+        return version;
+    }
+    
+    // Cấu hình giống thư viện MFRC522, gửi trong 2 batch thay vì 11 lần CS
+    resetBatch();
+    addWrite(REG_TX_MODE, 0x00);          // 106 kbit/s, không CRC phần cứng
+    addWrite(REG_RX_MODE, 0x00);
+    addWrite(REG_MOD_WIDTH, 0x26);
+    addWrite(REG_T_MODE, 0x80);           // TAuto: timer chạy ngay khi gửi xong
+    addWrite(REG_T_PRESCALER, 0xA9);      // 40 kHz → 25 µs mỗi tick
+    addWrite(REG_T_RELOAD_H, 0x03);       // 1000 tick = 25 ms
+    addWrite(REG_T_RELOAD_L, 0xE8);
+    addWrite(REG_TX_ASK, 0x40);           // 100% ASK
+    submitBatch();
+    waitBus();
+    
+    resetBatch();
+    addWrite(REG_MODE, 0x3D);             // CRC preset 0x6363
+    addWrite(REG_COLL, 0x00);             // ValuesAfterColl = 0
+    addWrite(REG_TX_CONTROL, 0x83);       // Bật antenna (Tx1RFEn, Tx2RFEn)
+    submitBatch();
+    waitBus();
+    
+    stage = STAGE_IDLE;
+    step = STEP_NONE;
+    return version;
+}
+
+void Rc522Driver::setResponseTimeout(uint32_t microseconds) {
+    uint32_t ticks = microseconds / 25;   // Prescaler 0xA9: 25 µs mỗi tick
+    if (ticks == 0) {
+        ticks = 1;
+    } else if (ticks > 0xFFFF) {
+        ticks = 0xFFFF;
+    }
+    resetBatch();
+    addWrite(REG_T_RELOAD_H, ticks >> 8);
+    addWrite(REG_T_RELOAD_L, ticks & 0xFF);
+    submitBatch();
+    waitBus();
+}
+
+uint8_t Rc522Driver::readVersion() {
+    return readRegister(REG_VERSION);
+}
+
+// ============================================
+// Một lệnh tới thẻ
+// ============================================
+
+void Rc522Driver::beginExchange(uint8_t command, const uint8_t* data, uint8_t length, uint8_t bitFraming) {
+    resetBatch();
+    addWrite(REG_COMMAND, PCD_IDLE);
+    addWrite(REG_COM_IRQ, 0x7F);          // Xóa cờ ngắt
+    addWrite(REG_FIFO_LEVEL, 0x80);       // Xóa FIFO
+    addFifoWrite(data, length);
+    addWrite(REG_BIT_FRAMING, bitFraming);
+    addWrite(REG_COMMAND, command);
+    if (command == PCD_TRANSCEIVE) {
+        addWrite(REG_BIT_FRAMING, 0x80 | bitFraming);   // StartSend
+    }
+    submitBatch();
+    
+    waitIrq = command == PCD_TRANSCEIVE ? (IRQ_RX | IRQ_IDLE) : IRQ_IDLE;
+    statusPolls = 0;
+    responseLength = 0;
+    step = STEP_COMMAND;
+}
+
+void Rc522Driver::submitStatusRead() {
+    // Đọc 5 thanh ghi trong một frame: mỗi byte địa chỉ trả về giá trị ở byte kế tiếp
+    static const uint8_t addresses[6] = {
+        readAddress(REG_COM_IRQ), readAddress(REG_ERROR), readAddress(REG_FIFO_LEVEL),
+        readAddress(REG_CONTROL), readAddress(REG_STATUS2), 0x00
+    };
+    resetBatch();
+    memcpy(tx, addresses, sizeof(addresses));
+    frames[frameCount++] = {tx, rx, sizeof(addresses)};
+    submitBatch();
+}
+
+Rc522Driver::Result Rc522Driver::stepExchange() {
+    if (!bus.done()) {
+        return EX_BUSY;
+    }
+    
+    switch (step) {
+        case STEP_COMMAND:
+            submitStatusRead();
+            step = STEP_STATUS;
+            return EX_BUSY;
+    
+        case STEP_STATUS: {
+            uint8_t irq = rx[1];
+            uint8_t error = rx[2];
+            uint8_t level = rx[3] & 0x7F;
+            responseLastBits = rx[4] & 0x07;
+            crypto1On = (rx[5] & STATUS2_CRYPTO1_ON) != 0;
+    
+            if (irq & waitIrq) {
+                if (level > RC522_FIFO_SIZE) {
+                    level = RC522_FIFO_SIZE;
+                }
+                if ((error & ERROR_FATAL) ||
+                    ((error & ERROR_COLL) && stage != STAGE_REQA && stage != STAGE_ANTICOLL)) {
+                    step = STEP_NONE;
+                    return EX_ERROR;
+                }
+                if (error & ERROR_COLL) {
+                    // Nhiều thẻ cùng trả lời: đọc CollReg và các bit trước chỗ va chạm trong một frame
+                    resetBatch();
+                    tx[0] = readAddress(REG_COLL);
+                    memset(tx + 1, readAddress(REG_FIFO_DATA), level);
+                    tx[level + 1] = 0x00;
+                    frames[frameCount++] = {tx, rx, (uint8_t)(level + 2)};
+                    submitBatch();
+                    responseLength = level;
+                    step = STEP_COLLISION;
+                    return EX_BUSY;
+                }
+                if (level == 0) {
+                    step = STEP_NONE;
+                    return EX_OK;
+                }
+    
+                // Đọc cả FIFO trong một frame
+                resetBatch();
+                memset(tx, readAddress(REG_FIFO_DATA), level);
+                tx[level] = 0x00;
+                frames[frameCount++] = {tx, rx, (uint8_t)(level + 1)};
+                submitBatch();
+                responseLength = level;
+                step = STEP_FIFO;
+                return EX_BUSY;
+            }
+            if ((irq & IRQ_TIMER) || ++statusPolls >= RC522_MAX_STATUS_POLLS) {
+                step = STEP_NONE;
+                return EX_TIMEOUT;
+            }
+            submitStatusRead();
+            return EX_BUSY;
+        }
+    
+        case STEP_FIFO:
+            memcpy(response, rx + 1, responseLength);
+            step = STEP_NONE;
+            return EX_OK;
+    
+        case STEP_COLLISION:
+            step = STEP_NONE;
+            if (rx[1] & COLL_POS_NOT_VALID) {
+                return EX_ERROR;
+            }
+            collisionPos = rx[1] & 0x1F;
+            memcpy(response, rx + 2, responseLength);
+            return EX_COLLISION;
+    
+        default:
+            return EX_ERROR;
+    }
+}
+
+Rc522Driver::Result Rc522Driver::runExchange(uint8_t command, const uint8_t* data, uint8_t length,
+                                             uint8_t txLastBits) {
+    beginExchange(command, data, length, txLastBits);
+    Result result;
+    while ((result = stepExchange()) == EX_BUSY) {
+    }
+    return result;
+}
+
+Rc522Driver::Result Rc522Driver::transceiveWithCrc(uint8_t* data, uint8_t length) {
+    // data phải còn chỗ cho 2 byte CRC
+    crcA(data, length, data + length);
+    return runExchange(PCD_TRANSCEIVE, data, length + 2, 0);
+}
+
+bool Rc522Driver::isAck() const {
+    return responseLength == 1 && responseLastBits == 4 && (response[0] & 0x0F) == MIFARE_ACK;
+}
+
+void Rc522Driver::crcA(const uint8_t* data, uint8_t length, uint8_t output[2]) {
+    uint16_t crc = 0x6363;
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t b = data[i] ^ (uint8_t)(crc & 0xFF);
+        b ^= b << 4;
+        crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+    }
+    output[0] = crc & 0xFF;
+    output[1] = crc >> 8;
+}
+
+// ============================================
+// Phát hiện thẻ (không chặn)
+// ============================================
+
+Rc522Poll Rc522Driver::service() {
+    Result result;
+    
+    switch (stage) {
+        case STAGE_IDLE: {
+            static const uint8_t reqa = PICC_REQA;
+            uidLength = 0;
+            cascadeLevel = 0;
+            beginExchange(PCD_TRANSCEIVE, &reqa, 1, 7);   // REQA là frame ngắn 7 bit
+            stage = STAGE_REQA;
+            return RC522_BUSY;
+        }
+    
+        case STAGE_REQA:
+            result = stepExchange();
+            if (result == EX_BUSY) {
+                return RC522_BUSY;
+            }
+            // Va chạm ở ATQA (thẻ khác loại cùng trả lời) vẫn là có thẻ: anticollision sẽ tách
+            if (result != EX_COLLISION && (result != EX_OK || responseLength != 2)) {
+                return finishStep(result == EX_TIMEOUT ? RC522_NO_CARD : RC522_ERROR);
+            }
+            return beginSelectLevel();
+    
+        case STAGE_ANTICOLL: {
+            result = stepExchange();
+            if (result == EX_BUSY) {
+                return RC522_BUSY;
+            }
+            if ((result != EX_OK && result != EX_COLLISION) || responseLength == 0 ||
+                knownBits / 8 + responseLength > sizeof(levelBytes)) {
+                return finishStep(RC522_ERROR);
+            }
+    
+            // Ghép phần thẻ trả lời vào sau các bit đã biết (byte đầu bắt đầu ở bit RxAlign)
+            uint8_t index = knownBits / 8;
+            uint8_t keep = (1 << (knownBits % 8)) - 1;
+            levelBytes[index] = (levelBytes[index] & keep) | (response[0] & ~keep);
+            memcpy(levelBytes + index + 1, response + 1, responseLength - 1);
+    
+            if (result == EX_COLLISION) {
+                // CollPos tính từ bit đầu của byte FIFO đầu tiên, 0 = bit thứ 32
+                uint8_t position = index * 8 + (collisionPos == 0 ? 32 : collisionPos);
+                if (position <= knownBits || position > 32) {
+                    return finishStep(RC522_ERROR);
+                }
+                // Chọn nhánh bit 1 tại chỗ va chạm; chỉ thẻ khớp tiền tố trả lời lần sau
+                levelBytes[(position - 1) / 8] |= 1 << ((position - 1) % 8);
+                knownBits = position;
+                collisions++;
+                if (knownBits < 32) {
+                    return sendAnticollision();
+                }
+                levelBytes[4] = levelBytes[0] ^ levelBytes[1] ^ levelBytes[2] ^ levelBytes[3];
+            } else if (index + responseLength != 5 ||
+                       (levelBytes[0] ^ levelBytes[1] ^ levelBytes[2] ^ levelBytes[3]) != levelBytes[4]) {
+                return finishStep(RC522_ERROR);
+            }
+    
+            // SELECT: SEL, NVB = 0x70, 4 byte + BCC, CRC_A
+            uint8_t select[9];
+            select[0] = PICC_SEL_CL1 + 2 * cascadeLevel;
+            select[1] = 0x70;
+            memcpy(select + 2, levelBytes, 5);
+            crcA(select, 7, select + 7);
+            beginExchange(PCD_TRANSCEIVE, select, sizeof(select), 0);
+            stage = STAGE_SELECT;
+            return RC522_BUSY;
+        }
+    
+        case STAGE_SELECT: {
+            result = stepExchange();
+            if (result == EX_BUSY) {
+                return RC522_BUSY;
+            }
+            uint8_t crc[2];
+            crcA(response, 1, crc);
+            if (result != EX_OK || responseLength != 3 || crc[0] != response[1] || crc[1] != response[2]) {
+                return finishStep(RC522_ERROR);
+            }
+            sak = response[0];
+    
+            // Bit cascade: UID còn tiếp ở mức sau, byte đầu mức này là CT (0x88)
+            if (sak & 0x04) {
+                memcpy(uidBytes + uidLength, levelBytes + 1, 3);
+                uidLength += 3;
+                cascadeLevel++;
+                if (cascadeLevel > 2) {
+                    return finishStep(RC522_ERROR);
+                }
+                return beginSelectLevel();
+            }
+            memcpy(uidBytes + uidLength, levelBytes, 4);
+            uidLength += 4;
+            return finishStep(RC522_CARD);
+        }
+    
+        case STAGE_HALT:
+            // Thẻ không trả lời HLTA, timeout là bình thường
+            if (stepExchange() == EX_BUSY) {
+                return RC522_BUSY;
+            }
+            resetBatch();
+            addWrite(REG_STATUS2, 0x00);      // Tắt Crypto1 sau HLTA (đã mã hóa nếu đang xác thực)
+            submitBatch();
+            stage = STAGE_STOP_CRYPTO;
+            return RC522_BUSY;
+    
+        case STAGE_STOP_CRYPTO:
+            if (!bus.done()) {
+                return RC522_BUSY;
+            }
+            crypto1On = false;
+            stage = STAGE_IDLE;
+            return RC522_NO_CARD;
+    }
+    
+    return RC522_ERROR;
+}
+
+Rc522Poll Rc522Driver::beginSelectLevel() {
+    knownBits = 0;
+    memset(levelBytes, 0, sizeof(levelBytes));
+    return sendAnticollision();
+}
+
+Rc522Poll Rc522Driver::sendAnticollision() {
+    // ANTICOLLISION: SEL, NVB (số byte << 4 | số bit lẻ), các bit đã biết.
+    // Không có va chạm thì chỉ là "SEL 20"
+    uint8_t fullBytes = knownBits / 8;
+    uint8_t extraBits = knownBits % 8;
+    uint8_t sendBytes = fullBytes + (extraBits != 0 ? 1 : 0);
+    uint8_t anticoll[6];
+    anticoll[0] = PICC_SEL_CL1 + 2 * cascadeLevel;
+    anticoll[1] = ((2 + fullBytes) << 4) | extraBits;
+    memcpy(anticoll + 2, levelBytes, sendBytes);
+    beginExchange(PCD_TRANSCEIVE, anticoll, 2 + sendBytes, (extraBits << 4) | extraBits);
+    stage = STAGE_ANTICOLL;
+    return RC522_BUSY;
+}
+
+Rc522Poll Rc522Driver::finishStep(Rc522Poll result) {
+    stage = STAGE_IDLE;
+    return result;
+}
+
+void Rc522Driver::halt() {
+    if (stage != STAGE_IDLE) {
+        return;
+    }
+    uint8_t hlta[4] = {PICC_HLTA, 0x00};
+    crcA(hlta, 2, hlta + 2);
+    beginExchange(PCD_TRANSCEIVE, hlta, sizeof(hlta), 0);
+    stage = STAGE_HALT;
+}
+
+// ============================================
+// PiccTransport (thẻ đã được chọn)
+// ============================================
+
+PiccKind Rc522Driver::kind() {
+    // Giống MFRC522::PICC_GetType
+    switch (sak & 0x7F) {
+        case 0x09:
+        case 0x08:
+        case 0x18:
+            return PICC_KIND_MIFARE_CLASSIC;
+        case 0x00:
+            return PICC_KIND_NTAG;
+        default:
+            return PICC_KIND_UNKNOWN;
+    }
+}
+
+const uint8_t* Rc522Driver::uid(uint8_t& length) {
+    length = uidLength;
+    return uidBytes;
+}
+
+bool Rc522Driver::authenticate(uint8_t block, const uint8_t key[6]) {
+    // MFAuthent: lệnh, block, key, 4 byte cuối của UID
+    uint8_t data[12];
+    data[0] = PICC_AUTH_KEY_A;
+    data[1] = block;
+    memcpy(data + 2, key, 6);
+    memcpy(data + 8, uidBytes + uidLength - 4, 4);
+    return runExchange(PCD_MF_AUTHENT, data, sizeof(data), 0) == EX_OK && crypto1On;
+}
+
+bool Rc522Driver::read16(uint8_t block, uint8_t output[16]) {
+    uint8_t command[4] = {PICC_READ, block};
+    if (transceiveWithCrc(command, 2) != EX_OK || responseLength != 18) {
+        return false;
+    }
+    uint8_t crc[2];
+    crcA(response, 16, crc);
+    if (crc[0] != response[16] || crc[1] != response[17]) {
+        return false;
+    }
+    memcpy(output, response, 16);
+    return true;
+}
+
+bool Rc522Driver::writeBlock(uint8_t block, const uint8_t data[16]) {
+    // MIFARE Classic ghi 2 bước: lệnh WRITE → ACK, dữ liệu → ACK
+    uint8_t command[4] = {PICC_WRITE, block};
+    if (transceiveWithCrc(command, 2) != EX_OK || !isAck()) {
+        return false;
+    }
+    uint8_t buffer[18];
+    memcpy(buffer, data, 16);
+    return transceiveWithCrc(buffer, 16) == EX_OK && isAck();
+}
+
+bool Rc522Driver::writePage(uint8_t page, const uint8_t data[4]) {
+    uint8_t command[8] = {PICC_UL_WRITE, page};
+    memcpy(command + 2, data, 4);
+    return transceiveWithCrc(command, 6) == EX_OK && isAck();
+}
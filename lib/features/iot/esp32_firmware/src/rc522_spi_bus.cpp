@@ -0,0 +1,71 @@
+#include "rc522_spi_bus.h"
+
+#define RC522_SPI_HOST SPI2_HOST
+
+Rc522SpiBus::Rc522SpiBus(uint8_t csPin) : csPin(csPin), device(nullptr), inFlight(0) {
+}
+
+bool Rc522SpiBus::beginBus() {
+    spi_bus_config_t config = {};
+    config.mosi_io_num = RFID_MOSI_PIN;
+    config.miso_io_num = RFID_MISO_PIN;
+    config.sclk_io_num = RFID_SCK_PIN;
+    config.quadwp_io_num = -1;
+    config.quadhd_io_num = -1;
+    config.max_transfer_sz = 96;     // Frame dài nhất: đọc cả FIFO 64 byte
+    
+    esp_err_t err = spi_bus_initialize(RC522_SPI_HOST, &config, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        DEBUG_PRINTF("[RFID] SPI bus init failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool Rc522SpiBus::begin() {
+    spi_device_interface_config_t config = {};
+    config.mode = 0;
+    config.clock_speed_hz = RFID_SPI_CLOCK_HZ;
+    config.spics_io_num = csPin;
+    config.queue_size = RC522_MAX_BATCH;
+    
+    esp_err_t err = spi_bus_add_device(RC522_SPI_HOST, &config, &device);
+    if (err != ESP_OK) {
+        DEBUG_PRINTF("[RFID] SPI device (CS %d) failed: %s\n", csPin, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool Rc522SpiBus::submit(const Rc522Frame* frames, uint8_t count) {
+    if (inFlight > 0 || count > RC522_MAX_BATCH) {
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        spi_transaction_t& t = transactions[i];
+        memset(&t, 0, sizeof(t));
+        t.length = frames[i].length * 8;
+        t.tx_buffer = frames[i].tx;
+        t.rx_buffer = frames[i].rx;
+        if (spi_device_queue_trans(device, &t, 0) != ESP_OK) {
+            // Hàng đợi đầy: các frame đã xếp vẫn phải được thu hồi ở done()
+            inFlight = i;
+            return false;
+        }
+    }
+    
+    inFlight = count;
+    return true;
+}
+
+bool Rc522SpiBus::done() {
+    spi_transaction_t* finished;
+    while (inFlight > 0) {
+        if (spi_device_get_trans_result(device, &finished, 0) != ESP_OK) {
+            return false;
+        }
+        inFlight--;
+    }
+    return true;
+}
@@ -0,0 +1,661 @@
+#include "request_scheduler.h"
+#include "backpressure.h"
+#include "station_params.h"
+
+RequestScheduler::RequestScheduler(APIClient& client)
+    : apiClient(client), pending(nullptr), interactiveDone(nullptr), interactiveLock(nullptr),
+      completions(nullptr), taskHandle(nullptr), heartbeatsPiggybacked(0), piggybackStreak(0), lastScanSuccess(0), heartbeatQueued(false),
+      inventoryQueued(false), firmwareQueued(false), batchSupported(true), lastScanArrival(0),
+      scanGapEwmaMs(BATCH_BURST_GAP_MS * 4) {
+    memset(stats, 0, sizeof(stats));
+    memset(&batchStats, 0, sizeof(batchStats));
+    for (uint8_t i = 0; i < PRIORITY_COUNT; i++) {
+        queues[i] = nullptr;
+    }
+}
+
+bool RequestScheduler::begin() {
+    for (uint8_t i = 0; i < PRIORITY_COUNT; i++) {
+        queues[i] = xQueueCreate(REQUEST_QUEUE_SIZE, sizeof(QueuedRequest));
+        if (queues[i] == nullptr) {
+            DEBUG_PRINTLN("[SCHED] Queue allocation failed!");
+            return false;
+        }
+    }
+    
+    completions = xQueueCreate(REQUEST_COMPLETION_QUEUE, sizeof(StudentInfo));
+    if (completions == nullptr) {
+        DEBUG_PRINTLN("[SCHED] Queue allocation failed!");
+        return false;
+    }
+    
+    pending = xSemaphoreCreateCounting(REQUEST_QUEUE_SIZE * PRIORITY_COUNT, 0);
+    interactiveDone = xSemaphoreCreateBinary();
+    interactiveLock = xSemaphoreCreateMutex();
+    if (pending == nullptr || interactiveDone == nullptr || interactiveLock == nullptr) {
+        DEBUG_PRINTLN("[SCHED] Semaphore allocation failed!");
+        return false;
+    }
+    
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "net", REQUEST_TASK_STACK, this,
+                                                 REQUEST_TASK_PRIORITY, &taskHandle, REQUEST_TASK_CORE);
+    if (created != pdPASS) {
+        DEBUG_PRINTLN("[SCHED] Task creation failed!");
+        return false;
+    }
+    
+    DEBUG_PRINTLN("[SCHED] Request scheduler started");
+    return true;
+}
+
+StudentInfo RequestScheduler::scanStudentCard(const char* cardUID, const ScanSource& source,
+                                              const ScanTrace& trace) {
+    StudentInfo result;
+    resetStudentInfo(result);
+    
+    QueuedRequest request = {};
+    request.type = REQUEST_STUDENT_SCAN;
+    request.priority = PRIORITY_SCAN;
+    request.source = source;
+    request.trace = trace;
+    strlcpy(request.data, cardUID, sizeof(request.data));
+    request.result = &result;
+    request.done = interactiveDone;
+    
+    // Chỉ một request tương tác chờ kết quả tại một thời điểm
+    xSemaphoreTake(interactiveLock, portMAX_DELAY);
+    if (enqueue(request)) {
+        xSemaphoreTake(interactiveDone, portMAX_DELAY);
+    } else {
+        strlcpy(result.error, "Request queue full", sizeof(result.error));
+    }
+    xSemaphoreGive(interactiveLock);
+    
+    return result;
+}
+
+bool RequestScheduler::submitStudentCard(const char* cardUID, const ScanSource& source, const ScanTrace& trace) {
+    QueuedRequest request = {};
+    request.type = REQUEST_STUDENT_SCAN;
+    request.priority = PRIORITY_SCAN;
+    request.notify = true;
+    request.source = source;
+    request.trace = trace;
+    strlcpy(request.data, cardUID, sizeof(request.data));
+    
+    return enqueue(request);
+}
+
+bool RequestScheduler::pollStudentResult(StudentInfo& result) {
+    return xQueueReceive(completions, &result, 0) == pdTRUE;
+}
+
+BookInfo RequestScheduler::scanBookBarcode(const char* barcode, const ScanTrace& trace) {
+    BookInfo result;
+    resetBookInfo(result);
+    
+    QueuedRequest request = {};
+    request.type = REQUEST_BOOK_SCAN;
+    request.priority = PRIORITY_SCAN;
+    request.trace = trace;
+    strlcpy(request.data, barcode, sizeof(request.data));
+    request.result = &result;
+    request.done = interactiveDone;
+    
+    xSemaphoreTake(interactiveLock, portMAX_DELAY);
+    if (enqueue(request)) {
+        xSemaphoreTake(interactiveDone, portMAX_DELAY);
+    } else {
+        strlcpy(result.error, "Request queue full", sizeof(result.error));
+    }
+    xSemaphoreGive(interactiveLock);
+    
+    return result;
+}
+
+bool RequestScheduler::requestHeartbeat() {
+    // Request quét thành công gần đây đã báo trạng thái thiết bị cho server. Quầy bận vẫn gửi
+    // heartbeat sau mỗi HEARTBEAT_MAX_PIGGYBACK lần bỏ để nhận cấu hình mới và cờ firmware
+    if (lastScanSuccess != 0 && (millis() - lastScanSuccess < stationParams.get(PARAM_HEARTBEAT_INTERVAL)) &&
+        piggybackStreak < HEARTBEAT_MAX_PIGGYBACK) {
+        piggybackStreak++;
+        heartbeatsPiggybacked++;
+        return false;
+    }
+    piggybackStreak = 0;
+    
+    // Gộp: không xếp thêm heartbeat khi heartbeat trước chưa được gửi
+    if (heartbeatQueued) {
+        return false;
+    }
+    
+    QueuedRequest request = {};
+    request.type = REQUEST_HEARTBEAT;
+    request.priority = PRIORITY_HEARTBEAT;
+    
+    heartbeatQueued = enqueue(request);
+    return heartbeatQueued;
+}
+
+#if INVENTORY_ENABLED
+bool RequestScheduler::requestInventoryUpload() {
+    if (inventoryQueued) {
+        return false;
+    }
+    
+    QueuedRequest request = {};
+    request.type = REQUEST_INVENTORY;
+    request.priority = PRIORITY_HEARTBEAT;
+    
+    inventoryQueued = enqueue(request);
+    return inventoryQueued;
+}
+#endif
+
+#if OTA_ENABLED
+bool RequestScheduler::requestFirmwareUpdate() {
+    if (firmwareQueued || otaUpdater.isRestartPending()) {
+        return false;
+    }
+    
+    QueuedRequest request = {};
+    request.type = REQUEST_FIRMWARE_UPDATE;
+    request.priority = PRIORITY_HEARTBEAT;
+    
+    firmwareQueued = enqueue(request);
+    return firmwareQueued;
+}
+#endif
+
+#if SELF_BENCH_ENABLED
+bool RequestScheduler::runBenchmark(BenchReport& report) {
+    QueuedRequest request = {};
+    request.type = REQUEST_BENCHMARK;
+    request.priority = PRIORITY_HEARTBEAT;
+    request.result = &report;
+    request.done = interactiveDone;
+    
+    xSemaphoreTake(interactiveLock, portMAX_DELAY);
+    bool queued = enqueue(request);
+    if (queued) {
+        xSemaphoreTake(interactiveDone, portMAX_DELAY);
+    }
+    xSemaphoreGive(interactiveLock);
+    return queued;
+}
+#endif
+
+uint32_t RequestScheduler::getPendingCount(RequestPriority priority) const {
+    if (queues[priority] == nullptr) {
+        return 0;
+    }
+    return uxQueueMessagesWaiting(queues[priority]);
+}
+
+void RequestScheduler::printStats() const {
+    static const char* names[PRIORITY_COUNT] = {"scan", "replay", "heartbeat"};
+    
+    for (uint8_t i = 0; i < PRIORITY_COUNT; i++) {
+        const QueueStats& s = stats[i];
+        DEBUG_PRINTF("[SCHED] %-9s served=%u dropped=%u avgWait=%uus maxWait=%uus pending=%u\n",
+                     names[i], s.served, s.dropped,
+                     s.served > 0 ? s.totalWaitUs / s.served : 0, s.maxWaitUs,
+                     getPendingCount((RequestPriority)i));
+    }
+    DEBUG_PRINTF("[SCHED] heartbeats piggybacked=%u\n", heartbeatsPiggybacked);
+    #if BATCH_ENABLED
+    const BatchStats& b = batchStats;
+    DEBUG_PRINTF("[SCHED] batches=%u avgSize=%.1f window=%ums maxWait=%uus%s\n", b.batches,
+                 b.batches > 0 ? (float)b.batchedScans / b.batches : 0.0f, getBatchWindowMs(),
+                 b.maxWaitUs, batchSupported ? "" : " (unsupported by server)");
+    #endif
+    #if BACKPRESSURE_ENABLED
+    const BackpressureStats& p = backpressure.getStats();
+    DEBUG_PRINTF("[SCHED] backpressure limit=%.2f hold=%ums overloads=%u timeouts=%u retryAfter=%u shed=%u rejected=%u\n",
+                 backpressure.getLimit(), backpressure.holdRemaining(millis()), p.overloads, p.timeouts,
+                 p.retryAfters, p.shed, p.rejected);
+    #endif
+}
+
+uint32_t RequestScheduler::getBatchWindowMs() const {
+    uint32_t gap = scanGapEwmaMs;
+    if (gap >= BATCH_BURST_GAP_MS) {
+        return 0;
+    }
+    // Chờ khoảng một nhịp quét: đủ để lần quét kế tiếp kịp vào batch
+    return gap < BATCH_MAX_WINDOW_MS ? gap : BATCH_MAX_WINDOW_MS;
+}
+
+void RequestScheduler::recordArrival() {
+    uint32_t now = millis();
+    uint32_t gap = lastScanArrival == 0 ? BATCH_BURST_GAP_MS * 4 : now - lastScanArrival;
+    if (gap > BATCH_BURST_GAP_MS * 4) {
+        gap = BATCH_BURST_GAP_MS * 4;
+    }
+    lastScanArrival = now;
+    // EWMA hệ số 1/2: sau một khoảng nghỉ, lần quét đầu tiên không bao giờ phải chờ,
+    // từ lần quét sát nhau thứ ba trở đi cửa sổ mới mở
+    scanGapEwmaMs = (scanGapEwmaMs + gap) / 2;
+}
+
+bool RequestScheduler::enqueue(QueuedRequest& request) {
+    request.enqueuedAtUs = micros();
+    if (request.priority == PRIORITY_SCAN) {
+        recordArrival();
+    }
+    
+    return push(request);
+}
+
+bool RequestScheduler::push(QueuedRequest& request) {
+    // Chỉ hàng đợi gửi lại có hạn riêng từng request (xem takeNext)
+    configASSERT(request.notBefore == 0 || request.priority == PRIORITY_REPLAY);
+    if (xQueueSendToBack(queues[request.priority], &request, 0) != pdTRUE) {
+        stats[request.priority].dropped++;
+        DEBUG_PRINTLN("[SCHED] Queue full, request dropped");
+        return false;
+    }
+    
+    xSemaphoreGive(pending);
+    // Đánh thức task mạng đang ngủ chờ request gửi lại tới hạn
+    if (taskHandle != nullptr) {
+        xTaskNotifyGive(taskHandle);
+    }
+    return true;
+}
+
+bool RequestScheduler::takeNext(QueuedRequest& request, uint32_t& waitMs) {
+    waitMs = portMAX_DELAY;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < PRIORITY_COUNT; i++) {
+        if (xQueuePeek(queues[i], &request, 0) != pdTRUE) {
+            continue;
+        }
+        // Chỉ request gửi lại mang notBefore (push() kiểm tra): hàng đợi gửi lại gần như theo thứ
+        // tự hạn nên request đầu chưa tới hạn chỉ chặn hàng đợi của nó, mức ưu tiên thấp hơn vẫn
+        // được gửi. Hàng đợi quét luôn FIFO và luôn tới hạn. Request nền (heartbeat...) bị giãn theo
+        // giới hạn AIMD cả hàng đợi một lúc, nên cũng không có request tới hạn nằm sau request chưa tới hạn
+        long remaining = request.notBefore != 0 ? (long)(request.notBefore - now) : 0;
+        #if BACKPRESSURE_ENABLED
+        if (i == PRIORITY_HEARTBEAT && request.type != REQUEST_BENCHMARK && !backpressure.isHolding(now)) {
+            // Đang giữ thì holdBack() bỏ các request này; tự kiểm tra được trả lời ngay trong holdBack()
+            remaining = backpressure.backgroundDelay(now);
+        }
+        #endif
+        if (remaining > 0) {
+            if ((uint32_t)remaining < waitMs) {
+                waitMs = remaining;
+            }
+            continue;
+        }
+        if (xQueueReceive(queues[i], &request, 0) == pdTRUE) {
+            xSemaphoreTake(pending, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestScheduler::clearQueued(RequestType type) {
+    switch (type) {
+        case REQUEST_HEARTBEAT:
+            heartbeatQueued = false;
+            break;
+        case REQUEST_INVENTORY:
+            inventoryQueued = false;
+            break;
+        case REQUEST_FIRMWARE_UPDATE:
+            firmwareQueued = false;
+            break;
+        default:
+            break;
+    }
+}
+
+// Lấy thêm một request quét cho batch: quét mới trước, rồi request gửi lại đã tới hạn
+bool RequestScheduler::takeScan(QueuedRequest& request) {
+    bool taken = xQueueReceive(queues[PRIORITY_SCAN], &request, 0) == pdTRUE;
+    if (!taken && xQueuePeek(queues[PRIORITY_REPLAY], &request, 0) == pdTRUE &&
+        (long)(millis() - request.notBefore) >= 0) {
+        taken = xQueueReceive(queues[PRIORITY_REPLAY], &request, 0) == pdTRUE;
+    }
+    if (taken) {
+        // Giữ bộ đếm pending khớp với số request còn trong hàng đợi
+        xSemaphoreTake(pending, 0);
+    }
+    return taken;
+}
+
+uint8_t RequestScheduler::gatherBatch(const QueuedRequest& first) {
+    uint32_t startUs = micros();
+    uint32_t deadline = millis() + getBatchWindowMs();
+    batch[0] = first;
+    uint8_t count = 1;
+    
+    while (count < BATCH_MAX_ITEMS) {
+        if (takeScan(batch[count])) {
+            count++;
+            continue;
+        }
+        long remaining = (long)(deadline - millis());
+        if (remaining <= 0) {
+            break;
+        }
+        // Chờ request mới; request tới không phải lần quét (heartbeat) thì gửi luôn
+        if (xSemaphoreTake(pending, pdMS_TO_TICKS(remaining)) != pdTRUE) {
+            break;
+        }
+        xSemaphoreGive(pending);
+        if (!takeScan(batch[count])) {
+            break;
+        }
+        count++;
+    }
+    
+    uint32_t waitUs = micros() - startUs;
+    stationMetrics.observeBatch(count, waitUs);
+    batchStats.totalWaitUs += waitUs;
+    if (waitUs > batchStats.maxWaitUs) {
+        batchStats.maxWaitUs = waitUs;
+    }
+    if (count > 1) {
+        batchStats.batches++;
+        batchStats.batchedScans += count;
+    }
+    return count;
+}
+
+void RequestScheduler::executeBatch(uint8_t count) {
+    BatchScan scans[BATCH_MAX_ITEMS];
+    for (uint8_t i = 0; i < count; i++) {
+        recordWait(batch[i]);
+        scans[i].data = batch[i].data;
+        scans[i].book = batch[i].type == REQUEST_BOOK_SCAN;
+        scans[i].source = batch[i].source;
+        scans[i].trace = &batch[i].trace;
+    }
+    
+    int httpCode = apiClient.scanBatch(scans, count, batchStudents, batchBooks);
+    if (httpCode == HTTP_CODE_NOT_FOUND) {
+        // Server chưa có API batch: gửi từng request như trước, không gom nữa
+        DEBUG_PRINTLN("[SCHED] Batch endpoint not found, sending scans one by one");
+        batchSupported = false;
+        for (uint8_t i = 0; i < count; i++) {
+            dispatch(batch[i]);
+        }
+        return;
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (scans[i].book) {
+            finishBook(batch[i], batchBooks[i], true);
+        } else {
+            finishStudent(batch[i], batchStudents[i], true);
+        }
+    }
+}
+
+void RequestScheduler::recordWait(const QueuedRequest& request) {
+    uint32_t waitUs = micros() - request.enqueuedAtUs;
+    QueueStats& s = stats[request.priority];
+    s.served++;
+    s.totalWaitUs += waitUs;
+    if (waitUs > s.maxWaitUs) {
+        s.maxWaitUs = waitUs;
+    }
+}
+
+void RequestScheduler::scheduleReplay(const QueuedRequest& request, bool sent) {
+    if (sent && request.attempts >= REQUEST_MAX_RETRIES) {
+        DEBUG_PRINT("[SCHED] Giving up on ");
+        DEBUG_PRINTLN(request.data);
+        return;
+    }
+    
+    QueuedRequest replay = request;
+    replay.priority = PRIORITY_REPLAY;
+    if (sent) {
+        replay.attempts++;
+    }
+    // Lũy thừa 2 có jitter, không sớm hơn thời gian server yêu cầu chờ (Retry-After)
+    uint32_t now = millis();
+    uint32_t delay = Backpressure::retryDelay(replay.attempts > 0 ? replay.attempts : 1, esp_random());
+    uint32_t hold = backpressure.holdRemaining(now);
+    replay.notBefore = now + (hold > delay ? hold : delay);
+    replay.result = nullptr;
+    replay.done = nullptr;
+    replay.notify = false;
+    enqueue(replay);
+}
+
+#if OTA_ENABLED
+void RequestScheduler::serveScans(void* param) {
+    RequestScheduler* scheduler = static_cast<RequestScheduler*>(param);
+    QueueHandle_t queue = scheduler->queues[PRIORITY_SCAN];
+    // Hàng đợi quét luôn tới hạn (holdBack() không giãn lần quét). Chỉ các request đang có lúc
+    // gọi, để lần quét tới liên tục không giữ lượt tải mãi
+    UBaseType_t waiting = uxQueueMessagesWaiting(queue);
+    QueuedRequest request;
+    while (waiting-- > 0 && xQueueReceive(queue, &request, 0) == pdTRUE) {
+        xSemaphoreTake(scheduler->pending, 0);
+        scheduler->serve(request);
+    }
+}
+#endif
+
+void RequestScheduler::serve(QueuedRequest& request) {
+    #if BACKPRESSURE_ENABLED
+    if (holdBack(request)) {
+        return;
+    }
+    #endif
+    
+    #if BATCH_ENABLED
+    // Lần quét: gom thêm các lần quét đang chờ (hoặc tới trong cửa sổ) vào một request
+    if (request.priority != PRIORITY_HEARTBEAT && batchSupported) {
+        uint8_t count = gatherBatch(request);
+        if (count > 1) {
+            executeBatch(count);
+            return;
+        }
+    }
+    #endif
+    execute(request);
+}
+
+void RequestScheduler::execute(QueuedRequest& request) {
+    recordWait(request);
+    dispatch(request);
+}
+
+void RequestScheduler::dispatch(QueuedRequest& request) {
+    switch (request.type) {
+        case REQUEST_STUDENT_SCAN: {
+            StudentInfo info = apiClient.scanStudentCard(request.data, request.source, request.trace);
+            finishStudent(request, info, true);
+            break;
+        }
+        case REQUEST_BOOK_SCAN: {
+            BookInfo info = apiClient.scanBookBarcode(request.data, request.trace);
+            finishBook(request, info, true);
+            break;
+        }
+        case REQUEST_HEARTBEAT:
+            heartbeatQueued = false;
+            if (apiClient.sendHeartbeat()) {
+                DEBUG_PRINTLN("[HEARTBEAT] OK");
+            } else {
+                DEBUG_PRINTLN("[HEARTBEAT] Failed");
+            }
+            #if OTA_ENABLED
+            if (apiClient.takeFirmwareUpdateRequest()) {
+                requestFirmwareUpdate();
+            }
+            #endif
+            break;
+        case REQUEST_INVENTORY:
+            inventoryQueued = false;
+            #if INVENTORY_ENABLED
+            if (!apiClient.sendInventoryBatch(inventorySession)) {
+                DEBUG_PRINTLN("[INVENTORY] Upload failed");
+            }
+            #endif
+            break;
+        case REQUEST_BENCHMARK:
+            #if SELF_BENCH_ENABLED
+            if (!apiClient.runBenchmark(*static_cast<BenchReport*>(request.result))) {
+                DEBUG_PRINTLN("[BENCH] Report upload failed");
+            }
+            #endif
+            xSemaphoreGive(request.done);
+            break;
+        case REQUEST_FIRMWARE_UPDATE:
+            firmwareQueued = false;
+            #if OTA_ENABLED
+            if (!apiClient.updateFirmware(serveScans, this)) {
+                DEBUG_PRINTLN("[OTA] No update installed");
+            }
+            #endif
+            break;
+    }
+}
+
+void RequestScheduler::finishStudent(const QueuedRequest& request, const StudentInfo& info, bool sent) {
+    if (sent && info.httpCode > 0 && !Backpressure::isOverloadStatus(info.httpCode)) {
+        lastScanSuccess = millis();
+    } else {
+        // Lỗi kết nối hoặc server quá tải: gửi lại ở nền để server/app vẫn nhận được lần quét
+        scheduleReplay(request, sent);
+    }
+    if (request.result != nullptr) {
+        *static_cast<StudentInfo*>(request.result) = info;
+    }
+    if (request.notify && xQueueSend(completions, &info, 0) != pdTRUE) {
+        DEBUG_PRINTLN("[SCHED] Completion queue full");
+    }
+    if (request.done != nullptr) {
+        xSemaphoreGive(request.done);
+    }
+}
+
+void RequestScheduler::finishBook(const QueuedRequest& request, const BookInfo& info, bool sent) {
+    if (sent && info.httpCode > 0 && !Backpressure::isOverloadStatus(info.httpCode)) {
+        lastScanSuccess = millis();
+    } else {
+        scheduleReplay(request, sent);
+    }
+    if (request.result != nullptr) {
+        *static_cast<BookInfo*>(request.result) = info;
+    }
+    if (request.done != nullptr) {
+        xSemaphoreGive(request.done);
+    }
+}
+
+// Server quá tải: lần quét (kể cả xác nhận thẻ chạy nền) được trả lời ngay tại trạm thay vì gửi đi
+// trong thời gian giữ, và không bao giờ bị giãn; request nền bị bỏ (heartbeat) hoặc giãn ra theo
+// giới hạn AIMD. Trả về true nếu request không được gửi bây giờ
+bool RequestScheduler::holdBack(QueuedRequest& request) {
+    uint32_t now = millis();
+    bool holding = backpressure.isHolding(now);
+    
+    if (request.type == REQUEST_BENCHMARK) {
+        // Đo lúc server đang bắt chờ chỉ thêm tải và cho số liệu sai: trả về ngay, phần mạng để trống
+        if (!holding) {
+            return false;
+        }
+        backpressure.countShed();
+        recordWait(request);
+        static_cast<BenchReport*>(request.result)->httpCode = HTTP_STATUS_SERVICE_UNAVAILABLE;
+        xSemaphoreGive(request.done);
+        return true;
+    }
+    if (request.done != nullptr) {
+        if (!holding) {
+            return false;
+        }
+        backpressure.countRejected();
+        rejectOverloaded(request);
+        return true;
+    }
+    if (request.priority == PRIORITY_SCAN) {
+        // Xác nhận thẻ chạy nền: xếp lại với hạn chờ sẽ chặn các lần quét có người chờ phía sau
+        // trong cùng hàng đợi, nên chỉ có gửi ngay hoặc trả lời quá tải (loop() nhận kết quả ngay,
+        // lần quét đi theo đường gửi lại)
+        if (!holding) {
+            return false;
+        }
+        backpressure.countShed();
+        rejectOverloaded(request);
+        return true;
+    }
+    
+    uint32_t delay = backpressure.backgroundDelay(now);
+    if (delay == 0) {
+        return false;
+    }
+    if (holding && request.type == REQUEST_HEARTBEAT) {
+        heartbeatQueued = false;
+        backpressure.countShed();
+        DEBUG_PRINTLN("[HEARTBEAT] Skipped (server overloaded)");
+        return true;
+    }
+    if (holding && request.type == REQUEST_INVENTORY) {
+        // UID vẫn nằm trong hàng đợi của phiên, lần gửi sau mang theo
+        inventoryQueued = false;
+        backpressure.countShed();
+        return true;
+    }
+    if (holding && request.type == REQUEST_FIRMWARE_UPDATE) {
+        // Tải firmware là tải lớn nhất của trạm: bỏ, heartbeat sau báo lại
+        firmwareQueued = false;
+        backpressure.countShed();
+        DEBUG_PRINTLN("[OTA] Skipped (server overloaded)");
+        return true;
+    }
+    if (request.priority != PRIORITY_REPLAY) {
+        // takeNext() chỉ lấy request nền khi đã hết giãn; không xếp lại với hạn ngoài hàng đợi gửi lại
+        return false;
+    }
+    request.notBefore = now + delay;
+    if (!push(request)) {
+        clearQueued(request.type);
+    }
+    return true;
+}
+
+void RequestScheduler::rejectOverloaded(QueuedRequest& request) {
+    recordWait(request);
+    if (request.type == REQUEST_BOOK_SCAN) {
+        BookInfo info;
+        resetBookInfo(info);
+        strlcpy(info.error, "Server qua tai", sizeof(info.error));
+        info.httpCode = HTTP_STATUS_SERVICE_UNAVAILABLE;
+        info.trace = request.trace;
+        finishBook(request, info, false);
+    } else {
+        StudentInfo info;
+        resetStudentInfo(info);
+        strlcpy(info.error, "Server qua tai", sizeof(info.error));
+        info.httpCode = HTTP_STATUS_SERVICE_UNAVAILABLE;
+        info.trace = request.trace;
+        finishStudent(request, info, false);
+    }
+}
+
+void RequestScheduler::taskEntry(void* param) {
+    static_cast<RequestScheduler*>(param)->run();
+}
+
+void RequestScheduler::run() {
+    while (true) {
+        QueuedRequest request;
+        uint32_t waitMs;
+        if (!takeNext(request, waitMs)) {
+            // Ngủ tới hạn của request gửi lại sớm nhất, hoặc tới khi có request mới
+            ulTaskNotifyTake(pdTRUE, waitMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(waitMs) + 1);
+            continue;
+        }
+        serve(request);
+    }
+}
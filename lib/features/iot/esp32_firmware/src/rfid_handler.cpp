@@ -1,72 +1,158 @@
 #include "rfid_handler.h"
+#include "station_params.h"
 
-RFIDHandler::RFIDHandler() : lastUID(""), lastReadTime(0) {
-    rfid = new MFRC522(RFID_CS_PIN, RFID_RST_PIN);
+#if CARD_DATA_MODE
+static const uint8_t sectorKey[6] = CARD_SECTOR_KEY;
+
+// Khóa mẫu từng nằm trong repo: thẻ ký bằng nó có thể bị làm giả
+static constexpr bool sameText(const char* a, const char* b) {
+    return *a == *b && (*a == '\0' || sameText(a + 1, b + 1));
+}
+static_assert(!sameText(CARD_SIGNING_KEY, CARD_SIGNING_KEY_PLACEHOLDER),
+              "CARD_SIGNING_KEY is still the published placeholder");
+#endif
+
+RFIDHandler::RFIDHandler(uint8_t csPin, uint8_t rstPin)
+    : bus(csPin), driver(bus), csPin(csPin), rstPin(rstPin), version(0), lastReadTime(0) {
+    currentUID[0] = '\0';
+    lastUID[0] = '\0';
 }
 
 bool RFIDHandler::begin() {
-    SPI.begin(RFID_SCK_PIN, RFID_MISO_PIN, RFID_MOSI_PIN, RFID_CS_PIN);
-    rfid->PCD_Init();
+    if (!bus.begin()) {
+        return false;
+    }
+    
+    // Hard reset qua chân RST rồi chờ dao động thạch anh khởi động
+    pinMode(rstPin, OUTPUT);
+    digitalWrite(rstPin, LOW);
+    delayMicroseconds(2);
+    digitalWrite(rstPin, HIGH);
+    delay(50);
     
     // Kiểm tra RFID reader
-    byte version = rfid->PCD_ReadRegister(rfid->VersionReg);
+    version = driver.init();
     if (version == 0x00 || version == 0xFF) {
-        DEBUG_PRINTLN("RFID reader not found!");
+        DEBUG_PRINTF("RFID reader (CS %d) not found!\n", csPin);
         return false;
     }
     
-    DEBUG_PRINT("RFID reader initialized. Version: 0x");
-    Serial.println(version, HEX);
+    DEBUG_PRINTF("RFID reader (CS %d) initialized. Version: 0x%02X\n", csPin, version);
     return true;
 }
 
 bool RFIDHandler::hasNewCard() {
-    // Kiểm tra có thẻ mới không
-    if (!rfid->PICC_IsNewCardPresent()) {
-        return false;
+    // Chạy REQA → anticollision → select trong giới hạn RFID_POLL_BUDGET_US,
+    // lúc chờ DMA/thẻ trả lời thì nhường CPU cho task khác
+    unsigned long start = micros();
+    Rc522Poll result;
+    while ((result = driver.service()) == RC522_BUSY && micros() - start < RFID_POLL_BUDGET_US) {
+        taskYIELD();
     }
-    
-    // Đọc serial number
-    if (!rfid->PICC_ReadCardSerial()) {
+    if (result != RC522_CARD) {
         return false;
     }
     
     // Debounce: tránh đọc cùng thẻ nhiều lần
-    String currentUID = byteArrayToHexString(rfid->uid.uidByte, rfid->uid.size);
+    uint8_t uidLength;
+    const uint8_t* uid = driver.uid(uidLength);
+    byteArrayToHexString(uid, uidLength, currentUID, sizeof(currentUID));
     unsigned long currentTime = millis();
     
-    if (currentUID == lastUID && (currentTime - lastReadTime) < debounceTime) {
+    if (strcmp(currentUID, lastUID) == 0 && (currentTime - lastReadTime) < stationParams.get(PARAM_RFID_DEBOUNCE)) {
         return false;
     }
     
-    lastUID = currentUID;
+    memcpy(lastUID, currentUID, sizeof(lastUID));
     lastReadTime = currentTime;
     
     return true;
 }
 
-String RFIDHandler::readCardUID() {
-    String uid = byteArrayToHexString(rfid->uid.uidByte, rfid->uid.size);
-    
+const char* RFIDHandler::readCardUID() {
     DEBUG_PRINT("[RFID] Card UID: ");
-    DEBUG_PRINTLN(uid);
+    DEBUG_PRINTLN(currentUID);
+    
+    return currentUID;
+}
+
+#if CARD_DATA_MODE
+CardRecordStatus RFIDHandler::readStudentRecord(StudentCardRecord& record) {
+    CardRecordStatus status = CardStore::readRecord(driver, CARD_SIGNING_KEY, sectorKey, record);
     
-    return uid;
+    DEBUG_PRINT("[RFID] Card record: ");
+    DEBUG_PRINTLN(CardRecord::statusName(status));
+    return status;
 }
 
+CardRecordStatus RFIDHandler::writeStudentRecord(const StudentCardRecord& record) {
+    CardRecordStatus status = CardStore::writeRecord(driver, CARD_SIGNING_KEY, sectorKey, record);
+    
+    DEBUG_PRINT("[RFID] Write card record: ");
+    DEBUG_PRINTLN(CardRecord::statusName(status));
+    return status;
+}
+#endif
+
 void RFIDHandler::haltCard() {
-    rfid->PICC_HaltA();
-    rfid->PCD_StopCrypto1();
+    // HLTA + tắt Crypto1 hoàn tất ở các lần hasNewCard() sau
+    driver.halt();
+}
+
+void RFIDHandler::setInventoryMode(bool enabled) {
+    // Chạy nốt lệnh đang dở trước khi đổi timer của chip
+    unsigned long start = micros();
+    while (driver.service() == RC522_BUSY && micros() - start < RFID_POLL_BUDGET_US * 10) {
+        taskYIELD();
+    }
+    driver.setResponseTimeout(enabled ? INVENTORY_RESPONSE_TIMEOUT_US : RC522_DEFAULT_TIMEOUT_US);
+}
+
+bool RFIDHandler::readInventoryTag(uint8_t* uid, uint8_t& length) {
+    unsigned long start = micros();
+    Rc522Poll result;
+    while ((result = driver.service()) == RC522_BUSY && micros() - start < RFID_POLL_BUDGET_US) {
+        taskYIELD();
+    }
+    if (result != RC522_CARD) {
+        return false;
+    }
+    
+    const uint8_t* selected = driver.uid(length);
+    memcpy(uid, selected, length);
+    
+    // HLTA hoàn tất ngay tại đây để lần gọi sau bắt đầu bằng REQA
+    driver.halt();
+    while (driver.service() == RC522_BUSY && micros() - start < RFID_POLL_BUDGET_US) {
+        taskYIELD();
+    }
+    return true;
 }
 
-String RFIDHandler::byteArrayToHexString(byte* buffer, byte bufferSize) {
-    String result = "";
-    for (byte i = 0; i < bufferSize; i++) {
-        if (buffer[i] < 0x10) {
-            result += "0";
+uint16_t RFIDHandler::benchmarkRegisters(uint32_t* samplesUs, uint16_t count) {
+    unsigned long start = micros();
+    while (driver.service() == RC522_BUSY && micros() - start < RFID_POLL_BUDGET_US * 10) {
+        taskYIELD();
+    }
+    
+    uint16_t mismatches = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t begin = micros();
+        uint8_t value = driver.readVersion();
+        samplesUs[i] = micros() - begin;
+        if (value != version) {
+            mismatches++;
         }
-        result += String(buffer[i], HEX);
     }
-    result.toUpperCase();
-    return result;
+    return mismatches;
+}
+
+void RFIDHandler::byteArrayToHexString(const byte* buffer, byte bufferSize, char* output, size_t outputSize) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    size_t pos = 0;
+    for (byte i = 0; i < bufferSize && pos + 2 < outputSize; i++) {
+        output[pos++] = hexDigits[buffer[i] >> 4];
+        output[pos++] = hexDigits[buffer[i] & 0x0F];
+    }
+    output[pos] = '\0';
 }
@@ -0,0 +1,95 @@
+#include "rfid_reader_pool.h"
+#include "api_codec.h"
+
+static const uint8_t csPins[RFID_READER_COUNT] = RFID_READER_CS_PINS;
+static const uint8_t rstPins[RFID_READER_COUNT] = RFID_READER_RST_PINS;
+static const ScanLane readerLanes[RFID_READER_COUNT] = RFID_READER_LANES;
+
+RFIDReaderPool::RFIDReaderPool() : next(0) {
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        readers[i] = new RFIDHandler(csPins[i], rstPins[i]);
+        lanes[i] = readerLanes[i];
+        active[i] = false;
+        lastPollUs[i] = 0;
+    }
+    memset(stats, 0, sizeof(stats));
+}
+
+bool RFIDReaderPool::begin() {
+    // CS do phần cứng SPI giữ ở mức cao khi không có transaction của đầu đọc đó
+    if (!Rc522SpiBus::beginBus()) {
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        active[i] = readers[i]->begin();
+        DEBUG_PRINTF("[RFID] Reader %d (%s): %s\n", i, ApiCodec::laneName(lanes[i]),
+                     active[i] ? "OK" : "not found");
+    }
+    
+    return getActiveCount() > 0;
+}
+
+bool RFIDReaderPool::poll(RFIDEvent& event) {
+    for (uint8_t n = 0; n < RFID_READER_COUNT; n++) {
+        uint8_t i = (next + n) % RFID_READER_COUNT;
+        if (!active[i]) {
+            continue;
+        }
+        
+        uint32_t startUs = micros();
+        ReaderStats& s = stats[i];
+        s.polls++;
+        
+        // Thẻ có thể đã nằm trên đầu đọc từ ngay sau lần poll trước
+        uint32_t cycleUs = lastPollUs[i] != 0 ? startUs - lastPollUs[i] : 0;
+        lastPollUs[i] = startUs;
+        s.lastCycleUs = cycleUs;
+        if (cycleUs > s.maxCycleUs) {
+            s.maxCycleUs = cycleUs;
+        }
+        
+        if (!readers[i]->hasNewCard()) {
+            continue;
+        }
+        
+        uint32_t latencyUs = cycleUs + (micros() - startUs);
+        s.detections++;
+        s.lastLatencyUs = latencyUs;
+        s.totalLatencyUs += latencyUs;
+        if (latencyUs > s.maxLatencyUs) {
+            s.maxLatencyUs = latencyUs;
+        }
+        
+        event.source.reader = i;
+        event.source.lane = lanes[i];
+        event.uid = readers[i]->readCardUID();
+        
+        next = (i + 1) % RFID_READER_COUNT;
+        return true;
+    }
+    
+    return false;
+}
+
+uint8_t RFIDReaderPool::getActiveCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        if (active[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void RFIDReaderPool::printStats() const {
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        const ReaderStats& s = stats[i];
+        DEBUG_PRINTF("[RFID] reader %d %-8s %s polls=%u detections=%u "
+                     "latency last=%uus avg=%uus max=%uus cycle max=%uus\n",
+                     i, ApiCodec::laneName(lanes[i]), active[i] ? "up  " : "down",
+                     s.polls, s.detections, s.lastLatencyUs,
+                     s.detections > 0 ? (uint32_t)(s.totalLatencyUs / s.detections) : 0,
+                     s.maxLatencyUs, s.maxCycleUs);
+    }
+}
@@ -0,0 +1,77 @@
+#include "scan_arena.h"
+
+ScanArena::ScanArena(size_t capacity)
+    : buffer(nullptr), capacity(capacity), offset(0), highWater(0), overflows(0), inPSRAM(false) {}
+
+bool ScanArena::begin() {
+    if (buffer != nullptr) {
+        return true;
+    }
+    
+    // PSRAM có thì dùng PSRAM để không chiếm SRAM nội
+    if (psramFound()) {
+        buffer = static_cast<uint8_t*>(ps_malloc(capacity));
+        inPSRAM = buffer != nullptr;
+    }
+    if (buffer == nullptr) {
+        buffer = static_cast<uint8_t*>(malloc(capacity));
+    }
+    
+    if (buffer == nullptr) {
+        DEBUG_PRINTLN("[ARENA] Allocation failed!");
+        capacity = 0;
+        return false;
+    }
+    
+    DEBUG_PRINTF("[ARENA] %u bytes in %s\n", (unsigned)capacity, inPSRAM ? "PSRAM" : "SRAM");
+    return true;
+}
+
+void* ScanArena::alloc(size_t size, size_t align) {
+    size_t start = (offset + align - 1) & ~(align - 1);
+    if (buffer == nullptr || start + size > capacity) {
+        overflows++;
+        DEBUG_PRINTF("[ARENA] Out of space (%u requested, %u used)\n", (unsigned)size, (unsigned)offset);
+        return nullptr;
+    }
+    
+    offset = start + size;
+    if (offset > highWater) {
+        highWater = offset;
+    }
+    return buffer + start;
+}
+
+char* ScanArena::allocString(size_t len) {
+    char* str = static_cast<char*>(alloc(len + 1, 1));
+    if (str != nullptr) {
+        str[0] = '\0';
+    }
+    return str;
+}
+
+void ScanArena::rewind(size_t position) {
+    if (position < offset) {
+        offset = position;
+    }
+}
+
+size_t BufferStream::write(const uint8_t* data, size_t size) {
+    if (capacity == 0) {
+        truncated = truncated || size > 0;
+        return 0;
+    }
+    
+    // Chừa 1 byte cho '\0'
+    size_t room = capacity > length + 1 ? capacity - length - 1 : 0;
+    size_t n = size < room ? size : room;
+    
+    memcpy(buffer + length, data, n);
+    length += n;
+    buffer[length] = '\0';
+    
+    if (n < size) {
+        truncated = true;
+    }
+    return n;
+}
@@ -0,0 +1,58 @@
+#include "scan_trace.h"
+#include "api_codec.h"
+#include "clock_sync.h"
+
+namespace ScanTracing {
+
+// Helper: count byte ngẫu nhiên (bộ sinh số ngẫu nhiên phần cứng) dạng hex
+static void randomHex(char* output, size_t count) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    uint8_t bytes[16];
+    esp_fill_random(bytes, count);
+    for (size_t i = 0; i < count; i++) {
+        output[i * 2] = HEX_DIGITS[bytes[i] >> 4];
+        output[i * 2 + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+    }
+    output[count * 2] = '\0';
+}
+
+void start(ScanTrace& trace) {
+    memset(&trace, 0, sizeof(trace));
+    randomHex(trace.id, (TRACE_ID_LEN - 1) / 2);
+    trace.tapMs = millis();
+    trace.tapEpochMs = clockSync.nowEpochMs();
+}
+
+void mark(ScanTrace& trace, TraceStage stage) {
+    if (trace.id[0] == '\0' || (trace.reached & (1 << stage))) {
+        return;
+    }
+    trace.stageMs[stage] = millis() - trace.tapMs;
+    trace.reached |= 1 << stage;
+}
+
+size_t traceparent(const ScanTrace& trace, char* output, size_t capacity) {
+    char spanId[TRACE_SPAN_ID_LEN];
+    randomHex(spanId, (TRACE_SPAN_ID_LEN - 1) / 2);
+    return ApiCodec::formatTraceparent(trace, spanId, output, capacity);
+}
+
+void print(const ScanTrace& trace, const char* label) {
+#if TRACE_LOG_ENABLED
+    if (trace.id[0] == '\0') {
+        return;
+    }
+    DEBUG_PRINTF("[TRACE] %s %s", trace.id, label);
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        if (trace.reached & (1 << i)) {
+            DEBUG_PRINTF(" %s=%ums", ApiCodec::traceStageName((TraceStage)i), (unsigned)trace.stageMs[i]);
+        }
+        if (i == TRACE_RESPONSE && trace.serverMs > 0) {
+            DEBUG_PRINTF(" (server=%ums)", (unsigned)trace.serverMs);
+        }
+    }
+    DEBUG_PRINTLN("");
+#endif
+}
+
+} // namespace ScanTracing
@@ -0,0 +1,171 @@
+#include "self_benchmark.h"
+#include <algorithm>
+#include "api_codec.h"
+#include "clock_sync.h"
+
+SelfBenchmark selfBenchmark;
+
+// Bộ đệm mẫu dùng chung cho các phép đo trên loop()
+#define BENCH_SAMPLE_CAPACITY (BENCH_RC522_ITERATIONS > BENCH_LCD_ITERATIONS ? BENCH_RC522_ITERATIONS : BENCH_LCD_ITERATIONS)
+
+#if DISPLAY_OLED
+#define BENCH_DISPLAY_NAME "ssd1306"
+#define BENCH_DISPLAY_COLS OLED_TEXT_COLS
+#else
+#define BENCH_DISPLAY_NAME "lcd1602"
+#define BENCH_DISPLAY_COLS LCD_COLS
+#endif
+
+// Chỉ số của phân vị pct (nearest-rank) trong count mẫu đã sắp xếp
+static uint16_t rankIndex(uint16_t count, uint8_t pct) {
+    return (uint16_t)(((uint32_t)count * pct + 99) / 100 - 1);
+}
+
+static void printTiming(const char* label, const BenchTiming& t) {
+    DEBUG_PRINTF("[BENCH] %s n=%u err=%u min=%uus p50=%uus p95=%uus max=%uus avg=%uus\n",
+                 label, t.samples, t.failures, t.minUs, t.p50Us, t.p95Us, t.maxUs, t.avgUs);
+}
+
+SelfBenchmark::SelfBenchmark() : runs(0) {
+    memset(&report, 0, sizeof(report));
+}
+
+void SelfBenchmark::summarize(uint32_t* samplesUs, uint16_t count, uint16_t failures, BenchTiming& out) {
+    memset(&out, 0, sizeof(out));
+    out.samples = count;
+    out.failures = failures;
+    if (count == 0) {
+        return;
+    }
+    
+    std::sort(samplesUs, samplesUs + count);
+    uint64_t total = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        total += samplesUs[i];
+    }
+    out.minUs = samplesUs[0];
+    out.p50Us = samplesUs[rankIndex(count, 50)];
+    out.p95Us = samplesUs[rankIndex(count, 95)];
+    out.maxUs = samplesUs[count - 1];
+    out.avgUs = (uint32_t)(total / count);
+}
+
+bool SelfBenchmark::run(RFIDReaderPool& readers, LCDHandler& lcd, WiFiHandler& wifi, RequestScheduler& scheduler) {
+    uint32_t* samples = static_cast<uint32_t*>(malloc(BENCH_SAMPLE_CAPACITY * sizeof(uint32_t)));
+    if (samples == nullptr) {
+        DEBUG_PRINTLN("[BENCH] Out of memory");
+        return false;
+    }
+    
+    memset(&report, 0, sizeof(report));
+    runs++;
+    report.deviceId = DEVICE_ID;
+    report.timestamp = clockSync.nowEpochMs();
+    report.run = runs;
+    report.startedMs = millis();
+    DEBUG_PRINTF("[BENCH] Run %u started\n", runs);
+    
+    lcd.displayText("Tự kiểm tra", "RC522...");
+    measureReaders(readers, samples);
+    measureDisplay(lcd, samples);
+    lcd.displayText("Tự kiểm tra", "WiFi...");
+    measureWifi(wifi);
+    free(samples);
+    
+    // Không có WiFi thì phần mạng chỉ chờ timeout, báo cáo cũng không gửi được
+    if (report.wifiConnected) {
+        lcd.displayText("Tự kiểm tra", "Mạng...");
+        if (!scheduler.runBenchmark(report)) {
+            DEBUG_PRINTLN("[BENCH] Request queue full, network skipped");
+        }
+    }
+    report.durationMs = millis() - report.startedMs;
+    return true;
+}
+
+void SelfBenchmark::measureReaders(RFIDReaderPool& readers, uint32_t* samples) {
+    report.readerCount = readers.getReaderCount();
+    for (uint8_t i = 0; i < report.readerCount; i++) {
+        report.readerActive[i] = readers.isActive(i);
+        report.readerLane[i] = readers.getLane(i);
+        if (!report.readerActive[i]) {
+            continue;
+        }
+        RFIDHandler& reader = readers.reader(i);
+        report.readerVersion[i] = reader.getVersion();
+        uint16_t mismatches = reader.benchmarkRegisters(samples, BENCH_RC522_ITERATIONS);
+        summarize(samples, BENCH_RC522_ITERATIONS, mismatches, report.rc522[i]);
+    }
+}
+
+void SelfBenchmark::measureDisplay(LCDHandler& lcd, uint32_t* samples) {
+    // Hai dòng đủ rộng, mọi ký tự đổi sau mỗi lần vẽ (OLED chỉ gửi cột thay đổi)
+    char line1[BENCH_DISPLAY_COLS + 1];
+    char line2[BENCH_DISPLAY_COLS + 1];
+    for (uint16_t i = 0; i < BENCH_LCD_ITERATIONS; i++) {
+        for (uint8_t col = 0; col < BENCH_DISPLAY_COLS; col++) {
+            line1[col] = 'A' + (col + i) % 26;
+            line2[col] = '0' + (col + i) % 10;
+        }
+        line1[BENCH_DISPLAY_COLS] = '\0';
+        line2[BENCH_DISPLAY_COLS] = '\0';
+    
+        uint32_t start = micros();
+        lcd.displayText(line1, line2);
+        samples[i] = micros() - start;
+    }
+    report.display = BENCH_DISPLAY_NAME;
+    summarize(samples, BENCH_LCD_ITERATIONS, 0, report.lcd);
+}
+
+void SelfBenchmark::measureWifi(WiFiHandler& wifi) {
+    report.wifiConnected = wifi.isConnected();
+    if (!report.wifiConnected) {
+        return;
+    }
+    
+    int32_t total = 0;
+    int8_t minRssi = 0;
+    int8_t maxRssi = -128;
+    for (uint16_t i = 0; i < BENCH_RSSI_SAMPLES; i++) {
+        int8_t rssi = (int8_t)wifi.getSignalStrength();
+        total += rssi;
+        minRssi = rssi < minRssi ? rssi : minRssi;
+        maxRssi = rssi > maxRssi ? rssi : maxRssi;
+        delay(BENCH_RSSI_INTERVAL_MS);
+    }
+    report.rssiMin = minRssi;
+    report.rssiMax = maxRssi;
+    report.rssiAvg = (float)total / BENCH_RSSI_SAMPLES;
+    report.channel = wifi.getChannel();
+}
+
+void SelfBenchmark::printReport() const {
+    if (runs == 0) {
+        return;
+    }
+    char label[32];
+    
+    DEBUG_PRINTF("[BENCH] run=%u duration=%ums\n", report.run, report.durationMs);
+    for (uint8_t i = 0; i < report.readerCount; i++) {
+        if (!report.readerActive[i]) {
+            DEBUG_PRINTF("[BENCH] rc522[%u] inactive\n", i);
+            continue;
+        }
+        snprintf(label, sizeof(label), "rc522[%u] %s v=0x%02X", i, ApiCodec::laneName(report.readerLane[i]),
+                 report.readerVersion[i]);
+        printTiming(label, report.rc522[i]);
+    }
+    printTiming(report.display, report.lcd);
+    
+    if (!report.wifiConnected) {
+        DEBUG_PRINTLN("[BENCH] wifi disconnected, network skipped");
+        return;
+    }
+    DEBUG_PRINTF("[BENCH] wifi rssi min=%d avg=%.1f max=%d dBm channel=%u\n",
+                 report.rssiMin, report.rssiAvg, report.rssiMax, report.channel);
+    snprintf(label, sizeof(label), "http status=%d", report.httpCode);
+    printTiming(label, report.http);
+    DEBUG_PRINTF("[BENCH] upload bytes=%u best=%ums throughput=%ukbit/s err=%u\n",
+                 report.uploadBytes, report.uploadBestMs, report.uploadKbps, report.uploadFailures);
+}
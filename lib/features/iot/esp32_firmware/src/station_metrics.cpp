@@ -0,0 +1,161 @@
+#include "station_metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+StationMetrics stationMetrics;
+
+// ============================================
+// MetricHistogram
+// ============================================
+
+MetricHistogram::MetricHistogram(const uint32_t* bounds, uint8_t boundCount)
+    : bounds(bounds), boundCount(boundCount > METRICS_MAX_BUCKETS ? METRICS_MAX_BUCKETS : boundCount),
+      count(0), sum(0) {
+    memset(buckets, 0, sizeof(buckets));
+}
+
+void MetricHistogram::observe(uint32_t value) {
+    uint8_t i = 0;
+    while (i < boundCount && value > bounds[i]) {
+        i++;
+    }
+    buckets[i]++;
+    count++;
+    sum += value;
+}
+
+uint32_t MetricHistogram::getCumulative(uint8_t i) const {
+    uint32_t total = 0;
+    for (uint8_t b = 0; b <= i && b <= boundCount; b++) {
+        total += buckets[b];
+    }
+    return total;
+}
+
+// ============================================
+// MetricsWriter
+// ============================================
+
+MetricsWriter::MetricsWriter(char* buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), used(0), overflow(false) {
+    if (capacity > 0) {
+        buffer[0] = '\0';
+    }
+}
+
+void MetricsWriter::append(const char* format, ...) {
+    if (overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer + used, capacity - used, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= capacity - used) {
+        // Bỏ dòng ghi dở, giữ phần trước đó hợp lệ
+        buffer[used] = '\0';
+        overflow = true;
+        return;
+    }
+    used += n;
+}
+
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+    append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, uint64_t value) {
+    append(labels[0] != '\0' ? "%s{%s} %llu\n" : "%s%s %llu\n", name, labels, (unsigned long long)value);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, int64_t value) {
+    append(labels[0] != '\0' ? "%s{%s} %lld\n" : "%s%s %lld\n", name, labels, (long long)value);
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, double value) {
+    append(labels[0] != '\0' ? "%s{%s} %g\n" : "%s%s %g\n", name, labels, value);
+}
+
+void MetricsWriter::histogram(const char* name, const char* labels, const MetricHistogram& histogram,
+                              double scale) {
+    const char* separator = labels[0] != '\0' ? "," : "";
+    for (uint8_t i = 0; i < histogram.getBoundCount(); i++) {
+        append("%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, separator, histogram.getBound(i) * scale,
+               (unsigned)histogram.getCumulative(i));
+    }
+    append("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, (unsigned)histogram.getCount());
+    append(labels[0] != '\0' ? "%s_sum{%s} %g\n" : "%s_sum%s %g\n", name, labels,
+           (double)histogram.getSum() * scale);
+    append(labels[0] != '\0' ? "%s_count{%s} %u\n" : "%s_count%s %u\n", name, labels,
+           (unsigned)histogram.getCount());
+}
+
+// ============================================
+// StationMetrics
+// ============================================
+
+// RTT HTTP (ms) và thời gian một vòng loop() không tính delay cuối vòng (µs)
+static const uint32_t HTTP_BOUNDS_MS[] = {25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+static const uint32_t LOOP_BOUNDS_US[] = {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+// Số lần quét mỗi request và thời gian chờ gom batch (µs, tối đa BATCH_MAX_WINDOW_MS)
+static const uint32_t BATCH_SIZE_BOUNDS[] = {1, 2, 3, 4, 6, 8};
+static const uint32_t BATCH_WAIT_BOUNDS_US[] = {0, 1000, 5000, 10000, 20000, 30000, 50000};
+
+static const char* const SCAN_KIND_NAMES[SCAN_KIND_COUNT] = {"student_card", "book_barcode"};
+static const char* const ENDPOINT_NAMES[ENDPOINT_COUNT] = {
+    "student", "book", "heartbeat", "batch", "inventory", "benchmark", "firmware"
+};
+static const char* const API_ERROR_NAMES[API_ERROR_COUNT] = {
+    "connection", "http_status", "overloaded", "response_too_large", "parse", "payload", "out_of_memory"
+};
+
+#define BOUND_COUNT(bounds) (sizeof(bounds) / sizeof(bounds[0]))
+
+StationMetrics::StationMetrics()
+    : httpDuration{{HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)},
+                   {HTTP_BOUNDS_MS, BOUND_COUNT(HTTP_BOUNDS_MS)}},
+      loopDuration(LOOP_BOUNDS_US, BOUND_COUNT(LOOP_BOUNDS_US)),
+      batchSize(BATCH_SIZE_BOUNDS, BOUND_COUNT(BATCH_SIZE_BOUNDS)),
+      batchWait(BATCH_WAIT_BOUNDS_US, BOUND_COUNT(BATCH_WAIT_BOUNDS_US)) {
+    memset(scans, 0, sizeof(scans));
+    memset(apiErrors, 0, sizeof(apiErrors));
+}
+
+void StationMetrics::write(MetricsWriter& out) const {
+    char labels[64];
+    
+    out.family("station_scans_total", "counter", "Scans handled by the station");
+    for (uint8_t kind = 0; kind < SCAN_KIND_COUNT; kind++) {
+        for (uint8_t success = 0; success < 2; success++) {
+            snprintf(labels, sizeof(labels), "type=\"%s\",result=\"%s\"", SCAN_KIND_NAMES[kind],
+                     success ? "success" : "failure");
+            out.sample("station_scans_total", labels, (uint64_t)scans[kind][success]);
+        }
+    }
+    
+    out.family("station_api_errors_total", "counter", "Failed API requests by error type");
+    for (uint8_t type = 0; type < API_ERROR_COUNT; type++) {
+        snprintf(labels, sizeof(labels), "type=\"%s\"", API_ERROR_NAMES[type]);
+        out.sample("station_api_errors_total", labels, (uint64_t)apiErrors[type]);
+    }
+    
+    out.family("station_http_request_duration_seconds", "histogram", "API request round-trip time");
+    for (uint8_t endpoint = 0; endpoint < ENDPOINT_COUNT; endpoint++) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", ENDPOINT_NAMES[endpoint]);
+        out.histogram("station_http_request_duration_seconds", labels, httpDuration[endpoint], 0.001);
+    }
+    
+    out.family("station_loop_duration_seconds", "histogram", "Main loop iteration time, idle delay excluded");
+    out.histogram("station_loop_duration_seconds", "", loopDuration, 0.000001);
+    
+    out.family("station_scan_batch_size", "histogram", "Scans sent per API request");
+    out.histogram("station_scan_batch_size", "", batchSize, 1);
+    out.family("station_scan_batch_wait_seconds", "histogram", "Latency added while gathering a batch");
+    out.histogram("station_scan_batch_wait_seconds", "", batchWait, 0.000001);
+}
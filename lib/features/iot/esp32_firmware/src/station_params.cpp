@@ -0,0 +1,166 @@
+#include "station_params.h"
+#include <Preferences.h>
+
+StationParams stationParams;
+
+#define PARAMS_NAMESPACE "params"
+#define PARAMS_KEY_VERSION "ver"
+#define PARAMS_KEY_REVISION "rev"
+
+// Thứ tự theo ParamId. Khoảng min/max chặn cấu hình làm trạm không dùng được
+// (ví dụ timeout 0 hay heartbeat mỗi giây)
+static const ParamSpec SPECS[PARAM_COUNT] = {
+    {"rfid_scan_interval_ms",  "rfid_scan",     RFID_SCAN_INTERVAL,  20,    2000,    1},
+    {"rfid_debounce_ms",       "rfid_debounce", RFID_DEBOUNCE_TIME,  0,     10000,   1},
+    {"lcd_display_timeout_ms", "lcd_timeout",   LCD_DISPLAY_TIMEOUT, 1000,  60000,   1},
+    {"heartbeat_interval_ms",  "hb_interval",   HEARTBEAT_INTERVAL,  10000, 3600000, 1},
+    {"api_timeout_ms",         "api_timeout",   API_TIMEOUT,         1000,  30000,   1},
+    {"wifi_check_interval_ms", "wifi_check",    WIFI_CHECK_INTERVAL, 1000,  60000,   1},
+};
+
+StationParams::StationParams() : revision(0), mutex(nullptr) {
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        values[i] = SPECS[i].defaultValue;
+    }
+    memset(&stats, 0, sizeof(stats));
+}
+
+const ParamSpec& StationParams::spec(ParamId id) {
+    return SPECS[id];
+}
+
+ParamId StationParams::find(const char* name) {
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        if (strcmp(SPECS[i].name, name) == 0) {
+            return (ParamId)i;
+        }
+    }
+    return PARAM_COUNT;
+}
+
+void StationParams::begin() {
+    mutex = xSemaphoreCreateMutex();
+    
+    Preferences prefs;
+    if (!prefs.begin(PARAMS_NAMESPACE, false)) {
+        DEBUG_PRINTLN("[PARAMS] NVS unavailable, using defaults");
+        return;
+    }
+    
+    // Giá trị lưu dưới bộ mặc định cũ hơn có thể mang ý nghĩa khác: bỏ, dùng mặc định mới
+    uint8_t storedVersion = prefs.getUChar(PARAMS_KEY_VERSION, 0);
+    uint8_t loaded = 0;
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        const ParamSpec& param = SPECS[i];
+        if (!prefs.isKey(param.key)) {
+            continue;
+        }
+        uint32_t value = prefs.getUInt(param.key, param.defaultValue);
+        if (param.version > storedVersion || value < param.minValue || value > param.maxValue) {
+            prefs.remove(param.key);
+            continue;
+        }
+        values[i] = value;
+        loaded++;
+    }
+    if (storedVersion != PARAMS_DEFAULTS_VERSION) {
+        prefs.putUChar(PARAMS_KEY_VERSION, PARAMS_DEFAULTS_VERSION);
+    }
+    revision = prefs.getUInt(PARAMS_KEY_REVISION, 0);
+    prefs.end();
+    
+    DEBUG_PRINTF("[PARAMS] %u override(s) loaded, config revision %u\n", loaded, revision);
+}
+
+// Gọi khi đã giữ mutex
+bool StationParams::store(ParamId id, uint32_t value, bool isReset) {
+    const ParamSpec& param = SPECS[id];
+    if (!isReset && (value < param.minValue || value > param.maxValue)) {
+        DEBUG_PRINTF("[PARAMS] %s=%u out of range [%u, %u]\n", param.name, value, param.minValue, param.maxValue);
+        stats.rejected++;
+        return false;
+    }
+    
+    Preferences prefs;
+    if (prefs.begin(PARAMS_NAMESPACE, false)) {
+        if (isReset) {
+            prefs.remove(param.key);
+        } else {
+            prefs.putUInt(param.key, value);
+        }
+        prefs.end();
+    }
+    
+    // Ghi 32-bit căn lề là nguyên tử trên Xtensa: task khác đọc được cũ hoặc mới, không lẫn
+    values[id] = isReset ? param.defaultValue : value;
+    stats.applied++;
+    DEBUG_PRINTF("[PARAMS] %s = %u%s\n", param.name, values[id], isReset ? " (default)" : "");
+    return true;
+}
+
+uint8_t StationParams::apply(const ConfigUpdate& update) {
+    if (update.revision == 0 || update.revision == revision || mutex == nullptr) {
+        return 0;
+    }
+    
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    stats.updates++;
+    stats.rejected += update.invalid;
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < update.count; i++) {
+        const ConfigEntry& entry = update.entries[i];
+        ParamId id = find(entry.name);
+        if (id == PARAM_COUNT) {
+            DEBUG_PRINTF("[PARAMS] Unknown parameter: %s\n", entry.name);
+            stats.rejected++;
+            continue;
+        }
+        if (store(id, entry.value, entry.reset)) {
+            changed++;
+        }
+    }
+    
+    // Ghi nhận phiên bản kể cả khi có tham số bị từ chối, để không áp dụng lại mỗi
+    // heartbeat; server thấy config_version và số lỗi trong log
+    Preferences prefs;
+    if (prefs.begin(PARAMS_NAMESPACE, false)) {
+        prefs.putUInt(PARAMS_KEY_REVISION, update.revision);
+        prefs.end();
+    }
+    revision = update.revision;
+    xSemaphoreGive(mutex);
+    
+    DEBUG_PRINTF("[PARAMS] Config revision %u: %u changed\n", update.revision, changed);
+    return changed;
+}
+
+bool StationParams::set(const char* name, uint32_t value) {
+    ParamId id = find(name);
+    if (id == PARAM_COUNT || mutex == nullptr) {
+        return false;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool stored = store(id, value, false);
+    xSemaphoreGive(mutex);
+    return stored;
+}
+
+bool StationParams::reset(const char* name) {
+    ParamId id = find(name);
+    if (id == PARAM_COUNT || mutex == nullptr) {
+        return false;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool stored = store(id, 0, true);
+    xSemaphoreGive(mutex);
+    return stored;
+}
+
+void StationParams::printStats() const {
+    DEBUG_PRINTF("[PARAMS] revision=%u updates=%u applied=%u rejected=%u\n",
+                 revision, stats.updates, stats.applied, stats.rejected);
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        DEBUG_PRINTF("  %-24s %8u%s\n", SPECS[i].name, values[i],
+                     values[i] == SPECS[i].defaultValue ? "" : " *");
+    }
+}
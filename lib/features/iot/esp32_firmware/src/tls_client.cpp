@@ -0,0 +1,387 @@
+#include "tls_client.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <lwip/sockets.h>
+#include <mbedtls/error.h>
+
+// Cipher suite TLS 1.2 dùng AES-GCM (AES + GHASH trên phần cứng) và SHA-256/384
+// (SHA phần cứng). Không có ChaCha20-Poly1305: chạy hoàn toàn bằng phần mềm.
+static const int HARDWARE_CIPHERSUITES[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    0
+};
+
+TlsClient::TlsClient()
+    : socketFd(-1), ready(false), haveSession(false), handshaking(false), certificateSeen(false), peeked(-1) {
+    memset(&stats, 0, sizeof(stats));
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_ssl_session_init(&session);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&session);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_entropy_free(&entropy);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ssl_free(&ssl);
+}
+
+bool TlsClient::begin(const char* caPem) {
+    static const char personalization[] = DEVICE_ID;
+    int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char*)personalization, sizeof(personalization) - 1);
+    if (ret != 0) {
+        DEBUG_PRINTF("[TLS] RNG seed failed: -0x%04x\n", -ret);
+        return false;
+    }
+    
+    ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        DEBUG_PRINTF("[TLS] Config failed: -0x%04x\n", -ret);
+        return false;
+    }
+    
+    // Không có CA thì không kết nối: server chưa xác thực không được nhận UID thẻ
+    if (caPem == nullptr || caPem[0] == '\0') {
+        DEBUG_PRINTLN("[TLS] No CA certificate, refusing to connect");
+        return false;
+    }
+    ret = mbedtls_x509_crt_parse(&ca, (const unsigned char*)caPem, strlen(caPem) + 1);
+    if (ret != 0) {
+        DEBUG_PRINTF("[TLS] CA certificate invalid: -0x%04x\n", -ret);
+        return false;
+    }
+    mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    
+    mbedtls_ssl_conf_verify(&conf, verifyCertificate, this);
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+    mbedtls_ssl_conf_ciphersuites(&conf, HARDWARE_CIPHERSUITES);
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) {
+        DEBUG_PRINTF("[TLS] Setup failed: -0x%04x\n", -ret);
+        return false;
+    }
+    mbedtls_ssl_set_bio(&ssl, this, bioSend, bioRecv, nullptr);
+    
+    #if defined(CONFIG_MBEDTLS_HARDWARE_AES) && defined(CONFIG_MBEDTLS_HARDWARE_SHA) && defined(CONFIG_MBEDTLS_HARDWARE_MPI)
+    DEBUG_PRINTLN("[TLS] Crypto: hardware AES/SHA/MPI");
+    #else
+    DEBUG_PRINTLN("[TLS] Warning: mbedTLS built without hardware AES/SHA/MPI");
+    #endif
+    
+    ready = true;
+    return true;
+}
+
+// ============================================
+// Kết nối
+// ============================================
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port, API_TLS_HANDSHAKE_TIMEOUT);
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return connect(ip.toString().c_str(), port, timeout);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, API_TLS_HANDSHAKE_TIMEOUT);
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    stop();
+    if (!ready) {
+        return 0;
+    }
+    
+    if (!openSocket(host, port, timeout) || !handshake(host)) {
+        stats.failedHandshakes++;
+        closeSocket();
+        return 0;
+    }
+    return 1;
+}
+
+bool TlsClient::openSocket(const char* host, uint16_t port, int32_t timeout) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) {
+        DEBUG_PRINT("[TLS] DNS failed: ");
+        DEBUG_PRINTLN(host);
+        return false;
+    }
+    
+    socketFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socketFd < 0) {
+        return false;
+    }
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    
+    // connect() không chặn + select() để có timeout kết nối
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL, 0) | O_NONBLOCK);
+    int ret = ::connect(socketFd, (struct sockaddr*)&addr, sizeof(addr));
+    if (ret < 0 && errno == EINPROGRESS) {
+        fd_set writable;
+        FD_ZERO(&writable);
+        FD_SET(socketFd, &writable);
+        struct timeval tv = {timeout / 1000, (timeout % 1000) * 1000};
+        ret = select(socketFd + 1, nullptr, &writable, nullptr, &tv) == 1 ? 0 : -1;
+    
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (ret == 0 && (getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)) {
+            ret = -1;
+        }
+    }
+    if (ret < 0) {
+        DEBUG_PRINTF("[TLS] TCP connect to %s:%d failed\n", host, port);
+        return false;
+    }
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL, 0) & ~O_NONBLOCK);
+    
+    // Handshake và ghi chờ tối đa API_TLS_HANDSHAKE_TIMEOUT; đọc dữ liệu sau handshake không chặn
+    struct timeval tv = {API_TLS_HANDSHAKE_TIMEOUT / 1000, (API_TLS_HANDSHAKE_TIMEOUT % 1000) * 1000};
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+}
+
+bool TlsClient::handshake(const char* host) {
+    mbedtls_ssl_session_reset(&ssl);
+    mbedtls_ssl_set_hostname(&ssl, host);
+    
+    bool resuming = haveSession && mbedtls_ssl_set_session(&ssl, &session) == 0;
+    certificateSeen = false;
+    handshaking = true;
+    
+    uint32_t start = millis();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+        if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+            millis() - start > API_TLS_HANDSHAKE_TIMEOUT) {
+            break;
+        }
+    }
+    uint32_t elapsed = millis() - start;
+    handshaking = false;
+    
+    if (ret != 0) {
+        char reason[64];
+        mbedtls_strerror(ret, reason, sizeof(reason));
+        DEBUG_PRINTF("[TLS] Handshake failed: -0x%04x %s\n", -ret, reason);
+        if (resuming) {
+            // Session có thể làm handshake hỏng (server đổi khóa ticket...): lần sau làm lại từ đầu
+            clearSession();
+        }
+        return false;
+    }
+    
+    // Server không gửi chứng chỉ = đã resume session
+    bool resumed = resuming && !certificateSeen;
+    if (resumed) {
+        stats.resumedHandshakes++;
+        stats.lastResumedMs = elapsed;
+        stats.totalResumedMs += elapsed;
+    } else {
+        stats.fullHandshakes++;
+        stats.lastFullMs = elapsed;
+        stats.totalFullMs += elapsed;
+    }
+    DEBUG_PRINTF("[TLS] %s handshake %lums (%s)\n", resumed ? "Resumed" : "Full",
+                 (unsigned long)elapsed, mbedtls_ssl_get_ciphersuite(&ssl));
+    
+    // Lưu lại mỗi lần: server có thể cấp ticket mới cả khi resume
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+    return true;
+}
+
+int TlsClient::verifyCertificate(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    static_cast<TlsClient*>(ctx)->certificateSeen = true;
+    return 0;
+}
+
+void TlsClient::clearSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    haveSession = false;
+}
+
+void TlsClient::stop() {
+    if (socketFd >= 0) {
+        mbedtls_ssl_close_notify(&ssl);
+    }
+    closeSocket();
+}
+
+void TlsClient::closeSocket() {
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+    peeked = -1;
+}
+
+uint8_t TlsClient::connected() {
+    if (socketFd < 0) {
+        return 0;
+    }
+    // Xử lý record đang chờ (close_notify của server làm đóng kết nối tại đây)
+    if (available() > 0) {
+        return 1;
+    }
+    if (socketFd < 0) {
+        return 0;
+    }
+    
+    // Server đóng kết nối keep-alive khi rảnh: recv trả 0
+    uint8_t probe;
+    int ret = recv(socketFd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        closeSocket();
+        return 0;
+    }
+    return 1;
+}
+
+// ============================================
+// Đọc / ghi
+// ============================================
+
+int TlsClient::bioSend(void* ctx, const unsigned char* buf, size_t len) {
+    int fd = static_cast<TlsClient*>(ctx)->socketFd;
+    int ret = send(fd, buf, len, 0);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    return errno == ECONNRESET || errno == EPIPE ? MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsClient::bioRecv(void* ctx, unsigned char* buf, size_t len) {
+    TlsClient* self = static_cast<TlsClient*>(ctx);
+    int ret = recv(self->socketFd, buf, len, self->handshaking ? 0 : MSG_DONTWAIT);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    return errno == ECONNRESET ? MBEDTLS_ERR_NET_CONN_RESET : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+size_t TlsClient::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    size_t sent = 0;
+    uint32_t start = millis();
+    
+    while (socketFd >= 0 && sent < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+        } else if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+                   millis() - start > API_TLS_HANDSHAKE_TIMEOUT) {
+            closeSocket();
+            break;
+        }
+    }
+    return sent;
+}
+
+int TlsClient::available() {
+    if (socketFd < 0) {
+        return peeked >= 0 ? 1 : 0;
+    }
+    
+    size_t pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (pending == 0) {
+        // Giải mã record mới nếu socket có dữ liệu (không chặn)
+        int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+        if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            closeSocket();
+            return peeked >= 0 ? 1 : 0;
+        }
+        pending = mbedtls_ssl_get_bytes_avail(&ssl);
+    }
+    return pending + (peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    
+    size_t offset = 0;
+    if (peeked >= 0) {
+        buf[offset++] = (uint8_t)peeked;
+        peeked = -1;
+        if (offset == size) {
+            return offset;
+        }
+    }
+    if (socketFd < 0) {
+        return offset > 0 ? (int)offset : -1;
+    }
+    
+    int ret = mbedtls_ssl_read(&ssl, buf + offset, size - offset);
+    if (ret > 0) {
+        return offset + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        closeSocket();
+    }
+    return offset > 0 ? (int)offset : -1;
+}
+
+int TlsClient::peek() {
+    if (peeked < 0) {
+        uint8_t data;
+        if (socketFd >= 0 && mbedtls_ssl_read(&ssl, &data, 1) == 1) {
+            peeked = data;
+        }
+    }
+    return peeked;
+}
+
+void TlsClient::flush() {
+    // Mỗi write() đã gửi trọn bản ghi TLS, không có buffer ghi nào để đẩy
+}
+
+void TlsClient::printStats() const {
+    DEBUG_PRINTF("[TLS] full=%lu (last %lums, avg %lums) resumed=%lu (last %lums, avg %lums) failed=%lu\n",
+                 (unsigned long)stats.fullHandshakes, (unsigned long)stats.lastFullMs,
+                 (unsigned long)(stats.fullHandshakes > 0 ? stats.totalFullMs / stats.fullHandshakes : 0),
+                 (unsigned long)stats.resumedHandshakes, (unsigned long)stats.lastResumedMs,
+                 (unsigned long)(stats.resumedHandshakes > 0 ? stats.totalResumedMs / stats.resumedHandshakes : 0),
+                 (unsigned long)stats.failedHandshakes);
+}
@@ -0,0 +1,200 @@
+#include "uid_set.h"
+#include <string.h>
+
+#define BLOOM_WORDS (INVENTORY_BLOOM_BITS / 32)
+
+static_assert((INVENTORY_BLOOM_BITS & (INVENTORY_BLOOM_BITS - 1)) == 0, "INVENTORY_BLOOM_BITS must be a power of 2");
+
+UidSet::UidSet(uint32_t* bloom, UidKey* keys, uint32_t capacity)
+    : bloom(bloom), keys(keys), capacity(capacity), count(0), sortedCount(0) {
+    clear();
+}
+
+void UidSet::clear() {
+    if (bloom != nullptr) {
+        memset(bloom, 0, BLOOM_WORDS * sizeof(uint32_t));
+    }
+    count = 0;
+    sortedCount = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+size_t UidSet::bytesUsed() const {
+    return BLOOM_WORDS * sizeof(uint32_t) + (size_t)capacity * sizeof(UidKey);
+}
+
+UidKey UidSet::makeKey(const uint8_t* uid, uint8_t length) {
+    if (length != 4 && length != 7) {
+        return 0;
+    }
+    UidKey key = (UidKey)length << 56;
+    for (uint8_t i = 0; i < length; i++) {
+        key |= (UidKey)uid[i] << (8 * (6 - i));
+    }
+    return key;
+}
+
+uint8_t UidSet::keyToUid(UidKey key, uint8_t uid[7]) {
+    uint8_t length = key >> 56;
+    if (length != 4 && length != 7) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        uid[i] = (key >> (8 * (6 - i))) & 0xFF;
+    }
+    return length;
+}
+
+// Double hashing từ một lần trộn 64-bit (finalizer của splitmix64)
+void UidSet::bloomPositions(UidKey key, uint32_t positions[INVENTORY_BLOOM_HASHES]) const {
+    uint64_t h = key;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    for (uint8_t i = 0; i < INVENTORY_BLOOM_HASHES; i++) {
+        positions[i] = (h1 + i * h2) & (INVENTORY_BLOOM_BITS - 1);
+    }
+}
+
+bool UidSet::search(UidKey key) const {
+    uint32_t low = 0;
+    uint32_t high = sortedCount;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (keys[mid] < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < sortedCount && keys[low] == key) {
+        return true;
+    }
+    for (uint32_t i = sortedCount; i < count; i++) {
+        if (keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UidSet::contains(UidKey key) {
+    stats.lookups++;
+    uint32_t positions[INVENTORY_BLOOM_HASHES];
+    bloomPositions(key, positions);
+    for (uint8_t i = 0; i < INVENTORY_BLOOM_HASHES; i++) {
+        if ((bloom[positions[i] / 32] & (1u << (positions[i] % 32))) == 0) {
+            stats.bloomRejects++;
+            return false;
+        }
+    }
+    if (search(key)) {
+        return true;
+    }
+    stats.falsePositives++;
+    return false;
+}
+
+UidInsert UidSet::insert(UidKey key) {
+    if (contains(key)) {
+        return UID_DUPLICATE;
+    }
+    if (count >= capacity) {
+        return UID_SET_FULL;
+    }
+    
+    uint32_t positions[INVENTORY_BLOOM_HASHES];
+    bloomPositions(key, positions);
+    for (uint8_t i = 0; i < INVENTORY_BLOOM_HASHES; i++) {
+        bloom[positions[i] / 32] |= 1u << (positions[i] % 32);
+    }
+    keys[count++] = key;
+    if (count - sortedCount >= INVENTORY_SET_TAIL || count == capacity) {
+        mergeTail();
+    }
+    return UID_INSERTED;
+}
+
+void UidSet::mergeTail() {
+    // Sắp xếp đuôi (ngắn, insertion sort) rồi trộn từ cuối về để không cần mảng phụ lớn
+    UidKey tail[INVENTORY_SET_TAIL];
+    uint32_t tailCount = count - sortedCount;
+    memcpy(tail, keys + sortedCount, tailCount * sizeof(UidKey));
+    for (uint32_t i = 1; i < tailCount; i++) {
+        UidKey value = tail[i];
+        uint32_t j = i;
+        while (j > 0 && tail[j - 1] > value) {
+            tail[j] = tail[j - 1];
+            j--;
+        }
+        tail[j] = value;
+    }
+    
+    uint32_t write = count;
+    uint32_t left = sortedCount;
+    uint32_t right = tailCount;
+    while (right > 0) {
+        if (left > 0 && keys[left - 1] > tail[right - 1]) {
+            keys[--write] = keys[--left];
+        } else {
+            keys[--write] = tail[--right];
+        }
+    }
+    sortedCount = count;
+    stats.merges++;
+}
+
+size_t UidSet::encodeBatch(UidKey* keys, uint16_t count, uint8_t* output, size_t capacity) {
+    for (uint16_t i = 1; i < count; i++) {
+        UidKey value = keys[i];
+        uint16_t j = i;
+        while (j > 0 && keys[j - 1] > value) {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = value;
+    }
+    
+    size_t length = 0;
+    UidKey previous = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint64_t delta = keys[i] - previous;
+        previous = keys[i];
+        do {
+            if (length >= capacity) {
+                return 0;
+            }
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            output[length++] = byte | (delta != 0 ? 0x80 : 0);
+        } while (delta != 0);
+    }
+    return length;
+}
+
+int UidSet::decodeBatch(const uint8_t* data, size_t length, UidKey* keys, uint16_t maxKeys) {
+    int count = 0;
+    UidKey previous = 0;
+    size_t pos = 0;
+    while (pos < length) {
+        uint64_t delta = 0;
+        uint8_t shift = 0;
+        uint8_t byte;
+        do {
+            if (pos >= length || shift > 63) {
+                return -1;
+            }
+            byte = data[pos++];
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (count >= maxKeys) {
+            return -1;
+        }
+        previous += delta;
+        keys[count++] = previous;
+    }
+    return count;
+}
@@ -0,0 +1,228 @@
+#include "usb_barcode_scanner.h"
+
+UsbBarcodeScanner usbBarcodeScanner;
+
+// HID class (USB HID 1.11): interface boot keyboard và request SET_PROTOCOL
+#define HID_SUBCLASS_BOOT 0x01
+#define HID_PROTOCOL_KEYBOARD 0x01
+#define HID_REQUEST_SET_PROTOCOL 0x0B
+#define HID_PROTOCOL_BOOT 0x00
+
+// Task USB thức dậy ít nhất mỗi nhịp này để kết thúc mã theo thời gian chờ
+#define USB_EVENT_TIMEOUT_MS 10
+
+UsbBarcodeScanner::UsbBarcodeScanner()
+    : decoder(barcodeReady, this), barcodes(nullptr), taskHandle(nullptr), client(nullptr), device(nullptr),
+      transfer(nullptr), control(nullptr), interfaceNumber(0), pendingAddress(0), inFlight(0), deviceGone(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool UsbBarcodeScanner::begin() {
+    barcodes = xQueueCreate(USB_SCANNER_QUEUE, REQUEST_DATA_LEN);
+    if (barcodes == nullptr) {
+        return false;
+    }
+    
+    usb_host_config_t hostConfig = {};
+    hostConfig.intr_flags = ESP_INTR_FLAG_LEVEL1;
+    if (usb_host_install(&hostConfig) != ESP_OK) {
+        DEBUG_PRINTLN("[USB] Host install failed!");
+        return false;
+    }
+    
+    BaseType_t created = xTaskCreatePinnedToCore(taskEntry, "usb", USB_SCANNER_TASK_STACK, this,
+                                                 USB_SCANNER_TASK_PRIORITY, &taskHandle, USB_SCANNER_TASK_CORE);
+    if (created != pdPASS) {
+        DEBUG_PRINTLN("[USB] Task creation failed!");
+        return false;
+    }
+    DEBUG_PRINTLN("[USB] Waiting for barcode scanner");
+    return true;
+}
+
+bool UsbBarcodeScanner::poll(char* barcode, size_t capacity) {
+    char item[REQUEST_DATA_LEN];
+    if (barcodes == nullptr || xQueueReceive(barcodes, item, 0) != pdTRUE) {
+        return false;
+    }
+    strlcpy(barcode, item, capacity);
+    return true;
+}
+
+void UsbBarcodeScanner::taskEntry(void* param) {
+    static_cast<UsbBarcodeScanner*>(param)->run();
+}
+
+void UsbBarcodeScanner::run() {
+    usb_host_client_config_t clientConfig = {};
+    clientConfig.is_synchronous = false;
+    clientConfig.max_num_event_msg = 5;
+    clientConfig.async.client_event_callback = clientEvent;
+    clientConfig.async.callback_arg = this;
+    if (usb_host_client_register(&clientConfig, &client) != ESP_OK) {
+        DEBUG_PRINTLN("[USB] Client register failed!");
+        vTaskDelete(nullptr);
+        return;
+    }
+    
+    TickType_t timeout = pdMS_TO_TICKS(USB_EVENT_TIMEOUT_MS);
+    while (true) {
+        // Task này vừa là daemon của thư viện host vừa là client duy nhất:
+        // callback sự kiện và callback transfer đều chạy ở đây, không cần khóa
+        uint32_t flags = 0;
+        usb_host_lib_handle_events(timeout, &flags);
+        usb_host_client_handle_events(client, timeout);
+    
+        if (pendingAddress != 0) {
+            open(pendingAddress);
+            pendingAddress = 0;
+        }
+        if (deviceGone && inFlight == 0) {
+            close();
+        }
+        decoder.tick(millis());
+    }
+}
+
+void UsbBarcodeScanner::clientEvent(const usb_host_client_event_msg_t* message, void* param) {
+    UsbBarcodeScanner* self = static_cast<UsbBarcodeScanner*>(param);
+    if (message->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
+        if (self->device == nullptr) {
+            self->pendingAddress = message->new_dev.address;
+        }
+    } else if (message->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
+        if (message->dev_gone.dev_hdl == self->device) {
+            self->deviceGone = true;
+        }
+    }
+}
+
+void UsbBarcodeScanner::open(uint8_t address) {
+    if (usb_host_device_open(client, address, &device) != ESP_OK) {
+        device = nullptr;
+        return;
+    }
+    
+    const usb_config_desc_t* config = nullptr;
+    if (usb_host_get_active_config_descriptor(device, &config) != ESP_OK || !claimKeyboard(config)) {
+        stats.unsupported++;
+        DEBUG_PRINTLN("[USB] Device is not a HID keyboard, ignored");
+        usb_host_device_close(client, device);
+        device = nullptr;
+        return;
+    }
+    
+    // Chuyển sang boot protocol để report luôn có dạng 8 byte cố định
+    usb_setup_packet_t* setup = reinterpret_cast<usb_setup_packet_t*>(control->data_buffer);
+    setup->bmRequestType = USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_CLASS |
+                           USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    setup->bRequest = HID_REQUEST_SET_PROTOCOL;
+    setup->wValue = HID_PROTOCOL_BOOT;
+    setup->wIndex = interfaceNumber;
+    setup->wLength = 0;
+    control->num_bytes = sizeof(usb_setup_packet_t);
+    control->device_handle = device;
+    control->bEndpointAddress = 0;
+    control->callback = transferDone;
+    control->context = this;
+    if (usb_host_transfer_submit_control(client, control) == ESP_OK) {
+        inFlight++;
+    }
+    
+    stats.connects++;
+    decoder.reset();
+    DEBUG_PRINTF("[USB] Barcode scanner connected (address %u)\n", address);
+}
+
+// Tìm interface HID boot keyboard có endpoint interrupt IN, claim và cấp transfer
+bool UsbBarcodeScanner::claimKeyboard(const usb_config_desc_t* config) {
+    for (uint8_t number = 0; number < config->bNumInterfaces; number++) {
+        int offset = 0;
+        const usb_intf_desc_t* interface = usb_parse_interface_descriptor(config, number, 0, &offset);
+        if (interface == nullptr || interface->bInterfaceClass != USB_CLASS_HID ||
+            interface->bInterfaceSubClass != HID_SUBCLASS_BOOT ||
+            interface->bInterfaceProtocol != HID_PROTOCOL_KEYBOARD) {
+            continue;
+        }
+    
+        for (uint8_t index = 0; index < interface->bNumEndpoints; index++) {
+            int endpointOffset = offset;
+            const usb_ep_desc_t* endpoint = usb_parse_endpoint_descriptor_by_index(interface, index,
+                                                                                   config->wTotalLength,
+                                                                                   &endpointOffset);
+            if (endpoint == nullptr || !USB_EP_DESC_GET_EP_DIR(endpoint) ||
+                (endpoint->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK) != USB_BM_ATTRIBUTES_XFER_INT) {
+                continue;
+            }
+            if (usb_host_interface_claim(client, device, number, 0) != ESP_OK) {
+                return false;
+            }
+            if (usb_host_transfer_alloc(endpoint->wMaxPacketSize, 0, &transfer) != ESP_OK ||
+                usb_host_transfer_alloc(sizeof(usb_setup_packet_t), 0, &control) != ESP_OK) {
+                usb_host_transfer_free(transfer);
+                transfer = nullptr;
+                usb_host_interface_release(client, device, number);
+                return false;
+            }
+            interfaceNumber = number;
+            transfer->device_handle = device;
+            transfer->bEndpointAddress = endpoint->bEndpointAddress;
+            transfer->num_bytes = endpoint->wMaxPacketSize;
+            transfer->callback = transferDone;
+            transfer->context = this;
+            return true;
+        }
+    }
+    return false;
+}
+
+void UsbBarcodeScanner::transferDone(usb_transfer_t* done) {
+    UsbBarcodeScanner* self = static_cast<UsbBarcodeScanner*>(done->context);
+    self->inFlight--;
+    if (self->deviceGone) {
+        return;
+    }
+    
+    if (done->status == USB_TRANSFER_STATUS_COMPLETED) {
+        if (done == self->transfer) {
+            self->decoder.feed(done->data_buffer, done->actual_num_bytes, millis());
+        }
+    } else if (done->status != USB_TRANSFER_STATUS_NO_DEVICE) {
+        // Máy quét không hỗ trợ SET_PROTOCOL (STALL) vẫn gửi report boot được: đọc tiếp
+        self->stats.transferErrors++;
+    }
+    
+    // Sau SET_PROTOCOL (dù lỗi) bắt đầu đọc report, sau mỗi report đọc tiếp
+    if (usb_host_transfer_submit(self->transfer) == ESP_OK) {
+        self->inFlight++;
+    }
+}
+
+void UsbBarcodeScanner::barcodeReady(const char* barcode, uint8_t length, void* param) {
+    UsbBarcodeScanner* self = static_cast<UsbBarcodeScanner*>(param);
+    char item[REQUEST_DATA_LEN];
+    memcpy(item, barcode, length + 1);
+    if (xQueueSendToBack(self->barcodes, item, 0) != pdTRUE) {
+        self->stats.dropped++;
+    }
+}
+
+void UsbBarcodeScanner::close() {
+    usb_host_transfer_free(transfer);
+    usb_host_transfer_free(control);
+    transfer = nullptr;
+    control = nullptr;
+    usb_host_interface_release(client, device, interfaceNumber);
+    usb_host_device_close(client, device);
+    device = nullptr;
+    deviceGone = false;
+    decoder.reset();
+    DEBUG_PRINTLN("[USB] Barcode scanner disconnected");
+}
+
+void UsbBarcodeScanner::printStats() const {
+    const HidDecoderStats& keys = decoder.getStats();
+    DEBUG_PRINTF("[USB] scanner=%s connects=%u barcodes=%u (timeout %u) discarded=%u overflow=%u dropped=%u errors=%u\n",
+                 isConnected() ? "connected" : "none", stats.connects, keys.barcodes, keys.timeoutBarcodes,
+                 keys.discarded, keys.overflows, stats.dropped, stats.transferErrors);
+}
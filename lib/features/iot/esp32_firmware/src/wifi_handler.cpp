@@ -1,4 +1,5 @@
 #include "wifi_handler.h"
+#include "station_params.h"
 
 WiFiHandler::WiFiHandler() : lastCheckTime(0) {}
 
@@ -37,8 +38,8 @@ bool WiFiHandler::isConnected() {
 void WiFiHandler::checkConnection() {
     unsigned long currentTime = millis();
     
-    // Chỉ check sau mỗi checkInterval
-    if (currentTime - lastCheckTime < checkInterval) {
+    // Chỉ check sau mỗi wifi_check_interval_ms
+    if (currentTime - lastCheckTime < stationParams.get(PARAM_WIFI_CHECK_INTERVAL)) {
         return;
     }
     
@@ -57,3 +58,7 @@ String WiFiHandler::getIPAddress() {
 int WiFiHandler::getSignalStrength() {
     return WiFi.RSSI();
 }
+
+uint8_t WiFiHandler::getChannel() {
+    return WiFi.channel();
+}
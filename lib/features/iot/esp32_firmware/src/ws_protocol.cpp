@@ -0,0 +1,187 @@
+#include "ws_protocol.h"
+#include <stdio.h>
+#include <strings.h>
+#include <mbedtls/md.h>
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_LEN 24                  // base64 của nonce 16 byte
+
+namespace WsProtocol {
+
+static void base64Encode(const uint8_t* data, size_t length, char* output) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t pos = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t block = data[i] << 16;
+        if (i + 1 < length) {
+            block |= data[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            block |= data[i + 2];
+        }
+        output[pos++] = alphabet[(block >> 18) & 0x3F];
+        output[pos++] = alphabet[(block >> 12) & 0x3F];
+        output[pos++] = i + 1 < length ? alphabet[(block >> 6) & 0x3F] : '=';
+        output[pos++] = i + 2 < length ? alphabet[block & 0x3F] : '=';
+    }
+    output[pos] = '\0';
+}
+
+// Giá trị header (danh sách phân cách bằng dấu phẩy) có chứa token, không phân biệt hoa thường
+static bool hasToken(const char* value, size_t length, const char* token) {
+    size_t tokenLength = strlen(token);
+    size_t i = 0;
+    while (i < length) {
+        while (i < length && (value[i] == ' ' || value[i] == ',')) {
+            i++;
+        }
+        size_t start = i;
+        while (i < length && value[i] != ',') {
+            i++;
+        }
+        size_t end = i;
+        while (end > start && value[end - 1] == ' ') {
+            end--;
+        }
+        if (end - start == tokenLength && strncasecmp(value + start, token, tokenLength) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseUpgrade(const char* request, char acceptKey[WS_ACCEPT_KEY_LEN]) {
+    if (strncmp(request, "GET ", 4) != 0) {
+        return false;
+    }
+    
+    bool upgrade = false;
+    bool connection = false;
+    bool version = false;
+    const char* key = nullptr;
+    
+    // Bỏ dòng request, duyệt từng header "Name: value\r\n"
+    const char* line = strstr(request, "\r\n");
+    while (line != nullptr && line[2] != '\r' && line[2] != '\0') {
+        line += 2;
+        const char* end = strstr(line, "\r\n");
+        if (end == nullptr) {
+            return false;
+        }
+        const char* colon = (const char*)memchr(line, ':', end - line);
+        if (colon != nullptr) {
+            size_t nameLength = colon - line;
+            const char* value = colon + 1;
+            while (value < end && *value == ' ') {
+                value++;
+            }
+            size_t valueLength = end - value;
+    
+            if (nameLength == 7 && strncasecmp(line, "Upgrade", 7) == 0) {
+                upgrade = hasToken(value, valueLength, "websocket");
+            } else if (nameLength == 10 && strncasecmp(line, "Connection", 10) == 0) {
+                connection = hasToken(value, valueLength, "upgrade");
+            } else if (nameLength == 21 && strncasecmp(line, "Sec-WebSocket-Version", 21) == 0) {
+                version = hasToken(value, valueLength, "13");
+            } else if (nameLength == 17 && strncasecmp(line, "Sec-WebSocket-Key", 17) == 0) {
+                while (valueLength > 0 && value[valueLength - 1] == ' ') {
+                    valueLength--;
+                }
+                key = valueLength == WS_KEY_LEN ? value : nullptr;
+            }
+        }
+        line = end;
+    }
+    if (!upgrade || !connection || !version || key == nullptr) {
+        return false;
+    }
+    
+    // Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+    char input[WS_KEY_LEN + sizeof(WS_GUID)];
+    memcpy(input, key, WS_KEY_LEN);
+    memcpy(input + WS_KEY_LEN, WS_GUID, sizeof(WS_GUID));
+    uint8_t digest[20];
+    if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), (const uint8_t*)input,
+                   WS_KEY_LEN + sizeof(WS_GUID) - 1, digest) != 0) {
+        return false;
+    }
+    base64Encode(digest, sizeof(digest), acceptKey);
+    return true;
+}
+
+size_t buildHandshakeResponse(const char* acceptKey, char* output, size_t capacity) {
+    int length = snprintf(output, capacity,
+                          "HTTP/1.1 101 Switching Protocols\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: %s\r\n\r\n", acceptKey);
+    return length > 0 && (size_t)length < capacity ? length : 0;
+}
+
+size_t frameHeader(WsOpcode opcode, size_t payloadLength, uint8_t output[WS_MAX_FRAME_HEADER]) {
+    output[0] = 0x80 | opcode;
+    if (payloadLength < 126) {
+        output[1] = (uint8_t)payloadLength;
+        return 2;
+    }
+    if (payloadLength <= 0xFFFF) {
+        output[1] = 126;
+        output[2] = (uint8_t)(payloadLength >> 8);
+        output[3] = (uint8_t)payloadLength;
+        return 4;
+    }
+    output[1] = 127;
+    for (int i = 0; i < 8; i++) {
+        output[2 + i] = (uint8_t)((uint64_t)payloadLength >> (56 - 8 * i));
+    }
+    return 10;
+}
+
+int parseClientFrame(uint8_t* data, size_t length, WsFrame& frame) {
+    if (length < 2) {
+        return 0;
+    }
+    // RSV phải bằng 0 (không hỗ trợ extension), client bắt buộc mask
+    if ((data[0] & 0x70) != 0 || (data[1] & 0x80) == 0) {
+        return -1;
+    }
+    
+    size_t header = 2;
+    uint64_t payloadLength = data[1] & 0x7F;
+    if (payloadLength == 126) {
+        if (length < 4) {
+            return 0;
+        }
+        payloadLength = (data[2] << 8) | data[3];
+        header = 4;
+    } else if (payloadLength == 127) {
+        if (length < 10) {
+            return 0;
+        }
+        payloadLength = 0;
+        for (int i = 0; i < 8; i++) {
+            payloadLength = (payloadLength << 8) | data[2 + i];
+        }
+        header = 10;
+    }
+    
+    frame.opcode = (WsOpcode)(data[0] & 0x0F);
+    frame.fin = (data[0] & 0x80) != 0;
+    // Frame điều khiển tối đa 125 byte và không được chia nhỏ
+    if (frame.opcode >= WS_OPCODE_CLOSE && (payloadLength > 125 || !frame.fin)) {
+        return -1;
+    }
+    if (payloadLength > length || header + 4 + payloadLength > length) {
+        return 0;
+    }
+    
+    const uint8_t* mask = data + header;
+    frame.payload = data + header + 4;
+    frame.length = (size_t)payloadLength;
+    for (size_t i = 0; i < frame.length; i++) {
+        frame.payload[i] ^= mask[i & 3];
+    }
+    return (int)(header + 4 + frame.length);
+}
+
+} // namespace WsProtocol
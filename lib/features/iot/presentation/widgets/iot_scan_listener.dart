@@ -57,6 +57,11 @@ class IoTScanListener extends StatelessWidget {
       );
       onScanError?.call(event.error ?? 'Unknown error');
     }
+
+    // Thời gian từ lúc chạm thẻ tới khi form đã nhận dữ liệu, tách theo chặng
+    if (event.traceId != null) {
+      print(event.traceSummary(DateTime.now()));
+    }
   }
 
   void _showSuccessSnackBar(BuildContext context, String message) {
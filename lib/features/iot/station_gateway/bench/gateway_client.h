@@ -0,0 +1,265 @@
+// Client giả dùng chung cho các bench của gateway: trạm (POST /events) và subscriber
+// (WebSocket như IoTWebSocketDataSource) nối tới GatewayServer chạy trong tiến trình
+// qua loopback, cùng sự kiện quét mẫu mang số thứ tự + lúc gửi.
+#ifndef GATEWAY_CLIENT_H
+#define GATEWAY_CLIENT_H
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "gateway_server.h"
+
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int connectLocal(uint16_t port, int receiveBuffer = 0) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (receiveBuffer > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+inline bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+// Nhận thêm dữ liệu vào buffer, false nếu hết thời gian hoặc server đóng
+inline bool receiveMore(int fd, std::string& buffer, int timeoutMs) {
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, timeoutMs) <= 0) {
+        return false;
+    }
+    char chunk[16384];
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) {
+        return false;
+    }
+    buffer.append(chunk, n);
+    return true;
+}
+
+// Một response HTTP trọn vẹn (header + body theo Content-Length) ở đầu buffer
+inline bool takeResponse(std::string& buffer, std::string& response) {
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return false;
+    }
+    size_t bodyLength = 0;
+    size_t field = buffer.find("Content-Length: ");
+    if (field != std::string::npos && field < headerEnd) {
+        bodyLength = strtoul(buffer.c_str() + field + 16, nullptr, 10);
+    }
+    if (buffer.size() < headerEnd + 4 + bodyLength) {
+        return false;
+    }
+    response = buffer.substr(0, headerEnd + 4 + bodyLength);
+    buffer.erase(0, response.size());
+    return true;
+}
+
+inline std::string readResponse(int fd, std::string& buffer) {
+    std::string response;
+    while (!takeResponse(buffer, response)) {
+        if (!receiveMore(fd, buffer, 2000)) {
+            return std::string();
+        }
+    }
+    return response;
+}
+
+inline std::string postRequest(const std::string& body) {
+    return "POST /events HTTP/1.1\r\nHost: gateway\r\nContent-Type: application/json\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Một request trên kết nối mới, trả về response
+inline std::string exchange(uint16_t port, const std::string& request) {
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::string response = fd >= 0 && sendAll(fd, request) ? readResponse(fd, buffer) : std::string();
+    if (fd >= 0) {
+        close(fd);
+    }
+    return response;
+}
+
+// Mở WebSocket như IoTWebSocketDataSource, -1 nếu handshake lỗi. Frame tới cùng
+// response 101 (hello/phát lại) được để lại trong rest
+inline int subscribe(uint16_t port, const char* target, int receiveBuffer = 0, std::string* rest = nullptr) {
+    int fd = connectLocal(port, receiveBuffer);
+    if (fd < 0) {
+        return -1;
+    }
+    std::string request = std::string("GET ") + target + " HTTP/1.1\r\n"
+                          "Host: gateway\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    std::string buffer;
+    if (!sendAll(fd, request) || readResponse(fd, buffer).find("101 Switching Protocols") == std::string::npos) {
+        close(fd);
+        return -1;
+    }
+    if (rest != nullptr) {
+        *rest = buffer;
+    }
+    return fd;
+}
+
+// Frame server → client (không mask) ở đầu buffer
+inline bool takeFrame(std::string& buffer, uint8_t& opcode, std::string& payload) {
+    if (buffer.size() < 2) {
+        return false;
+    }
+    const uint8_t* data = (const uint8_t*)buffer.data();
+    size_t header = 2;
+    uint64_t length = data[1] & 0x7F;
+    if (length == 126) {
+        if (buffer.size() < 4) {
+            return false;
+        }
+        length = (data[2] << 8) | data[3];
+        header = 4;
+    } else if (length == 127) {
+        if (buffer.size() < 10) {
+            return false;
+        }
+        length = 0;
+        for (int i = 0; i < 8; i++) {
+            length = (length << 8) | data[2 + i];
+        }
+        header = 10;
+    }
+    if (buffer.size() < header + length) {
+        return false;
+    }
+    opcode = data[0] & 0x0F;
+    payload.assign(buffer, header, length);
+    buffer.erase(0, header + length);
+    return true;
+}
+
+// Mọi frame tới trong timeoutMs (tính từ frame gần nhất)
+inline std::vector<std::string> readFrames(int fd, std::string& buffer, int timeoutMs,
+                                           std::vector<uint8_t>* opcodes = nullptr) {
+    std::vector<std::string> frames;
+    while (true) {
+        uint8_t opcode;
+        std::string payload;
+        while (takeFrame(buffer, opcode, payload)) {
+            frames.push_back(payload);
+            if (opcodes != nullptr) {
+                opcodes->push_back(opcode);
+            }
+        }
+        if (!receiveMore(fd, buffer, timeoutMs)) {
+            return frames;
+        }
+    }
+}
+
+// Frame client → server có mask (như app gửi lên)
+inline std::string maskedFrame(WsOpcode opcode, const std::string& payload) {
+    const uint8_t mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+    std::string out;
+    out += (char)(0x80 | opcode);
+    out += (char)(0x80 | payload.size());
+    out.append((const char*)mask, 4);
+    for (size_t i = 0; i < payload.size(); i++) {
+        out += (char)(payload[i] ^ mask[i & 3]);
+    }
+    return out;
+}
+
+// Sự kiện giống ApiCodec::createStudentEvent; "bench" mang số thứ tự và lúc gửi
+inline std::string scanEvent(const std::string& deviceId, uint64_t sequence, uint64_t sentNs,
+                             const char* nestedDeviceId = "ESP32-S3-HUB") {
+    char json[768];
+    snprintf(json, sizeof(json),
+             "{\"device_id\":\"%s\",\"scan_type\":\"student_card\",\"scan_data\":\"04A1B2C3\","
+             "\"success\":true,\"data\":{\"student_id\":\"SV2021%05llu\",\"full_name\":\"Nguyễn Văn An\","
+             "\"class_name\":\"CNTT-K62\",\"device_id\":\"%s\",\"active_loans\":2},\"error\":null,"
+             "\"timestamp\":\"2026-10-19T08:15:42.120Z\",\"trace\":{\"id\":\"4bf92f3577b34da6a3ce929d0e0e4736\","
+             "\"stages_ms\":{\"sent\":3,\"response\":41,\"published\":42},\"server_ms\":18},"
+             "\"bench\":{\"seq\":%llu,\"ns\":%llu}}",
+             deviceId.c_str(), (unsigned long long)(sequence % 100000), nestedDeviceId,
+             (unsigned long long)sequence, (unsigned long long)sentNs);
+    return json;
+}
+
+inline bool benchFields(const std::string& payload, uint64_t& sequence, uint64_t& sentNs) {
+    size_t field = payload.find("\"bench\":{\"seq\":");
+    unsigned long long seq;
+    unsigned long long ns;
+    if (field == std::string::npos || sscanf(payload.c_str() + field, "\"bench\":{\"seq\":%llu,\"ns\":%llu", &seq, &ns) != 2) {
+        return false;
+    }
+    sequence = seq;
+    sentNs = ns;
+    return true;
+}
+
+inline bool hasSequence(const std::vector<std::string>& frames, size_t index, uint64_t sequence) {
+    uint64_t seq;
+    uint64_t ns;
+    return index < frames.size() && benchFields(frames[index], seq, ns) && seq == sequence;
+}
+
+// Server chạy trên thread riêng trong suốt một kiểm tra
+struct RunningGateway {
+    GatewayServer server;
+    std::thread thread;
+    
+    explicit RunningGateway(const GatewayConfig& config) : server(config) {
+        if (server.begin()) {
+            thread = std::thread([this] { server.run(); });
+        }
+    }
+    
+    // Dừng trước khi đọc stats (stats chỉ thuộc thread của server)
+    void stop() {
+        if (thread.joinable()) {
+            server.stop();
+            thread.join();
+        }
+    }
+    
+    ~RunningGateway() { stop(); }
+};
+
+#endif // GATEWAY_CLIENT_H
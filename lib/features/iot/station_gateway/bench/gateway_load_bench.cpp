@@ -0,0 +1,405 @@
+// Gateway trên máy host: GatewayServer chạy trong tiến trình, trạm giả (POST /events)
+// và subscriber giả (WebSocket) nối qua loopback. Kiểm tra định tuyến theo device_id,
+// lỗi request, ping/close, keep-alive, subscriber chậm bị ngắt mà subscriber khác vẫn
+// nhận đủ; rồi đo tải với hàng nghìn subscriber: sự kiện/s gateway nhận, frame/s phát
+// ra, số sendmsg mỗi frame và độ trễ từ lúc trạm gửi tới khi subscriber đọc được
+// (khi bão hòa và ở nhịp quét đều).
+//
+//   gateway_load_bench [subscribers] [events] [devices]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+#include "gateway_client.h"
+
+#define PACED_RATE 200                 // Sự kiện/s ở pha đo độ trễ (cả thư viện quét cùng lúc)
+#define EVENT_WINDOW 32                // Sự kiện chưa tới hết subscriber tối đa ở pha bão hòa
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-52s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// ============================================
+// Kiểm tra
+// ============================================
+
+static void checkRouting() {
+    printf("Routing\n");
+    GatewayConfig config;
+    config.port = 0;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    int one = subscribe(port, "/ws?device_id=ST-1");
+    int two = subscribe(port, "/ws?device_id=ST-2,ST-1&device_id=ST-2");
+    int all = subscribe(port, "/ws");
+    expect(one >= 0 && two >= 0 && all >= 0, "three subscribers upgraded");
+    
+    bool posted = exchange(port, postRequest(scanEvent("ST-1", 1, 0))).find("202 Accepted") != std::string::npos;
+    posted &= exchange(port, postRequest(scanEvent("ST-2", 2, 0))).find("202 Accepted") != std::string::npos;
+    // device_id lồng trong "data" không được dùng để định tuyến
+    posted &= exchange(port, postRequest(scanEvent("ST-3", 3, 0, "ST-1"))).find("202 Accepted") != std::string::npos;
+    expect(posted, "POST /events -> 202");
+    
+    std::string bufferOne;
+    std::string bufferTwo;
+    std::string bufferAll;
+    std::vector<std::string> framesOne = readFrames(one, bufferOne, 200);
+    std::vector<std::string> framesTwo = readFrames(two, bufferTwo, 200);
+    std::vector<std::string> framesAll = readFrames(all, bufferAll, 200);
+    expect(framesOne.size() == 1 && hasSequence(framesOne, 0, 1), "device_id=ST-1 gets only ST-1");
+    expect(framesTwo.size() == 2 && hasSequence(framesTwo, 0, 1) && hasSequence(framesTwo, 1, 2),
+           "two devices (duplicate ignored) get both once");
+    expect(framesAll.size() == 3 && hasSequence(framesAll, 2, 3), "no filter gets every station");
+    // Payload nguyên văn, chỉ thêm "seq" của trạm vào đầu object
+    expect(framesAll.size() == 3 && framesAll[0] == "{\"seq\":1," + scanEvent("ST-1", 1, 0).substr(1),
+           "payload forwarded byte for byte (plus seq)");
+    
+    expect(exchange(port, postRequest("not json")).find("400 Bad Request") != std::string::npos,
+           "malformed body -> 400");
+    expect(exchange(port, postRequest("{\"scan_type\":\"book_barcode\",\"data\":{\"device_id\":\"ST-1\"}}"))
+               .find("400 Bad Request") != std::string::npos,
+           "no top-level device_id -> 400");
+    expect(exchange(port, postRequest(std::string(20000, ' '))).find("413") != std::string::npos,
+           "oversized body -> 413");
+    expect(exchange(port, "GET /nothing HTTP/1.1\r\nHost: gateway\r\n\r\n").find("404") != std::string::npos,
+           "unknown path -> 404");
+    
+    sendAll(one, maskedFrame(WS_OPCODE_PING, "hello"));
+    std::vector<uint8_t> opcodes;
+    std::vector<std::string> pong = readFrames(one, bufferOne, 200, &opcodes);
+    expect(pong.size() == 1 && opcodes[0] == WS_OPCODE_PONG && pong[0] == "hello", "ping -> pong with payload");
+    
+    // Server bỏ đăng ký ngay khi nhận frame close (trước khi trả lời)
+    sendAll(all, maskedFrame(WS_OPCODE_CLOSE, std::string("\x03\xe8", 2)));
+    opcodes.clear();
+    std::vector<std::string> closing = readFrames(all, bufferAll, 200, &opcodes);
+    char probe;
+    expect(closing.size() == 1 && opcodes[0] == WS_OPCODE_CLOSE && closing[0] == std::string("\x03\xe8", 2) &&
+           recv(all, &probe, 1, 0) == 0,
+           "close -> close frame, then socket closed");
+    
+    // Trạm giữ kết nối keep-alive và gửi liền hai sự kiện (không ai theo dõi ST-9)
+    int station = connectLocal(port);
+    std::string stationBuffer;
+    sendAll(station, postRequest(scanEvent("ST-9", 4, 0)) + postRequest(scanEvent("ST-9", 5, 0)));
+    bool pipelined = readResponse(station, stationBuffer).find("202") != std::string::npos &&
+                     readResponse(station, stationBuffer).find("202") != std::string::npos;
+    close(station);
+    expect(pipelined, "keep-alive: pipelined POSTs both answered");
+    
+    std::string metrics = exchange(port, "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n");
+    expect(metrics.find("gateway_events_ingested_total 5\n") != std::string::npos &&
+           metrics.find("gateway_subscribers 2\n") != std::string::npos,
+           "GET /metrics (Prometheus text)");
+    
+    close(one);
+    close(two);
+    close(all);
+    gateway.stop();
+    const GatewayStats& stats = gateway.server.getStats();
+    expect(stats.accepted == 3 && stats.invalid == 3 && stats.unrouted == 2 && stats.deliveries == 6,
+           "stats: accepted, invalid, unrouted, deliveries");
+}
+
+static void checkSlowSubscriber() {
+    printf("Backpressure\n");
+    const int events = 1000;
+    GatewayConfig config;
+    config.port = 0;
+    config.clientQueueBytes = 64 * 1024;
+    config.socketSendBytes = 16 * 1024;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    int fast = subscribe(port, "/ws?device_id=ST-1");
+    int slow = subscribe(port, "/ws?device_id=ST-1", 4096);     // Không bao giờ đọc
+    
+    std::vector<std::string> received;
+    std::thread reader([&] {
+        std::string buffer;
+        received = readFrames(fast, buffer, 1000);
+    });
+    int station = connectLocal(port);
+    std::string stationBuffer;
+    int accepted = 0;
+    for (int i = 0; i < events; i++) {
+        sendAll(station, postRequest(scanEvent("ST-1", i, 0)));
+        if (readResponse(station, stationBuffer).find("202") != std::string::npos) {
+            accepted++;
+        }
+    }
+    reader.join();
+    close(station);
+    
+    bool inOrder = (int)received.size() == events;
+    for (int i = 0; inOrder && i < events; i++) {
+        inOrder = hasSequence(received, i, i);
+    }
+    expect(accepted == events, "station never blocked by the slow subscriber");
+    expect(inOrder, "fast subscriber got every event in order");
+    
+    // Socket của subscriber chậm đã bị đóng phía server: đọc hết phần đã nằm trong buffer rồi EOF
+    std::string drained;
+    while (receiveMore(slow, drained, 1000)) {
+    }
+    size_t queued = drained.size();
+    close(fast);
+    close(slow);
+    gateway.stop();
+    const GatewayStats& stats = gateway.server.getStats();
+    expect(stats.slowDropped == 1, "slow subscriber dropped once");
+    expect(stats.maxQueued <= config.clientQueueBytes, "queue never exceeds clientQueueBytes");
+    printf("  slow subscriber received %zu bytes before the drop\n", queued);
+}
+
+// ============================================
+// Tải
+// ============================================
+
+struct Reader {
+    std::vector<int> fds;
+    std::vector<std::string> buffers;
+    std::vector<uint32_t> latencyUs[2];    // Pha bão hòa, pha nhịp đều
+    uint64_t frames = 0;
+};
+
+struct LoadResult {
+    double ingestPerSecond;
+    double deliveriesPerSecond;
+    uint64_t expected;
+    uint64_t received;
+};
+
+static std::atomic<uint64_t> totalReceived(0);
+static std::atomic<bool> readersDone(false);
+
+static void readLoop(Reader& reader, uint64_t phaseSplit) {
+    int epollFd = epoll_create1(0);
+    for (size_t i = 0; i < reader.fds.size(); i++) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, reader.fds[i], &ev);
+    }
+    epoll_event events[256];
+    char chunk[65536];
+    while (!readersDone) {
+        int n = epoll_wait(epollFd, events, 256, 20);
+        uint64_t batch = 0;
+        for (int e = 0; e < n; e++) {
+            size_t index = events[e].data.u64;
+            ssize_t got = recv(reader.fds[index], chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (got <= 0) {
+                continue;
+            }
+            uint64_t now = nowNs();
+            std::string& buffer = reader.buffers[index];
+            buffer.append(chunk, got);
+            uint8_t opcode;
+            std::string payload;
+            while (takeFrame(buffer, opcode, payload)) {
+                uint64_t sequence;
+                uint64_t sentNs;
+                if (opcode != WS_OPCODE_TEXT || !benchFields(payload, sequence, sentNs)) {
+                    continue;
+                }
+                reader.latencyUs[sequence < phaseSplit ? 0 : 1].push_back((uint32_t)((now - sentNs) / 1000));
+                batch++;
+            }
+        }
+        reader.frames += batch;
+        totalReceived += batch;
+    }
+    close(epollFd);
+}
+
+static uint32_t percentile(std::vector<uint32_t>& samples, double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t index = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+static void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void runLoad(int subscriberCount, int events, int devices) {
+    printf("\nLoad: %d subscribers (10%% unfiltered), %d stations, %d events\n", subscriberCount, devices, events);
+    raiseFileLimit();
+    
+    GatewayConfig config;
+    config.port = 0;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    unsigned cores = std::thread::hardware_concurrency();
+    size_t readerCount = std::max(1u, std::min(4u, cores > 2 ? cores - 2 : 1));
+    std::vector<Reader> readers(readerCount);
+    std::vector<int> perDevice(devices, 0);
+    int unfiltered = 0;
+    for (int i = 0; i < subscriberCount; i++) {
+        std::string target = "/ws";
+        if (i % 10 == 0) {
+            unfiltered++;
+        } else {
+            int device = i % devices;
+            perDevice[device]++;
+            target += "?device_id=ST-" + std::to_string(device);
+        }
+        int fd = subscribe(port, target.c_str());
+        if (fd < 0) {
+            expect(false, "subscriber upgraded");
+            return;
+        }
+        Reader& reader = readers[i % readerCount];
+        reader.fds.push_back(fd);
+        reader.buffers.emplace_back();
+    }
+    
+    // Sự kiện 0..events-1: bão hòa; events..: nhịp đều PACED_RATE/s trong 1 giây
+    const int paced = PACED_RATE;
+    uint64_t phaseSplit = events;
+    std::vector<uint64_t> cumulative(events + paced);     // Frame phải nhận được sau sự kiện i
+    uint64_t total = 0;
+    for (int i = 0; i < events + paced; i++) {
+        total += unfiltered + perDevice[i % devices];
+        cumulative[i] = total;
+    }
+    uint64_t expectedSaturated = events > 0 ? cumulative[events - 1] : 0;
+    uint64_t expectedTotal = total;
+    totalReceived = 0;
+    readersDone = false;
+    std::vector<std::thread> threads;
+    for (Reader& reader : readers) {
+        threads.emplace_back(readLoop, std::ref(reader), phaseSplit);
+    }
+    
+    // Pha 1: một trạm giả gửi hết tốc độ trên một kết nối keep-alive (tối đa 64 request
+    // chưa có response), nhưng không vượt quá EVENT_WINDOW sự kiện mà subscriber chưa
+    // đọc xong: đo thông lượng cả hệ thống chứ không đo tốc độ làm đầy hàng đợi (client
+    // giả cùng máy đọc không kịp thì sẽ bị ngắt đúng như subscriber chậm)
+    const int window = EVENT_WINDOW;
+    int station = connectLocal(port);
+    std::string stationBuffer;
+    std::string response;
+    int sent = 0;
+    int answered = 0;
+    int accepted = 0;
+    uint64_t start = nowNs();
+    uint64_t deadline = start + 60000000000ull;
+    while (answered < events && nowNs() < deadline) {
+        std::string batch;
+        while (sent < events && sent - answered < 64 && (sent < window || totalReceived >= cumulative[sent - window])) {
+            batch += postRequest(scanEvent("ST-" + std::to_string(sent % devices), sent, nowNs()));
+            sent++;
+        }
+        if (!batch.empty() && !sendAll(station, batch)) {
+            break;
+        }
+        if (answered == sent) {
+            std::this_thread::yield();  // Chờ subscriber đọc
+            continue;
+        }
+        if (!receiveMore(station, stationBuffer, 5000)) {
+            break;
+        }
+        while (takeResponse(stationBuffer, response)) {
+            answered++;
+            accepted += response.find("202") != std::string::npos;
+        }
+    }
+    uint64_t ingestDone = nowNs();
+    deadline = ingestDone + 20000000000ull;
+    while (totalReceived < expectedSaturated && nowNs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    uint64_t deliveredDone = nowNs();
+    uint64_t receivedSaturated = totalReceived;
+    
+    // Pha 2: nhịp quét đều, đo độ trễ khi gateway không bị dồn
+    auto next = std::chrono::steady_clock::now();
+    for (int i = 0; i < paced; i++) {
+        std::this_thread::sleep_until(next);
+        next += std::chrono::microseconds(1000000 / PACED_RATE);
+        int sequence = events + i;
+        sendAll(station, postRequest(scanEvent("ST-" + std::to_string(sequence % devices), sequence, nowNs())));
+        accepted += readResponse(station, stationBuffer).find("202") != std::string::npos;
+    }
+    deadline = nowNs() + 5000000000ull;
+    while (totalReceived < expectedTotal && nowNs() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    readersDone = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    close(station);
+    for (Reader& reader : readers) {
+        for (int fd : reader.fds) {
+            close(fd);
+        }
+    }
+    gateway.stop();
+    const GatewayStats& stats = gateway.server.getStats();
+    
+    std::vector<uint32_t> latency[2];
+    for (Reader& reader : readers) {
+        for (int phase = 0; phase < 2; phase++) {
+            latency[phase].insert(latency[phase].end(), reader.latencyUs[phase].begin(), reader.latencyUs[phase].end());
+        }
+    }
+    
+    expect(accepted == events + paced, "every event accepted (202)");
+    expect(totalReceived == expectedTotal, "every subscriber got every matching event");
+    expect(stats.slowDropped == 0, "no subscriber dropped");
+    
+    double ingestSeconds = (ingestDone - start) / 1e9;
+    double deliverSeconds = (deliveredDone - start) / 1e9;
+    printf("\n%-34s %14s %14s\n", "", "saturated", "paced");
+    printf("%-34s %14.0f %14d\n", "events/s in", events / ingestSeconds, PACED_RATE);
+    printf("%-34s %14.0f %14s\n", "frames/s delivered", receivedSaturated / deliverSeconds, "");
+    printf("%-34s %14llu %14llu\n", "frames delivered",
+           (unsigned long long)receivedSaturated, (unsigned long long)(totalReceived - receivedSaturated));
+    const double points[] = {0.5, 0.99, 0.999};
+    const char* names[] = {"latency p50", "latency p99", "latency p99.9"};
+    for (int i = 0; i < 3; i++) {
+        printf("%-34s %11u us %11u us\n", names[i], percentile(latency[0], points[i]),
+               percentile(latency[1], points[i]));
+    }
+    printf("%-34s %11u us %11u us\n", "latency max", percentile(latency[0], 1.0), percentile(latency[1], 1.0));
+    printf("%-34s %14.3f\n", "sendmsg calls per frame", stats.deliveries ? (double)stats.writeCalls / stats.deliveries : 0);
+    printf("%-34s %14llu bytes\n", "largest subscriber queue", (unsigned long long)stats.maxQueued);
+    printf("%-34s %14zu\n", "reader threads", readerCount);
+}
+
+int main(int argc, char** argv) {
+    int subscribers = argc > 1 ? atoi(argv[1]) : 2000;
+    int events = argc > 2 ? atoi(argv[2]) : 2000;
+    int devices = argc > 3 ? atoi(argv[3]) : 50;
+    
+    checkRouting();
+    checkSlowSubscriber();
+    runLoad(subscribers, events, std::max(1, devices));
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
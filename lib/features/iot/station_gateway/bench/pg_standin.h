@@ -0,0 +1,508 @@
+// PostgreSQL giả cho bench của ScanStore (máy build không có server): nói đúng phần giao
+// thức v3 mà libpq dùng cho simple query + COPY FROM STDIN (startup không mật khẩu,
+// BEGIN/COMMIT/ROLLBACK/SET, COPY ... FROM STDIN). COMMIT ghi các dòng vào một file WAL
+// rồi fdatasync như server thật với synchronous_commit = on, nên độ trễ commit là độ
+// trễ đĩa thật của máy chạy bench (cộng commitDelayUs nếu muốn giả lập đĩa chậm hơn).
+//
+// COPY (SELECT ...) TO STDOUT trả các dòng đặt bằng setCopyOut() (bảng readers giả).
+//
+// Giả lập lỗi: dòng COPY chứa rejectMarker bị từ chối với SQLSTATE 22P02 (dữ liệu sai,
+// như JSONB hỏng); setDown(true) cắt mọi kết nối và từ chối kết nối mới.
+#ifndef PG_STANDIN_H
+#define PG_STANDIN_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PgStandin {
+public:
+    std::string rejectMarker = "POISON";
+    uint32_t commitDelayUs = 0;
+    bool keepRows = true;              // Giữ các dòng đã commit để kiểm tra nội dung
+    
+    PgStandin() {
+        char path[] = "/var/tmp/pg_standin_walXXXXXX";
+        walFd = mkstemp(path);
+        if (walFd >= 0) {
+            unlink(path);
+        }
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listenFd, (sockaddr*)&addr, sizeof(addr));
+        listen(listenFd, 64);
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, (sockaddr*)&addr, &length);
+        port = ntohs(addr.sin_port);
+        acceptor = std::thread([this] { acceptLoop(); });
+    }
+    
+    ~PgStandin() {
+        stopping = true;
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptor.join();
+        closeClients();
+        for (std::thread& thread : sessions) {
+            thread.join();
+        }
+        if (walFd >= 0) {
+            close(walFd);
+        }
+    }
+    
+    std::string conninfo() const {
+        return "host=127.0.0.1 port=" + std::to_string(port) +
+               " dbname=bench user=bench sslmode=disable gssencmode=disable connect_timeout=2";
+    }
+    
+    void setDown(bool value) {
+        down = value;
+        if (value) {
+            closeClients();
+        }
+    }
+    
+    // Dòng (định dạng text COPY, không có '\n') cho mọi COPY ... TO STDOUT
+    void setCopyOut(std::vector<std::string> rows) {
+        std::lock_guard<std::mutex> guard(lock);
+        copyOutRows = std::make_shared<const std::vector<std::string>>(std::move(rows));
+    }
+    
+    uint64_t committedRows() const { return rowsCommitted; }
+    uint64_t commits() const { return commitCount; }
+    uint64_t fsyncUsTotal() const { return fsyncUs; }
+    
+    // Các dòng đã commit của một bảng (dạng text COPY, không có '\n')
+    std::vector<std::string> rows(const std::string& table) {
+        std::lock_guard<std::mutex> guard(lock);
+        return committed[table];
+    }
+    
+    // Tách dòng COPY text thành các trường (bỏ escape); "\N" thành trường null
+    static std::vector<std::string> fields(const std::string& line, std::vector<bool>* nulls = nullptr) {
+        std::vector<std::string> out(1);
+        std::vector<bool> isNull(1, false);
+        for (size_t i = 0; i < line.size(); i++) {
+            char c = line[i];
+            if (c == '\t') {
+                out.emplace_back();
+                isNull.push_back(false);
+            } else if (c == '\\' && i + 1 < line.size()) {
+                char next = line[++i];
+                if (next == 'N') {
+                    isNull.back() = true;
+                } else {
+                    out.back() += next == 't' ? '\t' : next == 'n' ? '\n' : next == 'r' ? '\r' : next;
+                }
+            } else {
+                out.back() += c;
+            }
+        }
+        if (nulls != nullptr) {
+            *nulls = isNull;
+        }
+        return out;
+    }
+    
+private:
+    struct Session {
+        int fd;
+        bool inTransaction = false;
+        bool failed = false;
+        std::map<std::string, std::vector<std::string>> staged;
+        size_t stagedRows = 0;
+    };
+    
+    void acceptLoop() {
+        while (!stopping) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            if (down) {
+                close(fd);
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::lock_guard<std::mutex> guard(lock);
+            clients.push_back(fd);
+            sessions.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+    
+    void closeClients() {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int fd : clients) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    
+    static bool readAll(int fd, void* data, size_t length) {
+        uint8_t* out = static_cast<uint8_t*>(data);
+        while (length > 0) {
+            ssize_t n = recv(fd, out, length, 0);
+            if (n <= 0) {
+                return false;
+            }
+            out += n;
+            length -= n;
+        }
+        return true;
+    }
+    
+    static void put32(std::string& out, uint32_t value) {
+        uint32_t be = htonl(value);
+        out.append((const char*)&be, 4);
+    }
+    
+    static void message(std::string& out, char type, const std::string& body) {
+        out += type;
+        put32(out, body.size() + 4);
+        out += body;
+    }
+    
+    static void ready(std::string& out, char status) { message(out, 'Z', std::string(1, status)); }
+    
+    static void complete(std::string& out, const std::string& tag) { message(out, 'C', tag + '\0'); }
+    
+    static void error(std::string& out, const char* code, const std::string& text) {
+        std::string body;
+        body += 'S';
+        body += "ERROR";
+        body += '\0';
+        body += 'V';
+        body += "ERROR";
+        body += '\0';
+        body += 'C';
+        body += code;
+        body += '\0';
+        body += 'M';
+        body += text;
+        body += '\0';
+        body += '\0';
+        message(out, 'E', body);
+    }
+    
+    static bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+    
+    char status(const Session& session) const { return session.failed ? 'E' : session.inTransaction ? 'T' : 'I'; }
+    
+    // Ghi WAL + fdatasync rồi mới coi là đã commit
+    void commit(Session& session) {
+        std::string wal;
+        for (const auto& table : session.staged) {
+            for (const std::string& row : table.second) {
+                wal += row;
+                wal += '\n';
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (walFd >= 0) {
+            if (write(walFd, wal.data(), wal.size()) < 0 || fdatasync(walFd) < 0) {
+                // Bench: lỗi đĩa chỉ làm số đo sai, không cần xử lý
+            }
+        }
+        if (commitDelayUs > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(commitDelayUs));
+        }
+        fsyncUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                       .count();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (keepRows) {
+                for (auto& table : session.staged) {
+                    std::vector<std::string>& target = committed[table.first];
+                    target.insert(target.end(), table.second.begin(), table.second.end());
+                }
+            }
+        }
+        rowsCommitted += session.stagedRows;
+        commitCount++;
+        session.staged.clear();
+        session.stagedRows = 0;
+    }
+    
+    void rollback(Session& session) {
+        session.staged.clear();
+        session.stagedRows = 0;
+        session.inTransaction = false;
+        session.failed = false;
+    }
+    
+    // COPY <bảng> (<cột>, ...) FROM STDIN: nhận CopyData tới CopyDone
+    bool copyIn(Session& session, const std::string& query, std::string& out) {
+        size_t tableStart = 5;
+        size_t tableEnd = query.find_first_of(" (", tableStart);
+        std::string table = query.substr(tableStart, tableEnd - tableStart);
+        size_t open = query.find('(');
+        size_t close = query.find(')');
+        int columns = open == std::string::npos ? 1 : (int)std::count(query.begin() + open, query.begin() + close, ',') + 1;
+        std::string body(1, '\0');
+        body += (char)(columns >> 8);
+        body += (char)columns;
+        for (int i = 0; i < columns; i++) {
+            body += '\0';
+            body += '\0';
+        }
+        message(out, 'G', body);
+        if (!sendAll(session.fd, out)) {
+            return false;
+        }
+        out.clear();
+    
+        std::string data;
+        bool aborted = false;
+        while (true) {
+            char type;
+            uint32_t length;
+            if (!readAll(session.fd, &type, 1) || !readAll(session.fd, &length, 4)) {
+                return false;
+            }
+            std::string payload(ntohl(length) - 4, '\0');
+            if (!payload.empty() && !readAll(session.fd, &payload[0], payload.size())) {
+                return false;
+            }
+            if (type == 'd') {
+                data += payload;
+            } else if (type == 'c') {
+                break;
+            } else if (type == 'f') {
+                aborted = true;
+                break;
+            }
+        }
+    
+        std::vector<std::string> lines;
+        size_t start = 0;
+        while (start < data.size()) {
+            size_t end = data.find('\n', start);
+            if (end == std::string::npos) {
+                end = data.size();
+            }
+            lines.push_back(data.substr(start, end - start));
+            start = end + 1;
+        }
+        bool rejected = aborted;
+        for (const std::string& line : lines) {
+            if (!rejectMarker.empty() && line.find(rejectMarker) != std::string::npos) {
+                rejected = true;
+            }
+        }
+        if (rejected) {
+            error(out, aborted ? "57014" : "22P02", aborted ? "COPY from stdin failed" : "invalid input syntax");
+            session.staged.clear();
+            session.stagedRows = 0;
+            session.failed = session.inTransaction;
+        } else {
+            std::vector<std::string>& target = session.staged[table];
+            target.insert(target.end(), lines.begin(), lines.end());
+            session.stagedRows += lines.size();
+            if (!session.inTransaction) {
+                commit(session);
+            }
+            complete(out, "COPY " + std::to_string(lines.size()));
+        }
+        ready(out, status(session));
+        return true;
+    }
+    
+    // COPY (SELECT ...) TO STDOUT: CopyOutResponse, mỗi dòng một CopyData, CopyDone
+    bool copyOut(Session& session, std::string& out) {
+        std::shared_ptr<const std::vector<std::string>> rows;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            rows = copyOutRows;
+        }
+        size_t count = rows ? rows->size() : 0;
+        int columns = count > 0 ? (int)std::count((*rows)[0].begin(), (*rows)[0].end(), '\t') + 1 : 1;
+        std::string body(1, '\0');
+        body += (char)(columns >> 8);
+        body += (char)columns;
+        body.append(columns * 2, '\0');
+        message(out, 'H', body);
+        for (size_t i = 0; i < count; i++) {
+            const std::string& row = (*rows)[i];
+            out += 'd';
+            put32(out, row.size() + 5);
+            out += row;
+            out += '\n';
+            if (out.size() >= 65536) {
+                if (!sendAll(session.fd, out)) {
+                    return false;
+                }
+                out.clear();
+            }
+        }
+        message(out, 'c', "");
+        complete(out, "COPY " + std::to_string(count));
+        ready(out, status(session));
+        return sendAll(session.fd, out);
+    }
+    
+    void serve(int fd) {
+        Session session;
+        session.fd = fd;
+        // Startup: SSLRequest/GSSENCRequest được trả 'N', rồi StartupMessage
+        while (true) {
+            uint32_t length;
+            uint32_t code;
+            if (!readAll(fd, &length, 4) || !readAll(fd, &code, 4)) {
+                close(fd);
+                return;
+            }
+            std::string rest(ntohl(length) - 8, '\0');
+            if (!rest.empty() && !readAll(fd, &rest[0], rest.size())) {
+                close(fd);
+                return;
+            }
+            code = ntohl(code);
+            if (code == 80877103 || code == 80877104) {
+                sendAll(fd, "N");
+                continue;
+            }
+            if (code != 196608) {
+                close(fd);
+                return;
+            }
+            break;
+        }
+        std::string out;
+        std::string ok;
+        put32(ok, 0);
+        message(out, 'R', ok);
+        const char* params[][2] = {{"server_version", "16.0"},
+                                   {"server_encoding", "UTF8"},
+                                   {"client_encoding", "UTF8"},
+                                   {"standard_conforming_strings", "on"},
+                                   {"DateStyle", "ISO, MDY"},
+                                   {"integer_datetimes", "on"}};
+        for (auto& param : params) {
+            message(out, 'S', std::string(param[0]) + '\0' + param[1] + '\0');
+        }
+        std::string key;
+        put32(key, (uint32_t)fd);
+        put32(key, 12345);
+        message(out, 'K', key);
+        ready(out, 'I');
+        if (!sendAll(fd, out)) {
+            close(fd);
+            return;
+        }
+    
+        while (!stopping) {
+            char type;
+            uint32_t length;
+            if (!readAll(fd, &type, 1) || !readAll(fd, &length, 4)) {
+                break;
+            }
+            std::string payload(ntohl(length) - 4, '\0');
+            if (!payload.empty() && !readAll(fd, &payload[0], payload.size())) {
+                break;
+            }
+            if (type == 'X') {
+                break;
+            }
+            if (type != 'Q') {
+                continue;
+            }
+            std::string query(payload.c_str());
+            while (!query.empty() && (query.back() == ';' || query.back() == ' ')) {
+                query.pop_back();
+            }
+            out.clear();
+            if (query == "BEGIN") {
+                session.inTransaction = true;
+                complete(out, "BEGIN");
+            } else if (query == "COMMIT") {
+                if (session.failed) {
+                    rollback(session);
+                    complete(out, "ROLLBACK");
+                } else {
+                    commit(session);
+                    session.inTransaction = false;
+                    complete(out, "COMMIT");
+                }
+            } else if (query == "ROLLBACK") {
+                rollback(session);
+                complete(out, "ROLLBACK");
+            } else if (session.failed) {
+                error(out, "25P02", "current transaction is aborted");
+            } else if (query.compare(0, 4, "SET ") == 0) {
+                complete(out, "SET");
+            } else if (query.compare(0, 6, "COPY (") == 0 && query.find("TO STDOUT") != std::string::npos) {
+                if (!copyOut(session, out)) {
+                    break;
+                }
+                continue;
+            } else if (query.compare(0, 5, "COPY ") == 0 && query.find("FROM STDIN") != std::string::npos) {
+                if (!copyIn(session, query, out)) {
+                    break;
+                }
+                if (!sendAll(fd, out)) {
+                    break;
+                }
+                continue;
+            } else {
+                error(out, "42601", "syntax error");
+                session.failed = session.inTransaction;
+            }
+            ready(out, status(session));
+            if (!sendAll(fd, out)) {
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            clients.erase(std::remove(clients.begin(), clients.end(), fd), clients.end());
+        }
+        close(fd);
+    }
+    
+    int listenFd;
+    int walFd;
+    uint16_t port = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> down{false};
+    std::thread acceptor;
+    std::vector<std::thread> sessions;
+    std::vector<int> clients;
+    std::mutex lock;
+    std::map<std::string, std::vector<std::string>> committed;
+    std::shared_ptr<const std::vector<std::string>> copyOutRows;
+    std::atomic<uint64_t> rowsCommitted{0};
+    std::atomic<uint64_t> commitCount{0};
+    std::atomic<uint64_t> fsyncUs{0};
+};
+
+#endif // PG_STANDIN_H
@@ -0,0 +1,428 @@
+// Snapshot UID thẻ → độc giả (ReaderIndex): dựng file từ hàng triệu độc giả giả, kiểm tra
+// mọi UID tra ra đúng bản ghi và UID lạ không ra gì, UID trùng / sai định dạng, tên dài cắt
+// đúng ranh giới UTF-8, file hỏng bị từ chối; dựng lại từ bảng readers qua libpq (PgStandin
+// trả COPY TO STDOUT), thay snapshot trong lúc một thread khác đang tra liên tục, và
+// POST /api/iot/scan-student-card qua GatewayServer. Đo thời gian dựng / mở và độ trễ tra.
+//
+//   reader_index_bench [readers=1000000] [lookups=1000000]
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gateway_client.h"
+#include "pg_standin.h"
+#include "reader_index.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static std::string workDir;
+
+static int statusOf(const std::string& response) {
+    return response.size() > 12 ? atoi(response.c_str() + 9) : 0;
+}
+
+static uint64_t metric(uint16_t port, const std::string& name) {
+    std::string metrics = exchange(port, "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n");
+    size_t line = metrics.find("\n" + name + " ");
+    return line == std::string::npos ? 0 : strtoull(metrics.c_str() + line + name.size() + 2, nullptr, 10);
+}
+
+// ============================================
+// Độc giả giả
+// ============================================
+
+// UID thẻ thật: nửa 4 byte, nửa 7 byte (NXP, byte đầu 0x04). Nhân với số lẻ là song ánh
+// nên không trùng; bản "miss" dùng phần còn lại của không gian
+static std::string syntheticUid(uint32_t index, bool miss = false) {
+    char text[20];
+    uint32_t value = (index * 2 + (miss ? 1 : 0)) * 2654435761u;
+    if (index % 2 == 0) {
+        snprintf(text, sizeof(text), "%08X", value);
+    } else {
+        snprintf(text, sizeof(text), "04%04X%08X", index % 0xFFFF, value);
+    }
+    return text;
+}
+
+static const char* const FAMILY[] = {"Nguyễn", "Trần", "Lê", "Phạm", "Hoàng", "Vũ", "Đặng", "Bùi"};
+static const char* const MIDDLE[] = {"Văn", "Thị", "Minh", "Thanh", "Đức", "Ngọc"};
+static const char* const GIVEN[] = {"An", "Bình", "Cường", "Dũng", "Hương", "Lan", "Phúc", "Quỳnh", "Tùng"};
+
+struct Synthetic {
+    std::string uid;
+    uint32_t id;
+    std::string mssv;
+    std::string name;
+    std::string className;
+};
+
+static Synthetic syntheticReader(uint32_t index, const char* version = "") {
+    Synthetic reader;
+    reader.uid = syntheticUid(index);
+    reader.id = index + 1;
+    char mssv[16];
+    snprintf(mssv, sizeof(mssv), "SV%08u", index);
+    reader.mssv = mssv;
+    reader.name = std::string(FAMILY[index % 8]) + " " + MIDDLE[(index / 8) % 6] + " " + GIVEN[(index / 48) % 9] + version;
+    reader.className = "CNTT-K" + std::to_string(60 + index % 6);
+    return reader;
+}
+
+static std::vector<ReaderEntry> syntheticEntries(uint32_t count) {
+    std::vector<ReaderEntry> entries(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Synthetic reader = syntheticReader(i);
+        bool truncated;
+        ReaderIndex::makeEntry(reader.uid.data(), reader.uid.size(), reader.id, reader.mssv.c_str(),
+                               reader.name.c_str(), reader.className.c_str(), entries[i], truncated);
+    }
+    return entries;
+}
+
+// Dòng COPY text của bảng readers: id, card_uid, student_id, name, class
+static std::vector<std::string> syntheticRows(uint32_t count, const char* version) {
+    std::vector<std::string> rows(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Synthetic reader = syntheticReader(i, version);
+        rows[i] = std::to_string(reader.id) + "\t" + reader.uid + "\t" + reader.mssv + "\t" + reader.name + "\t" +
+                  reader.className;
+    }
+    return rows;
+}
+
+static uint64_t key(const std::string& uid) {
+    uint64_t value = 0;
+    ReaderIndex::parseUid(uid.data(), uid.size(), value);
+    return value;
+}
+
+static bool matches(const ReaderRecord* record, const Synthetic& reader) {
+    return record != nullptr && record->readerId == reader.id && reader.mssv == record->mssv &&
+           reader.name == record->name && reader.className == record->className;
+}
+
+// Hợp lệ UTF-8 (không có ký tự bị cắt dở)
+static bool validUtf8(const char* text) {
+    for (const unsigned char* p = (const unsigned char*)text; *p != 0;) {
+        int extra = *p < 0x80 ? 0 : (*p & 0xE0) == 0xC0 ? 1 : (*p & 0xF0) == 0xE0 ? 2 : (*p & 0xF8) == 0xF0 ? 3 : -1;
+        if (extra < 0) {
+            return false;
+        }
+        p++;
+        for (int i = 0; i < extra; i++, p++) {
+            if ((*p & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static double elapsedMs(uint64_t startNs) {
+    return (nowNs() - startNs) / 1e6;
+}
+
+// ============================================
+// Kiểm tra
+// ============================================
+
+static void checkParsing() {
+    printf("UID keys and records\n");
+    uint64_t a;
+    uint64_t b;
+    expect(ReaderIndex::parseUid("04A1B2C3", 8, a) && ReaderIndex::parseUid("04:a1:b2:c3", 11, b) && a == b,
+           "case and ':' separators ignored");
+    expect(ReaderIndex::parseUid("A1", 2, a) && ReaderIndex::parseUid("00A1", 4, b) && a != b,
+           "leading 00 byte is part of the UID");
+    expect(ReaderIndex::parseUid("04112233445566", 14, a) && (a >> 56) == 7, "7-byte UID");
+    expect(!ReaderIndex::parseUid("0411223344556677", 16, a) && !ReaderIndex::parseUid("ABC", 3, a) &&
+           !ReaderIndex::parseUid("", 0, a) && !ReaderIndex::parseUid("04G1", 4, a),
+           "8+ bytes / odd digits / empty / non-hex rejected");
+    
+    std::string longName;
+    for (int i = 0; i < 40; i++) {
+        longName += "ễ";
+    }
+    ReaderEntry entry;
+    bool truncated = false;
+    bool made = ReaderIndex::makeEntry("04A1B2C3", 8, 7, "SV2021001234", longName.c_str(), nullptr, entry, truncated);
+    expect(made && truncated && strlen(entry.record.name) == 63 && validUtf8(entry.record.name),
+           "long name cut to 63 bytes on a character boundary");
+    expect(made && entry.record.className[0] == '\0' && entry.record.readerId == 7, "NULL class -> empty");
+}
+
+static void checkSnapshot(uint32_t readers) {
+    printf("Snapshot of %u readers\n", readers);
+    std::string path = workDir + "/readers.idx";
+    uint64_t start = nowNs();
+    std::vector<ReaderEntry> entries = syntheticEntries(readers);
+    double generateMs = elapsedMs(start);
+    
+    start = nowNs();
+    size_t skipped = 0;
+    std::string error;
+    bool written = ReaderIndex::writeSnapshot(path, entries, skipped, error);
+    double writeMs = elapsedMs(start);
+    expect(written && skipped == 0, "snapshot written (temp file, fsync, rename)");
+    
+    start = nowNs();
+    std::shared_ptr<const ReaderSnapshot> snapshot = ReaderSnapshot::open(path, error);
+    double openMs = elapsedMs(start);
+    expect(snapshot && snapshot->size() == readers, "mmap'ed with every reader");
+    if (!snapshot) {
+        return;
+    }
+    
+    bool hits = true;
+    bool misses = true;
+    for (uint32_t i = 0; i < readers; i++) {
+        hits &= matches(snapshot->find(key(syntheticUid(i))), syntheticReader(i));
+        misses &= snapshot->find(key(syntheticUid(i, true))) == nullptr;
+    }
+    expect(hits, "every UID -> its own record");
+    expect(misses, "unknown UIDs -> not found");
+    
+    printf("  %-34s %10.0f ms\n", "generate entries", generateMs);
+    printf("  %-34s %10.0f ms\n", "write snapshot (incl. fsync)", writeMs);
+    printf("  %-34s %10.0f ms\n", "open (mmap + populate)", openMs);
+    printf("  %-34s %10.1f MB (%.0f B/reader)\n", "file size", snapshot->bytes() / 1e6,
+           (double)snapshot->bytes() / readers);
+}
+
+static void checkDuplicatesAndCorruption() {
+    printf("Duplicates and damaged files\n");
+    std::string path = workDir + "/small.idx";
+    std::vector<ReaderEntry> entries = syntheticEntries(100);
+    entries.push_back(entries[10]);
+    entries.back().record.readerId = 9999;
+    size_t skipped = 0;
+    std::string error;
+    ReaderIndex::writeSnapshot(path, entries, skipped, error);
+    std::shared_ptr<const ReaderSnapshot> snapshot = ReaderSnapshot::open(path, error);
+    expect(snapshot && skipped == 1 && snapshot->size() == 100, "duplicate UID skipped");
+    expect(snapshot && snapshot->find(entries[10].key)->readerId == 11, "first row for a UID wins");
+    
+    std::vector<ReaderEntry> none;
+    ReaderIndex::writeSnapshot(workDir + "/empty.idx", none, skipped, error);
+    snapshot = ReaderSnapshot::open(workDir + "/empty.idx", error);
+    expect(snapshot && snapshot->size() == 0 && snapshot->find(entries[0].key) == nullptr, "empty table is valid");
+    
+    // Cắt cụt / sai magic / không tồn tại
+    std::string damaged = workDir + "/damaged.idx";
+    std::string copy = "cp " + path + " " + damaged;
+    bool rejected = system(copy.c_str()) == 0 && truncate(damaged.c_str(), 1000) == 0 &&
+                    !ReaderSnapshot::open(damaged, error);
+    int fd = open(damaged.c_str(), O_WRONLY | O_TRUNC);
+    rejected &= fd >= 0 && write(fd, "NOTANIDX", 8) == 8 && ftruncate(fd, 4096) == 0;
+    close(fd);
+    rejected &= !ReaderSnapshot::open(damaged, error) && !ReaderSnapshot::open(workDir + "/missing.idx", error);
+    expect(rejected, "truncated / wrong magic / missing file rejected");
+}
+
+static void measureLookups(uint32_t readers, uint32_t lookups) {
+    printf("Lookup latency (%u random lookups, 90%% hits)\n", lookups);
+    ReaderIndexConfig config;
+    config.path = workDir + "/readers.idx";
+    ReaderIndex index(config);
+    if (!index.begin()) {
+        expect(false, "index loads the snapshot");
+        return;
+    }
+    std::mt19937 random(42);
+    std::vector<uint64_t> keys(lookups);
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint32_t reader = random() % readers;
+        keys[i] = key(syntheticUid(reader, i % 10 == 0));
+    }
+    
+    // Thông lượng: tra liên tục (như gateway: lấy snapshot rồi find)
+    uint64_t found = 0;
+    uint64_t start = nowNs();
+    for (uint64_t k : keys) {
+        found += index.current()->find(k) != nullptr;
+    }
+    double totalNs = (double)(nowNs() - start);
+    
+    // Độ trễ từng lần (gồm ~20 ns của chính đồng hồ)
+    std::vector<uint32_t> latencies(lookups);
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint64_t t0 = nowNs();
+        std::shared_ptr<const ReaderSnapshot> snapshot = index.current();
+        found += snapshot->find(keys[i]) != nullptr;
+        latencies[i] = (uint32_t)(nowNs() - t0);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    index.stop();
+    expect(found == 2 * (uint64_t)(lookups - (lookups + 9) / 10), "hits and misses as generated");
+    printf("  %-34s %10.1f M/s\n", "lookups", lookups / totalNs * 1e3);
+    printf("  %-34s %10u ns\n", "p50", latencies[lookups / 2]);
+    printf("  %-34s %10u ns\n", "p99", latencies[(size_t)lookups * 99 / 100]);
+    printf("  %-34s %10u ns\n", "p99.9", latencies[(size_t)lookups * 999 / 1000]);
+    printf("  %-34s %10u ns\n", "max", latencies.back());
+}
+
+static void checkRebuildAndSwap(uint32_t readers) {
+    printf("Rebuild from the readers table\n");
+    PgStandin database;
+    database.setCopyOut(syntheticRows(readers, ""));
+    
+    ReaderIndexConfig config;
+    config.path = workDir + "/rebuilt.idx";
+    config.conninfo = database.conninfo();
+    ReaderIndex index(config);
+    uint64_t start = nowNs();
+    bool rebuilt = index.rebuild();
+    double rebuildMs = elapsedMs(start);
+    ReaderIndexStats stats = index.getStats();
+    expect(rebuilt && stats.readers == readers && stats.skipped == 0, "COPY TO STDOUT -> snapshot -> swapped in");
+    std::shared_ptr<const ReaderSnapshot> first = index.current();
+    bool exact = first != nullptr;
+    for (uint32_t i = 0; exact && i < readers; i += 97) {
+        exact = matches(first->find(key(syntheticUid(i))), syntheticReader(i));
+    }
+    expect(exact, "rebuilt records match the table");
+    printf("  %-34s %10.0f ms (%.1f us/reader)\n", "rebuild (query + write + swap)", rebuildMs,
+           rebuildMs * 1000 / readers);
+    
+    // Bảng đổi trong lúc một thread tra liên tục: mỗi lần tra ra bản cũ hoặc bản mới, không gì khác
+    const uint32_t probe = std::min<uint32_t>(readers, 50000);
+    database.setCopyOut(syntheticRows(probe, " B"));
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> checked{0};
+    std::atomic<uint64_t> wrong{0};
+    std::thread reader([&] {
+        uint32_t i = 0;
+        while (running) {
+            std::shared_ptr<const ReaderSnapshot> snapshot = index.current();
+            const ReaderRecord* record = snapshot->find(key(syntheticUid(i)));
+            if (!matches(record, syntheticReader(i)) && !matches(record, syntheticReader(i, " B"))) {
+                wrong++;
+            }
+            checked++;
+            i = (i + 1) % probe;
+        }
+    });
+    std::weak_ptr<const ReaderSnapshot> old = first;
+    bool oldStillReadable = true;
+    for (int round = 0; round < 6; round++) {
+        database.setCopyOut(syntheticRows(probe, round % 2 == 0 ? " B" : ""));
+        index.rebuild();
+        if (round == 0) {
+            // Ai còn giữ bản cũ vẫn đọc được dù file đã bị rename đè
+            oldStillReadable = matches(first->find(key(syntheticUid(probe - 1))), syntheticReader(probe - 1));
+            first.reset();
+        }
+    }
+    running = false;
+    reader.join();
+    stats = index.getStats();
+    expect(wrong == 0 && checked > 0, "lookups during six swaps: always old or new record");
+    expect(oldStillReadable && old.expired(), "old mapping readable until released, then unmapped");
+    expect(stats.rebuilds == 7 && stats.swaps == 7, "every rebuild swapped in");
+    printf("  %llu lookups during swaps\n", (unsigned long long)checked.load());
+    
+    database.setDown(true);
+    bool failed = !index.rebuild();
+    stats = index.getStats();
+    expect(failed && stats.rebuildFailures == 1 && index.current() && index.current()->size() == probe,
+           "database down -> rebuild fails, current snapshot kept");
+}
+
+static std::string studentRequest(const std::string& uid) {
+    std::string body = "{\"card_uid\":\"" + uid + "\",\"device_id\":\"ST-1\",\"include_loans\":true}";
+    return "POST /api/iot/scan-student-card HTTP/1.1\r\nHost: gateway\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static std::string bodyOf(const std::string& response) {
+    size_t end = response.find("\r\n\r\n");
+    return end == std::string::npos ? std::string() : response.substr(end + 4);
+}
+
+static void checkGateway() {
+    printf("POST /api/iot/scan-student-card\n");
+    std::string path = workDir + "/gateway.idx";
+    std::vector<ReaderEntry> entries = syntheticEntries(1000);
+    ReaderEntry quoted;
+    bool truncated;
+    ReaderIndex::makeEntry("04AABBCCDDEEFF", 14, 5000, "SV\"1\"", "Tên \\ có \"nháy\"", "K1", quoted, truncated);
+    entries.push_back(quoted);
+    size_t skipped;
+    std::string error;
+    ReaderIndex::writeSnapshot(path, entries, skipped, error);
+    
+    GatewayConfig config;
+    config.port = 0;
+    config.readers.path = path;
+    config.readers.refreshS = 1;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    Synthetic reader = syntheticReader(123);
+    std::string hit = exchange(port, studentRequest(reader.uid));
+    std::string wanted = "{\"success\":true,\"student\":{\"mssv\":\"" + reader.mssv + "\",\"name\":\"" + reader.name +
+                         "\",\"class\":\"" + reader.className + "\",\"reader_id\":124}}";
+    expect(hit.find("200 OK") != std::string::npos && hit.find("application/json") != std::string::npos &&
+           bodyOf(hit) == wanted, "hit -> 200 + student like the backend");
+    std::string lower = reader.uid;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    expect(bodyOf(exchange(port, studentRequest(lower))) == wanted, "lowercase UID finds the same reader");
+    std::string miss = exchange(port, studentRequest(syntheticUid(123, true)));
+    expect(statusOf(miss) == 200 && bodyOf(miss).find("\"success\":false") == 1, "unknown card -> success=false");
+    expect(statusOf(exchange(port, studentRequest("XYZ"))) == 400, "malformed card_uid -> 400");
+    expect(bodyOf(exchange(port, studentRequest("04AABBCCDDEEFF"))).find("\"name\":\"Tên \\\\ có \\\"nháy\\\"\"") !=
+           std::string::npos, "quotes and backslashes escaped");
+    
+    // Dựng ở nơi khác rồi rename đè: gateway nhận bản mới trong một chu kỳ làm mới
+    std::vector<ReaderEntry> next = syntheticEntries(10);
+    next[3].record.readerId = 77777;
+    ReaderIndex::writeSnapshot(path, next, skipped, error);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    expect(bodyOf(exchange(port, studentRequest(syntheticUid(3)))).find("\"reader_id\":77777") != std::string::npos,
+           "replaced file picked up without restart");
+    expect(metric(port, "gateway_reader_snapshot_readers") == 10, "gateway_reader_snapshot_readers");
+    expect(metric(port, "gateway_reader_lookups_total") == 5 && metric(port, "gateway_reader_misses_total") == 1,
+           "lookup / miss counters");
+    gateway.stop();
+}
+
+int main(int argc, char** argv) {
+    uint32_t readers = argc > 1 ? (uint32_t)std::max(100, atoi(argv[1])) : 1000000;
+    uint32_t lookups = argc > 2 ? (uint32_t)std::max(100, atoi(argv[2])) : 1000000;
+    char dir[] = "/var/tmp/reader_index_benchXXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    workDir = dir;
+    
+    checkParsing();
+    checkSnapshot(readers);
+    checkDuplicatesAndCorruption();
+    measureLookups(readers, lookups);
+    checkRebuildAndSwap(readers);
+    checkGateway();
+    
+    std::string cleanup = "rm -rf " + workDir;
+    if (system(cleanup.c_str()) != 0) {
+        fprintf(stderr, "could not remove %s\n", workDir.c_str());
+    }
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,438 @@
+// Phát lại cho app kết nối lại: GatewayServer chạy trong tiến trình, trạm giả gửi sự
+// kiện, subscriber giả ngắt rồi nối lại với since=<trạm>:<seq> như IoTWebSocketDataSource.
+// Kiểm tra hello/mốc seq, phát lại đúng phần đã lỡ theo thứ tự, trạm mới xuất hiện lúc
+// mất kết nối, gateway khởi động lại (epoch khác), ring nhỏ báo "lost" và không vượt
+// dung lượng, nối lại trong lúc trạm vẫn gửi không hổng không trùng; rồi đo thông lượng
+// phát lại (frame/s, MB/s) khi nhiều app cùng nối lại.
+//
+//   replay_bench [clients=100] [events=10000] [devices=50]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+#include "gateway_client.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+// "seq" gateway chèn vào đầu sự kiện, 0 nếu không có
+static uint64_t eventSeq(const std::string& payload) {
+    unsigned long long seq;
+    return sscanf(payload.c_str(), "{\"seq\":%llu,", &seq) == 1 ? seq : 0;
+}
+
+// device_id cấp ngoài cùng (scanEvent đặt trước "data")
+static std::string eventDevice(const std::string& payload) {
+    size_t field = payload.find("\"device_id\":\"");
+    if (field == std::string::npos) {
+        return std::string();
+    }
+    field += 13;
+    return payload.substr(field, payload.find('"', field) - field);
+}
+
+static std::string helloEpoch(const std::string& payload) {
+    size_t field = payload.find("\"epoch\":\"");
+    return field == std::string::npos ? std::string() : payload.substr(field + 9, 16);
+}
+
+// Trạm giả trên một kết nối keep-alive
+struct Station {
+    int fd;
+    std::string buffer;
+    uint64_t counter = 0;
+    
+    explicit Station(uint16_t port) : fd(connectLocal(port)) {}
+    ~Station() { close(fd); }
+    
+    bool post(const std::string& deviceId) {
+        return sendAll(fd, postRequest(scanEvent(deviceId, counter++, nowNs()))) &&
+               readResponse(fd, buffer).find("202") != std::string::npos;
+    }
+};
+
+// Giá trị một metric trong GET /metrics
+static uint64_t metric(uint16_t port, const std::string& name) {
+    std::string metrics = exchange(port, "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n");
+    size_t line = metrics.find("\n" + name + " ");
+    return line == std::string::npos ? 0 : strtoull(metrics.c_str() + line + name.size() + 2, nullptr, 10);
+}
+
+// ============================================
+// Kiểm tra
+// ============================================
+
+static void checkHelloAndResume() {
+    printf("Hello and resume\n");
+    GatewayConfig config;
+    config.port = 0;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    Station station(port);
+    
+    bool posted = station.post("ST-1") && station.post("ST-1") && station.post("ST-1") && station.post("ST-2") &&
+                  station.post("ST-2");
+    expect(posted, "five events accepted");
+    
+    // Lần đầu: chỉ nhận mốc seq, không phát lại gì
+    std::string buffer;
+    int first = subscribe(port, "/ws?device_id=ST-1&hello=1", 0, &buffer);
+    std::vector<std::string> frames = readFrames(first, buffer, 200);
+    expect(frames.size() == 1 && frames[0].find("\"type\":\"hello\"") == 1 &&
+           frames[0].find("\"seq\":{\"ST-1\":3}") != std::string::npos,
+           "hello=1 -> baseline seq only, no replay");
+    std::string epoch = frames.empty() ? std::string() : helloEpoch(frames[0]);
+    expect(epoch.size() == 16, "hello carries the gateway epoch");
+    
+    station.post("ST-1");
+    frames = readFrames(first, buffer, 200);
+    expect(frames.size() == 1 && eventSeq(frames[0]) == 4, "live event carries the next seq");
+    close(first);
+    
+    // Mất kết nối: trạm gửi tiếp 3 sự kiện ST-1 và ST-2 xen kẽ
+    station.post("ST-1");
+    station.post("ST-2");
+    station.post("ST-1");
+    station.post("ST-1");
+    std::string target = "/ws?device_id=ST-1&epoch=" + epoch + "&since=ST-1:4";
+    int again = subscribe(port, target.c_str(), 0, &buffer);
+    frames = readFrames(again, buffer, 200);
+    bool exact = frames.size() == 4 && frames[0].find("\"type\":\"hello\"") == 1;
+    for (size_t i = 1; exact && i < frames.size(); i++) {
+        exact = eventSeq(frames[i]) == 4 + i && eventDevice(frames[i]) == "ST-1";
+    }
+    expect(exact, "since=ST-1:4 -> hello + seq 5,6,7 of ST-1 only");
+    
+    station.post("ST-1");
+    frames = readFrames(again, buffer, 200);
+    expect(frames.size() == 1 && eventSeq(frames[0]) == 8, "then live, no duplicate");
+    close(again);
+    
+    // Client không lọc: có since của ST-1, ST-2; ST-3 xuất hiện lúc mất kết nối
+    station.post("ST-3");
+    station.post("ST-2");
+    station.post("ST-3");
+    target = "/ws?epoch=" + epoch + "&since=ST-1:8,ST-2:3";
+    int everything = subscribe(port, target.c_str(), 0, &buffer);
+    frames = readFrames(everything, buffer, 200);
+    std::vector<std::string> got;
+    for (size_t i = 1; i < frames.size(); i++) {
+        got.push_back(eventDevice(frames[i]) + ":" + std::to_string(eventSeq(frames[i])));
+    }
+    expect(got == std::vector<std::string>({"ST-3:1", "ST-2:4", "ST-3:2"}),
+           "unfiltered: new station from seq 1, arrival order");
+    close(everything);
+    
+    // Gateway khởi động lại (epoch khác): seq của client vô nghĩa, phát lại mọi thứ còn giữ
+    int restarted = subscribe(port, "/ws?device_id=ST-2&epoch=0000000000000000&since=ST-2:99", 0, &buffer);
+    frames = readFrames(restarted, buffer, 200);
+    bool all = frames.size() == 5;
+    for (size_t i = 1; all && i < frames.size(); i++) {
+        all = eventSeq(frames[i]) == i;
+    }
+    expect(all, "epoch mismatch -> every retained ST-2 event from seq 1");
+    close(restarted);
+    
+    gateway.stop();
+    const GatewayStats& stats = gateway.server.getStats();
+    expect(stats.resumed == 3 && stats.replayed == 3 + 3 + 4 && stats.replayLost == 0,
+           "stats: resumed, replayed, lost");
+}
+
+static void checkSmallRing() {
+    printf("Small ring\n");
+    const int events = 300;
+    GatewayConfig config;
+    config.port = 0;
+    config.replayBytes = 32 * 1024;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    Station station(port);
+    
+    bool posted = true;
+    for (int i = 0; i < events; i++) {
+        posted &= station.post("ST-1");
+    }
+    expect(posted, "events accepted");
+    uint64_t retainedBytes = metric(port, "gateway_replay_retained_bytes");
+    uint64_t retained = metric(port, "gateway_replay_retained_events");
+    uint64_t evicted = metric(port, "gateway_replay_evicted_total");
+    expect(retainedBytes > 0 && retainedBytes <= config.replayBytes, "retained bytes never exceed --replay-mb");
+    expect(retained + evicted == events, "retained + evicted == events");
+    
+    std::string buffer;
+    int fd = subscribe(port, "/ws?device_id=ST-1&since=ST-1:0", 0, &buffer);
+    std::vector<std::string> frames = readFrames(fd, buffer, 200);
+    std::string lost = "\"lost\":{\"ST-1\":" + std::to_string(evicted) + "}";
+    expect(!frames.empty() && frames[0].find(lost) != std::string::npos, "hello reports lost count per station");
+    bool tail = frames.size() == retained + 1;
+    for (size_t i = 1; tail && i < frames.size(); i++) {
+        tail = eventSeq(frames[i]) == evicted + i;
+    }
+    expect(tail, "replays exactly the retained tail");
+    close(fd);
+    printf("  ring kept %llu of %d events in %llu bytes\n", (unsigned long long)retained, events,
+           (unsigned long long)retainedBytes);
+}
+
+// App ngắt/nối lại liên tục trong khi trạm gửi hết tốc độ: ghép các lần kết nối phải ra
+// đúng 1..N của mỗi trạm
+static void checkResumeUnderLoad() {
+    printf("Resume while stations keep posting\n");
+    const int events = 3000;
+    const int devices = 3;
+    GatewayConfig config;
+    config.port = 0;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    std::atomic<bool> posting(true);
+    std::thread poster([&] {
+        Station station(port);
+        for (int i = 0; i < events; i++) {
+            station.post("ST-" + std::to_string(i % devices));
+        }
+        posting = false;
+    });
+    
+    std::map<std::string, uint64_t> lastSeq;
+    std::string epoch;
+    bool ordered = true;
+    int reconnects = 0;
+    uint64_t received = 0;
+    while (true) {
+        std::string target = "/ws?hello=1";
+        if (!epoch.empty()) {
+            target = "/ws?epoch=" + epoch + "&since=";
+            for (const auto& item : lastSeq) {
+                target += item.first + ":" + std::to_string(item.second) + ",";
+            }
+        }
+        std::string buffer;
+        int fd = subscribe(port, target.c_str(), 0, &buffer);
+        if (fd < 0) {
+            ordered = false;
+            break;
+        }
+        reconnects++;
+        bool finished = !posting;
+        // Đọc một ít (hoặc tới hết nếu trạm đã gửi xong) rồi ngắt giữa chừng
+        size_t budget = finished ? SIZE_MAX : 50 + reconnects * 37 % 200;
+        size_t taken = 0;
+        while (taken < budget) {
+            uint8_t opcode;
+            std::string payload;
+            if (!takeFrame(buffer, opcode, payload)) {
+                if (!receiveMore(fd, buffer, finished ? 300 : 2000)) {
+                    break;
+                }
+                continue;
+            }
+            taken++;
+            if (payload.find("\"type\":\"hello\"") == 1) {
+                if (epoch.empty()) {
+                    // Lần đầu: mốc là seq hiện tại, sự kiện trước đó không thuộc phiên này
+                    epoch = helloEpoch(payload);
+                    size_t at = payload.find("\"seq\":{");
+                    for (int d = 0; d < devices; d++) {
+                        std::string key = "\"ST-" + std::to_string(d) + "\":";
+                        size_t field = payload.find(key, at);
+                        lastSeq["ST-" + std::to_string(d)] = field == std::string::npos
+                                                                  ? 0
+                                                                  : strtoull(payload.c_str() + field + key.size(), nullptr, 10);
+                    }
+                }
+                continue;
+            }
+            std::string device = eventDevice(payload);
+            uint64_t seq = eventSeq(payload);
+            if (seq != lastSeq[device] + 1) {
+                ordered = false;
+            }
+            lastSeq[device] = seq;
+            received++;
+        }
+        close(fd);
+        if (finished) {
+            break;
+        }
+    }
+    poster.join();
+    
+    uint64_t expected = 0;
+    for (const auto& item : lastSeq) {
+        expected += item.second;
+    }
+    expect(ordered, "every station's seq contiguous across reconnects");
+    expect(lastSeq.size() == devices && expected == (uint64_t)events, "last seq of every station reached");
+    printf("  %d connections, %llu events received\n", reconnects, (unsigned long long)received);
+}
+
+// ============================================
+// Thông lượng phát lại
+// ============================================
+
+static void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void runReplayLoad(int clients, int events, int devices) {
+    printf("\nReplay load: %d clients resume from seq 0 over %d events, %d stations\n", clients, events, devices);
+    raiseFileLimit();
+    GatewayConfig config;
+    config.port = 0;
+    config.replayBytes = 256 * 1024 * 1024;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    // Trạm gửi theo lô trên một kết nối keep-alive
+    int station = connectLocal(port);
+    std::string stationBuffer;
+    std::string response;
+    int answered = 0;
+    uint64_t eventBytes = 0;
+    for (int sent = 0; sent < events;) {
+        std::string batch;
+        for (int i = 0; i < 64 && sent < events; i++, sent++) {
+            std::string event = scanEvent("ST-" + std::to_string(sent % devices), sent, 0);
+            eventBytes += event.size();
+            batch += postRequest(event);
+        }
+        sendAll(station, batch);
+        while (answered < sent) {
+            if (takeResponse(stationBuffer, response)) {
+                answered++;
+            } else if (!receiveMore(station, stationBuffer, 5000)) {
+                break;
+            }
+        }
+    }
+    close(station);
+    std::string buffer;
+    int probe = subscribe(port, "/ws?hello=1", 0, &buffer);
+    std::vector<std::string> hello = readFrames(probe, buffer, 200);
+    close(probe);
+    std::string epoch = hello.empty() ? std::string() : helloEpoch(hello[0]);
+    std::string since;
+    for (int d = 0; d < devices; d++) {
+        since += (d > 0 ? ",ST-" : "ST-") + std::to_string(d) + ":0";
+    }
+    std::string target = "/ws?epoch=" + epoch + "&since=" + since;
+    
+    // Mọi client nối lại cùng lúc, một thread đọc tất cả
+    std::vector<int> fds;
+    uint64_t start = nowNs();
+    for (int i = 0; i < clients; i++) {
+        int fd = connectLocal(port);
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: gateway\r\nUpgrade: websocket\r\n"
+                              "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                              "Sec-WebSocket-Version: 13\r\n\r\n";
+        if (fd < 0 || !sendAll(fd, request)) {
+            expect(false, "client connected");
+            return;
+        }
+        fds.push_back(fd);
+    }
+    int epollFd = epoll_create1(0);
+    std::vector<std::string> buffers(clients);
+    std::vector<bool> upgraded(clients, false);
+    std::vector<uint64_t> frames(clients, 0);
+    for (int i = 0; i < clients; i++) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+    const uint64_t expected = (uint64_t)clients * events;
+    uint64_t total = 0;
+    uint64_t bytes = 0;
+    bool orderedAll = true;
+    epoll_event ready[256];
+    char chunk[65536];
+    uint64_t deadline = nowNs() + 120000000000ull;
+    while (total < expected && nowNs() < deadline) {
+        int n = epoll_wait(epollFd, ready, 256, 1000);
+        for (int e = 0; e < n; e++) {
+            size_t index = ready[e].data.u64;
+            ssize_t got = recv(fds[index], chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (got <= 0) {
+                continue;
+            }
+            bytes += got;
+            std::string& in = buffers[index];
+            in.append(chunk, got);
+            if (!upgraded[index]) {
+                size_t end = in.find("\r\n\r\n");
+                if (end == std::string::npos) {
+                    continue;
+                }
+                in.erase(0, end + 4);
+                upgraded[index] = true;
+            }
+            uint8_t opcode;
+            std::string payload;
+            while (takeFrame(in, opcode, payload)) {
+                if (payload.compare(0, 7, "{\"seq\":") != 0) {
+                    continue;
+                }
+                uint64_t sequence;
+                uint64_t ns;
+                if (!benchFields(payload, sequence, ns) || sequence != frames[index]) {
+                    orderedAll = false;
+                }
+                frames[index]++;
+                total++;
+            }
+        }
+    }
+    uint64_t elapsed = nowNs() - start;
+    close(epollFd);
+    for (int fd : fds) {
+        close(fd);
+    }
+    gateway.stop();
+    const GatewayStats& stats = gateway.server.getStats();
+    
+    expect(total == expected, "every client replayed every event");
+    expect(orderedAll, "replay in arrival order for every client");
+    expect(stats.slowDropped == 0, "no resuming client dropped");
+    double seconds = elapsed / 1e9;
+    printf("\n%-34s %14llu\n", "events retained", (unsigned long long)events);
+    printf("%-34s %14.1f MB\n", "event payload retained", eventBytes / 1e6);
+    printf("%-34s %14.0f\n", "frames/s replayed", total / seconds);
+    printf("%-34s %14.1f MB/s\n", "bytes/s replayed", bytes / seconds / 1e6);
+    printf("%-34s %14.3f s\n", "all clients caught up in", seconds);
+    printf("%-34s %14.3f\n", "sendmsg calls per frame", stats.replayed ? (double)stats.writeCalls / stats.replayed : 0);
+}
+
+int main(int argc, char** argv) {
+    int clients = argc > 1 ? atoi(argv[1]) : 100;
+    int events = argc > 2 ? atoi(argv[2]) : 10000;
+    int devices = argc > 3 ? atoi(argv[3]) : 50;
+    
+    checkHelloAndResume();
+    checkSmallRing();
+    checkResumeUnderLoad();
+    runReplayLoad(std::max(1, clients), std::max(1, events), std::max(1, devices));
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,413 @@
+// Ghi PostgreSQL theo lô (ScanStore): GatewayServer chạy trong tiến trình, ghi vào
+// PgStandin (server giả nói giao thức v3 qua libpq, COMMIT = ghi WAL + fdatasync).
+// Kiểm tra 202 chỉ tới sau COMMIT, nội dung dòng COPY (escape, tiếng Việt, \u), phiếu
+// mượn với cột NULL, dòng DB từ chối trả 400 mà các dòng cùng lô vẫn vào, thứ tự phản hồi
+// khi POST/GET xen kẽ, hàng đợi đầy / DB mất trả 503 rồi tự kết nối lại; sau đó đo dòng/s
+// và độ trễ 202 của nhiều trạm gửi nối tiếp: commit từng dòng so với group commit.
+//
+//   STORE_BENCH_CONNINFO="host=127.0.0.1 dbname=library user=gateway" store_bench [stations=64] [seconds=2]
+//   store_bench [stations=64] [seconds=2] [conninfo]
+//
+// Phần đo ghi vào PostgreSQL thật (đã chạy setup_postgres.sql) theo conninfo hoặc
+// STORE_BENCH_CONNINFO; phần kiểm tra luôn dùng PgStandin. Không có conninfo thì phần đo
+// chạy trên PgStandin và mọi dòng kết quả mang nhãn [stand-in]: chỉ để so các chế độ với
+// nhau, không phải số của PostgreSQL.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gateway_client.h"
+#include "pg_standin.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static std::string borrowRequest(const std::string& body) {
+    return "POST /borrows HTTP/1.1\r\nHost: gateway\r\nContent-Type: application/json\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static int statusOf(const std::string& response) {
+    return response.size() > 12 ? atoi(response.c_str() + 9) : 0;
+}
+
+// Gửi nhiều request một lần (pipelining), trả về mã trạng thái theo thứ tự nhận
+static std::vector<int> pipeline(int fd, const std::string& requests, size_t count, std::string& buffer) {
+    std::vector<int> statuses;
+    if (!sendAll(fd, requests)) {
+        return statuses;
+    }
+    while (statuses.size() < count) {
+        std::string response = readResponse(fd, buffer);
+        if (response.empty()) {
+            break;
+        }
+        statuses.push_back(statusOf(response));
+    }
+    return statuses;
+}
+
+static uint64_t metric(uint16_t port, const std::string& name) {
+    std::string metrics = exchange(port, "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n");
+    size_t line = metrics.find("\n" + name + " ");
+    return line == std::string::npos ? 0 : strtoull(metrics.c_str() + line + name.size() + 2, nullptr, 10);
+}
+
+static GatewayConfig storeConfig(const std::string& conninfo) {
+    GatewayConfig config;
+    config.port = 0;
+    config.store.conninfo = conninfo;
+    config.store.reconnectMs = 200;
+    return config;
+}
+
+// "YYYY-MM-DD HH:MM:SS.ffffff+00"
+static bool timestampShape(const std::string& value) {
+    const char* shape = "dddd-dd-dd dd:dd:dd.dddddd+00";
+    if (value.size() != strlen(shape)) {
+        return false;
+    }
+    for (size_t i = 0; i < value.size(); i++) {
+        if (shape[i] == 'd' ? (value[i] < '0' || value[i] > '9') : value[i] != shape[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================
+// Kiểm tra
+// ============================================
+
+static void checkDurableAck() {
+    printf("Ack after commit\n");
+    const int events = 200;
+    PgStandin database;
+    database.commitDelayUs = 2000;
+    RunningGateway gateway(storeConfig(database.conninfo()));
+    uint16_t port = gateway.server.getPort();
+    
+    std::vector<std::string> bodies;
+    std::string requests;
+    for (int i = 0; i < events; i++) {
+        bodies.push_back(scanEvent("ST-1", i, 0));
+        requests += postRequest(bodies.back());
+    }
+    int fd = connectLocal(port);
+    std::string buffer;
+    sendAll(fd, requests);
+    int accepted = 0;
+    bool durable = true;
+    for (int i = 0; i < events; i++) {
+        std::string response = readResponse(fd, buffer);
+        if (statusOf(response) != 202) {
+            break;
+        }
+        accepted++;
+        durable &= database.committedRows() >= (uint64_t)accepted;
+    }
+    close(fd);
+    expect(accepted == events, "every pipelined event -> 202");
+    expect(durable, "each 202 arrives only after its row is committed");
+    expect(database.commits() < (uint64_t)events, "pipelined rows share transactions");
+    
+    std::vector<std::string> rows = database.rows("iot_scan_events");
+    bool exact = rows.size() == (size_t)events;
+    for (size_t i = 0; exact && i < rows.size(); i++) {
+        std::vector<std::string> fields = PgStandin::fields(rows[i]);
+        exact = fields.size() == 6 && fields[0] == "ST-1" && fields[1] == "student_card" && fields[2] == "04A1B2C3" &&
+                fields[3] == "t" && fields[4] == bodies[i] && timestampShape(fields[5]);
+    }
+    expect(exact, "rows in POST order: columns + raw payload + received_at");
+    gateway.stop();
+    printf("  %d rows in %llu commits\n", events, (unsigned long long)database.commits());
+}
+
+static void checkEncoding() {
+    printf("COPY encoding\n");
+    PgStandin database;
+    RunningGateway gateway(storeConfig(database.conninfo()));
+    uint16_t port = gateway.server.getPort();
+    
+    // JSON nhiều dòng (tab/xuống dòng giữa các token), escape trong chuỗi, \u tiếng Việt + emoji
+    // (device_id không được escape: publish() từ chối như trước)
+    std::string pretty = "{\n\t\"device_id\": \"ST-ĐẠ\",\n\t\"scan_type\": \"book\",\n"
+                         "\t\"scan_data\": \"a\\\"b\\\\c\\nd\\te \\u0110\\u1ea0 \\ud83d\\ude00\",\n\t\"success\": false,\n"
+                         "\t\"data\": {\"title\": \"Lập trình C\\\\C++\"}\n}";
+    std::string noType = "{\"device_id\":\"ST-2\",\"scan_data\":\"X\",\"success\":true}";
+    std::string longId = "{\"device_id\":\"" + std::string(65, 'A') + "\",\"scan_type\":\"book\"}";
+    std::string requests = postRequest(pretty) + postRequest(noType) + postRequest(longId) + postRequest("{\"oops\"");
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::vector<int> statuses = pipeline(fd, requests, 4, buffer);
+    close(fd);
+    expect(statuses == std::vector<int>({202, 202, 400, 400}), "valid -> 202, 65-char device_id / bad JSON -> 400");
+    
+    std::vector<std::string> rows = database.rows("iot_scan_events");
+    std::vector<std::string> first = rows.size() == 2 ? PgStandin::fields(rows[0]) : std::vector<std::string>();
+    std::vector<std::string> second = rows.size() == 2 ? PgStandin::fields(rows[1]) : std::vector<std::string>();
+    expect(first.size() == 6 && first[0] == "ST-ĐẠ" && first[2] == "a\"b\\c\nd\te ĐẠ 😀" && first[3] == "f",
+           "string escapes and \\u surrogates decoded into columns");
+    expect(first.size() == 6 && first[4] == pretty, "payload round-trips byte for byte (tabs, newlines, \\)");
+    expect(second.size() == 6 && second[1].empty() && second[3] == "t", "missing scan_type -> empty, not rejected");
+    gateway.stop();
+}
+
+static void checkBorrows() {
+    printf("Borrow cards\n");
+    PgStandin database;
+    RunningGateway gateway(storeConfig(database.conninfo()));
+    uint16_t port = gateway.server.getPort();
+    
+    std::string full = "{\"borrower_name\":\"Trần Thị Bình\",\"borrower_class\":\"CNTT-K62\","
+                       "\"borrower_student_id\":\"SV202100042\",\"borrower_phone\":\"0912345678\","
+                       "\"borrower_email\":\"binh@example.edu.vn\",\"book_name\":\"Cấu trúc dữ liệu\","
+                       "\"book_code\":\"CTDL-01\",\"borrow_date\":\"2026-10-19\",\"expected_return_date\":\"2026-11-02\"}";
+    std::string minimal = "{\"borrower_name\":\"Lê Văn C\",\"book_name\":\"Giải tích 1\","
+                          "\"borrow_date\":\"2026-10-19\",\"expected_return_date\":\"2026-10-26\"}";
+    std::string longName;
+    for (int i = 0; i < 255; i++) {
+        longName += "ễ";
+    }
+    std::string maxName = "{\"borrower_name\":\"" + longName + "\",\"book_name\":\"B\","
+                          "\"borrow_date\":\"2026-10-19\",\"expected_return_date\":\"2026-10-26\"}";
+    std::string tooLong = "{\"borrower_name\":\"" + longName + "e\",\"book_name\":\"B\","
+                          "\"borrow_date\":\"2026-10-19\",\"expected_return_date\":\"2026-10-26\"}";
+    std::string badDate = "{\"borrower_name\":\"D\",\"book_name\":\"B\","
+                          "\"borrow_date\":\"19/10/2026\",\"expected_return_date\":\"2026-10-26\"}";
+    std::string noBook = "{\"borrower_name\":\"D\",\"borrow_date\":\"2026-10-19\",\"expected_return_date\":\"2026-10-26\"}";
+    std::string requests = borrowRequest(full) + borrowRequest(minimal) + borrowRequest(maxName) +
+                           borrowRequest(tooLong) + borrowRequest(badDate) + borrowRequest(noBook);
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::vector<int> statuses = pipeline(fd, requests, 6, buffer);
+    close(fd);
+    expect(statuses == std::vector<int>({202, 202, 202, 400, 400, 400}),
+           "valid -> 202; 256 chars / bad date / no book -> 400");
+    
+    std::vector<std::string> rows = database.rows("borrow_cards");
+    std::vector<bool> nulls;
+    std::vector<std::string> first = rows.size() == 3 ? PgStandin::fields(rows[0]) : std::vector<std::string>();
+    std::vector<std::string> second = rows.size() == 3 ? PgStandin::fields(rows[1], &nulls) : std::vector<std::string>();
+    expect(first.size() == 9 && first[0] == "Trần Thị Bình" && first[5] == "Cấu trúc dữ liệu" &&
+           first[8] == "2026-11-02", "all nine columns in COPY order");
+    expect(second.size() == 9 && nulls == std::vector<bool>({false, true, true, true, true, false, true, false, false}),
+           "missing optional fields -> NULL");
+    expect(rows.size() == 3 && PgStandin::fields(rows[2])[0] == longName, "VARCHAR(255) counts characters, not bytes");
+    gateway.stop();
+}
+
+static void checkRejectedRow() {
+    printf("Row rejected by the database\n");
+    const int events = 20;
+    const int poison = 7;
+    PgStandin database;
+    database.commitDelayUs = 5000;
+    RunningGateway gateway(storeConfig(database.conninfo()));
+    uint16_t port = gateway.server.getPort();
+    
+    std::string requests;
+    for (int i = 0; i < events; i++) {
+        std::string event = scanEvent("ST-1", i, 0);
+        if (i == poison) {
+            size_t data = event.find("04A1B2C3");
+            event.replace(data, 8, "POISON");
+        }
+        requests += postRequest(event);
+    }
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::vector<int> statuses = pipeline(fd, requests, events, buffer);
+    close(fd);
+    std::vector<int> wanted(events, 202);
+    wanted[poison] = 400;
+    expect(statuses == wanted, "only the rejected row -> 400, the rest of its batch -> 202");
+    
+    std::vector<std::string> rows = database.rows("iot_scan_events");
+    bool clean = rows.size() == events - 1;
+    for (const std::string& row : rows) {
+        clean &= row.find("POISON") == std::string::npos;
+    }
+    expect(clean, "other rows committed, rejected row absent");
+    expect(metric(port, "gateway_store_rejected_rows_total") == 1, "gateway_store_rejected_rows_total == 1");
+    gateway.stop();
+}
+
+static void checkOrdering() {
+    printf("Pipelined ordering\n");
+    PgStandin database;
+    database.commitDelayUs = 20000;
+    RunningGateway gateway(storeConfig(database.conninfo()));
+    uint16_t port = gateway.server.getPort();
+    
+    // GET /metrics không được vượt lên trước các POST đang chờ commit
+    std::string requests = postRequest(scanEvent("ST-1", 0, 0)) + "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n" +
+                           postRequest("{\"device_id\":") + postRequest(scanEvent("ST-1", 1, 0)) +
+                           "GET /nowhere HTTP/1.1\r\nHost: gateway\r\n\r\n";
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::vector<int> statuses = pipeline(fd, requests, 5, buffer);
+    close(fd);
+    expect(statuses == std::vector<int>({202, 200, 400, 202, 404}), "responses in request order across commits");
+    
+    // Trạm ngắt khi POST còn chờ commit: dòng vẫn ghi, gateway không dùng kết nối đã giải phóng
+    fd = connectLocal(port);
+    sendAll(fd, postRequest(scanEvent("ST-2", 0, 0)) + postRequest(scanEvent("ST-2", 1, 0)));
+    close(fd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    expect(database.rows("iot_scan_events").size() == 4, "rows of a station that hung up still committed");
+    expect(statusOf(exchange(port, postRequest(scanEvent("ST-3", 0, 0)))) == 202, "gateway still serving");
+    gateway.stop();
+}
+
+static void checkBackpressure() {
+    printf("Queue full and database down\n");
+    PgStandin database;
+    database.commitDelayUs = 50000;
+    GatewayConfig config = storeConfig(database.conninfo());
+    config.store.maxPending = 4;
+    config.store.maxRows = 4;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    std::string requests;
+    for (int i = 0; i < 40; i++) {
+        requests += postRequest(scanEvent("ST-1", i, 0));
+    }
+    int fd = connectLocal(port);
+    std::string buffer;
+    std::vector<int> statuses = pipeline(fd, requests, 40, buffer);
+    close(fd);
+    size_t accepted = std::count(statuses.begin(), statuses.end(), 202);
+    size_t refused = std::count(statuses.begin(), statuses.end(), 503);
+    expect(statuses.size() == 40 && refused > 0 && accepted + refused == 40, "queue over --store-queue -> 503");
+    expect(database.committedRows() == accepted, "exactly the 202 rows are committed");
+    
+    database.commitDelayUs = 0;
+    database.setDown(true);
+    int lost = statusOf(exchange(port, postRequest(scanEvent("ST-1", 100, 0))));
+    int stillDown = statusOf(exchange(port, postRequest(scanEvent("ST-1", 101, 0))));
+    expect(lost == 503 && stillDown == 503, "database down -> 503 (station keeps the scan and retries)");
+    database.setDown(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.store.reconnectMs + 50));
+    expect(statusOf(exchange(port, postRequest(scanEvent("ST-1", 102, 0)))) == 202, "reconnects once it is back");
+    expect(metric(port, "gateway_store_failed_rows_total") == refused + 2, "gateway_store_failed_rows_total");
+    gateway.stop();
+}
+
+// ============================================
+// Đo: trạm gửi nối tiếp (chờ 202 rồi mới gửi tiếp, như firmware)
+// ============================================
+
+struct LoadResult {
+    double rowsPerSecond;
+    double p50Us;
+    double p99Us;
+    double rowsPerCommit;
+};
+
+static LoadResult runLoad(const char* name, const std::string& conninfo, uint32_t windowUs, size_t maxRows,
+                          int stations, int seconds) {
+    PgStandin database;
+    database.keepRows = false;
+    GatewayConfig config = storeConfig(conninfo.empty() ? database.conninfo() : conninfo);
+    config.store.windowUs = windowUs;
+    config.store.maxRows = maxRows;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    std::atomic<bool> running{true};
+    std::atomic<int> errors{0};
+    std::vector<std::vector<uint32_t>> latencies(stations);
+    std::vector<std::thread> threads;
+    for (int s = 0; s < stations; s++) {
+        threads.emplace_back([&, s] {
+            std::string deviceId = "ST-" + std::to_string(s);
+            int fd = connectLocal(port);
+            std::string buffer;
+            uint64_t counter = 0;
+            while (running) {
+                uint64_t sent = nowNs();
+                if (!sendAll(fd, postRequest(scanEvent(deviceId, counter++, sent))) ||
+                    statusOf(readResponse(fd, buffer)) != 202) {
+                    errors++;
+                    break;
+                }
+                latencies[s].push_back((uint32_t)((nowNs() - sent) / 1000));
+            }
+            close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    uint64_t rows = metric(port, "gateway_store_rows_total");
+    uint64_t commits = metric(port, "gateway_store_commits_total");
+    gateway.stop();
+    
+    std::vector<uint32_t> all;
+    for (const std::vector<uint32_t>& station : latencies) {
+        all.insert(all.end(), station.begin(), station.end());
+    }
+    std::sort(all.begin(), all.end());
+    LoadResult result = {};
+    if (!all.empty()) {
+        result.rowsPerSecond = (double)all.size() / seconds;
+        result.p50Us = all[all.size() / 2];
+        result.p99Us = all[all.size() * 99 / 100];
+    }
+    result.rowsPerCommit = commits ? (double)rows / commits : 0;
+    printf("%-28s %10.0f %10.0f %10.0f %12.1f%s\n", name, result.rowsPerSecond, result.p50Us, result.p99Us,
+           result.rowsPerCommit, conninfo.empty() ? " [stand-in]" : "");
+    if (errors > 0) {
+        printf("  %d stations stopped on a non-202 response\n", errors.load());
+    }
+    if (conninfo.empty() && database.commits() > 0) {
+        printf("  (fdatasync + commit on the stand-in: %.0f us avg)\n",
+               (double)database.fsyncUsTotal() / database.commits());
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int stations = argc > 1 ? std::max(1, atoi(argv[1])) : 64;
+    int seconds = argc > 2 ? std::max(1, atoi(argv[2])) : 2;
+    const char* environment = getenv("STORE_BENCH_CONNINFO");
+    std::string conninfo = argc > 3 ? argv[3] : environment != nullptr ? environment : "";
+    
+    checkDurableAck();
+    checkEncoding();
+    checkBorrows();
+    checkRejectedRow();
+    checkOrdering();
+    checkBackpressure();
+    
+    printf("\n%d stations, %d s each, %s\n", stations, seconds,
+           conninfo.empty() ? "PgStandin stand-in (WAL fdatasync on /var/tmp), NOT PostgreSQL" : conninfo.c_str());
+    if (conninfo.empty()) {
+        printf("  no conninfo: set STORE_BENCH_CONNINFO or pass it as the third argument for real numbers\n");
+    }
+    printf("%-28s %10s %10s %10s %12s\n", "mode", "rows/s", "p50 us", "p99 us", "rows/commit");
+    LoadResult single = runLoad("commit per row", conninfo, 0, 1, stations, seconds);
+    LoadResult group = runLoad("group commit (default)", conninfo, 0, 4096, stations, seconds);
+    runLoad("group commit, 2 ms window", conninfo, 2000, 4096, stations, seconds);
+    if (stations > 1) {
+        expect(group.rowsPerSecond > single.rowsPerSecond, "group commit beats commit per row");
+    }
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
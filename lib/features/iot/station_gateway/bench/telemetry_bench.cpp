@@ -0,0 +1,568 @@
+// Lịch sử heartbeat (TelemetryStore): mã hóa Gorilla trả lại đúng từng bit (NaN, -0, delta
+// lớn, 4 cột), bucket 5 phút / 1 giờ gộp từ nhiều tầng khớp đúng với gom từ mẫu gốc sau khi
+// mẫu gốc đã hết hạn, mẫu cũ/trùng và giới hạn series, rồi POST /api/iot/heartbeat và
+// GET /api/iot/telemetry qua GatewayServer. Sau đó mô phỏng cả đội trạm gửi heartbeat mỗi
+// 60 s (payload như ApiCodec::createHeartbeatPayload) để đo byte/mẫu, tốc độ ghi và độ trễ
+// truy vấn cho dashboard.
+//
+//   telemetry_bench [stations=1000] [hours=48]
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "gateway_client.h"
+#include "gorilla.h"
+#include "telemetry_store.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAIL");
+    if (!condition) {
+        failures++;
+    }
+}
+
+static int statusOf(const std::string& response) {
+    return response.size() > 12 ? atoi(response.c_str() + 9) : 0;
+}
+
+static std::string bodyOf(const std::string& response) {
+    size_t end = response.find("\r\n\r\n");
+    return end == std::string::npos ? std::string() : response.substr(end + 4);
+}
+
+static uint64_t metric(uint16_t port, const std::string& name) {
+    std::string metrics = exchange(port, "GET /metrics HTTP/1.1\r\nHost: gateway\r\n\r\n");
+    size_t line = metrics.find("\n" + name + " ");
+    return line == std::string::npos ? 0 : strtoull(metrics.c_str() + line + name.size() + 2, nullptr, 10);
+}
+
+static int64_t unixNow() {
+    return (int64_t)time(nullptr);
+}
+
+static uint64_t percentile(std::vector<uint64_t>& values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0 : values[std::min(values.size() - 1, (size_t)(values.size() * fraction))];
+}
+
+// ============================================
+// Mã hóa
+// ============================================
+
+static bool sameBits(double a, double b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Ghi rồi đọc lại; true nếu mọi timestamp và mọi bit giá trị trùng khớp
+static bool roundTrip(const std::vector<int64_t>& times, const std::vector<std::vector<double>>& rows, uint8_t columns,
+                      double* bitsPerSample = nullptr) {
+    GorillaEncoder encoder(columns);
+    for (size_t i = 0; i < times.size(); i++) {
+        encoder.append(times[i], rows[i].data());
+    }
+    GorillaBlock block = encoder.seal();
+    if (bitsPerSample != nullptr) {
+        *bitsPerSample = times.empty() ? 0 : block.bytes() * 8.0 / times.size();
+    }
+    GorillaDecoder decoder(block);
+    double values[GORILLA_MAX_COLUMNS];
+    int64_t time;
+    for (size_t i = 0; i < times.size(); i++) {
+        if (!decoder.next(time, values) || time != times[i]) {
+            return false;
+        }
+        for (int c = 0; c < columns; c++) {
+            if (!sameBits(values[c], rows[i][c])) {
+                return false;
+            }
+        }
+    }
+    return !decoder.next(time, values) && block.count == times.size() && encoder.empty();
+}
+
+static void checkCodec() {
+    printf("Gorilla codec\n");
+    std::mt19937_64 rng(7);
+    const double specials[] = {0.0, -0.0, NAN, INFINITY, -INFINITY, 5e-324, 1.7976931348623157e308, -1.0, 0.1};
+    
+    std::vector<int64_t> times;
+    std::vector<std::vector<double>> rows;
+    int64_t t = 1760000000;
+    for (int i = 0; i < 5000; i++) {
+        // Mọi khoảng delta-of-delta: 0, ±1, vài trăm, vài nghìn, hàng triệu giây
+        static const int64_t GAPS[] = {60, 60, 61, 59, 1, 120, 600, 3000, 9000, 4000000};
+        t += GAPS[rng() % 10];
+        times.push_back(t);
+        double value;
+        switch (rng() % 4) {
+            case 0: value = specials[rng() % 9]; break;
+            case 1: value = (double)(int64_t)(rng() % 1000000); break;
+            case 2: value = std::ldexp((double)(rng() >> 11), (int)(rng() % 200) - 100); break;
+            default: value = rows.empty() ? 1.0 : rows.back()[0]; break;
+        }
+        rows.push_back({value});
+    }
+    expect(roundTrip(times, rows, 1), "1 column: NaN, -0, inf, denormals, every dod range");
+    
+    for (auto& row : rows) {
+        row = {row[0], (double)(rng() % 7), -row[0], 42.0};
+    }
+    expect(roundTrip(times, rows, 4), "4 columns (min, max, sum, count)");
+    expect(roundTrip({1760000000}, {{123.0}}, 1), "single sample");
+    
+    // Heartbeat điển hình: 60 s (đôi khi 61), heap đi lên xuống theo bội 4
+    std::vector<int64_t> beatTimes;
+    std::vector<std::vector<double>> heap;
+    std::vector<std::vector<double>> constant;
+    double freeHeap = 183452;
+    t = 1760000000;
+    for (int i = 0; i < 120; i++) {
+        t += rng() % 4 == 0 ? 61 : 60;
+        beatTimes.push_back(t);
+        freeHeap += 4.0 * (int)(rng() % 501) - 1000.0;
+        heap.push_back({freeHeap});
+        constant.push_back({2140});
+    }
+    double heapBits = 0;
+    double constantBits = 0;
+    bool ok = roundTrip(beatTimes, heap, 1, &heapBits) && roundTrip(beatTimes, constant, 1, &constantBits);
+    printf("  2 h block, 60 s heartbeat: free_heap %.1f bits/sample, constant metric %.1f bits/sample\n", heapBits,
+           constantBits);
+    expect(ok && heapBits < 40 && constantBits < 6, "heartbeat series compress (vs 128 bits raw)");
+}
+
+// ============================================
+// Gộp nhiều tầng
+// ============================================
+
+struct Sample {
+    int64_t time;
+    double value;
+};
+
+// Gom trực tiếp từ mẫu gốc, cùng quy ước với TelemetryStore::range
+static std::vector<TelemetryBucket> bruteForce(const std::vector<Sample>& samples, int64_t from, int64_t to,
+                                               int64_t step) {
+    auto floorTo = [](int64_t value, int64_t unit) { return value - (((value % unit) + unit) % unit); };
+    int64_t first = floorTo(from, step);
+    int64_t end = floorTo(to, step) + step;
+    std::map<int64_t, TelemetryBucket> buckets;
+    for (const Sample& sample : samples) {
+        if (sample.time < first || sample.time >= end) {
+            continue;
+        }
+        int64_t start = floorTo(sample.time, step);
+        auto it = buckets.find(start);
+        if (it == buckets.end()) {
+            buckets[start] = {start, sample.value, sample.value, sample.value, 1};
+        } else {
+            it->second.min = std::min(it->second.min, sample.value);
+            it->second.max = std::max(it->second.max, sample.value);
+            it->second.sum += sample.value;
+            it->second.count++;
+        }
+    }
+    std::vector<TelemetryBucket> out;
+    for (const auto& item : buckets) {
+        out.push_back(item.second);
+    }
+    return out;
+}
+
+static bool sameBuckets(const std::vector<TelemetryBucket>& a, const std::vector<TelemetryBucket>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].start != b[i].start || a[i].min != b[i].min || a[i].max != b[i].max || a[i].sum != b[i].sum ||
+            a[i].count != b[i].count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkRollups() {
+    printf("Rollups and retention\n");
+    TelemetryConfig config;
+    config.rawRetentionS = 6 * 3600;
+    config.rollupRetentionS = 3 * 86400;
+    config.coarseRetentionS = 400 * 86400;
+    TelemetryStore store(config);
+    
+    // 20 ngày heartbeat không đều (trạm mất điện vài giờ, đổi chu kỳ), giá trị nguyên để tổng chính xác
+    std::mt19937 rng(11);
+    std::vector<Sample> samples;
+    int64_t now = 1760000000 + 1234;
+    double value = 180000;
+    int64_t end = now + 20 * 86400;
+    while (now < end) {
+        now += rng() % 50 == 0 ? 3600 + rng() % 7200 : 30 + rng() % 90;
+        value += (int)(rng() % 2001) - 1000;
+        store.append("ST-01", "memory.free_heap", now, value);
+        samples.push_back({now, value});
+        if (rng() % 500 == 0) {
+            store.expire(now);
+        }
+    }
+    store.expire(now);
+    TelemetryStats stats = store.getStats();
+    
+    std::vector<TelemetryBucket> got;
+    int64_t history = samples.front().time - samples.front().time % 3600;     // Biên giờ: mọi step dưới đây chung from
+    bool all = store.range("ST-01", "memory.free_heap", history, now, 3600, got) &&
+               sameBuckets(got, bruteForce(samples, history, now, 3600));
+    expect(all, "20 days at 1 h step (1 h tier only) == brute force");
+    
+    // Step 60 s trên cả lịch sử: mẫu gốc + 5 phút + 1 giờ. Bucket của tầng gộp nằm đúng ở start
+    // của nó, nên gom lại theo giờ phải khớp: không mẫu nào mất hay bị đếm hai lần ở ranh giới
+    std::vector<TelemetryBucket> fine;
+    store.range("ST-01", "memory.free_heap", history, now, 60, fine);
+    std::map<int64_t, TelemetryBucket> hourly;
+    for (const TelemetryBucket& bucket : fine) {
+        int64_t hour = bucket.start - bucket.start % 3600;
+        auto it = hourly.find(hour);
+        if (it == hourly.end()) {
+            hourly[hour] = {hour, bucket.min, bucket.max, bucket.sum, bucket.count};
+        } else {
+            it->second.min = std::min(it->second.min, bucket.min);
+            it->second.max = std::max(it->second.max, bucket.max);
+            it->second.sum += bucket.sum;
+            it->second.count += bucket.count;
+        }
+    }
+    std::vector<TelemetryBucket> regrouped;
+    for (const auto& item : hourly) {
+        regrouped.push_back(item.second);
+    }
+    expect(fine.size() > got.size() && sameBuckets(regrouped, bruteForce(samples, history, now, 3600)),
+           "60 s step across raw / 5 min / 1 h edges: every sample once");
+    bool day = true;
+    for (int64_t step : {86400, 7200, 3600 * 24 * 7}) {
+        day = day && store.range("ST-01", "memory.free_heap", history, now, step, got) &&
+              sameBuckets(got, bruteForce(samples, history, now, step));
+    }
+    expect(day, "2 h / 1 day / 1 week steps over full history");
+    int64_t rollupFrom = now - config.rollupRetentionS + 2 * 3600;
+    bool rollup = true;
+    for (int64_t step : {300, 900, 1800}) {
+        rollup = rollup && store.range("ST-01", "memory.free_heap", rollupFrom, now, step, got) &&
+                 sameBuckets(got, bruteForce(samples, rollupFrom, now, step));
+    }
+    expect(rollup, "5/15/30 min steps inside 5 min retention");
+    int64_t rawFrom = now - config.rawRetentionS + config.blockSpanS + 600;
+    bool raw = true;
+    for (int64_t step : {60, 7, 300}) {
+        raw = raw && store.range("ST-01", "memory.free_heap", rawFrom, now, step, got) &&
+              sameBuckets(got, bruteForce(samples, rawFrom, now, step));
+    }
+    expect(raw, "60 s / 7 s steps inside raw retention");
+    
+    std::vector<TelemetryPoint> points;
+    bool truncated;
+    store.raw("ST-01", "memory.free_heap", rawFrom, now, 1000000, points, truncated);
+    size_t wanted = 0;
+    for (const Sample& sample : samples) {
+        wanted += sample.time >= rawFrom ? 1 : 0;
+    }
+    expect(!truncated && points.size() == wanted && points.back().time == now && points.back().value == value,
+           "raw() returns every retained sample");
+    store.raw("ST-01", "memory.free_heap", rawFrom, now, 10, points, truncated);
+    expect(truncated && points.size() == 10, "raw() limit -> truncated");
+    expect(stats.rawSamples < samples.size() / 10 && stats.expiredBlocks > 0, "old raw blocks expired");
+    
+    expect(!store.append("ST-01", "memory.free_heap", now, 1) && !store.append("ST-01", "memory.free_heap", now - 60, 1),
+           "duplicate / older timestamp rejected");
+    expect(store.getStats().outOfOrder == 2, "outOfOrder counted");
+    
+    TelemetryConfig small;
+    small.maxSeries = 3;
+    TelemetryStore limited(small);
+    bool accepted = limited.append("A", "x", 100, 1) && limited.append("A", "y", 100, 1) &&
+                    limited.append("B", "x", 100, 1);
+    expect(accepted && !limited.append("B", "y", 100, 1) && !limited.append("C", "x", 100, 1) &&
+           limited.getStats().dropped == 2, "maxSeries -> new series dropped");
+    limited.expire(100 + 401 * 86400);
+    expect(limited.getStats().series == 0 && limited.getStats().devices == 0 && limited.append("C", "x", 500 * 86400, 1),
+           "fully expired series removed, slot reused");
+    expect(!store.range("ST-01", "unknown", 0, now, 60, got) && !store.range("ST-99", "memory.free_heap", 0, now, 60, got),
+           "unknown series -> false");
+}
+
+// ============================================
+// Đội trạm giả
+// ============================================
+
+static const char* const METRICS[] = {
+    "memory.free_heap", "memory.min_free_heap", "memory.largest_free_block", "memory.frag_pct",
+    "memory.heap_drift", "memory.free_psram", "memory.arena_high_water", "memory.arena_overflows",
+    "memory.stack_free.loopTask", "memory.stack_free.rfid", "memory.stack_free.api", "memory.stack_free.oled",
+    "memory.stack_free.usb_host", "config_version",
+};
+static const int METRIC_COUNT = sizeof(METRICS) / sizeof(METRICS[0]);
+
+// Trạng thái heap của một trạm, đổi như HeapMonitor báo: free_heap dao động theo bội 4,
+// min chỉ giảm, các số còn lại gần như không đổi
+struct Station {
+    std::string id;
+    int64_t next;
+    double values[METRIC_COUNT];
+};
+
+static void stepStation(Station& station, std::mt19937& rng) {
+    double* v = station.values;
+    v[0] += 4.0 * (int)(rng() % 1001) - 2000.0;
+    v[1] = std::min(v[1], v[0]);
+    if (rng() % 10 == 0) {
+        v[2] = 4096.0 * (24 + rng() % 6);
+    }
+    v[3] = (double)(int)(100 - 100 * v[2] / v[0]);
+    v[4] = v[0] - 183000;
+    if (rng() % 50 == 0) {
+        v[5] -= 4096;
+    }
+    if (rng() % 200 == 0) {
+        v[6] += 64;
+    }
+    for (int i = 8; i < 13; i++) {
+        if (rng() % 100 == 0) {
+            v[i] -= 16;
+        }
+    }
+    station.next += rng() % 4 == 0 ? 61 : 60;
+}
+
+static void measureFleet(int stations, int hours) {
+    printf("Fleet: %d stations x %d metrics, heartbeat 60 s, %d h simulated\n", stations, METRIC_COUNT, hours);
+    TelemetryConfig config;
+    TelemetryStore store(config);
+    std::mt19937 rng(3);
+    std::vector<Station> fleet(stations);
+    int64_t start = unixNow() - (int64_t)hours * 3600;
+    for (int s = 0; s < stations; s++) {
+        char id[16];
+        snprintf(id, sizeof(id), "ST-%04d", s);
+        Station& station = fleet[s];
+        station.id = id;
+        station.next = start + rng() % 60;
+        double initial[METRIC_COUNT] = {183452, 170000, 110592, 40, 452, 4190000, 2048, 0,
+                                        2140, 1800, 3100, 1500, 2600, 3};
+        memcpy(station.values, initial, sizeof(initial));
+    }
+    
+    // Ghi theo thứ tự thời gian như gateway nhận: mỗi phút mọi trạm một heartbeat
+    std::vector<std::string> names(METRICS, METRICS + METRIC_COUNT);
+    uint64_t appended = 0;
+    uint64_t began = nowNs();
+    int64_t end = start + (int64_t)hours * 3600;
+    for (int64_t minute = start; minute < end; minute += 60) {
+        for (Station& station : fleet) {
+            while (station.next < minute + 60 && station.next < end) {
+                for (int m = 0; m < METRIC_COUNT; m++) {
+                    store.append(station.id, names[m], station.next, station.values[m]);
+                }
+                appended += METRIC_COUNT;
+                stepStation(station, rng);
+            }
+        }
+        if ((minute - start) % 3600 == 0) {
+            store.expire(minute);
+        }
+    }
+    store.expire(end);
+    double seconds = (nowNs() - began) / 1e9;
+    TelemetryStats stats = store.getStats();
+    printf("  appended %llu samples in %.2f s (%.1f M samples/s, %.0f ns each)\n", (unsigned long long)appended,
+           seconds, appended / seconds / 1e6, seconds * 1e9 / appended);
+    printf("  retained: %llu raw samples, %llu rollup buckets, %llu series\n",
+           (unsigned long long)stats.rawSamples, (unsigned long long)stats.rollupPoints,
+           (unsigned long long)stats.series);
+    double rawBytesPerSample = (double)stats.rawBytes / stats.rawSamples;
+    double rollupBytesPerPoint = (double)(stats.payloadBytes - stats.rawBytes) / std::max<uint64_t>(1, stats.rollupPoints);
+    printf("  raw: %.2f bytes/sample (%.1f bits; uncompressed 16 B, one SQL row ~60 B)\n", rawBytesPerSample,
+           rawBytesPerSample * 8);
+    printf("  rollup: %.2f bytes/bucket (min, max, sum, count)\n", rollupBytesPerPoint);
+    printf("  total memory %.1f MB = %.2f bytes per retained raw sample incl. series overhead\n",
+           stats.memoryBytes / 1e6, (double)stats.memoryBytes / stats.rawSamples);
+    // Trạng thái ổn định với thời hạn mặc định, mỗi series
+    double rawPerSeries = config.rawRetentionS / 60.0 * rawBytesPerSample;
+    double rollupPerSeries = ((double)config.rollupRetentionS / TELEMETRY_ROLLUP_STEP_S +
+                              (double)config.coarseRetentionS / TELEMETRY_COARSE_STEP_S) * rollupBytesPerPoint;
+    double perSeries = rawPerSeries + rollupPerSeries + (double)(stats.memoryBytes - stats.payloadBytes) / stats.series;
+    printf("  steady state (%u h raw + %u d @5 min + %u d @1 h): ~%.1f KB/series, ~%.0f MB for this fleet\n",
+           config.rawRetentionS / 3600, config.rollupRetentionS / 86400, config.coarseRetentionS / 86400,
+           perSeries / 1024, perSeries * stats.series / 1e6);
+    expect(rawBytesPerSample < 4, "raw heartbeat samples < 4 bytes each");
+    
+    // Truy vấn của dashboard
+    struct Query {
+        const char* name;
+        int64_t span;
+        int64_t step;
+        bool fleet;
+    };
+    const Query queries[] = {
+        {"1 station, last 1 h raw", 3600, 0, false},
+        {"1 station, 24 h @5 min", 86400, 300, false},
+        {"1 station, full history @1 h", (int64_t)hours * 3600, 3600, false},
+        {"fleet, last 1 h @5 min", 3600, 300, true},
+        {"fleet, 24 h @1 h", 86400, 3600, true},
+    };
+    std::vector<std::string> ids = store.deviceIds();
+    std::vector<TelemetryPoint> points;
+    std::vector<TelemetryBucket> buckets;
+    bool answered = true;
+    for (const Query& query : queries) {
+        std::vector<uint64_t> latencies;
+        int rounds = query.fleet ? 20 : 2000;
+        size_t returned = 0;
+        for (int r = 0; r < rounds; r++) {
+            const std::string& metricName = names[rng() % METRIC_COUNT];
+            uint64_t t0 = nowNs();
+            returned = 0;
+            for (size_t d = query.fleet ? 0 : rng() % ids.size(); d < ids.size(); d++) {
+                bool truncated;
+                if (query.step == 0) {
+                    store.raw(ids[d], metricName, end - query.span, end, 10000, points, truncated);
+                    returned += points.size();
+                } else {
+                    store.range(ids[d], metricName, end - query.span, end, query.step, buckets);
+                    returned += buckets.size();
+                }
+                if (!query.fleet) {
+                    break;
+                }
+            }
+            latencies.push_back(nowNs() - t0);
+        }
+        answered = answered && returned > 0;
+        printf("  %-32s %7zu points  p50 %8.1f us  p99 %8.1f us\n", query.name, returned,
+               percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.99) / 1e3);
+    }
+    expect(answered, "every query returned points");
+}
+
+// ============================================
+// Qua gateway
+// ============================================
+
+// Giống ApiCodec::createHeartbeatPayload của firmware
+static std::string heartbeatRequest(const std::string& device, int64_t timestampMs, int freeHeap) {
+    char body[768];
+    snprintf(body, sizeof(body),
+             "{\"device_id\":\"%s\",\"device_name\":\"Trạm mượn trả\",\"location\":\"Tầng 1\","
+             "\"timestamp\":%lld,\"config_version\":3,\"memory\":{\"free_heap\":%d,\"min_free_heap\":170000,"
+             "\"largest_free_block\":110592,\"frag_pct\":12,\"heap_drift\":-240,\"arena_high_water\":2048,"
+             "\"arena_overflows\":0,\"stack_free\":{\"loopTask\":2140,\"rfid\":1800}}}",
+             device.c_str(), (long long)timestampMs, freeHeap);
+    std::string text = body;
+    return "POST /api/iot/heartbeat HTTP/1.1\r\nHost: gateway\r\nContent-Type: application/json\r\n"
+           "Content-Length: " + std::to_string(text.size()) + "\r\n\r\n" + text;
+}
+
+static std::string getRequest(const std::string& target) {
+    return "GET " + target + " HTTP/1.1\r\nHost: gateway\r\n\r\n";
+}
+
+static void checkGateway(int stations) {
+    printf("POST /api/iot/heartbeat, GET /api/iot/telemetry\n");
+    GatewayConfig config;
+    config.port = 0;
+    RunningGateway gateway(config);
+    uint16_t port = gateway.server.getPort();
+    
+    int64_t now = unixNow();
+    int64_t base = now - 180;
+    std::string first = exchange(port, heartbeatRequest("ST-1", base * 1000, 180000));
+    expect(statusOf(first) == 200 && bodyOf(first) == "{\"success\":true}", "heartbeat -> 200 {\"success\":true}");
+    exchange(port, heartbeatRequest("ST-1", (base + 60) * 1000, 179000));
+    exchange(port, heartbeatRequest("ST-1", (base + 120) * 1000, 181000));
+    exchange(port, heartbeatRequest("ST-1", (base + 120) * 1000, 1));        // Trùng: bỏ
+    exchange(port, heartbeatRequest("ST-2", 0, 200000));                     // Chưa đồng bộ SNTP: giờ nhận
+    
+    std::string target = "/api/iot/telemetry?metric=memory.free_heap&device_id=ST-1&from=" + std::to_string(base) +
+                         "&to=" + std::to_string(now);
+    std::string wanted = "{\"metric\":\"memory.free_heap\",\"from\":" + std::to_string(base) + ",\"to\":" +
+                         std::to_string(now) + ",\"step\":0,\"series\":[{\"device_id\":\"ST-1\",\"points\":[[" +
+                         std::to_string(base) + ",180000],[" + std::to_string(base + 60) + ",179000],[" +
+                         std::to_string(base + 120) + ",181000]]}]}";
+    std::string raw = exchange(port, getRequest(target));
+    expect(statusOf(raw) == 200 && bodyOf(raw) == wanted, "raw points, station timestamps, duplicate dropped");
+    
+    std::string bucketed = bodyOf(exchange(port, getRequest(
+        "/api/iot/telemetry?metric=memory.stack_free.loopTask&device_id=ST-1&step=86400&from=" +
+        std::to_string(base) + "&to=" + std::to_string(now))));
+    expect(bucketed.find(",2140,2140,2140,3]]") != std::string::npos, "step -> [t,min,avg,max,count] (nested key)");
+    std::string fleet = bodyOf(exchange(port, getRequest("/api/iot/telemetry?metric=config_version")));
+    expect(fleet.find("\"device_id\":\"ST-1\"") != std::string::npos &&
+           fleet.find("\"device_id\":\"ST-2\"") != std::string::npos, "no device_id -> every station");
+    std::string list = bodyOf(exchange(port, getRequest("/api/iot/telemetry")));
+    expect(list.find("{\"device_id\":\"ST-1\",\"last_seen\":" + std::to_string(base + 120)) != std::string::npos &&
+           list.find("\"memory.stack_free.rfid\"") != std::string::npos && list.find("timestamp") == std::string::npos,
+           "no metric -> stations and metric names");
+    expect(statusOf(exchange(port, getRequest("/api/iot/telemetry?metric=x&step=1&from=0"))) == 400,
+           "too many buckets -> 400");
+    expect(statusOf(exchange(port, getRequest("/api/iot/telemetry?metric=x&from=abc"))) == 400, "bad from -> 400");
+    std::string bad = "POST /api/iot/heartbeat HTTP/1.1\r\nHost: gateway\r\nContent-Length: 9\r\n\r\n{\"a\":1}  ";
+    expect(statusOf(exchange(port, bad)) == 400, "heartbeat without device_id -> 400");
+    
+    // Cả đội trạm gửi liền 3 heartbeat, rồi dashboard hỏi toàn bộ qua HTTP
+    std::string burst;
+    for (int s = 0; s < stations; s++) {
+        char id[16];
+        snprintf(id, sizeof(id), "HB-%04d", s);
+        for (int k = 0; k < 3; k++) {
+            burst += heartbeatRequest(id, (base + 60 * k) * 1000, 180000 + s * 4 + k * 8);
+        }
+    }
+    uint64_t began = nowNs();
+    int fd = connectLocal(port);
+    std::string buffer;
+    sendAll(fd, burst);
+    int ok = 0;
+    for (int i = 0; i < stations * 3; i++) {
+        ok += statusOf(readResponse(fd, buffer)) == 200 ? 1 : 0;
+    }
+    close(fd);
+    double seconds = (nowNs() - began) / 1e9;
+    printf("  %d heartbeats over one keep-alive connection: %.0f heartbeats/s\n", stations * 3, stations * 3 / seconds);
+    expect(ok == stations * 3, "every heartbeat accepted");
+    
+    std::vector<uint64_t> latencies;
+    size_t bytes = 0;
+    for (int r = 0; r < 20; r++) {
+        uint64_t t0 = nowNs();
+        bytes = bodyOf(exchange(port, getRequest("/api/iot/telemetry?metric=memory.free_heap&step=60&from=" +
+                                                 std::to_string(base) + "&to=" + std::to_string(now)))).size();
+        latencies.push_back(nowNs() - t0);
+    }
+    printf("  fleet query over HTTP (%d series, %zu B JSON): p50 %.2f ms\n", stations + 2, bytes,
+           percentile(latencies, 0.5) / 1e6);
+    expect(metric(port, "gateway_heartbeats_total") == (uint64_t)stations * 3 + 5 &&
+           metric(port, "gateway_telemetry_rejected_total") == 10, "heartbeat / rejected counters");
+    expect(metric(port, "gateway_telemetry_series") == (uint64_t)(stations + 2) * 10, "gateway_telemetry_series");
+    gateway.stop();
+}
+
+int main(int argc, char** argv) {
+    int stations = argc > 1 ? std::max(10, atoi(argv[1])) : 1000;
+    int hours = argc > 2 ? std::max(2, atoi(argv[2])) : 48;
+    
+    checkCodec();
+    checkRollups();
+    checkGateway(std::min(stations, 1000));
+    measureFleet(stations, hours);
+    
+    printf("\n%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
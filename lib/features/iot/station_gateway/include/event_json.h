@@ -0,0 +1,45 @@
+#ifndef EVENT_JSON_H
+#define EVENT_JSON_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define EVENT_DEVICE_ID_MAX 64         // Độ dài device_id tối đa (kể cả '\0')
+
+// Đọc nhanh sự kiện quét (JSON của ApiCodec / IoTScanEventModel) mà không dựng cây
+// JSON: gateway chỉ cần device_id để định tuyến, payload được chuyển nguyên văn.
+namespace EventJson {
+
+// Lấy "device_id" ở cấp ngoài cùng của object (bỏ qua khóa trùng tên trong "data").
+// false nếu không phải một object JSON trọn vẹn, thiếu device_id, hoặc device_id
+// không phải chuỗi/quá dài/có escape
+bool extractDeviceId(const char* json, size_t length, char deviceId[EVENT_DEVICE_ID_MAX]);
+
+// Một khóa ở cấp ngoài cùng: value là token JSON nguyên văn (chuỗi còn dấu ngoặc kép),
+// nullptr nếu không có khóa đó
+struct Field {
+    const char* name;
+    const char* value;
+    size_t length;
+};
+
+// Điền value/length cho các khóa trong fields. false nếu không phải một object JSON trọn vẹn
+bool findFields(const char* json, size_t length, Field* fields, size_t count);
+
+// Token chuỗi JSON → UTF-8 (xử lý escape kể cả \uXXXX). false nếu không phải chuỗi hợp lệ
+bool decodeString(const char* token, size_t length, std::string& out);
+
+// Một giá trị số trong object; tên là các khóa lồng nhau nối bằng '.' ("memory.free_heap")
+struct Number {
+    std::string name;
+    double value;
+};
+
+// Mọi giá trị số (hữu hạn) trong object, tới maxDepth cấp object lồng nhau. Bỏ qua chuỗi,
+// bool, null, mảng và khóa có escape. false nếu không phải một object JSON trọn vẹn
+bool collectNumbers(const char* json, size_t length, std::vector<Number>& out, int maxDepth = 3);
+
+} // namespace EventJson
+
+#endif // EVENT_JSON_H
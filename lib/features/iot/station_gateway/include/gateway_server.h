@@ -0,0 +1,177 @@
+#ifndef GATEWAY_SERVER_H
+#define GATEWAY_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "event_json.h"
+#include "reader_index.h"
+#include "replay_ring.h"
+#include "scan_store.h"
+#include "shared_frame.h"
+#include "telemetry_store.h"
+#include "ws_protocol.h"
+
+struct GatewayConfig {
+    uint16_t port = 8090;              // 0 = cổng tạm (bench)
+    size_t maxConnections = 16384;     // Trạm + app, vượt quá thì từ chối ngay
+    size_t clientQueueBytes = 256 * 1024;  // Byte chờ gửi tối đa của một subscriber
+    int socketSendBytes = 0;           // SO_SNDBUF mỗi kết nối, 0 = để kernel tự chỉnh
+    size_t maxEventBytes = 16 * 1024;  // Body POST /events lớn nhất
+    uint32_t pingIntervalMs = 30000;   // Subscriber im lặng 2 chu kỳ thì ngắt
+    uint32_t requestTimeoutMs = 10000; // Request HTTP / handshake chưa đủ sau thời gian này thì ngắt
+    uint32_t keepAliveTimeoutMs = 60000;   // Kết nối POST của trạm để không quá lâu thì đóng
+    size_t replayBytes = 8 * 1024 * 1024;  // Sự kiện gần nhất giữ lại cho app kết nối lại
+    size_t maxDevices = 4096;          // Số trạm (device_id) khác nhau tối đa
+    StoreConfig store;                 // Ghi sự kiện/phiếu mượn vào PostgreSQL (conninfo rỗng = tắt)
+    ReaderIndexConfig readers;         // Snapshot UID thẻ → độc giả (path rỗng = tắt)
+    TelemetryConfig telemetry;         // Lịch sử heartbeat/telemetry (maxSeries 0 = tắt)
+};
+
+struct GatewayStats {
+    uint64_t ingested;                 // Sự kiện nhận qua POST /events
+    uint64_t invalid;                  // Body không phải sự kiện hợp lệ (400/413)
+    uint64_t deliveries;               // Frame sự kiện đã xếp vào hàng đợi subscriber
+    uint64_t unrouted;                 // Sự kiện không có subscriber nào
+    uint64_t accepted;                 // Subscriber nâng cấp WebSocket thành công
+    uint64_t rejected;                 // Hết chỗ, handshake sai hoặc quá hạn
+    uint64_t slowDropped;              // Subscriber bị ngắt vì hàng đợi gửi vượt clientQueueBytes
+    uint64_t timedOut;                 // Subscriber không trả lời ping
+    uint64_t writeCalls;               // Số lần writev (mỗi lần gom nhiều frame)
+    uint64_t maxQueued;                // Byte chờ gửi lớn nhất của một subscriber
+    uint64_t resumed;                  // Subscriber kết nối lại kèm since
+    uint64_t replayed;                 // Frame phát lại từ ReplayRing
+    uint64_t replayLost;               // Sự kiện client cần nhưng đã bị bỏ khỏi ring
+    uint64_t readerLookups;            // POST /api/iot/scan-student-card tra được snapshot
+    uint64_t readerMisses;             // ... không có UID trong snapshot
+    uint64_t heartbeats;               // POST /api/iot/heartbeat đã ghi vào TelemetryStore
+    uint64_t telemetryQueries;         // GET /api/iot/telemetry
+};
+
+// Gateway giữa các trạm và app Flutter: trạm (hoặc backend) POST sự kiện quét
+// lên /events, gateway đẩy tới mọi subscriber WebSocket (/ws?device_id=...) đang
+// theo dõi trạm đó. Một thread, epoll; mỗi sự kiện mã hóa thành một SharedFrame
+// duy nhất và các subscriber chỉ giữ tham chiếu. Subscriber đánh dấu khi có frame
+// mới và được ghi một lần (writev) cuối mỗi vòng epoll, nên một loạt sự kiện tới
+// cùng lúc chỉ tốn một syscall cho mỗi subscriber. Client đọc không kịp bị ngắt như
+// EventStream trên trạm, không giữ bộ nhớ hay làm chậm các client khác.
+//
+// Mỗi sự kiện được gán seq theo trạm (trường "seq" chèn vào đầu JSON) và giữ trong
+// ReplayRing. App kết nối lại với since=<trạm>:<seq>,... nhận lại phần đã lỡ theo
+// đúng thứ tự nhận rồi mới chuyển sang nhận trực tiếp, không trùng không hổng.
+//
+// Bật store: sự kiện vẫn được phát ngay, nhưng 202 chỉ gửi cho trạm sau khi ScanStore
+// đã commit dòng của nó (group commit). Trong lúc chờ, kết nối của trạm chỉ nhận thêm
+// POST /events, POST /borrows (phản hồi đi qua store theo thứ tự); request khác chờ.
+//
+// Bật readers: POST /api/iot/scan-student-card trả thông tin độc giả từ ReaderSnapshot
+// (mmap) ngay trên thread của gateway, không hỏi DB.
+//
+// Bật telemetry: mọi giá trị số trong POST /api/iot/heartbeat thành mẫu của TelemetryStore
+// (nén Gorilla, gộp 5 phút / 1 giờ), GET /api/iot/telemetry trả lịch sử cho dashboard.
+class GatewayServer {
+public:
+    explicit GatewayServer(const GatewayConfig& config = GatewayConfig());
+    ~GatewayServer();
+    
+    // Mở cổng lắng nghe + epoll, false nếu lỗi (đã in lý do)
+    bool begin();
+    
+    // Vòng sự kiện, chạy tới khi stop()
+    void run();
+    
+    // Gọi được từ thread khác (hoặc signal handler)
+    void stop();
+    
+    // Đẩy một sự kiện JSON tới các subscriber của device_id trong sự kiện.
+    // Chỉ gọi trên thread chạy run() (POST /events dùng hàm này)
+    bool publish(const char* json, size_t length);
+    
+    uint16_t getPort() const { return port; }
+    size_t getSubscriberCount() const { return subscribers; }
+    const GatewayStats& getStats() const { return stats; }
+    void printStats() const;
+    
+private:
+    enum ConnectionState : uint8_t { CONN_HTTP, CONN_SUBSCRIBER, CONN_CLOSING, CONN_CLOSED };
+    
+    struct Pending {
+        SharedFrame* frame;
+        size_t offset;                 // Byte đã gửi của frame đầu hàng đợi
+    };
+    
+    struct Connection {
+        int fd;
+        ConnectionState state;
+        bool writable;                 // Đang chờ EPOLLOUT
+        bool dirty;                    // Có trong danh sách cần ghi cuối vòng
+        bool keepAlive;
+        bool subscribed;
+        size_t slot;                   // Vị trí trong connections (xóa O(1))
+        uint64_t since;                // Lúc nhận kết nối / nhận dữ liệu gần nhất
+        uint64_t lastPing;
+        std::string rx;
+        std::deque<Pending> queue;
+        size_t queuedBytes;
+        std::vector<std::string> devices;  // Rỗng = mọi trạm
+        bool replaying;                // Đang phát lại, chưa nhận sự kiện trực tiếp
+        uint64_t cursor;               // Vị trí tiếp theo trong ReplayRing
+        std::unordered_map<const ReplayRing::Device*, uint64_t> resumeFrom; // Seq client đã có, theo trạm
+        uint32_t pendingAcks;          // POST đang chờ ScanStore commit (không giải phóng khi > 0)
+    };
+    
+    void acceptConnections();
+    void onReadable(Connection* conn);
+    void serviceHttp(Connection* conn);
+    void serviceFrames(Connection* conn);
+    void handleRequest(Connection* conn, const std::string& request, const char* body, size_t bodyLength);
+    void ingestEvent(Connection* conn, const char* body, size_t length);
+    void ingestBorrow(Connection* conn, const char* body, size_t length);
+    void serviceAcks();
+    void lookupStudent(Connection* conn, const char* body, size_t length);
+    void ingestHeartbeat(Connection* conn, const char* body, size_t length);
+    void queryTelemetry(Connection* conn, const std::string& target);
+    void upgrade(Connection* conn, const std::string& request, const std::string& target);
+    void respond(Connection* conn, int status, const char* reason, const std::string& body,
+                 const char* contentType = "text/plain; charset=utf-8");
+    bool enqueue(Connection* conn, SharedFrame* frame);
+    bool startReplay(Connection* conn, const std::vector<std::pair<std::string, std::string>>& params);
+    bool pumpReplay(Connection* conn);
+    void flush(Connection* conn);
+    void flushDirty();
+    void sweep(uint64_t now);
+    void subscribe(Connection* conn);
+    void unsubscribe(Connection* conn);
+    void drop(Connection* conn);
+    void watchWritable(Connection* conn, bool enable);
+    std::string metricsText() const;
+    
+    GatewayConfig config;
+    int listenFd;
+    int epollFd;
+    int wakeFd;                        // eventfd: stop() / ScanStore đánh thức epoll_wait
+    uint16_t port;
+    std::atomic<bool> running;
+    
+    std::vector<Connection*> connections;  // Mọi kết nối đang mở (quét ping/timeout)
+    std::unordered_map<std::string, std::vector<Connection*>> byDevice;
+    std::vector<Connection*> everyone;     // Subscriber không lọc device_id
+    std::vector<Connection*> dirtyList;
+    std::vector<Connection*> graveyard;    // Giải phóng sau khi xử lý xong lô epoll
+    SharedFrame* pingFrame;                // Một frame ping dùng chung cho mọi subscriber
+    ReplayRing ring;
+    std::string epoch;                     // Đổi mỗi lần khởi động: seq của lần chạy trước không còn nghĩa
+    ScanStore store;
+    ReaderIndex readers;
+    TelemetryStore telemetry;
+    size_t subscribers;
+    uint64_t lastSweep;
+    uint64_t lastExpire;                   // Lần cuối bỏ dữ liệu telemetry quá hạn
+    GatewayStats stats;
+};
+
+#endif // GATEWAY_SERVER_H
@@ -0,0 +1,76 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define GORILLA_MAX_COLUMNS 4          // Mẫu gốc: 1 cột; bucket gộp: min, max, sum, count
+
+// Một khối chuỗi thời gian nén kiểu Gorilla (Pelkonen et al., VLDB 2015): timestamp
+// (giây) mã hóa delta-of-delta, mỗi cột giá trị double mã hóa XOR với giá trị trước.
+// Heartbeat đều 60 s cho delta-of-delta = 0 (1 bit); giá trị không đổi tốn 1 bit,
+// giá trị đổi ít (free_heap...) chỉ ghi đoạn bit có nghĩa của XOR. Khối đã đóng
+// không đổi nữa, chỉ đọc tuần tự bằng GorillaDecoder.
+struct GorillaBlock {
+    int64_t first = 0;                 // Timestamp mẫu đầu (không nằm trong dòng bit)
+    int64_t last = 0;
+    uint32_t count = 0;
+    uint8_t columns = 1;
+    std::vector<uint64_t> words;       // Dòng bit, bit cao trước
+    
+    size_t bytes() const { return words.capacity() * sizeof(uint64_t); }
+};
+
+// Ghi vào khối đang mở. Giữ trạng thái của mẫu trước (timestamp, delta, bit giá trị,
+// cửa sổ leading/trailing zero) nên khối đã đóng không phải mang theo
+class GorillaEncoder {
+public:
+    explicit GorillaEncoder(uint8_t columns = 1);
+    
+    // timestamp phải lớn hơn mẫu trước và cách mẫu đầu khối < 2^31 giây (người gọi đóng
+    // khối trước khi vượt)
+    void append(int64_t timestamp, const double* values);
+    
+    // Chuyển khối ra (thu nhỏ buffer) và bắt đầu khối rỗng mới
+    GorillaBlock seal();
+    void reset();
+    
+    const GorillaBlock& block() const { return current; }
+    bool empty() const { return current.count == 0; }
+    
+private:
+    void writeBits(uint64_t value, int count);
+    void writeValue(int column, double value);
+    
+    GorillaBlock current;
+    uint64_t bitLength;
+    int64_t previousDelta;
+    uint64_t previousBits[GORILLA_MAX_COLUMNS];
+    uint8_t leading[GORILLA_MAX_COLUMNS];   // Cửa sổ bit có nghĩa của XOR trước, 0xFF = chưa có
+    uint8_t trailing[GORILLA_MAX_COLUMNS];
+};
+
+// Đọc tuần tự một khối (khối đã đóng hoặc khối đang mở của encoder)
+class GorillaDecoder {
+public:
+    explicit GorillaDecoder(const GorillaBlock& block);
+    
+    // false khi đã đọc hết count mẫu
+    bool next(int64_t& timestamp, double* values);
+    
+private:
+    uint64_t readBits(int count);
+    double readValue(int column);
+    
+    const GorillaBlock& block;
+    uint32_t index;
+    size_t position;                   // Bit đang đọc
+    int64_t timestamp;
+    int64_t delta;
+    uint64_t previousBits[GORILLA_MAX_COLUMNS];
+    uint8_t leading[GORILLA_MAX_COLUMNS];
+    uint8_t trailing[GORILLA_MAX_COLUMNS];
+};
+
+#endif // GORILLA_H
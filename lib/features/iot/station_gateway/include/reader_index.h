@@ -0,0 +1,140 @@
+#ifndef READER_INDEX_H
+#define READER_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Độ dài trường (kể cả '\0') bằng buffer StudentInfo của trạm (api_types.h): chuỗi dài
+// hơn thì trạm cũng cắt, nên snapshot cắt sẵn (đúng ranh giới UTF-8)
+#define READER_MSSV_LEN 16
+#define READER_NAME_LEN 64
+#define READER_CLASS_LEN 24
+#define READER_UID_MAX_BYTES 7         // RC522: UID 4 hoặc 7 byte (10 byte không hỗ trợ)
+
+// Bản ghi cố định trong file snapshot
+struct ReaderRecord {
+    uint32_t readerId;                 // readers.id
+    char mssv[READER_MSSV_LEN];
+    char name[READER_NAME_LEN];
+    char className[READER_CLASS_LEN];
+    uint32_t reserved;
+};
+
+struct ReaderEntry {
+    uint64_t key;                      // ReaderIndex::parseUid
+    ReaderRecord record;
+};
+
+struct ReaderIndexConfig {
+    std::string path;                  // File snapshot, rỗng = tắt
+    std::string conninfo;              // Dựng lại từ bảng readers; rỗng = chỉ đọc file
+    uint32_t refreshS = 300;           // Chu kỳ dựng lại từ DB / kiểm tra file đổi
+};
+
+struct ReaderIndexStats {
+    uint64_t readers;                  // Bản ghi trong snapshot hiện tại
+    uint64_t fileBytes;
+    uint64_t builtAt;                  // Unix giây lúc dựng snapshot hiện tại
+    uint64_t swaps;                    // Số lần thay snapshot
+    uint64_t rebuilds;                 // Lần dựng từ DB thành công
+    uint64_t rebuildFailures;
+    uint64_t skipped;                  // Lần dựng gần nhất: UID sai định dạng / trùng
+    uint64_t truncated;                // Lần dựng gần nhất: trường bị cắt
+    uint64_t lastRebuildUs;            // Đọc DB + ghi file + thay snapshot
+};
+
+// Snapshot bất biến UID thẻ → độc giả, đọc bằng mmap. File gồm header, bảng băm địa
+// chỉ mở (dò tuyến tính, tải ≤ 50%, 16 byte mỗi ô: key + chỉ số bản ghi) và mảng
+// ReaderRecord. Tra cứu = một lần băm + thường một cache line của bảng + một bản ghi,
+// không cấp phát, không khóa. File không bao giờ bị sửa tại chỗ: bản mới được ghi ra
+// file tạm, fsync rồi rename(), nên tiến trình khác mở file luôn thấy bản đầy đủ.
+class ReaderSnapshot {
+public:
+    ~ReaderSnapshot();
+    
+    // nullptr nếu file không có / sai định dạng (error = lý do)
+    static std::shared_ptr<const ReaderSnapshot> open(const std::string& path, std::string& error);
+    
+    const ReaderRecord* find(uint64_t key) const;
+    size_t size() const { return count; }
+    size_t bytes() const { return length; }
+    uint64_t builtAt() const { return built; }
+    
+private:
+    ReaderSnapshot() = default;
+    
+    struct Slot {
+        uint64_t key;                  // 0 = trống
+        uint32_t record;
+        uint32_t reserved;
+    };
+    
+    void* base = nullptr;
+    size_t length = 0;
+    const Slot* slots = nullptr;
+    uint64_t mask = 0;
+    const ReaderRecord* records = nullptr;
+    size_t count = 0;
+    uint64_t built = 0;
+    dev_t device = 0;
+    ino_t inode = 0;
+    
+    friend class ReaderIndex;
+};
+
+// Giữ snapshot hiện tại và thay nó khi có bản mới. current() trả shared_ptr: request
+// đang tra cứu giữ bản cũ tới khi xong, bản cũ được munmap khi không còn ai giữ.
+// Có conninfo: một thread dựng lại từ bảng readers mỗi refreshS giây (COPY ... TO
+// STDOUT, không chặn gateway); không có: thread chỉ mở lại file khi nó bị thay.
+class ReaderIndex {
+public:
+    explicit ReaderIndex(const ReaderIndexConfig& config);
+    ~ReaderIndex();
+    
+    // Mở file sẵn có (nếu có) rồi chạy thread làm mới. false nếu không có file lẫn DB
+    bool begin();
+    void stop();
+    bool enabled() const { return !config.path.empty(); }
+    
+    std::shared_ptr<const ReaderSnapshot> current() const;
+    
+    // Dựng từ DB ngay (thread làm mới gọi; bench gọi trực tiếp)
+    bool rebuild();
+    
+    ReaderIndexStats getStats() const;
+    
+    // UID dạng hex ("04A1B2C3", chấp nhận chữ thường và ':'/' '/'-' ngăn cách) → key:
+    // byte độ dài ở trên cùng, UID ở 56 bit dưới, nên "00A1" khác "A1" và key không bao giờ 0
+    static bool parseUid(const char* text, size_t length, uint64_t& key);
+    
+    // Tạo bản ghi (cắt chuỗi dài); truncated = có trường bị cắt
+    static bool makeEntry(const char* uid, size_t uidLength, uint32_t readerId, const char* mssv,
+                          const char* name, const char* className, ReaderEntry& entry, bool& truncated);
+    
+    // Ghi file snapshot (tạm → fsync → rename). UID trùng: giữ bản đầu, đếm vào skipped
+    static bool writeSnapshot(const std::string& path, const std::vector<ReaderEntry>& entries, size_t& skipped,
+                              std::string& error);
+    
+private:
+    void refreshLoop();
+    bool swapIn(const std::string& reason);
+    
+    ReaderIndexConfig config;
+    std::thread refresher;
+    bool running;
+    std::mutex waitLock;
+    std::condition_variable wake;
+    
+    mutable std::mutex lock;           // Bảo vệ snapshot + stats
+    std::shared_ptr<const ReaderSnapshot> snapshot;
+    ReaderIndexStats stats;
+};
+
+#endif // READER_INDEX_H
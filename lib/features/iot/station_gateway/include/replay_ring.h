@@ -0,0 +1,69 @@
+#ifndef REPLAY_RING_H
+#define REPLAY_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "shared_frame.h"
+
+// Các sự kiện gần nhất của mọi trạm theo thứ tự nhận, để app kết nối lại lấy phần đã
+// lỡ. Mỗi trạm có seq riêng tăng dần từ 1; mỗi sự kiện có thêm vị trí toàn cục (tăng
+// dần, không bao giờ dùng lại) để phát lại nhiều trạm đúng thứ tự đã nhận. Giữ chính
+// SharedFrame đã phát trực tiếp (không copy); tổng byte vượt capacity thì bỏ sự kiện
+// cũ nhất. Không thread-safe: chỉ GatewayServer dùng, trên thread của nó.
+class ReplayRing {
+public:
+    struct Device {
+        std::string id;
+        uint64_t lastSeq;              // 0 = chưa có sự kiện
+        std::deque<uint64_t> positions;    // Vị trí toàn cục của các seq còn giữ (liên tục, tới lastSeq)
+    
+        uint64_t firstRetained() const { return lastSeq - positions.size() + 1; }
+    };
+    
+    struct Entry {
+        Device* device;
+        uint64_t seq;
+        SharedFrame* frame;
+    };
+    
+    ReplayRing(size_t capacityBytes, size_t maxDevices);
+    ~ReplayRing();
+    
+    // Trạm theo device_id; create = thêm nếu chưa có. nullptr nếu không có / đã đủ maxDevices
+    Device* device(const std::string& id, bool create);
+    
+    // Thêm sự kiện seq = device->lastSeq + 1 (giữ một tham chiếu tới frame)
+    void append(Device* device, SharedFrame* frame);
+    
+    // Vị trí toàn cục: [begin, end) đang giữ
+    uint64_t begin() const { return base; }
+    uint64_t end() const { return base + entries.size(); }
+    const Entry& at(uint64_t position) const { return entries[position - base]; }
+    
+    // Vị trí của sự kiện đầu tiên có seq > since (end() nếu không còn gì mới).
+    // lost = số sự kiện seq > since đã bị bỏ khỏi ring
+    uint64_t positionAfter(const Device* device, uint64_t since, uint64_t& lost) const;
+    
+    const std::unordered_map<std::string, std::unique_ptr<Device>>& getDevices() const { return devices; }
+    size_t size() const { return entries.size(); }
+    size_t getBytes() const { return bytes; }
+    size_t getCapacity() const { return capacity; }
+    uint64_t getEvicted() const { return evicted; }
+    
+private:
+    void evictOldest();
+    
+    size_t capacity;
+    size_t maxDevices;
+    std::deque<Entry> entries;
+    uint64_t base;                     // Vị trí toàn cục của entries.front()
+    size_t bytes;
+    uint64_t evicted;
+    std::unordered_map<std::string, std::unique_ptr<Device>> devices;
+};
+
+#endif // REPLAY_RING_H
@@ -0,0 +1,109 @@
+#ifndef SCAN_STORE_H
+#define SCAN_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StoreConfig {
+    std::string conninfo;              // libpq ("host=... dbname=..."), rỗng = không ghi DB
+    uint32_t windowUs = 0;             // Chờ thêm tính từ dòng cũ nhất; 0 = chỉ gom dòng tới lúc lô trước commit
+    size_t maxRows = 4096;             // Dòng tối đa mỗi transaction
+    size_t maxPending = 65536;         // Dòng chờ tối đa; quá thì trả 503 cho trạm
+    uint32_t reconnectMs = 1000;       // Chờ giữa hai lần kết nối lại khi DB mất
+};
+
+struct StoreStats {
+    uint64_t rows;                     // Dòng đã commit
+    uint64_t commits;                  // Transaction thành công
+    uint64_t failedRows;               // Dòng trả 503 (DB lỗi / hàng đợi đầy)
+    uint64_t rejectedRows;             // Dòng DB từ chối (dữ liệu sai), trả 400
+    uint64_t isolations;               // Lô lỗi dữ liệu phải ghi lại từng dòng
+    uint64_t maxBatch;
+    uint64_t commitUsTotal;            // Tổng thời gian BEGIN..COMMIT
+    uint64_t commitUsMax;
+    uint64_t pending;                  // Dòng đang chờ ghi
+};
+
+// Ghi sự kiện quét/phiếu mượn vào PostgreSQL theo lô (group commit): gateway xếp dòng
+// vào hàng đợi, một thread gom mọi dòng tới trong lúc lô trước đang commit (cộng cửa sổ
+// windowUs nếu đặt) thành một transaction, ghi bằng COPY ... FROM STDIN rồi COMMIT
+// (synchronous_commit = on). Chỉ sau khi COMMIT trả về, phản hồi của từng dòng mới được
+// trả lại cho gateway qua takeAcks(), theo đúng thứ tự submit(), để gửi 202 cho trạm.
+//
+// Lô bị DB từ chối vì dữ liệu (SQLSTATE lớp 22/23) được ghi lại từng dòng: dòng sai
+// trả 400, dòng còn lại vẫn 202. Mất kết nối / DB lỗi: cả lô trả 503, trạm gửi lại.
+class ScanStore {
+public:
+    enum Table : uint8_t { TABLE_NONE, TABLE_SCANS, TABLE_BORROWS };
+    
+    // Phản hồi cho một lần submit(): owner do gateway truyền vào (kết nối của trạm)
+    struct Ack {
+        void* owner;
+        int status;
+    };
+    
+    explicit ScanStore(const StoreConfig& config);
+    ~ScanStore();
+    
+    // Kết nối DB và chạy thread ghi; notifyFd (eventfd) được ghi mỗi khi có Ack mới.
+    // false nếu không kết nối được (đã in lý do)
+    bool begin(int notifyFd);
+    void stop();
+    bool enabled() const { return !config.conninfo.empty(); }
+    
+    // Xếp một dòng (định dạng text của COPY, kết thúc '\n') vào bảng table; TABLE_NONE =
+    // không ghi gì, chỉ giữ chỗ để phản hồi status đúng thứ tự. Hàng đợi đầy thì dòng
+    // được thay bằng phản hồi 503. Gọi từ một thread (thread của gateway)
+    void submit(Table table, std::string&& row, void* owner, int status);
+    bool full() const;
+    
+    // Lấy các phản hồi đã xong (theo thứ tự submit)
+    void takeAcks(std::vector<Ack>& out);
+    
+    StoreStats getStats() const;
+    
+    // Dựng dòng COPY: trường text (escape \, tab, xuống dòng), NULL, hoặc kết thúc dòng
+    static void appendText(std::string& row, const char* text, size_t length);
+    static void appendNull(std::string& row);
+    static void endRow(std::string& row);
+    
+    // Tên bảng + cột theo đúng thứ tự trường trong dòng
+    static const char* copyCommand(Table table);
+    
+private:
+    struct Item {
+        Table table;
+        std::string row;
+        void* owner;
+        int status;
+        uint64_t queuedUs;
+    };
+    
+    void writerLoop();
+    bool connect();
+    // Ghi cả lô trong một transaction; false nếu lỗi. dataError = lỗi do dữ liệu (không phải kết nối)
+    bool writeBatch(const std::vector<Item*>& items, bool& dataError);
+    bool exec(const char* sql, bool& dataError);
+    bool copyRows(Table table, const std::vector<Item*>& items, bool& dataError);
+    
+    StoreConfig config;
+    void* connection;                  // PGconn*, chỉ thread ghi dùng
+    int notifyFd;
+    bool running;
+    std::thread writer;
+    
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::deque<Item> queue;            // Chờ ghi, theo thứ tự submit
+    size_t queuedRows;                 // Số Item có dòng thật trong queue
+    std::vector<Ack> acks;             // Đã xong, chờ gateway lấy
+    StoreStats stats;
+};
+
+#endif // SCAN_STORE_H
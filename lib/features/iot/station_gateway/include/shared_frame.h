@@ -0,0 +1,75 @@
+#ifndef SHARED_FRAME_H
+#define SHARED_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ws_protocol.h"
+
+// Một frame đã mã hóa sẵn (header WebSocket + payload trong cùng một khối nhớ),
+// dùng chung cho mọi subscriber: mỗi sự kiện chỉ mã hóa và copy một lần, hàng đợi
+// gửi của từng client chỉ giữ con trỏ + offset. Đếm tham chiếu không atomic vì
+// GatewayServer chạy trên một thread.
+class SharedFrame {
+public:
+    // Frame server → client (FIN, không mask): sự kiện JSON là WS_OPCODE_TEXT
+    static SharedFrame* encode(WsOpcode opcode, const void* payload, size_t length) {
+        return encode(opcode, nullptr, 0, payload, length);
+    }
+    
+    // Như trên, payload = prefix + phần còn lại (chèn trường vào đầu object JSON)
+    static SharedFrame* encode(WsOpcode opcode, const void* prefix, size_t prefixLength,
+                               const void* payload, size_t length) {
+        uint8_t header[WS_MAX_FRAME_HEADER];
+        size_t headerLength = WsProtocol::frameHeader(opcode, prefixLength + length, header);
+        SharedFrame* frame = allocate(headerLength + prefixLength + length);
+        if (frame != nullptr) {
+            uint8_t* out = frame->data();
+            memcpy(out, header, headerLength);
+            if (prefixLength > 0) {
+                memcpy(out + headerLength, prefix, prefixLength);
+            }
+            if (length > 0) {
+                memcpy(out + headerLength + prefixLength, payload, length);
+            }
+        }
+        return frame;
+    }
+    
+    // Byte gửi nguyên văn (response HTTP, frame điều khiển)
+    static SharedFrame* raw(const void* bytes, size_t length) {
+        SharedFrame* frame = allocate(length);
+        if (frame != nullptr) {
+            memcpy(frame->data(), bytes, length);
+        }
+        return frame;
+    }
+    
+    void retain() { refs++; }
+    
+    void release() {
+        if (--refs == 0) {
+            free(this);
+        }
+    }
+    
+    uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+    size_t size() const { return length; }
+    uint32_t getRefs() const { return refs; }
+    
+private:
+    static SharedFrame* allocate(size_t length) {
+        SharedFrame* frame = static_cast<SharedFrame*>(malloc(sizeof(SharedFrame) + length));
+        if (frame != nullptr) {
+            frame->refs = 1;
+            frame->length = length;
+        }
+        return frame;
+    }
+    
+    uint32_t refs;
+    size_t length;
+};
+
+#endif // SHARED_FRAME_H
@@ -0,0 +1,136 @@
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "gorilla.h"
+
+#define TELEMETRY_ROLLUP_STEP_S 300    // Tầng 1: bucket 5 phút
+#define TELEMETRY_COARSE_STEP_S 3600   // Tầng 2: bucket 1 giờ (bội của tầng 1)
+#define TELEMETRY_TIERS 3              // Mẫu gốc + 2 tầng gộp
+#define TELEMETRY_ROLLUP_BLOCK_POINTS 120  // Khối của tầng gộp đóng sau chừng này bucket
+#define TELEMETRY_METRIC_MAX 64        // Độ dài tên metric tối đa
+
+struct TelemetryConfig {
+    size_t maxSeries = 65536;          // Tổng số (trạm, metric), 0 = tắt
+    uint32_t rawRetentionS = 24 * 3600;        // Giữ mẫu gốc
+    uint32_t rollupRetentionS = 7 * 86400;     // Giữ bucket 5 phút
+    uint32_t coarseRetentionS = 90 * 86400;    // Giữ bucket 1 giờ
+    uint32_t blockSpanS = 2 * 3600;    // Khối mẫu gốc đóng khi dài hơn
+};
+
+struct TelemetryStats {
+    uint64_t devices;
+    uint64_t series;
+    uint64_t rawSamples;               // Mẫu gốc đang giữ
+    uint64_t rollupPoints;             // Bucket đang giữ ở hai tầng gộp
+    uint64_t rawBytes;                 // Dòng bit của mẫu gốc
+    uint64_t payloadBytes;             // Dòng bit Gorilla mọi tầng (đã cấp phát)
+    uint64_t memoryBytes;              // Ước lượng tổng: dòng bit + khối + series + map
+    uint64_t appended;                 // Mẫu nhận
+    uint64_t outOfOrder;               // Mẫu không mới hơn mẫu trước của series (bỏ)
+    uint64_t dropped;                  // Hết maxSeries (bỏ)
+    uint64_t expiredBlocks;
+};
+
+struct TelemetryPoint {
+    int64_t time;
+    double value;
+};
+
+struct TelemetryBucket {
+    int64_t start;                     // Bội của step
+    double min;
+    double max;
+    double sum;
+    uint64_t count;
+};
+
+// Lịch sử heartbeat/telemetry của các trạm trong RAM. Mỗi (trạm, metric) là một series
+// số theo thời gian (giây) với ba tầng: mẫu gốc (giữ rawRetentionS), bucket 5 phút và
+// bucket 1 giờ (min/max/sum/count). Mỗi tầng là dãy GorillaBlock đã đóng + một khối
+// đang ghi, bỏ nguyên khối khi quá hạn. Mẫu mới được gộp ngay vào bucket đang mở của
+// cả hai tầng, nên tầng thô hơn luôn chứa đủ mọi mẫu của bucket nó giữ.
+//
+// Truy vấn gom theo step đọc tầng thô nhất có bucket chia hết step (step 1 giờ trên 24 h
+// chỉ giải mã 24 điểm thay vì 1440 mẫu), phần tầng đó đã bỏ thì lấy từ tầng thô hơn.
+// Ranh giới giữa các tầng canh theo bucket của tầng thô hơn, nên mỗi mẫu được tính đúng
+// một lần và kết quả khớp với gom từ mẫu gốc khi step là bội của bucket tầng được dùng.
+// Không thread-safe: chỉ GatewayServer dùng, trên thread của nó.
+class TelemetryStore {
+public:
+    struct DeviceInfo {
+        std::string id;
+        int64_t lastSeen;
+        std::vector<std::string> metrics;
+    };
+    
+    explicit TelemetryStore(const TelemetryConfig& config);
+    
+    bool enabled() const { return config.maxSeries > 0; }
+    
+    // false nếu timestamp không lớn hơn mẫu trước của series, hoặc đã đủ maxSeries
+    bool append(const std::string& device, const std::string& metric, int64_t timestamp, double value);
+    
+    // Bỏ khối/bucket quá hạn so với now (giây Unix) và series không còn gì
+    void expire(int64_t now);
+    
+    // Mẫu gốc trong [from, to] (tối đa limit mẫu, truncated = còn nữa). false nếu không có series
+    bool raw(const std::string& device, const std::string& metric, int64_t from, int64_t to, size_t limit,
+             std::vector<TelemetryPoint>& out, bool& truncated) const;
+    
+    // Gom [from, to] theo step giây, chỉ trả bucket có mẫu. false nếu không có series
+    bool range(const std::string& device, const std::string& metric, int64_t from, int64_t to, int64_t step,
+               std::vector<TelemetryBucket>& out) const;
+    
+    // Trạm theo id tăng dần
+    void listDevices(std::vector<DeviceInfo>& out) const;
+    std::vector<std::string> deviceIds() const;
+    
+    TelemetryStats getStats() const;
+    
+private:
+    struct Bucket {
+        int64_t start;
+        double min;
+        double max;
+        double sum;
+        double count;                  // 0 = chưa mở
+    };
+    
+    // vector thay vì deque: deque rỗng của libstdc++ đã cấp ~600 byte, nhân với mọi series
+    struct Tier {
+        std::vector<GorillaBlock> sealed;  // Cũ → mới, bỏ từ đầu khi hết hạn (vài chục khối)
+        GorillaEncoder open;
+    };
+    
+    struct Series {
+        int64_t last;                  // Mẫu gốc mới nhất (kể cả đã hết hạn)
+        Tier tiers[TELEMETRY_TIERS];   // [0] mẫu gốc, [1] 5 phút, [2] 1 giờ
+        Bucket pending[TELEMETRY_TIERS - 1];   // Bucket đang gom của tầng 1, 2
+    
+        Series();
+    };
+    
+    struct Device {
+        int64_t lastSeen;
+        std::map<std::string, Series> series;
+    };
+    
+    const Series* find(const std::string& device, const std::string& metric) const;
+    static void appendTier(Tier& tier, int64_t timestamp, const double* values, int64_t span);
+    static void addRollup(Series& series, int level, int64_t timestamp, double value);
+    static int64_t oldest(const Tier& tier, const Bucket* pending);
+    static size_t expireTier(Tier& tier, int64_t cutoff, int64_t step);
+    
+    TelemetryConfig config;
+    std::unordered_map<std::string, Device> devices;
+    size_t seriesCount;
+    TelemetryStats stats;
+};
+
+#endif // TELEMETRY_STORE_H
@@ -0,0 +1,307 @@
+#include "event_json.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace EventJson {
+
+static size_t skipSpace(const char* json, size_t length, size_t pos) {
+    while (pos < length && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) {
+        pos++;
+    }
+    return pos;
+}
+
+// pos ở dấu '"' mở, trả về vị trí sau dấu '"' đóng (0 nếu chuỗi không kết thúc)
+static size_t skipString(const char* json, size_t length, size_t pos) {
+    pos++;
+    while (pos < length) {
+        if (json[pos] == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (json[pos] == '"') {
+            return pos + 1;
+        }
+        pos++;
+    }
+    return 0;
+}
+
+// Bỏ qua một giá trị bất kỳ (chuỗi, object/array lồng nhau, số, true/false/null)
+static size_t skipValue(const char* json, size_t length, size_t pos) {
+    if (pos >= length) {
+        return 0;
+    }
+    if (json[pos] == '"') {
+        return skipString(json, length, pos);
+    }
+    if (json[pos] == '{' || json[pos] == '[') {
+        int depth = 0;
+        while (pos < length) {
+            char c = json[pos];
+            if (c == '"') {
+                pos = skipString(json, length, pos);
+                if (pos == 0) {
+                    return 0;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return pos + 1;
+                }
+            }
+            pos++;
+        }
+        return 0;
+    }
+    size_t start = pos;
+    while (pos < length && json[pos] != ',' && json[pos] != '}' && json[pos] != ' ' &&
+           json[pos] != '\t' && json[pos] != '\n' && json[pos] != '\r') {
+        pos++;
+    }
+    return pos > start ? pos : 0;
+}
+
+bool findFields(const char* json, size_t length, Field* fields, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        fields[i].value = nullptr;
+        fields[i].length = 0;
+    }
+    size_t pos = skipSpace(json, length, 0);
+    if (pos >= length || json[pos] != '{') {
+        return false;
+    }
+    pos++;
+    
+    bool afterComma = false;
+    while (true) {
+        pos = skipSpace(json, length, pos);
+        if (pos < length && json[pos] == '}' && !afterComma) {
+            break;
+        }
+        if (pos >= length || json[pos] != '"') {
+            return false;
+        }
+        size_t keyStart = pos + 1;
+        pos = skipString(json, length, pos);
+        if (pos == 0) {
+            return false;
+        }
+        size_t keyLength = pos - 1 - keyStart;
+        pos = skipSpace(json, length, pos);
+        if (pos >= length || json[pos] != ':') {
+            return false;
+        }
+        pos = skipSpace(json, length, pos + 1);
+    
+        size_t valueStart = pos;
+        pos = skipValue(json, length, pos);
+        if (pos == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (strlen(fields[i].name) == keyLength && memcmp(json + keyStart, fields[i].name, keyLength) == 0) {
+                fields[i].value = json + valueStart;
+                fields[i].length = pos - valueStart;
+            }
+        }
+    
+        pos = skipSpace(json, length, pos);
+        afterComma = pos < length && json[pos] == ',';
+        if (afterComma) {
+            pos++;
+        } else if (pos >= length || json[pos] != '}') {
+            return false;
+        }
+    }
+    
+    // Sau '}' đóng chỉ còn khoảng trắng
+    return skipSpace(json, length, pos + 1) == length;
+}
+
+bool extractDeviceId(const char* json, size_t length, char deviceId[EVENT_DEVICE_ID_MAX]) {
+    Field field = {"device_id", nullptr, 0};
+    if (!findFields(json, length, &field, 1) || field.value == nullptr) {
+        return false;
+    }
+    // Chuỗi không escape, không rỗng, vừa buffer
+    size_t valueLength = field.length - 2;
+    if (field.value[0] != '"' || field.length < 2 || valueLength == 0 || valueLength >= EVENT_DEVICE_ID_MAX ||
+        memchr(field.value + 1, '\\', valueLength) != nullptr) {
+        return false;
+    }
+    memcpy(deviceId, field.value + 1, valueLength);
+    deviceId[valueLength] = '\0';
+    return true;
+}
+
+// pos ở '{'. Trả về vị trí sau '}' đóng, 0 nếu sai cú pháp
+static size_t collectObject(const char* json, size_t length, size_t pos, const std::string& prefix, int depth,
+                            std::vector<Number>& out) {
+    pos++;
+    bool afterComma = false;
+    while (true) {
+        pos = skipSpace(json, length, pos);
+        if (pos < length && json[pos] == '}' && !afterComma) {
+            return pos + 1;
+        }
+        if (pos >= length || json[pos] != '"') {
+            return 0;
+        }
+        size_t keyStart = pos + 1;
+        pos = skipString(json, length, pos);
+        if (pos == 0) {
+            return 0;
+        }
+        size_t keyLength = pos - 1 - keyStart;
+        bool plainKey = memchr(json + keyStart, '\\', keyLength) == nullptr;
+        pos = skipSpace(json, length, pos);
+        if (pos >= length || json[pos] != ':') {
+            return 0;
+        }
+        pos = skipSpace(json, length, pos + 1);
+        if (pos >= length) {
+            return 0;
+        }
+    
+        char c = json[pos];
+        if (c == '{' && depth > 1 && plainKey) {
+            std::string nested = prefix + std::string(json + keyStart, keyLength) + ".";
+            pos = collectObject(json, length, pos, nested, depth - 1, out);
+        } else {
+            size_t valueStart = pos;
+            pos = skipValue(json, length, pos);
+            size_t valueLength = pos - valueStart;
+            if (pos != 0 && plainKey && (c == '-' || (c >= '0' && c <= '9')) && valueLength < 64) {
+                char number[64];
+                memcpy(number, json + valueStart, valueLength);
+                number[valueLength] = '\0';
+                char* end;
+                double value = strtod(number, &end);
+                if (*end == '\0' && isfinite(value)) {
+                    out.push_back({prefix + std::string(json + keyStart, keyLength), value});
+                }
+            }
+        }
+        if (pos == 0) {
+            return 0;
+        }
+    
+        pos = skipSpace(json, length, pos);
+        afterComma = pos < length && json[pos] == ',';
+        if (afterComma) {
+            pos++;
+        } else if (pos >= length || json[pos] != '}') {
+            return 0;
+        }
+    }
+}
+
+bool collectNumbers(const char* json, size_t length, std::vector<Number>& out, int maxDepth) {
+    out.clear();
+    size_t pos = skipSpace(json, length, 0);
+    if (pos >= length || json[pos] != '{') {
+        return false;
+    }
+    pos = collectObject(json, length, pos, std::string(), maxDepth, out);
+    return pos != 0 && skipSpace(json, length, pos) == length;
+}
+
+static void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | (code >> 6));
+        out += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += (char)(0xE0 | (code >> 12));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code >> 18));
+        out += (char)(0x80 | ((code >> 12) & 0x3F));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+static bool readHex4(const char* text, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = text[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    return true;
+}
+
+bool decodeString(const char* token, size_t length, std::string& out) {
+    out.clear();
+    if (length < 2 || token[0] != '"' || token[length - 1] != '"') {
+        return false;
+    }
+    size_t end = length - 1;
+    for (size_t pos = 1; pos < end; pos++) {
+        char c = token[pos];
+        if ((unsigned char)c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (++pos >= end) {
+            return false;
+        }
+        switch (token[pos]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code;
+                if (pos + 4 >= end || !readHex4(token + pos + 1, code)) {
+                    return false;
+                }
+                pos += 4;
+                // Cặp surrogate UTF-16 (emoji...)
+                if (code >= 0xD800 && code < 0xDC00) {
+                    uint32_t low;
+                    if (pos + 6 >= end || token[pos + 1] != '\\' || token[pos + 2] != 'u' ||
+                        !readHex4(token + pos + 3, low) || low < 0xDC00 || low >= 0xE000) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else if (code >= 0xDC00 && code < 0xE000) {
+                    return false;
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace EventJson
@@ -0,0 +1,1573 @@
+#include "gateway_server.h"
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+#define GATEWAY_MAX_EVENTS 256         // Sự kiện epoll xử lý mỗi vòng
+#define GATEWAY_MAX_IOV 64             // Frame gom trong một lần sendmsg
+#define GATEWAY_READ_CHUNK 16384
+#define GATEWAY_MAX_HEADER 8192        // Header request HTTP lớn nhất
+#define GATEWAY_WS_RX_MAX 1024         // Subscriber chỉ gửi ping/pong/close
+#define GATEWAY_SWEEP_MS 1000          // Nhịp quét ping/timeout
+#define GATEWAY_TELEMETRY_EXPIRE_MS 60000  // Nhịp bỏ dữ liệu telemetry quá hạn
+#define GATEWAY_CLOCK_SKEW_S 300       // Giờ trạm lệch hơn thì dùng giờ nhận heartbeat
+#define GATEWAY_HEARTBEAT_METRICS 64   // Giá trị số tối đa lấy từ một heartbeat
+#define GATEWAY_TELEMETRY_POINTS 10000 // Điểm tối đa mỗi series trong một truy vấn
+
+// data.ptr của epoll: kết nối, hoặc một trong hai thẻ này
+static char LISTEN_TAG;
+static char WAKE_TAG;
+
+static const char JSON_TYPE[] = "application/json; charset=utf-8";
+
+static uint64_t nowMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Giờ thực (giây Unix) cho mẫu telemetry
+static int64_t unixSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec;
+}
+
+// ============================================
+// HTTP
+// ============================================
+
+// Giá trị header (không phân biệt hoa thường), "" nếu không có
+static std::string headerValue(const std::string& request, const char* name) {
+    size_t nameLength = strlen(name);
+    size_t line = request.find("\r\n");
+    while (line != std::string::npos && line + 2 < request.size()) {
+        line += 2;
+        size_t end = request.find("\r\n", line);
+        if (end == std::string::npos || end == line) {
+            break;
+        }
+        if (end - line > nameLength && request[line + nameLength] == ':' &&
+            strncasecmp(request.c_str() + line, name, nameLength) == 0) {
+            size_t value = line + nameLength + 1;
+            while (value < end && request[value] == ' ') {
+                value++;
+            }
+            size_t valueEnd = end;
+            while (valueEnd > value && request[valueEnd - 1] == ' ') {
+                valueEnd--;
+            }
+            return request.substr(value, valueEnd - value);
+        }
+        line = end;
+    }
+    return std::string();
+}
+
+// POST /events, POST /borrows: phản hồi đi qua ScanStore khi bật store
+static bool isIngestRequest(const std::string& request) {
+    return request.compare(0, 13, "POST /events ") == 0 || request.compare(0, 13, "POST /events?") == 0 ||
+           request.compare(0, 14, "POST /borrows ") == 0 || request.compare(0, 14, "POST /borrows?") == 0;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static std::string percentDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+            out += (char)(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+            i += 2;
+        } else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+// Tham số query (đã giải mã) theo thứ tự xuất hiện
+static std::vector<std::pair<std::string, std::string>> parseQuery(const std::string& target) {
+    std::vector<std::pair<std::string, std::string>> params;
+    size_t query = target.find('?');
+    if (query == std::string::npos) {
+        return params;
+    }
+    size_t start = query + 1;
+    while (start <= target.size()) {
+        size_t end = target.find('&', start);
+        if (end == std::string::npos) {
+            end = target.size();
+        }
+        size_t equals = target.find('=', start);
+        if (equals == std::string::npos || equals > end) {
+            equals = end;
+        }
+        if (equals > start) {
+            params.emplace_back(percentDecode(target.substr(start, equals - start)),
+                                percentDecode(equals < end ? target.substr(equals + 1, end - equals - 1) : ""));
+        }
+        start = end + 1;
+    }
+    return params;
+}
+
+// Danh sách phân cách bằng dấu phẩy, bỏ phần tử rỗng
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    size_t from = 0;
+    while (from <= value.size()) {
+        size_t comma = value.find(',', from);
+        if (comma == std::string::npos) {
+            comma = value.size();
+        }
+        if (comma > from) {
+            items.push_back(value.substr(from, comma - from));
+        }
+        from = comma + 1;
+    }
+    return items;
+}
+
+// device_id nhận được từ query: cùng giới hạn với sự kiện, và ghi thẳng vào JSON hello được
+static bool validDeviceId(const std::string& id) {
+    if (id.empty() || id.size() >= EVENT_DEVICE_ID_MAX) {
+        return false;
+    }
+    for (char c : id) {
+        if (c == '"' || c == '\\' || (unsigned char)c < 0x20) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Trạm cần theo dõi trong query: device_id=A,B hoặc lặp device_id=A&device_id=B.
+// Rỗng = mọi trạm
+static std::vector<std::string> parseDevices(const std::vector<std::pair<std::string, std::string>>& params) {
+    std::vector<std::string> devices;
+    for (const auto& param : params) {
+        if (param.first != "device_id") {
+            continue;
+        }
+        for (const std::string& id : splitList(param.second)) {
+            if (validDeviceId(id)) {
+                devices.push_back(id);
+            }
+        }
+    }
+    // Trùng device_id thì mỗi sự kiện sẽ gửi hai lần
+    std::sort(devices.begin(), devices.end());
+    devices.erase(std::unique(devices.begin(), devices.end()), devices.end());
+    return devices;
+}
+
+// ============================================
+// Vòng sự kiện
+// ============================================
+
+GatewayServer::GatewayServer(const GatewayConfig& config)
+    : config(config), listenFd(-1), epollFd(-1), wakeFd(-1), port(config.port), running(false),
+      pingFrame(nullptr), ring(config.replayBytes, config.maxDevices), store(config.store), readers(config.readers),
+      telemetry(config.telemetry), subscribers(0), lastSweep(0), lastExpire(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+GatewayServer::~GatewayServer() {
+    // Ghi nốt phần đang chờ; phản hồi không còn ai nhận
+    store.stop();
+    for (size_t i = connections.size(); i-- > 0;) {
+        drop(connections[i]);
+    }
+    for (Connection* conn : graveyard) {
+        delete conn;
+    }
+    if (pingFrame != nullptr) {
+        pingFrame->release();
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+}
+
+bool GatewayServer::begin() {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        perror("[Gateway] socket");
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config.port);
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        perror("[Gateway] bind/listen");
+        return false;
+    }
+    socklen_t addrLength = sizeof(addr);
+    getsockname(listenFd, (sockaddr*)&addr, &addrLength);
+    port = ntohs(addr.sin_port);
+    
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        perror("[Gateway] epoll/eventfd");
+        return false;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &LISTEN_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.ptr = &WAKE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    
+    pingFrame = SharedFrame::encode(WS_OPCODE_PING, nullptr, 0);
+    char epochText[17];
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    snprintf(epochText, sizeof(epochText), "%016llx",
+             (unsigned long long)(((uint64_t)ts.tv_sec << 20) ^ ts.tv_nsec ^ ((uint64_t)getpid() << 44)));
+    epoch = epochText;
+    if (store.enabled() && !store.begin(wakeFd)) {
+        return false;
+    }
+    if (readers.enabled() && !readers.begin()) {
+        return false;
+    }
+    lastSweep = nowMs();
+    lastExpire = lastSweep;
+    running = true;
+    printf("[Gateway] Listening on port %u (POST /events, WebSocket /ws?device_id=...)\n", port);
+    return pingFrame != nullptr;
+}
+
+void GatewayServer::stop() {
+    running = false;
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0) {
+        // eventfd đã có giá trị chờ đọc: epoll_wait vẫn được đánh thức
+    }
+}
+
+void GatewayServer::run() {
+    epoll_event events[GATEWAY_MAX_EVENTS];
+    while (running) {
+        int n = epoll_wait(epollFd, events, GATEWAY_MAX_EVENTS, GATEWAY_SWEEP_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("[Gateway] epoll_wait");
+            break;
+        }
+    
+        for (int i = 0; i < n; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == &LISTEN_TAG) {
+                acceptConnections();
+                continue;
+            }
+            if (tag == &WAKE_TAG) {
+                uint64_t value;
+                if (read(wakeFd, &value, sizeof(value)) < 0) {
+                    // Đã đọc ở lần đánh thức trước
+                }
+                serviceAcks();
+                continue;
+            }
+            Connection* conn = static_cast<Connection*>(tag);
+            if (conn->state == CONN_CLOSED) {
+                continue;               // Đã bị ngắt trong lô này (subscriber chậm)
+            }
+            if (events[i].events & EPOLLIN) {
+                onReadable(conn);
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                drop(conn);
+                continue;
+            }
+            if (conn->state != CONN_CLOSED && (events[i].events & EPOLLOUT)) {
+                flush(conn);
+            }
+        }
+    
+        // Ghi một lần cho mỗi subscriber có frame mới trong lô này
+        flushDirty();
+    
+        uint64_t now = nowMs();
+        if (now - lastSweep >= GATEWAY_SWEEP_MS) {
+            lastSweep = now;
+            sweep(now);
+            flushDirty();
+        }
+        // Kết nối còn POST chờ store commit được giữ tới khi nhận đủ phản hồi
+        size_t kept = 0;
+        for (Connection* conn : graveyard) {
+            if (conn->pendingAcks > 0) {
+                graveyard[kept++] = conn;
+            } else {
+                delete conn;
+            }
+        }
+        graveyard.resize(kept);
+    }
+}
+
+void GatewayServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                perror("[Gateway] accept");
+            }
+            return;
+        }
+        if (connections.size() >= config.maxConnections) {
+            stats.rejected++;
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // Giới hạn thêm phần kernel giữ hộ subscriber chậm (mặc định tự tăng tới tcp_wmem)
+        if (config.socketSendBytes > 0) {
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &config.socketSendBytes, sizeof(config.socketSendBytes));
+        }
+    
+        Connection* conn = new Connection();
+        conn->fd = fd;
+        conn->state = CONN_HTTP;
+        conn->writable = false;
+        conn->dirty = false;
+        conn->keepAlive = true;
+        conn->subscribed = false;
+        conn->slot = connections.size();
+        conn->since = nowMs();
+        conn->lastPing = conn->since;
+        conn->queuedBytes = 0;
+        conn->replaying = false;
+        conn->cursor = 0;
+        conn->pendingAcks = 0;
+        connections.push_back(conn);
+    
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+void GatewayServer::onReadable(Connection* conn) {
+    char buffer[GATEWAY_READ_CHUNK];
+    bool peerClosed = false;
+    while (true) {
+        ssize_t n = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            if (conn->state != CONN_CLOSING) {
+                conn->rx.append(buffer, n);
+            }
+            if ((size_t)n < sizeof(buffer)) {
+                break;
+            }
+            continue;
+        }
+        if (n == 0) {
+            peerClosed = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            drop(conn);
+            return;
+        }
+        break;
+    }
+    conn->since = nowMs();
+    
+    if (conn->state == CONN_HTTP) {
+        serviceHttp(conn);
+    }
+    if (conn->state == CONN_SUBSCRIBER) {
+        serviceFrames(conn);
+        if (conn->state == CONN_SUBSCRIBER && conn->rx.size() > GATEWAY_WS_RX_MAX) {
+            drop(conn);                 // Frame lớn hơn buffer nhận: subscriber không có lý do gửi
+            return;
+        }
+    }
+    if (peerClosed && conn->state != CONN_CLOSED) {
+        // Vẫn gửi nốt response của các request đã nhận đủ
+        if (conn->queue.empty() && conn->pendingAcks == 0) {
+            drop(conn);
+        } else {
+            conn->state = CONN_CLOSING;
+        }
+    }
+}
+
+void GatewayServer::serviceHttp(Connection* conn) {
+    size_t consumed = 0;
+    while (conn->state == CONN_HTTP) {
+        size_t headerEnd = conn->rx.find("\r\n\r\n", consumed);
+        if (headerEnd == std::string::npos) {
+            if (conn->rx.size() - consumed > GATEWAY_MAX_HEADER) {
+                conn->keepAlive = false;
+                respond(conn, 431, "Request Header Fields Too Large", "");
+            }
+            break;
+        }
+        std::string request = conn->rx.substr(consumed, headerEnd + 4 - consumed);
+        std::string contentLength = headerValue(request, "Content-Length");
+        size_t bodyLength = contentLength.empty() ? 0 : strtoul(contentLength.c_str(), nullptr, 10);
+        if (conn->pendingAcks > 0 && (!isIngestRequest(request) || bodyLength > config.maxEventBytes)) {
+            break;                      // Phản hồi ngay sẽ vượt lên trước các POST đang chờ commit
+        }
+        if (bodyLength > config.maxEventBytes) {
+            stats.invalid++;
+            conn->keepAlive = false;
+            respond(conn, 413, "Payload Too Large", "");
+            break;
+        }
+        if (conn->rx.size() - (headerEnd + 4) < bodyLength) {
+            break;                      // Body chưa nhận đủ
+        }
+    
+        std::string connection = headerValue(request, "Connection");
+        std::string requestLine = request.substr(0, request.find("\r\n"));
+        bool http10 = requestLine.size() > 8 && requestLine.compare(requestLine.size() - 8, 8, "HTTP/1.0") == 0;
+        conn->keepAlive = !(strcasecmp(connection.c_str(), "close") == 0 ||
+                            (http10 && strcasecmp(connection.c_str(), "keep-alive") != 0));
+        handleRequest(conn, request, conn->rx.data() + headerEnd + 4, bodyLength);
+        consumed = headerEnd + 4 + bodyLength;
+    }
+    if (conn->state == CONN_CLOSED) {
+        return;
+    }
+    conn->rx.erase(0, consumed);
+    if (conn->state != CONN_HTTP && conn->state != CONN_SUBSCRIBER) {
+        conn->rx.clear();
+    }
+}
+
+void GatewayServer::handleRequest(Connection* conn, const std::string& request, const char* body,
+                                  size_t bodyLength) {
+    size_t methodEnd = request.find(' ');
+    size_t targetEnd = methodEnd == std::string::npos ? std::string::npos : request.find(' ', methodEnd + 1);
+    if (targetEnd == std::string::npos) {
+        conn->keepAlive = false;
+        respond(conn, 400, "Bad Request", "");
+        return;
+    }
+    std::string method = request.substr(0, methodEnd);
+    std::string target = request.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    std::string path = target.substr(0, target.find('?'));
+    
+    if (method == "POST" && path == "/events") {
+        ingestEvent(conn, body, bodyLength);
+    } else if (method == "POST" && path == "/borrows" && store.enabled()) {
+        ingestBorrow(conn, body, bodyLength);
+    } else if (method == "POST" && path == "/api/iot/scan-student-card" && readers.enabled()) {
+        lookupStudent(conn, body, bodyLength);
+    } else if (method == "POST" && path == "/api/iot/heartbeat" && telemetry.enabled()) {
+        ingestHeartbeat(conn, body, bodyLength);
+    } else if (method == "GET" && path == "/api/iot/telemetry" && telemetry.enabled() &&
+               headerValue(request, "Upgrade").empty()) {
+        queryTelemetry(conn, target);
+    } else if (method == "GET" && !headerValue(request, "Upgrade").empty()) {
+        // Nâng cấp ở mọi đường dẫn (/ws, hoặc /events như EventStream của trạm)
+        upgrade(conn, request, target);
+    } else if (method == "GET" && path == "/metrics") {
+        respond(conn, 200, "OK", metricsText());
+    } else if (method == "GET" || method == "POST") {
+        respond(conn, 404, "Not Found", "");
+    } else {
+        respond(conn, 405, "Method Not Allowed", "");
+    }
+}
+
+void GatewayServer::upgrade(Connection* conn, const std::string& request, const std::string& target) {
+    char acceptKey[WS_ACCEPT_KEY_LEN];
+    char response[160];
+    size_t length = 0;
+    if (WsProtocol::parseUpgrade(request.c_str(), acceptKey)) {
+        length = WsProtocol::buildHandshakeResponse(acceptKey, response, sizeof(response));
+    }
+    if (length == 0) {
+        stats.rejected++;
+        conn->keepAlive = false;
+        respond(conn, 400, "Bad Request", "");
+        return;
+    }
+    
+    SharedFrame* frame = SharedFrame::raw(response, length);
+    if (frame == nullptr || !enqueue(conn, frame)) {
+        if (frame != nullptr) {
+            frame->release();
+        }
+        drop(conn);
+        return;
+    }
+    frame->release();
+    std::vector<std::pair<std::string, std::string>> params = parseQuery(target);
+    conn->devices = parseDevices(params);
+    conn->state = CONN_SUBSCRIBER;
+    conn->lastPing = conn->since;
+    stats.accepted++;
+    if (!startReplay(conn, params)) {
+        return;
+    }
+    if (conn->replaying) {
+        pumpReplay(conn);               // Tự subscribe khi đã phát lại hết
+    } else {
+        subscribe(conn);
+    }
+}
+
+// hello=1: gửi {"type":"hello","epoch":...,"seq":{<trạm>:<seq hiện tại>}} để app biết mốc.
+// since=<trạm>:<seq>,...: app kết nối lại, phát lại mọi sự kiện seq lớn hơn còn trong ring
+// (trạm không có trong since = phát lại tất cả, vì trạm đó xuất hiện sau khi client mất
+// kết nối). epoch khác = gateway đã khởi động lại, seq cũ vô nghĩa.
+// false nếu kết nối đã bị ngắt
+bool GatewayServer::startReplay(Connection* conn, const std::vector<std::pair<std::string, std::string>>& params) {
+    conn->replaying = false;
+    bool hello = false;
+    bool resume = false;
+    std::string clientEpoch;
+    std::unordered_map<std::string, uint64_t> sinceById;
+    for (const auto& param : params) {
+        if (param.first == "hello") {
+            hello = true;
+        } else if (param.first == "epoch") {
+            clientEpoch = param.second;
+        } else if (param.first == "since") {
+            resume = true;
+            for (const std::string& item : splitList(param.second)) {
+                size_t colon = item.rfind(':');
+                if (colon != std::string::npos && colon > 0) {
+                    sinceById[item.substr(0, colon)] = strtoull(item.c_str() + colon + 1, nullptr, 10);
+                }
+            }
+        }
+    }
+    if (!hello && !resume) {
+        return true;
+    }
+    if (clientEpoch != epoch) {
+        sinceById.clear();
+    }
+    
+    // Trạm liên quan: danh sách đã lọc, hoặc mọi trạm gateway đã biết
+    std::vector<ReplayRing::Device*> relevant;
+    if (conn->devices.empty()) {
+        for (const auto& item : ring.getDevices()) {
+            relevant.push_back(item.second.get());
+        }
+    } else {
+        for (const std::string& id : conn->devices) {
+            // Trạm chưa từng gửi: mọi sự kiện của nó tới sau lúc này đều là mới (xem pumpReplay)
+            ReplayRing::Device* device = ring.device(id, false);
+            if (device != nullptr) {
+                relevant.push_back(device);
+            }
+        }
+    }
+    
+    std::string message = "{\"type\":\"hello\",\"epoch\":\"" + epoch + "\",\"seq\":{";
+    std::string lostText;
+    uint64_t cursor = ring.end();
+    for (size_t i = 0; i < relevant.size(); i++) {
+        ReplayRing::Device* device = relevant[i];
+        message += (i > 0 ? ",\"" : "\"") + device->id + "\":" + std::to_string(device->lastSeq);
+        if (!resume) {
+            continue;
+        }
+        auto known = sinceById.find(device->id);
+        uint64_t since = known != sinceById.end() ? known->second : 0;
+        uint64_t lost;
+        cursor = std::min(cursor, ring.positionAfter(device, since, lost));
+        conn->resumeFrom[device] = since;
+        if (lost > 0) {
+            stats.replayLost += lost;
+            lostText += (lostText.empty() ? "\"" : ",\"") + device->id + "\":" + std::to_string(lost);
+        }
+    }
+    message += "}";
+    if (!lostText.empty()) {
+        message += ",\"lost\":{" + lostText + "}";
+    }
+    message += "}";
+    
+    SharedFrame* frame = SharedFrame::encode(WS_OPCODE_TEXT, message.data(), message.size());
+    if (frame == nullptr) {
+        drop(conn);
+        return false;
+    }
+    bool queued = enqueue(conn, frame);
+    frame->release();
+    if (!queued) {
+        return false;
+    }
+    if (resume) {
+        conn->replaying = true;
+        conn->cursor = cursor;
+        stats.resumed++;
+    }
+    return true;
+}
+
+// Xếp tiếp sự kiện cần phát lại tới nửa hàng đợi; phát hết thì chuyển sang nhận trực tiếp.
+// publish() thêm vào ring trước khi phát, nên sự kiện tới trong lúc phát lại cũng được
+// lấy từ ring, và lúc subscribe() không có sự kiện nào bị lỡ hay gửi hai lần.
+// true nếu đã xếp thêm frame
+bool GatewayServer::pumpReplay(Connection* conn) {
+    if (conn->cursor < ring.begin()) {
+        // Client đọc chậm hơn tốc độ ring bị ghi đè: ngắt như subscriber chậm, app kết nối lại với since
+        stats.slowDropped++;
+        drop(conn);
+        return false;
+    }
+    bool queued = false;
+    size_t limit = config.clientQueueBytes / 2;
+    while (conn->cursor < ring.end() && conn->queuedBytes < limit) {
+        const ReplayRing::Entry& entry = ring.at(conn->cursor++);
+        auto known = conn->resumeFrom.find(entry.device);
+        bool wanted;
+        if (known != conn->resumeFrom.end()) {
+            wanted = entry.seq > known->second;
+        } else {
+            // Trạm xuất hiện sau startReplay(): mọi sự kiện của nó đều mới, nếu client theo dõi
+            wanted = conn->devices.empty() ||
+                     std::find(conn->devices.begin(), conn->devices.end(), entry.device->id) != conn->devices.end();
+        }
+        if (!wanted) {
+            continue;
+        }
+        if (!enqueue(conn, entry.frame)) {
+            return false;
+        }
+        stats.replayed++;
+        queued = true;
+    }
+    if (conn->cursor == ring.end()) {
+        conn->replaying = false;
+        conn->resumeFrom.clear();
+        subscribe(conn);
+    }
+    return queued;
+}
+
+void GatewayServer::respond(Connection* conn, int status, const char* reason, const std::string& body,
+                            const char* contentType) {
+    char header[192];
+    int length = snprintf(header, sizeof(header),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %zu\r\n"
+                          "Connection: %s\r\n\r\n",
+                          status, reason, contentType, body.size(), conn->keepAlive ? "keep-alive" : "close");
+    std::string message(header, length);
+    message += body;
+    SharedFrame* frame = SharedFrame::raw(message.data(), message.size());
+    if (frame == nullptr) {
+        drop(conn);
+        return;
+    }
+    if (enqueue(conn, frame) && !conn->keepAlive) {
+        conn->state = CONN_CLOSING;
+    }
+    frame->release();
+}
+
+// ============================================
+// Frame từ subscriber
+// ============================================
+
+void GatewayServer::serviceFrames(Connection* conn) {
+    size_t offset = 0;
+    while (offset < conn->rx.size() && conn->state == CONN_SUBSCRIBER) {
+        WsFrame frame;
+        int used = WsProtocol::parseClientFrame((uint8_t*)&conn->rx[offset], conn->rx.size() - offset, frame);
+        if (used < 0) {
+            drop(conn);
+            return;
+        }
+        if (used == 0) {
+            break;
+        }
+        offset += used;
+    
+        if (frame.opcode == WS_OPCODE_PING || frame.opcode == WS_OPCODE_CLOSE) {
+            bool closing = frame.opcode == WS_OPCODE_CLOSE;
+            SharedFrame* reply = SharedFrame::encode(closing ? WS_OPCODE_CLOSE : WS_OPCODE_PONG, frame.payload,
+                                                     closing ? (frame.length >= 2 ? 2 : 0) : frame.length);
+            if (reply == nullptr) {
+                drop(conn);
+                return;
+            }
+            bool queued = enqueue(conn, reply);
+            reply->release();
+            if (!queued) {
+                return;
+            }
+            if (closing) {
+                unsubscribe(conn);
+                conn->replaying = false;
+                conn->state = CONN_CLOSING;
+            }
+        }
+        // Text/binary/pong từ subscriber: bỏ qua (luồng một chiều)
+    }
+    if (conn->state != CONN_CLOSED) {
+        conn->rx.erase(0, offset);
+    }
+}
+
+// ============================================
+// Ghi PostgreSQL (ScanStore)
+// ============================================
+
+// Trường chuỗi JSON → trường COPY (NULL nếu không có / null). false nếu không phải chuỗi
+// hoặc dài hơn maxChars ký tự (0 = không giới hạn)
+static bool copyString(std::string& row, const EventJson::Field& field, size_t maxChars = 0) {
+    if (field.value == nullptr || (field.length == 4 && memcmp(field.value, "null", 4) == 0)) {
+        ScanStore::appendNull(row);
+        return true;
+    }
+    std::string text;
+    if (!EventJson::decodeString(field.value, field.length, text)) {
+        return false;
+    }
+    if (maxChars > 0) {
+        // VARCHAR(n) đếm ký tự, không phải byte (tên tiếng Việt nhiều byte)
+        size_t chars = 0;
+        for (char c : text) {
+            chars += ((unsigned char)c & 0xC0) != 0x80;
+        }
+        if (chars > maxChars) {
+            return false;
+        }
+    }
+    ScanStore::appendText(row, text.data(), text.size());
+    return true;
+}
+
+// Ngày dạng YYYY-MM-DD
+static bool validDate(const EventJson::Field& field) {
+    if (field.value == nullptr || field.length != 12) {
+        return false;
+    }
+    const char* d = field.value + 1;
+    for (int i = 0; i < 10; i++) {
+        if (i == 4 || i == 7 ? d[i] != '-' : (d[i] < '0' || d[i] > '9')) {
+            return false;
+        }
+    }
+    int month = (d[5] - '0') * 10 + (d[6] - '0');
+    int day = (d[8] - '0') * 10 + (d[9] - '0');
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+// Dòng iot_scan_events: device_id, scan_type, scan_data, success, payload (JSON gốc), received_at
+static bool scanRow(const char* json, size_t length, std::string& row) {
+    EventJson::Field fields[] = {
+        {"device_id", nullptr, 0}, {"scan_type", nullptr, 0}, {"scan_data", nullptr, 0}, {"success", nullptr, 0},
+    };
+    if (!EventJson::findFields(json, length, fields, 4)) {
+        return false;
+    }
+    row.reserve(length + 128);
+    if (!copyString(row, fields[0], 64)) {
+        return false;
+    }
+    // scan_type: cột NOT NULL, sự kiện thiếu thì ghi chuỗi rỗng (vẫn giữ payload)
+    if (fields[1].value == nullptr) {
+        ScanStore::appendText(row, "", 0);
+    } else if (!copyString(row, fields[1], 50)) {
+        return false;
+    }
+    if (!copyString(row, fields[2], 255)) {
+        return false;
+    }
+    bool success = fields[3].value != nullptr && fields[3].length == 4 && memcmp(fields[3].value, "true", 4) == 0;
+    ScanStore::appendText(row, success ? "t" : "f", 1);
+    ScanStore::appendText(row, json, length);
+    
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    tm utc;
+    gmtime_r(&ts.tv_sec, &utc);
+    char receivedAt[40];
+    int n = snprintf(receivedAt, sizeof(receivedAt), "%04d-%02d-%02d %02d:%02d:%02d.%06ld+00", utc.tm_year + 1900,
+                     utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, ts.tv_nsec / 1000);
+    ScanStore::appendText(row, receivedAt, n);
+    ScanStore::endRow(row);
+    return true;
+}
+
+// Dòng borrow_cards theo cột của setup_postgres.sql (status, created_at... để mặc định)
+static bool borrowRow(const char* json, size_t length, std::string& row) {
+    EventJson::Field fields[] = {
+        {"borrower_name", nullptr, 0},  {"borrower_class", nullptr, 0}, {"borrower_student_id", nullptr, 0},
+        {"borrower_phone", nullptr, 0}, {"borrower_email", nullptr, 0}, {"book_name", nullptr, 0},
+        {"book_code", nullptr, 0},      {"borrow_date", nullptr, 0},    {"expected_return_date", nullptr, 0},
+    };
+    const size_t limits[] = {255, 100, 50, 20, 255, 500, 100, 10, 10};
+    if (!EventJson::findFields(json, length, fields, 9) || fields[0].value == nullptr ||
+        fields[5].value == nullptr || !validDate(fields[7]) || !validDate(fields[8])) {
+        return false;
+    }
+    for (int i = 0; i < 9; i++) {
+        if (!copyString(row, fields[i], limits[i])) {
+            return false;
+        }
+    }
+    ScanStore::endRow(row);
+    return true;
+}
+
+void GatewayServer::ingestEvent(Connection* conn, const char* body, size_t length) {
+    if (!store.enabled()) {
+        if (publish(body, length)) {
+            respond(conn, 202, "Accepted", "");
+        } else {
+            respond(conn, 400, "Bad Request", "invalid scan event\n");
+        }
+        return;
+    }
+    // Phản hồi nào cũng đi qua store để giữ thứ tự với các POST trước đang chờ commit
+    conn->pendingAcks++;
+    if (store.full()) {
+        store.submit(ScanStore::TABLE_NONE, std::string(), conn, 503);   // Chưa phát: trạm gửi lại
+        return;
+    }
+    std::string row;
+    if (!scanRow(body, length, row)) {
+        stats.invalid++;
+        store.submit(ScanStore::TABLE_NONE, std::string(), conn, 400);
+        return;
+    }
+    if (!publish(body, length)) {
+        store.submit(ScanStore::TABLE_NONE, std::string(), conn, 400);     // publish() đã đếm invalid
+        return;
+    }
+    store.submit(ScanStore::TABLE_SCANS, std::move(row), conn, 202);
+}
+
+void GatewayServer::ingestBorrow(Connection* conn, const char* body, size_t length) {
+    conn->pendingAcks++;
+    std::string row;
+    if (!borrowRow(body, length, row)) {
+        stats.invalid++;
+        store.submit(ScanStore::TABLE_NONE, std::string(), conn, 400);
+        return;
+    }
+    store.submit(ScanStore::TABLE_BORROWS, std::move(row), conn, 202);
+}
+
+// Phản hồi cho trạm sau khi store commit (hoặc lỗi), theo đúng thứ tự POST
+void GatewayServer::serviceAcks() {
+    std::vector<ScanStore::Ack> acks;
+    store.takeAcks(acks);
+    for (const ScanStore::Ack& ack : acks) {
+        Connection* conn = static_cast<Connection*>(ack.owner);
+        conn->pendingAcks--;
+        if (conn->state == CONN_CLOSED) {
+            continue;                   // Trạm đã ngắt: nó sẽ gửi lại, graveyard giải phóng sau
+        }
+        if (ack.status == 202) {
+            respond(conn, 202, "Accepted", "");
+        } else if (ack.status == 400) {
+            respond(conn, 400, "Bad Request", "invalid scan event\n");
+        } else {
+            respond(conn, 503, "Service Unavailable", "storage unavailable\n");
+        }
+        // Request đến sau trong lúc chờ
+        if (conn->pendingAcks == 0 && conn->state == CONN_HTTP && !conn->rx.empty()) {
+            serviceHttp(conn);
+        }
+    }
+}
+
+// ============================================
+// Tra độc giả theo UID thẻ (ReaderIndex)
+// ============================================
+
+// Chuỗi JSON có dấu nháy, escape ký tự điều khiển (UTF-8 giữ nguyên)
+static void appendJsonString(std::string& out, const char* text) {
+    out += '"';
+    for (const char* p = text; *p != '\0'; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+// Cùng request/response với backend (INTEGRATION_GUIDE.md): không tìm thấy vẫn là 200 +
+// success=false để trạm hiện lỗi như khi hỏi backend. Không kèm phiếu mượn (include_loans)
+void GatewayServer::lookupStudent(Connection* conn, const char* body, size_t length) {
+    EventJson::Field field = {"card_uid", nullptr, 0};
+    std::string uid;
+    uint64_t key;
+    if (!EventJson::findFields(body, length, &field, 1) || field.value == nullptr ||
+        !EventJson::decodeString(field.value, field.length, uid) || !ReaderIndex::parseUid(uid.data(), uid.size(), key)) {
+        stats.invalid++;
+        respond(conn, 400, "Bad Request", "{\"success\":false,\"error\":\"card_uid không hợp lệ\"}", JSON_TYPE);
+        return;
+    }
+    std::shared_ptr<const ReaderSnapshot> snapshot = readers.current();
+    if (!snapshot) {
+        respond(conn, 503, "Service Unavailable", "{\"success\":false,\"error\":\"Chưa có dữ liệu độc giả\"}",
+                JSON_TYPE);
+        return;
+    }
+    stats.readerLookups++;
+    const ReaderRecord* record = snapshot->find(key);
+    if (record == nullptr) {
+        stats.readerMisses++;
+        respond(conn, 200, "OK", "{\"success\":false,\"error\":\"Không tìm thấy thông tin sinh viên\"}", JSON_TYPE);
+        return;
+    }
+    std::string out = "{\"success\":true,\"student\":{\"mssv\":";
+    out.reserve(256);
+    appendJsonString(out, record->mssv);
+    out += ",\"name\":";
+    appendJsonString(out, record->name);
+    out += ",\"class\":";
+    appendJsonString(out, record->className);
+    out += ",\"reader_id\":";
+    out += std::to_string(record->readerId);
+    out += "}}";
+    respond(conn, 200, "OK", out, JSON_TYPE);
+}
+
+// ============================================
+// Lịch sử heartbeat (TelemetryStore)
+// ============================================
+
+// Số nguyên trong query, false nếu rỗng/có ký tự thừa
+static bool parseInteger(const std::string& text, int64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    long long parsed = strtoll(text.c_str(), &end, 10);
+    if (*end != '\0' || errno != 0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Số nguyên (phần lớn metric: byte heap, số lần...) in không kèm phần thập phân
+static void appendNumber(std::string& out, double value) {
+    if (value == floor(value) && fabs(value) < 1e15) {
+        out += std::to_string((long long)value);
+        return;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.10g", value);
+    out += text;
+}
+
+// Mọi giá trị số của heartbeat (memory.free_heap, memory.stack_free.<task>, config_version...)
+// thành một mẫu của series (trạm, tên). Giờ lấy từ "timestamp" (ms) của trạm nếu lệch giờ
+// gateway không quá GATEWAY_CLOCK_SKEW_S (trạm chưa đồng bộ SNTP gửi giờ sai), không thì giờ
+// nhận. Phản hồi không kèm "config": cấu hình trạm vẫn do backend gửi
+void GatewayServer::ingestHeartbeat(Connection* conn, const char* body, size_t length) {
+    char deviceId[EVENT_DEVICE_ID_MAX];
+    std::vector<EventJson::Number> numbers;
+    if (!EventJson::extractDeviceId(body, length, deviceId) || !EventJson::collectNumbers(body, length, numbers)) {
+        stats.invalid++;
+        respond(conn, 400, "Bad Request", "{\"success\":false,\"error\":\"heartbeat không hợp lệ\"}", JSON_TYPE);
+        return;
+    }
+    int64_t now = unixSeconds();
+    int64_t timestamp = now;
+    for (const EventJson::Number& number : numbers) {
+        if (number.name == "timestamp") {
+            int64_t stationTime = (int64_t)(number.value / 1000);
+            if (llabs(stationTime - now) <= GATEWAY_CLOCK_SKEW_S) {
+                timestamp = stationTime;
+            }
+        }
+    }
+    std::string device = deviceId;
+    size_t kept = 0;
+    for (const EventJson::Number& number : numbers) {
+        if (number.name == "timestamp" || number.name.size() >= TELEMETRY_METRIC_MAX) {
+            continue;
+        }
+        if (++kept > GATEWAY_HEARTBEAT_METRICS) {
+            break;
+        }
+        telemetry.append(device, number.name, timestamp, number.value);
+    }
+    stats.heartbeats++;
+    respond(conn, 200, "OK", "{\"success\":true}", JSON_TYPE);
+}
+
+// GET /api/iot/telemetry?metric=memory.free_heap[&device_id=A,B][&from=..&to=..][&step=300]
+// from/to: giây Unix (mặc định 1 giờ gần nhất); step 0 = mẫu gốc [[t,v]...], step > 0 = bucket
+// [[t,min,avg,max,count]...]. Bỏ device_id = mọi trạm; bỏ metric = danh sách trạm và metric
+void GatewayServer::queryTelemetry(Connection* conn, const std::string& target) {
+    std::vector<std::pair<std::string, std::string>> params = parseQuery(target);
+    std::vector<std::string> devices = parseDevices(params);
+    std::string metric;
+    int64_t to = unixSeconds();
+    int64_t from = INT64_MIN;
+    int64_t step = 0;
+    bool valid = true;
+    for (const auto& param : params) {
+        if (param.first == "metric") {
+            metric = param.second;
+        } else if (param.first == "from") {
+            valid = valid && parseInteger(param.second, from);
+        } else if (param.first == "to") {
+            valid = valid && parseInteger(param.second, to);
+        } else if (param.first == "step") {
+            valid = valid && parseInteger(param.second, step);
+        }
+    }
+    if (from == INT64_MIN) {
+        from = to - 3600;
+    }
+    if (!valid || from > to || step < 0 || metric.size() >= TELEMETRY_METRIC_MAX ||
+        (step > 0 && (to - from) / step >= GATEWAY_TELEMETRY_POINTS)) {
+        stats.invalid++;
+        respond(conn, 400, "Bad Request", "{\"success\":false,\"error\":\"tham số không hợp lệ\"}", JSON_TYPE);
+        return;
+    }
+    stats.telemetryQueries++;
+    
+    std::string out;
+    if (metric.empty()) {
+        std::vector<TelemetryStore::DeviceInfo> infos;
+        telemetry.listDevices(infos);
+        out = "{\"devices\":[";
+        for (size_t i = 0; i < infos.size(); i++) {
+            out += i > 0 ? ",{\"device_id\":" : "{\"device_id\":";
+            appendJsonString(out, infos[i].id.c_str());
+            out += ",\"last_seen\":" + std::to_string(infos[i].lastSeen) + ",\"metrics\":[";
+            for (size_t j = 0; j < infos[i].metrics.size(); j++) {
+                if (j > 0) {
+                    out += ',';
+                }
+                appendJsonString(out, infos[i].metrics[j].c_str());
+            }
+            out += "]}";
+        }
+        out += "]}";
+        respond(conn, 200, "OK", out, JSON_TYPE);
+        return;
+    }
+    
+    if (devices.empty()) {
+        devices = telemetry.deviceIds();
+    }
+    out = "{\"metric\":";
+    appendJsonString(out, metric.c_str());
+    out += ",\"from\":" + std::to_string(from) + ",\"to\":" + std::to_string(to) + ",\"step\":" +
+           std::to_string(step) + ",\"series\":[";
+    std::vector<TelemetryPoint> points;
+    std::vector<TelemetryBucket> buckets;
+    bool first = true;
+    bool truncated = false;
+    for (const std::string& device : devices) {
+        bool found;
+        bool cut = false;
+        if (step == 0) {
+            found = telemetry.raw(device, metric, from, to, GATEWAY_TELEMETRY_POINTS, points, cut);
+        } else {
+            found = telemetry.range(device, metric, from, to, step, buckets);
+        }
+        if (!found) {
+            continue;
+        }
+        truncated = truncated || cut;
+        out += first ? "{\"device_id\":" : ",{\"device_id\":";
+        first = false;
+        appendJsonString(out, device.c_str());
+        out += ",\"points\":[";
+        if (step == 0) {
+            for (size_t i = 0; i < points.size(); i++) {
+                out += i > 0 ? ",[" : "[";
+                out += std::to_string(points[i].time);
+                out += ',';
+                appendNumber(out, points[i].value);
+                out += ']';
+            }
+        } else {
+            for (size_t i = 0; i < buckets.size(); i++) {
+                const TelemetryBucket& bucket = buckets[i];
+                out += i > 0 ? ",[" : "[";
+                out += std::to_string(bucket.start);
+                out += ',';
+                appendNumber(out, bucket.min);
+                out += ',';
+                appendNumber(out, bucket.sum / bucket.count);
+                out += ',';
+                appendNumber(out, bucket.max);
+                out += ',';
+                out += std::to_string(bucket.count);
+                out += ']';
+            }
+        }
+        out += "]}";
+    }
+    out += truncated ? "],\"truncated\":true}" : "]}";
+    respond(conn, 200, "OK", out, JSON_TYPE);
+}
+
+// ============================================
+// Fan-out
+// ============================================
+
+bool GatewayServer::publish(const char* json, size_t length) {
+    char deviceId[EVENT_DEVICE_ID_MAX];
+    if (!EventJson::extractDeviceId(json, length, deviceId)) {
+        stats.invalid++;
+        return false;
+    }
+    ReplayRing::Device* device = ring.device(deviceId, true);
+    if (device == nullptr) {
+        stats.invalid++;                // Quá maxDevices trạm khác nhau
+        return false;
+    }
+    stats.ingested++;
+    
+    // Chèn seq của trạm vào đầu object: {"seq":N, + phần sau '{' (extractDeviceId đã kiểm tra là object)
+    const char* brace = static_cast<const char*>(memchr(json, '{', length));
+    char prefix[32];
+    int prefixLength = snprintf(prefix, sizeof(prefix), "{\"seq\":%llu,", (unsigned long long)(device->lastSeq + 1));
+    SharedFrame* frame = SharedFrame::encode(WS_OPCODE_TEXT, prefix, prefixLength, brace + 1,
+                                             length - (brace + 1 - json));
+    if (frame == nullptr) {
+        return false;
+    }
+    ring.append(device, frame);
+    
+    std::vector<Connection*>* lists[2] = {&everyone, nullptr};
+    auto it = byDevice.find(deviceId);
+    if (it != byDevice.end()) {
+        lists[1] = &it->second;
+    }
+    if (everyone.empty() && (lists[1] == nullptr || lists[1]->empty())) {
+        stats.unrouted++;
+    }
+    for (std::vector<Connection*>* list : lists) {
+        if (list == nullptr) {
+            continue;
+        }
+        // Duyệt ngược: subscriber chậm bị ngắt được thay bằng phần tử cuối (đã xử lý)
+        for (size_t i = list->size(); i-- > 0;) {
+            if (enqueue((*list)[i], frame)) {
+                stats.deliveries++;
+            }
+        }
+    }
+    frame->release();
+    return true;
+}
+
+bool GatewayServer::enqueue(Connection* conn, SharedFrame* frame) {
+    if (conn->queuedBytes + frame->size() > config.clientQueueBytes) {
+        // Client đọc không kịp: ngắt thay vì giữ sự kiện cũ hay tăng bộ nhớ
+        stats.slowDropped++;
+        drop(conn);
+        return false;
+    }
+    frame->retain();
+    conn->queue.push_back({frame, 0});
+    conn->queuedBytes += frame->size();
+    if (conn->queuedBytes > stats.maxQueued) {
+        stats.maxQueued = conn->queuedBytes;
+    }
+    // Đang chờ EPOLLOUT thì frame sẽ được gửi khi socket ghi được
+    if (!conn->dirty && !conn->writable) {
+        conn->dirty = true;
+        dirtyList.push_back(conn);
+    }
+    return true;
+}
+
+void GatewayServer::flushDirty() {
+    for (size_t i = 0; i < dirtyList.size(); i++) {
+        Connection* conn = dirtyList[i];
+        conn->dirty = false;
+        if (conn->state != CONN_CLOSED) {
+            flush(conn);
+        }
+    }
+    dirtyList.clear();
+}
+
+void GatewayServer::flush(Connection* conn) {
+    while (true) {
+        if (conn->queue.empty()) {
+            // Đã gửi hết: xếp tiếp phần phát lại (nếu đang phát lại)
+            if (!conn->replaying || !pumpReplay(conn)) {
+                break;
+            }
+            continue;
+        }
+        iovec iov[GATEWAY_MAX_IOV];
+        size_t count = 0;
+        size_t total = 0;
+        for (auto it = conn->queue.begin(); it != conn->queue.end() && count < GATEWAY_MAX_IOV; ++it) {
+            iov[count].iov_base = it->frame->data() + it->offset;
+            iov[count].iov_len = it->frame->size() - it->offset;
+            total += iov[count].iov_len;
+            count++;
+        }
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        stats.writeCalls++;
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watchWritable(conn, true);
+                return;
+            }
+            drop(conn);
+            return;
+        }
+    
+        conn->queuedBytes -= sent;
+        size_t left = sent;
+        while (left > 0) {
+            Pending& pending = conn->queue.front();
+            size_t remaining = pending.frame->size() - pending.offset;
+            if (left < remaining) {
+                pending.offset += left;
+                break;
+            }
+            left -= remaining;
+            pending.frame->release();
+            conn->queue.pop_front();
+        }
+        if ((size_t)sent < total) {
+            watchWritable(conn, true);  // Buffer TCP đầy, gửi tiếp khi có EPOLLOUT
+            return;
+        }
+    }
+    if (conn->state == CONN_CLOSED) {
+        return;
+    }
+    watchWritable(conn, false);
+    // Đã gửi hết response cuối / frame close thì đóng socket
+    if (conn->state == CONN_CLOSING && conn->pendingAcks == 0) {
+        drop(conn);
+    }
+}
+
+void GatewayServer::watchWritable(Connection* conn, bool enable) {
+    if (conn->writable == enable) {
+        return;
+    }
+    conn->writable = enable;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | (enable ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.ptr = conn;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+// ============================================
+// Quản lý kết nối
+// ============================================
+
+void GatewayServer::sweep(uint64_t now) {
+    // Duyệt ngược vì drop() thay kết nối bị xóa bằng phần tử cuối
+    for (size_t i = connections.size(); i-- > 0;) {
+        Connection* conn = connections[i];
+        uint64_t idle = now - conn->since;
+        if (conn->state == CONN_SUBSCRIBER) {
+            if (idle > 2 * (uint64_t)config.pingIntervalMs) {
+                stats.timedOut++;
+                drop(conn);
+            } else if (now - conn->lastPing >= config.pingIntervalMs) {
+                conn->lastPing = now;
+                enqueue(conn, pingFrame);
+            }
+        } else if (conn->state == CONN_HTTP) {
+            // Request dở dang quá hạn là lỗi; kết nối keep-alive rảnh thì chỉ đóng
+            if (!conn->rx.empty() && idle > config.requestTimeoutMs) {
+                stats.rejected++;
+                drop(conn);
+            } else if (idle > config.keepAliveTimeoutMs) {
+                drop(conn);
+            }
+        } else if (conn->state == CONN_CLOSING && idle > config.requestTimeoutMs) {
+            drop(conn);
+        }
+    }
+    
+    // Trạm không còn ai theo dõi
+    for (auto it = byDevice.begin(); it != byDevice.end();) {
+        if (it->second.empty()) {
+            it = byDevice.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    if (telemetry.enabled() && now - lastExpire >= GATEWAY_TELEMETRY_EXPIRE_MS) {
+        lastExpire = now;
+        telemetry.expire(unixSeconds());
+    }
+}
+
+void GatewayServer::subscribe(Connection* conn) {
+    if (conn->devices.empty()) {
+        everyone.push_back(conn);
+    } else {
+        for (const std::string& device : conn->devices) {
+            byDevice[device].push_back(conn);
+        }
+    }
+    conn->subscribed = true;
+    subscribers++;
+}
+
+void GatewayServer::unsubscribe(Connection* conn) {
+    if (!conn->subscribed) {
+        return;
+    }
+    // Thay bằng phần tử cuối; vector rỗng để lại cho sweep() (publish() có thể đang duyệt)
+    auto remove = [conn](std::vector<Connection*>& list) {
+        auto it = std::find(list.begin(), list.end(), conn);
+        if (it != list.end()) {
+            *it = list.back();
+            list.pop_back();
+        }
+    };
+    if (conn->devices.empty()) {
+        remove(everyone);
+    } else {
+        for (const std::string& device : conn->devices) {
+            auto it = byDevice.find(device);
+            if (it != byDevice.end()) {
+                remove(it->second);
+            }
+        }
+    }
+    conn->subscribed = false;
+    subscribers--;
+}
+
+void GatewayServer::drop(Connection* conn) {
+    if (conn->state == CONN_CLOSED) {
+        return;
+    }
+    unsubscribe(conn);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    for (Pending& pending : conn->queue) {
+        pending.frame->release();
+    }
+    conn->queue.clear();
+    conn->queuedBytes = 0;
+    
+    Connection* last = connections.back();
+    connections[conn->slot] = last;
+    last->slot = conn->slot;
+    connections.pop_back();
+    
+    // Giải phóng ở cuối vòng: kết nối có thể còn trong lô epoll hoặc danh sách ghi
+    conn->state = CONN_CLOSED;
+    graveyard.push_back(conn);
+}
+
+// ============================================
+// Thống kê
+// ============================================
+
+std::string GatewayServer::metricsText() const {
+    struct Metric {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint64_t value;
+    };
+    const Metric metrics[] = {
+        {"gateway_subscribers", "gauge", "Open WebSocket subscribers", subscribers},
+        {"gateway_connections", "gauge", "Open TCP connections (stations and subscribers)", connections.size()},
+        {"gateway_events_ingested_total", "counter", "Scan events accepted on POST /events", stats.ingested},
+        {"gateway_events_invalid_total", "counter", "Rejected POST /events bodies", stats.invalid},
+        {"gateway_events_unrouted_total", "counter", "Events with no subscriber", stats.unrouted},
+        {"gateway_deliveries_total", "counter", "Event frames queued to subscribers", stats.deliveries},
+        {"gateway_subscribers_accepted_total", "counter", "Successful WebSocket upgrades", stats.accepted},
+        {"gateway_connections_rejected_total", "counter", "Refused or failed connections", stats.rejected},
+        {"gateway_subscribers_slow_dropped_total", "counter", "Subscribers dropped for exceeding the send queue",
+         stats.slowDropped},
+        {"gateway_subscribers_timed_out_total", "counter", "Subscribers dropped for not answering pings",
+         stats.timedOut},
+        {"gateway_write_calls_total", "counter", "sendmsg calls (frames are batched per call)", stats.writeCalls},
+        {"gateway_max_queued_bytes", "gauge", "Largest send queue seen on one connection", stats.maxQueued},
+        {"gateway_replay_retained_events", "gauge", "Events held for reconnecting subscribers", ring.size()},
+        {"gateway_replay_retained_bytes", "gauge", "Bytes held by the replay ring", ring.getBytes()},
+        {"gateway_replay_evicted_total", "counter", "Events evicted from the replay ring", ring.getEvicted()},
+        {"gateway_resumes_total", "counter", "Subscribers that reconnected with since=", stats.resumed},
+        {"gateway_replay_frames_total", "counter", "Event frames replayed to resuming subscribers", stats.replayed},
+        {"gateway_replay_lost_total", "counter", "Missed events already evicted when a subscriber resumed",
+         stats.replayLost},
+    };
+    StoreStats storeStats = store.getStats();
+    const Metric storeMetrics[] = {
+        {"gateway_store_rows_total", "counter", "Rows committed to PostgreSQL", storeStats.rows},
+        {"gateway_store_commits_total", "counter", "Group-commit transactions", storeStats.commits},
+        {"gateway_store_failed_rows_total", "counter", "Rows answered 503 (database down or queue full)",
+         storeStats.failedRows},
+        {"gateway_store_rejected_rows_total", "counter", "Rows the database refused (answered 400)",
+         storeStats.rejectedRows},
+        {"gateway_store_pending_rows", "gauge", "Rows waiting for the next commit", storeStats.pending},
+        {"gateway_store_max_batch_rows", "gauge", "Largest transaction so far", storeStats.maxBatch},
+        {"gateway_store_commit_microseconds_total", "counter", "Time spent in BEGIN..COMMIT",
+         storeStats.commitUsTotal},
+        {"gateway_store_commit_microseconds_max", "gauge", "Slowest transaction", storeStats.commitUsMax},
+    };
+    ReaderIndexStats readerStats = readers.getStats();
+    const Metric readerMetrics[] = {
+        {"gateway_reader_lookups_total", "counter", "Card UID lookups served from the reader snapshot",
+         stats.readerLookups},
+        {"gateway_reader_misses_total", "counter", "Card UIDs not in the reader snapshot", stats.readerMisses},
+        {"gateway_reader_snapshot_readers", "gauge", "Readers in the current snapshot", readerStats.readers},
+        {"gateway_reader_snapshot_bytes", "gauge", "Size of the mapped snapshot file", readerStats.fileBytes},
+        {"gateway_reader_snapshot_built_seconds", "gauge", "Unix time the current snapshot was built",
+         readerStats.builtAt},
+        {"gateway_reader_rebuilds_total", "counter", "Snapshots rebuilt from the readers table", readerStats.rebuilds},
+        {"gateway_reader_rebuild_failures_total", "counter", "Failed rebuilds (old snapshot kept)",
+         readerStats.rebuildFailures},
+        {"gateway_reader_rebuild_microseconds", "gauge", "Duration of the last rebuild", readerStats.lastRebuildUs},
+    };
+    TelemetryStats telemetryStats = telemetry.getStats();
+    const Metric telemetryMetrics[] = {
+        {"gateway_heartbeats_total", "counter", "Heartbeats recorded into the telemetry store", stats.heartbeats},
+        {"gateway_telemetry_series", "gauge", "Station/metric series held", telemetryStats.series},
+        {"gateway_telemetry_raw_samples", "gauge", "Raw samples held (Gorilla-compressed)", telemetryStats.rawSamples},
+        {"gateway_telemetry_rollup_points", "gauge", "5-minute and 1-hour buckets held", telemetryStats.rollupPoints},
+        {"gateway_telemetry_bytes", "gauge", "Estimated memory of the telemetry store", telemetryStats.memoryBytes},
+        {"gateway_telemetry_samples_total", "counter", "Samples appended", telemetryStats.appended},
+        {"gateway_telemetry_rejected_total", "counter", "Samples dropped (out of order or series limit)",
+         telemetryStats.outOfOrder + telemetryStats.dropped},
+        {"gateway_telemetry_queries_total", "counter", "GET /api/iot/telemetry requests", stats.telemetryQueries},
+    };
+    std::string out;
+    char line[256];
+    auto append = [&](const Metric& metric) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", metric.name, metric.help,
+                 metric.name, metric.type, metric.name, (unsigned long long)metric.value);
+        out += line;
+    };
+    for (const Metric& metric : metrics) {
+        append(metric);
+    }
+    if (store.enabled()) {
+        for (const Metric& metric : storeMetrics) {
+            append(metric);
+        }
+    }
+    if (readers.enabled()) {
+        for (const Metric& metric : readerMetrics) {
+            append(metric);
+        }
+    }
+    if (telemetry.enabled()) {
+        for (const Metric& metric : telemetryMetrics) {
+            append(metric);
+        }
+    }
+    return out;
+}
+
+void GatewayServer::printStats() const {
+    printf("[Gateway] subscribers=%zu events=%llu invalid=%llu deliveries=%llu writes=%llu "
+           "accepted=%llu rejected=%llu slow=%llu timeout=%llu max queued=%lluB\n",
+           subscribers, (unsigned long long)stats.ingested, (unsigned long long)stats.invalid,
+           (unsigned long long)stats.deliveries, (unsigned long long)stats.writeCalls,
+           (unsigned long long)stats.accepted, (unsigned long long)stats.rejected,
+           (unsigned long long)stats.slowDropped, (unsigned long long)stats.timedOut,
+           (unsigned long long)stats.maxQueued);
+    printf("[Gateway] replay: retained=%zu (%zu/%zuB) evicted=%llu resumed=%llu replayed=%llu lost=%llu "
+           "devices=%zu\n",
+           ring.size(), ring.getBytes(), ring.getCapacity(), (unsigned long long)ring.getEvicted(),
+           (unsigned long long)stats.resumed, (unsigned long long)stats.replayed,
+           (unsigned long long)stats.replayLost, ring.getDevices().size());
+    if (store.enabled()) {
+        StoreStats storeStats = store.getStats();
+        printf("[Gateway] store: rows=%llu commits=%llu (%.1f rows/commit, max %llu) failed=%llu rejected=%llu "
+               "commit avg=%lluus max=%lluus\n",
+               (unsigned long long)storeStats.rows, (unsigned long long)storeStats.commits,
+               storeStats.commits ? (double)storeStats.rows / storeStats.commits : 0.0,
+               (unsigned long long)storeStats.maxBatch, (unsigned long long)storeStats.failedRows,
+               (unsigned long long)storeStats.rejectedRows,
+               (unsigned long long)(storeStats.commits ? storeStats.commitUsTotal / storeStats.commits : 0),
+               (unsigned long long)storeStats.commitUsMax);
+    }
+    if (readers.enabled()) {
+        ReaderIndexStats readerStats = readers.getStats();
+        printf("[Gateway] readers: %llu in snapshot (%.1f MB) lookups=%llu misses=%llu rebuilds=%llu failed=%llu "
+               "last rebuild=%llums\n",
+               (unsigned long long)readerStats.readers, readerStats.fileBytes / 1e6,
+               (unsigned long long)stats.readerLookups, (unsigned long long)stats.readerMisses,
+               (unsigned long long)readerStats.rebuilds, (unsigned long long)readerStats.rebuildFailures,
+               (unsigned long long)(readerStats.lastRebuildUs / 1000));
+    }
+    if (telemetry.enabled()) {
+        TelemetryStats telemetryStats = telemetry.getStats();
+        printf("[Gateway] telemetry: heartbeats=%llu devices=%llu series=%llu raw=%llu rollup=%llu "
+               "memory=%.1f MB (%.2f B/raw sample) rejected=%llu queries=%llu\n",
+               (unsigned long long)stats.heartbeats, (unsigned long long)telemetryStats.devices,
+               (unsigned long long)telemetryStats.series, (unsigned long long)telemetryStats.rawSamples,
+               (unsigned long long)telemetryStats.rollupPoints, telemetryStats.memoryBytes / 1e6,
+               telemetryStats.rawSamples ? (double)telemetryStats.memoryBytes / telemetryStats.rawSamples : 0.0,
+               (unsigned long long)(telemetryStats.outOfOrder + telemetryStats.dropped),
+               (unsigned long long)stats.telemetryQueries);
+    }
+}
@@ -0,0 +1,226 @@
+#include "gorilla.h"
+#include <string.h>
+
+// Delta-of-delta: '0' = 0, rồi các khoảng [-63, 64] / [-255, 256] / [-2047, 2048] với
+// tiền tố '10' / '110' / '1110', còn lại '1111' + 32 bit. Delta đầu tiên tính với delta 0
+// (heartbeat 60 s rơi vào khoảng 9 bit), nên không cần trường riêng cho mẫu thứ hai
+struct DodRange {
+    uint32_t prefix;
+    int prefixBits;
+    int valueBits;
+    int64_t low;
+    int64_t high;
+};
+
+static const DodRange DOD_RANGES[] = {
+    {0x2, 2, 7, -63, 64},
+    {0x6, 3, 9, -255, 256},
+    {0xE, 4, 12, -2047, 2048},
+};
+
+static uint64_t toBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double fromBits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// ============================================
+// Encoder
+// ============================================
+
+GorillaEncoder::GorillaEncoder(uint8_t columns) {
+    current.columns = columns == 0 || columns > GORILLA_MAX_COLUMNS ? 1 : columns;
+    reset();
+}
+
+void GorillaEncoder::reset() {
+    current.first = 0;
+    current.last = 0;
+    current.count = 0;
+    current.words.clear();
+    bitLength = 0;
+    previousDelta = 0;
+    for (int i = 0; i < GORILLA_MAX_COLUMNS; i++) {
+        previousBits[i] = 0;
+        leading[i] = 0xFF;
+        trailing[i] = 0;
+    }
+}
+
+GorillaBlock GorillaEncoder::seal() {
+    current.words.shrink_to_fit();
+    GorillaBlock sealed = std::move(current);
+    current = GorillaBlock();
+    current.columns = sealed.columns;
+    reset();
+    return sealed;
+}
+
+void GorillaEncoder::writeBits(uint64_t value, int count) {
+    if (count == 0) {
+        return;
+    }
+    if (count < 64) {
+        value &= ((uint64_t)1 << count) - 1;
+    }
+    int offset = bitLength & 63;
+    if (offset == 0) {
+        current.words.push_back(0);
+    }
+    int space = 64 - offset;
+    if (count <= space) {
+        current.words.back() |= value << (space - count);
+    } else {
+        current.words.back() |= value >> (count - space);
+        current.words.push_back(value << (64 - (count - space)));
+    }
+    bitLength += count;
+}
+
+void GorillaEncoder::writeValue(int column, double value) {
+    uint64_t bits = toBits(value);
+    uint64_t xorBits = bits ^ previousBits[column];
+    previousBits[column] = bits;
+    if (xorBits == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    int lead = __builtin_clzll(xorBits);
+    int trail = __builtin_ctzll(xorBits);
+    if (lead > 31) {
+        lead = 31;                      // 5 bit
+    }
+    // Nằm gọn trong cửa sổ trước: chỉ ghi phần bit trong cửa sổ
+    if (leading[column] != 0xFF && lead >= leading[column] && trail >= trailing[column]) {
+        int meaningful = 64 - leading[column] - trailing[column];
+        writeBits(0x2, 2);
+        writeBits(xorBits >> trailing[column], meaningful);
+        return;
+    }
+    int meaningful = 64 - lead - trail;
+    writeBits(0x3, 2);
+    writeBits(lead, 5);
+    writeBits(meaningful - 1, 6);
+    writeBits(xorBits >> trail, meaningful);
+    leading[column] = lead;
+    trailing[column] = trail;
+}
+
+void GorillaEncoder::append(int64_t timestamp, const double* values) {
+    if (current.count == 0) {
+        current.first = timestamp;
+        for (int i = 0; i < current.columns; i++) {
+            previousBits[i] = toBits(values[i]);
+            writeBits(previousBits[i], 64);
+        }
+    } else {
+        int64_t delta = timestamp - current.last;
+        int64_t dod = delta - previousDelta;
+        previousDelta = delta;
+        if (dod == 0) {
+            writeBits(0, 1);
+        } else {
+            bool written = false;
+            for (const DodRange& range : DOD_RANGES) {
+                if (dod >= range.low && dod <= range.high) {
+                    writeBits(range.prefix, range.prefixBits);
+                    writeBits((uint64_t)(dod - range.low), range.valueBits);
+                    written = true;
+                    break;
+                }
+            }
+            if (!written) {
+                writeBits(0xF, 4);
+                writeBits((uint32_t)(int32_t)dod, 32);
+            }
+        }
+        for (int i = 0; i < current.columns; i++) {
+            writeValue(i, values[i]);
+        }
+    }
+    current.last = timestamp;
+    current.count++;
+}
+
+// ============================================
+// Decoder
+// ============================================
+
+GorillaDecoder::GorillaDecoder(const GorillaBlock& block)
+    : block(block), index(0), position(0), timestamp(block.first), delta(0) {
+    for (int i = 0; i < GORILLA_MAX_COLUMNS; i++) {
+        previousBits[i] = 0;
+        leading[i] = 0;
+        trailing[i] = 0;
+    }
+}
+
+uint64_t GorillaDecoder::readBits(int count) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t word = position >> 6;
+    int offset = position & 63;
+    uint64_t high = block.words[word] << offset;
+    uint64_t value = high >> (64 - count);
+    if (offset + count > 64) {
+        value |= block.words[word + 1] >> (128 - offset - count);
+    }
+    position += count;
+    return value;
+}
+
+double GorillaDecoder::readValue(int column) {
+    if (readBits(1) != 0) {
+        if (readBits(1) != 0) {
+            leading[column] = (uint8_t)readBits(5);
+            int meaningful = (int)readBits(6) + 1;
+            trailing[column] = (uint8_t)(64 - leading[column] - meaningful);
+        }
+        int meaningful = 64 - leading[column] - trailing[column];
+        previousBits[column] ^= readBits(meaningful) << trailing[column];
+    }
+    return fromBits(previousBits[column]);
+}
+
+bool GorillaDecoder::next(int64_t& outTimestamp, double* values) {
+    if (index >= block.count) {
+        return false;
+    }
+    if (index == 0) {
+        for (int i = 0; i < block.columns; i++) {
+            previousBits[i] = readBits(64);
+            values[i] = fromBits(previousBits[i]);
+        }
+    } else {
+        int64_t dod = 0;
+        if (readBits(1) != 0) {
+            // Tiền tố '1...10': mỗi bit '1' tiếp theo chuyển sang khoảng rộng hơn
+            bool matched = false;
+            for (const DodRange& range : DOD_RANGES) {
+                if (readBits(1) == 0) {
+                    dod = (int64_t)readBits(range.valueBits) + range.low;
+                    matched = true;
+                    break;
+                }
+            }
+            if (!matched) {
+                dod = (int32_t)(uint32_t)readBits(32);
+            }
+        }
+        delta += dod;
+        timestamp += delta;
+        for (int i = 0; i < block.columns; i++) {
+            values[i] = readValue(i);
+        }
+    }
+    outTimestamp = timestamp;
+    index++;
+    return true;
+}
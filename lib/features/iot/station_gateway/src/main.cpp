@@ -0,0 +1,115 @@
+// Gateway sự kiện quét: trạm POST sự kiện lên /events, app Flutter mở WebSocket
+// /ws?device_id=<trạm>[,<trạm>...] (bỏ device_id = mọi trạm), GET /metrics cho Prometheus.
+//
+//   station_gateway [--port 8090] [--queue-kb 256] [--max-event-kb 16]
+//                   [--ping-s 30] [--max-connections 16384] [--sndbuf-kb 0]
+//                   [--replay-mb 8] [--max-devices 4096]
+//                   [--store "host=... dbname=..."] [--commit-window-us 0]
+//                   [--commit-max-rows 4096] [--store-queue 65536]
+//                   [--readers /var/lib/station_gateway/readers.idx] [--readers-db CONNINFO]
+//                   [--readers-refresh-s 300] [--telemetry-series 65536]
+//                   [--telemetry-raw-h 24] [--telemetry-days 7] [--telemetry-coarse-days 90]
+//
+// --readers: POST /api/iot/scan-student-card trả độc giả từ snapshot mmap; snapshot được dựng
+// lại từ bảng readers của --readers-db (mặc định = --store), không có DB thì chỉ đọc file.
+// POST /api/iot/heartbeat ghi lịch sử heartbeat (mẫu gốc --telemetry-raw-h giờ, bucket 5 phút
+// --telemetry-days ngày, bucket 1 giờ --telemetry-coarse-days ngày), GET /api/iot/telemetry truy
+// vấn; --telemetry-series 0 để tắt.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "gateway_server.h"
+
+static GatewayServer* server = nullptr;
+
+static void onSignal(int) {
+    if (server != nullptr) {
+        server->stop();
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "usage: %s [--port N] [--queue-kb N] [--max-event-kb N] [--ping-s N] [--max-connections N] "
+            "[--sndbuf-kb N] [--replay-mb N] [--max-devices N] [--store CONNINFO] [--commit-window-us N] "
+            "[--commit-max-rows N] [--store-queue N] [--readers PATH] [--readers-db CONNINFO] "
+            "[--readers-refresh-s N] [--telemetry-series N] [--telemetry-raw-h N] [--telemetry-days N] "
+            "[--telemetry-coarse-days N]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    GatewayConfig config;
+    const char* readersDb = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        long value = atol(argv[i + 1]);
+        if (strcmp(argv[i], "--port") == 0) {
+            config.port = (uint16_t)value;
+        } else if (strcmp(argv[i], "--queue-kb") == 0) {
+            config.clientQueueBytes = (size_t)value * 1024;
+        } else if (strcmp(argv[i], "--max-event-kb") == 0) {
+            config.maxEventBytes = (size_t)value * 1024;
+        } else if (strcmp(argv[i], "--ping-s") == 0) {
+            config.pingIntervalMs = (uint32_t)value * 1000;
+        } else if (strcmp(argv[i], "--max-connections") == 0) {
+            config.maxConnections = (size_t)value;
+        } else if (strcmp(argv[i], "--sndbuf-kb") == 0) {
+            config.socketSendBytes = (int)value * 1024;
+        } else if (strcmp(argv[i], "--replay-mb") == 0) {
+            config.replayBytes = (size_t)value * 1024 * 1024;
+        } else if (strcmp(argv[i], "--max-devices") == 0) {
+            config.maxDevices = (size_t)value;
+        } else if (strcmp(argv[i], "--store") == 0) {
+            config.store.conninfo = argv[i + 1];
+        } else if (strcmp(argv[i], "--commit-window-us") == 0) {
+            config.store.windowUs = (uint32_t)value;
+        } else if (strcmp(argv[i], "--commit-max-rows") == 0) {
+            config.store.maxRows = (size_t)std::max(1L, value);
+        } else if (strcmp(argv[i], "--store-queue") == 0) {
+            config.store.maxPending = (size_t)value;
+        } else if (strcmp(argv[i], "--readers") == 0) {
+            config.readers.path = argv[i + 1];
+        } else if (strcmp(argv[i], "--readers-db") == 0) {
+            readersDb = argv[i + 1];
+        } else if (strcmp(argv[i], "--readers-refresh-s") == 0) {
+            config.readers.refreshS = (uint32_t)std::max(1L, value);
+        } else if (strcmp(argv[i], "--telemetry-series") == 0) {
+            config.telemetry.maxSeries = (size_t)value;
+        } else if (strcmp(argv[i], "--telemetry-raw-h") == 0) {
+            config.telemetry.rawRetentionS = (uint32_t)std::max(1L, value) * 3600;
+        } else if (strcmp(argv[i], "--telemetry-days") == 0) {
+            config.telemetry.rollupRetentionS = (uint32_t)std::max(1L, value) * 86400;
+        } else if (strcmp(argv[i], "--telemetry-coarse-days") == 0) {
+            config.telemetry.coarseRetentionS = (uint32_t)std::max(1L, value) * 86400;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    config.readers.conninfo = readersDb != nullptr ? readersDb : config.store.conninfo;
+    // Một sự kiện lớn nhất (kèm header frame) phải vừa hàng đợi của subscriber
+    if (config.clientQueueBytes < config.maxEventBytes + WS_MAX_FRAME_HEADER) {
+        fprintf(stderr, "--queue-kb must be larger than --max-event-kb\n");
+        return 2;
+    }
+    
+    GatewayServer gateway(config);
+    if (!gateway.begin()) {
+        return 1;
+    }
+    server = &gateway;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    
+    gateway.run();
+    gateway.printStats();
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include "reader_index.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libpq-fe.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <chrono>
+
+#define SNAPSHOT_MAGIC "RDRIDX01"
+#define SNAPSHOT_MIN_SLOT_BITS 4
+#define SNAPSHOT_MAX_SLOT_BITS 32
+
+// Header 64 byte ở đầu file; bảng băm ngay sau, mảng bản ghi sau bảng băm
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t recordSize;               // sizeof(ReaderRecord): đổi cấu trúc thì file cũ bị từ chối
+    uint32_t slotBits;                 // Bảng băm 2^slotBits ô
+    uint64_t count;
+    uint64_t builtAt;
+    uint64_t slotsOffset;
+    uint64_t recordsOffset;
+    uint64_t fileBytes;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout");
+static_assert(sizeof(ReaderRecord) == 112, "reader record layout");
+
+static const char READERS_QUERY[] =
+    "COPY (SELECT id, card_uid, student_id, name, class FROM readers WHERE card_uid IS NOT NULL) TO STDOUT";
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Trộn bit (bước cuối của MurmurHash3): UID thẻ thật tăng dần theo lô, không dùng trực tiếp được
+static uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+// ============================================
+// ReaderSnapshot
+// ============================================
+
+ReaderSnapshot::~ReaderSnapshot() {
+    if (base != nullptr) {
+        munmap(base, length);
+    }
+}
+
+std::shared_ptr<const ReaderSnapshot> ReaderSnapshot::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        error = "file too small";
+        close(fd);
+        return nullptr;
+    }
+    // Nạp hết trang ngay: tra cứu đầu tiên không phải chờ page fault đọc đĩa
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        error = strerror(errno);
+        return nullptr;
+    }
+    std::shared_ptr<ReaderSnapshot> snapshot(new ReaderSnapshot());
+    snapshot->base = base;
+    snapshot->length = st.st_size;
+    snapshot->device = st.st_dev;
+    snapshot->inode = st.st_ino;
+    
+    const SnapshotHeader* header = static_cast<const SnapshotHeader*>(base);
+    uint64_t slotCount = header->slotBits <= SNAPSHOT_MAX_SLOT_BITS ? 1ull << header->slotBits : 0;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0 || header->recordSize != sizeof(ReaderRecord)) {
+        error = "not a reader snapshot (or built by another version)";
+        return nullptr;
+    }
+    if (header->slotBits < SNAPSHOT_MIN_SLOT_BITS || slotCount == 0 || header->count * 2 > slotCount ||
+        header->slotsOffset != sizeof(SnapshotHeader) ||
+        header->recordsOffset != header->slotsOffset + slotCount * sizeof(Slot) ||
+        header->fileBytes != (uint64_t)st.st_size ||
+        header->recordsOffset + header->count * sizeof(ReaderRecord) != header->fileBytes) {
+        error = "corrupt snapshot header";
+        return nullptr;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(base);
+    snapshot->slots = reinterpret_cast<const Slot*>(bytes + header->slotsOffset);
+    snapshot->mask = slotCount - 1;
+    snapshot->records = reinterpret_cast<const ReaderRecord*>(bytes + header->recordsOffset);
+    snapshot->count = header->count;
+    snapshot->built = header->builtAt;
+    return snapshot;
+}
+
+const ReaderRecord* ReaderSnapshot::find(uint64_t key) const {
+    if (key == 0) {
+        return nullptr;
+    }
+    // Tải ≤ 50% (open() đã kiểm tra): luôn gặp ô trống trước khi đi hết bảng
+    for (uint64_t i = mix(key) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.key == key) {
+            return slot.record < count ? &records[slot.record] : nullptr;
+        }
+        if (slot.key == 0) {
+            return nullptr;
+        }
+    }
+}
+
+// ============================================
+// Dựng snapshot
+// ============================================
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool ReaderIndex::parseUid(const char* text, size_t length, uint64_t& key) {
+    uint64_t value = 0;
+    size_t digits = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == ':' || c == ' ' || c == '-') {
+            continue;
+        }
+        int digit = hexDigit(c);
+        if (digit < 0 || digits >= READER_UID_MAX_BYTES * 2) {
+            return false;
+        }
+        value = (value << 4) | digit;
+        digits++;
+    }
+    if (digits == 0 || digits % 2 != 0) {
+        return false;
+    }
+    key = ((uint64_t)(digits / 2) << 56) | value;
+    return true;
+}
+
+// Chép tối đa capacity - 1 byte, lùi về đầu ký tự UTF-8 nếu cắt giữa ký tự
+static bool copyTruncated(char* out, size_t capacity, const char* text) {
+    if (text == nullptr) {
+        return false;
+    }
+    size_t length = strlen(text);
+    bool truncated = length >= capacity;
+    if (truncated) {
+        length = capacity - 1;
+        while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80) {
+            length--;
+        }
+    }
+    memcpy(out, text, length);
+    return truncated;
+}
+
+bool ReaderIndex::makeEntry(const char* uid, size_t uidLength, uint32_t readerId, const char* mssv,
+                            const char* name, const char* className, ReaderEntry& entry, bool& truncated) {
+    if (!parseUid(uid, uidLength, entry.key)) {
+        return false;
+    }
+    memset(&entry.record, 0, sizeof(entry.record));
+    entry.record.readerId = readerId;
+    truncated = copyTruncated(entry.record.mssv, sizeof(entry.record.mssv), mssv);
+    truncated |= copyTruncated(entry.record.name, sizeof(entry.record.name), name);
+    truncated |= copyTruncated(entry.record.className, sizeof(entry.record.className), className);
+    return true;
+}
+
+bool ReaderIndex::writeSnapshot(const std::string& path, const std::vector<ReaderEntry>& entries, size_t& skipped,
+                                std::string& error) {
+    skipped = 0;
+    uint32_t slotBits = SNAPSHOT_MIN_SLOT_BITS;
+    while ((1ull << slotBits) < entries.size() * 2) {
+        slotBits++;
+    }
+    if (slotBits > SNAPSHOT_MAX_SLOT_BITS) {
+        error = "too many readers";
+        return false;
+    }
+    uint64_t slotCount = 1ull << slotBits;
+    uint64_t recordsOffset = sizeof(SnapshotHeader) + slotCount * sizeof(ReaderSnapshot::Slot);
+    uint64_t capacity = recordsOffset + entries.size() * sizeof(ReaderRecord);
+    
+    // Ghi thẳng vào file tạm qua mmap (không giữ bản thứ hai trong RAM); ftruncate cho sẵn ô trống = 0
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = temporary + ": " + strerror(errno);
+        return false;
+    }
+    void* base = ftruncate(fd, capacity) == 0 ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                              : MAP_FAILED;
+    if (base == MAP_FAILED) {
+        error = temporary + ": " + strerror(errno);
+        close(fd);
+        unlink(temporary.c_str());
+        return false;
+    }
+    uint8_t* bytes = static_cast<uint8_t*>(base);
+    ReaderSnapshot::Slot* slots = reinterpret_cast<ReaderSnapshot::Slot*>(bytes + sizeof(SnapshotHeader));
+    ReaderRecord* records = reinterpret_cast<ReaderRecord*>(bytes + recordsOffset);
+    uint64_t mask = slotCount - 1;
+    uint32_t count = 0;
+    for (const ReaderEntry& entry : entries) {
+        uint64_t i = mix(entry.key) & mask;
+        while (slots[i].key != 0 && slots[i].key != entry.key) {
+            i = (i + 1) & mask;
+        }
+        if (slots[i].key == entry.key) {
+            skipped++;                  // UID trùng (card_uid UNIQUE thì không xảy ra)
+            continue;
+        }
+        slots[i].key = entry.key;
+        slots[i].record = count;
+        records[count++] = entry.record;
+    }
+    
+    SnapshotHeader* header = reinterpret_cast<SnapshotHeader*>(bytes);
+    memcpy(header->magic, SNAPSHOT_MAGIC, 8);
+    header->recordSize = sizeof(ReaderRecord);
+    header->slotBits = slotBits;
+    header->count = count;
+    header->builtAt = (uint64_t)time(nullptr);
+    header->slotsOffset = sizeof(SnapshotHeader);
+    header->recordsOffset = recordsOffset;
+    header->fileBytes = recordsOffset + (uint64_t)count * sizeof(ReaderRecord);
+    uint64_t fileBytes = header->fileBytes;
+    munmap(base, capacity);
+    
+    bool ok = ftruncate(fd, fileBytes) == 0 && fsync(fd) == 0;
+    if (!ok) {
+        error = temporary + ": " + strerror(errno);
+    }
+    close(fd);
+    if (ok && rename(temporary.c_str(), path.c_str()) < 0) {
+        error = path + ": " + strerror(errno);
+        ok = false;
+    }
+    if (!ok) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    // Đồng bộ thư mục để rename() còn sau khi mất điện
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+// Tách một dòng COPY text tại chỗ: bỏ escape, "\N" thành nullptr
+static size_t splitCopyLine(char* line, size_t length, const char** fields, size_t maxFields) {
+    if (length > 0 && line[length - 1] == '\n') {
+        length--;
+    }
+    size_t count = 0;
+    char* out = line;
+    const char* start = line;
+    bool isNull = false;
+    auto finish = [&]() {
+        *out++ = '\0';
+        if (count < maxFields) {
+            fields[count] = isNull ? nullptr : start;
+        }
+        count++;
+        start = out;
+        isNull = false;
+    };
+    for (size_t i = 0; i < length; i++) {
+        char c = line[i];
+        if (c == '\t') {
+            finish();
+            continue;
+        }
+        if (c == '\\' && i + 1 < length) {
+            char next = line[++i];
+            switch (next) {
+                case 'N': isNull = true; continue;
+                case 't': c = '\t'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                default: c = next; break;
+            }
+        }
+        *out++ = c;
+    }
+    finish();
+    return count;
+}
+
+// ============================================
+// ReaderIndex
+// ============================================
+
+ReaderIndex::ReaderIndex(const ReaderIndexConfig& config) : config(config), running(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+ReaderIndex::~ReaderIndex() {
+    stop();
+}
+
+bool ReaderIndex::begin() {
+    bool loaded = swapIn("existing file");
+    if (!loaded && config.conninfo.empty()) {
+        fprintf(stderr, "[Readers] No snapshot at %s and no database to build one\n", config.path.c_str());
+        return false;
+    }
+    running = true;
+    refresher = std::thread(&ReaderIndex::refreshLoop, this);
+    return true;
+}
+
+void ReaderIndex::stop() {
+    {
+        std::lock_guard<std::mutex> guard(waitLock);
+        running = false;
+    }
+    wake.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+std::shared_ptr<const ReaderSnapshot> ReaderIndex::current() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return snapshot;
+}
+
+ReaderIndexStats ReaderIndex::getStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+bool ReaderIndex::swapIn(const std::string& reason) {
+    std::string error;
+    std::shared_ptr<const ReaderSnapshot> next = ReaderSnapshot::open(config.path, error);
+    if (!next) {
+        fprintf(stderr, "[Readers] Cannot open %s: %s\n", config.path.c_str(), error.c_str());
+        return false;
+    }
+    std::shared_ptr<const ReaderSnapshot> previous;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        previous = snapshot;            // munmap ngoài khóa (khi request cuối trả bản cũ)
+        snapshot = next;
+        stats.readers = next->size();
+        stats.fileBytes = next->bytes();
+        stats.builtAt = next->builtAt();
+        stats.swaps++;
+    }
+    printf("[Readers] Loaded %zu readers (%.1f MB, %s)\n", next->size(), next->bytes() / 1e6, reason.c_str());
+    return true;
+}
+
+bool ReaderIndex::rebuild() {
+    uint64_t started = nowUs();
+    PGconn* conn = PQconnectdb(config.conninfo.c_str());
+    std::vector<ReaderEntry> entries;
+    size_t invalid = 0;
+    size_t truncated = 0;
+    bool ok = PQstatus(conn) == CONNECTION_OK;
+    if (ok) {
+        PGresult* result = PQexec(conn, READERS_QUERY);
+        ok = PQresultStatus(result) == PGRES_COPY_OUT;
+        PQclear(result);
+    }
+    // Dòng: id, card_uid, student_id, name, class
+    char* line = nullptr;
+    int length;
+    while (ok && (length = PQgetCopyData(conn, &line, 0)) > 0) {
+        const char* fields[5] = {};
+        ReaderEntry entry;
+        bool cut = false;
+        if (splitCopyLine(line, length, fields, 5) == 5 && fields[0] != nullptr && fields[1] != nullptr &&
+            makeEntry(fields[1], strlen(fields[1]), (uint32_t)strtoul(fields[0], nullptr, 10), fields[2],
+                      fields[3], fields[4], entry, cut)) {
+            entries.push_back(entry);
+            truncated += cut;
+        } else {
+            invalid++;
+        }
+        PQfreemem(line);
+    }
+    if (ok) {
+        PGresult* result = PQgetResult(conn);
+        ok = length == -1 && PQresultStatus(result) == PGRES_COMMAND_OK;
+        PQclear(result);
+        while ((result = PQgetResult(conn)) != nullptr) {
+            PQclear(result);
+        }
+    }
+    std::string error = ok ? std::string() : PQerrorMessage(conn);
+    PQfinish(conn);
+    
+    size_t duplicates = 0;
+    if (ok && !writeSnapshot(config.path, entries, duplicates, error)) {
+        ok = false;
+    }
+    if (ok && !swapIn("rebuilt from database")) {
+        ok = false;
+        error = "cannot reopen the new snapshot";
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    if (!ok) {
+        stats.rebuildFailures++;
+        fprintf(stderr, "[Readers] Rebuild failed, keeping the current snapshot: %s\n", error.c_str());
+        return false;
+    }
+    stats.rebuilds++;
+    stats.skipped = invalid + duplicates;
+    stats.truncated = truncated;
+    stats.lastRebuildUs = nowUs() - started;
+    if (invalid + duplicates > 0) {
+        fprintf(stderr, "[Readers] Skipped %zu rows (bad or duplicate card_uid)\n", invalid + duplicates);
+    }
+    return true;
+}
+
+void ReaderIndex::refreshLoop() {
+    bool first = true;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(waitLock);
+            if (!first || config.conninfo.empty()) {
+                wake.wait_for(guard, std::chrono::seconds(config.refreshS), [this] { return !running; });
+            }
+            if (!running) {
+                break;
+            }
+        }
+        first = false;
+        if (!config.conninfo.empty()) {
+            rebuild();
+            continue;
+        }
+        // Không có DB: file được dựng ở nơi khác rồi rename() đè lên, inode đổi
+        struct stat st;
+        std::shared_ptr<const ReaderSnapshot> loaded = current();
+        if (stat(config.path.c_str(), &st) == 0 &&
+            (!loaded || st.st_ino != loaded->inode || st.st_dev != loaded->device)) {
+            swapIn("file replaced");
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include "replay_ring.h"
+
+// Mỗi sự kiện giữ lại tốn thêm Entry trong ring + một vị trí trong Device::positions
+#define REPLAY_ENTRY_OVERHEAD (sizeof(ReplayRing::Entry) + sizeof(uint64_t))
+
+ReplayRing::ReplayRing(size_t capacityBytes, size_t maxDevices)
+    : capacity(capacityBytes), maxDevices(maxDevices), base(0), bytes(0), evicted(0) {
+}
+
+ReplayRing::~ReplayRing() {
+    for (Entry& entry : entries) {
+        entry.frame->release();
+    }
+}
+
+ReplayRing::Device* ReplayRing::device(const std::string& id, bool create) {
+    auto it = devices.find(id);
+    if (it != devices.end()) {
+        return it->second.get();
+    }
+    if (!create || devices.size() >= maxDevices) {
+        return nullptr;
+    }
+    Device* device = new Device();
+    device->id = id;
+    device->lastSeq = 0;
+    devices.emplace(id, std::unique_ptr<Device>(device));
+    return device;
+}
+
+void ReplayRing::append(Device* device, SharedFrame* frame) {
+    device->lastSeq++;
+    device->positions.push_back(end());
+    frame->retain();
+    entries.push_back({device, device->lastSeq, frame});
+    bytes += frame->size() + REPLAY_ENTRY_OVERHEAD;
+    while (bytes > capacity && !entries.empty()) {
+        evictOldest();
+    }
+}
+
+void ReplayRing::evictOldest() {
+    Entry& oldest = entries.front();
+    // Ring theo thứ tự nhận nên sự kiện cũ nhất cũng là seq còn giữ nhỏ nhất của trạm đó
+    oldest.device->positions.pop_front();
+    bytes -= oldest.frame->size() + REPLAY_ENTRY_OVERHEAD;
+    oldest.frame->release();
+    entries.pop_front();
+    base++;
+    evicted++;
+}
+
+uint64_t ReplayRing::positionAfter(const Device* device, uint64_t since, uint64_t& lost) const {
+    lost = 0;
+    if (since >= device->lastSeq) {
+        return end();
+    }
+    uint64_t first = device->firstRetained();
+    if (since + 1 >= first) {
+        return device->positions[since + 1 - first];
+    }
+    lost = first - (since + 1);
+    return device->positions.empty() ? end() : device->positions.front();
+}
@@ -0,0 +1,337 @@
+#include "scan_store.h"
+#include <libpq-fe.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+#define STORE_COPY_CHUNK 65536         // Byte mỗi lần PQputCopyData
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ScanStore::ScanStore(const StoreConfig& config)
+    : config(config), connection(nullptr), notifyFd(-1), running(false), queuedRows(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+ScanStore::~ScanStore() {
+    stop();
+    if (connection != nullptr) {
+        PQfinish(static_cast<PGconn*>(connection));
+    }
+}
+
+bool ScanStore::begin(int notifyFd) {
+    this->notifyFd = notifyFd;
+    if (!connect()) {
+        return false;
+    }
+    running = true;
+    writer = std::thread(&ScanStore::writerLoop, this);
+    return true;
+}
+
+void ScanStore::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+bool ScanStore::connect() {
+    PGconn* conn = PQconnectdb(config.conninfo.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        fprintf(stderr, "[Store] Connect failed: %s", PQerrorMessage(conn));
+        PQfinish(conn);
+        return false;
+    }
+    connection = conn;
+    // 202 cho trạm nghĩa là đã nằm trên đĩa: không để cấu hình server tắt đồng bộ WAL
+    bool dataError;
+    if (!exec("SET synchronous_commit TO on", dataError)) {
+        PQfinish(conn);
+        connection = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// ============================================
+// Hàng đợi (thread của gateway)
+// ============================================
+
+void ScanStore::submit(Table table, std::string&& row, void* owner, int status) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (table != TABLE_NONE && queuedRows >= config.maxPending) {
+        table = TABLE_NONE;             // Giữ chỗ để trả 503 đúng thứ tự
+        row.clear();
+        status = 503;
+    }
+    if (table == TABLE_NONE && status == 503) {
+        stats.failedRows++;
+    }
+    queue.push_back({table, std::move(row), owner, status, nowUs()});
+    if (table != TABLE_NONE) {
+        queuedRows++;
+        stats.pending = queuedRows;
+    }
+    wake.notify_one();
+}
+
+bool ScanStore::full() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return queuedRows >= config.maxPending;
+}
+
+void ScanStore::takeAcks(std::vector<Ack>& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    out.insert(out.end(), acks.begin(), acks.end());
+    acks.clear();
+}
+
+StoreStats ScanStore::getStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+// ============================================
+// Thread ghi
+// ============================================
+
+void ScanStore::writerLoop() {
+    std::vector<Item> batch;
+    std::vector<Item*> rows;
+    uint64_t retryAt = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return !queue.empty() || !running; });
+        if (queue.empty()) {
+            break;                      // Đang dừng và đã ghi hết
+        }
+        // Cửa sổ group commit tính từ mục cũ nhất: trong lúc lô trước commit, mục mới
+        // đã tích lại và thường đã quá cửa sổ, nên lô sau được ghi ngay
+        if (config.windowUs > 0 && queuedRows > 0 && queuedRows < config.maxRows && running) {
+            auto deadline = std::chrono::steady_clock::time_point(
+                std::chrono::microseconds(queue.front().queuedUs + config.windowUs));
+            wake.wait_until(guard, deadline, [this] { return queuedRows >= config.maxRows || !running; });
+        }
+        size_t taken = 0;
+        while (!queue.empty() && (taken < config.maxRows || queue.front().table == TABLE_NONE)) {
+            if (queue.front().table != TABLE_NONE) {
+                taken++;
+            }
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        queuedRows -= taken;
+        stats.pending = queuedRows;
+        guard.unlock();
+    
+        rows.clear();
+        for (Item& item : batch) {
+            if (item.table != TABLE_NONE) {
+                rows.push_back(&item);
+            }
+        }
+        uint64_t started = nowUs();
+        bool ok = false;
+        bool dataError = false;
+        uint64_t isolated = 0;
+        if (!rows.empty()) {
+            if (connection == nullptr && started >= retryAt && !connect()) {
+                retryAt = started + config.reconnectMs * 1000ull;
+            }
+            if (connection != nullptr) {
+                ok = writeBatch(rows, dataError);
+            }
+            if (!ok && dataError) {
+                // Tìm dòng DB không nhận: ghi lại từng dòng, mỗi dòng một transaction
+                isolated = 1;
+                for (Item* item : rows) {
+                    std::vector<Item*> single(1, item);
+                    bool rowError = false;
+                    if (connection == nullptr || !writeBatch(single, rowError)) {
+                        item->status = rowError ? 400 : 503;
+                    }
+                }
+            } else if (!ok) {
+                for (Item* item : rows) {
+                    item->status = 503;
+                }
+            }
+            if (connection != nullptr && PQstatus(static_cast<PGconn*>(connection)) != CONNECTION_OK) {
+                fprintf(stderr, "[Store] Connection lost, retrying in %u ms\n", config.reconnectMs);
+                PQfinish(static_cast<PGconn*>(connection));
+                connection = nullptr;
+                retryAt = nowUs() + config.reconnectMs * 1000ull;
+            }
+        }
+        uint64_t elapsed = nowUs() - started;
+    
+        guard.lock();
+        for (Item& item : batch) {
+            acks.push_back({item.owner, item.status});
+            if (item.table == TABLE_NONE) {
+                continue;
+            }
+            if (item.status == 400) {
+                stats.rejectedRows++;
+            } else if (item.status == 503) {
+                stats.failedRows++;
+            } else {
+                stats.rows++;
+            }
+        }
+        if (!rows.empty() && (ok || isolated)) {
+            stats.commits++;
+            stats.isolations += isolated;
+            stats.commitUsTotal += elapsed;
+            if (elapsed > stats.commitUsMax) {
+                stats.commitUsMax = elapsed;
+            }
+            if (rows.size() > stats.maxBatch) {
+                stats.maxBatch = rows.size();
+            }
+        }
+        batch.clear();
+        uint64_t one = 1;
+        if (notifyFd >= 0 && write(notifyFd, &one, sizeof(one)) < 0) {
+            // eventfd đang có giá trị chờ đọc: gateway vẫn được đánh thức
+        }
+    }
+}
+
+bool ScanStore::writeBatch(const std::vector<Item*>& items, bool& dataError) {
+    dataError = false;
+    if (!exec("BEGIN", dataError)) {
+        return false;
+    }
+    const Table tables[] = {TABLE_SCANS, TABLE_BORROWS};
+    for (Table table : tables) {
+        if (!copyRows(table, items, dataError)) {
+            bool ignored;
+            exec("ROLLBACK", ignored);
+            return false;
+        }
+    }
+    return exec("COMMIT", dataError);
+}
+
+// Lỗi do dữ liệu (sai kiểu, vi phạm ràng buộc): ghi lại từng dòng thì các dòng khác vẫn vào
+static bool isDataError(PGresult* result) {
+    const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+    return state != nullptr && (strncmp(state, "22", 2) == 0 || strncmp(state, "23", 2) == 0);
+}
+
+bool ScanStore::exec(const char* sql, bool& dataError) {
+    PGconn* conn = static_cast<PGconn*>(connection);
+    PGresult* result = PQexec(conn, sql);
+    bool ok = PQresultStatus(result) == PGRES_COMMAND_OK;
+    if (!ok) {
+        dataError = isDataError(result);
+        fprintf(stderr, "[Store] %s: %s", sql, PQerrorMessage(conn));
+    }
+    PQclear(result);
+    return ok;
+}
+
+bool ScanStore::copyRows(Table table, const std::vector<Item*>& items, bool& dataError) {
+    bool any = false;
+    for (Item* item : items) {
+        any |= item->table == table;
+    }
+    if (!any) {
+        return true;
+    }
+    PGconn* conn = static_cast<PGconn*>(connection);
+    PGresult* result = PQexec(conn, copyCommand(table));
+    bool started = PQresultStatus(result) == PGRES_COPY_IN;
+    if (!started) {
+        dataError = isDataError(result);
+        fprintf(stderr, "[Store] COPY: %s", PQerrorMessage(conn));
+    }
+    PQclear(result);
+    if (!started) {
+        return false;
+    }
+    
+    // Gom dòng thành khối lớn: ít lần gọi libpq, ít gói TCP
+    std::string chunk;
+    chunk.reserve(STORE_COPY_CHUNK + 1024);
+    bool sent = true;
+    for (Item* item : items) {
+        if (item->table != table) {
+            continue;
+        }
+        chunk += item->row;
+        if (chunk.size() >= STORE_COPY_CHUNK) {
+            sent = PQputCopyData(conn, chunk.data(), (int)chunk.size()) == 1;
+            chunk.clear();
+            if (!sent) {
+                break;
+            }
+        }
+    }
+    if (sent && !chunk.empty()) {
+        sent = PQputCopyData(conn, chunk.data(), (int)chunk.size()) == 1;
+    }
+    PQputCopyEnd(conn, sent ? nullptr : "gateway send failed");
+    
+    bool ok = true;
+    while ((result = PQgetResult(conn)) != nullptr) {
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+            ok = false;
+            dataError = isDataError(result);
+            fprintf(stderr, "[Store] COPY: %s", PQresultErrorMessage(result));
+        }
+        PQclear(result);
+    }
+    return ok && sent;
+}
+
+// ============================================
+// Định dạng dòng COPY (text)
+// ============================================
+
+// Mỗi trường kết thúc bằng tab; endRow() đổi tab cuối thành xuống dòng
+void ScanStore::appendText(std::string& row, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        switch (c) {
+            case '\\': row += "\\\\"; break;
+            case '\t': row += "\\t"; break;
+            case '\n': row += "\\n"; break;
+            case '\r': row += "\\r"; break;
+            default: row += c; break;
+        }
+    }
+    row += '\t';
+}
+
+void ScanStore::appendNull(std::string& row) {
+    row += "\\N\t";
+}
+
+void ScanStore::endRow(std::string& row) {
+    row.back() = '\n';
+}
+
+const char* ScanStore::copyCommand(Table table) {
+    switch (table) {
+        case TABLE_SCANS:
+            return "COPY iot_scan_events (device_id, scan_type, scan_data, success, payload, received_at) "
+                   "FROM STDIN";
+        case TABLE_BORROWS:
+            return "COPY borrow_cards (borrower_name, borrower_class, borrower_student_id, borrower_phone, "
+                   "borrower_email, book_name, book_code, borrow_date, expected_return_date) FROM STDIN";
+        default:
+            return "";
+    }
+}
@@ -0,0 +1,382 @@
+#include "telemetry_store.h"
+#include <string.h>
+#include <algorithm>
+
+static const int64_t ROLLUP_STEPS[TELEMETRY_TIERS - 1] = {TELEMETRY_ROLLUP_STEP_S, TELEMETRY_COARSE_STEP_S};
+static const int64_t NONE = INT64_MAX;
+
+// Phần chuỗi nằm ngoài object (chuỗi ngắn nằm gọn trong std::string)
+static size_t heapBytes(const std::string& text) {
+    return text.capacity() > 15 ? text.capacity() + 1 : 0;
+}
+
+static int64_t floorTo(int64_t value, int64_t step) {
+    int64_t rest = value % step;
+    return rest < 0 ? value - rest - step : value - rest;
+}
+
+static int64_t ceilTo(int64_t value, int64_t step) {
+    int64_t floored = floorTo(value, step);
+    return floored == value ? value : floored + step;
+}
+
+// Gộp một mẫu gốc hoặc một bucket của tầng gộp vào bucket kết quả chứa time
+static void merge(std::vector<TelemetryBucket>& buckets, int64_t first, int64_t step, int64_t time, double min,
+                  double max, double sum, uint64_t count) {
+    TelemetryBucket& bucket = buckets[(floorTo(time, step) - first) / step];
+    if (bucket.count == 0) {
+        bucket.min = min;
+        bucket.max = max;
+        bucket.sum = sum;
+        bucket.count = count;
+        return;
+    }
+    bucket.min = std::min(bucket.min, min);
+    bucket.max = std::max(bucket.max, max);
+    bucket.sum += sum;
+    bucket.count += count;
+}
+
+TelemetryStore::Series::Series() : last(INT64_MIN) {
+    for (int i = 1; i < TELEMETRY_TIERS; i++) {
+        tiers[i].open = GorillaEncoder(4);  // min, max, sum, count
+    }
+    memset(pending, 0, sizeof(pending));
+}
+
+TelemetryStore::TelemetryStore(const TelemetryConfig& config) : config(config), seriesCount(0) {
+    // Tầng thô hơn phải giữ lâu hơn tầng mịn: truy vấn dựa vào đó để không hổng dữ liệu
+    this->config.rollupRetentionS = std::max(this->config.rollupRetentionS, this->config.rawRetentionS);
+    this->config.coarseRetentionS = std::max(this->config.coarseRetentionS, this->config.rollupRetentionS);
+    this->config.blockSpanS = std::max<uint32_t>(this->config.blockSpanS, 60);
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ============================================
+// Ghi
+// ============================================
+
+void TelemetryStore::appendTier(Tier& tier, int64_t timestamp, const double* values, int64_t span) {
+    if (!tier.open.empty() && timestamp - tier.open.block().first >= span) {
+        tier.sealed.push_back(tier.open.seal());
+    }
+    tier.open.append(timestamp, values);
+}
+
+// level 0 = tầng 5 phút, 1 = tầng 1 giờ. Mẫu sang bucket mới thì bucket cũ được ghi vào tầng
+void TelemetryStore::addRollup(Series& series, int level, int64_t timestamp, double value) {
+    int64_t step = ROLLUP_STEPS[level];
+    int64_t start = floorTo(timestamp, step);
+    Bucket& bucket = series.pending[level];
+    if (bucket.count > 0 && bucket.start != start) {
+        double point[4] = {bucket.min, bucket.max, bucket.sum, bucket.count};
+        appendTier(series.tiers[level + 1], bucket.start, point, step * TELEMETRY_ROLLUP_BLOCK_POINTS);
+        bucket.count = 0;
+    }
+    if (bucket.count == 0) {
+        bucket.start = start;
+        bucket.min = value;
+        bucket.max = value;
+        bucket.sum = value;
+        bucket.count = 1;
+        return;
+    }
+    bucket.min = std::min(bucket.min, value);
+    bucket.max = std::max(bucket.max, value);
+    bucket.sum += value;
+    bucket.count += 1;
+}
+
+bool TelemetryStore::append(const std::string& device, const std::string& metric, int64_t timestamp, double value) {
+    if (!enabled()) {
+        return false;
+    }
+    Device* owner;
+    auto found = devices.find(device);
+    if (found != devices.end()) {
+        owner = &found->second;
+    } else {
+        if (seriesCount >= config.maxSeries) {
+            stats.dropped++;
+            return false;
+        }
+        owner = &devices[device];
+        owner->lastSeen = timestamp;
+    }
+    auto slot = owner->series.find(metric);
+    if (slot == owner->series.end()) {
+        if (seriesCount >= config.maxSeries) {
+            stats.dropped++;
+            return false;
+        }
+        slot = owner->series.emplace(metric, Series()).first;
+        seriesCount++;
+    }
+    Series& series = slot->second;
+    if (timestamp <= series.last) {
+        stats.outOfOrder++;
+        return false;
+    }
+    series.last = timestamp;
+    owner->lastSeen = std::max(owner->lastSeen, timestamp);
+    
+    appendTier(series.tiers[0], timestamp, &value, config.blockSpanS);
+    for (int level = 0; level < TELEMETRY_TIERS - 1; level++) {
+        addRollup(series, level, timestamp, value);
+    }
+    stats.appended++;
+    return true;
+}
+
+// ============================================
+// Hết hạn
+// ============================================
+
+// Bỏ khối có điểm cuối (cộng độ dài bucket) trước cutoff. Trả về số khối đã bỏ
+size_t TelemetryStore::expireTier(Tier& tier, int64_t cutoff, int64_t step) {
+    size_t expired = 0;
+    while (expired < tier.sealed.size() && tier.sealed[expired].last + step <= cutoff) {
+        expired++;
+    }
+    tier.sealed.erase(tier.sealed.begin(), tier.sealed.begin() + expired);
+    if (tier.sealed.empty() && !tier.open.empty() && tier.open.block().last + step <= cutoff) {
+        tier.open.reset();
+        expired++;
+    }
+    return expired;
+}
+
+void TelemetryStore::expire(int64_t now) {
+    for (auto device = devices.begin(); device != devices.end();) {
+        auto& seriesMap = device->second.series;
+        for (auto it = seriesMap.begin(); it != seriesMap.end();) {
+            Series& series = it->second;
+            // Mẫu gốc "dài" 1 giây: khối hết hạn khi mẫu cuối cũ hơn rawRetentionS
+            stats.expiredBlocks += expireTier(series.tiers[0], now - config.rawRetentionS, 1);
+            bool empty = series.tiers[0].sealed.empty() && series.tiers[0].open.empty();
+            for (int level = 0; level < TELEMETRY_TIERS - 1; level++) {
+                int64_t step = ROLLUP_STEPS[level];
+                int64_t cutoff = now - (level == 0 ? config.rollupRetentionS : config.coarseRetentionS);
+                Tier& tier = series.tiers[level + 1];
+                stats.expiredBlocks += expireTier(tier, cutoff, step);
+                if (series.pending[level].count > 0 && series.pending[level].start + step <= cutoff) {
+                    series.pending[level].count = 0;
+                }
+                empty = empty && tier.sealed.empty() && tier.open.empty() && series.pending[level].count == 0;
+            }
+            if (empty) {
+                it = seriesMap.erase(it);
+                seriesCount--;
+            } else {
+                ++it;
+            }
+        }
+        if (seriesMap.empty()) {
+            device = devices.erase(device);
+        } else {
+            ++device;
+        }
+    }
+}
+
+// ============================================
+// Truy vấn
+// ============================================
+
+const TelemetryStore::Series* TelemetryStore::find(const std::string& device, const std::string& metric) const {
+    auto owner = devices.find(device);
+    if (owner == devices.end()) {
+        return nullptr;
+    }
+    auto slot = owner->second.series.find(metric);
+    return slot == owner->second.series.end() ? nullptr : &slot->second;
+}
+
+int64_t TelemetryStore::oldest(const Tier& tier, const Bucket* pending) {
+    if (!tier.sealed.empty()) {
+        return tier.sealed.front().first;
+    }
+    if (!tier.open.empty()) {
+        return tier.open.block().first;
+    }
+    return pending != nullptr && pending->count > 0 ? pending->start : NONE;
+}
+
+bool TelemetryStore::raw(const std::string& device, const std::string& metric, int64_t from, int64_t to,
+                         size_t limit, std::vector<TelemetryPoint>& out, bool& truncated) const {
+    out.clear();
+    truncated = false;
+    const Series* series = find(device, metric);
+    if (series == nullptr) {
+        return false;
+    }
+    const Tier& tier = series->tiers[0];
+    auto scan = [&](const GorillaBlock& block) {
+        if (block.count == 0 || block.last < from || block.first > to || truncated) {
+            return;
+        }
+        GorillaDecoder decoder(block);
+        int64_t time;
+        double value;
+        while (decoder.next(time, &value) && time <= to) {
+            if (time < from) {
+                continue;
+            }
+            if (out.size() >= limit) {
+                truncated = true;
+                return;
+            }
+            out.push_back({time, value});
+        }
+    };
+    for (const GorillaBlock& block : tier.sealed) {
+        scan(block);
+    }
+    scan(tier.open.block());
+    return true;
+}
+
+bool TelemetryStore::range(const std::string& device, const std::string& metric, int64_t from, int64_t to,
+                           int64_t step, std::vector<TelemetryBucket>& out) const {
+    out.clear();
+    const Series* series = find(device, metric);
+    if (series == nullptr || step <= 0 || to < from) {
+        return false;
+    }
+    // Bucket kết quả [first, end): from/to được nới ra biên bucket
+    int64_t first = floorTo(from, step);
+    int64_t end = floorTo(to, step) + step;
+    std::vector<TelemetryBucket> buckets((end - first) / step);
+    
+    // Tầng 2 trả mọi bucket trước coarseEdge, tầng 1 trả [coarseEdge, rawEdge), mẫu gốc từ rawEdge.
+    // Ranh giới canh theo bucket của tầng thô hơn: bucket đó chứa đủ mọi mẫu của nó (gộp ngay khi
+    // ghi), nên mỗi mẫu được đếm đúng một lần dù tầng mịn đã bỏ một phần của bucket. Tầng mịn
+    // hơn mức step cần thì bỏ qua hẳn (edge = NONE)
+    int64_t rollupOldest = oldest(series->tiers[1], &series->pending[0]);
+    int64_t rawOldest = oldest(series->tiers[0], nullptr);
+    int64_t coarseEdge = NONE;
+    int64_t rawEdge = NONE;
+    if (step % TELEMETRY_COARSE_STEP_S != 0) {
+        coarseEdge = rollupOldest == NONE ? NONE : ceilTo(rollupOldest, TELEMETRY_COARSE_STEP_S);
+        if (step % TELEMETRY_ROLLUP_STEP_S != 0 && rawOldest != NONE) {
+            rawEdge = std::max(ceilTo(rawOldest, TELEMETRY_ROLLUP_STEP_S), coarseEdge);
+        }
+    }
+    
+    double point[GORILLA_MAX_COLUMNS];
+    int64_t time;
+    for (int level = TELEMETRY_TIERS - 2; level >= 0; level--) {
+        int64_t low = std::max(first, level == 1 ? INT64_MIN : coarseEdge);
+        int64_t high = std::min(end, level == 1 ? coarseEdge : rawEdge);
+        if (low >= high) {
+            continue;
+        }
+        int64_t tierStep = ROLLUP_STEPS[level];
+        auto scan = [&](const GorillaBlock& block) {
+            if (block.count == 0 || block.last + tierStep <= low || block.first >= high) {
+                return;
+            }
+            GorillaDecoder decoder(block);
+            while (decoder.next(time, point) && time < high) {
+                if (time >= low) {
+                    merge(buckets, first, step, time, point[0], point[1], point[2], (uint64_t)point[3]);
+                }
+            }
+        };
+        const Tier& tier = series->tiers[level + 1];
+        for (const GorillaBlock& block : tier.sealed) {
+            scan(block);
+        }
+        scan(tier.open.block());
+        const Bucket& pending = series->pending[level];
+        if (pending.count > 0 && pending.start >= low && pending.start < high) {
+            merge(buckets, first, step, pending.start, pending.min, pending.max, pending.sum, (uint64_t)pending.count);
+        }
+    }
+    
+    int64_t low = std::max(first, rawEdge);
+    if (low < end) {
+        const Tier& tier = series->tiers[0];
+        auto scan = [&](const GorillaBlock& block) {
+            if (block.count == 0 || block.last < low || block.first >= end) {
+                return;
+            }
+            GorillaDecoder decoder(block);
+            while (decoder.next(time, point) && time < end) {
+                if (time >= low) {
+                    merge(buckets, first, step, time, point[0], point[0], point[0], 1);
+                }
+            }
+        };
+        for (const GorillaBlock& block : tier.sealed) {
+            scan(block);
+        }
+        scan(tier.open.block());
+    }
+    
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i].count > 0) {
+            buckets[i].start = first + (int64_t)i * step;
+            out.push_back(buckets[i]);
+        }
+    }
+    return true;
+}
+
+void TelemetryStore::listDevices(std::vector<DeviceInfo>& out) const {
+    out.clear();
+    for (const std::string& id : deviceIds()) {
+        const Device& device = devices.at(id);
+        DeviceInfo info;
+        info.id = id;
+        info.lastSeen = device.lastSeen;
+        for (const auto& item : device.series) {
+            info.metrics.push_back(item.first);
+        }
+        out.push_back(std::move(info));
+    }
+}
+
+std::vector<std::string> TelemetryStore::deviceIds() const {
+    std::vector<std::string> ids;
+    ids.reserve(devices.size());
+    for (const auto& item : devices) {
+        ids.push_back(item.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+TelemetryStats TelemetryStore::getStats() const {
+    TelemetryStats result = stats;
+    result.devices = devices.size();
+    result.series = seriesCount;
+    // Ước lượng bộ nhớ: node map/unordered_map (con trỏ + tên), Series, khối đã đóng và dòng bit
+    size_t overhead = 0;
+    for (const auto& device : devices) {
+        overhead += sizeof(Device) + heapBytes(device.first) + 64;
+        for (const auto& item : device.second.series) {
+            const Series& series = item.second;
+            overhead += sizeof(Series) + sizeof(std::string) + heapBytes(item.first) + 32;
+            for (int i = 0; i < TELEMETRY_TIERS; i++) {
+                const Tier& tier = series.tiers[i];
+                uint64_t points = tier.open.block().count;
+                uint64_t bytes = tier.open.block().bytes();
+                for (const GorillaBlock& block : tier.sealed) {
+                    points += block.count;
+                    bytes += block.bytes();
+                }
+                result.payloadBytes += bytes;
+                overhead += tier.sealed.capacity() * sizeof(GorillaBlock);
+                if (i == 0) {
+                    result.rawSamples += points;
+                    result.rawBytes += bytes;
+                } else {
+                    result.rollupPoints += points + (series.pending[i - 1].count > 0 ? 1 : 0);
+                }
+            }
+        }
+    }
+    result.memoryBytes = result.payloadBytes + overhead;
+    return result;
+}